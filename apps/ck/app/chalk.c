@@ -35,6 +35,7 @@ Module Name:
 #include <minoca/lib/chalk/bundle.h>
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <getopt.h>
 #include <libgen.h>
@@ -54,6 +55,8 @@ Module Name:
     "Chalk is a nifty scripting language. It's designed to be intuitive, \n"   \
     "small, and easily embeddable. Options are:\n"                             \
     "  -c \"expr\" -- Execute the given expression and exit.\n"                \
+    "  --compile -- Compile each file or directory tree given as an \n"     \
+    "      argument into cached objects, without running anything.\n"      \
     "  --debug-gc -- Stress the garbage collector.\n"                          \
     "  --debug-compiler -- Print the compiled bytecode.\n"                     \
     "  --help -- Show this help text and exit.\n"                              \
@@ -65,6 +68,7 @@ Module Name:
 
 #define CHALK_OPTION_DEBUG_GC 257
 #define CHALK_OPTION_DEBUG_COMPILER 258
+#define CHALK_OPTION_COMPILE 259
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -131,6 +135,28 @@ ChalkReadLine (
     PCK_APP_CONTEXT Context
     );
 
+INT
+ChalkCompilePath (
+    PCK_VM Vm,
+    PCSTR Path
+    );
+
+INT
+ChalkCompileDirectory (
+    PCK_VM Vm,
+    PSTR Path,
+    UINTN PathLength,
+    UINTN NameOffset
+    );
+
+INT
+ChalkCompileModule (
+    PCK_VM Vm,
+    PCSTR Path,
+    PCSTR Name,
+    UINTN NameLength
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -138,6 +164,7 @@ ChalkReadLine (
 struct option ChalkLongOptions[] = {
     {"debug-gc", no_argument, 0, CHALK_OPTION_DEBUG_GC},
     {"debug-compiler", no_argument, 0, CHALK_OPTION_DEBUG_COMPILER},
+    {"compile", no_argument, 0, CHALK_OPTION_COMPILE},
     {"help", no_argument, 0, 'h'},
     {"verbose", no_argument, 0, 'v'},
     {NULL, 0, 0, 0},
@@ -178,6 +205,7 @@ Return Value:
     PSTR ArgumentCopy;
     ULONG ArgumentIndex;
     PSTR BaseName;
+    BOOL Compile;
     CK_APP_CONTEXT Context;
     PCSTR Expression;
     PSTR FileBuffer;
@@ -188,6 +216,7 @@ Return Value:
 
     ArgumentIndex = 1;
     AppIsBundle = FALSE;
+    Compile = FALSE;
     Expression = NULL;
     FileBuffer = NULL;
     ScriptPath = NULL;
@@ -260,6 +289,10 @@ Return Value:
                 Context.Configuration.Flags |= CK_CONFIGURATION_DEBUG_COMPILER;
                 break;
 
+            case CHALK_OPTION_COMPILE:
+                Compile = TRUE;
+                break;
+
             case 'V':
                 printf("Chalk version %d.%d.%d. Copyright 2017 Minoca Corp. "
                        "All Rights Reserved.\n",
@@ -283,7 +316,7 @@ Return Value:
         }
 
         ArgumentIndex = optind;
-        if (ArgumentIndex < ArgumentCount) {
+        if ((Compile == FALSE) && (ArgumentIndex < ArgumentCount)) {
             ScriptPath = Arguments[ArgumentIndex];
             CkAppArgc = ArgumentCount - ArgumentIndex;
             CkAppArgv = Arguments + ArgumentIndex;
@@ -330,11 +363,26 @@ Return Value:
         goto MainEnd;
     }
 
+    //
+    // Precompile the given files and directories if requested. Loading a
+    // module compiles it and saves the object without running it.
+    //
+
+    if (Compile != FALSE) {
+        Status = 0;
+        while (ArgumentIndex < ArgumentCount) {
+            if (ChalkCompilePath(Context.Vm, Arguments[ArgumentIndex]) != 0) {
+                Status = 1;
+            }
+
+            ArgumentIndex += 1;
+        }
+
     //
     // Run the expression if there was one.
     //
 
-    if (Expression != NULL) {
+    } else if (Expression != NULL) {
         Status = CkInterpret(Context.Vm,
                              NULL,
                              Expression,
@@ -737,3 +785,266 @@ Return Value:
     return errno;
 }
 
+INT
+ChalkCompilePath (
+    PCK_VM Vm,
+    PCSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles a Chalk source file, or every Chalk source file in a
+    directory tree. Modules in a tree are named relative to its root, so
+    compiling "lib" compiles "lib/a/b.ck" as the module "a.b".
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Path - Supplies a pointer to the file or directory to compile.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero if any file could not be compiled.
+
+--*/
+
+{
+
+    PCSTR BaseName;
+    PCSTR Extension;
+    CHAR FullPath[PATH_MAX];
+    size_t Length;
+    struct stat Stat;
+
+    if (stat(Path, &Stat) != 0) {
+        fprintf(stderr, "chalk: Cannot stat %s: %s\n", Path, strerror(errno));
+        return 1;
+    }
+
+    if (S_ISDIR(Stat.st_mode)) {
+        Length = strlen(Path);
+        if (Length >= PATH_MAX) {
+            fprintf(stderr, "chalk: Path too long: %s\n", Path);
+            return 1;
+        }
+
+        memcpy(FullPath, Path, Length + 1);
+        while ((Length > 1) && (FullPath[Length - 1] == '/')) {
+            Length -= 1;
+            FullPath[Length] = '\0';
+        }
+
+        return ChalkCompileDirectory(Vm, FullPath, Length, Length + 1);
+    }
+
+    BaseName = strrchr(Path, '/');
+    if (BaseName == NULL) {
+        BaseName = Path;
+
+    } else {
+        BaseName += 1;
+    }
+
+    Extension = strrchr(BaseName, '.');
+    if ((Extension == NULL) ||
+        (strcmp(Extension + 1, CK_SOURCE_EXTENSION) != 0)) {
+
+        fprintf(stderr, "chalk: %s is not a Chalk source file\n", Path);
+        return 1;
+    }
+
+    return ChalkCompileModule(Vm, Path, BaseName, Extension - BaseName);
+}
+
+INT
+ChalkCompileDirectory (
+    PCK_VM Vm,
+    PSTR Path,
+    UINTN PathLength,
+    UINTN NameOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles every Chalk source file in a directory, recursing
+    into subdirectories. Hidden files and directories are skipped.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Path - Supplies a pointer to a buffer of PATH_MAX bytes containing the
+        directory path. The buffer is used to build child paths, and is
+        restored before returning.
+
+    PathLength - Supplies the length of the directory path in bytes, not
+        including the null terminator.
+
+    NameOffset - Supplies the offset into the path where module names start,
+        which is just after the root directory of the tree.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero if any file could not be compiled.
+
+--*/
+
+{
+
+    DIR *Directory;
+    struct dirent *Entry;
+    size_t EntryLength;
+    size_t ExtensionLength;
+    CHAR Name[PATH_MAX];
+    UINTN NameLength;
+    struct stat Stat;
+    INT Status;
+
+    Directory = opendir(Path);
+    if (Directory == NULL) {
+        fprintf(stderr, "chalk: Cannot open %s: %s\n", Path, strerror(errno));
+        return 1;
+    }
+
+    ExtensionLength = strlen(CK_SOURCE_EXTENSION);
+    Status = 0;
+    while (TRUE) {
+        errno = 0;
+        Entry = readdir(Directory);
+        if (Entry == NULL) {
+            if (errno != 0) {
+                fprintf(stderr,
+                        "chalk: Cannot read %s: %s\n",
+                        Path,
+                        strerror(errno));
+
+                Status = 1;
+            }
+
+            break;
+        }
+
+        if (Entry->d_name[0] == '.') {
+            continue;
+        }
+
+        EntryLength = strlen(Entry->d_name);
+        if (PathLength + EntryLength + 2 > PATH_MAX) {
+            fprintf(stderr, "chalk: Path too long in %s\n", Path);
+            Status = 1;
+            continue;
+        }
+
+        Path[PathLength] = '/';
+        memcpy(Path + PathLength + 1, Entry->d_name, EntryLength + 1);
+        if (stat(Path, &Stat) != 0) {
+            Path[PathLength] = '\0';
+            continue;
+        }
+
+        if (S_ISDIR(Stat.st_mode)) {
+            if (ChalkCompileDirectory(Vm,
+                                      Path,
+                                      PathLength + 1 + EntryLength,
+                                      NameOffset) != 0) {
+
+                Status = 1;
+            }
+
+        //
+        // Convert the relative path of a source file into a dotted module
+        // name.
+        //
+
+        } else if ((S_ISREG(Stat.st_mode)) &&
+                   (EntryLength > ExtensionLength + 1) &&
+                   (Entry->d_name[EntryLength - ExtensionLength - 1] == '.') &&
+                   (strcmp(Entry->d_name + EntryLength - ExtensionLength,
+                           CK_SOURCE_EXTENSION) == 0)) {
+
+            NameLength = PathLength + EntryLength - ExtensionLength -
+                         NameOffset;
+
+            memcpy(Name, Path + NameOffset, NameLength);
+            Name[NameLength] = '\0';
+            if (ChalkCompileModule(Vm, Path, Name, NameLength) != 0) {
+                Status = 1;
+            }
+        }
+
+        Path[PathLength] = '\0';
+    }
+
+    closedir(Directory);
+    return Status;
+}
+
+INT
+ChalkCompileModule (
+    PCK_VM Vm,
+    PCSTR Path,
+    PCSTR Name,
+    UINTN NameLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine loads a single module from the given path, which compiles
+    it and saves its object file without running it.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Path - Supplies a pointer to the source file path.
+
+    Name - Supplies a pointer to the module name, with slashes separating
+        package components. This does not need to be null terminated.
+
+    NameLength - Supplies the length of the module name in bytes.
+
+Return Value:
+
+    0 on success.
+
+    1 on failure.
+
+--*/
+
+{
+
+    UINTN Index;
+    CHAR ModuleName[PATH_MAX];
+
+    if (NameLength >= PATH_MAX) {
+        return 1;
+    }
+
+    for (Index = 0; Index < NameLength; Index += 1) {
+        ModuleName[Index] = Name[Index];
+        if (ModuleName[Index] == '/') {
+            ModuleName[Index] = '.';
+        }
+    }
+
+    ModuleName[NameLength] = '\0';
+    if ((!CkEnsureStack(Vm, 1)) || (!CkLoadModule(Vm, ModuleName, Path))) {
+        fprintf(stderr, "chalk: Failed to compile %s\n", Path);
+        return 1;
+    }
+
+    CkStackPop(Vm);
+    return 0;
+}
+
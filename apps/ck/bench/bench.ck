@@ -0,0 +1,200 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    bench.ck
+
+Abstract:
+
+    This module implements the Chalk interpreter benchmark runner. Run it as
+    "chalk bench.ck [name...]", where each optional name selects the
+    benchmarks starting with that string. With no names, every benchmark is
+    run.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+from app import argv;
+import _time;
+from calls import callBenchmarks;
+from dicts import dictBenchmarks;
+from fields import fieldBenchmarks;
+from strings import stringBenchmarks;
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+var NANOSECONDS_PER_SECOND = 1000000000;
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_isSelected (
+    name,
+    selections
+    );
+
+function
+_getTime (
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+main (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the entry point for the benchmark runner.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    0 always.
+
+--*/
+
+{
+
+    var benchmarks;
+    var checksum;
+    var elapsed;
+    var iterations;
+    var name;
+    var selections = argv[1...-1];
+    var start;
+    var total = 0;
+
+    benchmarks = callBenchmarks() + dictBenchmarks() + fieldBenchmarks() +
+                 stringBenchmarks();
+    for (benchmark in benchmarks) {
+        name = benchmark[0];
+        if (!_isSelected(name, selections)) {
+            continue;
+        }
+
+        iterations = benchmark[2];
+        start = _getTime();
+        checksum = (benchmark[1])(iterations);
+        elapsed = _getTime() - start;
+        total += elapsed;
+        Core.print("%-22s %9d iterations %8d us %6d ns/op (%d)" %
+                   [name,
+                    iterations,
+                    elapsed / 1000,
+                    elapsed / iterations,
+                    checksum]);
+    }
+
+    Core.print("%-22s %30d us" % ["total", total / 1000]);
+    return 0;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_isSelected (
+    name,
+    selections
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a benchmark was selected on the
+    command line.
+
+Arguments:
+
+    name - Supplies the name of the benchmark.
+
+    selections - Supplies the list of name prefixes from the command line.
+
+Return Value:
+
+    true if the benchmark should be run.
+
+    false if the benchmark should be skipped.
+
+--*/
+
+{
+
+    if (selections.length() == 0) {
+        return true;
+    }
+
+    for (selection in selections) {
+        if (name.startsWith(selection)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+function
+_getTime (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the current monotonic time.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the time in nanoseconds.
+
+--*/
+
+{
+
+    var now = (_time.clock_gettime)(_time.CLOCK_MONOTONIC);
+
+    return (now[0] * NANOSECONDS_PER_SECOND) + now[1];
+}
+
+main();
+
@@ -0,0 +1,412 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    calls.ck
+
+Abstract:
+
+    This module implements benchmarks for method dispatch: monomorphic,
+    polymorphic, and megamorphic call sites, super calls, and calls on builtin
+    classes.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+class Shape {
+    var _size;
+
+    function
+    __init (
+        size
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine initializes a new shape.
+
+    Arguments:
+
+        size - Supplies the size of the shape.
+
+    Return Value:
+
+        Returns the initialized object.
+
+    --*/
+
+    {
+
+        _size = size;
+        return this;
+    }
+
+    function
+    area (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the area of the shape.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the area.
+
+    --*/
+
+    {
+
+        return _size;
+    }
+
+    function
+    scaled (
+        factor
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the area of the shape scaled by a factor.
+
+    Arguments:
+
+        factor - Supplies the scale factor.
+
+    Return Value:
+
+        Returns the scaled area.
+
+    --*/
+
+    {
+
+        return this.area() * factor;
+    }
+}
+
+class Square is Shape {
+    function
+    area (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the area of the square.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the area.
+
+    --*/
+
+    {
+
+        return super.area() * super.area();
+    }
+}
+
+class Triangle is Shape {
+    function
+    area (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the area of the triangle.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the area.
+
+    --*/
+
+    {
+
+        return (super.area() * super.area()) / 2;
+    }
+}
+
+class Circle is Shape {
+    function
+    area (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the approximate area of the circle.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the area.
+
+    --*/
+
+    {
+
+        return (super.area() * super.area() * 355) / 113;
+    }
+}
+
+class Hexagon is Shape {}
+class Octagon is Shape {}
+class Star is Shape {}
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_monomorphicCalls (
+    iterations
+    );
+
+function
+_polymorphicCalls (
+    iterations
+    );
+
+function
+_megamorphicCalls (
+    iterations
+    );
+
+function
+_builtinCalls (
+    iterations
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+callBenchmarks (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the method call benchmarks.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a list of benchmarks. Each is a list of the name, a function
+    taking an iteration count, and the default iteration count.
+
+--*/
+
+{
+
+    return [
+        ["call.monomorphic", _monomorphicCalls, 2000000],
+        ["call.polymorphic", _polymorphicCalls, 1000000],
+        ["call.megamorphic", _megamorphicCalls, 1000000],
+        ["call.builtin", _builtinCalls, 1000000]
+    ];
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_monomorphicCalls (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine calls the same method on the same class over and over.
+
+Arguments:
+
+    iterations - Supplies the number of calls to make.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var shape = Shape(3);
+    var total = 0;
+
+    for (index in 0..iterations) {
+        total += shape.area();
+    }
+
+    return total;
+}
+
+function
+_polymorphicCalls (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine calls a method from a single call site on a handful of
+    classes, including a super call inside each one.
+
+Arguments:
+
+    iterations - Supplies the number of calls to make.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var shapes = [Square(2), Triangle(4), Circle(3)];
+    var count = shapes.length();
+    var total = 0;
+
+    for (index in 0..iterations) {
+        total += shapes[index % count].scaled(2);
+    }
+
+    return total;
+}
+
+function
+_megamorphicCalls (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine calls a method from a single call site on more classes than
+    an inline cache holds.
+
+Arguments:
+
+    iterations - Supplies the number of calls to make.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var shapes = [Shape(1), Square(2), Triangle(4), Circle(3), Hexagon(5),
+                  Octagon(6), Star(7)];
+
+    var count = shapes.length();
+    var total = 0;
+
+    for (index in 0..iterations) {
+        total += shapes[index % count].area();
+    }
+
+    return total;
+}
+
+function
+_builtinCalls (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine calls primitive methods on the builtin list, string, and
+    dict classes.
+
+Arguments:
+
+    iterations - Supplies the number of loop iterations.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var dict = {"a": 1, "b": 2};
+    var list = [1, 2, 3, 4];
+    var string = "benchmark";
+    var total = 0;
+
+    for (index in 0..iterations) {
+        total += list.length() + string.length() + dict.length();
+    }
+
+    return total;
+}
+
@@ -0,0 +1,258 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    dicts.ck
+
+Abstract:
+
+    This module implements benchmarks for dictionary lookups, insertions,
+    removals, and iteration.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_stringKeys (
+    iterations
+    );
+
+function
+_integerKeys (
+    iterations
+    );
+
+function
+_churn (
+    iterations
+    );
+
+function
+_iterate (
+    iterations
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+dictBenchmarks (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the dictionary benchmarks.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a list of benchmarks. Each is a list of the name, a function
+    taking an iteration count, and the default iteration count.
+
+--*/
+
+{
+
+    return [
+        ["dict.stringkeys", _stringKeys, 1000000],
+        ["dict.integerkeys", _integerKeys, 1000000],
+        ["dict.churn", _churn, 500000],
+        ["dict.iterate", _iterate, 2000]
+    ];
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_stringKeys (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks up constant string keys, in the style of a dictionary
+    used as a record.
+
+Arguments:
+
+    iterations - Supplies the number of lookups to perform.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var record = {
+        "name": "vm",
+        "type": "object",
+        "sources": 3,
+        "flags": 4,
+        "output": 5
+    };
+
+    var total = 0;
+
+    for (index in 0..iterations) {
+        total += record["sources"] + record["output"];
+    }
+
+    return total;
+}
+
+function
+_integerKeys (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills a dictionary with integer keys that share a large
+    stride, and looks them back up.
+
+Arguments:
+
+    iterations - Supplies the number of keys to add and look up.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var dict = {};
+    var total = 0;
+
+    for (index in 0..iterations) {
+        dict[index * 4096] = index;
+    }
+
+    for (index in 0..iterations) {
+        total += dict[index * 4096];
+    }
+
+    return total;
+}
+
+function
+_churn (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds and removes keys in a sliding window, which leaves a
+    steady stream of removed entries behind.
+
+Arguments:
+
+    iterations - Supplies the number of keys to add and remove.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var dict = {};
+    var total = 0;
+
+    for (index in 0..iterations) {
+        dict["key%d" % index] = index;
+        if (index >= 64) {
+            total += dict.remove("key%d" % (index - 64));
+        }
+    }
+
+    return total + dict.length();
+}
+
+function
+_iterate (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine iterates over a medium sized dictionary.
+
+Arguments:
+
+    iterations - Supplies the number of times to walk the dictionary.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var dict = {};
+    var total = 0;
+
+    for (index in 0..1000) {
+        dict["entry%d" % index] = index;
+    }
+
+    for (index in 0..iterations) {
+        for (key in dict) {
+            total += dict[key];
+        }
+    }
+
+    return total;
+}
+
@@ -0,0 +1,282 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    fields.ck
+
+Abstract:
+
+    This module implements benchmarks for field, module variable, and
+    object construction performance.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+class Counter {
+    var _count;
+    var _step;
+
+    function
+    __init (
+        step
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine initializes a new counter.
+
+    Arguments:
+
+        step - Supplies the amount to add on each increment.
+
+    Return Value:
+
+        Returns the initialized object.
+
+    --*/
+
+    {
+
+        _count = 0;
+        _step = step;
+        return this;
+    }
+
+    function
+    increment (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine bumps the counter by its step.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the new count.
+
+    --*/
+
+    {
+
+        _count += _step;
+        return _count;
+    }
+
+    function
+    count (
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine returns the current count.
+
+    Arguments:
+
+        None.
+
+    Return Value:
+
+        Returns the count.
+
+    --*/
+
+    {
+
+        return _count;
+    }
+}
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_fieldAccess (
+    iterations
+    );
+
+function
+_moduleVariables (
+    iterations
+    );
+
+function
+_construction (
+    iterations
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+var moduleTotal = 0;
+var moduleStep = 3;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+fieldBenchmarks (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the field and variable access benchmarks.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a list of benchmarks. Each is a list of the name, a function
+    taking an iteration count, and the default iteration count.
+
+--*/
+
+{
+
+    return [
+        ["field.access", _fieldAccess, 2000000],
+        ["field.module", _moduleVariables, 2000000],
+        ["field.construct", _construction, 500000]
+    ];
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_fieldAccess (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads and writes instance fields through small accessor
+    methods.
+
+Arguments:
+
+    iterations - Supplies the number of increments to perform.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var counter = Counter(2);
+
+    for (index in 0..iterations) {
+        counter.increment();
+    }
+
+    return counter.count();
+}
+
+function
+_moduleVariables (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads and writes module level variables.
+
+Arguments:
+
+    iterations - Supplies the number of updates to perform.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    moduleTotal = 0;
+    for (index in 0..iterations) {
+        moduleTotal += moduleStep;
+    }
+
+    return moduleTotal;
+}
+
+function
+_construction (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates new class instances.
+
+Arguments:
+
+    iterations - Supplies the number of objects to create.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var counter;
+    var total = 0;
+
+    for (index in 0..iterations) {
+        counter = Counter(index);
+        total += counter.increment();
+    }
+
+    return total;
+}
+
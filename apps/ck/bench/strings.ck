@@ -0,0 +1,241 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    strings.ck
+
+Abstract:
+
+    This module implements benchmarks for building strings, in the style of
+    the string manipulation done by mingen.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_concatenate (
+    iterations
+    );
+
+function
+_format (
+    iterations
+    );
+
+function
+_join (
+    iterations
+    );
+
+function
+_splitReplace (
+    iterations
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+stringBenchmarks (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the string building benchmarks.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a list of benchmarks. Each is a list of the name, a function
+    taking an iteration count, and the default iteration count.
+
+--*/
+
+{
+
+    return [
+        ["string.concatenate", _concatenate, 200000],
+        ["string.format", _format, 200000],
+        ["string.join", _join, 100000],
+        ["string.splitreplace", _splitReplace, 100000]
+    ];
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_concatenate (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds up short strings with the plus operator.
+
+Arguments:
+
+    iterations - Supplies the number of strings to build.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var line;
+    var total = 0;
+
+    for (index in 0..iterations) {
+        line = "$O/apps/ck/lib/" + "vm" + ".o: " + "vm.c";
+        total += line.length();
+    }
+
+    return total;
+}
+
+function
+_format (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds strings with the format operator.
+
+Arguments:
+
+    iterations - Supplies the number of strings to build.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var line;
+    var total = 0;
+
+    for (index in 0..iterations) {
+        line = "build %s: %s %d" % ["target", "input", index];
+        total += line.length();
+    }
+
+    return total;
+}
+
+function
+_join (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine joins lists of strings together.
+
+Arguments:
+
+    iterations - Supplies the number of joins to perform.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var line;
+    var parts = ["capi.o", "compiler.o", "core.o", "gc.o", "value.o", "vm.o"];
+    var total = 0;
+
+    for (index in 0..iterations) {
+        line = " ".join(parts);
+        total += line.length();
+    }
+
+    return total;
+}
+
+function
+_splitReplace (
+    iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine splits and rewrites path strings.
+
+Arguments:
+
+    iterations - Supplies the number of paths to process.
+
+Return Value:
+
+    Returns a checksum of the results.
+
+--*/
+
+{
+
+    var path = "apps\\ck\\lib\\vm.c";
+    var pieces;
+    var total = 0;
+
+    for (index in 0..iterations) {
+        pieces = path.replace("\\", "/", -1).split("/", -1);
+        total += pieces.length();
+    }
+
+    return total;
+}
+
@@ -1214,6 +1214,48 @@ Return Value:
     return;
 }
 
+CK_API
+VOID
+CkInternString (
+    PCK_VM Vm,
+    INTN StackIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine replaces the string at the given stack index with the
+    interned copy of that string. Interning strings that are used over and
+    over, such as dictionary keys, saves memory and speeds up lookups. If the
+    value at the given stack index is not a string, nothing happens. Strings
+    pushed as buffers must be finalized before being interned.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    StackIndex - Supplies the stack index of the string to intern. Negative
+        values reference stack indices from the end of the stack.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_VALUE Value;
+
+    Value = CkpGetStackIndex(Vm, StackIndex);
+    if (CK_IS_STRING(*Value)) {
+        *Value = CkpStringInternValue(Vm, *Value);
+    }
+
+    return;
+}
+
 CK_API
 VOID
 CkPushDict (
@@ -1518,7 +1560,7 @@ Return Value:
         }
 
         Index = CK_AS_INTEGER(*Iterator);
-        if ((Index < 0) || (Index >= Dict->Capacity)) {
+        if ((Index < 0) || (Index >= Dict->Used)) {
             *Iterator = CkNullValue;
             return FALSE;
         }
@@ -1527,10 +1569,10 @@ Return Value:
     }
 
     //
-    // Find an occupied slot.
+    // Find the next live entry.
     //
 
-    while (Index < Dict->Capacity) {
+    while (Index < Dict->Used) {
         if (!CK_IS_UNDEFINED(Dict->Entries[Index].Key)) {
             CK_INT_VALUE(*Iterator, Index);
             CK_PUSH(Fiber, Dict->Entries[Index].Key);
@@ -1722,6 +1764,7 @@ Return Value:
         List->Elements.Data[Index] = Value;
     }
 
+    CK_WRITE_BARRIER(Vm, &(List->Header));
     Fiber->StackTop -= 1;
     return;
 }
@@ -2169,6 +2212,7 @@ Return Value:
 {
 
     PCK_FIBER Fiber;
+    CK_VALUE Instance;
     PCK_VALUE Value;
 
     Fiber = Vm->Fiber;
@@ -2182,6 +2226,8 @@ Return Value:
     }
 
     *Value = CK_POP(Fiber);
+    Instance = Fiber->Frames[Fiber->FrameCount - 1].StackStart[0];
+    CK_WRITE_BARRIER(Vm, CK_AS_OBJECT(Instance));
     return;
 }
 
@@ -2297,6 +2343,7 @@ Return Value:
     Value = CkpFindModuleVariable(Vm, Module, Name, TRUE);
     if (Value != NULL) {
         *Value = CK_POP(Fiber);
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
 
     } else {
         Fiber->StackTop -= 1;
@@ -45,12 +45,6 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
-//
-// Define the current freeze file format version.
-//
-
-#define CK_FREEZE_VERSION 1
-
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -165,6 +159,7 @@ BOOL
 CkpThawList (
     PCK_VM Vm,
     PCK_MODULE Module,
+    PCK_OBJECT Owner,
     PCSTR *Contents,
     PUINTN Size,
     PCK_VALUE_ARRAY List
@@ -395,8 +390,10 @@ Return Value:
     }
 
     //
-    // The module name needs to be next, and it better match up with what was
-    // just loaded.
+    // The module name needs to be next. It doesn't have to match the name
+    // being loaded, since the same file can be imported under different
+    // names depending on the search path, and the compiled code does not
+    // depend on it.
     //
 
     Name = CkpThawElement(&Contents, &Size, &NameSize);
@@ -407,10 +404,7 @@ Return Value:
     }
 
     String = CkpThawString(Vm, &Contents, &Size);
-    if ((String == NULL) || (String->Length != Module->Name->Length) ||
-        (CkCompareMemory(String->Value, Module->Name->Value, String->Length) !=
-         0)) {
-
+    if (String == NULL) {
         return FALSE;
     }
 
@@ -470,10 +464,21 @@ Return Value:
                                     &Size,
                                     &(Module->Closure));
 
+            CK_WRITE_BARRIER(Vm, &(Module->Header));
+
         } else if ((NameSize == 4) &&
                    (CkCompareMemory(Name, "Path", 4) == 0)) {
 
-            Module->Path = CkpThawString(Vm, &Contents, &Size);
+            //
+            // Prefer the path the module was actually loaded from, since the
+            // frozen path is stale if the tree was moved after it was saved.
+            //
+
+            String = CkpThawString(Vm, &Contents, &Size);
+            if (Module->Path == NULL) {
+                Module->Path = String;
+                CK_WRITE_BARRIER(Vm, &(Module->Header));
+            }
 
         } else if ((NameSize == 17) &&
                    (CkCompareMemory(Name, "CoreVariableCount", 17) == 0)) {
@@ -847,6 +852,8 @@ Return Value:
     CkpFreezeInteger(Vm, String, Function->UpvalueCount);
     CkpFreezeAdd(Vm, String, "\nArity: ", 8);
     CkpFreezeInteger(Vm, String, Function->Arity);
+    CkpFreezeAdd(Vm, String, "\nCallCaches: ", 13);
+    CkpFreezeInteger(Vm, String, Function->CallCacheCount);
     CkpFreezeAdd(Vm, String, "\nName: ", 7);
     CkpFreezeString(Vm, String, Function->Debug.Name);
     CkpFreezeAdd(Vm, String, "\nFirstLine: ", 12);
@@ -1184,6 +1191,8 @@ Return Value:
         return FALSE;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
+
     CkpPopRoot(Vm);
     Result = TRUE;
     *Contents += 2;
@@ -1202,6 +1211,7 @@ Return Value:
 
             Result = CkpThawList(Vm,
                                  Module,
+                                 &(Function->Header),
                                  Contents,
                                  Size,
                                  &(Function->Constants));
@@ -1224,6 +1234,17 @@ Return Value:
             Result = CkpThawInteger(Contents, Size, &Integer);
             Function->Arity = Integer;
 
+        } else if ((NameSize == 10) &&
+                   (CkCompareMemory(Name, "CallCaches", 10) == 0)) {
+
+            Result = CkpThawInteger(Contents, Size, &Integer);
+            if ((Integer >= 0) && (Integer <= CK_NO_CALL_CACHE)) {
+                Function->CallCacheCount = Integer;
+
+            } else {
+                Result = FALSE;
+            }
+
         } else if ((NameSize == 4) &&
                    (CkCompareMemory(Name, "Name", 4) == 0)) {
 
@@ -1232,6 +1253,8 @@ Return Value:
                 Result = FALSE;
             }
 
+            CK_WRITE_BARRIER(Vm, &(Function->Header));
+
         } else if ((NameSize == 9) &&
                    (CkCompareMemory(Name, "FirstLine", 9) == 0)) {
 
@@ -1258,6 +1281,13 @@ Return Value:
         goto ThawFunctionEnd;
     }
 
+    if ((Result == FALSE) ||
+        (CkpFunctionCreateCallCaches(Vm, Function) != CkSuccess)) {
+
+        Result = FALSE;
+        goto ThawFunctionEnd;
+    }
+
     if ((*Size == 0) || (**Contents != '}')) {
         return FALSE;
     }
@@ -1376,7 +1406,12 @@ Return Value:
     CK_VALUE Value;
 
     StartIndex = Table->List.Count;
-    if (!CkpThawList(Vm, Module, Contents, Size, &(Table->List))) {
+    if (!CkpThawList(Vm,
+                     Module,
+                     &(Module->Header),
+                     Contents,
+                     Size,
+                     &(Table->List))) {
         return FALSE;
     }
 
@@ -1401,6 +1436,7 @@ BOOL
 CkpThawList (
     PCK_VM Vm,
     PCK_MODULE Module,
+    PCK_OBJECT Owner,
     PCSTR *Contents,
     PUINTN Size,
     PCK_VALUE_ARRAY List
@@ -1418,6 +1454,8 @@ Routine Description:
 
     Module - Supplies a pointer to the module being thawed.
 
+    Owner - Supplies a pointer to the object that contains the list.
+
     Contents - Supplies a pointer that on input points to the element to read.
         This is updated on output.
 
@@ -1473,6 +1511,7 @@ Return Value:
         //
 
         CkpArrayAppend(Vm, List, Value);
+        CK_WRITE_BARRIER(Vm, Owner);
         if (Index != Count - 1) {
             if ((*Size <= 2) || (**Contents != ',')) {
                 return FALSE;
@@ -660,6 +660,14 @@ Return Value:
 
     Compiler->Function->Debug.Name = CK_AS_STRING(Value);
 
+    //
+    // Once this compiler is torn down, the function is no longer a root. Make
+    // sure any young constants it picked up during compilation can still be
+    // found by young collections.
+    //
+
+    CK_WRITE_BARRIER(Compiler->Parser->Vm, &(Compiler->Function->Header));
+
     //
     // Don't return the function if there were any errors along the way
     // compiling it.
@@ -670,6 +678,13 @@ Return Value:
         goto FinalizeCompilerEnd;
     }
 
+    if (CkpFunctionCreateCallCaches(Compiler->Parser->Vm, Compiler->Function) !=
+        CkSuccess) {
+
+        Compiler->Function = NULL;
+        goto FinalizeCompilerEnd;
+    }
+
     //
     // If this is a child compiler, emit the definition for the function just
     // compiled.
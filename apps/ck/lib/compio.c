@@ -63,6 +63,11 @@ CkpEmitLineNumberInformation (
     ULONG Offset
     );
 
+VOID
+CkpEmitCallCache (
+    PCK_COMPILER Compiler
+    );
+
 VOID
 CkpReadUnicodeEscape (
     PCK_COMPILER Compiler,
@@ -204,16 +209,16 @@ UCHAR CkCompilerOperandSizes[CkOpcodeCount] = {
     1, // CkOpLoadField
     1, // CkOpStoreField
     0, // CkOpPop
-    2, // CkOpCall0
-    2,
-    2,
-    2,
-    2,
-    2,
-    2,
-    2,
-    2, // CkOpCall8
-    3, // CkOpCall
+    4, // CkOpCall0
+    4,
+    4,
+    4,
+    4,
+    4,
+    4,
+    4,
+    4, // CkOpCall8
+    5, // CkOpCall
     1, // CkOpIndirectCall
     4, // CkOpSuperCall0
     4,
@@ -649,6 +654,7 @@ Return Value:
     Symbol = CkpGetSignatureSymbol(Compiler, Signature);
     if (Signature->Arity <= 8) {
         CkpEmitShortOp(Compiler, Op + Signature->Arity, Symbol);
+        CkpEmitCallCache(Compiler);
 
     } else {
         if (Op == CkOpCall0) {
@@ -666,6 +672,7 @@ Return Value:
         Compiler->StackSlots -= Signature->Arity;
         CkpEmitByteOp(Compiler, Op, Signature->Arity);
         CkpEmitShort(Compiler, Symbol);
+        CkpEmitCallCache(Compiler);
     }
 
     return;
@@ -713,6 +720,7 @@ Return Value:
     Symbol = CkpGetMethodSymbol(Compiler, Name, Length);
     if (ArgumentCount <= 8) {
         CkpEmitShortOp(Compiler, CkOpCall0 + ArgumentCount, Symbol);
+        CkpEmitCallCache(Compiler);
 
     } else {
         if (ArgumentCount >= MAX_UCHAR) {
@@ -722,6 +730,7 @@ Return Value:
 
         CkpEmitByteOp(Compiler, CkOpCall, ArgumentCount);
         CkpEmitShort(Compiler, Symbol);
+        CkpEmitCallCache(Compiler);
 
         //
         // Manually track the stack usage since the instruction itself doesn't
@@ -1831,3 +1840,44 @@ Return Value:
     return -1;
 }
 
+VOID
+CkpEmitCallCache (
+    PCK_COMPILER Compiler
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the inline cache index operand that follows the symbol
+    of every method call instruction.
+
+Arguments:
+
+    Compiler - Supplies a pointer to the compiler.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_FUNCTION Function;
+
+    //
+    // Call sites beyond what fits in the operand simply go without a cache.
+    //
+
+    Function = Compiler->Function;
+    if (Function->CallCacheCount >= CK_NO_CALL_CACHE) {
+        CkpEmitShort(Compiler, CK_NO_CALL_CACHE);
+        return;
+    }
+
+    CkpEmitShort(Compiler, Function->CallCacheCount);
+    Function->CallCacheCount += 1;
+    return;
+}
+
@@ -38,6 +38,12 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the number of garbage collection statistics returned to scripts.
+//
+
+#define CK_GARBAGE_STATISTIC_COUNT 13
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -69,6 +75,12 @@ CkpCoreAddPrimitive (
     PCK_PRIMITIVE_FUNCTION Function
     );
 
+VOID
+CkpCorePatchClasses (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
 BOOL
 CkpObjectLogicalNot (
     PCK_VM Vm,
@@ -183,6 +195,18 @@ CkpCoreGarbageCollect (
     PCK_VALUE Arguments
     );
 
+BOOL
+CkpCoreGarbageCollectYoung (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    );
+
+BOOL
+CkpCoreGarbageStatistics (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    );
+
 BOOL
 CkpCoreImportModule (
     PCK_VM Vm,
@@ -273,8 +297,31 @@ CK_PRIMITIVE_DESCRIPTION CkFunctionPrimitives[] = {
     {NULL, 0, NULL}
 };
 
+//
+// Define the names of the garbage collection statistics returned by
+// Core.gcStatistics. These must line up with the values filled in there.
+//
+
+PCSTR CkGarbageStatisticNames[CK_GARBAGE_STATISTIC_COUNT] = {
+    "youngCollections",
+    "fullCollections",
+    "youngTime",
+    "fullTime",
+    "lastPause",
+    "maxPause",
+    "promoted",
+    "freed",
+    "bytesAllocated",
+    "youngBytes",
+    "oldBytes",
+    "nextCollection",
+    "nurserySize",
+};
+
 CK_PRIMITIVE_DESCRIPTION CkCorePrimitives[] = {
     {"gc@0", 0, CkpCoreGarbageCollect},
+    {"gcYoung@0", 0, CkpCoreGarbageCollectYoung},
+    {"gcStatistics@0", 0, CkpCoreGarbageStatistics},
     {"importModule@1", 1, CkpCoreImportModule},
     {"_write@1", 1, CkpCoreWrite},
     {"modules@0", 0, CkpCoreGetModules},
@@ -316,7 +363,6 @@ Return Value:
     PCK_BUILTIN_CLASSES Classes;
     PCK_MODULE CoreModule;
     CK_ERROR_TYPE Error;
-    PCK_OBJECT Object;
     PCK_CLASS ObjectMeta;
     UINTN Size;
     CK_VALUE Value;
@@ -346,6 +392,7 @@ Return Value:
     }
 
     Classes->Object->Super = Classes->Object;
+    CK_WRITE_BARRIER(Vm, &(Classes->Object->Header));
     CkpCoreAddPrimitives(Vm, Classes->Object, CkObjectPrimitives);
 
     //
@@ -373,6 +420,9 @@ Return Value:
     Classes->Object->Header.Class = ObjectMeta;
     ObjectMeta->Header.Class = Classes->Class;
     Classes->Class->Header.Class = Classes->Class;
+    CK_WRITE_BARRIER(Vm, &(Classes->Object->Header));
+    CK_WRITE_BARRIER(Vm, &(ObjectMeta->Header));
+    CK_WRITE_BARRIER(Vm, &(Classes->Class->Header));
     CkpBindSuperclass(Vm, ObjectMeta, Classes->Class);
 
     //
@@ -443,25 +493,10 @@ Return Value:
     // associated classes existed.
     //
 
-    Object = Vm->FirstObject;
-    while (Object != NULL) {
-        if (Object->Type == CkObjectString) {
-            Object->Class = Classes->String;
-
-        } else if (Object->Type == CkObjectClosure) {
-            Object->Class = Classes->Function;
-
-        } else if (Object->Type == CkObjectDict) {
-            Object->Class = Classes->Dict;
-
-        } else if (Object->Type == CkObjectFiber) {
-            Object->Class = Classes->Fiber;
-        }
-
-        Object = Object->Next;
-    }
-
+    CkpCorePatchClasses(Vm, Vm->FirstObject);
+    CkpCorePatchClasses(Vm, Vm->OldObjects);
     CoreModule->Header.Class = Classes->Module;
+    CK_WRITE_BARRIER(Vm, &(CoreModule->Header));
 
     //
     // Set some flags on the special builtin classes.
@@ -793,6 +828,57 @@ Return Value:
     return;
 }
 
+VOID
+CkpCorePatchClasses (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine patches up the classes of any core objects that were created
+    before their associated classes existed.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the first object in the list to patch.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_BUILTIN_CLASSES Classes;
+
+    Classes = &(Vm->Class);
+    while (Object != NULL) {
+        if (Object->Type == CkObjectString) {
+            Object->Class = Classes->String;
+
+        } else if (Object->Type == CkObjectClosure) {
+            Object->Class = Classes->Function;
+
+        } else if (Object->Type == CkObjectDict) {
+            Object->Class = Classes->Dict;
+
+        } else if (Object->Type == CkObjectFiber) {
+            Object->Class = Classes->Fiber;
+        }
+
+        CK_WRITE_BARRIER(Vm, Object);
+        Object = Object->Next;
+    }
+
+    return;
+}
+
 BOOL
 CkpObjectInit (
     PCK_VM Vm,
@@ -1177,6 +1263,7 @@ Return Value:
         }
 
         CK_OBJECT_VALUE(Instance->Fields[0], Dict);
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
 
     } else {
         Dict = CK_AS_DICT(Instance->Fields[0]);
@@ -1646,6 +1733,115 @@ Return Value:
     return TRUE;
 }
 
+BOOL
+CkpCoreGarbageCollectYoung (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the primitive to collect only the young objects,
+    those allocated since the last garbage collection.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Arguments - Supplies the function arguments.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if execution caused a runtime error.
+
+--*/
+
+{
+
+    CkpCollectYoungGarbage(Vm);
+    return TRUE;
+}
+
+BOOL
+CkpCoreGarbageStatistics (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the primitive that returns a dictionary of garbage
+    collection statistics. Times are in microseconds.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Arguments - Supplies the function arguments.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if execution caused a runtime error.
+
+--*/
+
+{
+
+    PCK_DICT Dict;
+    UINTN Index;
+    CK_VALUE Key;
+    PCSTR Name;
+    PCK_GARBAGE_STATISTICS Statistics;
+    CK_VALUE Value;
+    CK_INTEGER Values[CK_GARBAGE_STATISTIC_COUNT];
+
+    Statistics = &(Vm->GarbageStatistics);
+    Values[0] = Statistics->YoungRuns;
+    Values[1] = Statistics->FullRuns;
+    Values[2] = Statistics->YoungTime;
+    Values[3] = Statistics->FullTime;
+    Values[4] = Statistics->LastPause;
+    Values[5] = Statistics->MaxPause;
+    Values[6] = Statistics->Promoted;
+    Values[7] = Statistics->Freed;
+    Values[8] = Vm->BytesAllocated;
+    Values[9] = Vm->YoungBytes;
+    Values[10] = Vm->OldBytes;
+    Values[11] = Vm->NextGarbageCollection;
+    Values[12] = Vm->Configuration.NurserySize;
+    Dict = CkpDictCreate(Vm);
+    if (Dict == NULL) {
+        return FALSE;
+    }
+
+    CkpPushRoot(Vm, &(Dict->Header));
+    for (Index = 0; Index < CK_GARBAGE_STATISTIC_COUNT; Index += 1) {
+        Name = CkGarbageStatisticNames[Index];
+        Key = CkpStringCreate(Vm, Name, strlen(Name));
+        if (CK_IS_NULL(Key)) {
+            CkpPopRoot(Vm);
+            return FALSE;
+        }
+
+        CK_INT_VALUE(Value, Values[Index]);
+        CkpPushRoot(Vm, CK_AS_OBJECT(Key));
+        CkpDictSet(Vm, Dict, Key, Value);
+        CkpPopRoot(Vm);
+    }
+
+    CkpPopRoot(Vm);
+    CK_OBJECT_VALUE(Arguments[0], Dict);
+    return TRUE;
+}
+
 BOOL
 CkpCoreImportModule (
     PCK_VM Vm,
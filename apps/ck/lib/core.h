@@ -31,6 +31,12 @@ Module Name:
 
 #define CK_FREEZE_SIGNATURE_SIZE 4
 
+//
+// Define the current freeze file format version.
+//
+
+#define CK_FREEZE_VERSION 2
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
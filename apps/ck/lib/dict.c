@@ -36,15 +36,17 @@ Module Name:
 //
 
 //
-// Define the maximum percentage of dictionary hash table entries that can be
-// filled before the table is resized. This is roughly percent times ten
-// (it's actually 1024ths to turn a divide into a shift).
+// Define the maximum percentage of dictionary index slots that can be filled
+// before the table is resized. This also sets the size of the entries array
+// relative to the index. This is roughly percent times ten (it's actually
+// 1024ths to turn a divide into a shift).
 //
 
 #define DICT_LOAD_FACTOR 768
 
 //
-// Define how much bigger to make a dictionary when growing it.
+// Define how much room to leave for new entries when resizing a dictionary,
+// as a multiple of the live entry count.
 //
 
 #define DICT_GROW_FACTOR 2
@@ -57,10 +59,26 @@ Module Name:
 #define DICT_SHRINK_FACTOR 3
 
 //
-// Define the minimum capacity of a dictionary.
+// Define the minimum number of index slots in a dictionary. This must be a
+// power of two.
 //
 
-#define DICT_MIN_CAPACITY 16
+#define DICT_MIN_INDEX_SIZE 8
+
+//
+// Define the value of an empty index slot. Other slots hold one more than the
+// index of their entry.
+//
+
+#define DICT_INDEX_EMPTY 0
+
+//
+// Define how many more bits of the hash are mixed into the probe sequence on
+// each collision. This lets the high bits of the hash break up runs caused
+// by keys whose low bits collide, such as integers with a common stride.
+//
+
+#define DICT_PERTURB_SHIFT 5
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -145,6 +163,13 @@ CkpDictCopy (
 PCK_DICT_ENTRY
 CkpDictFindEntry (
     PCK_DICT Dict,
+    CK_VALUE Key,
+    ULONG Hash
+    );
+
+BOOL
+CkpDictAreKeysEqual (
+    CK_VALUE EntryKey,
     CK_VALUE Key
     );
 
@@ -152,15 +177,18 @@ VOID
 CkpDictResize (
     PCK_VM Vm,
     PCK_DICT Dict,
-    UINTN NewCapacity
+    UINTN IndexSize
     );
 
-BOOL
-CkpDictAddEntry (
-    PCK_DICT_ENTRY Entries,
-    UINTN Capacity,
-    CK_VALUE Key,
-    CK_VALUE Value
+UINTN
+CkpDictGetIndexSize (
+    UINTN Count
+    );
+
+VOID
+CkpDictInsertIndex (
+    PCK_DICT Dict,
+    UINTN EntryIndex
     );
 
 ULONG
@@ -233,8 +261,11 @@ Return Value:
 
     CkpInitializeObject(Vm, &(Dict->Header), CkObjectDict, Vm->Class.Dict);
     Dict->Count = 0;
+    Dict->Used = 0;
     Dict->Capacity = 0;
+    Dict->IndexSize = 0;
     Dict->Entries = NULL;
+    Dict->Indices = NULL;
     return Dict;
 }
 
@@ -268,7 +299,11 @@ Return Value:
 
     PCK_DICT_ENTRY Entry;
 
-    Entry = CkpDictFindEntry(Dict, Key);
+    if (Dict->Count == 0) {
+        return CK_UNDEFINED_VALUE;
+    }
+
+    Entry = CkpDictFindEntry(Dict, Key, CkpHashValue(Key));
     if (Entry != NULL) {
         return Entry->Value;
     }
@@ -308,14 +343,46 @@ Return Value:
 
 {
 
-    UINTN NewCapacity;
+    PCK_DICT_ENTRY Entry;
+    ULONG Hash;
+    UINTN IndexSize;
 
-    if ((Dict->Count + 1) > (Dict->Capacity * DICT_LOAD_FACTOR / 1024)) {
-        NewCapacity = Dict->Capacity * DICT_GROW_FACTOR;
-        if (NewCapacity < DICT_MIN_CAPACITY) {
-            NewCapacity = DICT_MIN_CAPACITY;
+    Hash = CkpHashValue(Key);
+    if (Dict->Count != 0) {
+        Entry = CkpDictFindEntry(Dict, Key, Hash);
+        if (Entry != NULL) {
+            Entry->Value = Value;
+            CK_WRITE_BARRIER(Vm, &(Dict->Header));
+            return;
         }
+    }
 
+    //
+    // String keys are interned so that lookups with other interned strings
+    // can usually get by comparing pointers. Interning may allocate, so
+    // protect the value from the garbage collector (the intern routine
+    // protects the string itself).
+    //
+
+    if ((CK_IS_STRING(Key)) &&
+        ((CK_AS_OBJECT(Key)->Flags & CK_OBJECT_INTERNED) == 0)) {
+
+        if (CK_IS_OBJECT(Value)) {
+            CkpPushRoot(Vm, CK_AS_OBJECT(Value));
+        }
+
+        Key = CkpStringInternValue(Vm, Key);
+        if (CK_IS_OBJECT(Value)) {
+            CkpPopRoot(Vm);
+        }
+    }
+
+    //
+    // If the entries array is used up, rebuild the table. This squeezes out
+    // any removed entries, and grows the table if it's actually full.
+    //
+
+    if (Dict->Used == Dict->Capacity) {
         if (CK_IS_OBJECT(Key)) {
             CkpPushRoot(Vm, CK_AS_OBJECT(Key));
         }
@@ -324,7 +391,8 @@ Return Value:
             CkpPushRoot(Vm, CK_AS_OBJECT(Value));
         }
 
-        CkpDictResize(Vm, Dict, NewCapacity);
+        IndexSize = CkpDictGetIndexSize((Dict->Count + 1) * DICT_GROW_FACTOR);
+        CkpDictResize(Vm, Dict, IndexSize);
         if (CK_IS_OBJECT(Value)) {
             CkpPopRoot(Vm);
         }
@@ -334,10 +402,17 @@ Return Value:
         }
     }
 
-    if (CkpDictAddEntry(Dict->Entries, Dict->Capacity, Key, Value) != FALSE) {
+    if (Dict->Used < Dict->Capacity) {
+        Entry = &(Dict->Entries[Dict->Used]);
+        Entry->Key = Key;
+        Entry->Value = Value;
+        Entry->Hash = Hash;
+        CkpDictInsertIndex(Dict, Dict->Used);
+        Dict->Used += 1;
         Dict->Count += 1;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Dict->Header));
     return;
 }
 
@@ -371,51 +446,51 @@ Return Value:
 
 {
 
-    UINTN Capacity;
     PCK_DICT_ENTRY Entry;
+    UINTN IndexSize;
     CK_VALUE Value;
 
-    Entry = CkpDictFindEntry(Dict, Key);
+    if (Dict->Count == 0) {
+        return CK_NULL_VALUE;
+    }
+
+    Entry = CkpDictFindEntry(Dict, Key, CkpHashValue(Key));
     if (Entry == NULL) {
         return CK_NULL_VALUE;
     }
 
     //
-    // Remove the entry from the dictionary. Set it to true, which marks it as
-    // a deleted slot (as opposed to an empty slot). When searching for a key,
-    // the search must continue through a deleted slot, but can stop if an
-    // empty slot is found.
+    // Remove the entry by making its key undefined. The index slot is left
+    // pointing at the dead entry so that searches continue through it. Both
+    // are reclaimed the next time the table is rebuilt, or right away if the
+    // dictionary is now empty.
     //
 
     Value = Entry->Value;
     Entry->Key = CK_UNDEFINED_VALUE;
-    Entry->Value = CK_TRUE_VALUE;
+    Entry->Value = CK_UNDEFINED_VALUE;
     Dict->Count -= 1;
-    if ((Dict->Capacity > DICT_MIN_CAPACITY) &&
-        (Dict->Count <
-         (Dict->Capacity / DICT_SHRINK_FACTOR * DICT_LOAD_FACTOR / 1024))) {
+    if (Dict->Count == 0) {
+        CkpDictClear(Vm, Dict);
 
-        if (CK_IS_OBJECT(Value)) {
-            CkpPushRoot(Vm, CK_AS_OBJECT(Value));
-        }
+    } else if ((Dict->IndexSize > DICT_MIN_INDEX_SIZE) &&
+               (Dict->Count < Dict->Capacity / DICT_SHRINK_FACTOR)) {
 
         //
-        // Shrink it by the grow factor rather than the shrink factor so
-        // there's a little extra room even after the resize. Shrink less
-        // aggressively than grow.
+        // Leave the same room for growth as an insert would, which shrinks
+        // less aggressively than the shrink factor.
         //
 
-        Capacity = Dict->Capacity / DICT_GROW_FACTOR;
-        if (Capacity < DICT_MIN_CAPACITY) {
-            Capacity = DICT_MIN_CAPACITY;
-        }
-
-        if (Capacity != Dict->Capacity) {
-            CkpDictResize(Vm, Dict, Capacity);
-        }
+        IndexSize = CkpDictGetIndexSize(Dict->Count * DICT_GROW_FACTOR);
+        if (IndexSize < Dict->IndexSize) {
+            if (CK_IS_OBJECT(Value)) {
+                CkpPushRoot(Vm, CK_AS_OBJECT(Value));
+            }
 
-        if (CK_IS_OBJECT(Value)) {
-            CkpPopRoot(Vm);
+            CkpDictResize(Vm, Dict, IndexSize);
+            if (CK_IS_OBJECT(Value)) {
+                CkpPopRoot(Vm);
+            }
         }
     }
 
@@ -449,6 +524,11 @@ Return Value:
 {
 
     Dict->Count = 0;
+    Dict->Used = 0;
+    if (Dict->Indices != NULL) {
+        CkZero(Dict->Indices, Dict->IndexSize * sizeof(ULONG));
+    }
+
     return;
 }
 
@@ -488,13 +568,11 @@ Return Value:
 
     CK_ASSERT(Source != Destination);
 
-    Entry = Source->Entries;
-    for (Index = 0; Index < Source->Capacity; Index += 1) {
+    for (Index = 0; Index < Source->Used; Index += 1) {
+        Entry = &(Source->Entries[Index]);
         if (!CK_IS_UNDEFINED(Entry->Key)) {
             CkpDictSet(Vm, Destination, Entry->Key, Entry->Value);
         }
-
-        Entry += 1;
     }
 
     return;
@@ -862,7 +940,7 @@ Return Value:
 
     ListIndex = 0;
     Entry = Dict->Entries;
-    for (Index = 0; Index < Dict->Capacity; Index += 1) {
+    for (Index = 0; Index < Dict->Used; Index += 1) {
         if (!CK_IS_UNDEFINED(Entry->Key)) {
             List->Elements.Data[ListIndex] = Entry->Key;
             ListIndex += 1;
@@ -924,7 +1002,7 @@ Return Value:
         }
 
         Integer = CK_AS_INTEGER(Arguments[1]);
-        if ((Integer < 0) || (Integer >= Dict->Capacity)) {
+        if ((Integer < 0) || (Integer >= Dict->Used)) {
             Arguments[0] = CkNullValue;
             return TRUE;
         }
@@ -933,10 +1011,10 @@ Return Value:
     }
 
     //
-    // Find an occupied slot.
+    // Find the next live entry. Entries are kept in insertion order.
     //
 
-    while (Index < Dict->Capacity) {
+    while (Index < Dict->Used) {
         if (!CK_IS_UNDEFINED(Dict->Entries[Index].Key)) {
             CK_INT_VALUE(Arguments[0], Index);
             return TRUE;
@@ -983,7 +1061,7 @@ Return Value:
     UINTN Index;
 
     Dict = CK_AS_DICT(Arguments[0]);
-    Index = CkpGetIndex(Vm, Arguments[1], Dict->Capacity);
+    Index = CkpGetIndex(Vm, Arguments[1], Dict->Used);
     if (Index == MAX_UINTN) {
         return FALSE;
     }
@@ -1035,14 +1113,23 @@ Return Value:
         return FALSE;
     }
 
-    CkpPushRoot(Vm, &(NewDict->Header));
-    CkpDictResize(Vm, NewDict, Dict->Capacity);
-    if (NewDict->Capacity == Dict->Capacity) {
-        CkCopy(NewDict->Entries,
-               Dict->Entries,
-               sizeof(CK_DICT_ENTRY) * NewDict->Capacity);
+    //
+    // Copy the entries and index array wholesale, since they're in the same
+    // allocation and have the same layout for the same index size.
+    //
 
-        NewDict->Count = Dict->Count;
+    CkpPushRoot(Vm, &(NewDict->Header));
+    if (Dict->Count != 0) {
+        CkpDictResize(Vm, NewDict, Dict->IndexSize);
+        if (NewDict->IndexSize == Dict->IndexSize) {
+            CkCopy(NewDict->Entries,
+                   Dict->Entries,
+                   (sizeof(CK_DICT_ENTRY) * NewDict->Capacity) +
+                   (sizeof(ULONG) * NewDict->IndexSize));
+
+            NewDict->Count = Dict->Count;
+            NewDict->Used = Dict->Used;
+        }
     }
 
     CkpPopRoot(Vm);
@@ -1057,7 +1144,8 @@ Return Value:
 PCK_DICT_ENTRY
 CkpDictFindEntry (
     PCK_DICT Dict,
-    CK_VALUE Key
+    CK_VALUE Key,
+    ULONG Hash
     )
 
 /*++
@@ -1065,7 +1153,7 @@ CkpDictFindEntry (
 Routine Description:
 
     This routine finds an entry in the dictionary corresponding to the given
-    key.
+    key. The caller must have checked that the dictionary is not empty.
 
 Arguments:
 
@@ -1073,6 +1161,8 @@ Routine Description:
 
     Key - Supplies the key to find.
 
+    Hash - Supplies the hash of the key.
+
 Return Value:
 
     Returns a pointer to the dict entry on success.
@@ -1084,57 +1174,137 @@ Return Value:
 {
 
     PCK_DICT_ENTRY Entry;
-    UINTN Index;
-    UINTN Loop;
+    ULONG Index;
+    UINTN Mask;
+    ULONG Perturb;
+    UINTN Slot;
 
-    if (Dict->Count == 0) {
-        return NULL;
+    CK_ASSERT(Dict->IndexSize != 0);
+
+    //
+    // Probe the index array until an empty slot is found. The entries array
+    // is smaller than the index array, so there is always an empty slot.
+    //
+
+    Mask = Dict->IndexSize - 1;
+    Perturb = Hash;
+    Slot = Hash & Mask;
+    while (TRUE) {
+        Index = Dict->Indices[Slot];
+        if (Index == DICT_INDEX_EMPTY) {
+            break;
+        }
+
+        Entry = &(Dict->Entries[Index - 1]);
+        if ((Entry->Hash == Hash) &&
+            (CkpDictAreKeysEqual(Entry->Key, Key) != FALSE)) {
+
+            return Entry;
+        }
+
+        Perturb >>= DICT_PERTURB_SHIFT;
+        Slot = ((Slot * 5) + Perturb + 1) & Mask;
     }
 
-    Index = CkpHashValue(Key) % Dict->Capacity;
+    return NULL;
+}
+
+BOOL
+CkpDictAreKeysEqual (
+    CK_VALUE EntryKey,
+    CK_VALUE Key
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares a dictionary key against a key being looked up,
+    whose hashes are already known to match.
+
+Arguments:
+
+    EntryKey - Supplies the key stored in the dictionary. This may be
+        undefined if the entry was removed.
+
+    Key - Supplies the key being looked up.
+
+Return Value:
+
+    TRUE if the keys are equal.
+
+    FALSE if the keys are not equal.
+
+--*/
+
+{
+
+    PCK_STRING EntryString;
+    PCK_STRING String;
+
+    if (EntryKey.Type != Key.Type) {
+        return FALSE;
+    }
+
+    switch (Key.Type) {
+    case CkValueNull:
+        return TRUE;
+
+    case CkValueInteger:
+        return CK_AS_INTEGER(EntryKey) == CK_AS_INTEGER(Key);
+
+    case CkValueObject:
+        if (CK_AS_OBJECT(EntryKey) == CK_AS_OBJECT(Key)) {
+            return TRUE;
+        }
+
+        break;
+
+    default:
+        return FALSE;
+    }
 
     //
-    // Loop looking for the entry, using open entry linear search on collision.
-    // Although there should always be empty slots in the dictionary, some
-    // badly timed allocation failures on resize could result in a full dict.
+    // There is only one interned string with any given contents, so two
+    // different interned strings can't be equal.
     //
 
-    for (Loop = 0; Loop < Dict->Capacity; Loop += 1) {
-        Entry = &(Dict->Entries[Index]);
-        if (CK_IS_UNDEFINED(Entry->Key)) {
-            if (CK_IS_UNDEFINED(Entry->Value)) {
-                break;
-            }
+    if ((CK_IS_STRING(EntryKey)) && (CK_IS_STRING(Key))) {
+        EntryString = CK_AS_STRING(EntryKey);
+        String = CK_AS_STRING(Key);
+        if ((EntryString->Header.Flags & String->Header.Flags &
+             CK_OBJECT_INTERNED) != 0) {
 
-        } else if (CkpAreValuesEqual(Entry->Key, Key) != FALSE) {
-            return Entry;
+            return FALSE;
         }
 
-        //
-        // Move to the next address linearly. Avoid the divide.
-        //
+        if ((EntryString->Length == String->Length) &&
+            (CkCompareMemory(EntryString->Value,
+                             String->Value,
+                             String->Length) == 0)) {
 
-        Index += 1;
-        if (Index == Dict->Capacity) {
-            Index = 0;
+            return TRUE;
         }
+
+        return FALSE;
     }
 
-    return NULL;
+    return CkpAreValuesEqual(EntryKey, Key);
 }
 
 VOID
 CkpDictResize (
     PCK_VM Vm,
     PCK_DICT Dict,
-    UINTN NewCapacity
+    UINTN IndexSize
     )
 
 /*++
 
 Routine Description:
 
-    This routine resizes the given dictionary.
+    This routine rebuilds the given dictionary with a new size, squeezing out
+    any removed entries.
 
 Arguments:
 
@@ -1142,49 +1312,54 @@ Routine Description:
 
     Dict - Supplies a pointer to the dictionary to resize.
 
-    NewCapacity - Supplies the new capacity of the dictionary.
+    IndexSize - Supplies the new number of index slots. This must be a power
+        of two.
 
 Return Value:
 
-    None.
+    None. On allocation failure the dictionary is left as it was.
 
 --*/
 
 {
 
+    UINTN Capacity;
     UINTN Index;
     PCK_DICT_ENTRY NewEntries;
-    PCK_DICT_ENTRY OldEntry;
+    PULONG NewIndices;
+    UINTN NewUsed;
+
+    CK_ASSERT((IndexSize & (IndexSize - 1)) == 0);
+
+    Capacity = IndexSize * DICT_LOAD_FACTOR / 1024;
 
-    CK_ASSERT(NewCapacity >= Dict->Count);
+    CK_ASSERT(Capacity >= Dict->Count);
+
+    NewEntries = CkAllocate(Vm,
+                            (Capacity * sizeof(CK_DICT_ENTRY)) +
+                            (IndexSize * sizeof(ULONG)));
 
-    NewEntries = CkAllocate(Vm, NewCapacity * sizeof(CK_DICT_ENTRY));
     if (NewEntries == NULL) {
         return;
     }
 
-    //
-    // Zero the entries, which also happens to set all the keys to undefined.
-    //
-
-    CkZero(NewEntries, NewCapacity * sizeof(CK_DICT_ENTRY));
+    NewIndices = (PULONG)(NewEntries + Capacity);
+    CkZero(NewIndices, IndexSize * sizeof(ULONG));
 
     //
-    // Re-add all the old entries.
+    // Copy the live entries over in order.
     //
 
-    OldEntry = Dict->Entries;
-    for (Index = 0; Index < Dict->Capacity; Index += 1) {
-        if (!CK_IS_UNDEFINED(OldEntry->Key)) {
-            CkpDictAddEntry(NewEntries,
-                            NewCapacity,
-                            OldEntry->Key,
-                            OldEntry->Value);
+    NewUsed = 0;
+    for (Index = 0; Index < Dict->Used; Index += 1) {
+        if (!CK_IS_UNDEFINED(Dict->Entries[Index].Key)) {
+            NewEntries[NewUsed] = Dict->Entries[Index];
+            NewUsed += 1;
         }
-
-        OldEntry += 1;
     }
 
+    CK_ASSERT(NewUsed == Dict->Count);
+
     //
     // Remove the old array and replace it with the new one.
     //
@@ -1194,79 +1369,99 @@ Return Value:
     }
 
     Dict->Entries = NewEntries;
-    Dict->Capacity = NewCapacity;
+    Dict->Indices = NewIndices;
+    Dict->Capacity = Capacity;
+    Dict->IndexSize = IndexSize;
+    Dict->Used = NewUsed;
+
+    //
+    // Rebuild the index from the saved hashes.
+    //
+
+    for (Index = 0; Index < NewUsed; Index += 1) {
+        CkpDictInsertIndex(Dict, Index);
+    }
+
     return;
 }
 
-BOOL
-CkpDictAddEntry (
-    PCK_DICT_ENTRY Entries,
-    UINTN Capacity,
-    CK_VALUE Key,
-    CK_VALUE Value
+UINTN
+CkpDictGetIndexSize (
+    UINTN Count
     )
 
 /*++
 
 Routine Description:
 
-    This routine sets the value for the given key in a dictionary.
+    This routine determines the index size needed to hold the given number of
+    entries.
 
 Arguments:
 
-    Entries - Supplies a pointer to the entries array.
+    Count - Supplies the number of entries the dictionary needs to hold.
 
-    Capacity - Supplies the size of the entries array.
+Return Value:
 
-    Key - Supplies the key to set the value for.
+    Returns the smallest allowed index size with room for the given count.
 
-    Value - Supplies the value to set.
+--*/
 
-Return Value:
+{
 
-    TRUE if the key was newly added.
+    UINTN IndexSize;
 
-    FALSE if the key was replaced or not added.
+    IndexSize = DICT_MIN_INDEX_SIZE;
+    while ((IndexSize * DICT_LOAD_FACTOR / 1024) < Count) {
+        IndexSize <<= 1;
+    }
 
---*/
+    return IndexSize;
+}
 
-{
+VOID
+CkpDictInsertIndex (
+    PCK_DICT Dict,
+    UINTN EntryIndex
+    )
 
-    PCK_DICT_ENTRY Entry;
-    UINTN Index;
-    UINTN Loop;
+/*++
 
-    Index = CkpHashValue(Key) % Capacity;
+Routine Description:
 
-    //
-    // Don't do this infinitely in the case that all recent resize attempts
-    // have failed to allocate, and the table is now completely full.
-    //
+    This routine adds an entry to the index array of the given dictionary. The
+    caller must have made sure the key isn't already in the dictionary.
 
-    for (Loop = 0; Loop < Capacity; Loop += 1) {
-        Entry = Entries + Index;
-        if (CK_IS_UNDEFINED(Entry->Key)) {
-            Entry->Key = Key;
-            Entry->Value = Value;
-            return TRUE;
+Arguments:
 
-        } else if (CkpAreValuesEqual(Entry->Key, Key) != FALSE) {
-            Entry->Value = Value;
-            return FALSE;
-        }
+    Dict - Supplies a pointer to the dictionary.
 
-        Index += 1;
-        if (Index == Capacity) {
-            Index = 0;
-        }
-    }
+    EntryIndex - Supplies the index of the entry to add.
 
-    //
-    // This case is only reached if the table is completely full and the
-    // element was never added.
-    //
+Return Value:
+
+    None.
+
+--*/
+
+{
 
-    return FALSE;
+    ULONG Hash;
+    UINTN Mask;
+    ULONG Perturb;
+    UINTN Slot;
+
+    Hash = Dict->Entries[EntryIndex].Hash;
+    Mask = Dict->IndexSize - 1;
+    Perturb = Hash;
+    Slot = Hash & Mask;
+    while (Dict->Indices[Slot] != DICT_INDEX_EMPTY) {
+        Perturb >>= DICT_PERTURB_SHIFT;
+        Slot = ((Slot * 5) + Perturb + 1) & Mask;
+    }
+
+    Dict->Indices[Slot] = EntryIndex + 1;
+    return;
 }
 
 ULONG
@@ -31,6 +31,7 @@ Module Name:
 //
 
 #include <dlfcn.h>
+#include <sys/stat.h>
 #include <minoca/lib/types.h>
 
 //
@@ -152,6 +153,35 @@ Return Value:
     return dlsym(Handle, SymbolName);
 }
 
+INT
+CkpCreateDirectory (
+    PCSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a directory that anyone can read, subject to the
+    process umask.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the directory to create.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, including if the directory already exists.
+
+--*/
+
+{
+
+    return mkdir(Path, 0777);
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
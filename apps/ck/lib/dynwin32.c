@@ -163,6 +163,39 @@ Return Value:
     return GetProcAddress(Handle, SymbolName);
 }
 
+INT
+CkpCreateDirectory (
+    PCSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a directory that anyone can read, subject to the
+    process umask.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the directory to create.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, including if the directory already exists.
+
+--*/
+
+{
+
+    if (CreateDirectoryA(Path, NULL) == FALSE) {
+        return -1;
+    }
+
+    return 0;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
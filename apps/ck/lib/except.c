@@ -250,6 +250,7 @@ Return Value:
 
         if (Fiber->TryCount == 0) {
             Fiber->Error = Exception;
+            CK_WRITE_BARRIER(Vm, &(Fiber->Header));
             Fiber->FrameCount = 0;
             Fiber->StackTop = Fiber->Stack;
             Fiber = Fiber->Caller;
@@ -386,6 +387,7 @@ Return Value:
                 Fiber->Error = CkNullValue;
                 CkpCallFunction(Vm, Vm->UnhandledException, 2);
                 Fiber->Error = CK_POP(Fiber);
+                CK_WRITE_BARRIER(Vm, &(Fiber->Header));
 
             } else {
                 CkpError(Vm,
@@ -480,6 +482,7 @@ Return Value:
         ArgumentsList->Elements.Data[0] =
                                       CkpStringCreate(Vm, Description, Length);
 
+        CK_WRITE_BARRIER(Vm, &(ArgumentsList->Header));
     }
 
     //
@@ -653,6 +656,7 @@ Return Value:
         }
 
         CK_OBJECT_VALUE(Instance->Fields[0], Dict);
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
     }
 
     Dict = CK_AS_DICT(Instance->Fields[0]);
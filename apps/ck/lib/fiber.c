@@ -337,6 +337,7 @@ Return Value:
     Frame->Closure = Closure;
     Frame->StackStart = Stack;
     Frame->TryCount = Fiber->TryCount;
+    CK_WRITE_BARRIER(Vm, &(Fiber->Header));
     return;
 }
 
@@ -587,6 +588,7 @@ Return Value:
 {
 
     Vm->Fiber->Error = Arguments[1];
+    CK_WRITE_BARRIER(Vm, &(Vm->Fiber->Header));
 
     //
     // If the caller passed null, then don't actually abort.
@@ -849,6 +851,7 @@ Return Value:
         return FALSE;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Vm->Fiber->Header));
     Vm->Fiber = NULL;
     return FALSE;
 }
@@ -1006,6 +1009,7 @@ Return Value:
         return FALSE;
     }
 
+    CK_WRITE_BARRIER(Vm, &(CurrentFiber->Header));
     Vm->Fiber = CurrentFiber->Caller;
     CurrentFiber->Caller = NULL;
     if (Vm->Fiber != NULL) {
@@ -1143,6 +1147,12 @@ Return Value:
         Fiber->StackTop[-1] = Arguments[1];
     }
 
+    //
+    // The fiber being switched away from is no longer a root, so make sure
+    // anything it picked up while running is found by young collections.
+    //
+
+    CK_WRITE_BARRIER(Vm, &(Vm->Fiber->Header));
     Vm->Fiber = Fiber;
     return;
 }
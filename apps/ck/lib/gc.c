@@ -37,11 +37,19 @@ Module Name:
 #include <minoca/lib/yy.h>
 #include "lang.h"
 #include "compsup.h"
+#include "vmsys.h"
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define how often a full collection is done instead of a young one when
+// stressing the garbage collector.
+//
+
+#define CK_GC_STRESS_FULL_INTERVAL 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -50,6 +58,34 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+VOID
+CkpKissRoots (
+    PCK_VM Vm
+    );
+
+VOID
+CkpKissRoot (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+VOID
+CkpForgetRememberedObjects (
+    PCK_VM Vm
+    );
+
+VOID
+CkpPromoteYoungObjects (
+    PCK_VM Vm
+    );
+
+VOID
+CkpRecordGarbageStatistics (
+    PCK_VM Vm,
+    ULONGLONG Start,
+    BOOL Young
+    );
+
 VOID
 CkpKissCompiler (
     PCK_VM Vm,
@@ -75,8 +111,15 @@ CkpDeeplyKiss (
     );
 
 VOID
+CkpKissComponents (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+ULONG
 CkpCollectUnkissedObjects (
-    PCK_VM Vm
+    PCK_VM Vm,
+    PCK_OBJECT *List
     );
 
 VOID
@@ -175,8 +218,8 @@ CkCollectGarbage (
 
 Routine Description:
 
-    This routine performs garbage collection on the given Chalk instance,
-    freeing up unused dynamic memory as appropriate.
+    This routine performs a full garbage collection on the given Chalk
+    instance, freeing up unused dynamic memory as appropriate.
 
 Arguments:
 
@@ -184,19 +227,20 @@ Routine Description:
 
 Return Value:
 
-    Returns a pointer to the newly allocated or reallocated memory on success.
-
-    NULL on allocation failure or for free operations.
+    None.
 
 --*/
 
 {
 
+    ULONG DestroyCount;
     UINTN Hysteresis;
-    UINTN Index;
     CK_OBJECT KissHead;
     UINTN Minimum;
     UINTN NextThreshold;
+    ULONGLONG Start;
+
+    Start = CkpGetProcessorTime();
 
     //
     // Reset the number of bytes allocated, and have the kiss functions count
@@ -209,29 +253,32 @@ Return Value:
     Vm->GarbageRuns += 1;
     Vm->GarbageFreed = 0;
 
+    //
+    // A full collection looks at everything, so the remembered set is not
+    // needed. Unlink it so that the kiss pointers are free for marking.
+    //
+
+    CkpForgetRememberedObjects(Vm);
+
     //
     // Set up the head of the kiss list. Make it a circle so that the last
     // object added does not have a non-null pointer.
     //
 
     KissHead.Type = CkObjectInvalid;
+    KissHead.Flags = 0;
     KissHead.Next = NULL;
     KissHead.NextKiss = &KissHead;
     Vm->KissList = &KissHead;
-    CkpKissObject(Vm, &(Vm->Modules->Header));
-    CkpKissObject(Vm, &(Vm->ModulePath->Header));
-    for (Index = 0; Index < Vm->WorkingObjectCount; Index += 1) {
-        CkpKissObject(Vm, Vm->WorkingObjects[Index]);
-    }
-
-    CkpKissObject(Vm, &(Vm->Fiber->Header));
-    if (Vm->Compiler != NULL) {
-        CkpKissCompiler(Vm, Vm->Compiler);
-    }
-
-    CkpKissObject(Vm, &(Vm->UnhandledException->Header));
+    Vm->YoungCollection = FALSE;
+    CkpKissRoots(Vm);
     CkpDeeplyKiss(Vm, &KissHead);
-    CkpCollectUnkissedObjects(Vm);
+    DestroyCount = CkpCollectUnkissedObjects(Vm, &(Vm->OldObjects));
+    DestroyCount += CkpCollectUnkissedObjects(Vm, &(Vm->FirstObject));
+    CkpPromoteYoungObjects(Vm);
+    Vm->GarbageFreed = DestroyCount;
+    Vm->OldBytes = Vm->BytesAllocated;
+    Vm->YoungBytes = 0;
 
     //
     // Determine the next garbage collection time, expressed as an additional
@@ -263,6 +310,119 @@ Return Value:
     }
 
     Vm->NextGarbageCollection = NextThreshold;
+    CkpRecordGarbageStatistics(Vm, Start, FALSE);
+    return;
+}
+
+VOID
+CkpCollectYoungGarbage (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a young generation garbage collection. Only objects
+    allocated since the last collection are considered. The survivors are
+    promoted into the old generation.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG DestroyCount;
+    CK_OBJECT KissHead;
+    PCK_OBJECT Object;
+    ULONGLONG Start;
+
+    Start = CkpGetProcessorTime();
+    Vm->GarbageRuns += 1;
+    Vm->GarbageFreed = 0;
+    KissHead.Type = CkObjectInvalid;
+    KissHead.Flags = 0;
+    KissHead.Next = NULL;
+    KissHead.NextKiss = &KissHead;
+    Vm->KissList = &KissHead;
+    Vm->YoungCollection = TRUE;
+
+    //
+    // Kiss the roots, and then everything old objects have pointed at since
+    // the last collection. Old objects only get their immediate components
+    // kissed, which only adds young objects to the kiss list.
+    //
+
+    CkpKissRoots(Vm);
+    Object = Vm->RememberedObjects;
+    while (Object != NULL) {
+
+        CK_ASSERT((Object->Flags & CK_OBJECT_REMEMBERED) != 0);
+
+        CkpKissComponents(Vm, Object);
+        Object = Object->NextKiss;
+    }
+
+    //
+    // Only count the bytes of the young survivors, which are about to be
+    // added to the old generation.
+    //
+
+    Vm->BytesAllocated = 0;
+    CkpDeeplyKiss(Vm, &KissHead);
+    Vm->YoungCollection = FALSE;
+    DestroyCount = CkpCollectUnkissedObjects(Vm, &(Vm->FirstObject));
+    CkpPromoteYoungObjects(Vm);
+    CkpForgetRememberedObjects(Vm);
+    Vm->GarbageFreed = DestroyCount;
+    Vm->OldBytes += Vm->BytesAllocated;
+    Vm->BytesAllocated = Vm->OldBytes;
+    Vm->YoungBytes = 0;
+    CkpRecordGarbageStatistics(Vm, Start, TRUE);
+    return;
+}
+
+VOID
+CkpRememberObject (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds an old object to the remembered set, since it may now
+    point at young objects. Use the write barrier macro rather than calling
+    this directly.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the old object that was written to.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CK_ASSERT((Object->Flags & CK_OBJECT_OLD) != 0);
+    CK_ASSERT(Object->NextKiss == NULL);
+
+    Object->Flags |= CK_OBJECT_REMEMBERED;
+    Object->NextKiss = Vm->RememberedObjects;
+    Vm->RememberedObjects = Object;
     return;
 }
 
@@ -374,16 +534,34 @@ Return Value:
     //
 
     Vm->BytesAllocated += NewSize - OldSize;
+    if (NewSize > OldSize) {
+        Vm->YoungBytes += NewSize - OldSize;
+    }
 
     //
-    // Potentially perform garbage collection.
+    // Potentially perform garbage collection. Most of the time only the young
+    // objects need to be looked at. When the heap as a whole has grown enough,
+    // do a full collection. In stress mode, mix in a full collection every so
+    // often as well.
     //
 
-    if ((NewSize > 0) &&
-        ((Vm->BytesAllocated >= Vm->NextGarbageCollection) ||
-         (CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)))) {
+    if (NewSize > 0) {
+        if (CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)) {
+            if ((Vm->GarbageRuns % CK_GC_STRESS_FULL_INTERVAL) == 0) {
+                CkCollectGarbage(Vm);
 
-        CkCollectGarbage(Vm);
+            } else {
+                CkpCollectYoungGarbage(Vm);
+            }
+
+        } else if (Vm->BytesAllocated >= Vm->NextGarbageCollection) {
+            CkCollectGarbage(Vm);
+
+        } else if ((Vm->Configuration.NurserySize != 0) &&
+                   (Vm->YoungBytes >= Vm->Configuration.NurserySize)) {
+
+            CkpCollectYoungGarbage(Vm);
+        }
     }
 
     Allocation = CkRawReallocate(Vm, Memory, NewSize);
@@ -411,6 +589,239 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+VOID
+CkpKissRoots (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine kisses the root objects of the virtual machine, the ones that
+    are alive no matter what.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+
+    CkpKissRoot(Vm, &(Vm->Modules->Header));
+    CkpKissRoot(Vm, &(Vm->ModulePath->Header));
+    for (Index = 0; Index < Vm->WorkingObjectCount; Index += 1) {
+        CkpKissRoot(Vm, Vm->WorkingObjects[Index]);
+    }
+
+    CkpKissRoot(Vm, &(Vm->Fiber->Header));
+    if (Vm->Compiler != NULL) {
+        CkpKissCompiler(Vm, Vm->Compiler);
+    }
+
+    CkpKissRoot(Vm, &(Vm->UnhandledException->Header));
+    return;
+}
+
+VOID
+CkpKissRoot (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine kisses a root object. During a young collection, old roots
+    have their components kissed directly, since roots like the running fiber
+    and the function being compiled are modified without write barriers.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies an optional pointer to the root object.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Object == NULL) {
+        return;
+    }
+
+    if ((Vm->YoungCollection != FALSE) &&
+        ((Object->Flags & CK_OBJECT_OLD) != 0)) {
+
+        CkpKissComponents(Vm, Object);
+
+    } else {
+        CkpKissObject(Vm, Object);
+    }
+
+    return;
+}
+
+VOID
+CkpForgetRememberedObjects (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine empties the remembered set.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_OBJECT Next;
+    PCK_OBJECT Object;
+
+    Object = Vm->RememberedObjects;
+    while (Object != NULL) {
+        Next = Object->NextKiss;
+        Object->NextKiss = NULL;
+        Object->Flags &= ~CK_OBJECT_REMEMBERED;
+        Object = Next;
+    }
+
+    Vm->RememberedObjects = NULL;
+    return;
+}
+
+VOID
+CkpPromoteYoungObjects (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves all the objects on the young list over to the old list.
+    This is called after the unloved young objects have been collected.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Count;
+    PCK_OBJECT Object;
+
+    Object = Vm->FirstObject;
+    if (Object == NULL) {
+        return;
+    }
+
+    Count = 1;
+    while (TRUE) {
+        Object->Flags |= CK_OBJECT_OLD;
+        if (Object->Next == NULL) {
+            break;
+        }
+
+        Object = Object->Next;
+        Count += 1;
+    }
+
+    Object->Next = Vm->OldObjects;
+    Vm->OldObjects = Vm->FirstObject;
+    Vm->FirstObject = NULL;
+    Vm->GarbageStatistics.Promoted += Count;
+    return;
+}
+
+VOID
+CkpRecordGarbageStatistics (
+    PCK_VM Vm,
+    ULONGLONG Start,
+    BOOL Young
+    )
+
+/*++
+
+Routine Description:
+
+    This routine updates the garbage collection statistics at the end of a
+    collection.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Start - Supplies the processor time when the collection began.
+
+    Young - Supplies a boolean indicating whether this was a young collection
+        (TRUE) or a full one (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Pause;
+    PCK_GARBAGE_STATISTICS Statistics;
+
+    Statistics = &(Vm->GarbageStatistics);
+    Pause = CkpGetProcessorTime() - Start;
+    if (Young != FALSE) {
+        Statistics->YoungRuns += 1;
+        Statistics->YoungTime += Pause;
+
+    } else {
+        Statistics->FullRuns += 1;
+        Statistics->FullTime += Pause;
+    }
+
+    Statistics->LastPause = Pause;
+    if (Pause > Statistics->MaxPause) {
+        Statistics->MaxPause = Pause;
+    }
+
+    Statistics->Freed += Vm->GarbageFreed;
+    if ((CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)) &&
+        (Vm->GarbageFreed != 0)) {
+
+        CkpDebugPrint(Vm, "%d objects destroyed\n", Vm->GarbageFreed);
+    }
+
+    return;
+}
+
 VOID
 CkpKissCompiler (
     PCK_VM Vm,
@@ -443,7 +854,7 @@ Return Value:
     //
 
     if (Compiler->Parser != NULL) {
-        CkpKissObject(Vm, &(Compiler->Parser->Module->Header));
+        CkpKissRoot(Vm, &(Compiler->Parser->Module->Header));
     }
 
     //
@@ -451,10 +862,10 @@ Return Value:
     //
 
     while (Compiler != NULL) {
-        CkpKissObject(Vm, &(Compiler->Function->Header));
+        CkpKissRoot(Vm, &(Compiler->Function->Header));
         if (Compiler->EnclosingClass != NULL) {
             CkpKissValueArray(Vm, &(Compiler->EnclosingClass->Fields.List));
-            CkpKissObject(Vm, &(Compiler->EnclosingClass->Fields.Dict->Header));
+            CkpKissRoot(Vm, &(Compiler->EnclosingClass->Fields.Dict->Header));
         }
 
         //
@@ -536,6 +947,17 @@ Return Value:
 
     PCK_OBJECT End;
 
+    //
+    // Young collections stop at the old generation. Anything old objects point
+    // to is found through the roots and the remembered set.
+    //
+
+    if ((Vm->YoungCollection != FALSE) && (Object != NULL) &&
+        ((Object->Flags & CK_OBJECT_OLD) != 0)) {
+
+        return;
+    }
+
     if ((Object != NULL) && (Object->NextKiss == NULL)) {
 
         //
@@ -589,86 +1011,121 @@ Return Value:
 
     Object = Head->NextKiss;
     while (Object != Head) {
-        switch (Object->Type) {
-        case CkObjectClass:
-            CkpKissClass(Vm, (PCK_CLASS)Object);
-            break;
+        CkpKissComponents(Vm, Object);
+        Object = Object->NextKiss;
+    }
 
-        case CkObjectClosure:
-            CkpKissClosure(Vm, (PCK_CLOSURE)Object);
-            break;
+    return;
+}
 
-        case CkObjectFiber:
-            CkpKissFiber(Vm, (PCK_FIBER)Object);
-            break;
+VOID
+CkpKissComponents (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
 
-        case CkObjectFunction:
-            CkpKissFunction(Vm, (PCK_FUNCTION)Object);
-            break;
+/*++
 
-        case CkObjectForeign:
-            CkpKissForeignData(Vm, (PCK_FOREIGN_DATA)Object);
-            break;
+Routine Description:
 
-        case CkObjectInstance:
-            CkpKissInstance(Vm, (PCK_INSTANCE)Object);
-            break;
+    This routine kisses everything the given object refers to.
 
-        case CkObjectList:
-            CkpKissList(Vm, (PCK_LIST)Object);
-            break;
+Arguments:
 
-        case CkObjectDict:
-            CkpKissDict(Vm, (PCK_DICT)Object);
-            break;
+    Vm - Supplies a pointer to the virtual machine.
 
-        case CkObjectModule:
-            CkpKissModule(Vm, (PCK_MODULE)Object);
-            break;
+    Object - Supplies a pointer to the object whose components should be
+        kissed.
 
-        case CkObjectRange:
-            CkpKissRange(Vm, (PCK_RANGE)Object);
-            break;
+Return Value:
 
-        case CkObjectString:
-            CkpKissString(Vm, (PCK_STRING)Object);
-            break;
+    None.
 
-        case CkObjectUpvalue:
-            CkpKissUpvalue(Vm, (PCK_UPVALUE)Object);
-            break;
+--*/
+
+{
 
-        default:
+    switch (Object->Type) {
+    case CkObjectClass:
+        CkpKissClass(Vm, (PCK_CLASS)Object);
+        break;
 
-            CK_ASSERT(FALSE);
+    case CkObjectClosure:
+        CkpKissClosure(Vm, (PCK_CLOSURE)Object);
+        break;
 
-            break;
-        }
+    case CkObjectFiber:
+        CkpKissFiber(Vm, (PCK_FIBER)Object);
+        break;
 
-        Object = Object->NextKiss;
+    case CkObjectFunction:
+        CkpKissFunction(Vm, (PCK_FUNCTION)Object);
+        break;
+
+    case CkObjectForeign:
+        CkpKissForeignData(Vm, (PCK_FOREIGN_DATA)Object);
+        break;
+
+    case CkObjectInstance:
+        CkpKissInstance(Vm, (PCK_INSTANCE)Object);
+        break;
+
+    case CkObjectList:
+        CkpKissList(Vm, (PCK_LIST)Object);
+        break;
+
+    case CkObjectDict:
+        CkpKissDict(Vm, (PCK_DICT)Object);
+        break;
+
+    case CkObjectModule:
+        CkpKissModule(Vm, (PCK_MODULE)Object);
+        break;
+
+    case CkObjectRange:
+        CkpKissRange(Vm, (PCK_RANGE)Object);
+        break;
+
+    case CkObjectString:
+        CkpKissString(Vm, (PCK_STRING)Object);
+        break;
+
+    case CkObjectUpvalue:
+        CkpKissUpvalue(Vm, (PCK_UPVALUE)Object);
+        break;
+
+    default:
+
+        CK_ASSERT(FALSE);
+
+        break;
     }
 
     return;
 }
 
-VOID
+ULONG
 CkpCollectUnkissedObjects (
-    PCK_VM Vm
+    PCK_VM Vm,
+    PCK_OBJECT *List
     )
 
 /*++
 
 Routine Description:
 
-    This routine garbage collects any objects that have not been kissed.
+    This routine garbage collects any objects on the given list that have not
+    been kissed.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
+    List - Supplies a pointer to the head of the object list to sweep.
+
 Return Value:
 
-    None.
+    Returns the number of objects destroyed.
 
 --*/
 
@@ -679,7 +1136,7 @@ Return Value:
     PCK_OBJECT *Object;
 
     DestroyCount = 0;
-    Object = &(Vm->FirstObject);
+    Object = List;
     while (*Object != NULL) {
 
         //
@@ -715,14 +1172,7 @@ Return Value:
         }
     }
 
-    Vm->GarbageFreed = DestroyCount;
-    if ((CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)) &&
-        (DestroyCount != 0)) {
-
-        CkpDebugPrint(Vm, "%d objects destroyed\n", DestroyCount);
-    }
-
-    return;
+    return DestroyCount;
 }
 
 VOID
@@ -855,7 +1305,7 @@ Return Value:
     PCK_DICT_ENTRY Entry;
     UINTN Index;
 
-    for (Index = 0; Index < Dict->Capacity; Index += 1) {
+    for (Index = 0; Index < Dict->Used; Index += 1) {
         Entry = &(Dict->Entries[Index]);
         if (!CK_IS_UNDEFINED(Entry->Key)) {
             CkpKissValue(Vm, Entry->Key);
@@ -864,7 +1314,8 @@ Return Value:
     }
 
     Vm->BytesAllocated += sizeof(CK_DICT) +
-                          (Dict->Capacity * sizeof(CK_DICT_ENTRY));
+                          (Dict->Capacity * sizeof(CK_DICT_ENTRY)) +
+                          (Dict->IndexSize * sizeof(ULONG));
 
     return;
 }
@@ -1114,7 +1565,7 @@ Return Value:
     CkpKissObject(Vm, &(Module->Name->Header));
     CkpKissObject(Vm, &(Module->Path->Header));
     CkpKissObject(Vm, &(Module->Closure->Header));
-    Vm->BytesAllocated = sizeof(CK_MODULE);
+    Vm->BytesAllocated += sizeof(CK_MODULE);
     return;
 }
 
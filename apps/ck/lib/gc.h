@@ -30,10 +30,63 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// This macro is invoked after a reference to another object is stored inside
+// the given object. If the object is in the old generation, it is added to the
+// remembered set so that the next young collection can find any young objects
+// it now points to. Invoke this after the store (and after any allocations
+// made along the way), since an allocation may promote the object.
+//
+
+#define CK_WRITE_BARRIER(_Vm, _Object)                                  \
+    ((((_Object)->Flags & (CK_OBJECT_OLD | CK_OBJECT_REMEMBERED)) ==    \
+      CK_OBJECT_OLD) ?                                                  \
+     CkpRememberObject((_Vm), (_Object)) :                              \
+     (VOID)0)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure contains statistics about the garbage collector. Times are
+    in microseconds of processor time.
+
+Members:
+
+    YoungRuns - Stores the number of young generation collections.
+
+    FullRuns - Stores the number of full collections.
+
+    YoungTime - Stores the total time spent in young collections.
+
+    FullTime - Stores the total time spent in full collections.
+
+    LastPause - Stores the duration of the most recent collection.
+
+    MaxPause - Stores the duration of the longest collection.
+
+    Promoted - Stores the total number of objects moved into the old
+        generation.
+
+    Freed - Stores the total number of objects freed.
+
+--*/
+
+typedef struct _CK_GARBAGE_STATISTICS {
+    ULONG YoungRuns;
+    ULONG FullRuns;
+    ULONGLONG YoungTime;
+    ULONGLONG FullTime;
+    ULONGLONG LastPause;
+    ULONGLONG MaxPause;
+    ULONGLONG Promoted;
+    ULONGLONG Freed;
+} CK_GARBAGE_STATISTICS, *PCK_GARBAGE_STATISTICS;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -42,6 +95,55 @@ Module Name:
 // -------------------------------------------------------- Function Prototypes
 //
 
+VOID
+CkpCollectYoungGarbage (
+    PCK_VM Vm
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs a young generation garbage collection. Only objects
+    allocated since the last collection are considered. The survivors are
+    promoted into the old generation.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CkpRememberObject (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds an old object to the remembered set, since it may now
+    point at young objects. Use the write barrier macro rather than calling
+    this directly.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the old object that was written to.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 CkpPushRoot (
     PCK_VM Vm,
@@ -296,6 +296,7 @@ Return Value:
     }
 
     List->Elements.Data[Index] = Element;
+    CK_WRITE_BARRIER(Vm, &(List->Header));
     return;
 }
 
@@ -433,6 +434,7 @@ Return Value:
                  Source->Elements.Data,
                  Source->Elements.Count);
 
+    CK_WRITE_BARRIER(Vm, &(Destination->Header));
     return Destination;
 }
 
@@ -1004,6 +1006,7 @@ Return Value:
     }
 
     List->Elements.Data[Index] = Arguments[2];
+    CK_WRITE_BARRIER(Vm, &(List->Header));
     Arguments[0] = Arguments[2];
     return TRUE;
 }
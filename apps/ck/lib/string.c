@@ -37,6 +37,14 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the minimum number of slots in the string intern table, and the
+// fraction of the slots (in 1024ths) that can be filled before it grows.
+//
+
+#define CK_INTERN_TABLE_MIN_CAPACITY 256
+#define CK_INTERN_TABLE_LOAD_FACTOR 768
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -211,6 +219,18 @@ CkpStringSliceBytes (
     UINTN Count
     );
 
+PCK_STRING
+CkpStringFindIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    );
+
+VOID
+CkpStringAddIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -1065,6 +1085,7 @@ Return Value:
     CK_VALUE Value;
 
     FakeStringObject->Header.Type = CkObjectString;
+    FakeStringObject->Header.Flags = 0;
     FakeStringObject->Header.Next = NULL;
     FakeStringObject->Header.Class = NULL;
     FakeStringObject->Length = Length;
@@ -1074,6 +1095,179 @@ Return Value:
     return Value;
 }
 
+CK_VALUE
+CkpStringIntern (
+    PCK_VM Vm,
+    PCSTR Text,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the interned string with the given contents, creating
+    it if needed.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Text - Supplies a pointer to the value of the string. A copy of this memory
+        will be made if a new string is created.
+
+    Length - Supplies the length of the string, not including the null
+        terminator.
+
+Return Value:
+
+    Returns the string value on success. This is usually interned, but may not
+    be if the intern table could not be grown.
+
+    CK_NULL_VALUE on allocation failure.
+
+--*/
+
+{
+
+    CK_STRING FakeString;
+    PCK_STRING Interned;
+    CK_VALUE Value;
+
+    CkpStringFake(&FakeString, Text, Length);
+    Interned = CkpStringFindIntern(Vm, &FakeString);
+    if (Interned != NULL) {
+        CK_OBJECT_VALUE(Value, Interned);
+        return Value;
+    }
+
+    Value = CkpStringCreate(Vm, Text, Length);
+    if (!CK_IS_NULL(Value)) {
+        CkpStringAddIntern(Vm, CK_AS_STRING(Value));
+    }
+
+    return Value;
+}
+
+CK_VALUE
+CkpStringInternValue (
+    PCK_VM Vm,
+    CK_VALUE String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the interned copy of the given string. If there is no
+    interned string with the same contents, the given string becomes the
+    interned copy.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies the string value to intern. This must be a real string
+        object, not a fake one.
+
+Return Value:
+
+    Returns the interned string, or the given string if the intern table could
+    not be grown.
+
+--*/
+
+{
+
+    PCK_STRING Interned;
+    CK_VALUE Value;
+
+    Interned = CK_AS_STRING(String);
+    if ((Interned->Header.Flags & CK_OBJECT_INTERNED) != 0) {
+        return String;
+    }
+
+    Interned = CkpStringFindIntern(Vm, Interned);
+    if (Interned != NULL) {
+        CK_OBJECT_VALUE(Value, Interned);
+        return Value;
+    }
+
+    CkpStringAddIntern(Vm, CK_AS_STRING(String));
+    return String;
+}
+
+VOID
+CkpStringRemoveIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a dying string from the intern table.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the interned string being destroyed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Hole;
+    UINTN Home;
+    UINTN Mask;
+    UINTN Slot;
+    PCK_STRING *Table;
+
+    CK_ASSERT((String->Header.Flags & CK_OBJECT_INTERNED) != 0);
+
+    Table = Vm->InternTable;
+    Mask = Vm->InternCapacity - 1;
+    Slot = String->Hash & Mask;
+    while (Table[Slot] != String) {
+        if (Table[Slot] == NULL) {
+
+            CK_ASSERT(FALSE);
+
+            return;
+        }
+
+        Slot = (Slot + 1) & Mask;
+    }
+
+    //
+    // Rather than leaving a tombstone, shift back any later entries in the
+    // run that would no longer be reachable from their home slot.
+    //
+
+    Hole = Slot;
+    Slot = (Slot + 1) & Mask;
+    while (Table[Slot] != NULL) {
+        Home = Table[Slot]->Hash & Mask;
+        if (((Slot - Home) & Mask) >= ((Slot - Hole) & Mask)) {
+            Table[Hole] = Table[Slot];
+            Hole = Slot;
+        }
+
+        Slot = (Slot + 1) & Mask;
+    }
+
+    Table[Hole] = NULL;
+    Vm->InternCount -= 1;
+    String->Header.Flags &= ~CK_OBJECT_INTERNED;
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -2955,3 +3149,152 @@ Return Value:
     return CkpStringCreate(Vm, Source->Value + Start, Count);
 }
 
+PCK_STRING
+CkpStringFindIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks for an interned string with the same contents as the
+    given string.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the string to look up.
+
+Return Value:
+
+    Returns a pointer to the interned string on success.
+
+    NULL if no interned string has the same contents.
+
+--*/
+
+{
+
+    PCK_STRING Entry;
+    UINTN Mask;
+    UINTN Slot;
+
+    if (Vm->InternCount == 0) {
+        return NULL;
+    }
+
+    Mask = Vm->InternCapacity - 1;
+    Slot = String->Hash & Mask;
+    while (TRUE) {
+        Entry = Vm->InternTable[Slot];
+        if (Entry == NULL) {
+            break;
+        }
+
+        if ((Entry->Hash == String->Hash) &&
+            (Entry->Length == String->Length) &&
+            (CkCompareMemory(Entry->Value, String->Value, String->Length) ==
+             0)) {
+
+            return Entry;
+        }
+
+        Slot = (Slot + 1) & Mask;
+    }
+
+    return NULL;
+}
+
+VOID
+CkpStringAddIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a string to the intern table, growing the table if
+    needed. The caller must have already checked that no interned string has
+    the same contents. If the table cannot be grown, the string is simply not
+    interned.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the string to intern.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Capacity;
+    UINTN Index;
+    UINTN Mask;
+    PCK_STRING *NewTable;
+    UINTN Slot;
+
+    CK_ASSERT((String->Header.Flags & CK_OBJECT_INTERNED) == 0);
+
+    if ((Vm->InternCount + 1) >
+        (Vm->InternCapacity * CK_INTERN_TABLE_LOAD_FACTOR / 1024)) {
+
+        Capacity = Vm->InternCapacity * 2;
+        if (Capacity < CK_INTERN_TABLE_MIN_CAPACITY) {
+            Capacity = CK_INTERN_TABLE_MIN_CAPACITY;
+        }
+
+        //
+        // The allocation may collect garbage, which can remove strings from
+        // the old table, so only look at the old table afterwards.
+        //
+
+        CkpPushRoot(Vm, &(String->Header));
+        NewTable = CkAllocate(Vm, Capacity * sizeof(PCK_STRING));
+        CkpPopRoot(Vm);
+        if (NewTable == NULL) {
+            return;
+        }
+
+        CkZero(NewTable, Capacity * sizeof(PCK_STRING));
+        Mask = Capacity - 1;
+        for (Index = 0; Index < Vm->InternCapacity; Index += 1) {
+            if (Vm->InternTable[Index] != NULL) {
+                Slot = Vm->InternTable[Index]->Hash & Mask;
+                while (NewTable[Slot] != NULL) {
+                    Slot = (Slot + 1) & Mask;
+                }
+
+                NewTable[Slot] = Vm->InternTable[Index];
+            }
+        }
+
+        if (Vm->InternTable != NULL) {
+            CkFree(Vm, Vm->InternTable);
+        }
+
+        Vm->InternTable = NewTable;
+        Vm->InternCapacity = Capacity;
+    }
+
+    Mask = Vm->InternCapacity - 1;
+    Slot = String->Hash & Mask;
+    while (Vm->InternTable[Slot] != NULL) {
+        Slot = (Slot + 1) & Mask;
+    }
+
+    Vm->InternTable[Slot] = String;
+    Vm->InternCount += 1;
+    String->Header.Flags |= CK_OBJECT_INTERNED;
+    return;
+}
+
@@ -211,6 +211,7 @@ Return Value:
         return CK_AS_INTEGER(Index);
     }
 
+    String = CkpStringInternValue(Vm, String);
     CK_INT_VALUE(Index, StringTable->List.Count);
     CkpDictSet(Vm, StringTable->Dict, String, Index);
     CkpArrayAppend(Vm, &(StringTable->List), String);
@@ -254,7 +255,7 @@ Return Value:
     CK_VALUE Index;
     CK_VALUE String;
 
-    String = CkpStringCreate(Vm, Name, Size);
+    String = CkpStringIntern(Vm, Name, Size);
     if (CK_IS_NULL(String)) {
         return -1;
     }
@@ -44,6 +44,12 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+VOID
+CkpTagClass (
+    PCK_VM Vm,
+    PCK_CLASS Class
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -280,6 +286,51 @@ Return Value:
     return Function;
 }
 
+CK_ERROR_TYPE
+CkpFunctionCreateCallCaches (
+    PCK_VM Vm,
+    PCK_FUNCTION Function
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates the inline caches for each call site in a function.
+    The number of caches needed should already be set in the function.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Function - Supplies a pointer to the function.
+
+Return Value:
+
+    Chalk status.
+
+--*/
+
+{
+
+    UINTN Size;
+
+    CK_ASSERT(Function->CallCaches == NULL);
+
+    if (Function->CallCacheCount == 0) {
+        return CkSuccess;
+    }
+
+    Size = Function->CallCacheCount * sizeof(CK_CALL_CACHE);
+    Function->CallCaches = CkAllocate(Vm, Size);
+    if (Function->CallCaches == NULL) {
+        return CkErrorNoMemory;
+    }
+
+    CkZero(Function->CallCaches, Size);
+    return CkSuccess;
+}
+
 VOID
 CkpDestroyObject (
     PCK_VM Vm,
@@ -319,6 +370,11 @@ Return Value:
         CkpClearArray(Vm, &(Function->Constants));
         CkpClearArray(Vm, &(Function->Code));
         CkpClearArray(Vm, &(Function->Debug.LineProgram));
+        if (Function->CallCaches != NULL) {
+            CkFree(Vm, Function->CallCaches);
+            Function->CallCaches = NULL;
+        }
+
         break;
 
     case CkObjectForeign:
@@ -342,6 +398,13 @@ Return Value:
         CkFree(Vm, ((PCK_DICT)Object)->Entries);
         break;
 
+    case CkObjectString:
+        if ((Object->Flags & CK_OBJECT_INTERNED) != 0) {
+            CkpStringRemoveIntern(Vm, (PCK_STRING)Object);
+        }
+
+        break;
+
     case CkObjectModule:
         CkpModuleDestroy(Vm, (PCK_MODULE)Object);
         break;
@@ -350,7 +413,6 @@ Return Value:
     case CkObjectClosure:
     case CkObjectInstance:
     case CkObjectRange:
-    case CkObjectString:
     case CkObjectUpvalue:
         break;
 
@@ -398,6 +460,7 @@ Return Value:
 {
 
     Object->Type = Type;
+    Object->Flags = 0;
     Object->NextKiss = NULL;
     Object->Class = Class;
     Object->Next = Vm->FirstObject;
@@ -675,6 +738,7 @@ Return Value:
     Class->FieldCount = FieldCount;
     Class->Name = Name;
     Class->Module = Module;
+    CkpTagClass(Vm, Class);
     CkpPushRoot(Vm, &(Class->Header));
     Class->Methods = CkpDictCreate(Vm);
     CkpPopRoot(Vm);
@@ -682,6 +746,8 @@ Return Value:
         return NULL;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
+
     return Class;
 }
 
@@ -722,6 +788,7 @@ Return Value:
 
     CK_OBJECT_VALUE(Value, Closure);
     CkpDictSet(Vm, Class->Methods, Signature, Value);
+    CkpTagClass(Vm, Class);
 
     //
     // Bind the closure to the class, so that when it's run it knows 1) where
@@ -729,6 +796,7 @@ Return Value:
     //
 
     Closure->Class = Class;
+    CK_WRITE_BARRIER(Vm, &(Closure->Header));
     return;
 }
 
@@ -763,12 +831,14 @@ Return Value:
 
     Class->Super = Super;
     Class->SuperFieldCount = Super->FieldCount;
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
 
     //
     // Copy all the methods in the superclass to this class.
     //
 
     CkpDictCombine(Vm, Class->Methods, Super->Methods);
+    CkpTagClass(Vm, Class);
     return;
 }
 
@@ -873,3 +943,43 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+VOID
+CkpTagClass (
+    PCK_VM Vm,
+    PCK_CLASS Class
+    )
+
+/*++
+
+Routine Description:
+
+    This routine assigns a new tag to a class whose methods have changed,
+    invalidating any inline call caches that remember the old methods.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Class - Supplies a pointer to the class to tag.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    //
+    // Zero is reserved for empty cache entries.
+    //
+
+    Vm->NextClassTag += 1;
+    if (Vm->NextClassTag == 0) {
+        Vm->NextClassTag = 1;
+    }
+
+    Class->Tag = Vm->NextClassTag;
+    return;
+}
+
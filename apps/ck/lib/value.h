@@ -113,11 +113,37 @@ Module Name:
 #define CK_CLASS_SPECIAL_CREATION 0x00000002
 #define CK_CLASS_FOREIGN 0x00000004
 
+//
+// Define the generic object flags. Old objects have survived a garbage
+// collection. Remembered objects are old objects that may point at young ones,
+// and are chained together through their kiss pointers. Interned strings are
+// the one canonical copy of their contents in the VM's intern table, so two
+// different interned strings are never equal.
+//
+
+#define CK_OBJECT_OLD 0x00000001
+#define CK_OBJECT_REMEMBERED 0x00000002
+#define CK_OBJECT_INTERNED 0x00000004
+
+//
+// Define the number of classes each call site remembers before it starts
+// evicting old ones.
+//
+
+#define CK_CALL_CACHE_SIZE 4
+
+//
+// Define the call cache index emitted for call sites that don't get a cache.
+//
+
+#define CK_NO_CALL_CACHE MAX_USHORT
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
 typedef struct _CK_CLASS CK_CLASS, *PCK_CLASS;
+typedef struct _CK_CLOSURE CK_CLOSURE, *PCK_CLOSURE;
 typedef struct _CK_FIBER CK_FIBER, *PCK_FIBER;
 typedef struct _CK_OBJECT CK_OBJECT, *PCK_OBJECT;
 typedef struct _CK_UPVALUE CK_UPVALUE, *PCK_UPVALUE;
@@ -273,11 +299,15 @@ Structure Description:
     Type - Stores the type of the object, which defines the parent type this
         structure is embedded in.
 
+    Flags - Stores a bitfield of flags about the object's generation. See
+        CK_OBJECT_* definitions.
+
     NextKiss - Stores a pointer to the next object in the list of kissed
         objects (objects that will not get garbage collected this time).
+        Outside of a collection, this links old objects in the remembered set.
 
-    Next - Stores a pointer to the next object in the global list of all
-        objects.
+    Next - Stores a pointer to the next object in the list of all objects in
+        the same generation.
 
     Class - Stores a pointer to the class this object belongs to.
 
@@ -285,6 +315,7 @@ Structure Description:
 
 struct _CK_OBJECT {
     CK_OBJECT_TYPE Type;
+    ULONG Flags;
     PCK_OBJECT NextKiss;
     PCK_OBJECT Next;
     PCK_CLASS Class;
@@ -380,22 +411,29 @@ Structure Description:
 
 Members:
 
-    Key - Stores the key associated with the value.
+    Key - Stores the key associated with the value. This is undefined if the
+        entry has been removed.
 
     Value - Stores the value in this slot.
 
+    Hash - Stores the hash of the key, which saves rehashing on resize and
+        lets most mismatched probes skip comparing the keys.
+
 --*/
 
 typedef struct _CK_DICT_ENTRY {
     CK_VALUE Key;
     CK_VALUE Value;
+    ULONG Hash;
 } CK_DICT_ENTRY, *PCK_DICT_ENTRY;
 
 /*++
 
 Structure Description:
 
-    This structure encapsulates a hash table dictionary.
+    This structure encapsulates a hash table dictionary. Entries are stored
+    densely in insertion order, and a separate power of two sized array of
+    indices is used to find them by hash.
 
 Members:
 
@@ -403,17 +441,30 @@ Structure Description:
 
     Count - Stores the number of values in the dictionary.
 
+    Used - Stores the number of entries consumed, including removed entries.
+        New entries are always appended at this index.
+
     Capacity - Stores the size of the entries array.
 
-    Entries - Stores a pointer to the entries.
+    IndexSize - Stores the number of slots in the index array. This is always
+        a power of two, or zero if no storage has been allocated.
+
+    Entries - Stores a pointer to the entries. The index array lives in the
+        same allocation, immediately after the entries.
+
+    Indices - Stores a pointer to the index array. Each slot is zero if empty,
+        or one more than the index of the entry whose key hashed there.
 
 --*/
 
 typedef struct _CK_DICT {
     CK_OBJECT Header;
     UINTN Count;
+    UINTN Used;
     UINTN Capacity;
+    UINTN IndexSize;
     PCK_DICT_ENTRY Entries;
+    PULONG Indices;
 } CK_DICT, *PCK_DICT;
 
 /*++
@@ -438,6 +489,49 @@ typedef struct _CK_STRING_TABLE {
 
 /*++
 
+Structure Description:
+
+    This structure defines a single remembered method lookup in an inline
+    call cache.
+
+Members:
+
+    Tag - Stores the tag of the receiver class the lookup was done on. Zero
+        means the entry is empty.
+
+    Closure - Stores a pointer to the method the lookup found. The class's
+        method dictionary keeps this alive for as long as the tag matches.
+
+--*/
+
+typedef struct _CK_CALL_CACHE_ENTRY {
+    ULONG Tag;
+    PCK_CLOSURE Closure;
+} CK_CALL_CACHE_ENTRY, *PCK_CALL_CACHE_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure defines the inline cache attached to a single method call
+    site. The first entry serves monomorphic sites, the remainder let a
+    polymorphic site avoid the method dictionary for a few receiver classes.
+
+Members:
+
+    Entries - Stores the remembered lookups.
+
+    Next - Stores the index of the entry to replace on the next miss.
+
+--*/
+
+typedef struct _CK_CALL_CACHE {
+    CK_CALL_CACHE_ENTRY Entries[CK_CALL_CACHE_SIZE];
+    ULONG Next;
+} CK_CALL_CACHE, *PCK_CALL_CACHE;
+
+/*++
+
 Structure Description:
 
     This structure defines debug information about a function object.
@@ -485,6 +579,11 @@ Structure Description:
     Debug - Stores a pointer to the debug information, which translates
         bytecode back to line numbers.
 
+    CallCaches - Stores a pointer to the array of inline caches, one for each
+        method call site in the bytecode.
+
+    CallCacheCount - Stores the number of elements in the call cache array.
+
 --*/
 
 typedef struct _CK_FUNCTION {
@@ -496,6 +595,8 @@ typedef struct _CK_FUNCTION {
     CK_SYMBOL_INDEX UpvalueCount;
     CK_ARITY Arity;
     CK_FUNCTION_DEBUG Debug;
+    PCK_CALL_CACHE CallCaches;
+    CK_SYMBOL_INDEX CallCacheCount;
 } CK_FUNCTION, *PCK_FUNCTION;
 
 /*++
@@ -604,13 +705,13 @@ Structure Description:
 
 --*/
 
-typedef struct _CK_CLOSURE {
+struct _CK_CLOSURE {
     CK_OBJECT Header;
     CK_CLOSURE_TYPE Type;
     CK_CLOSURE_UNION U;
     PCK_CLASS Class;
     PCK_UPVALUE *Upvalues;
-} CK_CLOSURE, *PCK_CLOSURE;
+};
 
 /*++
 
@@ -691,6 +792,11 @@ Structure Description:
     Flags - Stores flags describing special behaviors of this class. See
         CK_CLASS_* definitions.
 
+    Tag - Stores a VM-wide unique value identifying this class and the current
+        contents of its method dictionary. A new tag is assigned whenever the
+        methods change, which invalidates any inline caches holding the old
+        one.
+
 --*/
 
 struct _CK_CLASS {
@@ -702,6 +808,7 @@ struct _CK_CLASS {
     PCK_STRING Name;
     PCK_MODULE Module;
     ULONG Flags;
+    ULONG Tag;
 };
 
 /*++
@@ -1059,6 +1166,31 @@ Return Value:
 
 --*/
 
+CK_ERROR_TYPE
+CkpFunctionCreateCallCaches (
+    PCK_VM Vm,
+    PCK_FUNCTION Function
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates the inline caches for each call site in a function.
+    The number of caches needed should already be set in the function.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Function - Supplies a pointer to the function.
+
+Return Value:
+
+    Chalk status.
+
+--*/
+
 VOID
 CkpDestroyObject (
     PCK_VM Vm,
@@ -2048,6 +2180,91 @@ Return Value:
 
 --*/
 
+CK_VALUE
+CkpStringIntern (
+    PCK_VM Vm,
+    PCSTR Text,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the interned string with the given contents, creating
+    it if needed.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Text - Supplies a pointer to the value of the string. A copy of this memory
+        will be made if a new string is created.
+
+    Length - Supplies the length of the string, not including the null
+        terminator.
+
+Return Value:
+
+    Returns the string value on success. This is usually interned, but may not
+    be if the intern table could not be grown.
+
+    CK_NULL_VALUE on allocation failure.
+
+--*/
+
+CK_VALUE
+CkpStringInternValue (
+    PCK_VM Vm,
+    CK_VALUE String
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the interned copy of the given string. If there is no
+    interned string with the same contents, the given string becomes the
+    interned copy.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies the string value to intern. This must be a real string
+        object, not a fake one.
+
+Return Value:
+
+    Returns the interned string, or the given string if the intern table could
+    not be grown.
+
+--*/
+
+VOID
+CkpStringRemoveIntern (
+    PCK_VM Vm,
+    PCK_STRING String
+    );
+
+/*++
+
+Routine Description:
+
+    This routine removes a dying string from the intern table.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the interned string being destroyed.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Fiber functions
 //
@@ -66,6 +66,16 @@ Module Name:
 #define CKI_READ_ARITY(_Value) CKI_READ_BYTE(_Value)
 #define CKI_READ_SYMBOL(_Value) CKI_READ_SHORT(_Value)
 #define CKI_READ_OFFSET(_Value) CKI_READ_SHORT(_Value)
+#define CKI_READ_CACHE(_Value) CKI_READ_SHORT(_Value)
+
+//
+// This macro gets the inline cache for a call site given the index read from
+// the instruction stream, or NULL if the call site has no cache.
+//
+
+#define CKI_CALL_CACHE(_Index)                  \
+    (((_Index) < Function->CallCacheCount) ?    \
+     &(Function->CallCaches[(_Index)]) : NULL)
 
 //
 // These macros sync up the pieces of the VM state that are kept in local
@@ -295,6 +305,7 @@ CkpCaptureUpvalue (
 
 VOID
 CkpCloseUpvalues (
+    PCK_VM Vm,
     PCK_FIBER Fiber,
     PCK_VALUE Last
     );
@@ -466,6 +477,19 @@ Return Value:
     }
 
     Vm->FirstObject = NULL;
+    Object = Vm->OldObjects;
+    while (Object != NULL) {
+        Next = Object->Next;
+        CkpDestroyObject(Vm, Object);
+        Object = Next;
+    }
+
+    Vm->OldObjects = NULL;
+    Vm->RememberedObjects = NULL;
+    if (Vm->InternTable != NULL) {
+        CkFree(Vm, Vm->InternTable);
+        Vm->InternTable = NULL;
+    }
 
     //
     // Null out the reallocate function to catch double frees.
@@ -660,6 +684,8 @@ Return Value:
             return -2;
         }
 
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
+
     //
     // If the variable was previously declared, it will have an integer value.
     // Now it can be defined for real.
@@ -667,6 +693,7 @@ Return Value:
 
     } else if (CK_IS_INTEGER(Module->Variables.Data[Symbol])) {
         Module->Variables.Data[Symbol] = Value;
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
 
     //
     // Otherwise, the variable has been previously defined.
@@ -995,6 +1022,7 @@ Return Value:
 
         Upvalue = Frame->Closure->Upvalues[Local];
         *(Upvalue->Value) = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Upvalue->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadModuleVariable):
@@ -1011,6 +1039,7 @@ Return Value:
         CK_ASSERT(Symbol < Function->Module->Variables.Count);
 
         Function->Module->Variables.Data[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Function->Module->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadFieldThis):
@@ -1039,6 +1068,7 @@ Return Value:
         CK_ASSERT(Symbol < Instance->Header.Class->FieldCount);
 
         Instance->Fields[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadField):
@@ -1067,6 +1097,7 @@ Return Value:
         CK_ASSERT(Symbol < Instance->Header.Class->FieldCount);
 
         Instance->Fields[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpPop):
@@ -1084,11 +1115,12 @@ Return Value:
     CKI_CASE(CkOpCall8):
         Arity = Instruction - CkOpCall0 + 1;
         CKI_READ_SYMBOL(Symbol);
+        CKI_READ_CACHE(Index);
         Arguments = Fiber->StackTop - Arity;
         Class = CkpGetClass(Vm, Arguments[0]);
         MethodName = Function->Module->Strings.List.Data[Symbol];
         CKI_STORE_FRAME();
-        CkpCallMethod(Vm, Class, MethodName, Arity);
+        CkpCallMethod(Vm, Class, MethodName, CKI_CALL_CACHE(Index), Arity);
         CKI_LOAD_FIBER();
         CKI_DISPATCH();
 
@@ -1096,11 +1128,12 @@ Return Value:
         CKI_READ_ARITY(Arity);
         Arity += 1;
         CKI_READ_SYMBOL(Symbol);
+        CKI_READ_CACHE(Index);
         Arguments = Fiber->StackTop - Arity;
         Class = CkpGetClass(Vm, Arguments[0]);
         MethodName = Function->Module->Strings.List.Data[Symbol];
         CKI_STORE_FRAME();
-        CkpCallMethod(Vm, Class, MethodName, Arity);
+        CkpCallMethod(Vm, Class, MethodName, CKI_CALL_CACHE(Index), Arity);
         CKI_LOAD_FIBER();
         CKI_DISPATCH();
 
@@ -1115,11 +1148,12 @@ Return Value:
     CKI_CASE(CkOpSuperCall8):
         Arity = Instruction - CkOpSuperCall0 + 1;
         CKI_READ_SYMBOL(Symbol);
+        CKI_READ_CACHE(Index);
         Arguments = Fiber->StackTop - Arity;
         Class = Frame->Closure->Class->Super;
         MethodName = Function->Module->Strings.List.Data[Symbol];
         CKI_STORE_FRAME();
-        CkpCallMethod(Vm, Class, MethodName, Arity);
+        CkpCallMethod(Vm, Class, MethodName, CKI_CALL_CACHE(Index), Arity);
         CKI_LOAD_FIBER();
         CKI_DISPATCH();
 
@@ -1127,11 +1161,12 @@ Return Value:
         CKI_READ_ARITY(Arity);
         Arity += 1;
         CKI_READ_SYMBOL(Symbol);
+        CKI_READ_CACHE(Index);
         Arguments = Fiber->StackTop - Arity;
         Class = Frame->Closure->Class->Super;
         MethodName = Function->Module->Strings.List.Data[Symbol];
         CKI_STORE_FRAME();
-        CkpCallMethod(Vm, Class, MethodName, Arity);
+        CkpCallMethod(Vm, Class, MethodName, CKI_CALL_CACHE(Index), Arity);
         CKI_LOAD_FIBER();
         CKI_DISPATCH();
 
@@ -1210,7 +1245,7 @@ Return Value:
         CKI_DISPATCH();
 
     CKI_CASE(CkOpCloseUpvalue):
-        CkpCloseUpvalues(Fiber, Fiber->StackTop - 1);
+        CkpCloseUpvalues(Vm, Fiber, Fiber->StackTop - 1);
         CKI_DISPATCH();
 
     CKI_CASE(CkOpReturn):
@@ -1221,7 +1256,7 @@ Return Value:
 
         Fiber->FrameCount -= 1;
         Fiber->TryCount = Frame->TryCount;
-        CkpCloseUpvalues(Fiber, Stack);
+        CkpCloseUpvalues(Vm, Fiber, Stack);
 
         //
         // Handle the fiber completing. Either return the value to the C caller,
@@ -1319,6 +1354,7 @@ Return Value:
             }
         }
 
+        CK_WRITE_BARRIER(Vm, &(Closure->Header));
         Function = Frame->Closure->U.Block.Function;
         CKI_DISPATCH();
 
@@ -1475,6 +1511,7 @@ Return Value:
 
     CkpPushRoot(Vm, &(Class->Header));
     Class->Header.Class = Metaclass;
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
     CkpBindSuperclass(Vm, Class, Super);
     CkpPopRoot(Vm);
     CkpPopRoot(Vm);
@@ -1568,7 +1605,7 @@ Return Value:
     CkpPrintSignature(&Signature, Name, &Length);
     CkpStringFake(&FakeString, Name, Length);
     CK_OBJECT_VALUE(NameValue, &FakeString);
-    return CkpCallMethod(Vm, Class, NameValue, Arity);
+    return CkpCallMethod(Vm, Class, NameValue, NULL, Arity);
 }
 
 BOOL
@@ -1576,6 +1613,7 @@ CkpCallMethod (
     PCK_VM Vm,
     PCK_CLASS Class,
     CK_VALUE MethodName,
+    PCK_CALL_CACHE Cache,
     CK_ARITY Arity
     )
 
@@ -1593,6 +1631,10 @@ Routine Description:
 
     MethodName - Supplies the name of the method to look up on the class.
 
+    Cache - Supplies an optional pointer to the inline cache for the call site.
+        If the class has been seen here before, the method dictionary lookup
+        is skipped. Otherwise the result of the lookup is remembered.
+
     Arity - Supplies the number of arguments the method was called with in
         code (plus one for the receiver).
 
@@ -1609,11 +1651,27 @@ Return Value:
 {
 
     PCK_CLOSURE Closure;
+    PCK_CALL_CACHE_ENTRY Entry;
+    ULONG Index;
     CK_VALUE Method;
     PCK_STRING NameString;
 
     CK_ASSERT(CK_IS_STRING(MethodName));
 
+    //
+    // Check the call site cache first. A matching tag means the class's
+    // methods haven't changed since the lookup was cached.
+    //
+
+    if (Cache != NULL) {
+        for (Index = 0; Index < CK_CALL_CACHE_SIZE; Index += 1) {
+            Entry = &(Cache->Entries[Index]);
+            if (Entry->Tag == Class->Tag) {
+                return CkpCallFunction(Vm, Entry->Closure, Arity);
+            }
+        }
+    }
+
     //
     // Look up the method in the receiver, and call it.
     //
@@ -1631,6 +1689,13 @@ Return Value:
     }
 
     Closure = CK_AS_CLOSURE(Method);
+    if (Cache != NULL) {
+        Entry = &(Cache->Entries[Cache->Next]);
+        Entry->Tag = Class->Tag;
+        Entry->Closure = Closure;
+        Cache->Next = (Cache->Next + 1) % CK_CALL_CACHE_SIZE;
+    }
+
     return CkpCallFunction(Vm, Closure, Arity);
 }
 
@@ -1861,6 +1926,7 @@ Return Value:
 
 VOID
 CkpCloseUpvalues (
+    PCK_VM Vm,
     PCK_FIBER Fiber,
     PCK_VALUE Last
     )
@@ -1875,6 +1941,8 @@ Routine Description:
 
 Arguments:
 
+    Vm - Supplies a pointer to the virtual machine.
+
     Fiber - Supplies a pointer to the current fiber.
 
     Last - Supplies the soon-to-be new top of the stack.
@@ -1902,6 +1970,7 @@ Return Value:
         Upvalue->Closed = *(Upvalue->Value);
         Upvalue->Value = &(Upvalue->Closed);
         Fiber->OpenUpvalues = Upvalue->Next;
+        CK_WRITE_BARRIER(Vm, &(Upvalue->Header));
     }
 
     return;
@@ -150,14 +150,16 @@ Enumeration Description:
     CkOpCall0 - Invokes the method with the symbol specified by the next
         instruction word. The opcode number describes the number of arguments
         that have already been pushed (not including the receiver). Subsequent
-        opcodes code for 1-7 arguments, respectively.
+        opcodes code for 1-7 arguments, respectively. The word after the
+        symbol is the index of the call site's inline cache in the function.
 
     CkOpCall8 - Invokes the method with the symbol specified by the next
-        instruction word, with 8 arguments.
+        instruction word, with 8 arguments, followed by the inline cache
+        index word.
 
     CkOpCall - Invokes the method with the number of arguments specified by the
         next instruction byte. The symbol is specified by the subsequent
-        instruction word.
+        instruction word, followed by the inline cache index word.
 
     CkOpIndirectCall - Invokes the method with the number of arguments
         specified by the next instruction byte. The method to call is pushed
@@ -165,14 +167,17 @@ Enumeration Description:
 
     CkOpSuperCall0 - Invokes a method on the superclass with the symbol
         given by the next instruction word. The opcode specifies the number of
-        arguments (the next 8 opcodes code for 1-8 arguments).
+        arguments (the next 8 opcodes code for 1-8 arguments). The inline
+        cache index word follows the symbol.
 
     CkOpSuperCall8 - Invokes a method on the superclass with the symbol given
-        by the next instruction word, specifying 8 arguments.
+        by the next instruction word, specifying 8 arguments, followed by the
+        inline cache index word.
 
     CkOpSuperCall - Invokes a method on the superclass with the number of
         arguments in the next instruction byte. The subsequent instruction word
-        specifies the symbol to invoke.
+        specifies the symbol to invoke, followed by the inline cache index
+        word.
 
     CkOpJump - Moves the instruction pointer forward by the number of bytes
         specified in the following instruction word.
@@ -388,14 +393,42 @@ Structure Description:
     GarbageFreed - Stores the number of objects freed during the most recent
         garbage collection run.
 
-    FirstObject - Stores a pointer to the first object in the massive singly
-        linked list of all living objects. This is the list that the garbage
-        collector traverses.
+    YoungBytes - Stores the number of bytes allocated since the last garbage
+        collection. Once this reaches the configured nursery size, a young
+        collection is performed.
+
+    OldBytes - Stores the number of bytes in the old generation, as of the most
+        recent garbage collection.
+
+    FirstObject - Stores a pointer to the first object in the singly linked
+        list of young objects, those allocated since the last garbage
+        collection.
+
+    OldObjects - Stores a pointer to the first object in the singly linked
+        list of objects that have survived a garbage collection.
+
+    RememberedObjects - Stores a pointer to the first old object that has been
+        written to since the last garbage collection. These objects are linked
+        through their kiss pointers.
 
     KissList - Stores the tail of the list of objects that have been kissed.
         The list is circular to ensure that the last object has a non-null
         next pointer.
 
+    YoungCollection - Stores a boolean indicating whether the collection in
+        progress is only considering young objects.
+
+    GarbageStatistics - Stores statistics about the garbage collector.
+
+    InternTable - Stores a pointer to the open addressed hash table of
+        interned strings. The table does not keep its strings alive; strings
+        remove themselves when they are destroyed.
+
+    InternCount - Stores the number of strings in the intern table.
+
+    InternCapacity - Stores the number of slots in the intern table. This is
+        always a power of two.
+
     WorkingObjects - Stores a fixed stack of objects that should not be
         garbage collected but who are not necessarily linked anywhere else.
 
@@ -422,6 +455,9 @@ Structure Description:
     Context - Stores an opaque user context pointer that can be used by whoever
         is integrating the Chalk library.
 
+    NextClassTag - Stores the most recently handed out class tag, used to
+        validate inline call caches.
+
 --*/
 
 struct _CK_VM {
@@ -432,8 +468,17 @@ struct _CK_VM {
     UINTN NextGarbageCollection;
     ULONG GarbageRuns;
     ULONG GarbageFreed;
+    UINTN YoungBytes;
+    UINTN OldBytes;
     PCK_OBJECT FirstObject;
+    PCK_OBJECT OldObjects;
+    PCK_OBJECT RememberedObjects;
     PCK_OBJECT KissList;
+    BOOL YoungCollection;
+    CK_GARBAGE_STATISTICS GarbageStatistics;
+    PCK_STRING *InternTable;
+    UINTN InternCount;
+    UINTN InternCapacity;
     PCK_OBJECT WorkingObjects[CK_MAX_WORKING_OBJECTS];
     ULONG WorkingObjectCount;
     PCK_COMPILER Compiler;
@@ -443,6 +488,7 @@ struct _CK_VM {
     INT MemoryException;
     PCK_CLOSURE UnhandledException;
     PVOID Context;
+    ULONG NextClassTag;
 };
 
 //
@@ -698,6 +744,7 @@ CkpCallMethod (
     PCK_VM Vm,
     PCK_CLASS Class,
     CK_VALUE MethodName,
+    PCK_CALL_CACHE Cache,
     CK_ARITY Arity
     );
 
@@ -715,6 +762,10 @@ Routine Description:
 
     MethodName - Supplies the name of the method to look up on the class.
 
+    Cache - Supplies an optional pointer to the inline cache for the call site.
+        If the class has been seen here before, the method dictionary lookup
+        is skipped. Otherwise the result of the lookup is remembered.
+
     Arity - Supplies the number of arguments the method was called with in
         code (plus one for the receiver).
 
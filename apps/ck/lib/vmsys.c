@@ -36,6 +36,7 @@ Module Name:
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "chalkp.h"
@@ -52,11 +53,60 @@ Module Name:
 #define CK_INITIAL_HEAP_DEFAULT (1024 * 1024 * 10)
 #define CK_MINIMUM_HEAP_DEFAULT (1024 * 1024)
 #define CK_HEAP_GROWTH_DEFAULT 512
+#define CK_NURSERY_SIZE_DEFAULT (512 * 1024)
+
+//
+// Define the magic value at the start of a module cache file ("CkOb").
+//
+
+#define CK_MODULE_CACHE_MAGIC 0x624F6B43
+
+//
+// Define the name of the directory next to the source files where cached
+// module objects are kept. Keeping them out of the source directory keeps
+// interpreters that predate the cache header from picking them up.
+//
+
+#define CK_MODULE_CACHE_DIRECTORY "__ckcache__"
 
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure stores the header at the beginning of a cached module
+    object file. The cached object is only used if every field matches the
+    current interpreter and the source file it was compiled from.
+
+Members:
+
+    Magic - Stores the constant CK_MODULE_CACHE_MAGIC.
+
+    InterpreterVersion - Stores the Chalk version that wrote the file.
+
+    FreezeVersion - Stores the version of the frozen module format.
+
+    CoreVariableCount - Stores the number of module variables in the core
+        module, which frozen variable indices depend on.
+
+    SourceSize - Stores the size of the source file in bytes.
+
+    SourceModificationTime - Stores the modification time of the source file.
+
+--*/
+
+typedef struct _CK_MODULE_CACHE_HEADER {
+    ULONG Magic;
+    ULONG InterpreterVersion;
+    ULONG FreezeVersion;
+    ULONG CoreVariableCount;
+    ULONGLONG SourceSize;
+    LONGLONG SourceModificationTime;
+} CK_MODULE_CACHE_HEADER, *PCK_MODULE_CACHE_HEADER;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -123,6 +173,26 @@ CkpReadSource (
     PCK_MODULE_HANDLE ModuleData
     );
 
+BOOL
+CkpGetModuleCachePath (
+    PCSTR SourcePath,
+    PSTR ObjectPath
+    );
+
+VOID
+CkpInitializeModuleCacheHeader (
+    PCK_VM Vm,
+    struct stat *SourceStat,
+    PCK_MODULE_CACHE_HEADER Header
+    );
+
+BOOL
+CkpIsModuleCacheValid (
+    PCK_VM Vm,
+    FILE *File,
+    struct stat *SourceStat
+    );
+
 CK_LOAD_MODULE_RESULT
 CkpLoadDynamicModule (
     PCK_VM Vm,
@@ -146,6 +216,7 @@ CK_CONFIGURATION CkDefaultConfiguration = {
     CK_INITIAL_HEAP_DEFAULT,
     CK_MINIMUM_HEAP_DEFAULT,
     CK_HEAP_GROWTH_DEFAULT,
+    CK_NURSERY_SIZE_DEFAULT,
     0
 };
 
@@ -337,53 +408,89 @@ Return Value:
 
 {
 
-    PSTR Dot;
+    PSTR DirectoryEnd;
     FILE *File;
-    size_t Length;
+    CK_MODULE_CACHE_HEADER Header;
     CHAR Path[PATH_MAX];
-    ssize_t Written;
+    INT Status;
+    struct stat Stat;
+    CHAR TemporaryPath[PATH_MAX];
 
     //
-    // Use the same path as the source file, but replace the extension with
-    // the object extension.
+    // Put the object in the cache directory next to the source file. The
+    // source is stat'ed again so the header describes the file that was
+    // compiled.
     //
 
-    Length = strlen(ModulePath);
-    if (Length + 2 > PATH_MAX) {
+    if (CkpGetModuleCachePath(ModulePath, Path) == FALSE) {
         return 0;
     }
 
-    memcpy(Path, ModulePath, Length + 1);
-    Dot = strrchr(Path, '.');
-    if (Dot == NULL) {
+    if ((stat(ModulePath, &Stat) != 0) || (!S_ISREG(Stat.st_mode))) {
         return 0;
     }
 
-    if (Dot + 1 + strlen(CK_OBJECT_EXTENSION) >= Path + PATH_MAX) {
-        return 0;
-    }
+    DirectoryEnd = strrchr(Path, '/');
+
+    CK_ASSERT(DirectoryEnd != NULL);
+
+    *DirectoryEnd = '\0';
+    CkpCreateDirectory(Path);
+    *DirectoryEnd = '/';
 
-    strcpy(Dot + 1, CK_OBJECT_EXTENSION);
+    CkpInitializeModuleCacheHeader(Vm, &Stat, &Header);
 
     //
-    // Attempt to save the file.
+    // Write to a temporary file and rename it into place, so that other
+    // processes loading the module concurrently never see a half written
+    // object.
     //
 
-    File = fopen(Path, "wb");
+    Status = snprintf(TemporaryPath,
+                      PATH_MAX,
+                      "%s.%d.tmp",
+                      Path,
+                      (int)getpid());
+
+    if ((Status < 0) || (Status >= PATH_MAX)) {
+        return 0;
+    }
+
+    File = fopen(TemporaryPath, "wb");
     if (File == NULL) {
         return 0;
     }
 
-    Written = fwrite(FrozenData, 1, FrozenDataSize, File);
-    fclose(File);
+    Status = 0;
+    if ((fwrite(&Header, 1, sizeof(Header), File) != sizeof(Header)) ||
+        (fwrite(FrozenData, 1, FrozenDataSize, File) != FrozenDataSize)) {
+
+        Status = -1;
+    }
+
+    if (fclose(File) != 0) {
+        Status = -1;
+    }
+
+    if (Status == 0) {
+        Status = rename(TemporaryPath, Path);
+
+        //
+        // Some platforms refuse to rename over an existing file.
+        //
+
+        if (Status != 0) {
+            unlink(Path);
+            Status = rename(TemporaryPath, Path);
+        }
+    }
 
     //
-    // If not everything was written, delete the file so as not to have half
-    // baked objects.
+    // Don't leave half baked objects lying around.
     //
 
-    if (Written != FrozenDataSize) {
-        unlink(Path);
+    if (Status != 0) {
+        unlink(TemporaryPath);
     }
 
     return 0;
@@ -544,6 +651,40 @@ Return Value:
     return;
 }
 
+ULONGLONG
+CkpGetProcessorTime (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the amount of processor time used by the process. It
+    is used to measure garbage collection pauses.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the processor time in microseconds.
+
+--*/
+
+{
+
+    clock_t Clock;
+
+    Clock = clock();
+    if (Clock == (clock_t)-1) {
+        return 0;
+    }
+
+    return (ULONGLONG)Clock * 1000000ULL / CLOCKS_PER_SEC;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -585,11 +726,12 @@ Return Value:
     off_t FileSize;
     CK_LOAD_MODULE_RESULT LoadStatus;
     CHAR ObjectPath[PATH_MAX];
-    INT ObjectPathLength;
+    BOOL ObjectPathValid;
     struct stat ObjectStat;
     INT ObjectStatus;
     CHAR Path[PATH_MAX];
     INT PathLength;
+    struct stat *SourceStat;
     INT SourceStatus;
     struct stat Stat;
 
@@ -627,36 +769,15 @@ Return Value:
     Path[PATH_MAX - 1] = '\0';
 
     //
-    // Get the path to the pre-compiled object.
+    // Get the path to the pre-compiled object, which sits in the cache
+    // directory next to the source.
     //
 
-    if (Directory == NULL) {
-        ObjectPathLength = -1;
-
-    } else if (*Directory == '\0') {
-        ObjectPathLength = snprintf(ObjectPath,
-                                    PATH_MAX,
-                                    "%s.%s",
-                                    ModulePath,
-                                    CK_OBJECT_EXTENSION);
-
-    } else {
-        ObjectPathLength = snprintf(ObjectPath,
-                                    PATH_MAX,
-                                    "%s/%s.%s",
-                                    Directory,
-                                    ModulePath,
-                                    CK_OBJECT_EXTENSION);
-    }
-
-    if ((ObjectPathLength < 0) || (ObjectPathLength > PATH_MAX)) {
-        ObjectPath[0] = '\0';
-        ObjectPathLength = 0;
-    }
+    ObjectPathValid = CkpGetModuleCachePath(Path, ObjectPath);
 
     //
     // Stat both the source and the object. Both must be files, and the object
-    // must have a non-zero size.
+    // must be big enough to hold a cache header.
     //
 
     SourceStatus = stat(Path, &Stat);
@@ -665,10 +786,11 @@ Return Value:
     }
 
     ObjectStatus = -1;
-    if (ObjectPathLength != 0) {
+    if (ObjectPathValid != FALSE) {
         ObjectStatus = stat(ObjectPath, &ObjectStat);
         if ((ObjectStatus == 0) &&
-            ((!S_ISREG(ObjectStat.st_mode)) || (ObjectStat.st_size == 0))) {
+            ((!S_ISREG(ObjectStat.st_mode)) ||
+             (ObjectStat.st_size <= (off_t)sizeof(CK_MODULE_CACHE_HEADER)))) {
 
             ObjectStatus = -1;
         }
@@ -684,20 +806,28 @@ Return Value:
     }
 
     //
-    // If the object path exists and is either 1) the only thing that exists or
-    // 2) is newer than the source, then try to open the object file.
+    // If the object exists, use it as long as its header matches the source
+    // (or there is no source at all). A stale or foreign object is simply
+    // ignored, and gets replaced after the source is compiled.
     //
 
     FileSize = Stat.st_size;
-    if ((ObjectStatus == 0) &&
-        ((SourceStatus != 0) || (ObjectStat.st_mtime >= Stat.st_mtime))) {
-
+    if (ObjectStatus == 0) {
         File = fopen(ObjectPath, "rb");
         if (File != NULL) {
-            FileSize = ObjectStat.st_size;
-            PathLength = ObjectPathLength;
+            SourceStat = NULL;
+            if (SourceStatus == 0) {
+                SourceStat = &Stat;
+            }
+
+            if (CkpIsModuleCacheValid(Vm, File, SourceStat) != FALSE) {
+                FileSize = ObjectStat.st_size - sizeof(CK_MODULE_CACHE_HEADER);
+
+            } else {
+                fclose(File);
+                File = NULL;
+            }
         }
-
     }
 
     //
@@ -814,6 +944,191 @@ Return Value:
     return LoadStatus;
 }
 
+BOOL
+CkpGetModuleCachePath (
+    PCSTR SourcePath,
+    PSTR ObjectPath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets the path of the cached object for a source file. The
+    object lives in the cache directory within the source's directory, and is
+    named after the source with the extension replaced by the object
+    extension.
+
+Arguments:
+
+    SourcePath - Supplies a pointer to the source file path.
+
+    ObjectPath - Supplies a pointer to a buffer of PATH_MAX bytes where the
+        object path will be returned.
+
+Return Value:
+
+    TRUE if the source file has an object path.
+
+    FALSE if the source path does not end in the source extension or is too
+    long.
+
+--*/
+
+{
+
+    PCSTR BaseName;
+    size_t DirectoryLength;
+    size_t ExtensionLength;
+    size_t Length;
+    INT Result;
+
+    Length = strlen(SourcePath);
+    ExtensionLength = strlen(CK_SOURCE_EXTENSION);
+    if ((Length <= ExtensionLength + 1) ||
+        (SourcePath[Length - ExtensionLength - 1] != '.') ||
+        (strcmp(SourcePath + Length - ExtensionLength, CK_SOURCE_EXTENSION) !=
+         0)) {
+
+        return FALSE;
+    }
+
+    //
+    // Find the start of the file name. Windows paths may use either slash.
+    //
+
+    BaseName = SourcePath + Length;
+    while ((BaseName != SourcePath) &&
+           (BaseName[-1] != '/') &&
+           (BaseName[-1] != '\\')) {
+
+        BaseName -= 1;
+    }
+
+    DirectoryLength = BaseName - SourcePath;
+
+    Length -= ExtensionLength + 1;
+    Result = snprintf(ObjectPath,
+                      PATH_MAX,
+                      "%.*s%s/%.*s.%s",
+                      (int)DirectoryLength,
+                      SourcePath,
+                      CK_MODULE_CACHE_DIRECTORY,
+                      (int)(Length - DirectoryLength),
+                      BaseName,
+                      CK_OBJECT_EXTENSION);
+
+    if ((Result < 0) || (Result >= PATH_MAX)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+VOID
+CkpInitializeModuleCacheHeader (
+    PCK_VM Vm,
+    struct stat *SourceStat,
+    PCK_MODULE_CACHE_HEADER Header
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills out the cache header describing the given source file
+    as compiled by the current interpreter.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    SourceStat - Supplies an optional pointer to the source file information.
+        If NULL, the source fields are zeroed.
+
+    Header - Supplies a pointer where the header will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_MODULE CoreModule;
+
+    memset(Header, 0, sizeof(CK_MODULE_CACHE_HEADER));
+    Header->Magic = CK_MODULE_CACHE_MAGIC;
+    Header->InterpreterVersion = CHALK_VERSION;
+    Header->FreezeVersion = CK_FREEZE_VERSION;
+    CoreModule = CkpModuleGet(Vm, CkNullValue);
+    if (CoreModule != NULL) {
+        Header->CoreVariableCount = CoreModule->Variables.Count;
+    }
+
+    if (SourceStat != NULL) {
+        Header->SourceSize = SourceStat->st_size;
+        Header->SourceModificationTime = SourceStat->st_mtime;
+    }
+
+    return;
+}
+
+BOOL
+CkpIsModuleCacheValid (
+    PCK_VM Vm,
+    FILE *File,
+    struct stat *SourceStat
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads and validates the header of a cached module object.
+    On success, the file is left positioned at the frozen module data.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    File - Supplies a pointer to the opened object file.
+
+    SourceStat - Supplies an optional pointer to the information for the
+        source file. If NULL, the source is missing and only the interpreter
+        fields of the header are checked.
+
+Return Value:
+
+    TRUE if the cached object can be used.
+
+    FALSE if the object is stale, corrupt, or from a different interpreter.
+
+--*/
+
+{
+
+    CK_MODULE_CACHE_HEADER Expected;
+    CK_MODULE_CACHE_HEADER Header;
+
+    if (fread(&Header, 1, sizeof(Header), File) != sizeof(Header)) {
+        return FALSE;
+    }
+
+    CkpInitializeModuleCacheHeader(Vm, SourceStat, &Expected);
+    if (SourceStat == NULL) {
+        Header.SourceSize = 0;
+        Header.SourceModificationTime = 0;
+    }
+
+    if (memcmp(&Header, &Expected, sizeof(Header)) != 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 CK_LOAD_MODULE_RESULT
 CkpLoadDynamicModule (
     PCK_VM Vm,
@@ -115,3 +115,49 @@ Return Value:
 
 --*/
 
+INT
+CkpCreateDirectory (
+    PCSTR Path
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a directory that anyone can read, subject to the
+    process umask.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the directory to create.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, including if the directory already exists.
+
+--*/
+
+ULONGLONG
+CkpGetProcessorTime (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the amount of processor time used by the process. It
+    is used to measure garbage collection pauses.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the processor time in microseconds.
+
+--*/
+
@@ -66,6 +66,7 @@ function build() {
         "bufferedio.ck",
         "cpio.ck",
         "fileio.ck",
+        "gc.ck",
         "getopt.ck",
         "io.ck",
         "iobase.ck",
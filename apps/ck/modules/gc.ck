@@ -0,0 +1,130 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    gc.ck
+
+Abstract:
+
+    This module implements control over the Chalk garbage collector. New
+    objects are allocated in a nursery that is collected on its own, and
+    objects that survive a collection are promoted to the old generation,
+    which is only examined during full collections.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+collect (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a full garbage collection, examining both the young
+    and old generations.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    null.
+
+--*/
+
+{
+
+    Core.gc();
+    return null;
+}
+
+function
+collectYoung (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects only the nursery. Surviving young objects are
+    promoted to the old generation.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    null.
+
+--*/
+
+{
+
+    Core.gcYoung();
+    return null;
+}
+
+function
+statistics (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the garbage collector statistics.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a dictionary of statistics. The youngCollections and
+    fullCollections members count the collections of each kind. The youngTime,
+    fullTime, lastPause, and maxPause members are pause times in microseconds.
+    The promoted and freed members count objects moved to the old generation
+    and destroyed. The bytesAllocated, youngBytes, oldBytes, nextCollection,
+    and nurserySize members describe the current heap and its thresholds.
+
+--*/
+
+{
+
+    return Core.gcStatistics();
+}
+
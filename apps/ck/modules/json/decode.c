@@ -472,7 +472,8 @@ Return Value:
     while (TRUE) {
 
         //
-        // Decode a key.
+        // Decode a key. Keys tend to repeat across objects, so intern them to
+        // share one copy of each and speed up lookups on the result.
         //
 
         Status = CkpJsonDecodeObject(Decoder);
@@ -480,6 +481,8 @@ Return Value:
             return Status;
         }
 
+        CkInternString(Decoder->Vm, -1);
+
         Status = CkpJsonSkipSpace(Decoder);
         if (Status != 0) {
             return Status;
@@ -56,7 +56,7 @@ function build() {
     lib = {
         "label": "lzma_dynamic",
         "output": "lzma",
-        "inputs": objs[0]
+        "inputs": objs[0] + ["apps/osbase:libminocaos"]
     };
 
     entries += chalkSharedModule(lib);
@@ -73,7 +73,7 @@ function build() {
     lib = {
         "label": "build_lzma_dynamic",
         "output": "lzma",
-        "inputs": objs[0],
+        "inputs": objs[0] + ["lib/rtl/base:build_basertl"],
         "build": true,
         "prefix": "build"
     };
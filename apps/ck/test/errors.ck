@@ -0,0 +1,137 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    errors.ck
+
+Abstract:
+
+    This module tests that compile errors are raised as catchable CompileError
+    exceptions. Raising an exception sets fields on a new exception object
+    while the VM holds several objects of its own, so this also catches
+    garbage collector root overflows. Run it as "chalk errors.ck" from this
+    directory; it raises an exception if any test fails.
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_expectCompileError (
+    moduleName
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+main (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the entry point for the compile error test.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    0 always. Failures raise an exception.
+
+--*/
+
+{
+
+    var iteration;
+
+    //
+    // Import each broken module a few times, as the first error and later
+    // ones may take different paths through the dictionary code.
+    //
+
+    for (iteration in 0..3) {
+        _expectCompileError("undef");
+        _expectCompileError("syntax");
+    }
+
+    Core.print("Compile error tests passed.");
+    return 0;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_expectCompileError (
+    moduleName
+    )
+
+/*++
+
+Routine Description:
+
+    This routine imports a module that fails to compile, and raises an
+    exception if that doesn't result in a CompileError.
+
+Arguments:
+
+    moduleName - Supplies the name of the module to import.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    try {
+        Core.importModule(moduleName);
+
+    } except CompileError {
+        return;
+    }
+
+    Core.raise(RuntimeError("Importing %s did not raise a CompileError" %
+                            moduleName));
+
+    return;
+}
+
+main();
+
@@ -0,0 +1,60 @@
+#!/bin/sh
+## Copyright (c) 2026 Minoca Corp.
+##
+##    This file is licensed under the terms of the GNU General Public License
+##    version 3. Alternative licensing terms are available. Contact
+##    info@minocacorp.com for details. See the LICENSE file at the root of this
+##    project for complete licensing information.
+##
+## Script Name:
+##
+##     errors.sh
+##
+## Abstract:
+##
+##     This script checks that Chalk reports compile errors cleanly, both in
+##     the main script and in imported modules. Set CHALK to the interpreter
+##     to test. A debug build is best, as it asserts if the garbage collector
+##     runs out of room for working objects while raising the error.
+##
+##     usage: errors.sh
+##
+## Environment:
+##
+##     POSIX
+##
+
+CHALK=${CHALK:-chalk}
+cd "$(dirname "$0")" || exit 1
+failures=0
+
+for script in undef.ck syntax.ck; do
+    output=$("$CHALK" $script 2>&1)
+    status=$?
+    case "$output" in
+    *CompileError*)
+        if [ $status -ne 2 ]; then
+            echo "$script: Expected exit status 2, got $status."
+            failures=$((failures + 1))
+        fi
+        ;;
+
+    *)
+        echo "$script: Expected a CompileError, got status $status:"
+        echo "$output"
+        failures=$((failures + 1))
+        ;;
+    esac
+done
+
+if ! "$CHALK" errors.ck; then
+    failures=$((failures + 1))
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures compile error test failures."
+    exit 1
+fi
+
+exit 0
+
@@ -0,0 +1,25 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    undef.ck
+
+Abstract:
+
+    This module references an undefined variable, and so fails to compile. It
+    is imported by the compile error test.
+
+Environment:
+
+    Chalk
+
+--*/
+
+Foo;
@@ -0,0 +1,66 @@
+##
+## Copyright (c) 2026 Minoca Corp. All Rights Reserved.
+##
+## Script Name:
+##
+##     bench.sh
+##
+## Abstract:
+##
+##     This script compares the single stream lzma encoder and decoder against
+##     block-parallel mode at several thread counts. Set THREADS to change the
+##     thread counts tried, and LEVELS to change the compression levels.
+##
+## Environment:
+##
+##     Test
+##
+
+set -e
+
+files="gcc-6.3.0.tar binutils-2.27.tar"
+threads=${THREADS:-"2 4 8"}
+levels=${LEVELS:-"4 9"}
+
+for f in $files; do
+    if ! [ -f $f ]; then
+        gzip -d < $SRCROOT/third-party/src/${f}.gz > $f
+    fi
+done
+
+##
+## Run the given command and print the number of seconds it took.
+##
+
+elapsed() {
+    start=`date +%s.%N`
+    "$@"
+    end=`date +%s.%N`
+    echo "$start $end" | awk '{printf "%.2f", $2 - $1}'
+}
+
+printf "%-20s %-6s %-8s %-10s %-10s %s\n" File Level Threads Compress \
+    Decompress Size
+
+for f in $files; do
+    for l in $levels; do
+
+        # Measure the single stream encoder as the baseline.
+        c=`elapsed lzma -c -$l -i $f -o $f.lz`
+        d=`elapsed lzma -d -i $f.lz -o $f.out`
+        cmp $f.out $f
+        size=`wc -c < $f.lz`
+        printf "%-20s %-6s %-8s %-10s %-10s %s\n" $f $l stream $c $d $size
+
+        # Measure block mode at each thread count.
+        for t in $threads; do
+            c=`elapsed lzma -c -T$t -$l -i $f -o $f.lz`
+            d=`elapsed lzma -d -T$t -i $f.lz -o $f.out`
+            cmp $f.out $f
+            size=`wc -c < $f.lz`
+            printf "%-20s %-6s %-8s %-10s %-10s %s\n" $f $l $t $c $d $size
+        done
+
+        rm $f.lz $f.out
+    done
+done
@@ -34,7 +34,6 @@ function build() {
     var sources;
 
     sources = [
-        "crc32.c",
         "encopt.c",
         "lzfind.c",
         "lzmadec.c",
@@ -83,7 +83,7 @@ Module Name:
 //
 
 #define LZP_HASH3(_Finder, _Bytes, _HashValue2, _HashValue3) \
-    (_HashValue3) = LzCrc32[(_Bytes)[0]] ^ (_Bytes)[1]; \
+    (_HashValue3) = RtlCrcTable[0][(_Bytes)[0]] ^ (_Bytes)[1]; \
     (_HashValue2) = (_HashValue3) & (LZMA_HASH2_SIZE - 1); \
     (_HashValue3) = ((_HashValue3) ^ ((ULONG)(_Bytes)[2] << 8)) & \
                     (_Finder)->HashMask;
@@ -93,11 +93,11 @@ Module Name:
 //
 
 #define LZP_HASH4(_Finder, _Bytes, _HashValue2, _HashValue3, _HashValue4) \
-    (_HashValue4) = LzCrc32[(_Bytes)[0]] ^ (_Bytes)[1]; \
+    (_HashValue4) = RtlCrcTable[0][(_Bytes)[0]] ^ (_Bytes)[1]; \
     (_HashValue2) = (_HashValue4) & (LZMA_HASH2_SIZE - 1); \
     (_HashValue4) ^= ((ULONG)(_Bytes)[2]) << 8; \
     (_HashValue3) = (_HashValue4) & (LZMA_HASH3_SIZE - 1); \
-    (_HashValue4) = ((_HashValue4) ^ (LzCrc32[(_Bytes)[3]] << 5)) & \
+    (_HashValue4) = ((_HashValue4) ^ (RtlCrcTable[0][(_Bytes)[3]] << 5)) & \
                     (_Finder)->HashMask;
 
 //
@@ -1481,7 +1481,8 @@ Return Value:
     }
 
     //
-    // If the data is all in memory then just scoot the buffer along.
+    // If the data is all in memory then just scoot the buffer along. The
+    // input is still accounted for so the footer comes out right.
     //
 
     if (Finder->DirectInput != FALSE) {
@@ -1492,6 +1493,17 @@ Return Value:
             CurrentSize = Finder->DirectInputRemaining;
         }
 
+        Destination = Finder->Buffer +
+                      (Finder->StreamPosition - Finder->Position);
+
+        Finder->System->Input += CurrentSize;
+        Finder->System->InputSize -= CurrentSize;
+        Finder->System->UncompressedSize += CurrentSize;
+        Finder->System->UncompressedCrc32 =
+                             RtlComputeCrc32(Finder->System->UncompressedCrc32,
+                                             Destination,
+                                             CurrentSize);
+
         Finder->DirectInputRemaining -= CurrentSize;
         Finder->StreamPosition += CurrentSize;
         if (Finder->DirectInputRemaining == 0) {
@@ -1549,7 +1561,7 @@ Return Value:
 
         Finder->System->UncompressedSize += Size;
         Finder->System->UncompressedCrc32 =
-                             LzpComputeCrc32(Finder->System->UncompressedCrc32,
+                             RtlComputeCrc32(Finder->System->UncompressedCrc32,
                                              Destination,
                                              Size);
 
@@ -671,7 +671,7 @@ Return Value:
 
             Decoder->Dict = OriginalDict;
             Decoder->DictBufferSize = OriginalBufferSize;
-            Context->CompressedCrc32 = LzpComputeCrc32(Context->CompressedCrc32,
+            Context->CompressedCrc32 = RtlComputeCrc32(Context->CompressedCrc32,
                                                        Context->Input,
                                                        InSize);
 
@@ -679,7 +679,7 @@ Return Value:
             Context->Input += InSize;
             Context->InputSize -= InSize;
             Context->UncompressedCrc32 =
-                                    LzpComputeCrc32(Context->UncompressedCrc32,
+                                    RtlComputeCrc32(Context->UncompressedCrc32,
                                                     Context->Output,
                                                     Decoder->DictPosition);
 
@@ -753,7 +753,7 @@ Return Value:
                 //
 
                 Context->CompressedCrc32 =
-                                      LzpComputeCrc32(Context->CompressedCrc32,
+                                      RtlComputeCrc32(Context->CompressedCrc32,
                                                       InBuffer + InPosition,
                                                       InProcessed);
 
@@ -772,7 +772,7 @@ Return Value:
                 }
 
                 Context->UncompressedCrc32 =
-                                    LzpComputeCrc32(Context->UncompressedCrc32,
+                                    RtlComputeCrc32(Context->UncompressedCrc32,
                                                     OutBuffer,
                                                     OutPosition);
 
@@ -957,7 +957,6 @@ Return Value:
 
     PLZMA_DECODER Decoder;
 
-    LzpCrcInitialize();
     Decoder = Context->Reallocate(NULL, sizeof(LZMA_DECODER));
     if (Decoder == NULL) {
         return NULL;
@@ -1334,7 +1333,7 @@ Return Value:
         return Status;
     }
 
-    Context->CompressedCrc32 = LzpComputeCrc32(Context->CompressedCrc32,
+    Context->CompressedCrc32 = RtlComputeCrc32(Context->CompressedCrc32,
                                                Header,
                                                LZMA_HEADER_SIZE);
 
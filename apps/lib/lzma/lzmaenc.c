@@ -537,7 +537,9 @@ Return Value:
     // encode directly to memory if no read/write functions are supplied.
     //
 
-    if (Context->UncompressedSize == 0) {
+    if ((Context->UncompressedSize == 0) &&
+        (Encoder->MatchFinderData.DirectInput == FALSE)) {
+
         if ((Flush != LzNoFlush) && (Context->Read == NULL)) {
             Context->Reallocate(Encoder->MatchFinderData.BufferBase, 0);
             Encoder->MatchFinderData.BufferBase = (PUCHAR)(Context->Input);
@@ -940,7 +942,6 @@ Return Value:
     PLZMA_ENCODER Encoder;
     LZMA_ENCODER_PROPERTIES Properties;
 
-    LzpCrcInitialize();
     Encoder = Context->Reallocate(NULL, sizeof(LZMA_ENCODER));
     if (Encoder == NULL) {
         return NULL;
@@ -3265,7 +3266,7 @@ Return Value:
         RangeEncoder->Result = LzErrorWrite;
     }
 
-    System->CompressedCrc32 = LzpComputeCrc32(System->CompressedCrc32,
+    System->CompressedCrc32 = RtlComputeCrc32(System->CompressedCrc32,
                                               RangeEncoder->BufferBase,
                                               Size);
 
@@ -3324,7 +3325,7 @@ Return Value:
             memcpy(Context->Output, Range->BufferRead, Size);
         }
 
-        Context->CompressedCrc32 = LzpComputeCrc32(Context->CompressedCrc32,
+        Context->CompressedCrc32 = RtlComputeCrc32(Context->CompressedCrc32,
                                                    Range->BufferRead,
                                                    Size);
 
@@ -26,6 +26,16 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+//
+// The CRC-32 and its tables come from the Rtl base library, which is linked in
+// statically on build machines.
+//
+
+#define RTL_API
+
+#include <minoca/lib/status.h>
+#include <minoca/lib/rtl.h>
+
 //
 // --------------------------------------------------------------------- Macros
 //
@@ -104,58 +114,7 @@ typedef USHORT LZ_PROB, *PLZ_PROB;
 // -------------------------------------------------------------------- Globals
 //
 
-extern ULONG LzCrc32[0x100];
-
 //
 // -------------------------------------------------------- Function Prototypes
 //
 
-VOID
-LzpCrcInitialize (
-    VOID
-    );
-
-/*++
-
-Routine Description:
-
-    This routine initializes the CRC-32 table.
-
-Arguments:
-
-    None.
-
-Return Value:
-
-    None.
-
---*/
-
-ULONG
-LzpComputeCrc32 (
-    ULONG InitialCrc,
-    PCVOID Buffer,
-    ULONG Size
-    );
-
-/*++
-
-Routine Description:
-
-    This routine computes the CRC-32 on the given buffer of data.
-
-Arguments:
-
-    InitialCrc - Supplies an initial CRC value to start with. Supply 0
-        initially.
-
-    Buffer - Supplies a pointer to the buffer to compute the CRC32 of.
-
-    Size - Supplies the size of the buffer, in bytes.
-
-Return Value:
-
-    Returns the CRC32 hash of the buffer.
-
---*/
-
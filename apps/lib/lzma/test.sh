@@ -47,9 +47,17 @@ for f in $files; do
         cmp $f.lz$l $f.lzm$l
         cmp $f.lzm$l.txt $f.lz$l.txt
 
+        # Compress in parallel blocks, and decompress both in parallel and on
+        # a single thread.
+        lzma -c -T4 --block-size=4096 -$l -i $f -o $f.lzt$l
+        lzma -d -T4 -i $f.lzt$l -o $f.outt$l
+        cmp $f.outt$l $f
+        lzma -d -T1 -i $f.lzt$l -o $f.outt$l
+        cmp $f.outt$l $f
+
         # Clean up.
         rm $f.lz$l $f.lzm$l $f.out$l $f.lzm$l.txt
-        rm $f.lz$l.txt $f.$l.txt
+        rm $f.lz$l.txt $f.$l.txt $f.lzt$l $f.outt$l
     done
 done
 
@@ -31,6 +31,8 @@ from menv import application, mconfig;
 function build() {
     var app;
     var buildApp;
+    var buildConfig;
+    var buildOs = mconfig.build_os;
     var entries;
     var sources;
 
@@ -40,13 +42,30 @@ function build() {
 
     app = {
         "label": "lzma",
-        "inputs": sources + ["apps/lib/lzma:liblzma"],
+        "inputs": sources + [
+            "apps/lib/lzma:liblzma",
+            "apps/osbase:libminocaos"
+        ],
     };
 
+    //
+    // Minoca's C library has pthreads built in, but other build hosts need it
+    // linked in explicitly.
+    //
+
+    buildConfig = {};
+    if (buildOs != "Minoca") {
+        buildConfig["DYNLIBS"] = ["-lpthread"];
+    }
+
     buildApp = {
         "label": "build_lzma",
         "output": "lzma",
-        "inputs": sources + ["apps/lib/lzma:build_liblzma"],
+        "inputs": sources + [
+            "apps/lib/lzma:build_liblzma",
+            "lib/rtl/base:build_basertl"
+        ],
+        "config": buildConfig,
         "build": true,
         "prefix": "build",
         "binplace": "tools/bin"
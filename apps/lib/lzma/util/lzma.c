@@ -33,6 +33,7 @@ Module Name:
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -84,17 +85,48 @@ Module Name:
     "  --pb=<count> - Set number of position bits [0, 4] (default 2).\n" \
     "  --mf=<type> - Set match finder [hc4, bt2, bt3, bt4] (default bt4).\n" \
     "  --no-eos - Do not write end of stream marker.\n" \
+    "  -T, --threads=<count> - Set the number of threads (default 1). Zero\n"\
+    "      uses one thread per processor. With more than one thread, the\n" \
+    "      input is compressed as independent blocks, which can later be\n" \
+    "      decompressed in parallel as well.\n" \
+    "  --block-size=<size> - Set the block size in kilobytes for \n" \
+    "      multithreaded compression (default 8192).\n" \
     "  --help - Display this help message.\n" \
     "  --version -- Display the version information and exit.\n"
 
-#define LZMA_OPTIONS_STRING "cdi:lo:0123456789hvV"
+#define LZMA_OPTIONS_STRING "cdi:lo:0123456789T:hvV"
 
 #define LZMA_UTIL_VERSION_MAJOR 1
-#define LZMA_UTIL_VERSION_MINOR 0
+#define LZMA_UTIL_VERSION_MINOR 1
 
 #define LZMA_UTIL_OPTION_VERBOSE 0x00000001
 #define LZMA_UTIL_OPTION_LIST 0x00000002
 
+//
+// Define the magic value at the start of a block stream: 'LZMB'. A block
+// stream is the magic, followed by the maximum uncompressed block size, and
+// then the blocks. Each block starts with its compressed and uncompressed
+// sizes, followed by a complete LZMA stream (including the file header and
+// footer) for that block. A block with both sizes zero terminates the stream.
+// Since every block stands alone, the blocks can be compressed and
+// decompressed in parallel.
+//
+
+#define LZMA_UTIL_BLOCK_MAGIC 0x424D5A4C
+
+#define LZMA_UTIL_DEFAULT_BLOCK_SIZE (8 * _1MB)
+#define LZMA_UTIL_MIN_BLOCK_SIZE _64KB
+#define LZMA_UTIL_MAX_BLOCK_SIZE _1GB
+#define LZMA_UTIL_MAX_THREADS 64
+
+//
+// Define the largest compressed size a block of the given size can take up.
+// LZMA expands incompressible data only very slightly, so this is generous.
+//
+
+#define LZMA_UTIL_COMPRESSED_BOUND(_Size) \
+    ((_Size) + ((_Size) >> 3) + _64KB)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -111,7 +143,8 @@ typedef enum _LZMA_UTIL_ARGUMENT {
     LzmaUtilLp,
     LzmaUtilPb,
     LzmaUtilMf,
-    LzmaUtilNoEos
+    LzmaUtilNoEos,
+    LzmaUtilBlockSize
 } LZMA_UTIL_ARGUMENT, *PLZMA_UTIL_ARGUMENT;
 
 typedef enum _LZMA_UTIL_ACTION {
@@ -125,8 +158,88 @@ typedef struct _LZMA_UTIL {
     LZMA_ENCODER_PROPERTIES EncoderProperties;
     ULONG Options;
     UINTN MemoryTest;
+    ULONG ThreadCount;
+    ULONG BlockSize;
+    BOOL BlockStream;
+    UCHAR Peek[sizeof(ULONG)];
+    UINTN PeekSize;
 } LZMA_UTIL, *PLZMA_UTIL;
 
+/*++
+
+Structure Description:
+
+    This structure stores a single block of a block stream.
+
+Members:
+
+    Input - Stores a pointer to the input buffer for the block.
+
+    InputSize - Stores the number of valid bytes in the input buffer. This is
+        zero once the input has run out.
+
+    InputCapacity - Stores the allocated size of the input buffer.
+
+    Output - Stores a pointer to the output buffer for the block.
+
+    OutputSize - Stores the number of bytes produced into the output buffer.
+
+    OutputCapacity - Stores the allocated size of the output buffer.
+
+    ExpectedSize - Stores the uncompressed size recorded in the block header
+        when decompressing.
+
+    Status - Stores the result of compressing or decompressing the block.
+
+--*/
+
+typedef struct _LZMA_UTIL_BLOCK {
+    PUCHAR Input;
+    UINTN InputSize;
+    UINTN InputCapacity;
+    PUCHAR Output;
+    UINTN OutputSize;
+    UINTN OutputCapacity;
+    UINTN ExpectedSize;
+    LZ_STATUS Status;
+} LZMA_UTIL_BLOCK, *PLZMA_UTIL_BLOCK;
+
+/*++
+
+Structure Description:
+
+    This structure stores a batch of blocks being worked on by a set of
+    threads.
+
+Members:
+
+    Action - Stores the action being performed on the blocks.
+
+    Properties - Stores the encoder properties to use for each block.
+
+    BlockSize - Stores the maximum uncompressed size of a block.
+
+    Blocks - Stores the array of blocks, one per thread.
+
+    BlockCount - Stores the number of valid blocks in this batch.
+
+    NextBlock - Stores the index of the next block to be picked up by a
+        thread.
+
+    Lock - Stores the lock serializing access to the next block index.
+
+--*/
+
+typedef struct _LZMA_UTIL_BATCH {
+    LZMA_UTIL_ACTION Action;
+    LZMA_ENCODER_PROPERTIES Properties;
+    ULONG BlockSize;
+    PLZMA_UTIL_BLOCK Blocks;
+    UINTN BlockCount;
+    UINTN NextBlock;
+    pthread_mutex_t Lock;
+} LZMA_UTIL_BATCH, *PLZMA_UTIL_BATCH;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -145,6 +258,35 @@ LzpUtilRunMemoryTest (
     LZMA_UTIL_ACTION Action
     );
 
+INT
+LzpUtilProcessBlocks (
+    PLZMA_UTIL Context,
+    LZMA_UTIL_ACTION Action
+    );
+
+INT
+LzpUtilReadBlock (
+    PLZMA_UTIL Context,
+    PLZMA_UTIL_BATCH Batch,
+    PLZMA_UTIL_BLOCK Block
+    );
+
+PVOID
+LzpUtilBlockThread (
+    PVOID Parameter
+    );
+
+LZ_STATUS
+LzpUtilEncodeBlock (
+    PLZMA_UTIL_BATCH Batch,
+    PLZMA_UTIL_BLOCK Block
+    );
+
+LZ_STATUS
+LzpUtilDecodeBlock (
+    PLZMA_UTIL_BLOCK Block
+    );
+
 PVOID
 LzpUtilReallocate (
     PVOID Allocation,
@@ -158,6 +300,13 @@ LzpUtilRead (
     UINTN Size
     );
 
+INTN
+LzpUtilReadFull (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    );
+
 INTN
 LzpUtilWrite (
     PLZ_CONTEXT Context,
@@ -172,6 +321,11 @@ LzpUtilGetNumericOption (
     INT Max
     );
 
+ULONG
+LzpUtilGetProcessorCount (
+    VOID
+    );
+
 PCSTR
 LzpUtilGetErrorString (
     LZ_STATUS Status
@@ -198,6 +352,8 @@ struct option LzmaLongOptions[] = {
     {"pb", required_argument, 0, LzmaUtilPb},
     {"mf", required_argument, 0, LzmaUtilMf},
     {"no-eos", no_argument, 0, LzmaUtilNoEos},
+    {"threads", required_argument, 0, 'T'},
+    {"block-size", required_argument, 0, LzmaUtilBlockSize},
     {"help", no_argument, 0, 'h'},
     {"version", no_argument, 0, 'V'},
     {"verbose", no_argument, 0, 'v'},
@@ -272,6 +428,8 @@ Return Value:
     Context.Lz.Write = LzpUtilWrite;
     LzLzmaInitializeProperties(&(Context.EncoderProperties));
     Context.EncoderProperties.EndMark = TRUE;
+    Context.ThreadCount = 1;
+    Context.BlockSize = LZMA_UTIL_DEFAULT_BLOCK_SIZE;
     Status = 1;
     TotalStatus = 0;
 
@@ -444,6 +602,35 @@ Return Value:
             Context.EncoderProperties.EndMark = FALSE;
             break;
 
+        case 'T':
+            Integer = LzpUtilGetNumericOption(optarg,
+                                              0,
+                                              LZMA_UTIL_MAX_THREADS);
+
+            if (Integer < 0) {
+                goto MainEnd;
+            }
+
+            Context.ThreadCount = Integer;
+            if (Integer == 0) {
+                Context.ThreadCount = LzpUtilGetProcessorCount();
+            }
+
+            break;
+
+        case LzmaUtilBlockSize:
+            Integer = LzpUtilGetNumericOption(
+                                        optarg,
+                                        LZMA_UTIL_MIN_BLOCK_SIZE / _1KB,
+                                        LZMA_UTIL_MAX_BLOCK_SIZE / _1KB);
+
+            if (Integer < 0) {
+                goto MainEnd;
+            }
+
+            Context.BlockSize = Integer * _1KB;
+            break;
+
         case 'v':
             Context.Options |= LZMA_UTIL_OPTION_VERBOSE;
             break;
@@ -606,15 +793,19 @@ Return Value:
     PSTR LastDot;
     PLZ_CONTEXT Lz;
     LZ_STATUS LzStatus;
+    ULONG Magic;
     PSTR OutPathBuffer;
     size_t OutPathSize;
     ULONG Ratio;
     CHAR RatioString[6];
     PCSTR Search;
+    INTN Size;
     INT Status;
 
     Lz = &(Context->Lz);
     OutPathBuffer = NULL;
+    Context->BlockStream = FALSE;
+    Context->PeekSize = 0;
     Status = 2;
 
     //
@@ -721,16 +912,53 @@ Return Value:
         }
     }
 
+    //
+    // Compressing with multiple threads produces a block stream. When
+    // decompressing, peek at the magic to see if this is a block stream. If
+    // it's not, the peeked bytes are handed back to the decoder when it reads.
+    //
+
+    if (Action == LzmaActionCompress) {
+        if ((Context->ThreadCount > 1) && (Context->MemoryTest == 0)) {
+            Context->BlockStream = TRUE;
+        }
+
+    } else {
+        Size = LzpUtilReadFull(Lz, Context->Peek, sizeof(Context->Peek));
+        if (Size < 0) {
+            fprintf(stderr,
+                    "Error: Failed to read %s: %s.\n",
+                    InputPath,
+                    strerror(errno));
+
+            goto ProcessStreamEnd;
+        }
+
+        Context->PeekSize = Size;
+        if (Size == sizeof(ULONG)) {
+            memcpy(&Magic, Context->Peek, sizeof(ULONG));
+            if (Magic == LZMA_UTIL_BLOCK_MAGIC) {
+                Context->BlockStream = TRUE;
+                Context->PeekSize = 0;
+            }
+        }
+    }
+
+    if (Context->BlockStream != FALSE) {
+        Status = LzpUtilProcessBlocks(Context, Action);
+        if (Status != 0) {
+            goto ProcessStreamEnd;
+        }
+
     //
     // If memory test mode was requested, go off and do things the buffer way.
     //
 
-    if (Context->MemoryTest != 0) {
+    } else if (Context->MemoryTest != 0) {
         Status = LzpUtilRunMemoryTest(Context, Action);
         goto ProcessStreamEnd;
-    }
 
-    if (Action == LzmaActionCompress) {
+    } else if (Action == LzmaActionCompress) {
         LzStatus = LzLzmaInitializeEncoder(Lz,
                                            &(Context->EncoderProperties),
                                            TRUE);
@@ -788,14 +1016,35 @@ Return Value:
     //
 
     if ((Context->Options & LZMA_UTIL_OPTION_LIST) != 0) {
-        Ratio = (Lz->CompressedSize * 1000ULL) / Lz->UncompressedSize;
+        Ratio = 0;
+        if (Lz->UncompressedSize != 0) {
+            Ratio = (Lz->CompressedSize * 1000ULL) / Lz->UncompressedSize;
+        }
+
         snprintf(RatioString,
                  sizeof(RatioString),
                  "%d.%d%%",
                  Ratio / 10,
                  Ratio % 10);
 
-        if ((Context->Options & LZMA_UTIL_OPTION_VERBOSE) != 0) {
+        //
+        // Block streams don't have a single CRC covering all the data, each
+        // block is checked on its own.
+        //
+
+        if (((Context->Options & LZMA_UTIL_OPTION_VERBOSE) != 0) &&
+            (Context->BlockStream != FALSE)) {
+
+            fprintf(stderr,
+                    "%-15lld%-15lld%-7s%-10s%-10s%s\n",
+                    Lz->UncompressedSize,
+                    Lz->CompressedSize,
+                    RatioString,
+                    "-",
+                    "-",
+                    InputPath);
+
+        } else if ((Context->Options & LZMA_UTIL_OPTION_VERBOSE) != 0) {
             fprintf(stderr,
                     "%-15lld%-15lld%-7s%08x  %08x  %s\n",
                     Lz->UncompressedSize,
@@ -1024,6 +1273,573 @@ Return Value:
     return Status;
 }
 
+INT
+LzpUtilProcessBlocks (
+    PLZMA_UTIL Context,
+    LZMA_UTIL_ACTION Action
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses or decompresses a block stream, spreading the
+    blocks out across the requested number of threads. For decompression, the
+    magic value is assumed to have already been read.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Action - Supplies the action to perform.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    LZMA_UTIL_BATCH Batch;
+    PLZMA_UTIL_BLOCK Block;
+    UINTN BlockCount;
+    BOOL Finished;
+    ULONG Header[2];
+    UINTN Index;
+    PLZ_CONTEXT Lz;
+    LZ_STATUS LzStatus;
+    LZ_CONTEXT Scratch;
+    INT Status;
+    UINTN ThreadCount;
+    UINTN ThreadIndex;
+    pthread_t *Threads;
+    PSTR Verb;
+
+    Lz = &(Context->Lz);
+    Lz->CompressedCrc32 = 0;
+    Lz->UncompressedCrc32 = 0;
+    Lz->CompressedSize = 0;
+    Lz->UncompressedSize = 0;
+    ThreadCount = Context->ThreadCount;
+    memset(&Batch, 0, sizeof(LZMA_UTIL_BATCH));
+    Batch.Action = Action;
+    pthread_mutex_init(&(Batch.Lock), NULL);
+    Batch.Blocks = calloc(ThreadCount, sizeof(LZMA_UTIL_BLOCK));
+    Threads = malloc(ThreadCount * sizeof(pthread_t));
+    if ((Batch.Blocks == NULL) || (Threads == NULL)) {
+        Status = ENOMEM;
+        goto ProcessBlocksEnd;
+    }
+
+    //
+    // Get the library to build its shared CRC table now, before there are
+    // multiple threads racing to initialize it.
+    //
+
+    memset(&Scratch, 0, sizeof(LZ_CONTEXT));
+    Scratch.Reallocate = LzpUtilReallocate;
+    LzStatus = LzLzmaInitializeDecoder(&Scratch, NULL, FALSE);
+    if (LzStatus != LzSuccess) {
+        Status = ENOMEM;
+        goto ProcessBlocksEnd;
+    }
+
+    LzLzmaFinishDecode(&Scratch);
+
+    //
+    // Write out or read in the rest of the stream header. Each block is
+    // encoded with an end marker so it can be decoded without any outside
+    // help, and the dictionary never needs to be bigger than a block.
+    //
+
+    Status = 1;
+    if (Action == LzmaActionCompress) {
+        Verb = "encode";
+        Batch.BlockSize = Context->BlockSize;
+        Header[0] = LZMA_UTIL_BLOCK_MAGIC;
+        Header[1] = Batch.BlockSize;
+        if (LzpUtilWrite(Lz, Header, sizeof(Header)) != sizeof(Header)) {
+            fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+            goto ProcessBlocksEnd;
+        }
+
+        memcpy(&(Batch.Properties),
+               &(Context->EncoderProperties),
+               sizeof(LZMA_ENCODER_PROPERTIES));
+
+        Batch.Properties.EndMark = TRUE;
+        Batch.Properties.ReduceSize = Batch.BlockSize;
+
+    } else {
+        Verb = "decode";
+        if (LzpUtilReadFull(Lz, &(Batch.BlockSize), sizeof(ULONG)) !=
+            sizeof(ULONG)) {
+
+            fprintf(stderr,
+                    "Error: Failed to read header: %s.\n",
+                    LzpUtilGetErrorString(LzErrorInputEof));
+
+            goto ProcessBlocksEnd;
+        }
+
+        if ((Batch.BlockSize == 0) ||
+            (Batch.BlockSize > LZMA_UTIL_MAX_BLOCK_SIZE)) {
+
+            fprintf(stderr,
+                    "Error: Invalid block size: %s.\n",
+                    LzpUtilGetErrorString(LzErrorCorruptData));
+
+            goto ProcessBlocksEnd;
+        }
+    }
+
+    Lz->CompressedSize += sizeof(Header);
+
+    //
+    // Loop reading in a block for each thread, crunching them all in
+    // parallel, and then writing them out in order.
+    //
+
+    Finished = FALSE;
+    while (Finished == FALSE) {
+        BlockCount = 0;
+        while (BlockCount < ThreadCount) {
+            Block = &(Batch.Blocks[BlockCount]);
+            Status = LzpUtilReadBlock(Context, &Batch, Block);
+            if (Status != 0) {
+                goto ProcessBlocksEnd;
+            }
+
+            if (Block->InputSize == 0) {
+                Finished = TRUE;
+                break;
+            }
+
+            BlockCount += 1;
+        }
+
+        if (BlockCount == 0) {
+            break;
+        }
+
+        //
+        // This thread works on blocks too, so one fewer thread is needed. If
+        // a thread fails to start, the others just pick up its share.
+        //
+
+        Batch.BlockCount = BlockCount;
+        Batch.NextBlock = 0;
+        for (ThreadIndex = 0; ThreadIndex < BlockCount - 1; ThreadIndex += 1) {
+            Status = pthread_create(&(Threads[ThreadIndex]),
+                                    NULL,
+                                    LzpUtilBlockThread,
+                                    &Batch);
+
+            if (Status != 0) {
+                break;
+            }
+        }
+
+        LzpUtilBlockThread(&Batch);
+        for (Index = 0; Index < ThreadIndex; Index += 1) {
+            pthread_join(Threads[Index], NULL);
+        }
+
+        Status = 1;
+        for (Index = 0; Index < BlockCount; Index += 1) {
+            Block = &(Batch.Blocks[Index]);
+            if (Block->Status != LzStreamComplete) {
+                fprintf(stderr,
+                        "Error: Failed to %s block: %s.\n",
+                        Verb,
+                        LzpUtilGetErrorString(Block->Status));
+
+                goto ProcessBlocksEnd;
+            }
+
+            if (Action == LzmaActionCompress) {
+                Header[0] = Block->OutputSize;
+                Header[1] = Block->InputSize;
+                if (LzpUtilWrite(Lz, Header, sizeof(Header)) !=
+                    sizeof(Header)) {
+
+                    fprintf(stderr,
+                            "lzma: Write Error: %s\n",
+                            strerror(errno));
+
+                    goto ProcessBlocksEnd;
+                }
+
+                Lz->CompressedSize += sizeof(Header) + Block->OutputSize;
+                Lz->UncompressedSize += Block->InputSize;
+
+            } else {
+                Lz->CompressedSize += sizeof(Header) + Block->InputSize;
+                Lz->UncompressedSize += Block->OutputSize;
+            }
+
+            if (LzpUtilWrite(Lz, Block->Output, Block->OutputSize) !=
+                Block->OutputSize) {
+
+                fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+                goto ProcessBlocksEnd;
+            }
+        }
+    }
+
+    //
+    // Terminate the stream with an empty block.
+    //
+
+    if (Action == LzmaActionCompress) {
+        Header[0] = 0;
+        Header[1] = 0;
+        if (LzpUtilWrite(Lz, Header, sizeof(Header)) != sizeof(Header)) {
+            fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+            goto ProcessBlocksEnd;
+        }
+    }
+
+    Lz->CompressedSize += sizeof(Header);
+    Status = 0;
+
+ProcessBlocksEnd:
+    if (Batch.Blocks != NULL) {
+        for (Index = 0; Index < ThreadCount; Index += 1) {
+            Block = &(Batch.Blocks[Index]);
+            if (Block->Input != NULL) {
+                free(Block->Input);
+            }
+
+            if (Block->Output != NULL) {
+                free(Block->Output);
+            }
+        }
+
+        free(Batch.Blocks);
+    }
+
+    if (Threads != NULL) {
+        free(Threads);
+    }
+
+    pthread_mutex_destroy(&(Batch.Lock));
+    return Status;
+}
+
+INT
+LzpUtilReadBlock (
+    PLZMA_UTIL Context,
+    PLZMA_UTIL_BATCH Batch,
+    PLZMA_UTIL_BLOCK Block
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads in the next block of the input. When compressing this
+    is the next block size worth of raw data. When decompressing this is the
+    next compressed block.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Batch - Supplies a pointer to the batch the block belongs to.
+
+    Block - Supplies a pointer to the block to read into. On success, the
+        input size will be zero if the end of the input was reached.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN Capacity;
+    ULONG Header[2];
+    PLZ_CONTEXT Lz;
+    PVOID NewBuffer;
+    INTN Size;
+
+    Lz = &(Context->Lz);
+    Block->InputSize = 0;
+    Block->OutputSize = 0;
+    Block->ExpectedSize = 0;
+    Block->Status = LzSuccess;
+    if (Batch->Action == LzmaActionCompress) {
+        Capacity = Batch->BlockSize;
+
+    } else {
+        Size = LzpUtilReadFull(Lz, Header, sizeof(Header));
+        if (Size != sizeof(Header)) {
+            if (Size < 0) {
+                fprintf(stderr, "lzma: Read Error: %s\n", strerror(errno));
+
+            } else {
+                fprintf(stderr,
+                        "Error: Failed to read block: %s.\n",
+                        LzpUtilGetErrorString(LzErrorInputEof));
+            }
+
+            return 1;
+        }
+
+        if ((Header[0] == 0) && (Header[1] == 0)) {
+            return 0;
+        }
+
+        if ((Header[0] == 0) || (Header[1] == 0) ||
+            (Header[0] > LZMA_UTIL_COMPRESSED_BOUND(Batch->BlockSize)) ||
+            (Header[1] > Batch->BlockSize)) {
+
+            fprintf(stderr,
+                    "Error: Invalid block header: %s.\n",
+                    LzpUtilGetErrorString(LzErrorCorruptData));
+
+            return 1;
+        }
+
+        Capacity = Header[0];
+        Block->ExpectedSize = Header[1];
+    }
+
+    if (Block->InputCapacity < Capacity) {
+        NewBuffer = realloc(Block->Input, Capacity);
+        if (NewBuffer == NULL) {
+            fprintf(stderr, "lzma: Allocation failure.\n");
+            return ENOMEM;
+        }
+
+        Block->Input = NewBuffer;
+        Block->InputCapacity = Capacity;
+    }
+
+    Size = LzpUtilReadFull(Lz, Block->Input, Capacity);
+    if (Size < 0) {
+        fprintf(stderr, "lzma: Read Error: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if ((Batch->Action == LzmaActionDecompress) && (Size != Capacity)) {
+        fprintf(stderr,
+                "Error: Failed to read block: %s.\n",
+                LzpUtilGetErrorString(LzErrorInputEof));
+
+        return 1;
+    }
+
+    Block->InputSize = Size;
+    return 0;
+}
+
+PVOID
+LzpUtilBlockThread (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements a block worker thread. It compresses or
+    decompresses blocks from the batch until there are none left.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the batch.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PLZMA_UTIL_BATCH Batch;
+    PLZMA_UTIL_BLOCK Block;
+    UINTN Index;
+
+    Batch = Parameter;
+    while (TRUE) {
+        pthread_mutex_lock(&(Batch->Lock));
+        Index = Batch->NextBlock;
+        if (Index < Batch->BlockCount) {
+            Batch->NextBlock += 1;
+        }
+
+        pthread_mutex_unlock(&(Batch->Lock));
+        if (Index >= Batch->BlockCount) {
+            break;
+        }
+
+        Block = &(Batch->Blocks[Index]);
+        if (Batch->Action == LzmaActionCompress) {
+            Block->Status = LzpUtilEncodeBlock(Batch, Block);
+
+        } else {
+            Block->Status = LzpUtilDecodeBlock(Block);
+        }
+    }
+
+    return NULL;
+}
+
+LZ_STATUS
+LzpUtilEncodeBlock (
+    PLZMA_UTIL_BATCH Batch,
+    PLZMA_UTIL_BLOCK Block
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses a single block in memory.
+
+Arguments:
+
+    Batch - Supplies a pointer to the batch, which holds the encoder
+        properties.
+
+    Block - Supplies a pointer to the block to compress.
+
+Return Value:
+
+    LzStreamComplete on success.
+
+    Returns an LZ error status on failure.
+
+--*/
+
+{
+
+    UINTN Capacity;
+    LZ_CONTEXT Lz;
+    PVOID NewBuffer;
+    LZ_STATUS Status;
+
+    Capacity = LZMA_UTIL_COMPRESSED_BOUND(Block->InputSize);
+    if (Block->OutputCapacity < Capacity) {
+        NewBuffer = realloc(Block->Output, Capacity);
+        if (NewBuffer == NULL) {
+            return LzErrorMemory;
+        }
+
+        Block->Output = NewBuffer;
+        Block->OutputCapacity = Capacity;
+    }
+
+    memset(&Lz, 0, sizeof(LZ_CONTEXT));
+    Lz.Reallocate = LzpUtilReallocate;
+    Lz.Input = Block->Input;
+    Lz.InputSize = Block->InputSize;
+    Lz.Output = Block->Output;
+    Lz.OutputSize = Block->OutputCapacity;
+    Status = LzLzmaInitializeEncoder(&Lz, &(Batch->Properties), TRUE);
+    if (Status != LzSuccess) {
+        return Status;
+    }
+
+    //
+    // The whole block is handed over at once, so the encoder should finish
+    // in one shot. Finishing also tears down the encoder.
+    //
+
+    Status = LzLzmaEncode(&Lz, LzInputFinished);
+    if (Status == LzStreamComplete) {
+        Status = LzLzmaFinishEncode(&Lz);
+
+    } else {
+        LzLzmaFinishEncode(&Lz);
+        if (Status == LzSuccess) {
+            Status = LzErrorOutputEof;
+        }
+    }
+
+    Block->OutputSize = Block->OutputCapacity - Lz.OutputSize;
+    return Status;
+}
+
+LZ_STATUS
+LzpUtilDecodeBlock (
+    PLZMA_UTIL_BLOCK Block
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decompresses a single block in memory.
+
+Arguments:
+
+    Block - Supplies a pointer to the block to decompress.
+
+Return Value:
+
+    LzStreamComplete on success.
+
+    Returns an LZ error status on failure.
+
+--*/
+
+{
+
+    LZ_CONTEXT Lz;
+    PVOID NewBuffer;
+    LZ_STATUS Status;
+
+    if (Block->OutputCapacity < Block->ExpectedSize) {
+        NewBuffer = realloc(Block->Output, Block->ExpectedSize);
+        if (NewBuffer == NULL) {
+            return LzErrorMemory;
+        }
+
+        Block->Output = NewBuffer;
+        Block->OutputCapacity = Block->ExpectedSize;
+    }
+
+    memset(&Lz, 0, sizeof(LZ_CONTEXT));
+    Lz.Reallocate = LzpUtilReallocate;
+    Lz.Input = Block->Input;
+    Lz.InputSize = Block->InputSize;
+    Lz.Output = Block->Output;
+    Lz.OutputSize = Block->ExpectedSize;
+    Status = LzLzmaInitializeDecoder(&Lz, NULL, TRUE);
+    if (Status != LzSuccess) {
+        return Status;
+    }
+
+    //
+    // The block had better decode to exactly the size its header claims.
+    //
+
+    Status = LzLzmaDecode(&Lz, LzFlushNow);
+    LzLzmaFinishDecode(&Lz);
+    if (Status == LzSuccess) {
+        Status = LzErrorCorruptData;
+    }
+
+    Block->OutputSize = Block->ExpectedSize - Lz.OutputSize;
+    if ((Status == LzStreamComplete) &&
+        (Block->OutputSize != Block->ExpectedSize)) {
+
+        Status = LzErrorCorruptData;
+    }
+
+    return Status;
+}
+
 PVOID
 LzpUtilReallocate (
     PVOID Allocation,
@@ -1095,6 +1911,23 @@ Return Value:
 
     FILE *File;
     UINTN Result;
+    PLZMA_UTIL Util;
+
+    //
+    // Hand back any bytes that were peeked at first.
+    //
+
+    Util = Context->Context;
+    if (Util->PeekSize != 0) {
+        if (Size > Util->PeekSize) {
+            Size = Util->PeekSize;
+        }
+
+        memcpy(Buffer, Util->Peek, Size);
+        Util->PeekSize -= Size;
+        memmove(Util->Peek, Util->Peek + Size, Util->PeekSize);
+        return Size;
+    }
 
     File = Context->ReadContext;
     Result = fread(Buffer, 1, Size, File);
@@ -1107,6 +1940,59 @@ Return Value:
     return Result;
 }
 
+INTN
+LzpUtilReadFull (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads from the input until the given buffer is full or the
+    end of the input is reached.
+
+Arguments:
+
+    Context - Supplies a pointer to the LZ context.
+
+    Buffer - Supplies a pointer where the read data should be returned.
+
+    Size - Supplies the number of bytes to read.
+
+Return Value:
+
+    Returns the number of bytes read, which is only less than the requested
+    size at the end of the input.
+
+    -1 on I/O failure.
+
+--*/
+
+{
+
+    INTN Result;
+    UINTN Total;
+
+    Total = 0;
+    while (Total < Size) {
+        Result = LzpUtilRead(Context, (PUCHAR)Buffer + Total, Size - Total);
+        if (Result < 0) {
+            return -1;
+        }
+
+        if (Result == 0) {
+            break;
+        }
+
+        Total += Result;
+    }
+
+    return Total;
+}
+
 INTN
 LzpUtilWrite (
     PLZ_CONTEXT Context,
@@ -1210,6 +2096,64 @@ Return Value:
     return Result;
 }
 
+ULONG
+LzpUtilGetProcessorCount (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of processors in the machine, which is
+    used as the thread count if zero threads are requested.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of online processors, clipped to the maximum thread
+    count.
+
+--*/
+
+{
+
+    long Count;
+
+#if !defined(_SC_NPROCESSORS_ONLN)
+
+    PCSTR Variable;
+
+#endif
+
+    Count = 1;
+
+#if defined(_SC_NPROCESSORS_ONLN)
+
+    Count = sysconf(_SC_NPROCESSORS_ONLN);
+
+#else
+
+    Variable = getenv("NUMBER_OF_PROCESSORS");
+    if (Variable != NULL) {
+        Count = strtol(Variable, NULL, 10);
+    }
+
+#endif
+
+    if (Count < 1) {
+        Count = 1;
+
+    } else if (Count > LZMA_UTIL_MAX_THREADS) {
+        Count = LZMA_UTIL_MAX_THREADS;
+    }
+
+    return Count;
+}
+
 PCSTR
 LzpUtilGetErrorString (
     LZ_STATUS Status
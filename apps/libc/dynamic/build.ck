@@ -150,6 +150,7 @@ function build() {
         "realpath.c",
         "regexcmp.c",
         "regexexe.c",
+        "regexvm.c",
         "resolv.c",
         "resource.c",
         "scan.c",
@@ -189,12 +190,14 @@ function build() {
         "getopt.c",
         "qsort.c",
         "regexcmp.c",
-        "regexexe.c"
+        "regexexe.c",
+        "regexvm.c"
     ];
 
     wincsupSources = [
         "regexcmp.c",
         "regexexe.c",
+        "regexvm.c",
         "wincsup/strftime.c"
     ];
 
@@ -215,6 +218,7 @@ function build() {
             "x86/fenv.S",
             "x86/fenvc.c",
             "x86/setjmpa.S",
+            "x86/strsse2.c",
             "x86/tlsaddr.S"
         ];
 
@@ -226,6 +230,7 @@ function build() {
             "x64/setjmpa.S",
             "x64/tlsaddr.S",
             "x86/fenvc.c",
+            "x86/strsse2.c",
         ];
     }
 
@@ -451,6 +451,16 @@ Return Value:
         FileControlCommand = FileControlCommandCloseFrom;
         break;
 
+    case F_GETPIPE_SZ:
+        FileControlCommand = FileControlCommandGetPipeSize;
+        Parameters.PipeSize = 0;
+        break;
+
+    case F_SETPIPE_SZ:
+        FileControlCommand = FileControlCommandSetPipeSize;
+        Parameters.PipeSize = va_arg(ArgumentList, int);
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         goto fcntlEnd;
@@ -618,6 +628,11 @@ Return Value:
         ReturnValue = 0;
         break;
 
+    case F_GETPIPE_SZ:
+    case F_SETPIPE_SZ:
+        ReturnValue = Parameters.PipeSize;
+        break;
+
     default:
 
         assert(FALSE);
@@ -1112,6 +1127,106 @@ Return Value:
     return (ssize_t)BytesCompleted;
 }
 
+LIBC_API
+ssize_t
+copy_file_range (
+    int InputDescriptor,
+    off_t *InputOffset,
+    int OutputDescriptor,
+    off_t *OutputOffset,
+    size_t Length,
+    unsigned int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data between two open file descriptors without
+    passing it through the caller's memory. Both descriptors must refer to
+    regular files or block devices.
+
+Arguments:
+
+    InputDescriptor - Supplies the file descriptor to read from.
+
+    InputOffset - Supplies an optional pointer to the offset to read from. If
+        supplied, it is advanced by the number of bytes copied and the input
+        file position is not changed. If NULL, the current file position of
+        the input is used and updated.
+
+    OutputDescriptor - Supplies the file descriptor to write to.
+
+    OutputOffset - Supplies an optional pointer to the offset to write to,
+        with the same semantics as the input offset.
+
+    Length - Supplies the number of bytes to copy.
+
+    Flags - Supplies a bitfield of flags. No flags are defined, so this must
+        be zero.
+
+Return Value:
+
+    Returns the number of bytes copied, which may be less than requested. Zero
+    is returned at the end of the input.
+
+    -1 on failure, and errno will contain more information. EINVAL is
+    returned if either descriptor is not a regular file or block device, or if
+    the ranges overlap within the same file.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    IO_OFFSET Input;
+    IO_OFFSET Output;
+    KSTATUS Status;
+
+    if (Length > (size_t)SSIZE_MAX) {
+        Length = (size_t)SSIZE_MAX;
+    }
+
+    Input = IO_OFFSET_NONE;
+    if (InputOffset != NULL) {
+        Input = *InputOffset;
+    }
+
+    Output = IO_OFFSET_NONE;
+    if (OutputOffset != NULL) {
+        Output = *OutputOffset;
+    }
+
+    Status = OsCopyFileRange((HANDLE)(UINTN)InputDescriptor,
+                             Input,
+                             (HANDLE)(UINTN)OutputDescriptor,
+                             Output,
+                             Length,
+                             Flags,
+                             &BytesCompleted);
+
+    if (!KSUCCESS(Status)) {
+        if (Status == STATUS_NOT_SUPPORTED) {
+            errno = EINVAL;
+
+        } else {
+            errno = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        return -1;
+    }
+
+    if (InputOffset != NULL) {
+        *InputOffset += BytesCompleted;
+    }
+
+    if (OutputOffset != NULL) {
+        *OutputOffset += BytesCompleted;
+    }
+
+    return (ssize_t)BytesCompleted;
+}
+
 LIBC_API
 int
 fsync (
@@ -1251,12 +1366,20 @@ Routine Description:
 
         SEEK_END - The offset will be added to the end of the file.
 
+        SEEK_DATA - The file position will be set to the start of the next
+            region of data at or after the given offset.
+
+        SEEK_HOLE - The file position will be set to the start of the next
+            hole at or after the given offset. The end of the file is always
+            considered a hole.
+
 Return Value:
 
     Returns the resulting file offset after the operation.
 
     -1 on failure, and errno will contain more information. The file offset
-    will remain unchanged.
+    will remain unchanged. For SEEK_DATA and SEEK_HOLE, errno is ENXIO if the
+    offset is at or beyond the end of the file.
 
 --*/
 
@@ -1279,6 +1402,14 @@ Return Value:
         SeekCommand = SeekCommandFromEnd;
         break;
 
+    case SEEK_DATA:
+        SeekCommand = SeekCommandData;
+        break;
+
+    case SEEK_HOLE:
+        SeekCommand = SeekCommandHole;
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         goto lseekEnd;
@@ -1298,6 +1429,9 @@ Return Value:
         if (Status == STATUS_NOT_SUPPORTED) {
             errno = ESPIPE;
 
+        } else if (Status == STATUS_END_OF_FILE) {
+            errno = ENXIO;
+
         } else {
             errno = ClConvertKstatusToErrorNumber(Status);
         }
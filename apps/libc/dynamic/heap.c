@@ -13,7 +13,10 @@ Module Name:
 
 Abstract:
 
-    This module implements heap functionality for the C Library.
+    This module implements heap functionality for the C Library. Small
+    allocations are served from per-thread caches backed by a handful of
+    arenas, so that threads rarely contend on a lock. Large allocations go
+    directly to the system heap.
 
 Author:
 
@@ -40,18 +43,301 @@ Module Name:
 
 #define MALLOC_ALLOCATION_TAG 0x6C6C614D // 'llaM'
 
+//
+// Define the number of small size classes, and the largest block (including
+// its header) served from them. Larger allocations go directly to the heap.
+//
+
+#define MALLOC_CLASS_COUNT 20
+#define MALLOC_SMALL_BLOCK_MAX 1024
+
+//
+// Define the size of a span, the unit in which small blocks are carved out of
+// the shared heap.
+//
+
+#define MALLOC_SPAN_SIZE (32 * 1024)
+
+//
+// Define the number of arenas threads are spread across.
+//
+
+#define MALLOC_ARENA_COUNT 8
+
+//
+// Define the number of bytes worth of blocks moved between a thread cache and
+// its arena at once, and the limits on the resulting block count.
+//
+
+#define MALLOC_CACHE_BATCH_BYTES 4096
+#define MALLOC_CACHE_BATCH_MIN 4
+#define MALLOC_CACHE_BATCH_MAX 32
+
+//
+// Define the number of frees after which a thread returns unused cached
+// blocks to its arena.
+//
+
+#define MALLOC_TRIM_INTERVAL 4096
+
+#define MALLOC_HEADER_SIZE sizeof(MALLOC_HEADER)
+
+#define MALLOC_HEADER_FROM_MEMORY(_Memory) (((PMALLOC_HEADER)(_Memory)) - 1)
+#define MALLOC_MEMORY_FROM_HEADER(_Header) ((PVOID)((_Header) + 1))
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+typedef struct _MALLOC_SPAN MALLOC_SPAN, *PMALLOC_SPAN;
+
+/*++
+
+Structure Description:
+
+    This structure defines the header that precedes every allocation. Its
+    size keeps the allocation aligned to the heap alignment.
+
+Members:
+
+    Span - Stores a pointer to the span a small block was carved from, or
+        NULL for a large block allocated directly from the heap.
+
+    Link - Stores the next free block while a small block sits in a free
+        list. For large blocks, this stores the start of the underlying heap
+        allocation.
+
+--*/
+
+typedef struct _MALLOC_HEADER {
+    PMALLOC_SPAN Span;
+    PVOID Link;
+} MALLOC_HEADER, *PMALLOC_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure defines an arena, which owns the spans its threads carve
+    small blocks from.
+
+Members:
+
+    Lock - Stores the lock protecting the arena.
+
+    RemoteFrees - Stores the head of a lock-free list of blocks freed by
+        threads belonging to other arenas. These are returned to their spans
+        the next time the arena lock is held.
+
+    Spans - Stores the list heads, one per size class, of spans that have
+        blocks available.
+
+--*/
+
+typedef struct _MALLOC_ARENA {
+    OS_LOCK Lock;
+    PMALLOC_HEADER volatile RemoteFrees;
+    LIST_ENTRY Spans[MALLOC_CLASS_COUNT];
+} MALLOC_ARENA, *PMALLOC_ARENA;
+
+/*++
+
+Structure Description:
+
+    This structure defines a span, a chunk of the shared heap divided into
+    blocks of a single size class. The blocks follow this structure.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous spans in the arena
+        list for this size class. The next pointer is NULL if the span is not
+        on the list because it has no blocks available.
+
+    Arena - Stores a pointer to the arena that owns the span.
+
+    ClassIndex - Stores the size class of the blocks.
+
+    BlockSize - Stores the size of each block, including its header.
+
+    AllocatedCount - Stores the number of blocks handed out of the span to
+        thread caches or callers.
+
+    FreeList - Stores the list of blocks returned to the span.
+
+    Next - Stores a pointer to the first byte never carved into a block.
+
+    End - Stores a pointer to the end of the span.
+
+--*/
+
+struct _MALLOC_SPAN {
+    LIST_ENTRY ListEntry;
+    PMALLOC_ARENA Arena;
+    ULONG ClassIndex;
+    ULONG BlockSize;
+    ULONG AllocatedCount;
+    PMALLOC_HEADER FreeList;
+    PUCHAR Next;
+    PUCHAR End;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines the blocks of one size class cached by a thread.
+
+Members:
+
+    Head - Stores the list of cached blocks.
+
+    Count - Stores the number of cached blocks.
+
+    LowWater - Stores the lowest the count has been since the last trim.
+        Blocks below this mark went unused during the interval.
+
+--*/
+
+typedef struct _MALLOC_CACHE_BIN {
+    PMALLOC_HEADER Head;
+    ULONG Count;
+    ULONG LowWater;
+} MALLOC_CACHE_BIN, *PMALLOC_CACHE_BIN;
+
+/*++
+
+Structure Description:
+
+    This structure defines the per-thread cache of small blocks, which lets
+    most allocations and frees proceed without taking a lock.
+
+Members:
+
+    Arena - Stores a pointer to the arena assigned to the thread.
+
+    Operations - Stores the number of frees since the cache was last trimmed.
+
+    Disabled - Stores a boolean indicating that the thread is exiting and
+        blocks should go straight to the arena.
+
+    Bins - Stores the cached blocks for each size class.
+
+--*/
+
+typedef struct _MALLOC_THREAD_CACHE {
+    PMALLOC_ARENA Arena;
+    ULONG Operations;
+    BOOL Disabled;
+    MALLOC_CACHE_BIN Bins[MALLOC_CLASS_COUNT];
+} MALLOC_THREAD_CACHE, *PMALLOC_THREAD_CACHE;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+PVOID
+ClpHeapAllocate (
+    UINTN Size
+    );
+
+PVOID
+ClpHeapAllocateSmall (
+    ULONG ClassIndex
+    );
+
+VOID
+ClpHeapFreeSmall (
+    PMALLOC_HEADER Header
+    );
+
+PMALLOC_HEADER
+ClpHeapRefillCache (
+    PMALLOC_THREAD_CACHE Cache,
+    ULONG ClassIndex
+    );
+
+VOID
+ClpHeapReleaseBlocks (
+    PMALLOC_THREAD_CACHE Cache,
+    ULONG ClassIndex,
+    ULONG Count
+    );
+
+VOID
+ClpHeapTrimCache (
+    PMALLOC_THREAD_CACHE Cache,
+    BOOL Flush
+    );
+
+PMALLOC_ARENA
+ClpHeapGetArena (
+    PMALLOC_THREAD_CACHE Cache
+    );
+
+VOID
+ClpHeapAcquireArena (
+    PMALLOC_ARENA Arena
+    );
+
+ULONG
+ClpHeapGetArenaBlocks (
+    PMALLOC_ARENA Arena,
+    ULONG ClassIndex,
+    ULONG Count,
+    PMALLOC_HEADER *List
+    );
+
+VOID
+ClpHeapReturnBlock (
+    PMALLOC_ARENA Arena,
+    PMALLOC_HEADER Header
+    );
+
+VOID
+ClpHeapDrainRemoteFrees (
+    PMALLOC_ARENA Arena
+    );
+
+ULONG
+ClpHeapGetClass (
+    UINTN BlockSize
+    );
+
+ULONG
+ClpHeapGetBatchSize (
+    ULONG ClassIndex
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
 
+//
+// Store the block size of each small size class. These go up by 16 bytes to
+// 128, and then by quarter powers of two.
+//
+
+const USHORT ClMallocClassSizes[MALLOC_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024
+};
+
+//
+// Store the arenas, and the counter used to assign them to threads round
+// robin.
+//
+
+MALLOC_ARENA ClMallocArenas[MALLOC_ARENA_COUNT];
+ULONG ClMallocNextArena;
+
+//
+// Store the current thread's cache.
+//
+
+__THREAD MALLOC_THREAD_CACHE ClMallocCache;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -80,11 +366,20 @@ Return Value:
 
 {
 
+    PMALLOC_HEADER Header;
+
     if (Memory == NULL) {
         return;
     }
 
-    OsHeapFree(Memory);
+    Header = MALLOC_HEADER_FROM_MEMORY(Memory);
+    if (Header->Span == NULL) {
+        OsHeapFree(Header->Link);
+
+    } else {
+        ClpHeapFreeSmall(Header);
+    }
+
     return;
 }
 
@@ -118,7 +413,7 @@ Return Value:
         AllocationSize = 1;
     }
 
-    return OsHeapAllocate(AllocationSize, MALLOC_ALLOCATION_TAG);
+    return ClpHeapAllocate(AllocationSize);
 }
 
 LIBC_API
@@ -154,20 +449,83 @@ Return Value:
 
 {
 
+    PMALLOC_HEADER Header;
     void *NewBuffer;
+    PMALLOC_HEADER NewHeader;
+    UINTN OldSize;
 
-    if ((Allocation == NULL) && (AllocationSize == 0)) {
-        AllocationSize = 1;
+    if (Allocation == NULL) {
+        if (AllocationSize == 0) {
+            AllocationSize = 1;
+        }
+
+        NewBuffer = ClpHeapAllocate(AllocationSize);
+        if (NewBuffer == NULL) {
+            errno = ENOMEM;
+        }
+
+        return NewBuffer;
+    }
+
+    if (AllocationSize == 0) {
+        free(Allocation);
+        return NULL;
     }
 
-    NewBuffer = OsHeapReallocate(Allocation,
-                                 AllocationSize,
-                                 MALLOC_ALLOCATION_TAG);
+    //
+    // Small blocks can grow in place up to the size of their class.
+    //
+
+    Header = MALLOC_HEADER_FROM_MEMORY(Allocation);
+    if (Header->Span != NULL) {
+        OldSize = Header->Span->BlockSize - MALLOC_HEADER_SIZE;
+        if (AllocationSize <= OldSize) {
+            return Allocation;
+        }
+
+    //
+    // Large blocks that were not aligned are resized by the heap directly.
+    //
+
+    } else if (Header->Link == Header) {
+        if (AllocationSize > MAX_UINTN - MALLOC_HEADER_SIZE) {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        NewHeader = OsHeapReallocate(Header,
+                                     AllocationSize + MALLOC_HEADER_SIZE,
+                                     MALLOC_ALLOCATION_TAG);
+
+        if (NewHeader == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        NewHeader->Link = NewHeader;
+        return MALLOC_MEMORY_FROM_HEADER(NewHeader);
+
+    //
+    // Aligned allocations record their size at the start of the underlying
+    // heap allocation.
+    //
+
+    } else {
+        OldSize = *((PUINTN)(Header->Link));
+    }
 
-    if ((NewBuffer == NULL) && (AllocationSize != 0)) {
+    NewBuffer = ClpHeapAllocate(AllocationSize);
+    if (NewBuffer == NULL) {
         errno = ENOMEM;
+        return NULL;
+    }
+
+    if (OldSize > AllocationSize) {
+        OldSize = AllocationSize;
     }
 
+    memcpy(NewBuffer, Allocation, OldSize);
+    free(Allocation);
     return NewBuffer;
 }
 
@@ -216,7 +574,7 @@ Return Value:
         TotalSize = 1;
     }
 
-    NewBuffer = OsHeapAllocate(TotalSize, MALLOC_ALLOCATION_TAG);
+    NewBuffer = ClpHeapAllocate(TotalSize);
     if (NewBuffer == NULL) {
         errno = ENOMEM;
         return NULL;
@@ -260,6 +618,8 @@ Return Value:
 
 {
 
+    PVOID Allocation;
+    PMALLOC_HEADER Header;
     KSTATUS Status;
 
     if ((IS_ALIGNED(AllocationAlignment, sizeof(void *)) == FALSE) ||
@@ -269,15 +629,759 @@ Return Value:
         return EINVAL;
     }
 
-    Status = OsHeapAlignedAllocate(AllocationPointer,
+    //
+    // Every allocation is already aligned to the header size.
+    //
+
+    if (AllocationAlignment <= MALLOC_HEADER_SIZE) {
+        if (AllocationSize == 0) {
+            AllocationSize = 1;
+        }
+
+        Allocation = ClpHeapAllocate(AllocationSize);
+        if (Allocation == NULL) {
+            return ENOMEM;
+        }
+
+        *AllocationPointer = Allocation;
+        return 0;
+    }
+
+    //
+    // Allocate an extra alignment's worth so that the header fits before the
+    // aligned buffer, with room to spare at the start to record the size.
+    //
+
+    if (AllocationSize > MAX_UINTN - AllocationAlignment) {
+        return ENOMEM;
+    }
+
+    Status = OsHeapAlignedAllocate(&Allocation,
                                    AllocationAlignment,
-                                   AllocationSize,
+                                   AllocationSize + AllocationAlignment,
                                    MALLOC_ALLOCATION_TAG);
 
-    return ClConvertKstatusToErrorNumber(Status);
+    if (!KSUCCESS(Status)) {
+        return ClConvertKstatusToErrorNumber(Status);
+    }
+
+    *((PUINTN)Allocation) = AllocationSize;
+    Header = MALLOC_HEADER_FROM_MEMORY(Allocation + AllocationAlignment);
+    Header->Span = NULL;
+    Header->Link = Allocation;
+    *AllocationPointer = MALLOC_MEMORY_FROM_HEADER(Header);
+    return 0;
+}
+
+VOID
+ClpFlushThreadHeapCache (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns every block cached by the current thread to its
+    arena. It is called when a thread exits. Blocks allocated or freed by the
+    thread after this point bypass the cache.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PMALLOC_THREAD_CACHE Cache;
+
+    Cache = &ClMallocCache;
+    ClpHeapTrimCache(Cache, TRUE);
+    Cache->Disabled = TRUE;
+    return;
 }
 
 //
 // --------------------------------------------------------- Internal Functions
 //
 
+PVOID
+ClpHeapAllocate (
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates memory, either from the thread cache for small
+    sizes or directly from the heap for large sizes.
+
+Arguments:
+
+    Size - Supplies the required allocation size in bytes. This must not be
+        zero.
+
+Return Value:
+
+    Returns a pointer to the allocated memory on success.
+
+    NULL on failure.
+
+--*/
+
+{
+
+    PMALLOC_HEADER Header;
+
+    if (Size <= MALLOC_SMALL_BLOCK_MAX - MALLOC_HEADER_SIZE) {
+        return ClpHeapAllocateSmall(ClpHeapGetClass(Size + MALLOC_HEADER_SIZE));
+    }
+
+    if (Size > MAX_UINTN - MALLOC_HEADER_SIZE) {
+        return NULL;
+    }
+
+    Header = OsHeapAllocate(Size + MALLOC_HEADER_SIZE, MALLOC_ALLOCATION_TAG);
+    if (Header == NULL) {
+        return NULL;
+    }
+
+    Header->Span = NULL;
+    Header->Link = Header;
+    return MALLOC_MEMORY_FROM_HEADER(Header);
+}
+
+PVOID
+ClpHeapAllocateSmall (
+    ULONG ClassIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a small block, refilling the thread cache from its
+    arena if the cache is empty.
+
+Arguments:
+
+    ClassIndex - Supplies the size class to allocate from.
+
+Return Value:
+
+    Returns a pointer to the allocated memory on success.
+
+    NULL on failure.
+
+--*/
+
+{
+
+    PMALLOC_CACHE_BIN Bin;
+    PMALLOC_THREAD_CACHE Cache;
+    PMALLOC_HEADER Header;
+
+    Cache = &ClMallocCache;
+    Bin = &(Cache->Bins[ClassIndex]);
+    Header = Bin->Head;
+    if (Header == NULL) {
+        Header = ClpHeapRefillCache(Cache, ClassIndex);
+        if (Header == NULL) {
+            return NULL;
+        }
+
+    } else {
+        Bin->Head = Header->Link;
+        Bin->Count -= 1;
+        if (Bin->Count < Bin->LowWater) {
+            Bin->LowWater = Bin->Count;
+        }
+    }
+
+    return MALLOC_MEMORY_FROM_HEADER(Header);
+}
+
+VOID
+ClpHeapFreeSmall (
+    PMALLOC_HEADER Header
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees a small block. Blocks belonging to the thread's arena
+    go into the thread cache, others are queued back to their own arena.
+
+Arguments:
+
+    Header - Supplies a pointer to the header of the block to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PMALLOC_ARENA Arena;
+    ULONG BatchSize;
+    PMALLOC_CACHE_BIN Bin;
+    PMALLOC_THREAD_CACHE Cache;
+    PMALLOC_HEADER Head;
+    PMALLOC_HEADER OriginalHead;
+    PMALLOC_SPAN Span;
+
+    Span = Header->Span;
+    Cache = &ClMallocCache;
+    Arena = ClpHeapGetArena(Cache);
+    if (Span->Arena != Arena) {
+        Arena = Span->Arena;
+        do {
+            Head = Arena->RemoteFrees;
+            Header->Link = Head;
+            OriginalHead = (PMALLOC_HEADER)(UINTN)RtlAtomicCompareExchange(
+                                                   &(Arena->RemoteFrees),
+                                                   (UINTN)Header,
+                                                   (UINTN)Head);
+
+        } while (OriginalHead != Head);
+
+        return;
+    }
+
+    if (Cache->Disabled != FALSE) {
+        ClpHeapAcquireArena(Arena);
+        ClpHeapReturnBlock(Arena, Header);
+        OsReleaseLock(&(Arena->Lock));
+        return;
+    }
+
+    Bin = &(Cache->Bins[Span->ClassIndex]);
+    Header->Link = Bin->Head;
+    Bin->Head = Header;
+    Bin->Count += 1;
+    BatchSize = ClpHeapGetBatchSize(Span->ClassIndex);
+    if (Bin->Count > (BatchSize * 2)) {
+        ClpHeapReleaseBlocks(Cache, Span->ClassIndex, BatchSize);
+    }
+
+    Cache->Operations += 1;
+    if (Cache->Operations >= MALLOC_TRIM_INTERVAL) {
+        Cache->Operations = 0;
+        ClpHeapTrimCache(Cache, FALSE);
+    }
+
+    return;
+}
+
+PMALLOC_HEADER
+ClpHeapRefillCache (
+    PMALLOC_THREAD_CACHE Cache,
+    ULONG ClassIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine refills an empty thread cache bin from the thread's arena.
+
+Arguments:
+
+    Cache - Supplies a pointer to the current thread's cache.
+
+    ClassIndex - Supplies the size class to refill.
+
+Return Value:
+
+    Returns a pointer to a block for the caller to use. The remaining blocks
+    obtained are placed in the cache.
+
+    NULL if no memory could be obtained.
+
+--*/
+
+{
+
+    PMALLOC_ARENA Arena;
+    PMALLOC_CACHE_BIN Bin;
+    ULONG Count;
+    PMALLOC_HEADER Header;
+
+    Arena = ClpHeapGetArena(Cache);
+    Count = 1;
+    if (Cache->Disabled == FALSE) {
+        Count = ClpHeapGetBatchSize(ClassIndex);
+    }
+
+    ClpHeapAcquireArena(Arena);
+    ClpHeapDrainRemoteFrees(Arena);
+    Count = ClpHeapGetArenaBlocks(Arena, ClassIndex, Count, &Header);
+    OsReleaseLock(&(Arena->Lock));
+    if (Count == 0) {
+        return NULL;
+    }
+
+    Bin = &(Cache->Bins[ClassIndex]);
+
+    ASSERT(Bin->Count == 0);
+
+    Bin->Head = Header->Link;
+    Bin->Count = Count - 1;
+    return Header;
+}
+
+VOID
+ClpHeapReleaseBlocks (
+    PMALLOC_THREAD_CACHE Cache,
+    ULONG ClassIndex,
+    ULONG Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns blocks from a thread cache bin to the arena.
+
+Arguments:
+
+    Cache - Supplies a pointer to the current thread's cache.
+
+    ClassIndex - Supplies the size class whose blocks should be released.
+
+    Count - Supplies the number of blocks to release.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PMALLOC_ARENA Arena;
+    PMALLOC_CACHE_BIN Bin;
+    PMALLOC_HEADER Header;
+
+    Bin = &(Cache->Bins[ClassIndex]);
+    if (Count > Bin->Count) {
+        Count = Bin->Count;
+    }
+
+    if (Count == 0) {
+        return;
+    }
+
+    Arena = ClpHeapGetArena(Cache);
+    ClpHeapAcquireArena(Arena);
+    ClpHeapDrainRemoteFrees(Arena);
+    Bin->Count -= Count;
+    while (Count != 0) {
+        Header = Bin->Head;
+        Bin->Head = Header->Link;
+        ClpHeapReturnBlock(Arena, Header);
+        Count -= 1;
+    }
+
+    OsReleaseLock(&(Arena->Lock));
+    if (Bin->Count < Bin->LowWater) {
+        Bin->LowWater = Bin->Count;
+    }
+
+    return;
+}
+
+VOID
+ClpHeapTrimCache (
+    PMALLOC_THREAD_CACHE Cache,
+    BOOL Flush
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns cached blocks that went unused since the last trim
+    to the arena, which in turn hands empty spans back to the shared heap.
+
+Arguments:
+
+    Cache - Supplies a pointer to the current thread's cache.
+
+    Flush - Supplies a boolean indicating whether to return every cached
+        block rather than just the unused ones.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PMALLOC_CACHE_BIN Bin;
+    ULONG ClassIndex;
+    ULONG Count;
+
+    for (ClassIndex = 0; ClassIndex < MALLOC_CLASS_COUNT; ClassIndex += 1) {
+        Bin = &(Cache->Bins[ClassIndex]);
+        if (Flush != FALSE) {
+            Count = Bin->Count;
+
+        } else {
+            Count = (Bin->LowWater + 1) / 2;
+        }
+
+        ClpHeapReleaseBlocks(Cache, ClassIndex, Count);
+        Bin->LowWater = Bin->Count;
+    }
+
+    return;
+}
+
+PMALLOC_ARENA
+ClpHeapGetArena (
+    PMALLOC_THREAD_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the arena of the current thread, assigning one if
+    the thread has not allocated before.
+
+Arguments:
+
+    Cache - Supplies a pointer to the current thread's cache.
+
+Return Value:
+
+    Returns a pointer to the thread's arena.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    if (Cache->Arena == NULL) {
+        Index = RtlAtomicAdd32(&ClMallocNextArena, 1) % MALLOC_ARENA_COUNT;
+        Cache->Arena = &(ClMallocArenas[Index]);
+    }
+
+    return Cache->Arena;
+}
+
+VOID
+ClpHeapAcquireArena (
+    PMALLOC_ARENA Arena
+    )
+
+/*++
+
+Routine Description:
+
+    This routine acquires an arena's lock, initializing the arena the first
+    time through.
+
+Arguments:
+
+    Arena - Supplies a pointer to the arena to acquire.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG ClassIndex;
+
+    OsAcquireLock(&(Arena->Lock));
+    if (Arena->Spans[0].Next == NULL) {
+        Arena->Lock.SpinCount = OS_LOCK_DEFAULT_SPIN_COUNT;
+        for (ClassIndex = 0; ClassIndex < MALLOC_CLASS_COUNT; ClassIndex += 1) {
+            INITIALIZE_LIST_HEAD(&(Arena->Spans[ClassIndex]));
+        }
+    }
+
+    return;
+}
+
+ULONG
+ClpHeapGetArenaBlocks (
+    PMALLOC_ARENA Arena,
+    ULONG ClassIndex,
+    ULONG Count,
+    PMALLOC_HEADER *List
+    )
+
+/*++
+
+Routine Description:
+
+    This routine takes blocks from an arena's spans, carving a new span out
+    of the shared heap if needed. The arena lock must be held.
+
+Arguments:
+
+    Arena - Supplies a pointer to the arena.
+
+    ClassIndex - Supplies the size class of the blocks.
+
+    Count - Supplies the desired number of blocks.
+
+    List - Supplies a pointer where the list of blocks obtained is returned.
+
+Return Value:
+
+    Returns the number of blocks obtained, which is only less than the count
+    requested if the heap is out of memory.
+
+--*/
+
+{
+
+    PMALLOC_HEADER Header;
+    PLIST_ENTRY ListHead;
+    ULONG Obtained;
+    PMALLOC_SPAN Span;
+
+    *List = NULL;
+    ListHead = &(Arena->Spans[ClassIndex]);
+    Obtained = 0;
+    while (Obtained < Count) {
+        if (LIST_EMPTY(ListHead) != FALSE) {
+            Span = OsHeapAllocate(MALLOC_SPAN_SIZE, MALLOC_ALLOCATION_TAG);
+            if (Span == NULL) {
+                break;
+            }
+
+            Span->Arena = Arena;
+            Span->ClassIndex = ClassIndex;
+            Span->BlockSize = ClMallocClassSizes[ClassIndex];
+            Span->AllocatedCount = 0;
+            Span->FreeList = NULL;
+            Span->Next = (PUCHAR)Span +
+                         ALIGN_RANGE_UP(sizeof(MALLOC_SPAN),
+                                        MALLOC_HEADER_SIZE);
+
+            Span->End = (PUCHAR)Span + MALLOC_SPAN_SIZE;
+            INSERT_AFTER(&(Span->ListEntry), ListHead);
+        }
+
+        Span = LIST_VALUE(ListHead->Next, MALLOC_SPAN, ListEntry);
+        while ((Obtained < Count) && (Span->FreeList != NULL)) {
+            Header = Span->FreeList;
+            Span->FreeList = Header->Link;
+            Header->Link = *List;
+            *List = Header;
+            Span->AllocatedCount += 1;
+            Obtained += 1;
+        }
+
+        while ((Obtained < Count) &&
+               ((UINTN)(Span->End - Span->Next) >= Span->BlockSize)) {
+
+            Header = (PMALLOC_HEADER)(Span->Next);
+            Span->Next += Span->BlockSize;
+            Header->Span = Span;
+            Header->Link = *List;
+            *List = Header;
+            Span->AllocatedCount += 1;
+            Obtained += 1;
+        }
+
+        if ((Span->FreeList == NULL) &&
+            ((UINTN)(Span->End - Span->Next) < Span->BlockSize)) {
+
+            LIST_REMOVE(&(Span->ListEntry));
+            Span->ListEntry.Next = NULL;
+        }
+    }
+
+    return Obtained;
+}
+
+VOID
+ClpHeapReturnBlock (
+    PMALLOC_ARENA Arena,
+    PMALLOC_HEADER Header
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a block to its span. If that leaves the span empty
+    and the arena has other spans of the class available, the span is freed
+    back to the shared heap. The arena lock must be held.
+
+Arguments:
+
+    Arena - Supplies a pointer to the arena that owns the block.
+
+    Header - Supplies a pointer to the header of the block.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLIST_ENTRY ListHead;
+    PMALLOC_SPAN Span;
+
+    Span = Header->Span;
+
+    ASSERT((Span->Arena == Arena) && (Span->AllocatedCount != 0));
+
+    Header->Link = Span->FreeList;
+    Span->FreeList = Header;
+    Span->AllocatedCount -= 1;
+    ListHead = &(Arena->Spans[Span->ClassIndex]);
+    if (Span->ListEntry.Next == NULL) {
+        INSERT_AFTER(&(Span->ListEntry), ListHead);
+    }
+
+    if ((Span->AllocatedCount == 0) && (ListHead->Next != ListHead->Previous)) {
+        LIST_REMOVE(&(Span->ListEntry));
+        OsHeapFree(Span);
+    }
+
+    return;
+}
+
+VOID
+ClpHeapDrainRemoteFrees (
+    PMALLOC_ARENA Arena
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the blocks other threads have freed to the arena.
+    The arena lock must be held.
+
+Arguments:
+
+    Arena - Supplies a pointer to the arena.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PMALLOC_HEADER Header;
+    PMALLOC_HEADER Next;
+
+    if (Arena->RemoteFrees == NULL) {
+        return;
+    }
+
+    Header = (PMALLOC_HEADER)(UINTN)RtlAtomicExchange(&(Arena->RemoteFrees),
+                                                      (UINTN)NULL);
+
+    while (Header != NULL) {
+        Next = Header->Link;
+        ClpHeapReturnBlock(Arena, Header);
+        Header = Next;
+    }
+
+    return;
+}
+
+ULONG
+ClpHeapGetClass (
+    UINTN BlockSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the smallest size class that fits the given block.
+
+Arguments:
+
+    BlockSize - Supplies the size of the block, including its header. This
+        must be between 1 and MALLOC_SMALL_BLOCK_MAX.
+
+Return Value:
+
+    Returns the size class index.
+
+--*/
+
+{
+
+    ULONG Shift;
+
+    ASSERT((BlockSize != 0) && (BlockSize <= MALLOC_SMALL_BLOCK_MAX));
+
+    if (BlockSize <= 128) {
+        return (BlockSize - 1) >> 4;
+    }
+
+    //
+    // Above 128 there are four classes per power of two.
+    //
+
+    Shift = 31 - RtlCountLeadingZeros32(BlockSize - 1);
+    return 8 + ((Shift - 7) * 4) + (((BlockSize - 1) >> (Shift - 2)) & 0x3);
+}
+
+ULONG
+ClpHeapGetBatchSize (
+    ULONG ClassIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of blocks moved at once between a thread
+    cache and its arena for the given size class.
+
+Arguments:
+
+    ClassIndex - Supplies the size class index.
+
+Return Value:
+
+    Returns the batch size.
+
+--*/
+
+{
+
+    ULONG Count;
+
+    Count = MALLOC_CACHE_BATCH_BYTES / ClMallocClassSizes[ClassIndex];
+    if (Count < MALLOC_CACHE_BATCH_MIN) {
+        Count = MALLOC_CACHE_BATCH_MIN;
+
+    } else if (Count > MALLOC_CACHE_BATCH_MAX) {
+        Count = MALLOC_CACHE_BATCH_MAX;
+    }
+
+    return Count;
+}
+
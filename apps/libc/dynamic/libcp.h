@@ -207,6 +207,140 @@ typedef struct _CL_TYPE_CONVERSION_INTERFACE {
 
 } CL_TYPE_CONVERSION_INTERFACE, *PCL_TYPE_CONVERSION_INTERFACE;
 
+typedef
+void *
+(*PCL_MEMORY_FIND_ROUTINE) (
+    const void *Buffer,
+    int Character,
+    size_t Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine locates the first occurrence of the given character within
+    the given buffer, as memchr does.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer of characters.
+
+    Character - Supplies the character (converted to an unsigned char) to
+        locate.
+
+    Size - Supplies the size of the buffer.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+typedef
+int
+(*PCL_MEMORY_COMPARE_ROUTINE) (
+    const void *Left,
+    const void *Right,
+    size_t Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine compares two buffers byte for byte, as memcmp does.
+
+Arguments:
+
+    Left - Supplies the first buffer to compare.
+
+    Right - Supplies the second buffer to compare.
+
+    Size - Supplies the number of bytes to compare.
+
+Return Value:
+
+    Returns the difference between the first differing bytes, or 0 if the
+    buffers are equal.
+
+--*/
+
+typedef
+size_t
+(*PCL_STRING_LENGTH_ROUTINE) (
+    const char *String
+    );
+
+/*++
+
+Routine Description:
+
+    This routine computes the length of the given string, as strlen does.
+
+Arguments:
+
+    String - Supplies a pointer to the string.
+
+Return Value:
+
+    Returns the length of the string, not including the null terminator.
+
+--*/
+
+typedef
+char *
+(*PCL_STRING_FIND_ROUTINE) (
+    const char *String,
+    int Character
+    );
+
+/*++
+
+Routine Description:
+
+    This routine finds the first instance of the given character in the given
+    string, as strchr does.
+
+Arguments:
+
+    String - Supplies a pointer to the string to search.
+
+    Character - Supplies the character to search for.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+/*++
+
+Structure Description:
+
+    This structure defines the set of string routines that have processor
+    specific implementations. The best implementation for the processor is
+    selected when the library initializes.
+
+Members:
+
+    MemoryFind - Stores a pointer to the memchr implementation.
+
+    MemoryCompare - Stores a pointer to the memcmp implementation.
+
+    StringLength - Stores a pointer to the strlen implementation.
+
+    StringFind - Stores a pointer to the strchr implementation.
+
+--*/
+
+typedef struct _CL_STRING_ROUTINES {
+    PCL_MEMORY_FIND_ROUTINE MemoryFind;
+    PCL_MEMORY_COMPARE_ROUTINE MemoryCompare;
+    PCL_STRING_LENGTH_ROUTINE StringLength;
+    PCL_STRING_FIND_ROUTINE StringFind;
+} CL_STRING_ROUTINES, *PCL_STRING_ROUTINES;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -219,6 +353,19 @@ typedef struct _CL_TYPE_CONVERSION_INTERFACE {
 LIST_ENTRY ClTypeConversionInterfaceList;
 pthread_mutex_t ClTypeConversionInterfaceLock;
 
+//
+// Store the string routines selected for this processor.
+//
+
+extern CL_STRING_ROUTINES ClStringRoutines;
+
+//
+// Store a boolean indicating whether the process has ever created a second
+// thread. Until it does, internal stream locking is skipped.
+//
+
+extern BOOL ClProcessMultithreaded;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -403,6 +550,152 @@ Return Value:
 
 --*/
 
+VOID
+ClpInitializeStringRoutines (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects the fastest string routine implementations the
+    processor supports.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+void *
+ClpMemoryFindSse2 (
+    const void *Buffer,
+    int Character,
+    size_t Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements memchr using SSE2 instructions.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer of characters.
+
+    Character - Supplies the character (converted to an unsigned char) to
+        locate.
+
+    Size - Supplies the size of the buffer.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+int
+ClpMemoryCompareSse2 (
+    const void *Left,
+    const void *Right,
+    size_t Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements memcmp using SSE2 instructions.
+
+Arguments:
+
+    Left - Supplies the first buffer to compare.
+
+    Right - Supplies the second buffer to compare.
+
+    Size - Supplies the number of bytes to compare.
+
+Return Value:
+
+    Returns the difference between the first differing bytes, or 0 if the
+    buffers are equal.
+
+--*/
+
+size_t
+ClpStringLengthSse2 (
+    const char *String
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements strlen using SSE2 instructions.
+
+Arguments:
+
+    String - Supplies a pointer to the string.
+
+Return Value:
+
+    Returns the length of the string, not including the null terminator.
+
+--*/
+
+char *
+ClpStringFindSse2 (
+    const char *String,
+    int Character
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements strchr using SSE2 instructions.
+
+Arguments:
+
+    String - Supplies a pointer to the string to search.
+
+    Character - Supplies the character to search for.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+VOID
+ClpFlushThreadHeapCache (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns every block cached by the current thread to its
+    arena. It is called when a thread exits. Blocks allocated or freed by the
+    thread after this point bypass the cache.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 ClpInitializeTimeZoneSupport (
     VOID
@@ -39,6 +39,22 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the number of words above the frame pointer of vfork that belong to
+// its frame: the saved frame pointer and the return address. In ARM mode, the
+// frame pointer points at the saved link register instead.
+//
+
+#if defined(__arm__) && !defined(__thumb__)
+
+#define VFORK_FRAME_WORDS 1
+
+#else
+
+#define VFORK_FRAME_WORDS 2
+
+#endif
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -416,6 +432,59 @@ Return Value:
     return -1;
 }
 
+LIBC_API
+pid_t
+vfork (
+    void
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new process that shares the address space of the
+    calling process. The calling thread is suspended until the child calls
+    one of the exec functions or _exit. The child must not return from the
+    function that called vfork, and must not modify any data other than a
+    variable of type pid_t used to store the return value. At-fork handlers
+    are not run.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns 0 to the child process.
+
+    Returns the process ID of the child process to the parent process.
+
+    Returns -1 to the parent process on error, and the errno variable will be
+    set to provide more information about the error.
+
+--*/
+
+{
+
+    PVOID FrameRestoreBase;
+    INTN Result;
+
+    //
+    // The child returns through this frame and then reuses the stack below
+    // the caller. Have the kernel preserve everything from the system call
+    // up through this routine's return address so the parent can return too.
+    //
+
+    FrameRestoreBase = (PVOID *)__builtin_frame_address(0) + VFORK_FRAME_WORDS;
+    Result = OsForkProcess(FORK_FLAG_VFORK, FrameRestoreBase);
+    if (Result >= 0) {
+        return Result;
+    }
+
+    errno = ClConvertKstatusToErrorNumber(Result);
+    return -1;
+}
+
 LIBC_API
 uid_t
 getuid (
@@ -136,6 +136,13 @@ __THREAD PPTHREAD ClCurrentThread;
 
 __THREAD LIST_ENTRY ClThreadDestructors;
 
+//
+// Store whether any thread has been created besides the main thread. This
+// never goes back to FALSE, even when the other threads exit.
+//
+
+BOOL ClProcessMultithreaded;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -247,6 +254,14 @@ Return Value:
     pthread_self();
     pthread_mutex_lock(&(NewThread->StartMutex));
 
+    //
+    // Turn on stream locking before the second thread exists. The creating
+    // thread can't be in the middle of a stream operation, so no elided lock
+    // is outstanding.
+    //
+
+    ClProcessMultithreaded = TRUE;
+
     //
     // Block all possible signals in the new thread while it sets itself up,
     // including the internal signals.
@@ -547,6 +562,7 @@ Return Value:
     //
 
     ClpDestroyThreadKeyData(Thread);
+    ClpFlushThreadHeapCache();
     DestroyRegion = NULL;
     DestroyRegionSize = 0;
 
@@ -13,7 +13,11 @@ Module Name:
 
 Abstract:
 
-    This module implements the QuickSort standard C library function.
+    This module implements the QuickSort standard C library function. The
+    sort is a pattern-defeating quicksort: a quicksort that falls back to
+    insertion sort for small partitions, shuffles elements when it sees
+    repeated bad partitions, and bails out to heapsort if that keeps
+    happening, which bounds the worst case to O(n log n).
 
 Author:
 
@@ -38,63 +42,183 @@ Module Name:
 //
 
 //
-// This macro is a helper to the quicksort swap macro. It gets a pointer to a
-// void pointer at the given index.
+// This macro calls the comparison routine for the sort, with or without the
+// caller's context.
 //
 
-#define QUICKSORT_ELEMENT(_Base, _ElementSize, _Index) \
-    (*((void **)((_Base) + ((_ElementSize) * (_Index)))))
+#define QSORT_COMPARE(_Sort, _Left, _Right)                                    \
+    (((_Sort)->CompareFunction != NULL) ?                                      \
+     (_Sort)->CompareFunction((_Left), (_Right)) :                             \
+     (_Sort)->ContextCompareFunction((_Left), (_Right), (_Sort)->Context))
 
 //
-// This macro either performs an exchange directly for pointer sized elements,
-// or calls the bytewise swap function to exchange byte for byte. It assumes
-// the presence of a void pointer local called SwapPointer.
+// This macro evaluates to non-zero if the left element sorts strictly before
+// the right element.
 //
 
-#define QUICKSORT_SWAP(_Base, _ElementSize, _FirstIndex, _SecondIndex)         \
-    {                                                                          \
-        if ((_ElementSize) == sizeof(void *)) {                                \
-            SwapPointer = QUICKSORT_ELEMENT(_Base, _ElementSize, _FirstIndex); \
-            QUICKSORT_ELEMENT(_Base, _ElementSize, _FirstIndex) =              \
-                        QUICKSORT_ELEMENT(_Base, _ElementSize, _SecondIndex);  \
-                                                                               \
-            QUICKSORT_ELEMENT(_Base, _ElementSize, _SecondIndex) =             \
-                                                                  SwapPointer; \
-        } else {                                                               \
-            ClpQuickSortSwap((_Base),                                          \
-                             (_ElementSize),                                   \
-                             (_FirstIndex),                                    \
-                             (_SecondIndex));                                  \
-        }                                                                      \
-    }
+#define QSORT_LESS(_Sort, _Left, _Right) \
+    (QSORT_COMPARE(_Sort, _Left, _Right) < 0)
+
+//
+// This macro gets the number of elements between two element pointers.
+//
+
+#define QSORT_COUNT(_Sort, _Start, _End) \
+    ((size_t)((_End) - (_Start)) / (_Sort)->ElementSize)
+
+//
+// This macro gets a pointer to the element at the given offset, which may be
+// negative, from another element.
+//
+
+#define QSORT_ELEMENT(_Sort, _Element, _Offset) \
+    ((_Element) + ((ssize_t)(_Sort)->ElementSize * (ssize_t)(_Offset)))
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Partitions smaller than this are sorted with insertion sort.
+//
+
+#define QSORT_INSERTION_SORT_THRESHOLD 24
+
+//
+// Partitions larger than this use the median of three medians (Tukey's
+// ninther) as the pivot, rather than a simple median of three.
+//
+
+#define QSORT_NINTHER_THRESHOLD 128
+
+//
+// Define the number of element moves a partial insertion sort is allowed
+// before it gives up on the partition being nearly sorted.
+//
+
+#define QSORT_PARTIAL_INSERTION_SORT_LIMIT 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+typedef enum _QSORT_SWAP_TYPE {
+    QsortSwapBytes,
+    QsortSwapWords,
+    QsortSwap32,
+    QsortSwap64,
+    QsortSwap128
+} QSORT_SWAP_TYPE, *PQSORT_SWAP_TYPE;
+
+/*++
+
+Structure Description:
+
+    This structure stores the invariant parameters of a sort operation.
+
+Members:
+
+    ElementSize - Stores the size of one element in bytes.
+
+    SwapType - Stores the method used to exchange two elements, selected from
+        the element size and array alignment.
+
+    CompareFunction - Stores the caller's comparison routine, for qsort.
+
+    ContextCompareFunction - Stores the caller's comparison routine, for
+        qsort_r. Only one of the comparison routines is set.
+
+    Context - Stores the context pointer passed to the context comparison
+        routine.
+
+--*/
+
+typedef struct _QSORT_CONTEXT {
+    size_t ElementSize;
+    QSORT_SWAP_TYPE SwapType;
+    int (*CompareFunction)(const void *, const void *);
+    int (*ContextCompareFunction)(const void *, const void *, void *);
+    void *Context;
+} QSORT_CONTEXT, *PQSORT_CONTEXT;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
 VOID
-ClpQuickSort (
+ClpSort (
+    PQSORT_CONTEXT Sort,
     void *ArrayBase,
-    size_t ElementSize,
-    ssize_t StartIndex,
-    ssize_t EndIndex,
-    int (*CompareFunction)(const void *, const void *)
+    size_t ElementCount
     );
 
 VOID
-ClpQuickSortSwap (
-    void *ArrayBase,
-    size_t ElementSize,
-    ssize_t FirstIndex,
-    ssize_t SecondIndex
+ClpSortLoop (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    ULONG BadPartitionsAllowed,
+    BOOL Leftmost
+    );
+
+PUCHAR
+ClpSortPartitionRight (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    PBOOL AlreadyPartitioned
+    );
+
+PUCHAR
+ClpSortPartitionLeft (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
+    );
+
+VOID
+ClpSortInsertion (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    BOOL Guarded
+    );
+
+BOOL
+ClpSortPartialInsertion (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
+    );
+
+VOID
+ClpSortHeap (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
+    );
+
+VOID
+ClpSortSiftDown (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    size_t Count,
+    size_t Index
+    );
+
+VOID
+ClpSortThree (
+    PQSORT_CONTEXT Sort,
+    PUCHAR First,
+    PUCHAR Second,
+    PUCHAR Third
+    );
+
+VOID
+ClpSortSwap (
+    PQSORT_CONTEXT Sort,
+    PUCHAR First,
+    PUCHAR Second
     );
 
 //
@@ -145,57 +269,52 @@ Return Value:
 
 {
 
-    assert(ElementCount < (((size_t)-1) >> 1));
-    assert(ElementSize < (((size_t)-1) >> 1));
-
-    if (ElementCount > 1) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     0,
-                     ElementCount - 1,
-                     CompareFunction);
-    }
+    QSORT_CONTEXT Sort;
 
+    Sort.ElementSize = ElementSize;
+    Sort.CompareFunction = CompareFunction;
+    Sort.ContextCompareFunction = NULL;
+    Sort.Context = NULL;
+    ClpSort(&Sort, ArrayBase, ElementCount);
     return;
 }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
-
-VOID
-ClpQuickSort (
+LIBC_API
+void
+qsort_r (
     void *ArrayBase,
+    size_t ElementCount,
     size_t ElementSize,
-    ssize_t StartIndex,
-    ssize_t EndIndex,
-    int (*CompareFunction)(const void *, const void *)
+    int (*CompareFunction)(const void *, const void *, void *),
+    void *Context
     )
 
 /*++
 
 Routine Description:
 
-    This routine sorts an array of items in place using the QuickSort algorithm.
+    This routine sorts an array of items in place using the QuickSort
+    algorithm, passing a caller-defined context pointer to the comparison
+    routine.
 
 Arguments:
 
     ArrayBase - Supplies a pointer to the array of items that will get pushed
         around.
 
-    ElementSize - Supplies the size of one of the elements.
-
-    StartIndex - Supplies the starting index of the array to sort, inclusive.
+    ElementCount - Supplies the number of elements in the array.
 
-    EndIndex - Supplies the ending index of the array to sort, inclusive.
+    ElementSize - Supplies the size of one of the elements.
 
     CompareFunction - Supplies a pointer to a function that will be used to
         compare elements. The function takes in two pointers that will point
-        within the array. It returns less than zero if the first element is
-        less than the second, zero if the first element is equal to the second,
-        and greater than zero if the first element is greater than the second.
-        The routine must not modify the array itself or inconsistently
-        report comparisons, otherwise the sorting will not come out correctly.
+        within the array, and the context pointer. It returns less than zero if
+        the first element is less than the second, zero if the first element
+        is equal to the second, and greater than zero if the first element is
+        greater than the second.
+
+    Context - Supplies a pointer that is passed through to the comparison
+        routine.
 
 Return Value:
 
@@ -205,206 +324,719 @@ Return Value:
 
 {
 
-    int CompareResult;
-    ssize_t EqualIndex;
-    ssize_t LargerIndex;
-    ssize_t LargestIndex;
-    void *LastElement;
-    ssize_t SmallerIndex;
-    ssize_t SmallestIndex;
-    void *SwapPointer;
+    QSORT_CONTEXT Sort;
+
+    Sort.ElementSize = ElementSize;
+    Sort.CompareFunction = NULL;
+    Sort.ContextCompareFunction = CompareFunction;
+    Sort.Context = Context;
+    ClpSort(&Sort, ArrayBase, ElementCount);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpSort (
+    PQSORT_CONTEXT Sort,
+    void *ArrayBase,
+    size_t ElementCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets up and runs a sort operation.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context, with the element size and
+        comparison routine filled in.
+
+    ArrayBase - Supplies a pointer to the array to sort.
+
+    ElementCount - Supplies the number of elements in the array.
+
+Return Value:
 
-    if (EndIndex <= StartIndex) {
+    None.
+
+--*/
+
+{
+
+    UINTN Alignment;
+    ULONG BadPartitionsAllowed;
+    size_t Count;
+
+    assert(ElementCount < (((size_t)-1) >> 1));
+    assert(Sort->ElementSize < (((size_t)-1) >> 1));
+
+    if ((ElementCount < 2) || (Sort->ElementSize == 0)) {
         return;
     }
 
-    LastElement = ArrayBase + (EndIndex * ElementSize);
-    SmallerIndex = StartIndex - 1;
-    SmallestIndex = StartIndex - 1;
-    LargerIndex = EndIndex;
-    LargestIndex = EndIndex;
+    //
+    // Pick the widest swap the element size and array alignment allow. Since
+    // every element is a multiple of the element size away from the base,
+    // checking the base and the size covers all elements.
+    //
+
+    Alignment = (UINTN)ArrayBase | Sort->ElementSize;
+    Sort->SwapType = QsortSwapBytes;
+    if (Sort->ElementSize == sizeof(ULONG)) {
+        if ((Alignment & (sizeof(ULONG) - 1)) == 0) {
+            Sort->SwapType = QsortSwap32;
+        }
+
+    } else if (Sort->ElementSize == sizeof(ULONGLONG)) {
+        if ((Alignment & (sizeof(ULONGLONG) - 1)) == 0) {
+            Sort->SwapType = QsortSwap64;
+        }
+
+    } else if (Sort->ElementSize == (sizeof(ULONGLONG) * 2)) {
+        if ((Alignment & (sizeof(ULONGLONG) - 1)) == 0) {
+            Sort->SwapType = QsortSwap128;
+        }
+
+    } else if ((Alignment & (sizeof(UINTN) - 1)) == 0) {
+        Sort->SwapType = QsortSwapWords;
+    }
 
     //
-    // Loop swapping elements that are on the wrong side of the pivot (which is
-    // selected to be the last element). The loop stops when the indices cross.
+    // Allow about log2(n) bad partitions before switching to heapsort.
     //
 
-    while (TRUE) {
+    BadPartitionsAllowed = 0;
+    Count = ElementCount;
+    while (Count > 1) {
+        BadPartitionsAllowed += 1;
+        Count >>= 1;
+    }
 
-        //
-        // Scan along as long as the current value is less than the last value.
-        //
+    ClpSortLoop(Sort,
+                ArrayBase,
+                QSORT_ELEMENT(Sort, (PUCHAR)ArrayBase, ElementCount),
+                BadPartitionsAllowed,
+                TRUE);
 
-        while (TRUE) {
-            SmallerIndex += 1;
-            if (SmallerIndex == EndIndex) {
-                break;
-            }
+    return;
+}
 
-            CompareResult =
-                      CompareFunction(ArrayBase + (SmallerIndex * ElementSize),
-                                      LastElement);
+VOID
+ClpSortLoop (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    ULONG BadPartitionsAllowed,
+    BOOL Leftmost
+    )
 
-            if (CompareResult >= 0) {
-                break;
-            }
-        }
+/*++
 
-        //
-        // Scan down as long as the current value is greater than the last
-        // value.
-        //
+Routine Description:
 
-        while (TRUE) {
-            LargerIndex -= 1;
-            CompareResult =
-                      CompareFunction(LastElement,
-                                      ArrayBase + (LargerIndex * ElementSize));
+    This routine implements the main pattern-defeating quicksort loop. It
+    recurses on the left partition and loops on the right.
 
-            if (CompareResult >= 0) {
-                break;
-            }
+Arguments:
 
-            if (LargerIndex == StartIndex) {
-                break;
-            }
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the first element to sort.
+
+    End - Supplies a pointer one element beyond the last element to sort.
+
+    BadPartitionsAllowed - Supplies the number of highly unbalanced partitions
+        tolerated before falling back to heapsort.
+
+    Leftmost - Supplies a boolean indicating if this range is at the very
+        start of the array. If it is not, the element before the range is
+        known to be less than or equal to everything in the range.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL AlreadyPartitioned;
+    BOOL HighlyUnbalanced;
+    size_t LeftCount;
+    size_t Middle;
+    PUCHAR Pivot;
+    size_t RightCount;
+    size_t Size;
+
+    while (TRUE) {
+        Size = QSORT_COUNT(Sort, Start, End);
+        if (Size < QSORT_INSERTION_SORT_THRESHOLD) {
+            ClpSortInsertion(Sort, Start, End, Leftmost);
+            return;
         }
 
         //
-        // Stop if the paths crossed, as that means everything's on the correct
-        // side of the pivot if the pivot were here.
+        // Select a pivot and move it to the start of the range. Median of
+        // three also leaves an element no smaller than the pivot at the end,
+        // which the partition routines rely on as a sentinel.
         //
 
-        if (SmallerIndex >= LargerIndex) {
-            break;
+        Middle = Size / 2;
+        if (Size > QSORT_NINTHER_THRESHOLD) {
+            ClpSortThree(Sort,
+                         Start,
+                         QSORT_ELEMENT(Sort, Start, Middle),
+                         QSORT_ELEMENT(Sort, End, -1));
+
+            ClpSortThree(Sort,
+                         QSORT_ELEMENT(Sort, Start, 1),
+                         QSORT_ELEMENT(Sort, Start, Middle - 1),
+                         QSORT_ELEMENT(Sort, End, -2));
+
+            ClpSortThree(Sort,
+                         QSORT_ELEMENT(Sort, Start, 2),
+                         QSORT_ELEMENT(Sort, Start, Middle + 1),
+                         QSORT_ELEMENT(Sort, End, -3));
+
+            ClpSortThree(Sort,
+                         QSORT_ELEMENT(Sort, Start, Middle - 1),
+                         QSORT_ELEMENT(Sort, Start, Middle),
+                         QSORT_ELEMENT(Sort, Start, Middle + 1));
+
+            ClpSortSwap(Sort, Start, QSORT_ELEMENT(Sort, Start, Middle));
+
+        } else {
+            ClpSortThree(Sort,
+                         QSORT_ELEMENT(Sort, Start, Middle),
+                         Start,
+                         QSORT_ELEMENT(Sort, End, -1));
         }
 
         //
-        // Exchange the two, as they're both on the wrong side of the pivot.
+        // If the element before this range is equal to the pivot, then the
+        // pivot is the smallest value in the range. Put everything equal to
+        // it on the left; there is no need to sort those again. This makes
+        // arrays with many duplicates run in linear time.
         //
 
-        if (SmallerIndex != LargerIndex) {
-            QUICKSORT_SWAP(ArrayBase, ElementSize, SmallerIndex, LargerIndex);
+        if ((Leftmost == FALSE) &&
+            (!QSORT_LESS(Sort, QSORT_ELEMENT(Sort, Start, -1), Start))) {
+
+            Pivot = ClpSortPartitionLeft(Sort, Start, End);
+            Start = QSORT_ELEMENT(Sort, Pivot, 1);
+            continue;
+        }
+
+        Pivot = ClpSortPartitionRight(Sort, Start, End, &AlreadyPartitioned);
+        LeftCount = QSORT_COUNT(Sort, Start, Pivot);
+        RightCount = QSORT_COUNT(Sort, QSORT_ELEMENT(Sort, Pivot, 1), End);
+        HighlyUnbalanced = FALSE;
+        if ((LeftCount < (Size / 8)) || (RightCount < (Size / 8))) {
+            HighlyUnbalanced = TRUE;
         }
 
         //
-        // Move keys equal to the partitioning element over to the ends of the
-        // arrays. This is the beginning of what's called Bentley-McIlroy 3-way
-        // partitioning, and it helps to handle an array with lots of
-        // elements equal to the pivot. So the array is going to look like this:
-        // | equal | less |  xxx (unsorted)  | greater | equal |
-        // At the end, swap the equals to the center so that it looks like:
-        // | less | equal | greater |
-        // This has the benefit that it always uses N - 1 three way compares,
-        // there's no extra overhead if there are no equal keys, and only one
-        // extra exchange per equal key.
+        // After too many bad partitions, give up on quicksort and guarantee
+        // O(n log n) with heapsort. Otherwise, shuffle a few elements around
+        // to break up whatever pattern led to the bad pivot.
         //
 
-        CompareResult =
-                      CompareFunction(ArrayBase + (SmallerIndex * ElementSize),
-                                      LastElement);
+        if (HighlyUnbalanced != FALSE) {
+            BadPartitionsAllowed -= 1;
+            if (BadPartitionsAllowed == 0) {
+                ClpSortHeap(Sort, Start, End);
+                return;
+            }
 
-        if (CompareResult == 0) {
-            SmallestIndex += 1;
-            QUICKSORT_SWAP(ArrayBase, ElementSize, SmallestIndex, SmallerIndex);
-        }
+            if (LeftCount >= QSORT_INSERTION_SORT_THRESHOLD) {
+                ClpSortSwap(Sort,
+                            Start,
+                            QSORT_ELEMENT(Sort, Start, LeftCount / 4));
+
+                ClpSortSwap(Sort,
+                            QSORT_ELEMENT(Sort, Pivot, -1),
+                            QSORT_ELEMENT(Sort, Pivot, -(LeftCount / 4)));
+
+                if (LeftCount > QSORT_NINTHER_THRESHOLD) {
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Start, 1),
+                                QSORT_ELEMENT(Sort, Start, LeftCount / 4 + 1));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Start, 2),
+                                QSORT_ELEMENT(Sort, Start, LeftCount / 4 + 2));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Pivot, -2),
+                                QSORT_ELEMENT(Sort,
+                                              Pivot,
+                                              -(LeftCount / 4 + 1)));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Pivot, -3),
+                                QSORT_ELEMENT(Sort,
+                                              Pivot,
+                                              -(LeftCount / 4 + 2)));
+                }
+            }
+
+            if (RightCount >= QSORT_INSERTION_SORT_THRESHOLD) {
+                ClpSortSwap(Sort,
+                            QSORT_ELEMENT(Sort, Pivot, 1),
+                            QSORT_ELEMENT(Sort, Pivot, RightCount / 4 + 1));
+
+                ClpSortSwap(Sort,
+                            QSORT_ELEMENT(Sort, End, -1),
+                            QSORT_ELEMENT(Sort, End, -(RightCount / 4)));
+
+                if (RightCount > QSORT_NINTHER_THRESHOLD) {
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Pivot, 2),
+                                QSORT_ELEMENT(Sort,
+                                              Pivot,
+                                              RightCount / 4 + 2));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, Pivot, 3),
+                                QSORT_ELEMENT(Sort,
+                                              Pivot,
+                                              RightCount / 4 + 3));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, End, -2),
+                                QSORT_ELEMENT(Sort,
+                                              End,
+                                              -(RightCount / 4 + 1)));
+
+                    ClpSortSwap(Sort,
+                                QSORT_ELEMENT(Sort, End, -3),
+                                QSORT_ELEMENT(Sort,
+                                              End,
+                                              -(RightCount / 4 + 2)));
+                }
+            }
+
+        //
+        // If the partition step didn't have to move anything, the range may
+        // well be sorted already. Try a bounded insertion sort on both sides,
+        // which finishes the job cheaply if so.
+        //
 
-        CompareResult =
-                      CompareFunction(LastElement,
-                                      ArrayBase + (LargerIndex * ElementSize));
+        } else if (AlreadyPartitioned != FALSE) {
+            if ((ClpSortPartialInsertion(Sort, Start, Pivot) != FALSE) &&
+                (ClpSortPartialInsertion(Sort,
+                                         QSORT_ELEMENT(Sort, Pivot, 1),
+                                         End) != FALSE)) {
 
-        if (CompareResult == 0) {
-            LargestIndex -= 1;
-            QUICKSORT_SWAP(ArrayBase, ElementSize, LargerIndex, LargestIndex);
+                return;
+            }
         }
+
+        ClpSortLoop(Sort, Start, Pivot, BadPartitionsAllowed, Leftmost);
+        Start = QSORT_ELEMENT(Sort, Pivot, 1);
+        Leftmost = FALSE;
     }
 
+    return;
+}
+
+PUCHAR
+ClpSortPartitionRight (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    PBOOL AlreadyPartitioned
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions a range around the pivot at its start. Elements
+    less than the pivot end up on the left, and elements greater than or equal
+    to it on the right.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the first element of the range, which holds
+        the pivot.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+    AlreadyPartitioned - Supplies a pointer where a boolean is returned
+        indicating whether the range was already partitioned, meaning no
+        elements had to be exchanged.
+
+Return Value:
+
+    Returns a pointer to the pivot's final position.
+
+--*/
+
+{
+
+    PUCHAR First;
+    PUCHAR Last;
+    PUCHAR Pivot;
+    size_t Size;
+
+    Pivot = Start;
+    Size = Sort->ElementSize;
+    First = Start;
+    Last = End;
+
     //
-    // Put the pivot into place.
+    // Find the first element not less than the pivot. Median of three
+    // guarantees one exists.
     //
 
-    QUICKSORT_SWAP(ArrayBase, ElementSize, SmallerIndex, EndIndex);
+    do {
+        First += Size;
+
+    } while (QSORT_LESS(Sort, First, Pivot));
 
     //
-    // Move lower equal elements back up to the middle, and remove them from
-    // the partition of things that need to be resorted.
+    // Find the last element less than the pivot. If nothing was skipped above
+    // there might not be one, so this scan has to be bounded.
     //
 
-    LargerIndex = SmallerIndex + 1;
-    SmallerIndex -= 1;
-    for (EqualIndex = StartIndex; EqualIndex < SmallestIndex; EqualIndex += 1) {
-        QUICKSORT_SWAP(ArrayBase,
-                       ElementSize,
-                       EqualIndex,
-                       SmallerIndex);
+    if (First - Size == Start) {
+        while (First < Last) {
+            Last -= Size;
+            if (QSORT_LESS(Sort, Last, Pivot)) {
+                break;
+            }
+        }
 
-        SmallerIndex -= 1;
+    } else {
+        do {
+            Last -= Size;
+
+        } while (!QSORT_LESS(Sort, Last, Pivot));
+    }
+
+    *AlreadyPartitioned = FALSE;
+    if (First >= Last) {
+        *AlreadyPartitioned = TRUE;
     }
 
     //
-    // Move upper equal elements back down to the middle, and remove them from
-    // the partition of things that need to be resorted.
+    // Keep swapping pairs on the wrong side of the pivot. The elements just
+    // swapped act as sentinels for the unbounded scans.
     //
 
-    for (EqualIndex = EndIndex - 1;
-         EqualIndex > LargestIndex;
-         EqualIndex -= 1) {
+    while (First < Last) {
+        ClpSortSwap(Sort, First, Last);
+        do {
+            First += Size;
 
-        QUICKSORT_SWAP(ArrayBase,
-                       ElementSize,
-                       LargerIndex,
-                       EqualIndex);
+        } while (QSORT_LESS(Sort, First, Pivot));
+
+        do {
+            Last -= Size;
+
+        } while (!QSORT_LESS(Sort, Last, Pivot));
+    }
 
-        LargerIndex += 1;
+    First -= Size;
+    if (First != Start) {
+        ClpSortSwap(Sort, Start, First);
     }
 
+    return First;
+}
+
+PUCHAR
+ClpSortPartitionLeft (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions a range around the pivot at its start, putting
+    elements equal to the pivot on the left. It is used when the pivot is
+    known to be the smallest value in the range.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the first element of the range, which holds
+        the pivot.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    Returns a pointer to the pivot's final position.
+
+--*/
+
+{
+
+    PUCHAR First;
+    PUCHAR Last;
+    PUCHAR Pivot;
+    size_t Size;
+
+    Pivot = Start;
+    Size = Sort->ElementSize;
+    First = Start;
+    Last = End;
+
     //
-    // Sort the bottom half and then the top half.
+    // Find the last element not greater than the pivot. The pivot itself
+    // stops the scan.
     //
 
-    if (SmallerIndex > StartIndex) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     StartIndex,
-                     SmallerIndex,
-                     CompareFunction);
+    do {
+        Last -= Size;
+
+    } while (QSORT_LESS(Sort, Pivot, Last));
+
+    if (Last + Size == End) {
+        while (First < Last) {
+            First += Size;
+            if (QSORT_LESS(Sort, Pivot, First)) {
+                break;
+            }
+        }
+
+    } else {
+        do {
+            First += Size;
+
+        } while (!QSORT_LESS(Sort, Pivot, First));
     }
 
-    if (EndIndex > LargerIndex) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     LargerIndex,
-                     EndIndex,
-                     CompareFunction);
+    while (First < Last) {
+        ClpSortSwap(Sort, First, Last);
+        do {
+            Last -= Size;
+
+        } while (QSORT_LESS(Sort, Pivot, Last));
+
+        do {
+            First += Size;
+
+        } while (!QSORT_LESS(Sort, Pivot, First));
+    }
+
+    if (Last != Start) {
+        ClpSortSwap(Sort, Start, Last);
+    }
+
+    return Last;
+}
+
+VOID
+ClpSortInsertion (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End,
+    BOOL Guarded
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts a small range using insertion sort.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+    Guarded - Supplies a boolean indicating whether the scan needs to check
+        for the start of the range. If FALSE, the element before the range is
+        known to be no greater than any element within it, and stops the scan.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PUCHAR Current;
+    PUCHAR Previous;
+    PUCHAR Sift;
+    size_t Size;
+
+    Size = Sort->ElementSize;
+    if (Start == End) {
+        return;
+    }
+
+    for (Current = Start + Size; Current < End; Current += Size) {
+        Sift = Current;
+        while ((Guarded == FALSE) || (Sift != Start)) {
+            Previous = Sift - Size;
+            if (!QSORT_LESS(Sort, Sift, Previous)) {
+                break;
+            }
+
+            ClpSortSwap(Sort, Sift, Previous);
+            Sift = Previous;
+        }
     }
 
     return;
 }
 
+BOOL
+ClpSortPartialInsertion (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to insertion sort a range, giving up if too many
+    elements have to be moved.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    TRUE if the range is now sorted.
+
+    FALSE if the sort was abandoned.
+
+--*/
+
+{
+
+    PUCHAR Current;
+    ULONG Moves;
+    PUCHAR Previous;
+    PUCHAR Sift;
+    size_t Size;
+
+    Size = Sort->ElementSize;
+    if (Start == End) {
+        return TRUE;
+    }
+
+    Moves = 0;
+    for (Current = Start + Size; Current < End; Current += Size) {
+        Sift = Current;
+        while (Sift != Start) {
+            Previous = Sift - Size;
+            if (!QSORT_LESS(Sort, Sift, Previous)) {
+                break;
+            }
+
+            ClpSortSwap(Sort, Sift, Previous);
+            Sift = Previous;
+            Moves += 1;
+        }
+
+        if (Moves > QSORT_PARTIAL_INSERTION_SORT_LIMIT) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 VOID
-ClpQuickSortSwap (
-    void *ArrayBase,
-    size_t ElementSize,
-    ssize_t FirstIndex,
-    ssize_t SecondIndex
+ClpSortHeap (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    PUCHAR End
     )
 
 /*++
 
 Routine Description:
 
-    This routine swaps two elements in the given array.
+    This routine sorts a range using heapsort.
 
 Arguments:
 
-    ArrayBase - Supplies a pointer to the array of items that will get pushed
-        around.
+    Sort - Supplies a pointer to the sort context.
 
-    ElementSize - Supplies the size of one of the elements.
+    Start - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    None.
 
-    FirstIndex - Supplies the first index of the indices to exchange.
+--*/
+
+{
+
+    size_t Count;
+    size_t Index;
 
-    SecondIndex - Supplies the second index of the indices to exchange.
+    Count = QSORT_COUNT(Sort, Start, End);
+    Index = Count / 2;
+    while (Index != 0) {
+        Index -= 1;
+        ClpSortSiftDown(Sort, Start, Count, Index);
+    }
+
+    while (Count > 1) {
+        Count -= 1;
+        ClpSortSwap(Sort, Start, QSORT_ELEMENT(Sort, Start, Count));
+        ClpSortSiftDown(Sort, Start, Count, 0);
+    }
+
+    return;
+}
+
+VOID
+ClpSortSiftDown (
+    PQSORT_CONTEXT Sort,
+    PUCHAR Start,
+    size_t Count,
+    size_t Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves an element down a max-heap until the heap property is
+    restored.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    Start - Supplies a pointer to the root of the heap.
+
+    Count - Supplies the number of elements in the heap.
+
+    Index - Supplies the index of the element to sift down.
 
 Return Value:
 
@@ -414,17 +1046,162 @@ Return Value:
 
 {
 
-    ssize_t ByteIndex;
-    unsigned char *FirstElement;
-    unsigned char *SecondElement;
-    unsigned char Swap;
-
-    FirstElement = (unsigned char *)ArrayBase + (ElementSize * FirstIndex);
-    SecondElement = (unsigned char *)ArrayBase + (ElementSize * SecondIndex);
-    for (ByteIndex = 0; ByteIndex < ElementSize; ByteIndex += 1) {
-        Swap = FirstElement[ByteIndex];
-        FirstElement[ByteIndex] = SecondElement[ByteIndex];
-        SecondElement[ByteIndex] = Swap;
+    size_t Child;
+
+    while (TRUE) {
+        Child = (Index * 2) + 1;
+        if (Child >= Count) {
+            break;
+        }
+
+        if ((Child + 1 < Count) &&
+            (QSORT_LESS(Sort,
+                        QSORT_ELEMENT(Sort, Start, Child),
+                        QSORT_ELEMENT(Sort, Start, Child + 1)))) {
+
+            Child += 1;
+        }
+
+        if (!QSORT_LESS(Sort,
+                        QSORT_ELEMENT(Sort, Start, Index),
+                        QSORT_ELEMENT(Sort, Start, Child))) {
+
+            break;
+        }
+
+        ClpSortSwap(Sort,
+                    QSORT_ELEMENT(Sort, Start, Index),
+                    QSORT_ELEMENT(Sort, Start, Child));
+
+        Index = Child;
+    }
+
+    return;
+}
+
+VOID
+ClpSortThree (
+    PQSORT_CONTEXT Sort,
+    PUCHAR First,
+    PUCHAR Second,
+    PUCHAR Third
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts three elements in place.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    First - Supplies a pointer to the element that receives the smallest
+        value.
+
+    Second - Supplies a pointer to the element that receives the median.
+
+    Third - Supplies a pointer to the element that receives the largest value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (QSORT_LESS(Sort, Second, First)) {
+        ClpSortSwap(Sort, First, Second);
+    }
+
+    if (QSORT_LESS(Sort, Third, Second)) {
+        ClpSortSwap(Sort, Second, Third);
+        if (QSORT_LESS(Sort, Second, First)) {
+            ClpSortSwap(Sort, First, Second);
+        }
+    }
+
+    return;
+}
+
+VOID
+ClpSortSwap (
+    PQSORT_CONTEXT Sort,
+    PUCHAR First,
+    PUCHAR Second
+    )
+
+/*++
+
+Routine Description:
+
+    This routine exchanges two elements, using the widest accesses the element
+    size and alignment allow.
+
+Arguments:
+
+    Sort - Supplies a pointer to the sort context.
+
+    First - Supplies a pointer to the first element.
+
+    Second - Supplies a pointer to the second element.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Byte;
+    size_t Index;
+    ULONG Swap32;
+    ULONGLONG Swap64;
+    UINTN Word;
+
+    switch (Sort->SwapType) {
+    case QsortSwap32:
+        Swap32 = *((PULONG)First);
+        *((PULONG)First) = *((PULONG)Second);
+        *((PULONG)Second) = Swap32;
+        break;
+
+    case QsortSwap64:
+        Swap64 = *((PULONGLONG)First);
+        *((PULONGLONG)First) = *((PULONGLONG)Second);
+        *((PULONGLONG)Second) = Swap64;
+        break;
+
+    case QsortSwap128:
+        Swap64 = ((PULONGLONG)First)[0];
+        ((PULONGLONG)First)[0] = ((PULONGLONG)Second)[0];
+        ((PULONGLONG)Second)[0] = Swap64;
+        Swap64 = ((PULONGLONG)First)[1];
+        ((PULONGLONG)First)[1] = ((PULONGLONG)Second)[1];
+        ((PULONGLONG)Second)[1] = Swap64;
+        break;
+
+    case QsortSwapWords:
+        for (Index = 0; Index < Sort->ElementSize; Index += sizeof(UINTN)) {
+            Word = *((PUINTN)(First + Index));
+            *((PUINTN)(First + Index)) = *((PUINTN)(Second + Index));
+            *((PUINTN)(Second + Index)) = Word;
+        }
+
+        break;
+
+    case QsortSwapBytes:
+    default:
+        for (Index = 0; Index < Sort->ElementSize; Index += 1) {
+            Byte = First[Index];
+            First[Index] = Second[Index];
+            Second[Index] = Byte;
+        }
+
+        break;
     }
 
     return;
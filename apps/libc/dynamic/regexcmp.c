@@ -531,6 +531,13 @@ Return Value:
         goto CompileRegularExpressionEnd;
     }
 
+    //
+    // Build the program used to execute the expression in linear time. If
+    // one can't be built, the backtracking matcher runs the expression.
+    //
+
+    ClpCompileRegularExpressionProgram(Result);
+
 CompileRegularExpressionEnd:
     if (Status != RegexStatusSuccess) {
         if (Result != NULL) {
@@ -582,6 +589,10 @@ Return Value:
         ClpDestroyRegularExpressionEntry(Entry);
     }
 
+    if (Expression->Program != NULL) {
+        ClpDestroyRegularExpressionProgram(Expression->Program);
+    }
+
     free(Expression);
     return;
 }
@@ -289,6 +289,214 @@ Return Value:
     return Status;
 }
 
+BOOL
+ClpRegularExpressionBracketMatches (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given character is a member of the given
+    bracket expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression the
+        bracket expression belongs to.
+
+    Entry - Supplies the bracket expression entry.
+
+    Character - Supplies the character to test.
+
+Return Value:
+
+    TRUE if the bracket expression matches the character.
+
+    FALSE if the bracket expression does not match the character.
+
+--*/
+
+{
+
+    PREGULAR_BRACKET_ENTRY BracketEntry;
+    PREGULAR_BRACKET_EXPRESSION BracketExpression;
+    ULONG CharacterCount;
+    ULONG CharacterIndex;
+    PLIST_ENTRY CurrentEntry;
+    BOOL Match;
+    PSTR RegularCharacters;
+
+    assert(Entry->Type == RegexEntryBracketExpression);
+
+    if (Character == '\0') {
+        return FALSE;
+    }
+
+    Match = FALSE;
+    BracketExpression = &(Entry->U.BracketExpression);
+    CharacterCount = BracketExpression->RegularCharacters.Size;
+    RegularCharacters = BracketExpression->RegularCharacters.Data;
+
+    //
+    // First match against any of the regular characters.
+    //
+
+    for (CharacterIndex = 0;
+         CharacterIndex < CharacterCount;
+         CharacterIndex += 1) {
+
+        if ((Character == RegularCharacters[CharacterIndex]) ||
+            (((Expression->Flags & REG_ICASE) != 0) &&
+              (tolower(Character) ==
+               tolower(RegularCharacters[CharacterIndex])))) {
+
+            Match = TRUE;
+            goto RegularExpressionBracketMatchesEnd;
+        }
+    }
+
+    //
+    // Go through the list of other stuff and see if any of that matches.
+    //
+
+    CurrentEntry = BracketExpression->EntryList.Next;
+    while (CurrentEntry != &(BracketExpression->EntryList)) {
+        BracketEntry = LIST_VALUE(CurrentEntry,
+                                  REGULAR_BRACKET_ENTRY,
+                                  ListEntry);
+
+        CurrentEntry = CurrentEntry->Next;
+        switch (BracketEntry->Type) {
+        case BracketExpressionRange:
+            if ((Character >= BracketEntry->U.Range.Minimum) &&
+                (Character <= BracketEntry->U.Range.Maximum)) {
+
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassAlphanumeric:
+            if (isalnum(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassAlphabetic:
+            if (isalpha(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassBlank:
+            if (isblank(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassControl:
+            if (iscntrl(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassDigit:
+            if (isdigit(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassGraph:
+            if (isgraph(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassLowercase:
+            if ((islower(Character)) ||
+                (((Expression->Flags & REG_ICASE) != 0) &&
+                 (isupper(Character)))) {
+
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassPrintable:
+            if (isprint(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassPunctuation:
+            if (ispunct(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassSpace:
+            if (isspace(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassUppercase:
+            if ((isupper(Character)) ||
+                (((Expression->Flags & REG_ICASE) != 0) &&
+                 (islower(Character)))) {
+
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassHexDigit:
+            if (isxdigit(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassName:
+            if (REGULAR_EXPRESSION_IS_NAME(Character)) {
+                Match = TRUE;
+            }
+
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            goto RegularExpressionBracketMatchesEnd;
+        }
+
+        if (Match != FALSE) {
+            break;
+        }
+    }
+
+RegularExpressionBracketMatchesEnd:
+    if ((Entry->Flags & REGULAR_EXPRESSION_NEGATED) != 0) {
+        Match = !Match;
+    }
+
+    return Match;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -356,6 +564,41 @@ Return Value:
         }
     }
 
+    //
+    // Quickly rule out strings that don't contain the literal every match
+    // needs.
+    //
+
+    if ((RegularExpression->RequiredStringSize != 0) &&
+        (ClpRegularExpressionFindRequiredString(RegularExpression,
+                                                String,
+                                                Context.InputSize - 1) ==
+         FALSE)) {
+
+        return RegexStatusNoMatch;
+    }
+
+    //
+    // Run the expression in linear time if it was compiled into a program.
+    // The backtracker below handles back references, and is the fallback if
+    // the program couldn't get the memory it needed.
+    //
+
+    if (RegularExpression->Program != NULL) {
+        Status = ClpExecuteRegularExpressionProgram(RegularExpression,
+                                                    String,
+                                                    Context.InputSize - 1,
+                                                    Match,
+                                                    MatchArraySize,
+                                                    Flags);
+
+        if (Status != RegexStatusNoMemory) {
+            return Status;
+        }
+
+        Status = RegexStatusNoMatch;
+    }
+
     for (MatchIndex = 0;
          MatchIndex < REGEX_INTERNAL_MATCH_COUNT;
          MatchIndex += 1) {
@@ -1333,14 +1576,7 @@ Return Value:
 
 {
 
-    PREGULAR_BRACKET_ENTRY BracketEntry;
-    PREGULAR_BRACKET_EXPRESSION BracketExpression;
     CHAR Character;
-    ULONG CharacterCount;
-    ULONG CharacterIndex;
-    PLIST_ENTRY CurrentEntry;
-    PSTR RegularCharacters;
-    REGULAR_EXPRESSION_STATUS Status;
 
     assert(Entry->Type == RegexEntryBracketExpression);
 
@@ -1349,178 +1585,15 @@ Return Value:
     }
 
     Character = Context->Input[Context->NextInput];
-    if (Character == '\0') {
-        return RegexStatusNoMatch;
-    }
-
-    Status = RegexStatusNoMatch;
-    BracketExpression = &(Entry->U.BracketExpression);
-    CharacterCount = BracketExpression->RegularCharacters.Size;
-    RegularCharacters = BracketExpression->RegularCharacters.Data;
-
-    //
-    // First match against any of the regular characters.
-    //
-
-    for (CharacterIndex = 0;
-         CharacterIndex < CharacterCount;
-         CharacterIndex += 1) {
-
-        if ((Character == RegularCharacters[CharacterIndex]) ||
-            (((Context->Expression->Flags & REG_ICASE) != 0) &&
-              (tolower(Character) ==
-               tolower(RegularCharacters[CharacterIndex])))) {
-
-            Status = RegexStatusSuccess;
-            goto RegularExpressionMatchBracketExpressionEnd;
-        }
-    }
-
-    //
-    // Go through the list of other stuff and see if any of that matches.
-    //
-
-    CurrentEntry = BracketExpression->EntryList.Next;
-    while (CurrentEntry != &(BracketExpression->EntryList)) {
-        BracketEntry = LIST_VALUE(CurrentEntry,
-                                  REGULAR_BRACKET_ENTRY,
-                                  ListEntry);
-
-        CurrentEntry = CurrentEntry->Next;
-        switch (BracketEntry->Type) {
-        case BracketExpressionRange:
-            if ((Character >= BracketEntry->U.Range.Minimum) &&
-                (Character <= BracketEntry->U.Range.Maximum)) {
-
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassAlphanumeric:
-            if (isalnum(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassAlphabetic:
-            if (isalpha(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassBlank:
-            if (isblank(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassControl:
-            if (iscntrl(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
+    if (ClpRegularExpressionBracketMatches(Context->Expression,
+                                           Entry,
+                                           Character) == FALSE) {
 
-        case BracketExpressionCharacterClassDigit:
-            if (isdigit(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassGraph:
-            if (isgraph(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassLowercase:
-            if ((islower(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
-                 (isupper(Character)))) {
-
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassPrintable:
-            if (isprint(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassPunctuation:
-            if (ispunct(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassSpace:
-            if (isspace(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassUppercase:
-            if ((isupper(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
-                 (islower(Character)))) {
-
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassHexDigit:
-            if (isxdigit(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassName:
-            if (REGULAR_EXPRESSION_IS_NAME(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        default:
-
-            assert(FALSE);
-
-            goto RegularExpressionMatchBracketExpressionEnd;
-        }
-
-        if (Status == RegexStatusSuccess) {
-            break;
-        }
-    }
-
-RegularExpressionMatchBracketExpressionEnd:
-    if ((Entry->Flags & REGULAR_EXPRESSION_NEGATED) != 0) {
-        if (Status == RegexStatusNoMatch) {
-            Status = RegexStatusSuccess;
-
-        } else if (Status == RegexStatusSuccess) {
-            Status = RegexStatusNoMatch;
-        }
-    }
-
-    if (Status == RegexStatusSuccess) {
-        Context->NextInput += 1;
+        return RegexStatusNoMatch;
     }
 
-    return Status;
+    Context->NextInput += 1;
+    return RegexStatusSuccess;
 }
 
 VOID
@@ -51,6 +51,29 @@ Module Name:
 #define REGULAR_EXPRESSION_ANCHORED_RIGHT 0x00000002
 #define REGULAR_EXPRESSION_NEGATED 0x00000004
 
+//
+// Define the maximum number of instructions in a compiled regular expression
+// program. Expressions that would need more than this (usually because of
+// large duplication counts) are run by the backtracking matcher instead.
+//
+
+#define REGEX_PROGRAM_MAX_SIZE 4096
+
+//
+// Define the number of 32-bit words in a character set bitmap.
+//
+
+#define REGEX_CHARACTER_SET_WORDS (256 / 32)
+
+//
+// Define the zero-width assertions a program can test.
+//
+
+#define REGEX_ASSERT_LINE_BEGIN 0x00000001
+#define REGEX_ASSERT_LINE_END 0x00000002
+#define REGEX_ASSERT_WORD_BEGIN 0x00000004
+#define REGEX_ASSERT_WORD_END 0x00000008
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -105,6 +128,19 @@ typedef enum _BRACKET_EXPRESSION_TYPE {
     BracketExpressionCharacterClassName
 } BRACKET_EXPRESSION_TYPE, *PBRACKET_EXPRESSION_TYPE;
 
+typedef enum _REGEX_INSTRUCTION_TYPE {
+    RegexInstructionInvalid,
+    RegexInstructionCharacterSet,
+    RegexInstructionSplit,
+    RegexInstructionJump,
+    RegexInstructionSave,
+    RegexInstructionAssert,
+    RegexInstructionProgress,
+    RegexInstructionMatch
+} REGEX_INSTRUCTION_TYPE, *PREGEX_INSTRUCTION_TYPE;
+
+typedef struct _REGEX_DFA REGEX_DFA, *PREGEX_DFA;
+
 /*++
 
 Structure Description:
@@ -257,6 +293,106 @@ struct _REGULAR_EXPRESSION_ENTRY {
 
 /*++
 
+Structure Description:
+
+    This structure defines a single instruction in a compiled regular
+    expression program.
+
+Members:
+
+    Type - Stores the instruction type.
+
+    Argument - Stores the character set index for character set instructions,
+        the match slot for save and progress instructions, and the
+        REGEX_ASSERT_* value for assert instructions. A progress instruction
+        only lets a thread through if the input has moved on since the
+        position in its slot was saved.
+
+    Next - Stores the index of the instruction to run next. For split
+        instructions this is the preferred path.
+
+    Alternate - Stores the lower priority path of a split instruction.
+
+--*/
+
+typedef struct _REGEX_INSTRUCTION {
+    REGEX_INSTRUCTION_TYPE Type;
+    ULONG Argument;
+    ULONG Next;
+    ULONG Alternate;
+} REGEX_INSTRUCTION, *PREGEX_INSTRUCTION;
+
+/*++
+
+Structure Description:
+
+    This structure defines a set of input bytes a character set instruction
+    accepts.
+
+Members:
+
+    Bits - Stores the bitmap of accepted bytes.
+
+--*/
+
+typedef struct _REGEX_CHARACTER_SET {
+    ULONG Bits[REGEX_CHARACTER_SET_WORDS];
+} REGEX_CHARACTER_SET, *PREGEX_CHARACTER_SET;
+
+/*++
+
+Structure Description:
+
+    This structure defines a regular expression compiled into a Thompson NFA
+    program. The program can be simulated directly to find submatches, or
+    turned lazily into a DFA to answer whether or not there is a match.
+
+Members:
+
+    Instructions - Stores the array of instructions.
+
+    InstructionCount - Stores the number of valid instructions.
+
+    InstructionCapacity - Stores the number of elements the instruction array
+        can hold.
+
+    CharacterSets - Stores the array of unique character sets.
+
+    CharacterSetCount - Stores the number of valid character sets.
+
+    CharacterSetCapacity - Stores the number of elements the character set
+        array can hold.
+
+    SlotCount - Stores the number of match slots, two for the overall match
+        and each subexpression, followed by one for each unbounded loop to
+        remember where its current iteration started.
+
+    ByteClasses - Stores the equivalence class of each input byte. Bytes in
+        the same class are in exactly the same character sets and look the
+        same to the assertions, so the DFA only needs one transition per
+        class.
+
+    ByteClassCount - Stores the number of byte classes.
+
+    Dfa - Stores a pointer to the lazily built DFA state cache.
+
+--*/
+
+typedef struct _REGEX_PROGRAM {
+    PREGEX_INSTRUCTION Instructions;
+    ULONG InstructionCount;
+    ULONG InstructionCapacity;
+    PREGEX_CHARACTER_SET CharacterSets;
+    ULONG CharacterSetCount;
+    ULONG CharacterSetCapacity;
+    ULONG SlotCount;
+    UCHAR ByteClasses[256];
+    ULONG ByteClassCount;
+    PREGEX_DFA Dfa;
+} REGEX_PROGRAM, *PREGEX_PROGRAM;
+
+/*++
+
 Structure Description:
 
     This structure defines the internal regular expression representation.
@@ -270,12 +406,26 @@ Structure Description:
     BaseEntry - Stores the initial subexpression entry, a slightly modified
         subexpression.
 
+    Program - Stores an optional pointer to the compiled program. This is NULL
+        if the expression uses back references or is too large, in which case
+        the backtracking matcher is used.
+
+    RequiredString - Stores an optional pointer to a literal string that must
+        appear in any input that matches. This points into the expression's
+        own entries.
+
+    RequiredStringSize - Stores the length of the required string, or zero if
+        there is none.
+
 --*/
 
 typedef struct _REGULAR_EXPRESSION {
     ULONG SubexpressionCount;
     ULONG Flags;
     REGULAR_EXPRESSION_ENTRY BaseEntry;
+    PREGEX_PROGRAM Program;
+    PSTR RequiredString;
+    ULONG RequiredStringSize;
 } REGULAR_EXPRESSION, *PREGULAR_EXPRESSION;
 
 //
@@ -285,3 +435,158 @@ typedef struct _REGULAR_EXPRESSION {
 //
 // -------------------------------------------------------- Function Prototypes
 //
+
+BOOL
+ClpRegularExpressionBracketMatches (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given character is a member of the given
+    bracket expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression the
+        bracket expression belongs to.
+
+    Entry - Supplies the bracket expression entry.
+
+    Character - Supplies the character to test.
+
+Return Value:
+
+    TRUE if the bracket expression matches the character.
+
+    FALSE if the bracket expression does not match the character.
+
+--*/
+
+VOID
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    );
+
+/*++
+
+Routine Description:
+
+    This routine compiles a parsed regular expression into a program for the
+    automaton based matchers, and finds the literal string any match must
+    contain. Failure is not fatal: if no program can be built the expression
+    is run by the backtracking matcher.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGEX_PROGRAM Program
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys a compiled regular expression program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+REGULAR_EXPRESSION_STATUS
+ClpExecuteRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine runs a compiled regular expression program against the given
+    string in time linear in the length of the string.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression, which
+        must have a program.
+
+    String - Supplies a pointer to the string to check for a match.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+    Match - Supplies an optional pointer to an array where the string indices of
+        the match and its subexpressions will be returned.
+
+    MatchArraySize - Supplies the number of elements in the match array.
+
+    Flags - Supplies a bitfield of flags governing the search. See some REG_*
+        definitions (specifically REG_NOTBOL and REG_NOTEOL).
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory if the program could not be run, in which case the caller should
+    fall back to the backtracking matcher.
+
+--*/
+
+BOOL
+ClpRegularExpressionFindRequiredString (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the given string contains the literal
+    string that every match of the expression must contain.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression, which
+        must have a required string.
+
+    String - Supplies a pointer to the string to search.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+Return Value:
+
+    TRUE if the string contains the required string, and so might match.
+
+    FALSE if the string cannot possibly match.
+
+--*/
+
@@ -0,0 +1,2942 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    regexvm.c
+
+Abstract:
+
+    This module implements the linear time regular expression engines. A
+    parsed expression is compiled into a Thompson NFA program. Whether or not
+    an input matches is answered by a DFA built lazily from that program, and
+    the match and subexpression positions are found by simulating the program
+    directly in lockstep over the input (a Pike VM).
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define LIBC_API __DLLEXPORT
+
+#include <minoca/lib/types.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regexp.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro determines whether the given byte is in the given character set.
+//
+
+#define REGEX_CHARACTER_SET_CONTAINS(_Set, _Byte) \
+    (((_Set)->Bits[(_Byte) >> 5] & (1 << ((_Byte) & 0x1F))) != 0)
+
+//
+// This macro adds the given byte to the given character set.
+//
+
+#define REGEX_CHARACTER_SET_ADD(_Set, _Byte) \
+    ((_Set)->Bits[(_Byte) >> 5] |= (1 << ((_Byte) & 0x1F)))
+
+//
+// This macro determines whether or not the given program counter is already
+// in the given thread list.
+//
+
+#define REGEX_THREAD_LIST_CONTAINS(_List, _Pc)    \
+    (((_List)->Sparse[(_Pc)] < (_List)->Count) && \
+     ((_List)->Dense[(_List)->Sparse[(_Pc)]] == (_Pc)))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define REGEX_INVALID_INDEX MAX_ULONG
+
+#define REGEX_INITIAL_PROGRAM_CAPACITY 32
+#define REGEX_INITIAL_CHARACTER_SET_CAPACITY 8
+
+//
+// Define the number of DFA states cached per expression. When the cache fills
+// up it is flushed and rebuilt from the state the search is currently in.
+//
+
+#define REGEX_DFA_MAX_STATES 2048
+#define REGEX_DFA_INITIAL_STATE_CAPACITY 16
+
+//
+// Define the number of hash buckets used to look up DFA states. This must be a
+// power of two.
+//
+
+#define REGEX_DFA_HASH_SIZE 512
+
+//
+// Define the transition value for transitions that have not been computed
+// yet. Computed transitions store the next state index shifted left by one,
+// with the low bit set if the program reached a match before the byte.
+//
+
+#define REGEX_DFA_UNKNOWN (-1)
+#define REGEX_DFA_MATCHED 0x1
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// Define the kinds of characters that can surround a position. These are all
+// the zero-width assertions need to know.
+//
+
+typedef enum _REGEX_CONTEXT {
+    RegexContextBoundary,
+    RegexContextNewline,
+    RegexContextWord,
+    RegexContextOther,
+    RegexContextCount
+} REGEX_CONTEXT, *PREGEX_CONTEXT;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single DFA state, which is the set of program
+    threads waiting to run at an input position.
+
+Members:
+
+    Threads - Stores the sorted array of program counters in the state. These
+        are not closed over: empty transitions are followed when the next byte
+        is known, since the assertions depend on it.
+
+    ThreadCount - Stores the number of elements in the threads array.
+
+    Previous - Stores the context of the byte before the state.
+
+    Hash - Stores the hash of the state.
+
+    NextInBucket - Stores the index of the next state in the same hash bucket,
+        or -1 at the end of the chain.
+
+    Transitions - Stores the transition for each class of next byte. See the
+        REGEX_DFA_* definitions. The threads array follows this array in the
+        same allocation.
+
+--*/
+
+typedef struct _REGEX_DFA_STATE {
+    PULONG Threads;
+    ULONG ThreadCount;
+    REGEX_CONTEXT Previous;
+    ULONG Hash;
+    LONG NextInBucket;
+    LONG Transitions[ANYSIZE_ARRAY];
+} REGEX_DFA_STATE, *PREGEX_DFA_STATE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the lazily built DFA for a program.
+
+Members:
+
+    Busy - Stores a flag that is set while a search is using the DFA.
+        Searches that find the DFA busy use the Pike VM instead of waiting.
+
+    Newline - Stores a boolean indicating if the expression was compiled with
+        REG_NEWLINE.
+
+    ClassCount - Stores the number of byte classes, which is the number of
+        transitions out of each state.
+
+    States - Stores the array of cached states.
+
+    StateCount - Stores the number of valid states.
+
+    StateCapacity - Stores the number of elements the states array can hold.
+
+    StartStates - Stores the index of the start state for each previous
+        context, or -1 if that start state has not been built.
+
+    Buckets - Stores the hash table heads.
+
+    Marks - Stores the generation each program counter was last visited in.
+
+    Generation - Stores the current visit generation.
+
+    Stack - Stores the work stack used to follow empty transitions.
+
+    Consumers - Stores the character set instructions reached by the last
+        closure.
+
+    ConsumerCount - Stores the number of valid elements in the consumers array.
+
+    NextThreads - Stores the scratch buffer the next state is built in.
+
+    SavedThreads - Stores the scratch buffer the current state is saved in
+        while the cache is flushed.
+
+--*/
+
+struct _REGEX_DFA {
+    volatile ULONG Busy;
+    BOOL Newline;
+    ULONG ClassCount;
+    PREGEX_DFA_STATE *States;
+    ULONG StateCount;
+    ULONG StateCapacity;
+    LONG StartStates[RegexContextCount];
+    LONG Buckets[REGEX_DFA_HASH_SIZE];
+    PULONG Marks;
+    ULONG Generation;
+    PULONG Stack;
+    PULONG Consumers;
+    ULONG ConsumerCount;
+    PULONG NextThreads;
+    PULONG SavedThreads;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines a list of Pike VM threads, kept in priority order.
+
+Members:
+
+    Dense - Stores the program counters of the threads in priority order.
+
+    Sparse - Stores the index into the dense array of each program counter,
+        which makes membership tests constant time.
+
+    Count - Stores the number of threads in the list.
+
+    Slots - Stores the match slots for each thread, indexed the same way as
+        the dense array.
+
+--*/
+
+typedef struct _REGEX_THREAD_LIST {
+    PULONG Dense;
+    PULONG Sparse;
+    ULONG Count;
+    regoff_t *Slots;
+} REGEX_THREAD_LIST, *PREGEX_THREAD_LIST;
+
+/*++
+
+Structure Description:
+
+    This structure defines an entry on the Pike VM work stack.
+
+Members:
+
+    Pc - Stores the program counter to explore.
+
+    Slot - Stores the slot to restore, or -1 if this frame explores the
+        program counter.
+
+    Value - Stores the value to restore the slot to.
+
+--*/
+
+typedef struct _REGEX_PIKE_FRAME {
+    ULONG Pc;
+    LONG Slot;
+    regoff_t Value;
+} REGEX_PIKE_FRAME, *PREGEX_PIKE_FRAME;
+
+/*++
+
+Structure Description:
+
+    This structure defines the state of a Pike VM search.
+
+Members:
+
+    Program - Stores a pointer to the program being run.
+
+    Input - Stores a pointer to the input string.
+
+    InputSize - Stores the length of the input, not including the terminator.
+
+    Newline - Stores a boolean indicating if REG_NEWLINE is set.
+
+    Flags - Stores the execution flags.
+
+    Lists - Stores the current and next thread lists.
+
+    Stack - Stores the work stack.
+
+    Slots - Stores the working match slots used while adding threads.
+
+    Best - Stores the match slots of the highest priority match found.
+
+--*/
+
+typedef struct _REGEX_PIKE_CONTEXT {
+    PREGEX_PROGRAM Program;
+    PSTR Input;
+    ULONG InputSize;
+    BOOL Newline;
+    int Flags;
+    REGEX_THREAD_LIST Lists[2];
+    PREGEX_PIKE_FRAME Stack;
+    regoff_t *Slots;
+    regoff_t *Best;
+} REGEX_PIKE_CONTEXT, *PREGEX_PIKE_CONTEXT;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+ClpRegexFindRequiredString (
+    PREGULAR_EXPRESSION Expression
+    );
+
+BOOL
+ClpRegexEntryHasBackReference (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEntryMatchesEmpty (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEmitEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEmitSingleEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEmitEntryList (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PLIST_ENTRY ListHead
+    );
+
+BOOL
+ClpRegexEmitCharacterSet (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    );
+
+ULONG
+ClpRegexEmit (
+    PREGEX_PROGRAM Program,
+    REGEX_INSTRUCTION_TYPE Type,
+    ULONG Argument
+    );
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGEX_PROGRAM Program
+    );
+
+VOID
+ClpRegexSplitByteClasses (
+    PREGEX_PROGRAM Program,
+    PREGEX_CHARACTER_SET Set
+    );
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program
+    );
+
+VOID
+ClpRegexDestroyDfa (
+    PREGEX_DFA Dfa
+    );
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    );
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexDfaSearch (
+    PREGEX_PROGRAM Program,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    );
+
+LONG
+ClpRegexDfaComputeTransition (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    PLONG StateIndex,
+    UCHAR Byte
+    );
+
+BOOL
+ClpRegexDfaClosure (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    PREGEX_DFA_STATE State,
+    REGEX_CONTEXT Next
+    );
+
+LONG
+ClpRegexDfaFindState (
+    PREGEX_DFA Dfa,
+    PULONG Threads,
+    ULONG ThreadCount,
+    REGEX_CONTEXT Previous
+    );
+
+ULONG
+ClpRegexDfaNextGeneration (
+    PREGEX_DFA Dfa,
+    ULONG InstructionCount
+    );
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexPikeSearch (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    );
+
+VOID
+ClpRegexPikeAddThread (
+    PREGEX_PIKE_CONTEXT Context,
+    PREGEX_THREAD_LIST List,
+    ULONG Pc,
+    ULONG Position
+    );
+
+REGEX_CONTEXT
+ClpRegexGetContext (
+    PSTR String,
+    ULONG StringSize,
+    ULONG Position,
+    BOOL Previous,
+    int Flags
+    );
+
+REGEX_CONTEXT
+ClpRegexClassifyCharacter (
+    CHAR Character
+    );
+
+BOOL
+ClpRegexCheckAssertion (
+    ULONG Assertion,
+    REGEX_CONTEXT Previous,
+    REGEX_CONTEXT Next,
+    BOOL Newline
+    );
+
+int
+ClpRegexCompareThreads (
+    const void *Left,
+    const void *Right
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles a parsed regular expression into a program for the
+    automaton based matchers, and finds the literal string any match must
+    contain. Failure is not fatal: if no program can be built the expression
+    is run by the backtracking matcher.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY BaseEntry;
+    PREGEX_PROGRAM Program;
+    BOOL Result;
+
+    BaseEntry = &(Expression->BaseEntry);
+    ClpRegexFindRequiredString(Expression);
+
+    //
+    // Back references need to remember what a subexpression matched, which
+    // no finite automaton can do. Leave those to the backtracker.
+    //
+
+    if (ClpRegexEntryHasBackReference(BaseEntry) != FALSE) {
+        return;
+    }
+
+    Program = malloc(sizeof(REGEX_PROGRAM));
+    if (Program == NULL) {
+        return;
+    }
+
+    memset(Program, 0, sizeof(REGEX_PROGRAM));
+    Program->SlotCount = (Expression->SubexpressionCount + 1) * 2;
+
+    //
+    // The program saves the overall match in slots zero and one, with the
+    // anchors of a basic regular expression as assertions just inside them.
+    //
+
+    Result = FALSE;
+    if ((BaseEntry->Flags & REGULAR_EXPRESSION_ANCHORED_LEFT) != 0) {
+        if (ClpRegexEmit(Program,
+                         RegexInstructionAssert,
+                         REGEX_ASSERT_LINE_BEGIN) == REGEX_INVALID_INDEX) {
+
+            goto CompileRegularExpressionProgramEnd;
+        }
+    }
+
+    if (ClpRegexEmit(Program, RegexInstructionSave, 0) ==
+        REGEX_INVALID_INDEX) {
+
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    if (ClpRegexEmitEntryList(Expression,
+                              Program,
+                              &(BaseEntry->ChildList)) == FALSE) {
+
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    if ((BaseEntry->Flags & REGULAR_EXPRESSION_ANCHORED_RIGHT) != 0) {
+        if (ClpRegexEmit(Program,
+                         RegexInstructionAssert,
+                         REGEX_ASSERT_LINE_END) == REGEX_INVALID_INDEX) {
+
+            goto CompileRegularExpressionProgramEnd;
+        }
+    }
+
+    if ((ClpRegexEmit(Program, RegexInstructionSave, 1) ==
+         REGEX_INVALID_INDEX) ||
+        (ClpRegexEmit(Program, RegexInstructionMatch, 0) ==
+         REGEX_INVALID_INDEX)) {
+
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    ClpRegexComputeByteClasses(Program);
+    Program->Dfa = ClpRegexCreateDfa(Expression, Program);
+    if (Program->Dfa == NULL) {
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    Result = TRUE;
+
+CompileRegularExpressionProgramEnd:
+    if (Result == FALSE) {
+        ClpDestroyRegularExpressionProgram(Program);
+        Program = NULL;
+    }
+
+    Expression->Program = Program;
+    return;
+}
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGEX_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a compiled regular expression program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Program->Dfa != NULL) {
+        ClpRegexDestroyDfa(Program->Dfa);
+    }
+
+    if (Program->Instructions != NULL) {
+        free(Program->Instructions);
+    }
+
+    if (Program->CharacterSets != NULL) {
+        free(Program->CharacterSets);
+    }
+
+    free(Program);
+    return;
+}
+
+REGULAR_EXPRESSION_STATUS
+ClpExecuteRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs a compiled regular expression program against the given
+    string in time linear in the length of the string.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression, which
+        must have a program.
+
+    String - Supplies a pointer to the string to check for a match.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+    Match - Supplies an optional pointer to an array where the string indices of
+        the match and its subexpressions will be returned.
+
+    MatchArraySize - Supplies the number of elements in the match array.
+
+    Flags - Supplies a bitfield of flags governing the search. See some REG_*
+        definitions (specifically REG_NOTBOL and REG_NOTEOL).
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory if the program could not be run, in which case the caller should
+    fall back to the backtracking matcher.
+
+--*/
+
+{
+
+    REGULAR_EXPRESSION_STATUS Status;
+
+    assert(Expression->Program != NULL);
+
+    //
+    // The DFA answers whether or not there is a match at all, which is all
+    // that's needed if the caller doesn't want positions. If the DFA is busy
+    // in another thread, go straight to the Pike VM.
+    //
+
+    Status = ClpRegexDfaSearch(Expression->Program, String, StringSize, Flags);
+    if (Status == RegexStatusNoMatch) {
+        return Status;
+    }
+
+    if ((Status == RegexStatusSuccess) &&
+        (((Expression->Flags & REG_NOSUB) != 0) || (MatchArraySize == 0))) {
+
+        return Status;
+    }
+
+    Status = ClpRegexPikeSearch(Expression,
+                                String,
+                                StringSize,
+                                Match,
+                                MatchArraySize,
+                                Flags);
+
+    return Status;
+}
+
+BOOL
+ClpRegularExpressionFindRequiredString (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the given string contains the literal
+    string that every match of the expression must contain.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression, which
+        must have a required string.
+
+    String - Supplies a pointer to the string to search.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+Return Value:
+
+    TRUE if the string contains the required string, and so might match.
+
+    FALSE if the string cannot possibly match.
+
+--*/
+
+{
+
+    PSTR End;
+    PSTR Required;
+    ULONG RequiredSize;
+    PSTR Search;
+
+    Required = Expression->RequiredString;
+    RequiredSize = Expression->RequiredStringSize;
+
+    assert(RequiredSize != 0);
+
+    if (RequiredSize > StringSize) {
+        return FALSE;
+    }
+
+    //
+    // Use memchr to skip quickly to candidates for the first character, and
+    // only then compare the rest.
+    //
+
+    Search = String;
+    End = String + StringSize - RequiredSize + 1;
+    while (Search < End) {
+        Search = memchr(Search, Required[0], End - Search);
+        if (Search == NULL) {
+            break;
+        }
+
+        if (memcmp(Search + 1, Required + 1, RequiredSize - 1) == 0) {
+            return TRUE;
+        }
+
+        Search += 1;
+    }
+
+    return FALSE;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpRegexFindRequiredString (
+    PREGULAR_EXPRESSION Expression
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the longest literal string that must appear in any
+    match of the given expression, for use as a prefilter.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    None. The required string is saved in the expression.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PREGULAR_EXPRESSION_ENTRY Entry;
+    PLIST_ENTRY ListHead;
+
+    Expression->RequiredString = NULL;
+    Expression->RequiredStringSize = 0;
+
+    //
+    // Case insensitive expressions would need a case insensitive search, which
+    // isn't worth it.
+    //
+
+    if ((Expression->Flags & REG_ICASE) != 0) {
+        return;
+    }
+
+    //
+    // Only the top level entries are each certain to be part of every match.
+    // Any ordinary characters there that appear at least once are required.
+    //
+
+    ListHead = &(Expression->BaseEntry.ChildList);
+    CurrentEntry = ListHead->Next;
+    while (CurrentEntry != ListHead) {
+        Entry = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if ((Entry->Type == RegexEntryOrdinaryCharacters) &&
+            (Entry->DuplicateMin != 0) &&
+            (Entry->U.String.Size > Expression->RequiredStringSize)) {
+
+            Expression->RequiredString = Entry->U.String.Data;
+            Expression->RequiredStringSize = Entry->U.String.Size;
+        }
+    }
+
+    return;
+}
+
+BOOL
+ClpRegexEntryHasBackReference (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given entry or any of its children is a
+    back reference.
+
+Arguments:
+
+    Entry - Supplies a pointer to the entry to search.
+
+Return Value:
+
+    TRUE if a back reference was found.
+
+    FALSE if the entry contains no back references.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY Child;
+    PLIST_ENTRY CurrentEntry;
+
+    if (Entry->Type == RegexEntryBackReference) {
+        return TRUE;
+    }
+
+    if ((Entry->Type != RegexEntrySubexpression) &&
+        (Entry->Type != RegexEntryBranch) &&
+        (Entry->Type != RegexEntryBranchOption)) {
+
+        return FALSE;
+    }
+
+    CurrentEntry = Entry->ChildList.Next;
+    while (CurrentEntry != &(Entry->ChildList)) {
+        Child = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (ClpRegexEntryHasBackReference(Child) != FALSE) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+BOOL
+ClpRegexEntryMatchesEmpty (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given entry can match the empty string
+    wherever it is tried. Assertions and back references only match nothing
+    at some positions, so they count as not matching empty.
+
+Arguments:
+
+    Entry - Supplies a pointer to the entry to examine.
+
+Return Value:
+
+    TRUE if the entry can match the empty string at any position.
+
+    FALSE if the entry might need to consume characters.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY Child;
+    PLIST_ENTRY CurrentEntry;
+
+    if (Entry->DuplicateMin == 0) {
+        return TRUE;
+    }
+
+    switch (Entry->Type) {
+    case RegexEntryOrdinaryCharacters:
+        if (Entry->U.String.Size == 0) {
+            return TRUE;
+        }
+
+        return FALSE;
+
+    //
+    // A branch matches empty if any of its options do.
+    //
+
+    case RegexEntryBranch:
+        CurrentEntry = Entry->ChildList.Next;
+        while (CurrentEntry != &(Entry->ChildList)) {
+            Child = LIST_VALUE(CurrentEntry,
+                               REGULAR_EXPRESSION_ENTRY,
+                               ListEntry);
+
+            CurrentEntry = CurrentEntry->Next;
+            if (ClpRegexEntryMatchesEmpty(Child) != FALSE) {
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+
+    //
+    // A subexpression or branch option matches empty if all of its children
+    // do.
+    //
+
+    case RegexEntrySubexpression:
+    case RegexEntryBranchOption:
+        CurrentEntry = Entry->ChildList.Next;
+        while (CurrentEntry != &(Entry->ChildList)) {
+            Child = LIST_VALUE(CurrentEntry,
+                               REGULAR_EXPRESSION_ENTRY,
+                               ListEntry);
+
+            CurrentEntry = CurrentEntry->Next;
+            if (ClpRegexEntryMatchesEmpty(Child) == FALSE) {
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+
+    default:
+        break;
+    }
+
+    return FALSE;
+}
+
+BOOL
+ClpRegexEmitEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for an entry and its duplication
+    count. The entry is repeated its minimum number of times, followed by
+    either a loop (for an unbounded maximum) or a string of optional copies.
+    Splits prefer another copy, making duplication greedy.
+
+Arguments:
+
+    Expression - Supplies a pointer to the expression being compiled.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to emit.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if the program got too large or an allocation failed.
+
+--*/
+
+{
+
+    ULONG Chain;
+    ULONG Count;
+    ULONG End;
+    ULONG First;
+    ULONG Loop;
+    ULONG Minimum;
+    ULONG Previous;
+    ULONG Slot;
+    ULONG Split;
+
+    //
+    // If the entry can match nothing anywhere, then any copies beyond the
+    // first can just as well be left out as match empty. Treat them as
+    // optional, so that the progress checks below keep an empty copy from
+    // replacing the subexpressions of the copy before it.
+    //
+
+    Minimum = Entry->DuplicateMin;
+    if ((Minimum > 1) && (ClpRegexEntryMatchesEmpty(Entry) != FALSE)) {
+        Minimum = 1;
+    }
+
+    for (Count = 0; Count < Minimum; Count += 1) {
+        if (ClpRegexEmitSingleEntry(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+    }
+
+    //
+    // An unbounded loop is closed by a split that prefers going around again
+    // but can also leave. Each iteration saves its starting position in a
+    // slot of its own, and a progress check at the end of the iteration
+    // drops threads that matched nothing. This way an empty iteration can
+    // never replace the subexpressions of the one before it, just as in the
+    // backtracking matcher. For a star the first copy is peeled off in front
+    // of the loop, so that the first iteration is allowed to match nothing.
+    //
+
+    if (Entry->DuplicateMax == (ULONG)-1) {
+        First = REGEX_INVALID_INDEX;
+        if (Minimum == 0) {
+            First = ClpRegexEmit(Program, RegexInstructionSplit, 0);
+            if ((First == REGEX_INVALID_INDEX) ||
+                (ClpRegexEmitSingleEntry(Expression, Program, Entry) ==
+                 FALSE)) {
+
+                return FALSE;
+            }
+        }
+
+        Slot = Program->SlotCount;
+        Program->SlotCount += 1;
+        Split = ClpRegexEmit(Program, RegexInstructionSplit, 0);
+        if ((Split == REGEX_INVALID_INDEX) ||
+            (ClpRegexEmit(Program, RegexInstructionSave, Slot) ==
+             REGEX_INVALID_INDEX) ||
+            (ClpRegexEmitSingleEntry(Expression, Program, Entry) == FALSE) ||
+            (ClpRegexEmit(Program, RegexInstructionProgress, Slot) ==
+             REGEX_INVALID_INDEX)) {
+
+            return FALSE;
+        }
+
+        Loop = ClpRegexEmit(Program, RegexInstructionSplit, 0);
+        if (Loop == REGEX_INVALID_INDEX) {
+            return FALSE;
+        }
+
+        End = Program->InstructionCount;
+        Program->Instructions[Loop].Next = Split;
+        Program->Instructions[Loop].Alternate = End;
+        Program->Instructions[Split].Alternate = End;
+        if (First != REGEX_INVALID_INDEX) {
+            Program->Instructions[First].Alternate = End;
+        }
+
+        return TRUE;
+    }
+
+    //
+    // Each optional copy can be skipped to the end. The splits are chained
+    // together through their alternate paths until the end is known. Like the
+    // iterations of an unbounded loop, each optional copy gets a progress
+    // check so that an empty copy can't replace the subexpressions of the
+    // copy before it. As with a star, the first copy is allowed to match
+    // nothing if there are no mandatory copies in front of it.
+    //
+
+    Chain = REGEX_INVALID_INDEX;
+    for (Count = Minimum;
+         Count < Entry->DuplicateMax;
+         Count += 1) {
+
+        Split = ClpRegexEmit(Program, RegexInstructionSplit, 0);
+        if (Split == REGEX_INVALID_INDEX) {
+            return FALSE;
+        }
+
+        Program->Instructions[Split].Alternate = Chain;
+        Chain = Split;
+        if (Count == 0) {
+            if (ClpRegexEmitSingleEntry(Expression, Program, Entry) == FALSE) {
+                return FALSE;
+            }
+
+            continue;
+        }
+
+        Slot = Program->SlotCount;
+        Program->SlotCount += 1;
+        if ((ClpRegexEmit(Program, RegexInstructionSave, Slot) ==
+             REGEX_INVALID_INDEX) ||
+            (ClpRegexEmitSingleEntry(Expression, Program, Entry) == FALSE) ||
+            (ClpRegexEmit(Program, RegexInstructionProgress, Slot) ==
+             REGEX_INVALID_INDEX)) {
+
+            return FALSE;
+        }
+    }
+
+    End = Program->InstructionCount;
+    while (Chain != REGEX_INVALID_INDEX) {
+        Previous = Program->Instructions[Chain].Alternate;
+        Program->Instructions[Chain].Alternate = End;
+        Chain = Previous;
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitSingleEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for a single occurrence of an entry.
+
+Arguments:
+
+    Expression - Supplies a pointer to the expression being compiled.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to emit.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if the program got too large, an allocation failed, or the entry
+    can't be expressed as a program.
+
+--*/
+
+{
+
+    ULONG Assertion;
+    ULONG Chain;
+    PLIST_ENTRY CurrentEntry;
+    ULONG End;
+    ULONG Index;
+    ULONG Jump;
+    PREGULAR_EXPRESSION_ENTRY Option;
+    ULONG Previous;
+    ULONG Split;
+
+    Assertion = 0;
+    switch (Entry->Type) {
+    case RegexEntryOrdinaryCharacters:
+        for (Index = 0; Index < Entry->U.String.Size; Index += 1) {
+            if (ClpRegexEmitCharacterSet(Expression,
+                                         Program,
+                                         Entry,
+                                         Entry->U.String.Data[Index]) ==
+                FALSE) {
+
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+
+    case RegexEntryAnyCharacter:
+    case RegexEntryBracketExpression:
+        return ClpRegexEmitCharacterSet(Expression, Program, Entry, 0);
+
+    case RegexEntrySubexpression:
+        Index = Entry->U.SubexpressionNumber * 2;
+        if ((ClpRegexEmit(Program, RegexInstructionSave, Index) ==
+             REGEX_INVALID_INDEX) ||
+            (ClpRegexEmitEntryList(Expression,
+                                   Program,
+                                   &(Entry->ChildList)) == FALSE) ||
+            (ClpRegexEmit(Program, RegexInstructionSave, Index + 1) ==
+             REGEX_INVALID_INDEX)) {
+
+            return FALSE;
+        }
+
+        return TRUE;
+
+    //
+    // Each option but the last is preceded by a split preferring it, and
+    // followed by a jump to the end. The jumps are chained together through
+    // their next fields until the end is known.
+    //
+
+    case RegexEntryBranch:
+        Chain = REGEX_INVALID_INDEX;
+        CurrentEntry = Entry->ChildList.Next;
+        while (CurrentEntry != &(Entry->ChildList)) {
+            Option = LIST_VALUE(CurrentEntry,
+                                REGULAR_EXPRESSION_ENTRY,
+                                ListEntry);
+
+            CurrentEntry = CurrentEntry->Next;
+
+            assert(Option->Type == RegexEntryBranchOption);
+
+            if (CurrentEntry == &(Entry->ChildList)) {
+                if (ClpRegexEmitEntryList(Expression,
+                                          Program,
+                                          &(Option->ChildList)) == FALSE) {
+
+                    return FALSE;
+                }
+
+                break;
+            }
+
+            Split = ClpRegexEmit(Program, RegexInstructionSplit, 0);
+            if ((Split == REGEX_INVALID_INDEX) ||
+                (ClpRegexEmitEntryList(Expression,
+                                       Program,
+                                       &(Option->ChildList)) == FALSE)) {
+
+                return FALSE;
+            }
+
+            Jump = ClpRegexEmit(Program, RegexInstructionJump, 0);
+            if (Jump == REGEX_INVALID_INDEX) {
+                return FALSE;
+            }
+
+            Program->Instructions[Jump].Next = Chain;
+            Chain = Jump;
+            Program->Instructions[Split].Alternate = Program->InstructionCount;
+        }
+
+        End = Program->InstructionCount;
+        while (Chain != REGEX_INVALID_INDEX) {
+            Previous = Program->Instructions[Chain].Next;
+            Program->Instructions[Chain].Next = End;
+            Chain = Previous;
+        }
+
+        return TRUE;
+
+    case RegexEntryStringBegin:
+        Assertion = REGEX_ASSERT_LINE_BEGIN;
+        break;
+
+    case RegexEntryStringEnd:
+        Assertion = REGEX_ASSERT_LINE_END;
+        break;
+
+    case RegexEntryStartOfWord:
+        Assertion = REGEX_ASSERT_WORD_BEGIN;
+        break;
+
+    case RegexEntryEndOfWord:
+        Assertion = REGEX_ASSERT_WORD_END;
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    if (ClpRegexEmit(Program, RegexInstructionAssert, Assertion) ==
+        REGEX_INVALID_INDEX) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitEntryList (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PLIST_ENTRY ListHead
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for a sequence of entries.
+
+Arguments:
+
+    Expression - Supplies a pointer to the expression being compiled.
+
+    Program - Supplies a pointer to the program being built.
+
+    ListHead - Supplies a pointer to the head of the list of entries.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on failure.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PREGULAR_EXPRESSION_ENTRY Entry;
+
+    CurrentEntry = ListHead->Next;
+    while (CurrentEntry != ListHead) {
+        Entry = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (ClpRegexEmitEntry(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitCharacterSet (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits an instruction that consumes one byte matching the given
+    entry. The set of bytes is found by asking the same questions the
+    backtracking matcher would for every possible byte, so that the two
+    engines agree exactly. Null terminators are never in a set.
+
+Arguments:
+
+    Expression - Supplies a pointer to the expression being compiled.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the ordinary character, any character, or
+        bracket expression entry.
+
+    Character - Supplies the character to match for ordinary character entries.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on failure.
+
+--*/
+
+{
+
+    ULONG Byte;
+    ULONG Index;
+    BOOL Member;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+    REGEX_CHARACTER_SET Set;
+    CHAR Test;
+
+    memset(&Set, 0, sizeof(REGEX_CHARACTER_SET));
+    for (Byte = 1; Byte < 256; Byte += 1) {
+        Test = (CHAR)Byte;
+        Member = FALSE;
+        switch (Entry->Type) {
+        case RegexEntryOrdinaryCharacters:
+            if ((Test == Character) ||
+                (((Expression->Flags & REG_ICASE) != 0) &&
+                 (tolower(Test) == tolower(Character)))) {
+
+                Member = TRUE;
+            }
+
+            break;
+
+        case RegexEntryAnyCharacter:
+            if ((Test != '\n') || ((Expression->Flags & REG_NEWLINE) == 0)) {
+                Member = TRUE;
+            }
+
+            break;
+
+        case RegexEntryBracketExpression:
+            Member = ClpRegularExpressionBracketMatches(Expression,
+                                                        Entry,
+                                                        Test);
+
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            return FALSE;
+        }
+
+        if (Member != FALSE) {
+            REGEX_CHARACTER_SET_ADD(&Set, Byte);
+        }
+    }
+
+    //
+    // Reuse an identical set if there is one, as programs tend to repeat the
+    // same few sets.
+    //
+
+    for (Index = 0; Index < Program->CharacterSetCount; Index += 1) {
+        if (memcmp(&(Program->CharacterSets[Index]),
+                   &Set,
+                   sizeof(REGEX_CHARACTER_SET)) == 0) {
+
+            break;
+        }
+    }
+
+    if (Index == Program->CharacterSetCount) {
+        if (Program->CharacterSetCount == Program->CharacterSetCapacity) {
+            NewCapacity = Program->CharacterSetCapacity * 2;
+            if (NewCapacity == 0) {
+                NewCapacity = REGEX_INITIAL_CHARACTER_SET_CAPACITY;
+            }
+
+            NewBuffer = realloc(Program->CharacterSets,
+                                NewCapacity * sizeof(REGEX_CHARACTER_SET));
+
+            if (NewBuffer == NULL) {
+                return FALSE;
+            }
+
+            Program->CharacterSets = NewBuffer;
+            Program->CharacterSetCapacity = NewCapacity;
+        }
+
+        memcpy(&(Program->CharacterSets[Index]),
+               &Set,
+               sizeof(REGEX_CHARACTER_SET));
+
+        Program->CharacterSetCount += 1;
+    }
+
+    if (ClpRegexEmit(Program, RegexInstructionCharacterSet, Index) ==
+        REGEX_INVALID_INDEX) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+ULONG
+ClpRegexEmit (
+    PREGEX_PROGRAM Program,
+    REGEX_INSTRUCTION_TYPE Type,
+    ULONG Argument
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends an instruction to the program. Both the next and
+    alternate paths are initialized to fall through to the following
+    instruction.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being built.
+
+    Type - Supplies the instruction type.
+
+    Argument - Supplies the instruction argument.
+
+Return Value:
+
+    Returns the index of the new instruction.
+
+    REGEX_INVALID_INDEX if the program is too large or an allocation failed.
+
+--*/
+
+{
+
+    ULONG Index;
+    PREGEX_INSTRUCTION Instruction;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+
+    Index = Program->InstructionCount;
+    if (Index == REGEX_PROGRAM_MAX_SIZE) {
+        return REGEX_INVALID_INDEX;
+    }
+
+    if (Index == Program->InstructionCapacity) {
+        NewCapacity = Program->InstructionCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = REGEX_INITIAL_PROGRAM_CAPACITY;
+        }
+
+        NewBuffer = realloc(Program->Instructions,
+                            NewCapacity * sizeof(REGEX_INSTRUCTION));
+
+        if (NewBuffer == NULL) {
+            return REGEX_INVALID_INDEX;
+        }
+
+        Program->Instructions = NewBuffer;
+        Program->InstructionCapacity = NewCapacity;
+    }
+
+    Instruction = &(Program->Instructions[Index]);
+    Instruction->Type = Type;
+    Instruction->Argument = Argument;
+    Instruction->Next = Index + 1;
+    Instruction->Alternate = Index + 1;
+    Program->InstructionCount += 1;
+    return Index;
+}
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGEX_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine divides the input bytes into classes that the program cannot
+    tell apart. Most expressions only care about a handful of distinct kinds of
+    bytes, which keeps the DFA's transition tables small.
+
+Arguments:
+
+    Program - Supplies a pointer to the completed program.
+
+Return Value:
+
+    None. The byte classes are saved in the program.
+
+--*/
+
+{
+
+    ULONG Byte;
+    REGEX_CONTEXT Context;
+    ULONG Index;
+    REGEX_CHARACTER_SET Newline;
+    REGEX_CHARACTER_SET Word;
+
+    memset(Program->ByteClasses, 0, sizeof(Program->ByteClasses));
+    Program->ByteClassCount = 1;
+
+    //
+    // Start by separating the bytes the assertions treat differently, then
+    // split further by membership in each character set.
+    //
+
+    memset(&Newline, 0, sizeof(REGEX_CHARACTER_SET));
+    memset(&Word, 0, sizeof(REGEX_CHARACTER_SET));
+    for (Byte = 0; Byte < 256; Byte += 1) {
+        Context = ClpRegexClassifyCharacter((CHAR)Byte);
+        if (Context == RegexContextNewline) {
+            REGEX_CHARACTER_SET_ADD(&Newline, Byte);
+
+        } else if (Context == RegexContextWord) {
+            REGEX_CHARACTER_SET_ADD(&Word, Byte);
+        }
+    }
+
+    ClpRegexSplitByteClasses(Program, &Newline);
+    ClpRegexSplitByteClasses(Program, &Word);
+    for (Index = 0; Index < Program->CharacterSetCount; Index += 1) {
+        ClpRegexSplitByteClasses(Program, &(Program->CharacterSets[Index]));
+    }
+
+    return;
+}
+
+VOID
+ClpRegexSplitByteClasses (
+    PREGEX_PROGRAM Program,
+    PREGEX_CHARACTER_SET Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine splits every byte class into the bytes inside and outside of
+    the given set.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    Set - Supplies a pointer to the set to split by.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Byte;
+    ULONG Count;
+    ULONG Key;
+    USHORT NewClass[256 * 2];
+
+    Count = 0;
+    for (Key = 0; Key < (Program->ByteClassCount * 2); Key += 1) {
+        NewClass[Key] = MAX_USHORT;
+    }
+
+    for (Byte = 0; Byte < 256; Byte += 1) {
+        Key = Program->ByteClasses[Byte] * 2;
+        if (REGEX_CHARACTER_SET_CONTAINS(Set, Byte)) {
+            Key += 1;
+        }
+
+        if (NewClass[Key] == MAX_USHORT) {
+            NewClass[Key] = Count;
+            Count += 1;
+        }
+
+        Program->ByteClasses[Byte] = NewClass[Key];
+    }
+
+    Program->ByteClassCount = Count;
+    return;
+}
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates an empty DFA state cache for a finished program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the expression being compiled.
+
+    Program - Supplies a pointer to the completed program.
+
+Return Value:
+
+    Returns a pointer to the new DFA on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    ULONG Count;
+    PREGEX_DFA Dfa;
+
+    Dfa = malloc(sizeof(REGEX_DFA));
+    if (Dfa == NULL) {
+        return NULL;
+    }
+
+    memset(Dfa, 0, sizeof(REGEX_DFA));
+    Count = Program->InstructionCount;
+    Dfa->Marks = malloc(Count * sizeof(ULONG) * 5);
+    if (Dfa->Marks == NULL) {
+        free(Dfa);
+        return NULL;
+    }
+
+    memset(Dfa->Marks, 0, Count * sizeof(ULONG));
+    Dfa->ClassCount = Program->ByteClassCount;
+    Dfa->Stack = Dfa->Marks + Count;
+    Dfa->Consumers = Dfa->Stack + Count;
+    Dfa->NextThreads = Dfa->Consumers + Count;
+    Dfa->SavedThreads = Dfa->NextThreads + Count;
+    if ((Expression->Flags & REG_NEWLINE) != 0) {
+        Dfa->Newline = TRUE;
+    }
+
+    ClpRegexFlushDfa(Dfa);
+    return Dfa;
+}
+
+VOID
+ClpRegexDestroyDfa (
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a DFA state cache.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ClpRegexFlushDfa(Dfa);
+    if (Dfa->States != NULL) {
+        free(Dfa->States);
+    }
+
+    free(Dfa->Marks);
+    free(Dfa);
+    return;
+}
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees all cached DFA states.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA to flush.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    for (Index = 0; Index < Dfa->StateCount; Index += 1) {
+        free(Dfa->States[Index]);
+        Dfa->States[Index] = NULL;
+    }
+
+    Dfa->StateCount = 0;
+    for (Index = 0; Index < RegexContextCount; Index += 1) {
+        Dfa->StartStates[Index] = -1;
+    }
+
+    for (Index = 0; Index < REGEX_DFA_HASH_SIZE; Index += 1) {
+        Dfa->Buckets[Index] = -1;
+    }
+
+    return;
+}
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexDfaSearch (
+    PREGEX_PROGRAM Program,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the program matches anywhere in the
+    given string by running the lazily built DFA over it. Each input byte
+    costs a table lookup once the states it visits have been built.
+
+Arguments:
+
+    Program - Supplies a pointer to the program to run.
+
+    String - Supplies a pointer to the string to search.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+    Flags - Supplies the execution flags.
+
+Return Value:
+
+    Success if there is a match.
+
+    No match if there is no match.
+
+    No memory if the DFA is in use by another thread or a state could not be
+    allocated, in which case the answer is unknown.
+
+--*/
+
+{
+
+    ULONG Class;
+    PREGEX_DFA Dfa;
+    ULONG Index;
+    BOOL Matched;
+    REGEX_CONTEXT Next;
+    REGEX_CONTEXT Previous;
+    ULONG StartThread;
+    LONG StateIndex;
+    REGULAR_EXPRESSION_STATUS Status;
+    LONG Transition;
+
+    //
+    // This code is also built into the build host and Windows support
+    // libraries, so it uses compiler atomics rather than pthreads or the
+    // runtime library to claim the DFA.
+    //
+
+    Dfa = Program->Dfa;
+    if (__sync_lock_test_and_set(&(Dfa->Busy), 1) != 0) {
+        return RegexStatusNoMemory;
+    }
+
+    Status = RegexStatusNoMemory;
+    Previous = ClpRegexGetContext(String, StringSize, 0, TRUE, Flags);
+    StateIndex = Dfa->StartStates[Previous];
+    if (StateIndex < 0) {
+        StartThread = 0;
+        StateIndex = ClpRegexDfaFindState(Dfa, &StartThread, 1, Previous);
+        if (StateIndex < 0) {
+            goto DfaSearchEnd;
+        }
+
+        Dfa->StartStates[Previous] = StateIndex;
+    }
+
+    for (Index = 0; Index < StringSize; Index += 1) {
+        Class = Program->ByteClasses[(UCHAR)String[Index]];
+        Transition = Dfa->States[StateIndex]->Transitions[Class];
+
+        if (Transition == REGEX_DFA_UNKNOWN) {
+            Transition = ClpRegexDfaComputeTransition(Program,
+                                                      Dfa,
+                                                      &StateIndex,
+                                                      (UCHAR)String[Index]);
+
+            if (Transition == REGEX_DFA_UNKNOWN) {
+                goto DfaSearchEnd;
+            }
+        }
+
+        if ((Transition & REGEX_DFA_MATCHED) != 0) {
+            Status = RegexStatusSuccess;
+            goto DfaSearchEnd;
+        }
+
+        StateIndex = Transition >> 1;
+    }
+
+    //
+    // The end of the input is looked at just once per search, so it isn't
+    // worth caching.
+    //
+
+    Next = ClpRegexGetContext(String, StringSize, StringSize, FALSE, Flags);
+    Matched = ClpRegexDfaClosure(Program,
+                                 Dfa,
+                                 Dfa->States[StateIndex],
+                                 Next);
+
+    Status = RegexStatusNoMatch;
+    if (Matched != FALSE) {
+        Status = RegexStatusSuccess;
+    }
+
+DfaSearchEnd:
+    __sync_lock_release(&(Dfa->Busy));
+    return Status;
+}
+
+LONG
+ClpRegexDfaComputeTransition (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    PLONG StateIndex,
+    UCHAR Byte
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes and caches the transition out of a DFA state on the
+    given byte. Since the search is unanchored, the start of the program is
+    added to every state, so a new match attempt begins at each position.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being run.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    StateIndex - Supplies a pointer to the index of the current state. If the
+        state cache has to be flushed, this is updated with the index the
+        current state was rebuilt at.
+
+    Byte - Supplies the next input byte.
+
+Return Value:
+
+    Returns the transition, which is saved for every byte in the same class.
+    See the REGEX_DFA_* definitions.
+
+    REGEX_DFA_UNKNOWN if a state could not be allocated.
+
+--*/
+
+{
+
+    ULONG ConsumerIndex;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG Generation;
+    BOOL Matched;
+    REGEX_CONTEXT Next;
+    LONG NextIndex;
+    ULONG NextThreadCount;
+    ULONG SavedCount;
+    REGEX_CONTEXT SavedPrevious;
+    PREGEX_CHARACTER_SET Set;
+    PREGEX_DFA_STATE State;
+    ULONG Target;
+    LONG Transition;
+
+    State = Dfa->States[*StateIndex];
+    Next = ClpRegexClassifyCharacter((CHAR)Byte);
+    Matched = ClpRegexDfaClosure(Program, Dfa, State, Next);
+
+    //
+    // Step every thread that accepts the byte, then start a new attempt.
+    //
+
+    Generation = ClpRegexDfaNextGeneration(Dfa, Program->InstructionCount);
+    NextThreadCount = 0;
+    for (ConsumerIndex = 0;
+         ConsumerIndex < Dfa->ConsumerCount;
+         ConsumerIndex += 1) {
+
+        Instruction = &(Program->Instructions[Dfa->Consumers[ConsumerIndex]]);
+        Set = &(Program->CharacterSets[Instruction->Argument]);
+        Target = Instruction->Next;
+        if ((REGEX_CHARACTER_SET_CONTAINS(Set, Byte)) &&
+            (Dfa->Marks[Target] != Generation)) {
+
+            Dfa->Marks[Target] = Generation;
+            Dfa->NextThreads[NextThreadCount] = Target;
+            NextThreadCount += 1;
+        }
+    }
+
+    if (Dfa->Marks[0] != Generation) {
+        Dfa->Marks[0] = Generation;
+        Dfa->NextThreads[NextThreadCount] = 0;
+        NextThreadCount += 1;
+    }
+
+    qsort(Dfa->NextThreads,
+          NextThreadCount,
+          sizeof(ULONG),
+          ClpRegexCompareThreads);
+
+    NextIndex = ClpRegexDfaFindState(Dfa,
+                                     Dfa->NextThreads,
+                                     NextThreadCount,
+                                     Next);
+
+    //
+    // If the cache is full, throw it all away and rebuild the current state.
+    //
+
+    if (NextIndex < 0) {
+        if (Dfa->StateCount < REGEX_DFA_MAX_STATES) {
+            return REGEX_DFA_UNKNOWN;
+        }
+
+        SavedCount = State->ThreadCount;
+        SavedPrevious = State->Previous;
+        memcpy(Dfa->SavedThreads, State->Threads, SavedCount * sizeof(ULONG));
+        ClpRegexFlushDfa(Dfa);
+        *StateIndex = ClpRegexDfaFindState(Dfa,
+                                           Dfa->SavedThreads,
+                                           SavedCount,
+                                           SavedPrevious);
+
+        if (*StateIndex < 0) {
+            return REGEX_DFA_UNKNOWN;
+        }
+
+        State = Dfa->States[*StateIndex];
+        NextIndex = ClpRegexDfaFindState(Dfa,
+                                         Dfa->NextThreads,
+                                         NextThreadCount,
+                                         Next);
+
+        if (NextIndex < 0) {
+            return REGEX_DFA_UNKNOWN;
+        }
+    }
+
+    Transition = NextIndex << 1;
+    if (Matched != FALSE) {
+        Transition |= REGEX_DFA_MATCHED;
+    }
+
+    State->Transitions[Program->ByteClasses[Byte]] = Transition;
+    return Transition;
+}
+
+BOOL
+ClpRegexDfaClosure (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    PREGEX_DFA_STATE State,
+    REGEX_CONTEXT Next
+    )
+
+/*++
+
+Routine Description:
+
+    This routine follows all the empty transitions out of the threads in a
+    DFA state, collecting the character set instructions reached into the
+    DFA's consumer array.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being run.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    State - Supplies a pointer to the state to close over.
+
+    Next - Supplies the context of the byte after the state.
+
+Return Value:
+
+    TRUE if a match instruction was reached.
+
+    FALSE if no match instruction was reached.
+
+--*/
+
+{
+
+    ULONG Generation;
+    PREGEX_INSTRUCTION Instruction;
+    BOOL Matched;
+    ULONG Pc;
+    ULONG StackSize;
+    ULONG ThreadIndex;
+
+    Generation = ClpRegexDfaNextGeneration(Dfa, Program->InstructionCount);
+    Dfa->ConsumerCount = 0;
+    Matched = FALSE;
+    StackSize = 0;
+    for (ThreadIndex = 0; ThreadIndex < State->ThreadCount; ThreadIndex += 1) {
+        Pc = State->Threads[ThreadIndex];
+        if (Dfa->Marks[Pc] != Generation) {
+            Dfa->Marks[Pc] = Generation;
+            Dfa->Stack[StackSize] = Pc;
+            StackSize += 1;
+        }
+    }
+
+    //
+    // Each instruction is marked as it is pushed, so the stack never holds
+    // more than one entry per instruction.
+    //
+
+    while (StackSize != 0) {
+        StackSize -= 1;
+        Pc = Dfa->Stack[StackSize];
+        Instruction = &(Program->Instructions[Pc]);
+        switch (Instruction->Type) {
+        case RegexInstructionCharacterSet:
+            Dfa->Consumers[Dfa->ConsumerCount] = Pc;
+            Dfa->ConsumerCount += 1;
+            continue;
+
+        case RegexInstructionMatch:
+            Matched = TRUE;
+            continue;
+
+        case RegexInstructionSplit:
+            if (Dfa->Marks[Instruction->Alternate] != Generation) {
+                Dfa->Marks[Instruction->Alternate] = Generation;
+                Dfa->Stack[StackSize] = Instruction->Alternate;
+                StackSize += 1;
+            }
+
+            break;
+
+        //
+        // The DFA has no slots, so it lets progress checks through. That
+        // only keeps paths through empty iterations, which never match
+        // anything that skipping the iteration wouldn't.
+        //
+
+        case RegexInstructionJump:
+        case RegexInstructionSave:
+        case RegexInstructionProgress:
+            break;
+
+        case RegexInstructionAssert:
+            if (ClpRegexCheckAssertion(Instruction->Argument,
+                                       State->Previous,
+                                       Next,
+                                       Dfa->Newline) == FALSE) {
+
+                continue;
+            }
+
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            continue;
+        }
+
+        if (Dfa->Marks[Instruction->Next] != Generation) {
+            Dfa->Marks[Instruction->Next] = Generation;
+            Dfa->Stack[StackSize] = Instruction->Next;
+            StackSize += 1;
+        }
+    }
+
+    return Matched;
+}
+
+LONG
+ClpRegexDfaFindState (
+    PREGEX_DFA Dfa,
+    PULONG Threads,
+    ULONG ThreadCount,
+    REGEX_CONTEXT Previous
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the cached DFA state with the given threads and
+    previous context, creating it if it does not exist.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA.
+
+    Threads - Supplies the sorted array of program counters in the state.
+
+    ThreadCount - Supplies the number of elements in the threads array.
+
+    Previous - Supplies the context of the byte before the state.
+
+Return Value:
+
+    Returns the index of the state.
+
+    -1 if the state cache is full or an allocation failed.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    ULONG Hash;
+    ULONG Index;
+    ULONG NewCapacity;
+    PREGEX_DFA_STATE *NewStates;
+    LONG StateIndex;
+    PREGEX_DFA_STATE State;
+
+    Hash = 2166136261U ^ Previous;
+    for (Index = 0; Index < ThreadCount; Index += 1) {
+        Hash = (Hash ^ Threads[Index]) * 16777619U;
+    }
+
+    Bucket = Hash & (REGEX_DFA_HASH_SIZE - 1);
+    StateIndex = Dfa->Buckets[Bucket];
+    while (StateIndex >= 0) {
+        State = Dfa->States[StateIndex];
+        if ((State->Hash == Hash) &&
+            (State->Previous == Previous) &&
+            (State->ThreadCount == ThreadCount) &&
+            (memcmp(State->Threads,
+                    Threads,
+                    ThreadCount * sizeof(ULONG)) == 0)) {
+
+            return StateIndex;
+        }
+
+        StateIndex = State->NextInBucket;
+    }
+
+    if (Dfa->StateCount == REGEX_DFA_MAX_STATES) {
+        return -1;
+    }
+
+    if (Dfa->StateCount == Dfa->StateCapacity) {
+        NewCapacity = Dfa->StateCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = REGEX_DFA_INITIAL_STATE_CAPACITY;
+        }
+
+        NewStates = realloc(Dfa->States, NewCapacity * sizeof(PVOID));
+        if (NewStates == NULL) {
+            return -1;
+        }
+
+        Dfa->States = NewStates;
+        Dfa->StateCapacity = NewCapacity;
+    }
+
+    //
+    // Allocate the state, its transitions, and its threads together.
+    //
+
+    State = malloc(sizeof(REGEX_DFA_STATE) +
+                   (Dfa->ClassCount * sizeof(LONG)) +
+                   (ThreadCount * sizeof(ULONG)));
+
+    if (State == NULL) {
+        return -1;
+    }
+
+    State->Threads = (PULONG)&(State->Transitions[Dfa->ClassCount]);
+    memcpy(State->Threads, Threads, ThreadCount * sizeof(ULONG));
+    State->ThreadCount = ThreadCount;
+    State->Previous = Previous;
+    State->Hash = Hash;
+    State->NextInBucket = Dfa->Buckets[Bucket];
+    for (Index = 0; Index < Dfa->ClassCount; Index += 1) {
+        State->Transitions[Index] = REGEX_DFA_UNKNOWN;
+    }
+
+    StateIndex = Dfa->StateCount;
+    Dfa->States[StateIndex] = State;
+    Dfa->StateCount += 1;
+    Dfa->Buckets[Bucket] = StateIndex;
+    return StateIndex;
+}
+
+ULONG
+ClpRegexDfaNextGeneration (
+    PREGEX_DFA Dfa,
+    ULONG InstructionCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts a new visit generation, which effectively clears all
+    the marks without touching them.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA.
+
+    InstructionCount - Supplies the number of instructions in the program.
+
+Return Value:
+
+    Returns the new generation.
+
+--*/
+
+{
+
+    Dfa->Generation += 1;
+    if (Dfa->Generation == 0) {
+        memset(Dfa->Marks, 0, InstructionCount * sizeof(ULONG));
+        Dfa->Generation = 1;
+    }
+
+    return Dfa->Generation;
+}
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexPikeSearch (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the match and subexpression positions by running all
+    threads of the program in lockstep over the input. Threads are kept in
+    priority order, so the match found is the same one the backtracking
+    matcher would find: the leftmost, preferring earlier options and longer
+    repetitions.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression.
+
+    String - Supplies a pointer to the string to search.
+
+    StringSize - Supplies the length of the string, not including the null
+        terminator.
+
+    Match - Supplies an optional pointer to an array where the string indices of
+        the match and its subexpressions will be returned.
+
+    MatchArraySize - Supplies the number of elements in the match array.
+
+    Flags - Supplies the execution flags.
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory if the search could not allocate its working memory.
+
+--*/
+
+{
+
+    PVOID Buffer;
+    UCHAR Byte;
+    REGEX_PIKE_CONTEXT Context;
+    PREGEX_THREAD_LIST Current;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG ListIndex;
+    size_t MatchIndex;
+    BOOL Matched;
+    PREGEX_THREAD_LIST NextList;
+    ULONG Position;
+    PREGEX_PROGRAM Program;
+    ULONG SlotCount;
+    ULONG SlotIndex;
+    size_t SlotsSize;
+    size_t ThreadSize;
+    regoff_t *ThreadSlots;
+
+    Program = Expression->Program;
+    SlotCount = Program->SlotCount;
+
+    //
+    // Carve all the working memory out of one allocation.
+    //
+
+    ThreadSize = Program->InstructionCount * sizeof(ULONG);
+    SlotsSize = Program->InstructionCount * SlotCount * sizeof(regoff_t);
+    Buffer = malloc((ThreadSize * 4) + (SlotsSize * 2) +
+                    (((Program->InstructionCount * 2) + 1) *
+                     sizeof(REGEX_PIKE_FRAME)) +
+                    (SlotCount * 2 * sizeof(regoff_t)));
+
+    if (Buffer == NULL) {
+        return RegexStatusNoMemory;
+    }
+
+    Context.Program = Program;
+    Context.Input = String;
+    Context.InputSize = StringSize;
+    Context.Newline = FALSE;
+    if ((Expression->Flags & REG_NEWLINE) != 0) {
+        Context.Newline = TRUE;
+    }
+
+    Context.Flags = Flags;
+    Context.Stack = Buffer;
+    Context.Slots = (regoff_t *)(Context.Stack +
+                                 (Program->InstructionCount * 2) + 1);
+
+    Context.Best = Context.Slots + SlotCount;
+    Context.Lists[0].Slots = Context.Best + SlotCount;
+    Context.Lists[1].Slots = (regoff_t *)((PUCHAR)Context.Lists[0].Slots +
+                                          SlotsSize);
+
+    Context.Lists[0].Dense = (PULONG)((PUCHAR)Context.Lists[1].Slots +
+                                      SlotsSize);
+
+    Context.Lists[0].Sparse = Context.Lists[0].Dense +
+                              Program->InstructionCount;
+
+    Context.Lists[1].Dense = Context.Lists[0].Sparse +
+                             Program->InstructionCount;
+
+    Context.Lists[1].Sparse = Context.Lists[1].Dense +
+                              Program->InstructionCount;
+
+    memset(Context.Lists[0].Dense, 0, ThreadSize * 4);
+    Context.Lists[0].Count = 0;
+    Context.Lists[1].Count = 0;
+    Current = &(Context.Lists[0]);
+    NextList = &(Context.Lists[1]);
+    Matched = FALSE;
+    for (Position = 0; Position <= StringSize; Position += 1) {
+
+        //
+        // Start a new attempt here unless a match has already been found, in
+        // which case only attempts that started further left can beat it.
+        // The new attempt goes at the end, since it has the lowest priority.
+        //
+
+        if (Matched == FALSE) {
+            for (SlotIndex = 0; SlotIndex < SlotCount; SlotIndex += 1) {
+                Context.Slots[SlotIndex] = -1;
+            }
+
+            ClpRegexPikeAddThread(&Context, Current, 0, Position);
+        }
+
+        if (Current->Count == 0) {
+            break;
+        }
+
+        Byte = 0;
+        if (Position < StringSize) {
+            Byte = (UCHAR)String[Position];
+        }
+
+        NextList->Count = 0;
+        for (ListIndex = 0; ListIndex < Current->Count; ListIndex += 1) {
+            Instruction = &(Program->Instructions[Current->Dense[ListIndex]]);
+            ThreadSlots = Current->Slots + (ListIndex * SlotCount);
+
+            //
+            // A match beats all the lower priority threads after it, so cut
+            // them off.
+            //
+
+            if (Instruction->Type == RegexInstructionMatch) {
+                memcpy(Context.Best, ThreadSlots, SlotCount * sizeof(regoff_t));
+                Matched = TRUE;
+                break;
+            }
+
+            //
+            // The list also holds the empty transitions visited on the way,
+            // which have nothing left to do.
+            //
+
+            if (Instruction->Type != RegexInstructionCharacterSet) {
+                continue;
+            }
+
+            if ((Position < StringSize) &&
+                (REGEX_CHARACTER_SET_CONTAINS(
+                        &(Program->CharacterSets[Instruction->Argument]),
+                        Byte))) {
+
+                memcpy(Context.Slots,
+                       ThreadSlots,
+                       SlotCount * sizeof(regoff_t));
+
+                ClpRegexPikeAddThread(&Context,
+                                      NextList,
+                                      Instruction->Next,
+                                      Position + 1);
+            }
+        }
+
+        Current = NextList;
+        NextList = &(Context.Lists[0]);
+        if (Current == NextList) {
+            NextList = &(Context.Lists[1]);
+        }
+    }
+
+    if ((Matched != FALSE) && ((Expression->Flags & REG_NOSUB) == 0)) {
+        for (MatchIndex = 0; MatchIndex < MatchArraySize; MatchIndex += 1) {
+            Match[MatchIndex].rm_so = -1;
+            Match[MatchIndex].rm_eo = -1;
+            if (MatchIndex <= Expression->SubexpressionCount) {
+                if ((Context.Best[MatchIndex * 2] != -1) &&
+                    (Context.Best[(MatchIndex * 2) + 1] != -1)) {
+
+                    Match[MatchIndex].rm_so = Context.Best[MatchIndex * 2];
+                    Match[MatchIndex].rm_eo =
+                                            Context.Best[(MatchIndex * 2) + 1];
+                }
+            }
+        }
+    }
+
+    free(Buffer);
+    if (Matched == FALSE) {
+        return RegexStatusNoMatch;
+    }
+
+    return RegexStatusSuccess;
+}
+
+VOID
+ClpRegexPikeAddThread (
+    PREGEX_PIKE_CONTEXT Context,
+    PREGEX_THREAD_LIST List,
+    ULONG Pc,
+    ULONG Position
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a thread to a list, following its empty transitions in
+    priority order. Threads reaching an instruction already on the list are
+    dropped, since the thread already there has higher priority. A thread
+    reaching a character set or match instruction is given a copy of the
+    working match slots.
+
+Arguments:
+
+    Context - Supplies a pointer to the search context. The working slots
+        hold the slots of the thread being added, and are restored on return.
+
+    List - Supplies a pointer to the list to add the thread to.
+
+    Pc - Supplies the program counter of the new thread.
+
+    Position - Supplies the input position the thread is at.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PREGEX_PIKE_FRAME Frame;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG ListIndex;
+    REGEX_CONTEXT Next;
+    REGEX_CONTEXT Previous;
+    PREGEX_PROGRAM Program;
+    ULONG StackSize;
+
+    Program = Context->Program;
+    Context->Stack[0].Pc = Pc;
+    Context->Stack[0].Slot = -1;
+    StackSize = 1;
+    while (StackSize != 0) {
+        StackSize -= 1;
+        Frame = &(Context->Stack[StackSize]);
+        if (Frame->Slot >= 0) {
+            Context->Slots[Frame->Slot] = Frame->Value;
+            continue;
+        }
+
+        Pc = Frame->Pc;
+        if (REGEX_THREAD_LIST_CONTAINS(List, Pc)) {
+            continue;
+        }
+
+        ListIndex = List->Count;
+        List->Dense[ListIndex] = Pc;
+        List->Sparse[Pc] = ListIndex;
+        List->Count += 1;
+        Instruction = &(Program->Instructions[Pc]);
+        switch (Instruction->Type) {
+        case RegexInstructionCharacterSet:
+        case RegexInstructionMatch:
+            memcpy(List->Slots + (ListIndex * Program->SlotCount),
+                   Context->Slots,
+                   Program->SlotCount * sizeof(regoff_t));
+
+            continue;
+
+        //
+        // Push the alternate first so that the preferred path is explored
+        // first.
+        //
+
+        case RegexInstructionSplit:
+            Context->Stack[StackSize].Pc = Instruction->Alternate;
+            Context->Stack[StackSize].Slot = -1;
+            StackSize += 1;
+            break;
+
+        case RegexInstructionJump:
+            break;
+
+        //
+        // Record the position, and arrange for the old value to come back
+        // once everything reachable from here has been explored.
+        //
+
+        case RegexInstructionSave:
+            Context->Stack[StackSize].Slot = Instruction->Argument;
+            Context->Stack[StackSize].Value =
+                                       Context->Slots[Instruction->Argument];
+
+            StackSize += 1;
+            Context->Slots[Instruction->Argument] = Position;
+            break;
+
+        //
+        // Drop the thread if the iteration it just finished matched nothing.
+        //
+
+        case RegexInstructionProgress:
+            if (Context->Slots[Instruction->Argument] == (regoff_t)Position) {
+                continue;
+            }
+
+            break;
+
+        case RegexInstructionAssert:
+            Previous = ClpRegexGetContext(Context->Input,
+                                          Context->InputSize,
+                                          Position,
+                                          TRUE,
+                                          Context->Flags);
+
+            Next = ClpRegexGetContext(Context->Input,
+                                      Context->InputSize,
+                                      Position,
+                                      FALSE,
+                                      Context->Flags);
+
+            if (ClpRegexCheckAssertion(Instruction->Argument,
+                                       Previous,
+                                       Next,
+                                       Context->Newline) == FALSE) {
+
+                continue;
+            }
+
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            continue;
+        }
+
+        Context->Stack[StackSize].Pc = Instruction->Next;
+        Context->Stack[StackSize].Slot = -1;
+        StackSize += 1;
+    }
+
+    return;
+}
+
+REGEX_CONTEXT
+ClpRegexGetContext (
+    PSTR String,
+    ULONG StringSize,
+    ULONG Position,
+    BOOL Previous,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine classifies the character on one side of a position in the
+    input. The beginning and end of the input count as boundaries unless
+    REG_NOTBOL or REG_NOTEOL say otherwise, in which case they are just
+    ordinary non-word characters.
+
+Arguments:
+
+    String - Supplies a pointer to the input string.
+
+    StringSize - Supplies the length of the input, not including the
+        terminator.
+
+    Position - Supplies the position to look around.
+
+    Previous - Supplies a boolean indicating whether to classify the character
+        before the position (TRUE) or the character at it (FALSE).
+
+    Flags - Supplies the execution flags.
+
+Return Value:
+
+    Returns the context of the character.
+
+--*/
+
+{
+
+    CHAR Character;
+
+    if (Previous != FALSE) {
+        if (Position == 0) {
+            if ((Flags & REG_NOTBOL) != 0) {
+                return RegexContextOther;
+            }
+
+            return RegexContextBoundary;
+        }
+
+        Character = String[Position - 1];
+
+    } else {
+        if (Position == StringSize) {
+            if ((Flags & REG_NOTEOL) != 0) {
+                return RegexContextOther;
+            }
+
+            return RegexContextBoundary;
+        }
+
+        Character = String[Position];
+    }
+
+    return ClpRegexClassifyCharacter(Character);
+}
+
+REGEX_CONTEXT
+ClpRegexClassifyCharacter (
+    CHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine classifies an input character for the zero-width assertions.
+
+Arguments:
+
+    Character - Supplies the character to classify.
+
+Return Value:
+
+    Returns the context of the character.
+
+--*/
+
+{
+
+    if (Character == '\n') {
+        return RegexContextNewline;
+    }
+
+    if (REGULAR_EXPRESSION_IS_NAME(Character)) {
+        return RegexContextWord;
+    }
+
+    return RegexContextOther;
+}
+
+BOOL
+ClpRegexCheckAssertion (
+    ULONG Assertion,
+    REGEX_CONTEXT Previous,
+    REGEX_CONTEXT Next,
+    BOOL Newline
+    )
+
+/*++
+
+Routine Description:
+
+    This routine evaluates a zero-width assertion at a position.
+
+Arguments:
+
+    Assertion - Supplies the REGEX_ASSERT_* value to check.
+
+    Previous - Supplies the context of the character before the position.
+
+    Next - Supplies the context of the character at the position.
+
+    Newline - Supplies a boolean indicating if REG_NEWLINE is set, in which
+        case newlines also begin and end lines.
+
+Return Value:
+
+    TRUE if the assertion holds.
+
+    FALSE if the assertion does not hold.
+
+--*/
+
+{
+
+    switch (Assertion) {
+    case REGEX_ASSERT_LINE_BEGIN:
+        if ((Previous == RegexContextBoundary) ||
+            ((Newline != FALSE) && (Previous == RegexContextNewline))) {
+
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_LINE_END:
+        if ((Next == RegexContextBoundary) ||
+            ((Newline != FALSE) && (Next == RegexContextNewline))) {
+
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_WORD_BEGIN:
+        if ((Next == RegexContextWord) && (Previous != RegexContextWord)) {
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_WORD_END:
+        if ((Previous == RegexContextWord) && (Next != RegexContextWord)) {
+            return TRUE;
+        }
+
+        break;
+
+    default:
+
+        assert(FALSE);
+
+        break;
+    }
+
+    return FALSE;
+}
+
+int
+ClpRegexCompareThreads (
+    const void *Left,
+    const void *Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two program counters, for sorting DFA states into a
+    canonical order.
+
+Arguments:
+
+    Left - Supplies a pointer to the left program counter.
+
+    Right - Supplies a pointer to the right program counter.
+
+Return Value:
+
+    Less than zero if the left is less than the right.
+
+    Zero if they are equal.
+
+    Greater than zero if the left is greater than the right.
+
+--*/
+
+{
+
+    ULONG LeftValue;
+    ULONG RightValue;
+
+    LeftValue = *((PULONG)Left);
+    RightValue = *((PULONG)Right);
+    if (LeftValue < RightValue) {
+        return -1;
+    }
+
+    if (LeftValue > RightValue) {
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -33,6 +33,7 @@ Module Name:
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <spawn.h>
 #include <stdlib.h>
 #include <sys/wait.h>
@@ -42,6 +43,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the value a vfork child reports back when the image turned out not
+// to be a binary, and the slower fork path should take over.
+//
+
+#define SPAWN_RETRY_WITH_FORK (-1)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -210,6 +218,29 @@ ClpPosixSpawn (
     BOOL UsePath
     );
 
+INT
+ClpPosixSpawnVfork (
+    pid_t *ChildPid,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    PPROCESS_ENVIRONMENT ImageEnvironment
+    );
+
+PPROCESS_ENVIRONMENT
+ClpCreateSpawnEnvironment (
+    const char *Path,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath
+    );
+
+INT
+ClpSetUpSpawnChild (
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    const sigset_t *OriginalMask
+    );
+
 INT
 ClpProcessSpawnAttributes (
     PPOSIX_SPAWN_ATTRIBUTES Attributes
@@ -1185,10 +1216,39 @@ Return Value:
 {
 
     volatile int Error;
+    PPROCESS_ENVIRONMENT ImageEnvironment;
     pid_t Pid;
 
+    if (Environment == NULL) {
+        Environment = environ;
+    }
+
     //
-    // TODO: Use vfork when it is implemented.
+    // Try the fast path first: build everything the exec needs up front, then
+    // vfork so that the address space of a large parent is not copied only to
+    // be thrown away a moment later.
+    //
+
+    ImageEnvironment = ClpCreateSpawnEnvironment(Path,
+                                                 Arguments,
+                                                 Environment,
+                                                 UsePath);
+
+    if (ImageEnvironment != NULL) {
+        Error = ClpPosixSpawnVfork(ChildPid,
+                                   FileActions,
+                                   Attributes,
+                                   ImageEnvironment);
+
+        OsDestroyEnvironment(ImageEnvironment);
+        if (Error != SPAWN_RETRY_WITH_FORK) {
+            return Error;
+        }
+    }
+
+    //
+    // Fall back to a full fork for things like interpreter scripts, which
+    // need more help from the C library to execute.
     //
 
     Error = 0;
@@ -1197,9 +1257,7 @@ Return Value:
         return errno;
 
     //
-    // In the child, process the attributes and execute the image. With vfork,
-    // the values set in error here will be accessible by the parent, since
-    // vfork temporarily shares the memory of the parent.
+    // In the child, process the attributes and execute the image.
     //
 
     } else if (Pid == 0) {
@@ -1217,10 +1275,6 @@ Return Value:
             }
         }
 
-        if (Environment == NULL) {
-            Environment = environ;
-        }
-
         if (UsePath != FALSE) {
             execvpe(Path, Arguments, Environment);
 
@@ -1240,26 +1294,311 @@ Return Value:
     //
 
     } else {
+        if (ChildPid != NULL) {
+            *ChildPid = Pid;
+        }
+    }
 
-        //
-        // If the child had a problem, then with vfork the error variable will
-        // be set, and this routine can return a more detailed status. Reap the
-        // child here.
-        //
+    return Error;
+}
 
-        if (Error != 0) {
-            waitpid(Pid, NULL, 0);
+INT
+ClpPosixSpawnVfork (
+    pid_t *ChildPid,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    PPROCESS_ENVIRONMENT ImageEnvironment
+    )
 
-        } else {
-            if (ChildPid != NULL) {
-                *ChildPid = Pid;
+/*++
+
+Routine Description:
+
+    This routine spawns a child using vfork. The child shares the parent's
+    memory until it executes the new image, so it is careful to only make
+    system calls and never touch the parent's heap or C library state.
+
+Arguments:
+
+    ChildPid - Supplies an optional pointer where the child process ID will be
+        returned on success.
+
+    FileActions - Supplies an optional pointer to the file actions to execute
+        in the child.
+
+    Attributes - Supplies an optional pointer to the spawn attributes.
+
+    ImageEnvironment - Supplies a pointer to the fully formed image
+        environment to execute.
+
+Return Value:
+
+    0 on success.
+
+    SPAWN_RETRY_WITH_FORK if the image was not a binary the kernel could run
+    directly. The child has been reaped.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    sigset_t AllSignals;
+    volatile int Error;
+    sigset_t OriginalMask;
+    pid_t Pid;
+    KSTATUS Status;
+
+    //
+    // Block all signals so that none of the parent's handlers run in the
+    // child on the shared stack. The child puts the mask back once it has
+    // reset its handlers.
+    //
+
+    sigfillset(&AllSignals);
+    sigprocmask(SIG_SETMASK, &AllSignals, &OriginalMask);
+    Error = 0;
+    Pid = vfork();
+    if (Pid == 0) {
+        Error = ClpSetUpSpawnChild(FileActions, Attributes, &OriginalMask);
+        if (Error == 0) {
+            Status = OsExecuteImage(ImageEnvironment);
+            if (Status == STATUS_UNKNOWN_IMAGE_FORMAT) {
+                Error = SPAWN_RETRY_WITH_FORK;
+
+            } else {
+                Error = ClConvertKstatusToErrorNumber(Status);
             }
         }
+
+        _exit(127);
     }
 
+    //
+    // The child is done with the memory by the time vfork returns in the
+    // parent, so any error it stored is now visible. Reap failed children
+    // here so they do not linger as zombies.
+    //
+
+    if (Pid == -1) {
+        Error = errno;
+
+    } else if (Error != 0) {
+        waitpid(Pid, NULL, 0);
+
+    } else if (ChildPid != NULL) {
+        *ChildPid = Pid;
+    }
+
+    sigprocmask(SIG_SETMASK, &OriginalMask, NULL);
     return Error;
 }
 
+PPROCESS_ENVIRONMENT
+ClpCreateSpawnEnvironment (
+    const char *Path,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resolves the path to the image to spawn and creates the
+    environment needed to execute it, so that the child does not have to.
+
+Arguments:
+
+    Path - Supplies a pointer to the file path to execute.
+
+    Arguments - Supplies the arguments to pass to the new child.
+
+    Environment - Supplies the environment to pass to the new child.
+
+    UsePath - Supplies a boolean indicating whether to search the PATH
+        variable for the executable.
+
+Return Value:
+
+    Returns a pointer to the image environment on success. The caller is
+    responsible for destroying it.
+
+    NULL if the path could not be resolved or on allocation failure. The
+    caller should fall back to the exec functions.
+
+--*/
+
+{
+
+    UINTN ArgumentCount;
+    UINTN ArgumentsLength;
+    PCSTR Current;
+    UINTN EnvironmentCount;
+    UINTN EnvironmentLength;
+    size_t FileLength;
+    PCSTR PathEntry;
+    size_t PathEntryLength;
+    PSTR PathVariable;
+    PPROCESS_ENVIRONMENT ProcessEnvironment;
+    char ResolvedPath[PATH_MAX];
+
+    //
+    // Search the PATH the same way execvpe does, taking the first executable
+    // match. Leave the strange cases to execvpe.
+    //
+
+    PathVariable = NULL;
+    if (UsePath != FALSE) {
+        PathVariable = getenv("PATH");
+    }
+
+    if ((strchr(Path, '/') == NULL) && (PathVariable != NULL) &&
+        (*PathVariable != '\0')) {
+
+        FileLength = strlen(Path);
+        Current = PathVariable;
+        while (TRUE) {
+            PathEntry = Current;
+            while ((*Current != ':') && (*Current != '\0')) {
+                Current += 1;
+            }
+
+            PathEntryLength = Current - PathEntry;
+            if (PathEntryLength == 0) {
+                PathEntry = ".";
+                PathEntryLength = 1;
+            }
+
+            if (PathEntry[PathEntryLength - 1] == '/') {
+                PathEntryLength -= 1;
+            }
+
+            if (PathEntryLength + FileLength + 2 <= sizeof(ResolvedPath)) {
+                memcpy(ResolvedPath, PathEntry, PathEntryLength);
+                ResolvedPath[PathEntryLength] = '/';
+                strcpy(ResolvedPath + PathEntryLength + 1, Path);
+                if (access(ResolvedPath, X_OK) == 0) {
+                    break;
+                }
+            }
+
+            if (*Current == '\0') {
+                return NULL;
+            }
+
+            Current += 1;
+        }
+
+        Path = ResolvedPath;
+    }
+
+    ArgumentCount = 0;
+    ArgumentsLength = 0;
+    while (Arguments[ArgumentCount] != NULL) {
+        ArgumentsLength += strlen(Arguments[ArgumentCount]) + 1;
+        ArgumentCount += 1;
+    }
+
+    EnvironmentCount = 0;
+    EnvironmentLength = 0;
+    if (Environment != NULL) {
+        while (Environment[EnvironmentCount] != NULL) {
+            EnvironmentLength += strlen(Environment[EnvironmentCount]) + 1;
+            EnvironmentCount += 1;
+        }
+    }
+
+    ProcessEnvironment = OsCreateEnvironment((PSTR)Path,
+                                             strlen(Path) + 1,
+                                             (PSTR *)Arguments,
+                                             ArgumentsLength,
+                                             ArgumentCount,
+                                             (PSTR *)Environment,
+                                             EnvironmentLength,
+                                             EnvironmentCount);
+
+    return ProcessEnvironment;
+}
+
+INT
+ClpSetUpSpawnChild (
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    const sigset_t *OriginalMask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine prepares a vfork child for executing its new image. It runs
+    with all signals blocked.
+
+Arguments:
+
+    FileActions - Supplies an optional pointer to the file actions to execute.
+
+    Attributes - Supplies an optional pointer to the spawn attributes.
+
+    OriginalMask - Supplies a pointer to the signal mask the parent had before
+        all signals were blocked.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    INT Error;
+    SIGNAL_SET HandledSignals;
+
+    //
+    // The signal handlers all live in the parent. Send every handled signal
+    // back to the default disposition before unblocking anything. Ignored
+    // signals stay ignored across the exec.
+    //
+
+    INITIALIZE_SIGNAL_SET(HandledSignals);
+    HandledSignals = OsSetSignalBehavior(SignalMaskHandled,
+                                         SignalMaskOperationNone,
+                                         &HandledSignals);
+
+    OsSetSignalBehavior(SignalMaskHandled,
+                        SignalMaskOperationClear,
+                        &HandledSignals);
+
+    if (Attributes != NULL) {
+        Error = ClpProcessSpawnAttributes(*Attributes);
+        if (Error != 0) {
+            return Error;
+        }
+    }
+
+    if ((Attributes == NULL) ||
+        (((*Attributes)->Flags & POSIX_SPAWN_SETSIGMASK) == 0)) {
+
+        if (sigprocmask(SIG_SETMASK, OriginalMask, NULL) != 0) {
+            return errno;
+        }
+    }
+
+    if (FileActions != NULL) {
+        Error = ClpProcessSpawnFileActions(*FileActions);
+        if (Error != 0) {
+            return Error;
+        }
+    }
+
+    return 0;
+}
+
 INT
 ClpProcessSpawnAttributes (
     PPOSIX_SPAWN_ATTRIBUTES Attributes
@@ -1270,7 +1609,8 @@ ClpProcessSpawnAttributes (
 Routine Description:
 
     This routine performs the actions specified by the given posix spawn
-    attributes.
+    attributes. This routine may run in a vfork child, so it only changes
+    the state of the kernel, and never the C library's own bookkeeping.
 
 Arguments:
 
@@ -1286,8 +1626,9 @@ Return Value:
 
 {
 
-    struct sigaction Action;
-    int Signal;
+    SIGNAL_SET DefaultSignals;
+    THREAD_IDENTITY Identity;
+    KSTATUS Status;
 
     if ((Attributes->Flags & POSIX_SPAWN_SETPGROUP) != 0) {
         if (setpgid(0, Attributes->ProcessGroup) != 0) {
@@ -1299,13 +1640,21 @@ Return Value:
     // TODO: Set the scheduler policy and scheduler parameter.
     //
 
-    if ((Attributes->Flags & POSIX_SPAWN_RESETIDS) != 0) {
-        if (setegid(getgid()) != 0) {
-            return errno;
-        }
+    //
+    // Set the identity directly rather than with setegid and seteuid, which
+    // update the C library's cached identity and poke every other thread.
+    //
 
-        if (seteuid(getuid()) != 0) {
-            return errno;
+    if ((Attributes->Flags & POSIX_SPAWN_RESETIDS) != 0) {
+        memset(&Identity, 0, sizeof(THREAD_IDENTITY));
+        Identity.EffectiveGroupId = getgid();
+        Identity.EffectiveUserId = getuid();
+        Status = OsSetThreadIdentity(THREAD_IDENTITY_FIELD_EFFECTIVE_GROUP_ID |
+                                     THREAD_IDENTITY_FIELD_EFFECTIVE_USER_ID,
+                                     &Identity);
+
+        if (!KSUCCESS(Status)) {
+            return ClConvertKstatusToErrorNumber(Status);
         }
     }
 
@@ -1317,19 +1666,15 @@ Return Value:
 
     //
     // If desired, reset any signals mentioned in the default mask back to
-    // the default disposition.
+    // the default disposition. Clearing the handled bits in the kernel also
+    // clears the ignored bits. The exec resets the handler table anyway.
     //
 
     if ((Attributes->Flags & POSIX_SPAWN_SETSIGDEF) != 0) {
-        memset(&Action, 0, sizeof(Action));
-        Action.sa_handler = SIG_DFL;
-        for (Signal = 1; Signal < NSIG; Signal += 1) {
-            if (sigismember(&(Attributes->DefaultMask), Signal) != 0) {
-                if (sigaction(Signal, &Action, NULL) != 0) {
-                    return errno;
-                }
-            }
-        }
+        DefaultSignals = Attributes->DefaultMask;
+        OsSetSignalBehavior(SignalMaskHandled,
+                            SignalMaskOperationClear,
+                            &DefaultSignals);
     }
 
     return 0;
@@ -62,6 +62,21 @@ Module Name:
 
 #define STREAM_PRINT_BUFFER_SIZE 128
 
+//
+// Define the minimum buffer size for streams on regular files. The buffer is
+// a whole number of the file's preferred I/O blocks of at least this size.
+// Other streams use BUFSIZ.
+//
+
+#define STREAM_FILE_BUFFER_SIZE (32 * 1024)
+
+//
+// Define the largest preferred block size that is honored when sizing a
+// stream buffer.
+//
+
+#define STREAM_MAX_BLOCK_SIZE (256 * 1024)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -112,6 +127,11 @@ ClpDestroyFileStructure (
     PFILE File
     );
 
+ULONG
+ClpGetStreamBufferSize (
+    ULONG Descriptor
+    );
+
 BOOL
 ClpFileFormatWriteCharacter (
     INT Character,
@@ -1696,6 +1716,27 @@ Return Value:
     ssize_t Result;
 
     ORIENT_STREAM(Stream, FILE_FLAG_BYTE_ORIENTED);
+
+    //
+    // Take the byte straight out of the buffer if the stream is reading and
+    // has data buffered. Everything else goes the long way around.
+    //
+
+    if (((Stream->Flags &
+          (FILE_FLAG_READ_LAST | FILE_FLAG_UNGET_VALID)) ==
+         FILE_FLAG_READ_LAST) &&
+        (Stream->BufferNextIndex < Stream->BufferValidSize)) {
+
+        Byte = Stream->Buffer[Stream->BufferNextIndex];
+        Stream->BufferNextIndex += 1;
+        if (Stream->BufferNextIndex == Stream->BufferValidSize) {
+            Stream->BufferNextIndex = 0;
+            Stream->BufferValidSize = 0;
+        }
+
+        return Byte;
+    }
+
     Result = fread_unlocked(&Byte, 1, 1, Stream);
     if (Result == 0) {
         return EOF;
@@ -2083,6 +2124,28 @@ Return Value:
 
     ORIENT_STREAM(Stream, FILE_FLAG_BYTE_ORIENTED);
     Byte = (unsigned char)Character;
+
+    //
+    // Drop the byte straight into the buffer if the stream is writing and the
+    // byte neither fills the buffer nor ends a line on a line buffered stream.
+    // Anything that would trigger a flush goes the long way around.
+    //
+
+    if (((Stream->Flags &
+          (FILE_FLAG_READ_LAST | FILE_FLAG_UNGET_VALID)) == 0) &&
+        ((Stream->OpenFlags & O_WRONLY) != 0) &&
+        (Stream->BufferNextIndex + 1 < Stream->BufferSize) &&
+        ((Stream->BufferMode == _IOFBF) ||
+         ((Stream->BufferMode == _IOLBF) && (Byte != '\n')))) {
+
+        assert(Stream->BufferValidSize == Stream->BufferNextIndex);
+
+        Stream->Buffer[Stream->BufferNextIndex] = Byte;
+        Stream->BufferNextIndex += 1;
+        Stream->BufferValidSize = Stream->BufferNextIndex;
+        return Byte;
+    }
+
     Result = fwrite_unlocked(&Byte, 1, 1, Stream);
     if (Result > 0) {
         return Byte;
@@ -2825,7 +2888,16 @@ Return Value:
 
 {
 
-    return ClpLockStream(Stream);
+    //
+    // Explicit locks are always taken for real, even in a single threaded
+    // process, since a thread may be created before the stream is unlocked.
+    //
+
+    if ((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) == 0) {
+        pthread_mutex_lock(&(Stream->Lock));
+    }
+
+    return;
 }
 
 LIBC_API
@@ -2886,7 +2958,11 @@ Return Value:
 
 {
 
-    return ClpUnlockStream(Stream);
+    if ((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) == 0) {
+        pthread_mutex_unlock(&(Stream->Lock));
+    }
+
+    return;
 }
 
 LIBC_API
@@ -3297,7 +3373,14 @@ Return Value:
 
     int Status;
 
-    if ((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) != 0) {
+    //
+    // Skip the lock while the process only has one thread, as there is no one
+    // to contend with.
+    //
+
+    if (((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) != 0) ||
+        (ClProcessMultithreaded == FALSE)) {
+
         return;
     }
 
@@ -3371,7 +3454,9 @@ Return Value:
 
 {
 
-    if ((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) != 0) {
+    if (((Stream->Flags & FILE_FLAG_DISABLE_LOCKING) != 0) ||
+        (ClProcessMultithreaded == FALSE)) {
+
         return;
     }
 
@@ -3471,6 +3556,7 @@ Return Value:
 {
 
     pthread_mutexattr_t Attribute;
+    ULONG BufferSize;
     FILE *File;
     BOOL Result;
 
@@ -3501,12 +3587,13 @@ Return Value:
     //
 
     if (File->BufferMode != _IONBF) {
-        File->Buffer = malloc(BUFSIZ);
+        BufferSize = ClpGetStreamBufferSize(Descriptor);
+        File->Buffer = malloc(BufferSize);
         if (File->Buffer == NULL) {
             goto CreateFileEnd;
         }
 
-        File->BufferSize = BUFSIZ;
+        File->BufferSize = BufferSize;
         File->Flags |= FILE_FLAG_BUFFER_ALLOCATED;
     }
 
@@ -3578,6 +3665,53 @@ Return Value:
     return;
 }
 
+ULONG
+ClpGetStreamBufferSize (
+    ULONG Descriptor
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the buffer size for a new stream. Regular files
+    get a larger buffer made up of whole preferred I/O blocks, which cuts down
+    the number of system calls made by character-at-a-time readers and
+    writers.
+
+Arguments:
+
+    Descriptor - Supplies the file descriptor the stream is opened on.
+
+Return Value:
+
+    Returns the buffer size to use, in bytes.
+
+--*/
+
+{
+
+    ULONG BlockSize;
+    ULONG BufferSize;
+    struct stat Stat;
+
+    if ((fstat(Descriptor, &Stat) != 0) || (!S_ISREG(Stat.st_mode))) {
+        return BUFSIZ;
+    }
+
+    BlockSize = Stat.st_blksize;
+    if ((BlockSize == 0) || (BlockSize > STREAM_MAX_BLOCK_SIZE)) {
+        BlockSize = BUFSIZ;
+    }
+
+    BufferSize = BlockSize;
+    while (BufferSize < STREAM_FILE_BUFFER_SIZE) {
+        BufferSize += BlockSize;
+    }
+
+    return BufferSize;
+}
+
 BOOL
 ClpFileFormatWriteCharacter (
     INT Character,
@@ -41,14 +41,61 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define a word with every byte set to one, and one with the high bit of
+// every byte set.
+//
+
+#define CL_WORD_ONES (MAX_UINTN / 0xFF)
+#define CL_WORD_HIGH_BITS (CL_WORD_ONES * 0x80)
+
+//
+// This macro evaluates to non-zero if any byte in the given word is zero.
+//
+
+#define CL_WORD_HAS_ZERO(_Word) \
+    (((_Word) - CL_WORD_ONES) & ~(_Word) & CL_WORD_HIGH_BITS)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+//
+// Define a word type that may alias the character data it is used to scan.
+//
+
+typedef UINTN __attribute__((__may_alias__)) CL_STRING_WORD;
+typedef const CL_STRING_WORD *PCCL_STRING_WORD;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+void *
+ClpMemoryFindWord (
+    const void *Buffer,
+    int Character,
+    size_t Size
+    );
+
+int
+ClpMemoryCompareWord (
+    const void *Left,
+    const void *Right,
+    size_t Size
+    );
+
+size_t
+ClpStringLengthWord (
+    const char *String
+    );
+
+char *
+ClpStringFindWord (
+    const char *String,
+    int Character
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -59,6 +106,18 @@ Module Name:
 
 char *ClStringTokenizerContext;
 
+//
+// Store the string routines selected for this processor. These start out as
+// the portable versions so that they work before the library initializes.
+//
+
+CL_STRING_ROUTINES ClStringRoutines = {
+    ClpMemoryFindWord,
+    ClpMemoryCompareWord,
+    ClpStringLengthWord,
+    ClpStringFindWord
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -98,19 +157,7 @@ Return Value:
 
 {
 
-    PSTR CharacterBuffer;
-
-    CharacterBuffer = (PSTR)Buffer;
-    while (Size != 0) {
-        if ((unsigned char)*CharacterBuffer == (unsigned char)Character) {
-            return CharacterBuffer;
-        }
-
-        CharacterBuffer += 1;
-        Size -= 1;
-    }
-
-    return NULL;
+    return ClStringRoutines.MemoryFind(Buffer, Character, Size);
 }
 
 LIBC_API
@@ -147,24 +194,7 @@ Return Value:
 
 {
 
-    int Difference;
-    size_t Index;
-    unsigned char *LeftCharacters;
-    unsigned char *RightCharacters;
-
-    LeftCharacters = (unsigned char *)Left;
-    RightCharacters = (unsigned char *)Right;
-    for (Index = 0; Index < Size; Index += 1) {
-        Difference = *LeftCharacters - *RightCharacters;
-        if (Difference != 0) {
-            return Difference;
-        }
-
-        LeftCharacters += 1;
-        RightCharacters += 1;
-    }
-
-    return 0;
+    return ClStringRoutines.MemoryCompare(Left, Right, Size);
 }
 
 LIBC_API
@@ -484,19 +514,7 @@ Return Value:
 
 {
 
-    while (TRUE) {
-        if (*String == (char)Character) {
-            return (char *)String;
-        }
-
-        if (*String == '\0') {
-            break;
-        }
-
-        String += 1;
-    }
-
-    return NULL;
+    return ClStringRoutines.StringFind(String, Character);
 }
 
 LIBC_API
@@ -571,7 +589,7 @@ Return Value:
 
 {
 
-    return RtlStringLength((PSTR)String);
+    return ClStringRoutines.StringLength(String);
 }
 
 LIBC_API
@@ -604,14 +622,19 @@ Return Value:
 
 {
 
-    size_t Size;
+    const char *Terminator;
 
-    Size = 0;
-    while ((Size < MaxLength) && (String[Size] != '\0')) {
-        Size += 1;
+    //
+    // The search routines never read beyond the word or block containing the
+    // first match, so this does not touch memory past the terminator.
+    //
+
+    Terminator = ClStringRoutines.MemoryFind(String, '\0', MaxLength);
+    if (Terminator == NULL) {
+        return MaxLength;
     }
 
-    return Size;
+    return Terminator - String;
 }
 
 LIBC_API
@@ -1920,7 +1943,315 @@ Return Value:
     return;
 }
 
+VOID
+ClpInitializeStringRoutines (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects the fastest string routine implementations the
+    processor supports.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+#if defined(__i386)
+
+    if (OsTestProcessorFeature(OsX86Sse2) == FALSE) {
+        return;
+    }
+
+#endif
+
+    ClStringRoutines.MemoryFind = ClpMemoryFindSse2;
+    ClStringRoutines.MemoryCompare = ClpMemoryCompareSse2;
+    ClStringRoutines.StringLength = ClpStringLengthSse2;
+    ClStringRoutines.StringFind = ClpStringFindSse2;
+
+#endif
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
+void *
+ClpMemoryFindWord (
+    const void *Buffer,
+    int Character,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements memchr a word at a time, for processors without
+    a faster implementation.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer of characters.
+
+    Character - Supplies the character (converted to an unsigned char) to
+        locate.
+
+    Size - Supplies the size of the buffer.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+{
+
+    const unsigned char *Bytes;
+    UINTN Pattern;
+    PCCL_STRING_WORD Word;
+
+    Bytes = Buffer;
+    while ((Size != 0) && (IS_POINTER_ALIGNED(Bytes, sizeof(UINTN)) == FALSE)) {
+        if (*Bytes == (unsigned char)Character) {
+            return (void *)Bytes;
+        }
+
+        Bytes += 1;
+        Size -= 1;
+    }
+
+    Pattern = CL_WORD_ONES * (unsigned char)Character;
+    Word = (PCCL_STRING_WORD)Bytes;
+    while ((Size >= sizeof(UINTN)) &&
+           (CL_WORD_HAS_ZERO(*Word ^ Pattern) == 0)) {
+
+        Word += 1;
+        Size -= sizeof(UINTN);
+    }
+
+    Bytes = (const unsigned char *)Word;
+    while (Size != 0) {
+        if (*Bytes == (unsigned char)Character) {
+            return (void *)Bytes;
+        }
+
+        Bytes += 1;
+        Size -= 1;
+    }
+
+    return NULL;
+}
+
+int
+ClpMemoryCompareWord (
+    const void *Left,
+    const void *Right,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements memcmp a word at a time when the buffers share an
+    alignment, for processors without a faster implementation.
+
+Arguments:
+
+    Left - Supplies the first buffer to compare.
+
+    Right - Supplies the second buffer to compare.
+
+    Size - Supplies the number of bytes to compare.
+
+Return Value:
+
+    Returns the difference between the first differing bytes, or 0 if the
+    buffers are equal.
+
+--*/
+
+{
+
+    const unsigned char *LeftBytes;
+    PCCL_STRING_WORD LeftWord;
+    const unsigned char *RightBytes;
+    PCCL_STRING_WORD RightWord;
+
+    LeftBytes = Left;
+    RightBytes = Right;
+    if ((((UINTN)LeftBytes ^ (UINTN)RightBytes) & (sizeof(UINTN) - 1)) == 0) {
+        while ((Size != 0) &&
+               (IS_POINTER_ALIGNED(LeftBytes, sizeof(UINTN)) == FALSE)) {
+
+            if (*LeftBytes != *RightBytes) {
+                return *LeftBytes - *RightBytes;
+            }
+
+            LeftBytes += 1;
+            RightBytes += 1;
+            Size -= 1;
+        }
+
+        //
+        // Skip over equal words. The bytes of the first differing word are
+        // compared individually below.
+        //
+
+        LeftWord = (PCCL_STRING_WORD)LeftBytes;
+        RightWord = (PCCL_STRING_WORD)RightBytes;
+        while ((Size >= sizeof(UINTN)) && (*LeftWord == *RightWord)) {
+            LeftWord += 1;
+            RightWord += 1;
+            Size -= sizeof(UINTN);
+        }
+
+        LeftBytes = (const unsigned char *)LeftWord;
+        RightBytes = (const unsigned char *)RightWord;
+    }
+
+    while (Size != 0) {
+        if (*LeftBytes != *RightBytes) {
+            return *LeftBytes - *RightBytes;
+        }
+
+        LeftBytes += 1;
+        RightBytes += 1;
+        Size -= 1;
+    }
+
+    return 0;
+}
+
+size_t
+ClpStringLengthWord (
+    const char *String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements strlen a word at a time, for processors without
+    a faster implementation. Aligned words never straddle a page, so reading
+    the bytes after the terminator in its word is harmless.
+
+Arguments:
+
+    String - Supplies a pointer to the string.
+
+Return Value:
+
+    Returns the length of the string, not including the null terminator.
+
+--*/
+
+{
+
+    const char *Current;
+    PCCL_STRING_WORD Word;
+
+    Current = String;
+    while (IS_POINTER_ALIGNED(Current, sizeof(UINTN)) == FALSE) {
+        if (*Current == '\0') {
+            return Current - String;
+        }
+
+        Current += 1;
+    }
+
+    Word = (PCCL_STRING_WORD)Current;
+    while (CL_WORD_HAS_ZERO(*Word) == 0) {
+        Word += 1;
+    }
+
+    Current = (const char *)Word;
+    while (*Current != '\0') {
+        Current += 1;
+    }
+
+    return Current - String;
+}
+
+char *
+ClpStringFindWord (
+    const char *String,
+    int Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements strchr a word at a time, for processors without
+    a faster implementation.
+
+Arguments:
+
+    String - Supplies a pointer to the string to search.
+
+    Character - Supplies the character to search for.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+{
+
+    UINTN Pattern;
+    PCCL_STRING_WORD Word;
+
+    while (IS_POINTER_ALIGNED(String, sizeof(UINTN)) == FALSE) {
+        if (*String == (char)Character) {
+            return (char *)String;
+        }
+
+        if (*String == '\0') {
+            return NULL;
+        }
+
+        String += 1;
+    }
+
+    Pattern = CL_WORD_ONES * (unsigned char)Character;
+    Word = (PCCL_STRING_WORD)String;
+    while ((CL_WORD_HAS_ZERO(*Word) == 0) &&
+           (CL_WORD_HAS_ZERO(*Word ^ Pattern) == 0)) {
+
+        Word += 1;
+    }
+
+    String = (const char *)Word;
+    while (TRUE) {
+        if (*String == (char)Character) {
+            return (char *)String;
+        }
+
+        if (*String == '\0') {
+            break;
+        }
+
+        String += 1;
+    }
+
+    return NULL;
+}
+
@@ -36,6 +36,7 @@ Module Name:
 #include <fcntl.h>
 #include <paths.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/wait.h>
@@ -110,6 +111,8 @@ Return Value:
 
     struct sigaction Action;
     char *Arguments[4];
+    posix_spawnattr_t Attributes;
+    sigset_t DefaultSignals;
     pid_t Pid;
     sigset_t SaveBlock;
     struct sigaction SavedInterrupt;
@@ -132,31 +135,46 @@ Return Value:
     sigprocmask(SIG_BLOCK, &(Action.sa_mask), &SaveBlock);
 
     //
-    // Fork off the child process.
+    // Spawn the shell rather than forking, so that a large caller does not
+    // pay to copy its address space. The child gets the original signal mask
+    // back. Interrupt and quit go back to the default unless they were
+    // ignored to begin with; caught signals are reset by the exec anyway.
     //
 
-    Pid = fork();
-    if (Pid < 0) {
-        return -1;
+    sigemptyset(&DefaultSignals);
+    if (SavedInterrupt.sa_handler != SIG_IGN) {
+        sigaddset(&DefaultSignals, SIGINT);
     }
 
-    //
-    // If this is the child, run the command.
-    //
+    if (SavedQuit.sa_handler != SIG_IGN) {
+        sigaddset(&DefaultSignals, SIGQUIT);
+    }
 
-    if (Pid == 0) {
-        sigaction(SIGINT, &SavedInterrupt, NULL);
-        sigaction(SIGQUIT, &SavedQuit, NULL);
-        sigprocmask(SIG_SETMASK, &SaveBlock, NULL);
-        Arguments[0] = SHELL_ARGUMENT0;
-        Arguments[1] = SHELL_ARGUMENT1;
-        Arguments[2] = (char *)Command;
-        Arguments[3] = NULL;
-        execvp(_PATH_BSHELL, Arguments);
-        exit(SHELL_NOT_FOUND_STATUS);
+    if (posix_spawnattr_init(&Attributes) != 0) {
+        Status = -1;
+        goto systemEnd;
+    }
+
+    posix_spawnattr_setflags(&Attributes,
+                             POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    posix_spawnattr_setsigmask(&Attributes, &SaveBlock);
+    posix_spawnattr_setsigdefault(&Attributes, &DefaultSignals);
+    Arguments[0] = SHELL_ARGUMENT0;
+    Arguments[1] = SHELL_ARGUMENT1;
+    Arguments[2] = (char *)Command;
+    Arguments[3] = NULL;
+    if (posix_spawn(&Pid,
+                    _PATH_BSHELL,
+                    NULL,
+                    &Attributes,
+                    Arguments,
+                    environ) != 0) {
+
+        Status = SHELL_NOT_FOUND_STATUS << 8;
 
     //
-    // This is the parent, wait for the command to finish.
+    // Wait for the command to finish.
     //
 
     } else {
@@ -168,12 +186,15 @@ Return Value:
         }
     }
 
+    posix_spawnattr_destroy(&Attributes);
+
     //
     // Restore the signal mask and dispositions.
     //
 
+systemEnd:
     sigaction(SIGINT, &SavedInterrupt, NULL);
-    sigaction(SIGQUIT, &SavedInterrupt, NULL);
+    sigaction(SIGQUIT, &SavedQuit, NULL);
     sigprocmask(SIG_SETMASK, &SaveBlock, NULL);
     return Status;
 }
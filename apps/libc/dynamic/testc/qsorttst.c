@@ -46,10 +46,63 @@ Module Name:
 
 #define TEST_QUICKSORT_ARRAY_COUNT 1000
 
+//
+// Define the size of the arrays used for the input pattern cases, which look
+// at the number of comparisons made as well as the result.
+//
+
+#define TEST_QUICKSORT_PATTERN_COUNT 50000
+
+//
+// Define the maximum number of comparisons allowed for a pattern case, as a
+// multiple of n log2 n. A quadratic sort blows well past this.
+//
+
+#define TEST_QUICKSORT_COMPARISON_FACTOR 3
+
+//
+// Define the size of the odd-sized elements, which use the bytewise swap.
+//
+
+#define TEST_QUICKSORT_RECORD_PAD 11
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+typedef enum _TEST_QUICKSORT_PATTERN {
+    TestQuickSortSorted,
+    TestQuickSortReversed,
+    TestQuickSortOrganPipe,
+    TestQuickSortSawtooth,
+    TestQuickSortManyDuplicates,
+    TestQuickSortAllEqual,
+    TestQuickSortNearlySorted,
+    TestQuickSortRandom,
+    TestQuickSortPatternCount
+} TEST_QUICKSORT_PATTERN, *PTEST_QUICKSORT_PATTERN;
+
+/*++
+
+Structure Description:
+
+    This structure defines an oddly sized record, used to test sorting
+    elements that are not a multiple of the machine word size.
+
+Members:
+
+    Key - Stores the sort key.
+
+    Pad - Stores filler bytes, which are set from the key so that moving a
+        record incorrectly is detected.
+
+--*/
+
+typedef struct _TEST_QUICKSORT_RECORD {
+    ULONG Key;
+    UCHAR Pad[TEST_QUICKSORT_RECORD_PAD];
+} PACKED TEST_QUICKSORT_RECORD, *PTEST_QUICKSORT_RECORD;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -62,17 +115,75 @@ TestQuickSortCase (
     BOOL ExactSet
     );
 
+ULONG
+TestQuickSortPattern (
+    ULONG TestIndex,
+    TEST_QUICKSORT_PATTERN Pattern
+    );
+
+ULONG
+TestQuickSortElementSizes (
+    ULONG TestIndex
+    );
+
+ULONG
+TestQuickSortWithContext (
+    ULONG TestIndex
+    );
+
 int
 TestQuickSortCompare (
     const void *Left,
     const void *Right
     );
 
+int
+TestQuickSortCompareWide (
+    const void *Left,
+    const void *Right
+    );
+
+int
+TestQuickSortCompareRecord (
+    const void *Left,
+    const void *Right
+    );
+
+int
+TestQuickSortCompareWithContext (
+    const void *Left,
+    const void *Right,
+    void *Context
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
 
-ULONG TestQuickSortArray[TEST_QUICKSORT_ARRAY_COUNT];
+ULONG TestQuickSortArray[TEST_QUICKSORT_PATTERN_COUNT];
+ULONGLONG TestQuickSortWideArray[TEST_QUICKSORT_ARRAY_COUNT * 2];
+TEST_QUICKSORT_RECORD TestQuickSortRecords[TEST_QUICKSORT_ARRAY_COUNT];
+
+//
+// Store the number of comparisons made by the current sort.
+//
+
+ULONG TestQuickSortComparisons;
+
+//
+// Store the names of the input patterns.
+//
+
+PSTR TestQuickSortPatternNames[TestQuickSortPatternCount] = {
+    "sorted",
+    "reversed",
+    "organ pipe",
+    "sawtooth",
+    "many duplicates",
+    "all equal",
+    "nearly sorted",
+    "random"
+};
 
 //
 // ------------------------------------------------------------------ Functions
@@ -105,6 +216,7 @@ Return Value:
     ULONG Case;
     ULONG Failures;
     ULONG Index;
+    TEST_QUICKSORT_PATTERN Pattern;
 
     Array = TestQuickSortArray;
     Case = 0;
@@ -229,6 +341,20 @@ Return Value:
                                   FALSE);
 
     Case += 1;
+
+    //
+    // Run the larger inputs with patterns that tend to trip up quicksort.
+    //
+
+    for (Pattern = 0; Pattern < TestQuickSortPatternCount; Pattern += 1) {
+        Failures += TestQuickSortPattern(Case, Pattern);
+        Case += 1;
+    }
+
+    Failures += TestQuickSortElementSizes(Case);
+    Case += 1;
+    Failures += TestQuickSortWithContext(Case);
+    Case += 1;
     return Failures;
 }
 
@@ -236,6 +362,282 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+ULONG
+TestQuickSortPattern (
+    ULONG TestIndex,
+    TEST_QUICKSORT_PATTERN Pattern
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts a large array filled with the given pattern, and
+    checks both the result and the number of comparisons it took.
+
+Arguments:
+
+    TestIndex - Supplies the test case number for error printing.
+
+    Pattern - Supplies the input pattern to sort.
+
+Return Value:
+
+    Returns the number of failures (zero or one).
+
+--*/
+
+{
+
+    PULONG Array;
+    ULONG Count;
+    ULONG Index;
+    ULONG Log2;
+    ULONG MaxComparisons;
+
+    Array = TestQuickSortArray;
+    Count = TEST_QUICKSORT_PATTERN_COUNT;
+    for (Index = 0; Index < Count; Index += 1) {
+        switch (Pattern) {
+        case TestQuickSortSorted:
+            Array[Index] = Index;
+            break;
+
+        case TestQuickSortReversed:
+            Array[Index] = Count - Index;
+            break;
+
+        case TestQuickSortOrganPipe:
+            if (Index < (Count / 2)) {
+                Array[Index] = Index;
+
+            } else {
+                Array[Index] = Count - Index;
+            }
+
+            break;
+
+        case TestQuickSortSawtooth:
+            Array[Index] = Index % 1000;
+            break;
+
+        case TestQuickSortManyDuplicates:
+            Array[Index] = rand() % 8;
+            break;
+
+        case TestQuickSortAllEqual:
+            Array[Index] = 7;
+            break;
+
+        case TestQuickSortNearlySorted:
+            Array[Index] = Index;
+            if ((Index % 100) == 99) {
+                Array[Index] = rand() % Count;
+            }
+
+            break;
+
+        case TestQuickSortRandom:
+        default:
+            Array[Index] = rand();
+            break;
+        }
+    }
+
+    Log2 = 0;
+    while ((1UL << Log2) < Count) {
+        Log2 += 1;
+    }
+
+    MaxComparisons = TEST_QUICKSORT_COMPARISON_FACTOR * Count * Log2;
+    TestQuickSortComparisons = 0;
+    if (TestQuickSortCase(TestIndex, Array, Count, FALSE) != 0) {
+        printf("Error: Pattern \"%s\" was not sorted.\n",
+               TestQuickSortPatternNames[Pattern]);
+
+        return 1;
+    }
+
+    if (TestQuickSortComparisons > MaxComparisons) {
+        printf("Error: Test case %d: pattern \"%s\" took %d comparisons to "
+               "sort %d elements, more than the %d allowed.\n",
+               TestIndex,
+               TestQuickSortPatternNames[Pattern],
+               TestQuickSortComparisons,
+               Count,
+               MaxComparisons);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+ULONG
+TestQuickSortElementSizes (
+    ULONG TestIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts arrays of elements that are wider than a word and that
+    are oddly sized, which exercise the different element swap methods.
+
+Arguments:
+
+    TestIndex - Supplies the test case number for error printing.
+
+Return Value:
+
+    Returns the number of failures.
+
+--*/
+
+{
+
+    ULONG Byte;
+    ULONG Failures;
+    ULONG Index;
+    PTEST_QUICKSORT_RECORD Records;
+    ULONGLONG *Wide;
+
+    Failures = 0;
+
+    //
+    // Sort 16-byte elements, where the key is the first half and the second
+    // half must travel with it.
+    //
+
+    Wide = TestQuickSortWideArray;
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        Wide[Index * 2] = rand() % TEST_QUICKSORT_ARRAY_COUNT;
+        Wide[(Index * 2) + 1] = ~(Wide[Index * 2]);
+    }
+
+    qsort(Wide,
+          TEST_QUICKSORT_ARRAY_COUNT,
+          sizeof(ULONGLONG) * 2,
+          TestQuickSortCompareWide);
+
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        if ((Wide[(Index * 2) + 1] != ~(Wide[Index * 2])) ||
+            ((Index != 0) && (Wide[Index * 2] < Wide[(Index - 1) * 2]))) {
+
+            printf("Error: Test case %d: 16-byte element %d wrong.\n",
+                   TestIndex,
+                   Index);
+
+            Failures += 1;
+            break;
+        }
+    }
+
+    //
+    // Sort packed records whose size is not a multiple of a word.
+    //
+
+    Records = TestQuickSortRecords;
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        Records[Index].Key = rand() % 100;
+        for (Byte = 0; Byte < TEST_QUICKSORT_RECORD_PAD; Byte += 1) {
+            Records[Index].Pad[Byte] = Records[Index].Key + Byte;
+        }
+    }
+
+    qsort(Records,
+          TEST_QUICKSORT_ARRAY_COUNT,
+          sizeof(TEST_QUICKSORT_RECORD),
+          TestQuickSortCompareRecord);
+
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        if ((Index != 0) && (Records[Index].Key < Records[Index - 1].Key)) {
+            printf("Error: Test case %d: record %d out of order.\n",
+                   TestIndex,
+                   Index);
+
+            Failures += 1;
+            break;
+        }
+
+        for (Byte = 0; Byte < TEST_QUICKSORT_RECORD_PAD; Byte += 1) {
+            if (Records[Index].Pad[Byte] !=
+                (UCHAR)(Records[Index].Key + Byte)) {
+
+                printf("Error: Test case %d: record %d corrupted.\n",
+                       TestIndex,
+                       Index);
+
+                Failures += 1;
+                break;
+            }
+        }
+
+        if (Failures != 0) {
+            break;
+        }
+    }
+
+    return Failures;
+}
+
+ULONG
+TestQuickSortWithContext (
+    ULONG TestIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests qsort_r, using the context pointer to select a
+    descending sort.
+
+Arguments:
+
+    TestIndex - Supplies the test case number for error printing.
+
+Return Value:
+
+    Returns the number of failures (zero or one).
+
+--*/
+
+{
+
+    PULONG Array;
+    int Direction;
+    ULONG Index;
+
+    Array = TestQuickSortArray;
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        Array[Index] = rand() % TEST_QUICKSORT_ARRAY_COUNT;
+    }
+
+    Direction = -1;
+    qsort_r(Array,
+            TEST_QUICKSORT_ARRAY_COUNT,
+            sizeof(ULONG),
+            TestQuickSortCompareWithContext,
+            &Direction);
+
+    for (Index = 1; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        if (Array[Index] > Array[Index - 1]) {
+            printf("Error: Test case %d: qsort_r index %d had %d, but "
+                   "previous value was %d.\n",
+                   TestIndex,
+                   Index,
+                   Array[Index],
+                   Array[Index - 1]);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 ULONG
 TestQuickSortCase (
     ULONG TestIndex,
@@ -352,6 +754,7 @@ Return Value:
     ULONG LeftNumber;
     ULONG RightNumber;
 
+    TestQuickSortComparisons += 1;
     LeftNumber = *((PULONG)Left);
     RightNumber = *((PULONG)Right);
     if (LeftNumber < RightNumber) {
@@ -365,3 +768,136 @@ Return Value:
     return 0;
 }
 
+int
+TestQuickSortCompareWide (
+    const void *Left,
+    const void *Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two 16-byte test elements by their first half.
+
+Arguments:
+
+    Left - Supplies a pointer into the array of the left side of the comparison.
+
+    Right - Supplies a pointer into the array of the right side of the
+        comparison.
+
+Return Value:
+
+    <0 if the left is less than the right.
+
+    0 if the two elements are equal.
+
+    >0 if the left element is greater than the right.
+
+--*/
+
+{
+
+    ULONGLONG LeftNumber;
+    ULONGLONG RightNumber;
+
+    LeftNumber = *((ULONGLONG *)Left);
+    RightNumber = *((ULONGLONG *)Right);
+    if (LeftNumber < RightNumber) {
+        return -1;
+    }
+
+    if (LeftNumber > RightNumber) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+TestQuickSortCompareRecord (
+    const void *Left,
+    const void *Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two oddly sized test records by their key.
+
+Arguments:
+
+    Left - Supplies a pointer into the array of the left side of the comparison.
+
+    Right - Supplies a pointer into the array of the right side of the
+        comparison.
+
+Return Value:
+
+    <0 if the left is less than the right.
+
+    0 if the two elements are equal.
+
+    >0 if the left element is greater than the right.
+
+--*/
+
+{
+
+    ULONG LeftNumber;
+    ULONG RightNumber;
+
+    LeftNumber = ((PTEST_QUICKSORT_RECORD)Left)->Key;
+    RightNumber = ((PTEST_QUICKSORT_RECORD)Right)->Key;
+    if (LeftNumber < RightNumber) {
+        return -1;
+    }
+
+    if (LeftNumber > RightNumber) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+TestQuickSortCompareWithContext (
+    const void *Left,
+    const void *Right,
+    void *Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two test array elements, scaling the result by the
+    direction in the context. It is used by the qsort_r test.
+
+Arguments:
+
+    Left - Supplies a pointer into the array of the left side of the comparison.
+
+    Right - Supplies a pointer into the array of the right side of the
+        comparison.
+
+    Context - Supplies a pointer to an integer holding 1 for an ascending sort
+        or -1 for a descending one.
+
+Return Value:
+
+    <0 if the left sorts before the right.
+
+    0 if the two elements are equal.
+
+    >0 if the left element sorts after the right.
+
+--*/
+
+{
+
+    return TestQuickSortCompare(Left, Right) * *((int *)Context);
+}
+
@@ -35,6 +35,7 @@ Module Name:
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 //
 // ---------------------------------------------------------------- Definitions
@@ -46,6 +47,14 @@ Module Name:
 
 #define REGEX_TEST_MATCH_COUNT 5
 
+//
+// Define the shape of the generated log the throughput test searches, which
+// cycles through the throughput templates.
+//
+
+#define REGEX_THROUGHPUT_CYCLE_COUNT 4000
+#define REGEX_THROUGHPUT_LINE_SIZE 96
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -71,6 +80,12 @@ typedef struct _REGEX_ERROR_STRING {
     PSTR String;
 } REGEX_ERROR_STRING, *PREGEX_ERROR_STRING;
 
+typedef struct _REGEX_THROUGHPUT_TEST_CASE {
+    PSTR Pattern;
+    INT CompileFlags;
+    ULONG MatchesPerCycle;
+} REGEX_THROUGHPUT_TEST_CASE, *PREGEX_THROUGHPUT_TEST_CASE;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -644,6 +659,113 @@ REGEX_EXECUTION_TEST_CASE RegexExecutionTestCases[] = {
         REG_NOMATCH,
         {{-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
     },
+
+    //
+    // A repetition that ends with an empty iteration should keep the
+    // subexpressions of the last iteration that matched something.
+    //
+
+    {
+        "(a*)*", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*)+", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "\\(a*\\)*", 0,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(.*)*", REG_EXTENDED,
+        "abc", 0,
+        0,
+        {{0, 3}, {0, 3}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "([a-z]*)*x", REG_EXTENDED,
+        "abx", 0,
+        0,
+        {{0, 3}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "x(a*)*", REG_EXTENDED,
+        "xaa", 0,
+        0,
+        {{0, 3}, {1, 3}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "x(a*)*", REG_EXTENDED,
+        "x", 0,
+        0,
+        {{0, 1}, {1, 1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*)*", REG_EXTENDED,
+        "", 0,
+        0,
+        {{0, 0}, {0, 0}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a|b*)*c", REG_EXTENDED,
+        "abbc", 0,
+        0,
+        {{0, 4}, {1, 3}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "((a*)b*)*", REG_EXTENDED,
+        "aab", 0,
+        0,
+        {{0, 3}, {0, 3}, {0, 2}, {-1, -1}, {-1, -1}},
+    },
+
+    //
+    // The same goes for the optional copies of a bounded repetition.
+    //
+
+    {
+        "(a*){1,2}", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*){1,3}", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*){0,2}", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "\\(a*\\)\\{1,2\\}", 0,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*){2,3}", REG_EXTENDED,
+        "aa", 0,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a*){0,2}", REG_EXTENDED,
+        "", 0,
+        0,
+        {{0, 0}, {0, 0}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
 };
 
 //
@@ -749,6 +871,42 @@ REGEX_ERROR_STRING RegexErrorStrings[] = {
     {REG_BADRPT, "REG_BADRPT"}
 };
 
+//
+// Define the lines the throughput test's log is made of. Each is formatted
+// with the line number three times.
+//
+
+PSTR RegexThroughputTemplates[] = {
+    "Oct 19 12:%02d:%02d minoca kernel: eth0: link up, 1000 Mbps full duplex",
+    "Oct 19 12:%02d:%02d minoca sshd[%d]: Accepted publickey for root from "
+    "10.0.0.7",
+
+    "Oct 19 12:%02d:%02d minoca cron[%d]: (root) CMD (run-parts /etc/hourly)",
+    "Oct 19 12:%02d:%02d minoca kernel: usb 1-1: descriptor read, error -71",
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+};
+
+//
+// Define the throughput test cases, along with how many lines of each cycle
+// through the templates they match. The last few have nested or alternated
+// repetitions that take exponential time to backtrack through.
+//
+
+REGEX_THROUGHPUT_TEST_CASE RegexThroughputTestCases[] = {
+    {"error", 0, 1},
+    {"sshd\\[[0-9]+\\]: (Accepted|Failed) [a-z]+ for [a-z]+",
+     REG_EXTENDED,
+     1},
+
+    {"(kernel|cron).*(error|duplex)", REG_EXTENDED, 2},
+    {"[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+$", REG_EXTENDED, 1},
+    {"^Oct [0-9]+ ([0-9]{2}:){2}[0-9]{2} [a-z]+ ", REG_EXTENDED, 4},
+    {"ETH0: LINK (UP|DOWN)", REG_EXTENDED | REG_ICASE, 1},
+    {"^(a|aa)*[bc]$", REG_EXTENDED, 0},
+    {"(a*)*[^a]", REG_EXTENDED, 4},
+    {"(a|b|ab)*(a|b|ab)*(a|b|ab)*z", REG_EXTENDED | REG_NOSUB, 0},
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -821,6 +979,132 @@ Return Value:
     return Failures;
 }
 
+ULONG
+TestRegularExpressionThroughput (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures how quickly regular expressions can search a
+    generated log one line at a time, the way grep does, and checks that each
+    expression matches the expected number of lines.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the count of test failures.
+
+--*/
+
+{
+
+    clock_t Begin;
+    PREGEX_THROUGHPUT_TEST_CASE Case;
+    ULONG CaseCount;
+    ULONG CaseIndex;
+    double Elapsed;
+    regex_t Expression;
+    ULONG Failures;
+    PSTR Line;
+    ULONG LineCount;
+    ULONG LineIndex;
+    PSTR Lines;
+    regmatch_t Match[REGEX_TEST_MATCH_COUNT];
+    ULONG Matches;
+    INT Result;
+    ULONG TemplateCount;
+    size_t TotalSize;
+
+    Failures = 0;
+    TemplateCount = sizeof(RegexThroughputTemplates) /
+                    sizeof(RegexThroughputTemplates[0]);
+
+    LineCount = REGEX_THROUGHPUT_CYCLE_COUNT * TemplateCount;
+    Lines = malloc(LineCount * REGEX_THROUGHPUT_LINE_SIZE);
+    if (Lines == NULL) {
+        printf("Regex throughput test failed to allocate.\n");
+        return 1;
+    }
+
+    TotalSize = 0;
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex += 1) {
+        Line = Lines + (LineIndex * REGEX_THROUGHPUT_LINE_SIZE);
+        snprintf(Line,
+                 REGEX_THROUGHPUT_LINE_SIZE,
+                 RegexThroughputTemplates[LineIndex % TemplateCount],
+                 (INT)(LineIndex / 60) % 60,
+                 (INT)LineIndex % 60,
+                 (INT)LineIndex);
+
+        TotalSize += strlen(Line);
+    }
+
+    CaseCount = sizeof(RegexThroughputTestCases) /
+                sizeof(RegexThroughputTestCases[0]);
+
+    for (CaseIndex = 0; CaseIndex < CaseCount; CaseIndex += 1) {
+        Case = &(RegexThroughputTestCases[CaseIndex]);
+        Result = regcomp(&Expression, Case->Pattern, Case->CompileFlags);
+        if (Result != 0) {
+            printf("Regex throughput case %d failed to compile: %s.\n",
+                   CaseIndex,
+                   TestRegexGetErrorCodeString(Result));
+
+            Failures += 1;
+            continue;
+        }
+
+        Matches = 0;
+        Begin = clock();
+        for (LineIndex = 0; LineIndex < LineCount; LineIndex += 1) {
+            Line = Lines + (LineIndex * REGEX_THROUGHPUT_LINE_SIZE);
+            Result = regexec(&Expression,
+                             Line,
+                             REGEX_TEST_MATCH_COUNT,
+                             Match,
+                             0);
+
+            if (Result == 0) {
+                Matches += 1;
+            }
+        }
+
+        Elapsed = (double)(clock() - Begin) / CLOCKS_PER_SEC;
+        regfree(&Expression);
+        if (Matches != Case->MatchesPerCycle * REGEX_THROUGHPUT_CYCLE_COUNT) {
+            printf("Regex throughput case %d failed.\n"
+                   "Pattern: \"%s\", Flags 0x%x.\n"
+                   "Expected %d matching lines, got %d.\n",
+                   CaseIndex,
+                   Case->Pattern,
+                   Case->CompileFlags,
+                   Case->MatchesPerCycle * REGEX_THROUGHPUT_CYCLE_COUNT,
+                   Matches);
+
+            Failures += 1;
+        }
+
+        if (Elapsed > 0) {
+            printf("Regex throughput: %-48s %8.2f MB/s\n",
+                   Case->Pattern,
+                   (double)TotalSize / Elapsed / (1024.0 * 1024.0));
+
+        } else {
+            printf("Regex throughput: %-48s too fast to measure\n",
+                   Case->Pattern);
+        }
+    }
+
+    free(Lines);
+    return Failures;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1038,4 +1322,3 @@ Return Value:
 
     return "Unknown Error";
 }
-
@@ -39,6 +39,16 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the usage string. The throughput measurements take a while, so they
+// only run when asked for.
+//
+
+#define TESTC_USAGE \
+    "usage: testc [-p]\n\n" \
+    "Tests the C library.\n\n" \
+    "    -p  Also measure regular expression throughput.\n"
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -84,11 +94,37 @@ Return Value:
 
 {
 
+    PSTR Argument;
     ULONG Failures;
+    BOOL Performance;
     ULONG TotalFailures;
 
+    Performance = FALSE;
+
+    //
+    // Process the command line options.
+    //
+
+    while ((ArgumentCount > 1) && (Arguments[1][0] == '-')) {
+        Argument = &(Arguments[1][1]);
+        if (strcmp(Argument, "p") == 0) {
+            Performance = TRUE;
+
+        } else {
+            printf("%s: Invalid option\n\n%s", Argument, TESTC_USAGE);
+            return 1;
+        }
+
+        ArgumentCount -= 1;
+        Arguments += 1;
+    }
+
     TotalFailures = 0;
     Failures = TestRegularExpressions();
+    if (Performance != FALSE) {
+        Failures += TestRegularExpressionThroughput();
+    }
+
     if (Failures != 0) {
         printf("%d regular expression test failures.\n", Failures);
         TotalFailures += Failures;
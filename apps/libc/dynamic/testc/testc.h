@@ -64,6 +64,29 @@ Return Value:
 
 --*/
 
+ULONG
+TestRegularExpressionThroughput (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine measures how quickly regular expressions can search a
+    generated log one line at a time, the way grep does, and checks that each
+    expression matches the expected number of lines.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the count of test failures.
+
+--*/
+
 ULONG
 TestQuickSort (
     VOID
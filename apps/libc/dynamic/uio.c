@@ -32,6 +32,7 @@ Module Name:
 #include "libcp.h"
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
@@ -189,6 +190,80 @@ Return Value:
     return (ssize_t)BytesCompleted;
 }
 
+LIBC_API
+ssize_t
+vmsplice (
+    int FileDescriptor,
+    const struct iovec *IoVector,
+    size_t IoVectorCount,
+    unsigned int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes the contents of the given I/O vectors into a pipe.
+
+Arguments:
+
+    FileDescriptor - Supplies the file descriptor of the write end of a pipe.
+
+    IoVector - Supplies a pointer to an array of I/O vectors.
+
+    IoVectorCount - Supplies the number of elements in the I/O vector array.
+
+    Flags - Supplies a bitfield of flags. See SPLICE_F_* definitions.
+
+Return Value:
+
+    Returns the number of bytes written into the pipe on success.
+
+    -1 on error, and errno will be set to indicate the error.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    UINTN Index;
+    ULONG IoFlags;
+    UINTN Size;
+    KSTATUS Status;
+
+    IoFlags = SYS_IO_FLAG_WRITE;
+    if ((Flags & SPLICE_F_GIFT) != 0) {
+        IoFlags |= SYS_IO_FLAG_GIFT;
+    }
+
+    Size = 0;
+    for (Index = 0; Index < IoVectorCount; Index += 1) {
+        Size += IoVector[Index].iov_len;
+    }
+
+    Status = OsPerformVectoredIo((HANDLE)(INTN)FileDescriptor,
+                                 IO_OFFSET_NONE,
+                                 Size,
+                                 IoFlags,
+                                 SYS_WAIT_TIME_INDEFINITE,
+                                 (PIO_VECTOR)IoVector,
+                                 IoVectorCount,
+                                 &BytesCompleted);
+
+    if (Status == STATUS_TIMEOUT) {
+        errno = EAGAIN;
+        return -1;
+
+    } else if (!KSUCCESS(Status)) {
+        errno = ClConvertKstatusToErrorNumber(Status);
+        if (BytesCompleted == 0) {
+            BytesCompleted = -1;
+        }
+    }
+
+    return (ssize_t)BytesCompleted;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -0,0 +1,358 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    strsse2.c
+
+Abstract:
+
+    This module implements string and memory routines using SSE2
+    instructions. It is shared between x86 and x64.
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "../libcp.h"
+#include <emmintrin.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// SSE2 is not part of the baseline 32-bit instruction set, so these routines
+// must be compiled for it explicitly. They are only called once the processor
+// has been confirmed to support it.
+//
+
+#if defined(__i386)
+
+#define SSE2_ROUTINE __attribute__((__target__("sse2")))
+
+#else
+
+#define SSE2_ROUTINE
+
+#endif
+
+#define SSE2_BLOCK_SIZE sizeof(__m128i)
+#define SSE2_BLOCK_MASK (SSE2_BLOCK_SIZE - 1)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+//
+// The scanning routines below only ever load naturally aligned blocks. An
+// aligned block never straddles a page, so reading the bytes of a block that
+// lie before the start or after the end of the string is harmless; they are
+// simply masked out of the result.
+//
+
+SSE2_ROUTINE
+void *
+ClpMemoryFindSse2 (
+    const void *Buffer,
+    int Character,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements memchr using SSE2 instructions.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer of characters.
+
+    Character - Supplies the character (converted to an unsigned char) to
+        locate.
+
+    Size - Supplies the size of the buffer.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+{
+
+    const __m128i *Block;
+    UINTN Index;
+    unsigned int Mask;
+    UINTN Offset;
+    __m128i Pattern;
+    UINTN Remaining;
+
+    if (Size == 0) {
+        return NULL;
+    }
+
+    Pattern = _mm_set1_epi8((char)Character);
+    Offset = (UINTN)Buffer & SSE2_BLOCK_MASK;
+    Block = (const __m128i *)((const char *)Buffer - Offset);
+    Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(Block), Pattern));
+    Mask >>= Offset;
+    if (Mask != 0) {
+        Index = __builtin_ctz(Mask);
+        if (Index < Size) {
+            return (char *)Buffer + Index;
+        }
+
+        return NULL;
+    }
+
+    Remaining = SSE2_BLOCK_SIZE - Offset;
+    if (Size <= Remaining) {
+        return NULL;
+    }
+
+    Remaining = Size - Remaining;
+    Block += 1;
+    while (TRUE) {
+        Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(Block),
+                                                Pattern));
+
+        if (Mask != 0) {
+            Index = __builtin_ctz(Mask);
+            if (Index < Remaining) {
+                return (char *)Block + Index;
+            }
+
+            return NULL;
+        }
+
+        if (Remaining <= SSE2_BLOCK_SIZE) {
+            break;
+        }
+
+        Remaining -= SSE2_BLOCK_SIZE;
+        Block += 1;
+    }
+
+    return NULL;
+}
+
+SSE2_ROUTINE
+int
+ClpMemoryCompareSse2 (
+    const void *Left,
+    const void *Right,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements memcmp using SSE2 instructions.
+
+Arguments:
+
+    Left - Supplies the first buffer to compare.
+
+    Right - Supplies the second buffer to compare.
+
+    Size - Supplies the number of bytes to compare.
+
+Return Value:
+
+    Returns the difference between the first differing bytes, or 0 if the
+    buffers are equal.
+
+--*/
+
+{
+
+    UINTN Index;
+    const unsigned char *LeftBytes;
+    __m128i LeftBlock;
+    unsigned int Mask;
+    const unsigned char *RightBytes;
+    __m128i RightBlock;
+
+    LeftBytes = Left;
+    RightBytes = Right;
+    while (Size >= SSE2_BLOCK_SIZE) {
+        LeftBlock = _mm_loadu_si128((const __m128i *)LeftBytes);
+        RightBlock = _mm_loadu_si128((const __m128i *)RightBytes);
+        Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(LeftBlock, RightBlock));
+        if (Mask != 0xFFFF) {
+            Index = __builtin_ctz(~Mask);
+            return LeftBytes[Index] - RightBytes[Index];
+        }
+
+        LeftBytes += SSE2_BLOCK_SIZE;
+        RightBytes += SSE2_BLOCK_SIZE;
+        Size -= SSE2_BLOCK_SIZE;
+    }
+
+    while (Size != 0) {
+        if (*LeftBytes != *RightBytes) {
+            return *LeftBytes - *RightBytes;
+        }
+
+        LeftBytes += 1;
+        RightBytes += 1;
+        Size -= 1;
+    }
+
+    return 0;
+}
+
+SSE2_ROUTINE
+size_t
+ClpStringLengthSse2 (
+    const char *String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements strlen using SSE2 instructions.
+
+Arguments:
+
+    String - Supplies a pointer to the string.
+
+Return Value:
+
+    Returns the length of the string, not including the null terminator.
+
+--*/
+
+{
+
+    const __m128i *Block;
+    unsigned int Mask;
+    UINTN Offset;
+    __m128i Zero;
+
+    Zero = _mm_setzero_si128();
+    Offset = (UINTN)String & SSE2_BLOCK_MASK;
+    Block = (const __m128i *)(String - Offset);
+    Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(Block), Zero));
+    Mask >>= Offset;
+    if (Mask != 0) {
+        return __builtin_ctz(Mask);
+    }
+
+    while (TRUE) {
+        Block += 1;
+        Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(Block), Zero));
+        if (Mask != 0) {
+            break;
+        }
+    }
+
+    return (const char *)Block + __builtin_ctz(Mask) - String;
+}
+
+SSE2_ROUTINE
+char *
+ClpStringFindSse2 (
+    const char *String,
+    int Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements strchr using SSE2 instructions.
+
+Arguments:
+
+    String - Supplies a pointer to the string to search.
+
+    Character - Supplies the character to search for.
+
+Return Value:
+
+    Returns a pointer to the first occurrence of the character, or NULL.
+
+--*/
+
+{
+
+    const __m128i *Block;
+    __m128i Data;
+    const char *Found;
+    unsigned int Mask;
+    UINTN Offset;
+    __m128i Pattern;
+    __m128i Zero;
+
+    Zero = _mm_setzero_si128();
+    Pattern = _mm_set1_epi8((char)Character);
+    Offset = (UINTN)String & SSE2_BLOCK_MASK;
+    Block = (const __m128i *)(String - Offset);
+    Data = _mm_load_si128(Block);
+    Mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(Data, Zero),
+                                          _mm_cmpeq_epi8(Data, Pattern)));
+
+    Mask >>= Offset;
+    if (Mask != 0) {
+        Found = String + __builtin_ctz(Mask);
+
+    } else {
+        while (TRUE) {
+            Block += 1;
+            Data = _mm_load_si128(Block);
+            Mask = _mm_movemask_epi8(
+                                _mm_or_si128(_mm_cmpeq_epi8(Data, Zero),
+                                             _mm_cmpeq_epi8(Data, Pattern)));
+
+            if (Mask != 0) {
+                break;
+            }
+        }
+
+        Found = (const char *)Block + __builtin_ctz(Mask);
+    }
+
+    //
+    // The scan stops at either the character or the terminator.
+    //
+
+    if (*Found == (char)Character) {
+        return (char *)Found;
+    }
+
+    return NULL;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -28,6 +28,7 @@ Module Name:
 //
 
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 //
@@ -110,6 +111,18 @@ extern "C" {
 
 #define F_CLOSEM 11
 
+//
+// Get the capacity of a pipe, in bytes.
+//
+
+#define F_GETPIPE_SZ 12
+
+//
+// Set the capacity of a pipe, in bytes. The value is rounded up to a page.
+//
+
+#define F_SETPIPE_SZ 13
+
 //
 // There's no need for 64-bit versions, since off_t is always 64 bits.
 //
@@ -125,6 +138,17 @@ extern "C" {
 
 #define flock64 flock
 
+//
+// Define flags for the vmsplice function.
+//
+
+//
+// Set this flag to promise not to modify the supplied buffers until the call
+// returns, allowing the reader of the pipe to copy directly out of them.
+//
+
+#define SPLICE_F_GIFT 0x00000008
+
 //
 // Define file creation flags for the open call.
 //
@@ -478,6 +502,39 @@ Return Value:
 
 --*/
 
+LIBC_API
+ssize_t
+vmsplice (
+    int FileDescriptor,
+    const struct iovec *IoVector,
+    size_t IoVectorCount,
+    unsigned int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine writes the contents of the given I/O vectors into a pipe.
+
+Arguments:
+
+    FileDescriptor - Supplies the file descriptor of the write end of a pipe.
+
+    IoVector - Supplies a pointer to an array of I/O vectors.
+
+    IoVectorCount - Supplies the number of elements in the I/O vector array.
+
+    Flags - Supplies a bitfield of flags. See SPLICE_F_* definitions.
+
+Return Value:
+
+    Returns the number of bytes written into the pipe on success.
+
+    -1 on error, and errno will be set to indicate the error.
+
+--*/
+
 #ifdef __cplusplus
 
 }
@@ -104,6 +104,20 @@ extern "C" {
 
 #define SEEK_END 2
 
+//
+// Specify this value to seek to the next region of data at or after the given
+// offset.
+//
+
+#define SEEK_DATA 3
+
+//
+// Specify this value to seek to the next hole at or after the given offset.
+// The end of the file always counts as a hole.
+//
+
+#define SEEK_HOLE 4
+
 //
 // Define the maximum number of streams which the implementation guarantees
 // can be open simultaneously. It's effectively limitless, but a value is
@@ -787,6 +787,49 @@ Return Value:
 
 --*/
 
+LIBC_API
+void
+qsort_r (
+    void *ArrayBase,
+    size_t ElementCount,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *, void *),
+    void *Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of items in place using the QuickSort
+    algorithm, passing a caller-defined context pointer to the comparison
+    routine.
+
+Arguments:
+
+    ArrayBase - Supplies a pointer to the array of items that will get pushed
+        around.
+
+    ElementCount - Supplies the number of elements in the array.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies a pointer to a function that will be used to
+        compare elements. The function takes in two pointers that will point
+        within the array, and the context pointer. It returns less than zero if
+        the first element is less than the second, zero if the first element
+        is equal to the second, and greater than zero if the first element is
+        greater than the second.
+
+    Context - Supplies a pointer that is passed through to the comparison
+        routine.
+
+Return Value:
+
+    None.
+
+--*/
+
 LIBC_API
 int
 atoi (
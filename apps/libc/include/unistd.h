@@ -1557,6 +1557,55 @@ Return Value:
 
 --*/
 
+LIBC_API
+ssize_t
+copy_file_range (
+    int InputDescriptor,
+    off_t *InputOffset,
+    int OutputDescriptor,
+    off_t *OutputOffset,
+    size_t Length,
+    unsigned int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies data between two open file descriptors without
+    passing it through the caller's memory. Both descriptors must refer to
+    regular files or block devices.
+
+Arguments:
+
+    InputDescriptor - Supplies the file descriptor to read from.
+
+    InputOffset - Supplies an optional pointer to the offset to read from. If
+        supplied, it is advanced by the number of bytes copied and the input
+        file position is not changed. If NULL, the current file position of
+        the input is used and updated.
+
+    OutputDescriptor - Supplies the file descriptor to write to.
+
+    OutputOffset - Supplies an optional pointer to the offset to write to,
+        with the same semantics as the input offset.
+
+    Length - Supplies the number of bytes to copy.
+
+    Flags - Supplies a bitfield of flags. No flags are defined, so this must
+        be zero.
+
+Return Value:
+
+    Returns the number of bytes copied, which may be less than requested. Zero
+    is returned at the end of the input.
+
+    -1 on failure, and errno will contain more information. EINVAL is
+    returned if either descriptor is not a regular file or block device, or if
+    the ranges overlap within the same file.
+
+--*/
+
 LIBC_API
 int
 fsync (
@@ -1668,12 +1717,20 @@ Routine Description:
 
         SEEK_END - The offset will be added to the end of the file.
 
+        SEEK_DATA - The file position will be set to the start of the next
+            region of data at or after the given offset.
+
+        SEEK_HOLE - The file position will be set to the start of the next
+            hole at or after the given offset. The end of the file is always
+            considered a hole.
+
 Return Value:
 
     Returns the resulting file offset after the operation.
 
     -1 on failure, and errno will contain more information. The file offset
-    will remain unchanged.
+    will remain unchanged. For SEEK_DATA and SEEK_HOLE, errno is ENXIO if the
+    offset is at or beyond the end of the file.
 
 --*/
 
@@ -2799,6 +2856,38 @@ Return Value:
 
 --*/
 
+LIBC_API
+pid_t
+vfork (
+    void
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new process that shares the address space of the
+    calling process. The calling thread is suspended until the child calls
+    one of the exec functions or _exit. The child must not return from the
+    function that called vfork, and must not modify any data other than a
+    variable of type pid_t used to store the return value. At-fork handlers
+    are not run.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns 0 to the child process.
+
+    Returns the process ID of the child process to the parent process.
+
+    Returns -1 to the parent process on error, and the errno variable will be
+    set to provide more information about the error.
+
+--*/
+
 LIBC_API
 uid_t
 getuid (
@@ -52,7 +52,8 @@ ULONG OsProcessorFeatureMasks[OsArmFeatureCount] = {
     ARM_FEATURE_V7,
     ARM_FEATURE_VFP2,
     ARM_FEATURE_VFP3,
-    ARM_FEATURE_NEON32
+    ARM_FEATURE_NEON32,
+    ARM_FEATURE_CRC32
 };
 
 //
@@ -102,6 +103,37 @@ Return Value:
     return FALSE;
 }
 
+VOID
+OspInitializeProcessorFeatures (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects the faster library routines that the current
+    processor supports, such as the hardware CRC-32.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (OsTestProcessorFeature(OsArmCrc32) != FALSE) {
+        RtlEnableHardwareCrc32(TRUE);
+    }
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
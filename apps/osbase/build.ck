@@ -78,7 +78,8 @@ function build() {
         textAddress = "0x200000";
         archSources = [
             "x64/osbasea.S",
-            "x64/syscall.c"
+            "x64/syscall.c",
+            "x86/features.c"
         ];
     }
 
@@ -166,6 +166,7 @@ Return Value:
     OsEnvironment = Environment;
     OsLibraryInitialized = TRUE;
     OspSetUpSystemCalls();
+    OspInitializeProcessorFeatures();
     OspInitializeMemory();
     OspInitializeImageSupport();
     OspInitializeThreadSupport();
@@ -490,6 +491,90 @@ Return Value:
     return STATUS_SUCCESS;
 }
 
+OS_API
+KSTATUS
+OsCopyFileRange (
+    HANDLE InputHandle,
+    IO_OFFSET InputOffset,
+    HANDLE OutputHandle,
+    IO_OFFSET OutputOffset,
+    UINTN Size,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open file or block device to another
+    within the kernel, without passing it through user mode.
+
+Arguments:
+
+    InputHandle - Supplies the handle to read from.
+
+    InputOffset - Supplies the offset in the input to start reading from. Set
+        this to IO_OFFSET_NONE to use and update the input's current file
+        position.
+
+    OutputHandle - Supplies the handle to write to.
+
+    OutputOffset - Supplies the offset in the output to start writing at. Set
+        this to IO_OFFSET_NONE to use and update the output's current file
+        position.
+
+    Size - Supplies the number of bytes to copy.
+
+    Flags - Supplies a bitfield of flags. No flags are currently defined, so
+        this must be zero.
+
+    BytesCompleted - Supplies a pointer where the number of bytes copied will
+        be returned. This may be less than requested, and is zero at the end
+        of the input.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if either handle is not a regular file, block device,
+    or shared memory object. The caller should fall back to reading and
+    writing.
+
+    Other error codes on failure.
+
+--*/
+
+{
+
+    SYSTEM_CALL_COPY_FILE_RANGE Parameters;
+    INTN Result;
+
+    //
+    // Truncate the size so that the bytes completed can be returned via a
+    // register.
+    //
+
+    if (Size > (UINTN)MAX_INTN) {
+        Size = (UINTN)MAX_INTN;
+    }
+
+    Parameters.InputHandle = InputHandle;
+    Parameters.OutputHandle = OutputHandle;
+    Parameters.InputOffset = InputOffset;
+    Parameters.OutputOffset = OutputOffset;
+    Parameters.Size = (INTN)Size;
+    Parameters.Flags = Flags;
+    Result = OsSystemCall(SystemCallCopyFileRange, &Parameters);
+    if (Result < 0) {
+        *BytesCompleted = 0;
+        return Result;
+    }
+
+    *BytesCompleted = (UINTN)Result;
+    return STATUS_SUCCESS;
+}
+
 OS_API
 KSTATUS
 OsFlush (
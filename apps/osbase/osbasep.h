@@ -235,6 +235,28 @@ Return Value:
 
 --*/
 
+VOID
+OspInitializeProcessorFeatures (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects the faster library routines that the current
+    processor supports, such as the hardware CRC-32.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 OspSignalHandler (
     PSIGNAL_PARAMETERS Parameters,
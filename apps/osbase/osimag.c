@@ -53,6 +53,13 @@ Module Name:
 
 #define LD_BIND_NOW "LD_BIND_NOW"
 
+//
+// Define the size of the suffix added to a file being saved: a period, eight
+// hex digits of process ID, and a terminator.
+//
+
+#define OS_IMAGE_SAVE_SUFFIX_SIZE 10
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -177,6 +184,26 @@ OspImFinalizeSegments (
     UINTN SegmentCount
     );
 
+KSTATUS
+OspImSaveFile (
+    PVOID SystemContext,
+    PCSTR Path,
+    PVOID Buffer,
+    UINTN Size
+    );
+
+KSTATUS
+OspImOpenCacheFile (
+    PVOID SystemContext,
+    PCSTR Path,
+    PIMAGE_FILE_INFORMATION File
+    );
+
+BOOL
+OspImIsSetId (
+    VOID
+    );
+
 VOID
 OspImInitializeImages (
     PLIST_ENTRY ListHead
@@ -246,7 +273,9 @@ IM_IMPORT_TABLE OsImageFunctionTable = {
     OspImInvalidateInstructionCacheRegion,
     OspImGetEnvironmentVariable,
     OspImFinalizeSegments,
-    OspImArchResolvePltEntry
+    OspImArchResolvePltEntry,
+    OspImSaveFile,
+    OspImOpenCacheFile
 };
 
 //
@@ -2187,6 +2216,291 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+OspImSaveFile (
+    PVOID SystemContext,
+    PCSTR Path,
+    PVOID Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine replaces the contents of a file with the given buffer. The
+    data is written to a temporary file next to the destination, which is then
+    renamed over it, so other processes never see a partially written file.
+
+Arguments:
+
+    SystemContext - Supplies the context pointer passed to the load executable
+        function.
+
+    Path - Supplies a pointer to the path of the file to write.
+
+    Buffer - Supplies a pointer to the new file contents.
+
+    Size - Supplies the size of the buffer in bytes.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    BOOL Created;
+    ULONG Digit;
+    HANDLE Handle;
+    INTN Index;
+    FILE_PERMISSIONS Permissions;
+    PROCESS_ID ProcessId;
+    BOOL Renamed;
+    KSTATUS Status;
+    PSTR Suffix;
+    PSTR TemporaryPath;
+    ULONG TemporaryPathSize;
+
+    Created = FALSE;
+    Handle = INVALID_HANDLE;
+    Renamed = FALSE;
+    TemporaryPath = NULL;
+
+    //
+    // Don't let a set-ID program leave behind files for other programs to
+    // trust.
+    //
+
+    if (OspImIsSetId() != FALSE) {
+        Status = STATUS_ACCESS_DENIED;
+        goto SaveFileEnd;
+    }
+
+    TemporaryPathSize = RtlStringLength(Path) + OS_IMAGE_SAVE_SUFFIX_SIZE;
+    TemporaryPath = OsHeapAllocate(TemporaryPathSize, OS_IMAGE_ALLOCATION_TAG);
+    if (TemporaryPath == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto SaveFileEnd;
+    }
+
+    //
+    // Name the temporary file after the process so that two processes saving
+    // the same file don't trip over each other.
+    //
+
+    Status = OsGetProcessId(ProcessIdProcess, &ProcessId);
+    if (!KSUCCESS(Status)) {
+        goto SaveFileEnd;
+    }
+
+    RtlCopyMemory(TemporaryPath,
+                  Path,
+                  TemporaryPathSize - OS_IMAGE_SAVE_SUFFIX_SIZE);
+
+    Suffix = TemporaryPath + TemporaryPathSize - OS_IMAGE_SAVE_SUFFIX_SIZE;
+    *Suffix = '.';
+    Suffix += 1;
+    for (Index = 7; Index >= 0; Index -= 1) {
+        Digit = ((ULONG)ProcessId >> (Index * 4)) & 0xF;
+        if (Digit < 10) {
+            *Suffix = '0' + Digit;
+
+        } else {
+            *Suffix = 'A' + Digit - 10;
+        }
+
+        Suffix += 1;
+    }
+
+    *Suffix = '\0';
+    Permissions = FILE_PERMISSION_USER_READ | FILE_PERMISSION_USER_WRITE |
+                  FILE_PERMISSION_GROUP_READ | FILE_PERMISSION_OTHER_READ;
+
+    Status = OsOpen(INVALID_HANDLE,
+                    TemporaryPath,
+                    TemporaryPathSize,
+                    SYS_OPEN_FLAG_CREATE | SYS_OPEN_FLAG_FAIL_IF_EXISTS |
+                    SYS_OPEN_FLAG_WRITE | SYS_OPEN_FLAG_CLOSE_ON_EXECUTE,
+                    Permissions,
+                    &Handle);
+
+    if (!KSUCCESS(Status)) {
+        goto SaveFileEnd;
+    }
+
+    Created = TRUE;
+    Status = OsPerformIo(Handle,
+                         0,
+                         Size,
+                         SYS_IO_FLAG_WRITE,
+                         SYS_WAIT_TIME_INDEFINITE,
+                         Buffer,
+                         &BytesCompleted);
+
+    if (!KSUCCESS(Status)) {
+        goto SaveFileEnd;
+    }
+
+    if (BytesCompleted != Size) {
+        Status = STATUS_DATA_LENGTH_MISMATCH;
+        goto SaveFileEnd;
+    }
+
+    OsClose(Handle);
+    Handle = INVALID_HANDLE;
+    Status = OsRename(INVALID_HANDLE,
+                      TemporaryPath,
+                      TemporaryPathSize,
+                      INVALID_HANDLE,
+                      (PSTR)Path,
+                      TemporaryPathSize - OS_IMAGE_SAVE_SUFFIX_SIZE + 1);
+
+    if (!KSUCCESS(Status)) {
+        goto SaveFileEnd;
+    }
+
+    Renamed = TRUE;
+
+SaveFileEnd:
+    if (Handle != INVALID_HANDLE) {
+        OsClose(Handle);
+    }
+
+    if (TemporaryPath != NULL) {
+        if ((Created != FALSE) && (Renamed == FALSE)) {
+            OsDelete(INVALID_HANDLE, TemporaryPath, TemporaryPathSize, 0);
+        }
+
+        OsHeapFree(TemporaryPath);
+    }
+
+    return Status;
+}
+
+KSTATUS
+OspImOpenCacheFile (
+    PVOID SystemContext,
+    PCSTR Path,
+    PIMAGE_FILE_INFORMATION File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine opens a cache file previously written with the save file
+    routine. Since the image library trusts what it reads from a cache, the
+    file is only opened if it is owned by the administrator or the current
+    user and is not writable by the group or others. Set-ID programs never
+    use cache files.
+
+Arguments:
+
+    SystemContext - Supplies the context pointer passed to the load executable
+        function.
+
+    Path - Supplies a pointer to the path of the file to open.
+
+    File - Supplies a pointer where the information for the file including its
+        open handle will be returned.
+
+Return Value:
+
+    STATUS_ACCESS_DENIED if the file cannot be trusted.
+
+    Other status codes.
+
+--*/
+
+{
+
+    FILE_CONTROL_PARAMETERS_UNION FileControlParameters;
+    FILE_PROPERTIES FileProperties;
+    PTHREAD_IDENTITY Identity;
+    KSTATUS Status;
+
+    File->Handle = INVALID_HANDLE;
+    if (OspImIsSetId() != FALSE) {
+        Status = STATUS_ACCESS_DENIED;
+        goto OpenCacheFileEnd;
+    }
+
+    Status = OspImOpenFile(SystemContext, Path, File);
+    if (!KSUCCESS(Status)) {
+        goto OpenCacheFileEnd;
+    }
+
+    FileControlParameters.SetFileInformation.FieldsToSet = 0;
+    FileControlParameters.SetFileInformation.FileProperties = &FileProperties;
+    Status = OsFileControl(File->Handle,
+                           FileControlCommandGetFileInformation,
+                           &FileControlParameters);
+
+    if (!KSUCCESS(Status)) {
+        goto OpenCacheFileEnd;
+    }
+
+    Identity = &(OsEnvironment->StartData->Identity);
+    if (((FileProperties.UserId != USER_ID_ROOT) &&
+         (FileProperties.UserId != Identity->EffectiveUserId)) ||
+        ((FileProperties.Permissions &
+          (FILE_PERMISSION_GROUP_WRITE | FILE_PERMISSION_OTHER_WRITE)) != 0)) {
+
+        Status = STATUS_ACCESS_DENIED;
+        goto OpenCacheFileEnd;
+    }
+
+    Status = STATUS_SUCCESS;
+
+OpenCacheFileEnd:
+    if (!KSUCCESS(Status)) {
+        OspImCloseFile(File);
+    }
+
+    return Status;
+}
+
+BOOL
+OspImIsSetId (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the current process is running with a
+    user or group ID other than that of the user who ran it.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the process is running set-user-ID or set-group-ID.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    PTHREAD_IDENTITY Identity;
+
+    Identity = &(OsEnvironment->StartData->Identity);
+    if ((Identity->RealUserId != Identity->EffectiveUserId) ||
+        (Identity->RealGroupId != Identity->EffectiveGroupId)) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 VOID
 OspImInitializeImages (
     PLIST_ENTRY ListHead
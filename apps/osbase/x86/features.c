@@ -29,7 +29,10 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+#define CRYPTO_API __DLLPROTECTED
+
 #include "../osbasep.h"
+#include <minoca/lib/crypto.h>
 
 //
 // ---------------------------------------------------------------- Definitions
@@ -51,7 +54,11 @@ ULONG OsProcessorFeatureMasks[OsX86FeatureCount] = {
     0,
     X86_FEATURE_SYSENTER,
     X86_FEATURE_I686,
-    X86_FEATURE_FXSAVE
+    X86_FEATURE_FXSAVE,
+    X86_FEATURE_SSE2,
+    X86_FEATURE_PCLMULQDQ,
+    X86_FEATURE_AES,
+    X86_FEATURE_SHA
 };
 
 //
@@ -101,6 +108,46 @@ Return Value:
     return FALSE;
 }
 
+VOID
+OspInitializeProcessorFeatures (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects the faster library routines that the current
+    processor supports, such as the hardware CRC-32, AES, and SHA routines.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (OsTestProcessorFeature(OsX86Pclmulqdq) != FALSE) {
+        RtlEnableHardwareCrc32(TRUE);
+    }
+
+    if (OsTestProcessorFeature(OsX86Aes) != FALSE) {
+        CyAesEnableHardware(TRUE);
+    }
+
+    if (OsTestProcessorFeature(OsX86Sha) != FALSE) {
+        CySha1EnableHardware(TRUE);
+        CySha256EnableHardware(TRUE);
+    }
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -544,6 +544,57 @@ Return Value:
     return TotalBytesWritten;
 }
 
+ssize_t
+SetupCopyRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open handle to another at their current
+    positions, without passing it through a buffer. Handles with a cache in
+    front of them are not supported.
+
+Arguments:
+
+    DestinationHandle - Supplies the handle to write to.
+
+    SourceHandle - Supplies the handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
+{
+
+    PSETUP_HANDLE Destination;
+    PSETUP_HANDLE Source;
+
+    Destination = DestinationHandle;
+    Source = SourceHandle;
+    if ((Destination->Cached != FALSE) || (Source->Cached != FALSE)) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    return SetupOsCopyFileRange(Destination->Handle,
+                                Source->Handle,
+                                ByteCount);
+}
+
 LONGLONG
 SetupSeek (
     PVOID Handle,
@@ -916,6 +916,57 @@ Return Value:
     return (ssize_t)BytesComplete;
 }
 
+ssize_t
+SetupFileCopyRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open file to another at their current
+    positions, without passing it through a buffer. This is only possible when
+    both files are on native volumes.
+
+Arguments:
+
+    DestinationHandle - Supplies the file handle to write to.
+
+    SourceHandle - Supplies the file handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
+{
+
+    PSETUP_FILE Destination;
+    PSETUP_FILE Source;
+
+    Destination = DestinationHandle;
+    Source = SourceHandle;
+    if ((Destination->Volume->DestinationType != SetupDestinationDirectory) ||
+        (Source->Volume->DestinationType != SetupDestinationDirectory)) {
+
+        errno = ENOSYS;
+        return -1;
+    }
+
+    return SetupCopyRange(Destination->Handle, Source->Handle, ByteCount);
+}
+
 LONGLONG
 SetupFileSeek (
     PVOID Handle,
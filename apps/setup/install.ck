@@ -136,6 +136,9 @@ if ((arch == "x86") || (arch == "x64")) {
         "rtl81xx.drv",
         "uhci.drv",
         "pcnet32.drv",
+        "virtblk.drv",
+        "virtio.drv",
+        "virtnet.drv",
     ];
 
 } else if ((arch == "armv7") || (arch == "armv6")) {
@@ -166,6 +169,8 @@ if ((arch == "x86") || (arch == "x64")) {
         "usbhub.drv",
         "usbmass.drv",
         "sd.drv",
+        "virtblk.drv",
+        "virtio.drv",
     ];
 }
 
@@ -522,6 +527,9 @@ if (plat == "install-armv6") {
         "usbmouse.drv",
         "usrinput.drv",
         "videocon.drv",
+        "virtblk.drv",
+        "virtio.drv",
+        "virtnet.drv",
     ];
 
     Files += [
@@ -766,6 +774,9 @@ if ((plat == "install-x86") || (plat == "install-x64")) {
         "usbmouse.drv",
         "usrinput.drv",
         "videocon.drv",
+        "virtblk.drv",
+        "virtio.drv",
+        "virtnet.drv",
     ];
 
     Files += [
@@ -387,6 +387,70 @@ Return Value:
     return (ssize_t)BytesCompleted;
 }
 
+ssize_t
+SetupOsCopyFileRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine has the operating system copy data from one open handle to
+    another at their current positions, without passing it through a buffer.
+
+Arguments:
+
+    DestinationHandle - Supplies the handle to write to.
+
+    SourceHandle - Supplies the handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    PSETUP_OS_HANDLE Destination;
+    PSETUP_OS_HANDLE Source;
+    KSTATUS Status;
+
+    Destination = DestinationHandle;
+    Source = SourceHandle;
+    Status = OsCopyFileRange(Source->Handle,
+                             IO_OFFSET_NONE,
+                             Destination->Handle,
+                             IO_OFFSET_NONE,
+                             ByteCount,
+                             0,
+                             &BytesCompleted);
+
+    if (!KSUCCESS(Status)) {
+        if (Status == STATUS_NOT_SUPPORTED) {
+            errno = ENOSYS;
+
+        } else {
+            errno = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        return -1;
+    }
+
+    return (ssize_t)BytesCompleted;
+}
+
 LONGLONG
 SetupOsSeek (
     PVOID Handle,
@@ -601,6 +601,39 @@ Return Value:
 
 --*/
 
+ssize_t
+SetupOsCopyFileRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine has the operating system copy data from one open handle to
+    another at their current positions, without passing it through a buffer.
+
+Arguments:
+
+    DestinationHandle - Supplies the handle to write to.
+
+    SourceHandle - Supplies the handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
 LONGLONG
 SetupOsSeek (
     PVOID Handle,
@@ -1020,6 +1053,40 @@ Return Value:
 
 --*/
 
+ssize_t
+SetupCopyRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open handle to another at their current
+    positions, without passing it through a buffer. Handles with a cache in
+    front of them are not supported.
+
+Arguments:
+
+    DestinationHandle - Supplies the handle to write to.
+
+    SourceHandle - Supplies the handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
 LONGLONG
 SetupSeek (
     PVOID Handle,
@@ -1407,6 +1474,40 @@ Return Value:
 
 --*/
 
+ssize_t
+SetupFileCopyRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open file to another at their current
+    positions, without passing it through a buffer. This is only possible when
+    both files are on native volumes.
+
+Arguments:
+
+    DestinationHandle - Supplies the file handle to write to.
+
+    SourceHandle - Supplies the file handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
 LONGLONG
 SetupFileSeek (
     PVOID Handle,
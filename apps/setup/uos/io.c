@@ -341,6 +341,45 @@ Return Value:
     return BytesWritten;
 }
 
+ssize_t
+SetupOsCopyFileRange (
+    PVOID DestinationHandle,
+    PVOID SourceHandle,
+    size_t ByteCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine has the operating system copy data from one open handle to
+    another at their current positions, without passing it through a buffer.
+
+Arguments:
+
+    DestinationHandle - Supplies the handle to write to.
+
+    SourceHandle - Supplies the handle to read from.
+
+    ByteCount - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the
+    source.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENOSYS if the data cannot be copied directly, in which case the
+    caller should read and write it instead.
+
+--*/
+
+{
+
+    errno = ENOSYS;
+    return -1;
+}
+
 LONGLONG
 SetupOsSeek (
     PVOID Handle,
@@ -47,6 +47,13 @@ Module Name:
 
 #define SETUP_FILE_BUFFER_SIZE (1024 * 512)
 
+//
+// Define the number of bytes to ask the OS to copy at once between native
+// files.
+//
+
+#define SETUP_FILE_COPY_RANGE_SIZE (1024 * 1024 * 16)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1000,6 +1007,34 @@ Return Value:
             goto CopyFileEnd;
         }
 
+        //
+        // Try to have the OS copy the data directly between native files.
+        // Fall back to copying it through the buffer if that's not possible.
+        //
+
+        while (FileSize != 0) {
+            Size = SETUP_FILE_COPY_RANGE_SIZE;
+            if (Size > FileSize) {
+                Size = FileSize;
+            }
+
+            Size = SetupFileCopyRange(DestinationFile, SourceFile, Size);
+            if (Size <= 0) {
+                if ((Size < 0) && (errno != ENOSYS)) {
+                    Result = errno;
+                    fprintf(stderr,
+                            "Failed to copy to file %s.\n",
+                            DestinationPath);
+
+                    goto CopyFileEnd;
+                }
+
+                break;
+            }
+
+            FileSize -= Size;
+        }
+
         //
         // Loop copying chunks.
         //
@@ -218,10 +218,11 @@ function build() {
         buildSources = baseSources + win32Sources;
         buildLibs = ["apps/libc/dynamic:wincsup"] + buildLibs;
         buildIncludes += ["$S/apps/libc/dynamic/wincsup/include"];
-        buildConfig["DYNLIBS"] += ["-lpsapi", "-lws2_32"];
+        buildConfig["DYNLIBS"] += ["-lpsapi", "-lws2_32", "-lpthread"];
 
     } else {
         buildSources = baseSources + uosOnlyCommands + uosSources;
+        buildConfig["DYNLIBS"] += ["-lpthread"];
         if (buildOs == "Linux") {
             buildConfig["DYNLIBS"] += ["-ldl", "-lutil"];
         }
@@ -53,9 +53,21 @@ Module Name:
 SWISS_COMMAND_ENTRY SwissCommands[] = {
     {SH_COMMAND_NAME, SH_COMMAND_DESCRIPTION, ShMain, 0},
     {CAT_COMMAND_NAME, CAT_COMMAND_DESCRIPTION, CatMain, 0},
-    {ECHO_COMMAND_NAME, ECHO_COMMAND_DESCRIPTION, EchoMain, 0},
-    {TEST_COMMAND_NAME, TEST_COMMAND_DESCRIPTION, TestMain, 0},
-    {TEST_COMMAND_NAME2, TEST_COMMAND_DESCRIPTON2, TestMain, 0},
+    {ECHO_COMMAND_NAME,
+     ECHO_COMMAND_DESCRIPTION,
+     EchoMain,
+     SWISS_APP_IN_PROCESS},
+
+    {TEST_COMMAND_NAME,
+     TEST_COMMAND_DESCRIPTION,
+     TestMain,
+     SWISS_APP_IN_PROCESS},
+
+    {TEST_COMMAND_NAME2,
+     TEST_COMMAND_DESCRIPTON2,
+     TestMain,
+     SWISS_APP_IN_PROCESS},
+
     {MKDIR_COMMAND_NAME, MKDIR_COMMAND_DESCRIPTION, MkdirMain, 0},
     {LS_COMMAND_NAME, LS_COMMAND_DESCRIPTION, LsMain, 0},
     {RM_COMMAND_NAME, RM_COMMAND_DESCRIPTION, RmMain, 0},
@@ -63,20 +75,40 @@ SWISS_COMMAND_ENTRY SwissCommands[] = {
     {MV_COMMAND_NAME, MV_COMMAND_DESCRIPTION, MvMain, 0},
     {CP_COMMAND_NAME, CP_COMMAND_DESCRIPTION, CpMain, 0},
     {SED_COMMAND_NAME, SED_COMMAND_DESCRIPTION, SedMain, 0},
-    {PRINTF_COMMAND_NAME, PRINTF_COMMAND_DESCRIPTION, PrintfMain, 0},
-    {EXPR_COMMAND_NAME, EXPR_COMMAND_DESCRIPTION, ExprMain, 0},
+    {PRINTF_COMMAND_NAME,
+     PRINTF_COMMAND_DESCRIPTION,
+     PrintfMain,
+     SWISS_APP_IN_PROCESS},
+
+    {EXPR_COMMAND_NAME,
+     EXPR_COMMAND_DESCRIPTION,
+     ExprMain,
+     SWISS_APP_IN_PROCESS},
+
     {CHMOD_COMMAND_NAME, CHMOD_COMMAND_DESCRIPTION, ChmodMain, 0},
     {GREP_COMMAND_NAME, GREP_COMMAND_DESCRIPTION, GrepMain, 0},
     {EGREP_COMMAND_NAME, EGREP_COMMAND_DESCRIPTION, EgrepMain, 0},
     {FGREP_COMMAND_NAME, FGREP_COMMAND_DESCRIPTION, FgrepMain, 0},
     {UNAME_COMMAND_NAME, UNAME_COMMAND_DESCRIPTION, UnameMain, 0},
     {BASENAME_COMMAND_NAME, BASENAME_COMMAND_DESCRIPTION, BasenameMain, 0},
-    {DIRNAME_COMMAND_NAME, DIRNAME_COMMAND_DESCRIPTION, DirnameMain, 0},
+    {DIRNAME_COMMAND_NAME,
+     DIRNAME_COMMAND_DESCRIPTION,
+     DirnameMain,
+     SWISS_APP_IN_PROCESS},
+
     {SORT_COMMAND_NAME, SORT_COMMAND_DESCRIPTION, SortMain, 0},
     {TR_COMMAND_NAME, TR_COMMAND_DESCRIPTION, TrMain, 0},
     {TOUCH_COMMAND_NAME, TOUCH_COMMAND_DESCRIPTION, TouchMain, 0},
-    {TRUE_COMMAND_NAME, TRUE_COMMAND_DESCRIPTION, TrueMain, 0},
-    {FALSE_COMMAND_NAME, FALSE_COMMAND_DESCRIPTION, FalseMain, 0},
+    {TRUE_COMMAND_NAME,
+     TRUE_COMMAND_DESCRIPTION,
+     TrueMain,
+     SWISS_APP_IN_PROCESS},
+
+    {FALSE_COMMAND_NAME,
+     FALSE_COMMAND_DESCRIPTION,
+     FalseMain,
+     SWISS_APP_IN_PROCESS},
+
     {PWD_COMMAND_NAME, PWD_COMMAND_DESCRIPTION, PwdMain, 0},
     {ENV_COMMAND_NAME, ENV_COMMAND_DESCRIPTION, EnvMain, 0},
     {FIND_COMMAND_NAME, FIND_COMMAND_DESCRIPTION, FindMain, 0},
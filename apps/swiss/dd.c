@@ -185,6 +185,23 @@ Module Name:
 
 #define DD_OPTION_FULL_BLOCKS 0x00000800
 
+//
+// Define the options that transform the data, which prevent the operating
+// system from copying it directly.
+//
+
+#define DD_CONVERSION_OPTIONS                                                  \
+    (DD_OPTION_BLOCK | DD_OPTION_UNBLOCK | DD_OPTION_LOWERCASE |               \
+     DD_OPTION_UPPERCASE | DD_OPTION_SPARSE | DD_OPTION_SWAB |                 \
+     DD_OPTION_SYNC | DD_OPTION_NO_ERROR)
+
+//
+// Define the approximate amount of data to ask the operating system to copy
+// at a time. This is rounded down to a multiple of the block size.
+//
+
+#define DD_COPY_RANGE_SIZE (1024 * 1024)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -269,6 +286,15 @@ DdPrintIoStatistics (
     PDD_CONTEXT Context
     );
 
+INT
+DdCopyFileRange (
+    PDD_CONTEXT Context,
+    int Input,
+    PSTR InPath,
+    int Output,
+    PSTR OutPath
+    );
+
 INT
 DdParseConversionArguments (
     PDD_CONTEXT Context,
@@ -647,6 +673,23 @@ Return Value:
         }
     }
 
+    //
+    // If the data is not being transformed, try to have the operating system
+    // copy it directly. Fall back to reading and writing if it can't.
+    //
+
+    if (((Context.Options & DD_CONVERSION_OPTIONS) == 0) &&
+        (Context.InBlockSize == Context.OutBlockSize)) {
+
+        Status = DdCopyFileRange(&Context, Input, InPath, Output, OutPath);
+        if (Status == 0) {
+            goto MainCopyDone;
+
+        } else if (Status != ENOSYS) {
+            goto MainEnd;
+        }
+    }
+
     //
     // Loop processing data.
     //
@@ -830,6 +873,7 @@ Return Value:
         }
     }
 
+MainCopyDone:
     DdPrintIoStatistics(&Context);
     Status = 0;
 
@@ -898,6 +942,140 @@ Return Value:
     return;
 }
 
+INT
+DdCopyFileRange (
+    PDD_CONTEXT Context,
+    int Input,
+    PSTR InPath,
+    int Output,
+    PSTR OutPath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine has the operating system copy data directly from the input to
+    the output, starting at their current file positions. This is only
+    suitable when no conversions are requested and the input and output block
+    sizes match.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Input - Supplies the input file descriptor.
+
+    InPath - Supplies the name of the input, for error messages.
+
+    Output - Supplies the output file descriptor.
+
+    OutPath - Supplies the name of the output, for error messages.
+
+Return Value:
+
+    0 on success.
+
+    ENOSYS if the operating system cannot copy between these descriptors. No
+    data has been copied in this case.
+
+    Returns an error number on other failures.
+
+--*/
+
+{
+
+    UINTN BlockSize;
+    ssize_t BytesCopied;
+    UINTN BytesThisRound;
+    BOOL Copied;
+    off_t InOffset;
+    off_t OutOffset;
+    UINTN RangeSize;
+    INT Status;
+
+    //
+    // Copying at explicit offsets requires seekable descriptors.
+    //
+
+    InOffset = lseek(Input, 0, SEEK_CUR);
+    OutOffset = lseek(Output, 0, SEEK_CUR);
+    if ((InOffset < 0) || (OutOffset < 0)) {
+        return ENOSYS;
+    }
+
+    BlockSize = Context->InBlockSize;
+    RangeSize = BlockSize;
+    if (RangeSize < DD_COPY_RANGE_SIZE) {
+        RangeSize = (DD_COPY_RANGE_SIZE / BlockSize) * BlockSize;
+    }
+
+    Copied = FALSE;
+    while ((Context->Count == 0) ||
+           (Context->BytesComplete < Context->Count)) {
+
+        if (Context->PrintRequest != FALSE) {
+            Context->PrintRequest = FALSE;
+            DdPrintIoStatistics(Context);
+        }
+
+        if (Context->Exit != FALSE) {
+            return EINTR;
+        }
+
+        BytesThisRound = RangeSize;
+        if ((Context->Count != 0) &&
+            (Context->Count - Context->BytesComplete < BytesThisRound)) {
+
+            BytesThisRound = Context->Count - Context->BytesComplete;
+        }
+
+        BytesCopied = SwCopyFileRange(Input,
+                                      &InOffset,
+                                      Output,
+                                      &OutOffset,
+                                      BytesThisRound);
+
+        if (BytesCopied < 0) {
+            Status = errno;
+            if (Status == EINTR) {
+                continue;
+            }
+
+            if ((Status == ENOSYS) && (Copied == FALSE)) {
+                return ENOSYS;
+            }
+
+            SwPrintError(Status,
+                         NULL,
+                         "Failed to copy %s to %s",
+                         InPath,
+                         OutPath);
+
+            return Status;
+        }
+
+        if (BytesCopied == 0) {
+            break;
+        }
+
+        //
+        // Account for the copy as if it had been done a block at a time.
+        //
+
+        Copied = TRUE;
+        Context->BytesComplete += BytesCopied;
+        Context->InWholeBlocks += BytesCopied / BlockSize;
+        Context->OutWholeBlocks += BytesCopied / BlockSize;
+        if ((BytesCopied % BlockSize) != 0) {
+            Context->InPartialBlocks += 1;
+            Context->OutPartialBlocks += 1;
+        }
+    }
+
+    return 0;
+}
+
 VOID
 DdPrintIoStatistics (
     PDD_CONTEXT Context
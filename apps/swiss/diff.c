@@ -50,7 +50,7 @@ Module Name:
 #define DIFF_VERSION_MINOR 0
 
 #define DIFF_USAGE                                                             \
-    "usage: diff [-c | -e | -f | -C n][-br] file1 file2\n"                     \
+    "usage: diff [-c | -e | -f | -C n][-bdr] file1 file2\n"                    \
     "The diff utility compares the contents of two paths and reports the \n"   \
     "differences to standard out. Options are:\n"                              \
     "  -b, --ignore-space-change -- Ignore whitespace changes.\n"              \
@@ -58,7 +58,13 @@ Module Name:
     "  -C, --context=n -- Produce n lines of context around every diff, \n"    \
     "      where n is a decimal integer.\n"                                    \
     "  --color=value -- Turn on or off color printing. Valid values are \n"    \
-    "      always, never, and auto."                                           \
+    "      always, never, and auto.\n"                                         \
+    "  -d, --minimal -- Try hard to find the smallest set of changes.\n"       \
+    "  --diff-algorithm=name -- Select the algorithm used to find the \n"      \
+    "      differences. Valid values are myers (the default), minimal, \n"     \
+    "      patience, and histogram.\n"                                         \
+    "  --patience -- Use the patience diff algorithm.\n"                       \
+    "  --histogram -- Use the histogram diff algorithm.\n"                     \
     "  -e, --ed -- Output an ed script.\n"                                     \
     "  -N, --new-file -- Treat absent files as empty.\n"                       \
     "  -r, --recursive -- Recursively compare any subdirectories found.\n"     \
@@ -68,7 +74,7 @@ Module Name:
     "  --help -- Show this help text and exit.\n"                              \
     "  --version -- Show the application version information and exit.\n"      \
 
-#define DIFF_OPTIONS_STRING "bcC:eNru::x:"
+#define DIFF_OPTIONS_STRING "bcC:deNru::x:"
 
 //
 // Define the diff option flags.
@@ -78,6 +84,7 @@ Module Name:
 #define DIFF_OPTION_RECURSIVE     0x00000002
 #define DIFF_OPTION_COLOR         0x00000004
 #define DIFF_OPTION_ABSENT_EMPTY  0x00000008
+#define DIFF_OPTION_MINIMAL       0x00000010
 
 //
 // Define the default number of context lines when they're asked for.
@@ -103,6 +110,49 @@ Module Name:
 
 #define DIFF_INITIAL_LINE_BUFFER 256
 
+//
+// Define the minimum number of buckets in the hash table used to assign line
+// IDs. This must be a power of two.
+//
+
+#define DIFF_MINIMUM_HASH_BUCKETS 16
+
+//
+// Define the FNV-1a parameters used to hash lines.
+//
+
+#define DIFF_HASH_INITIAL_VALUE 0x811C9DC5
+#define DIFF_HASH_MULTIPLIER 0x01000193
+
+//
+// Define the flags describing where a line ID appears.
+//
+
+#define DIFF_CLASS_IN_A 0x01
+#define DIFF_CLASS_IN_B 0x02
+#define DIFF_CLASS_FINAL 0x04
+
+//
+// Define the smallest cost at which the Myers' search gives up on finding
+// the optimal middle snake, unless a minimal diff was requested.
+//
+
+#define DIFF_MINIMUM_EXPENSIVE_COST 4096
+
+//
+// Define the maximum number of times a line can appear in a region of file A
+// and still be used as an anchor by the histogram algorithm.
+//
+
+#define DIFF_HISTOGRAM_MAX_CHAIN 64
+
+//
+// Define the maximum recursion depth of the patience algorithm before it
+// hands the remaining region to the Myers' algorithm.
+//
+
+#define DIFF_MAX_PATIENCE_DEPTH 256
+
 //
 // Define the colors used for insertion and deletion.
 //
@@ -128,6 +178,13 @@ typedef enum _DIFF_OUTPUT_TYPE {
     DiffOutputUnified,
 } DIFF_OUTPUT_TYPE, *PDIFF_OUTPUT_TYPE;
 
+typedef enum _DIFF_ALGORITHM {
+    DiffAlgorithmInvalid,
+    DiffAlgorithmMyers,
+    DiffAlgorithmPatience,
+    DiffAlgorithmHistogram,
+} DIFF_ALGORITHM, *PDIFF_ALGORITHM;
+
 typedef enum _DIFF_FILE_TYPE {
     DiffFileUnknown,
     DiffFileBlockDevice,
@@ -152,8 +209,11 @@ Structure Description:
 
     Size - Stores the size of the line data in bytes.
 
-    Hash - Stores the hash of the file, which is used to quickly determine if
-        two files are not equal (but not necessarily if they're equal).
+    Hash - Stores the hash of the line, which is used to quickly determine if
+        two lines are not equal (but not necessarily if they're equal).
+
+    Id - Stores the line's ID. Two lines in a comparison have the same ID if
+        and only if they are equal.
 
     Modified - Stores a boolean indicating that this line is part of the diff.
 
@@ -163,6 +223,7 @@ typedef struct _DIFF_LINE {
     PSTR Data;
     UINTN Size;
     ULONG Hash;
+    ULONG Id;
     BOOL Modified;
 } DIFF_LINE, *PDIFF_LINE;
 
@@ -239,6 +300,8 @@ Structure Description:
 
     OutputType - Stores the type of output to produce.
 
+    Algorithm - Stores the algorithm used to find the differences.
+
     ContextLines - Stores the number of lines of context to produce around
         each diff.
 
@@ -256,12 +319,90 @@ Structure Description:
 typedef struct _DIFF_CONTEXT {
     ULONG Options;
     DIFF_OUTPUT_TYPE OutputType;
+    DIFF_ALGORITHM Algorithm;
     LONG ContextLines;
     DIFF_FILE EmptyFile;
     PSTR *FileExclusions;
     UINTN FileExclusionCount;
 } DIFF_CONTEXT, *PDIFF_CONTEXT;
 
+/*++
+
+Structure Description:
+
+    This structure stores the state used while computing the differences
+    between two files. The algorithms work on sequences of line IDs that leave
+    out the lines which appear in only one of the files.
+
+Members:
+
+    Context - Stores a pointer to the application context.
+
+    FileA - Stores a pointer to the first file.
+
+    FileB - Stores a pointer to the second file.
+
+    IdsA - Stores the array of line IDs for sequence A.
+
+    IdsB - Stores the array of line IDs for sequence B.
+
+    LinesA - Stores the index within file A of each element of sequence A.
+
+    LinesB - Stores the index within file B of each element of sequence B.
+
+    CountA - Stores the number of elements in sequence A.
+
+    CountB - Stores the number of elements in sequence B.
+
+    DownVector - Stores the k-indexed vector for computing the shortest
+        middle snake from the top down.
+
+    UpVector - Stores the k-indexed vector for computing the shortest middle
+        snake from the bottom up.
+
+    CostLimit - Stores the D value at which the Myers' search settles for a
+        good split instead of the best one, or 0 to always find the best.
+
+    ClassCount - Stores the number of distinct line IDs.
+
+    OccurrencesA - Stores an array indexed by line ID used to count lines in
+        a region of sequence A. This is all zeros between uses.
+
+    OccurrencesB - Stores an array indexed by line ID used to count lines in
+        a region of sequence B. This is all zeros between uses.
+
+    FirstA - Stores an array indexed by line ID of the first position of that
+        line in a region of sequence A. This is all -1 between uses.
+
+    NextA - Stores an array indexed by position in sequence A of the next
+        position with the same line ID, or -1.
+
+    Different - Stores a boolean indicating whether any lines were found to
+        differ.
+
+--*/
+
+typedef struct _DIFF_COMPARISON {
+    PDIFF_CONTEXT Context;
+    PDIFF_FILE FileA;
+    PDIFF_FILE FileB;
+    PULONG IdsA;
+    PULONG IdsB;
+    PINTN LinesA;
+    PINTN LinesB;
+    INTN CountA;
+    INTN CountB;
+    PINTN DownVector;
+    PINTN UpVector;
+    INTN CostLimit;
+    ULONG ClassCount;
+    PINTN OccurrencesA;
+    PINTN OccurrencesB;
+    PINTN FirstA;
+    PINTN NextA;
+    BOOL Different;
+} DIFF_COMPARISON, *PDIFF_COMPARISON;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -374,40 +515,77 @@ DiffCompareBinaryFiles (
     );
 
 INT
-DiffComputeLongestCommonSubsequence (
+DiffPrepareComparison (
     PDIFF_CONTEXT Context,
     PDIFF_FILE FileA,
     PDIFF_FILE FileB,
+    PDIFF_COMPARISON Comparison
+    );
+
+VOID
+DiffDestroyComparison (
+    PDIFF_COMPARISON Comparison
+    );
+
+INT
+DiffAssignLineIds (
+    PDIFF_COMPARISON Comparison,
+    PUCHAR *ClassFiles
+    );
+
+VOID
+DiffMarkModified (
+    PDIFF_COMPARISON Comparison,
     INTN LowerA,
     INTN UpperA,
     INTN LowerB,
-    INTN UpperB,
-    PINTN DownVector,
-    PINTN UpVector
+    INTN UpperB
+    );
+
+VOID
+DiffComputeLongestCommonSubsequence (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB
     );
 
 VOID
 DiffComputeShortestMiddleSnake (
-    PDIFF_CONTEXT Context,
-    PDIFF_FILE FileA,
-    PDIFF_FILE FileB,
+    PDIFF_COMPARISON Comparison,
     INTN LowerA,
     INTN UpperA,
     INTN LowerB,
     INTN UpperB,
-    PINTN DownVector,
-    PINTN UpVector,
     PINTN MiddleSnakeX,
     PINTN MiddleSnakeY
     );
 
+VOID
+DiffComputePatienceDiff (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB,
+    ULONG Depth
+    );
+
+VOID
+DiffComputeHistogramDiff (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB
+    );
+
 INT
 DiffCompareLines (
     PDIFF_CONTEXT Context,
-    PDIFF_FILE FileA,
-    PDIFF_FILE FileB,
-    UINTN LineIndexA,
-    UINTN LineIndexB
+    PDIFF_LINE LineA,
+    PDIFF_LINE LineB
     );
 
 VOID
@@ -456,8 +634,12 @@ struct option DiffLongOptions[] = {
     {"ignore-space-change", no_argument, 0, 'b'},
     {"context", optional_argument, 0, 'C'},
     {"color", required_argument, 0, '1'},
+    {"diff-algorithm", required_argument, 0, '2'},
     {"ed", no_argument, 0, 'e'},
+    {"histogram", no_argument, 0, '4'},
+    {"minimal", no_argument, 0, 'd'},
     {"new-file", no_argument, 0, 'N'},
+    {"patience", no_argument, 0, '3'},
     {"recursive", no_argument, 0, 'r'},
     {"unified", optional_argument, 0, 'u'},
     {"help", no_argument, 0, 'h'},
@@ -519,6 +701,7 @@ Return Value:
     memset(&Context, 0, sizeof(DIFF_CONTEXT));
     ContextLinesSpecified = FALSE;
     Context.OutputType = DiffOutputDefault;
+    Context.Algorithm = DiffAlgorithmMyers;
     OutputIsTerminal = FALSE;
     if (isatty(STDOUT_FILENO) != 0) {
         OutputIsTerminal = TRUE;
@@ -602,6 +785,45 @@ Return Value:
 
             break;
 
+        case '2':
+
+            assert(optarg != NULL);
+
+            if ((strcasecmp(optarg, "myers") == 0) ||
+                (strcasecmp(optarg, "default") == 0)) {
+
+                Context.Algorithm = DiffAlgorithmMyers;
+
+            } else if (strcasecmp(optarg, "minimal") == 0) {
+                Context.Algorithm = DiffAlgorithmMyers;
+                Context.Options |= DIFF_OPTION_MINIMAL;
+
+            } else if (strcasecmp(optarg, "patience") == 0) {
+                Context.Algorithm = DiffAlgorithmPatience;
+
+            } else if (strcasecmp(optarg, "histogram") == 0) {
+                Context.Algorithm = DiffAlgorithmHistogram;
+
+            } else {
+                SwPrintError(0, optarg, "Invalid diff algorithm");
+                Status = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
+        case '3':
+            Context.Algorithm = DiffAlgorithmPatience;
+            break;
+
+        case '4':
+            Context.Algorithm = DiffAlgorithmHistogram;
+            break;
+
+        case 'd':
+            Context.Options |= DIFF_OPTION_MINIMAL;
+            break;
+
         case 'e':
             if (Context.ContextLines != 0) {
                 SwPrintError(0, NULL, "Conflicting output style options");
@@ -1941,7 +2163,7 @@ Return Value:
 
     while (TRUE) {
         LineBufferSize = 0;
-        LineHash = 0;
+        LineHash = DIFF_HASH_INITIAL_VALUE;
 
         //
         // Loop adding characters to the line.
@@ -1985,15 +2207,17 @@ Return Value:
             LineBufferSize += 1;
 
             //
-            // The poor man's hash is really just the sum of all the
-            // characters. Don't count this character as part of the hash if
-            // it's blank and blanks are being ignored.
+            // Fold the character into an FNV-1a hash, which spreads lines
+            // out well enough to find equal lines with a hash table. Don't
+            // count this character as part of the hash if it's blank and
+            // blanks are being ignored.
             //
 
             if (((Context->Options & DIFF_OPTION_IGNORE_BLANKS) == 0) ||
                 (isspace(Character) == 0)) {
 
-                LineHash += Character;
+                LineHash = (LineHash ^ (UCHAR)Character) *
+                           DIFF_HASH_MULTIPLIER;
             }
         }
 
@@ -2142,11 +2366,10 @@ Return Value:
 
 {
 
-    PINTN DownVector;
-    UINTN Maximum;
+    DIFF_COMPARISON Comparison;
     INT Status;
-    PINTN UpVector;
-    UINTN VectorSize;
+
+    memset(&Comparison, 0, sizeof(DIFF_COMPARISON));
 
     //
     // Load up the two files.
@@ -2212,47 +2435,54 @@ Return Value:
         return Status;
     }
 
-    //
-    // Allocate vectors (V in the paper) for computing the shortest middle
-    // snake from both directions (forward and reverse). The vectors are
-    // indexed by k-line, which is the distance from the diagonal. The maximum
-    // possible distance is the sum of the two lengths. This goes in either
-    // direction (times two), plus two extra.
-    //
-
-    Maximum = FileA->LineCount + FileB->LineCount + 1;
-    VectorSize = (2 * Maximum) + 2;
-    DownVector = malloc(sizeof(INTN) * VectorSize);
-    if (DownVector == NULL) {
-        Status = ENOMEM;
-        goto CompareRegularFilesEnd;
-    }
-
-    UpVector = malloc(sizeof(INTN) * VectorSize);
-    if (UpVector == NULL) {
-        Status = ENOMEM;
+    Status = DiffPrepareComparison(Context, FileA, FileB, &Comparison);
+    if (Status != 0) {
         goto CompareRegularFilesEnd;
     }
 
     //
-    // Find the longest common subsequence, which marks the different lines
-    // as modified.
+    // Find a common subsequence with the selected algorithm, which marks the
+    // different lines as modified.
     //
 
-    Status = DiffComputeLongestCommonSubsequence(Context,
-                                                 FileA,
-                                                 FileB,
-                                                 0,
-                                                 FileA->LineCount,
-                                                 0,
-                                                 FileB->LineCount,
-                                                 DownVector,
-                                                 UpVector);
+    switch (Context->Algorithm) {
+    case DiffAlgorithmPatience:
+        DiffComputePatienceDiff(&Comparison,
+                                0,
+                                Comparison.CountA,
+                                0,
+                                Comparison.CountB,
+                                0);
+
+        break;
+
+    case DiffAlgorithmHistogram:
+        DiffComputeHistogramDiff(&Comparison,
+                                 0,
+                                 Comparison.CountA,
+                                 0,
+                                 Comparison.CountB);
+
+        break;
+
+    case DiffAlgorithmMyers:
+    default:
+        DiffComputeLongestCommonSubsequence(&Comparison,
+                                            0,
+                                            Comparison.CountA,
+                                            0,
+                                            Comparison.CountB);
+
+        break;
+    }
 
-    if (Status != 1) {
+    if (Comparison.Different == FALSE) {
+        Status = 0;
         goto CompareRegularFilesEnd;
     }
 
+    Status = 1;
+
     if (RecursionLevel != 0) {
         DiffPrintCommandLine(Context, DirectoryA, FileA, DirectoryB, FileB);
     }
@@ -2283,6 +2513,7 @@ Return Value:
     }
 
 CompareRegularFilesEnd:
+    DiffDestroyComparison(&Comparison);
     return Status;
 }
 
@@ -2371,27 +2602,21 @@ Return Value:
 }
 
 INT
-DiffComputeLongestCommonSubsequence (
+DiffPrepareComparison (
     PDIFF_CONTEXT Context,
     PDIFF_FILE FileA,
     PDIFF_FILE FileB,
-    INTN LowerA,
-    INTN UpperA,
-    INTN LowerB,
-    INTN UpperB,
-    PINTN DownVector,
-    PINTN UpVector
+    PDIFF_COMPARISON Comparison
     )
 
 /*++
 
 Routine Description:
 
-    This routine implements the Myers' algorithm for computing the longest
-    common subsequence in linear space (but with recursion). The algorithm is
-    a divide-and-conquer algorithm, finding an element of the correct path
-    in the middle and then recursing on each of the slightly smaller split
-    pieces.
+    This routine sets up the state needed to compute the differences between
+    two loaded files. Each line is assigned an ID, and lines that do not
+    appear anywhere in the other file are marked as modified and left out of
+    the sequences the algorithms work on.
 
 Arguments:
 
@@ -2401,208 +2626,584 @@ Routine Description:
 
     FileB - Supplies a pointer to the second file.
 
-    LowerA - Supplies the starting index within file A to work on.
-
-    UpperA - Supplies the ending index within file A to work on, exclusive.
-
-    LowerB - Supplies the starting index within file B to work on.
-
-    UpperB - Supplies the ending index within file B to work on, exclusive.
-
-    DownVector - Supplies the k-indexed vector for computing the shortest
-        middle snake from the top down.
-
-    UpVector - Supplies the k-indexed vector for computing the shortest middle
-        snake from the bottom up.
+    Comparison - Supplies a pointer to the comparison to initialize. The
+        caller must call DiffDestroyComparison on it even if this routine
+        fails.
 
 Return Value:
 
-    0 if the files are equal in the compared region.
+    0 on success.
 
-    1 if the files differ somewhere.
+    Returns an error number on failure.
 
 --*/
 
 {
 
-    INTN MiddleSnakeX;
-    INTN MiddleSnakeY;
+    PUCHAR ClassFiles;
+    INTN Index;
+    PDIFF_LINE Line;
+    INTN Maximum;
     INT Status;
-    INT TotalStatus;
+    INTN TotalLines;
+    INTN VectorSize;
+
+    memset(Comparison, 0, sizeof(DIFF_COMPARISON));
+    Comparison->Context = Context;
+    Comparison->FileA = FileA;
+    Comparison->FileB = FileB;
+    ClassFiles = NULL;
+    Status = DiffAssignLineIds(Comparison, &ClassFiles);
+    if (Status != 0) {
+        goto PrepareComparisonEnd;
+    }
 
-    Status = 0;
-    TotalStatus = 0;
+    Status = ENOMEM;
+    Comparison->IdsA = malloc(sizeof(ULONG) * (FileA->LineCount + 1));
+    Comparison->IdsB = malloc(sizeof(ULONG) * (FileB->LineCount + 1));
+    Comparison->LinesA = malloc(sizeof(INTN) * (FileA->LineCount + 1));
+    Comparison->LinesB = malloc(sizeof(INTN) * (FileB->LineCount + 1));
+    if ((Comparison->IdsA == NULL) || (Comparison->IdsB == NULL) ||
+        (Comparison->LinesA == NULL) || (Comparison->LinesB == NULL)) {
+
+        goto PrepareComparisonEnd;
+    }
 
     //
-    // As a basic no-brainer, get past any lines at the beginning and the
-    // end that match.
+    // A line that appears nowhere in the other file can never be part of the
+    // longest common subsequence, so mark it as modified now. This often
+    // shrinks the problem considerably.
     //
 
-    while ((LowerA < UpperA) && (LowerB < UpperB)) {
-        Status = DiffCompareLines(Context, FileA, FileB, LowerA, LowerB);
-        if (Status != 0) {
-            break;
+    for (Index = 0; Index < FileA->LineCount; Index += 1) {
+        Line = FileA->Lines[Index];
+        if ((ClassFiles[Line->Id] & DIFF_CLASS_IN_B) == 0) {
+            Line->Modified = TRUE;
+            Comparison->Different = TRUE;
+            continue;
         }
 
-        LowerA += 1;
-        LowerB += 1;
-    }
-
-    if (Status != 0) {
-        TotalStatus = Status;
+        Comparison->IdsA[Comparison->CountA] = Line->Id;
+        Comparison->LinesA[Comparison->CountA] = Index;
+        Comparison->CountA += 1;
     }
 
-    while ((LowerA < UpperA) && (LowerB < UpperB)) {
-        Status = DiffCompareLines(Context,
-                                  FileA,
-                                  FileB,
-                                  UpperA - 1,
-                                  UpperB - 1);
-
-        if (Status != 0) {
-            break;
+    for (Index = 0; Index < FileB->LineCount; Index += 1) {
+        Line = FileB->Lines[Index];
+        if ((ClassFiles[Line->Id] & DIFF_CLASS_IN_A) == 0) {
+            Line->Modified = TRUE;
+            Comparison->Different = TRUE;
+            continue;
         }
 
-        UpperA -= 1;
-        UpperB -= 1;
-    }
-
-    if (Status != 0) {
-        TotalStatus = Status;
+        Comparison->IdsB[Comparison->CountB] = Line->Id;
+        Comparison->LinesB[Comparison->CountB] = Index;
+        Comparison->CountB += 1;
     }
 
     //
-    // If file A ended, then mark everything in file B as an insertion.
+    // Allocate vectors (V in the paper) for computing the shortest middle
+    // snake from both directions (forward and reverse). The vectors are
+    // indexed by k-line, which is the distance from the diagonal. The maximum
+    // possible distance is the sum of the two lengths. This goes in either
+    // direction (times two), plus two extra.
     //
 
-    if (LowerA == UpperA) {
-        if (LowerB < UpperB) {
-            TotalStatus = 1;
-        }
-
-        while (LowerB < UpperB) {
-            FileB->Lines[LowerB]->Modified = TRUE;
-            LowerB += 1;
-        }
+    Maximum = Comparison->CountA + Comparison->CountB + 1;
+    VectorSize = (2 * Maximum) + 2;
+    Comparison->DownVector = malloc(sizeof(INTN) * VectorSize);
+    Comparison->UpVector = malloc(sizeof(INTN) * VectorSize);
+    if ((Comparison->DownVector == NULL) || (Comparison->UpVector == NULL)) {
+        goto PrepareComparisonEnd;
+    }
 
     //
-    // If file B ended, then mark everything in file A as a deletion.
+    // Unless a minimal diff was requested, stop searching for the optimal
+    // middle snake at a cost of roughly the square root of the problem size.
     //
 
-    } else if (LowerB == UpperB) {
-        if (LowerA < UpperA) {
-            TotalStatus = 1;
+    if ((Context->Options & DIFF_OPTION_MINIMAL) == 0) {
+        Comparison->CostLimit = 1;
+        TotalLines = Comparison->CountA + Comparison->CountB;
+        while (TotalLines != 0) {
+            Comparison->CostLimit <<= 1;
+            TotalLines >>= 2;
         }
 
-        while (LowerA < UpperA) {
-            FileA->Lines[LowerA]->Modified = TRUE;
-            LowerA += 1;
+        if (Comparison->CostLimit < DIFF_MINIMUM_EXPENSIVE_COST) {
+            Comparison->CostLimit = DIFF_MINIMUM_EXPENSIVE_COST;
         }
+    }
 
     //
-    // Run the real crux of the diff algorithm.
+    // The patience and histogram algorithms need per-ID occurrence counts.
     //
 
-    } else {
+    if (Context->Algorithm != DiffAlgorithmMyers) {
+        Comparison->OccurrencesA = malloc(
+                                 sizeof(INTN) * (Comparison->ClassCount + 1));
 
-        //
-        // Find the shortest middle snake, which returns a k index into the
-        // down vector array. This index contains the x value of the shortest
-        // middle snake. The y value is then x - k.
-        //
+        Comparison->OccurrencesB = malloc(
+                                 sizeof(INTN) * (Comparison->ClassCount + 1));
 
-        DiffComputeShortestMiddleSnake(Context,
-                                       FileA,
-                                       FileB,
-                                       LowerA,
-                                       UpperA,
-                                       LowerB,
-                                       UpperB,
-                                       DownVector,
-                                       UpVector,
-                                       &MiddleSnakeX,
-                                       &MiddleSnakeY);
+        Comparison->FirstA = malloc(
+                                 sizeof(INTN) * (Comparison->ClassCount + 1));
 
-        //
-        // Now that a middle value in the longest common subsequence is known,
-        // recurse down to find the longest common subsequences of the upper
-        // left box and lower right box that remains.
-        //
+        Comparison->NextA = malloc(sizeof(INTN) * (Comparison->CountA + 1));
+        if ((Comparison->OccurrencesA == NULL) ||
+            (Comparison->OccurrencesB == NULL) ||
+            (Comparison->FirstA == NULL) ||
+            (Comparison->NextA == NULL)) {
 
-        Status = DiffComputeLongestCommonSubsequence(Context,
-                                                     FileA,
-                                                     FileB,
-                                                     LowerA,
-                                                     MiddleSnakeX,
-                                                     LowerB,
-                                                     MiddleSnakeY,
-                                                     DownVector,
-                                                     UpVector);
+            goto PrepareComparisonEnd;
+        }
 
-        if (Status != 0) {
-            TotalStatus = Status;
+        for (Index = 0; Index < Comparison->ClassCount; Index += 1) {
+            Comparison->OccurrencesA[Index] = 0;
+            Comparison->OccurrencesB[Index] = 0;
+            Comparison->FirstA[Index] = -1;
         }
+    }
 
-        Status = DiffComputeLongestCommonSubsequence(Context,
-                                                     FileA,
-                                                     FileB,
-                                                     MiddleSnakeX,
-                                                     UpperA,
-                                                     MiddleSnakeY,
-                                                     UpperB,
-                                                     DownVector,
-                                                     UpVector);
+    Status = 0;
 
-        if (Status != 0) {
-            TotalStatus = Status;
-        }
+PrepareComparisonEnd:
+    if (ClassFiles != NULL) {
+        free(ClassFiles);
     }
 
-    return TotalStatus;
+    return Status;
 }
 
 VOID
-DiffComputeShortestMiddleSnake (
-    PDIFF_CONTEXT Context,
-    PDIFF_FILE FileA,
-    PDIFF_FILE FileB,
-    INTN LowerA,
-    INTN UpperA,
-    INTN LowerB,
-    INTN UpperB,
-    PINTN DownVector,
-    PINTN UpVector,
-    PINTN MiddleSnakeX,
-    PINTN MiddleSnakeY
+DiffDestroyComparison (
+    PDIFF_COMPARISON Comparison
     )
 
 /*++
 
 Routine Description:
 
-    This routine implements the crux of the Myers' algorithm for computing the
-    longest common subsequence in linear space, which is computing the shortest
-    middle snake. Let's explore the algorithm a bit.
+    This routine frees the resources held by a diff comparison.
 
-    Introduction
+Arguments:
 
-    Computing the difference between two files is equivalent to asking minimum
-    set of steps it would take to transform one file into the other. Minimum
-    being the tricky part (as in it's not good enough to say "delete all the
-    lines from file A and replace them with all the lines from file B"). It
-    turns out this problem is simple with the Longest Common Subsequence of the
-    two sequences. For example, the longest common subsequence of BANANA and
-    CATANA is AANA. Everything not in the longest common subsequence is the
-    diff. The Myers' diff paper sets out to solve the problem of finding an
-    LCS efficiently.
+    Comparison - Supplies a pointer to the comparison to tear down.
 
-    Visualization:
+Return Value:
 
-    Arrange the two sequences with one along the X axis and one along the Y
-    axis. Moving horizontally along the grid represents a single deletion, and
-    moving vertically represents an addition. Diagonal moves can be made when
-    the sequences are equal. Finding the longest common subsequence is then a
-    matter of tracing a path from the top left to the bottom right using as few
+    None.
+
+--*/
+
+{
+
+    if (Comparison->IdsA != NULL) {
+        free(Comparison->IdsA);
+        Comparison->IdsA = NULL;
+    }
+
+    if (Comparison->IdsB != NULL) {
+        free(Comparison->IdsB);
+        Comparison->IdsB = NULL;
+    }
+
+    if (Comparison->LinesA != NULL) {
+        free(Comparison->LinesA);
+        Comparison->LinesA = NULL;
+    }
+
+    if (Comparison->LinesB != NULL) {
+        free(Comparison->LinesB);
+        Comparison->LinesB = NULL;
+    }
+
+    if (Comparison->DownVector != NULL) {
+        free(Comparison->DownVector);
+        Comparison->DownVector = NULL;
+    }
+
+    if (Comparison->UpVector != NULL) {
+        free(Comparison->UpVector);
+        Comparison->UpVector = NULL;
+    }
+
+    if (Comparison->OccurrencesA != NULL) {
+        free(Comparison->OccurrencesA);
+        Comparison->OccurrencesA = NULL;
+    }
+
+    if (Comparison->OccurrencesB != NULL) {
+        free(Comparison->OccurrencesB);
+        Comparison->OccurrencesB = NULL;
+    }
+
+    if (Comparison->FirstA != NULL) {
+        free(Comparison->FirstA);
+        Comparison->FirstA = NULL;
+    }
+
+    if (Comparison->NextA != NULL) {
+        free(Comparison->NextA);
+        Comparison->NextA = NULL;
+    }
+
+    return;
+}
+
+INT
+DiffAssignLineIds (
+    PDIFF_COMPARISON Comparison,
+    PUCHAR *ClassFiles
+    )
+
+/*++
+
+Routine Description:
+
+    This routine assigns every line in both files an ID such that two lines
+    have the same ID if and only if they compare equal. This lets the diff
+    algorithms compare integers instead of strings. A final line without a
+    trailing newline is never considered equal to a line that has one.
+
+Arguments:
+
+    Comparison - Supplies a pointer to the comparison. The class count is
+        filled in.
+
+    ClassFiles - Supplies a pointer where an array indexed by line ID will be
+        returned on success. Each element contains DIFF_CLASS_* flags
+        describing which files the line appears in. The caller is responsible
+        for freeing this array.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    UINTN Bucket;
+    UINTN BucketCount;
+    PULONG Buckets;
+    ULONG Class;
+    PDIFF_LINE *ClassLines;
+    PULONG ClassNext;
+    ULONG ClassCount;
+    PDIFF_FILE File;
+    UCHAR FileFlag;
+    PUCHAR Files;
+    UCHAR Final;
+    INTN LineIndex;
+    PDIFF_LINE Line;
+    INT Status;
+    INTN TotalLines;
+
+    ClassCount = 0;
+    ClassLines = NULL;
+    ClassNext = NULL;
+    Files = NULL;
+    Status = ENOMEM;
+    TotalLines = Comparison->FileA->LineCount + Comparison->FileB->LineCount;
+    BucketCount = DIFF_MINIMUM_HASH_BUCKETS;
+    while (BucketCount < (UINTN)TotalLines * 2) {
+        BucketCount <<= 1;
+    }
+
+    Buckets = malloc(sizeof(ULONG) * BucketCount);
+    if (Buckets == NULL) {
+        goto AssignLineIdsEnd;
+    }
+
+    memset(Buckets, 0, sizeof(ULONG) * BucketCount);
+    ClassLines = malloc(sizeof(PDIFF_LINE) * (TotalLines + 1));
+    ClassNext = malloc(sizeof(ULONG) * (TotalLines + 1));
+    Files = malloc(sizeof(UCHAR) * (TotalLines + 1));
+    if ((ClassLines == NULL) || (ClassNext == NULL) || (Files == NULL)) {
+        goto AssignLineIdsEnd;
+    }
+
+    //
+    // Look up each line in a hash table of the distinct lines seen so far.
+    // The buckets and chains store the class index plus one, so that zero
+    // can terminate the chain.
+    //
+
+    File = Comparison->FileA;
+    FileFlag = DIFF_CLASS_IN_A;
+    while (TRUE) {
+        for (LineIndex = 0; LineIndex < File->LineCount; LineIndex += 1) {
+            Line = File->Lines[LineIndex];
+            Final = 0;
+            if ((LineIndex == File->LineCount - 1) &&
+                (File->NoNewlineAtEnd != FALSE)) {
+
+                Final = DIFF_CLASS_FINAL;
+            }
+
+            Bucket = Line->Hash & (BucketCount - 1);
+            Class = Buckets[Bucket];
+            while (Class != 0) {
+                if (((Files[Class - 1] & DIFF_CLASS_FINAL) == Final) &&
+                    (DiffCompareLines(Comparison->Context,
+                                      ClassLines[Class - 1],
+                                      Line) == 0)) {
+
+                    break;
+                }
+
+                Class = ClassNext[Class - 1];
+            }
+
+            if (Class == 0) {
+                ClassLines[ClassCount] = Line;
+                ClassNext[ClassCount] = Buckets[Bucket];
+                Files[ClassCount] = Final;
+                ClassCount += 1;
+                Buckets[Bucket] = ClassCount;
+                Class = ClassCount;
+            }
+
+            Line->Id = Class - 1;
+            Files[Class - 1] |= FileFlag;
+        }
+
+        if (File == Comparison->FileB) {
+            break;
+        }
+
+        File = Comparison->FileB;
+        FileFlag = DIFF_CLASS_IN_B;
+    }
+
+    Comparison->ClassCount = ClassCount;
+    *ClassFiles = Files;
+    Files = NULL;
+    Status = 0;
+
+AssignLineIdsEnd:
+    if (Buckets != NULL) {
+        free(Buckets);
+    }
+
+    if (ClassLines != NULL) {
+        free(ClassLines);
+    }
+
+    if (ClassNext != NULL) {
+        free(ClassNext);
+    }
+
+    if (Files != NULL) {
+        free(Files);
+    }
+
+    return Status;
+}
+
+VOID
+DiffMarkModified (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks a region of each sequence as part of the diff.
+
+Arguments:
+
+    Comparison - Supplies a pointer to the comparison.
+
+    LowerA - Supplies the starting index within sequence A to mark.
+
+    UpperA - Supplies the ending index within sequence A to mark, exclusive.
+
+    LowerB - Supplies the starting index within sequence B to mark.
+
+    UpperB - Supplies the ending index within sequence B to mark, exclusive.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PDIFF_FILE FileA;
+    PDIFF_FILE FileB;
+
+    if ((LowerA < UpperA) || (LowerB < UpperB)) {
+        Comparison->Different = TRUE;
+    }
+
+    FileA = Comparison->FileA;
+    while (LowerA < UpperA) {
+        FileA->Lines[Comparison->LinesA[LowerA]]->Modified = TRUE;
+        LowerA += 1;
+    }
+
+    FileB = Comparison->FileB;
+    while (LowerB < UpperB) {
+        FileB->Lines[Comparison->LinesB[LowerB]]->Modified = TRUE;
+        LowerB += 1;
+    }
+
+    return;
+}
+
+VOID
+DiffComputeLongestCommonSubsequence (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the Myers' algorithm for computing the longest
+    common subsequence in linear space (but with recursion). The algorithm is
+    a divide-and-conquer algorithm, finding an element of the correct path
+    in the middle and then recursing on each of the slightly smaller split
+    pieces. Lines not in the subsequence are marked as modified.
+
+Arguments:
+
+    Comparison - Supplies a pointer to the comparison.
+
+    LowerA - Supplies the starting index within sequence A to work on.
+
+    UpperA - Supplies the ending index within sequence A to work on, exclusive.
+
+    LowerB - Supplies the starting index within sequence B to work on.
+
+    UpperB - Supplies the ending index within sequence B to work on, exclusive.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PULONG IdsA;
+    PULONG IdsB;
+    INTN MiddleSnakeX;
+    INTN MiddleSnakeY;
+
+    IdsA = Comparison->IdsA;
+    IdsB = Comparison->IdsB;
+
+    //
+    // As a basic no-brainer, get past any lines at the beginning and the
+    // end that match.
+    //
+
+    while ((LowerA < UpperA) && (LowerB < UpperB) &&
+           (IdsA[LowerA] == IdsB[LowerB])) {
+
+        LowerA += 1;
+        LowerB += 1;
+    }
+
+    while ((LowerA < UpperA) && (LowerB < UpperB) &&
+           (IdsA[UpperA - 1] == IdsB[UpperB - 1])) {
+
+        UpperA -= 1;
+        UpperB -= 1;
+    }
+
+    //
+    // If either sequence ended, then everything left in the other one is an
+    // insertion or deletion.
+    //
+
+    if ((LowerA == UpperA) || (LowerB == UpperB)) {
+        DiffMarkModified(Comparison, LowerA, UpperA, LowerB, UpperB);
+        return;
+    }
+
+    //
+    // Find the shortest middle snake, then recurse down to find the longest
+    // common subsequences of the upper left box and lower right box that
+    // remain.
+    //
+
+    DiffComputeShortestMiddleSnake(Comparison,
+                                   LowerA,
+                                   UpperA,
+                                   LowerB,
+                                   UpperB,
+                                   &MiddleSnakeX,
+                                   &MiddleSnakeY);
+
+    DiffComputeLongestCommonSubsequence(Comparison,
+                                        LowerA,
+                                        MiddleSnakeX,
+                                        LowerB,
+                                        MiddleSnakeY);
+
+    DiffComputeLongestCommonSubsequence(Comparison,
+                                        MiddleSnakeX,
+                                        UpperA,
+                                        MiddleSnakeY,
+                                        UpperB);
+
+    return;
+}
+
+VOID
+DiffComputeShortestMiddleSnake (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB,
+    PINTN MiddleSnakeX,
+    PINTN MiddleSnakeY
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the crux of the Myers' algorithm for computing the
+    longest common subsequence in linear space, which is computing the shortest
+    middle snake. Let's explore the algorithm a bit.
+
+    Introduction
+
+    Computing the difference between two files is equivalent to asking minimum
+    set of steps it would take to transform one file into the other. Minimum
+    being the tricky part (as in it's not good enough to say "delete all the
+    lines from file A and replace them with all the lines from file B"). It
+    turns out this problem is simple with the Longest Common Subsequence of the
+    two sequences. For example, the longest common subsequence of BANANA and
+    CATANA is AANA. Everything not in the longest common subsequence is the
+    diff. The Myers' diff paper sets out to solve the problem of finding an
+    LCS efficiently.
+
+    Visualization:
+
+    Arrange the two sequences with one along the X axis and one along the Y
+    axis. Moving horizontally along the grid represents a single deletion, and
+    moving vertically represents an addition. Diagonal moves can be made when
+    the sequences are equal. Finding the longest common subsequence is then a
+    matter of tracing a path from the top left to the bottom right using as few
     horizontal and vertical moves as possible (and therefore as many diagonals
     as possible). Below is an example trace through the sequences ABCABBA and
     CBABAC.
@@ -2682,33 +3283,34 @@ Routine Description:
     smaller rectangles created in the upper left and lower right corners
     recursively until the solution is trivial.
 
-Arguments:
+    Bounding the cost:
 
-    Context - Supplies a pointer to the diff application context.
-
-    FileA - Supplies a pointer to the first file.
-
-    FileB - Supplies a pointer to the second file.
+    The running time is proportional to the number of lines times D, which
+    gets painful for large files that differ a lot. Once D passes the
+    comparison's cost limit, the search gives up on finding the true middle
+    snake and instead splits at whichever point the forward or reverse search
+    has pushed furthest. The two halves still produce a correct diff, though
+    not necessarily the smallest one.
 
-    LowerA - Supplies the starting index within file A to work on.
+Arguments:
 
-    UpperA - Supplies the ending index within file A to work on, exclusive.
+    Comparison - Supplies a pointer to the comparison, which contains the
+        sequences and the k-indexed vectors for computing the shortest middle
+        snake from the top down and from the bottom up.
 
-    LowerB - Supplies the starting index within file B to work on.
+    LowerA - Supplies the starting index within sequence A to work on.
 
-    UpperB - Supplies the ending index within file B to work on, exclusive.
+    UpperA - Supplies the ending index within sequence A to work on, exclusive.
 
-    DownVector - Supplies the k-indexed vector for computing the shortest
-        middle snake from the top down.
+    LowerB - Supplies the starting index within sequence B to work on.
 
-    UpVector - Supplies the k-indexed vector for computing the shortest middle
-        snake from the bottom up.
+    UpperB - Supplies the ending index within sequence B to work on, exclusive.
 
-    MiddleSnakeX - Supplies a pointer where the X coordinate (line index of
-        file A) of the shortest middle snake will be returned.
+    MiddleSnakeX - Supplies a pointer where the X coordinate (index into
+        sequence A) of the shortest middle snake will be returned.
 
-    MiddleSnakeY - Supplies a pointer where the Y coordinate (line index of
-        file B) of the shortest middle snake will be returned.
+    MiddleSnakeY - Supplies a pointer where the Y coordinate (index into
+        sequence B) of the shortest middle snake will be returned.
 
 Return Value:
 
@@ -2718,26 +3320,38 @@ Return Value:
 
 {
 
+    INTN BestProgress;
+    INTN BestX;
+    INTN BestY;
     INTN Delta;
     BOOL DeltaIsOdd;
     INTN DIndex;
     INTN DownK;
     INTN DownOffset;
+    PINTN DownVector;
+    PULONG IdsA;
+    PULONG IdsB;
     INTN KIndex;
     INTN Maximum;
     INTN MaximumD;
+    INTN Progress;
     INTN SnakeX;
     INTN SnakeY;
-    INT Status;
     INTN UpK;
     INTN UpOffset;
+    PINTN UpVector;
+
+    DownVector = Comparison->DownVector;
+    UpVector = Comparison->UpVector;
+    IdsA = Comparison->IdsA;
+    IdsB = Comparison->IdsB;
 
     //
     // The maximum D value would be going all the way right and all the way
     // down (the files are entirely different).
     //
 
-    Maximum = FileA->LineCount + FileB->LineCount + 1;
+    Maximum = Comparison->CountA + Comparison->CountB + 1;
 
     //
     // Compute the K lines to start the forward (down) and reverse (up)
@@ -2831,16 +3445,8 @@ Return Value:
             // Take as many diagonals as possible.
             //
 
-            while ((SnakeX < UpperA) && (SnakeY < UpperB)) {
-                Status = DiffCompareLines(Context,
-                                          FileA,
-                                          FileB,
-                                          SnakeX,
-                                          SnakeY);
-
-                if (Status != 0) {
-                    break;
-                }
+            while ((SnakeX < UpperA) && (SnakeY < UpperB) &&
+                   (IdsA[SnakeX] == IdsB[SnakeY])) {
 
                 SnakeX += 1;
                 SnakeY += 1;
@@ -2904,16 +3510,8 @@ Return Value:
             // Take as many diagonals as possible.
             //
 
-            while ((SnakeX > LowerA) && (SnakeY > LowerB)) {
-                Status = DiffCompareLines(Context,
-                                          FileA,
-                                          FileB,
-                                          SnakeX - 1,
-                                          SnakeY - 1);
-
-                if (Status != 0) {
-                    break;
-                }
+            while ((SnakeX > LowerA) && (SnakeY > LowerB) &&
+                   (IdsA[SnakeX - 1] == IdsB[SnakeY - 1])) {
 
                 SnakeX -= 1;
                 SnakeY -= 1;
@@ -2937,6 +3535,62 @@ Return Value:
                 }
             }
         }
+
+        //
+        // If this is getting too expensive, settle for splitting at the point
+        // that has made the most progress from either corner.
+        //
+
+        if ((Comparison->CostLimit == 0) ||
+            (DIndex < Comparison->CostLimit)) {
+
+            continue;
+        }
+
+        BestProgress = 0;
+        BestX = LowerA;
+        BestY = LowerB;
+        for (KIndex = DownK - DIndex; KIndex <= DownK + DIndex; KIndex += 2) {
+            SnakeX = DownVector[DownOffset + KIndex];
+            SnakeY = SnakeX - KIndex;
+            if ((SnakeX > UpperA) || (SnakeY < LowerB) || (SnakeY > UpperB)) {
+                continue;
+            }
+
+            Progress = (SnakeX - LowerA) + (SnakeY - LowerB);
+            if (Progress > BestProgress) {
+                BestProgress = Progress;
+                BestX = SnakeX;
+                BestY = SnakeY;
+            }
+        }
+
+        for (KIndex = UpK - DIndex; KIndex <= UpK + DIndex; KIndex += 2) {
+            SnakeX = UpVector[UpOffset + KIndex];
+            SnakeY = SnakeX - KIndex;
+            if ((SnakeX < LowerA) || (SnakeY < LowerB) || (SnakeY > UpperB)) {
+                continue;
+            }
+
+            Progress = (UpperA - SnakeX) + (UpperB - SnakeY);
+            if (Progress > BestProgress) {
+                BestProgress = Progress;
+                BestX = SnakeX;
+                BestY = SnakeY;
+            }
+        }
+
+        //
+        // Splitting at either corner would not make any progress.
+        //
+
+        if (((BestX != LowerA) || (BestY != LowerB)) &&
+            ((BestX != UpperA) || (BestY != UpperB))) {
+
+            *MiddleSnakeX = BestX;
+            *MiddleSnakeY = BestY;
+            return;
+        }
     }
 
     //
@@ -2948,87 +3602,496 @@ Return Value:
     return;
 }
 
-INT
-DiffCompareLines (
-    PDIFF_CONTEXT Context,
-    PDIFF_FILE FileA,
-    PDIFF_FILE FileB,
-    UINTN LineIndexA,
-    UINTN LineIndexB
+VOID
+DiffComputePatienceDiff (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB,
+    ULONG Depth
     )
 
 /*++
 
 Routine Description:
 
-    This routine compares two diff lines for equality.
+    This routine implements patience diff. Lines that appear exactly once in
+    each side of the region are matched up, and the longest run of those
+    matches that is in order in both files becomes a set of anchors. The
+    algorithm then recurses on the gaps between the anchors. Regions with no
+    unique lines in common are handed to the Myers' algorithm. This tends to
+    line up the structure of mostly similar files (such as function
+    boundaries) better than a minimal diff does.
 
 Arguments:
 
-    Context - Supplies a pointer to the diff application context.
+    Comparison - Supplies a pointer to the comparison.
 
-    FileA - Supplies a pointer to the first file.
+    LowerA - Supplies the starting index within sequence A to work on.
 
-    FileB - Supplies a pointer to the second file.
+    UpperA - Supplies the ending index within sequence A to work on, exclusive.
 
-    LineIndexA - Supplies the index of the line in the first file.
+    LowerB - Supplies the starting index within sequence B to work on.
 
-    LineIndexB - Supplies the index of the line in the second file.
+    UpperB - Supplies the ending index within sequence B to work on, exclusive.
 
-Return Value:
+    Depth - Supplies the recursion depth of this call.
 
-    0 if the lines are equal.
+Return Value:
 
-    1 if the linse are not equal.
+    None.
 
 --*/
 
 {
 
-    UINTN IndexA;
-    UINTN IndexB;
-    PDIFF_LINE LineA;
-    PDIFF_LINE LineB;
+    INTN AnchorCount;
+    INTN AnchorIndex;
+    INTN High;
+    ULONG Id;
+    PULONG IdsA;
+    PULONG IdsB;
+    INTN Index;
+    INTN Low;
+    INTN MatchCount;
+    PINTN MatchesA;
+    PINTN MatchesB;
+    INTN Middle;
+    PINTN Previous;
+    INTN Size;
+    PINTN Tails;
+
+    IdsA = Comparison->IdsA;
+    IdsB = Comparison->IdsB;
+    while ((LowerA < UpperA) && (LowerB < UpperB) &&
+           (IdsA[LowerA] == IdsB[LowerB])) {
+
+        LowerA += 1;
+        LowerB += 1;
+    }
+
+    while ((LowerA < UpperA) && (LowerB < UpperB) &&
+           (IdsA[UpperA - 1] == IdsB[UpperB - 1])) {
+
+        UpperA -= 1;
+        UpperB -= 1;
+    }
+
+    if ((LowerA == UpperA) || (LowerB == UpperB)) {
+        DiffMarkModified(Comparison, LowerA, UpperA, LowerB, UpperB);
+        return;
+    }
+
+    Size = UpperA - LowerA;
+    if (Size > UpperB - LowerB) {
+        Size = UpperB - LowerB;
+    }
+
+    MatchesA = NULL;
+    if (Depth < DIFF_MAX_PATIENCE_DEPTH) {
+        MatchesA = malloc(sizeof(INTN) * Size * 4);
+    }
+
+    if (MatchesA == NULL) {
+        DiffComputeLongestCommonSubsequence(Comparison,
+                                            LowerA,
+                                            UpperA,
+                                            LowerB,
+                                            UpperB);
 
-    assert(LineIndexA < FileA->LineCount);
-    assert(LineIndexB < FileB->LineCount);
+        return;
+    }
 
-    LineA = FileA->Lines[LineIndexA];
-    LineB = FileB->Lines[LineIndexB];
+    MatchesB = MatchesA + Size;
+    Previous = MatchesB + Size;
+    Tails = Previous + Size;
 
     //
-    // If the hashes are not equal, then the lines are definitely not equal.
-    // Easy peasy.
+    // Count the occurrences of each line in both regions, remembering where
+    // each line in A was seen.
     //
 
-    if (LineA->Hash != LineB->Hash) {
-        return 1;
+    for (Index = LowerA; Index < UpperA; Index += 1) {
+        Id = IdsA[Index];
+        Comparison->OccurrencesA[Id] += 1;
+        Comparison->FirstA[Id] = Index;
+    }
+
+    for (Index = LowerB; Index < UpperB; Index += 1) {
+        Comparison->OccurrencesB[IdsB[Index]] += 1;
     }
 
     //
-    // If this is the last line for either of them and there's not a newline at
-    // the end, then it's probably different.
+    // Collect the lines unique to both sides, in file B order.
     //
 
-    if ((LineIndexA == FileA->LineCount - 1) &&
-        (FileA->NoNewlineAtEnd != FALSE)) {
+    MatchCount = 0;
+    for (Index = LowerB; Index < UpperB; Index += 1) {
+        Id = IdsB[Index];
+        if ((Comparison->OccurrencesA[Id] == 1) &&
+            (Comparison->OccurrencesB[Id] == 1)) {
+
+            MatchesA[MatchCount] = Comparison->FirstA[Id];
+            MatchesB[MatchCount] = Index;
+            MatchCount += 1;
+        }
+    }
 
-        if ((LineIndexB != FileB->LineCount - 1) ||
-            (FileB->NoNewlineAtEnd == FALSE)) {
+    for (Index = LowerA; Index < UpperA; Index += 1) {
+        Id = IdsA[Index];
+        Comparison->OccurrencesA[Id] = 0;
+        Comparison->FirstA[Id] = -1;
+    }
 
-            return 1;
+    for (Index = LowerB; Index < UpperB; Index += 1) {
+        Comparison->OccurrencesB[IdsB[Index]] = 0;
+    }
+
+    if (MatchCount == 0) {
+        free(MatchesA);
+        DiffComputeLongestCommonSubsequence(Comparison,
+                                            LowerA,
+                                            UpperA,
+                                            LowerB,
+                                            UpperB);
+
+        return;
+    }
+
+    //
+    // Find the longest increasing subsequence of A positions using patience
+    // sorting. Each pile is represented by the match on top of it, and each
+    // match remembers the top of the pile to its left when it was placed.
+    //
+
+    AnchorCount = 0;
+    for (Index = 0; Index < MatchCount; Index += 1) {
+        Low = 0;
+        High = AnchorCount;
+        while (Low < High) {
+            Middle = Low + ((High - Low) / 2);
+            if (MatchesA[Tails[Middle]] < MatchesA[Index]) {
+                Low = Middle + 1;
+
+            } else {
+                High = Middle;
+            }
+        }
+
+        Previous[Index] = -1;
+        if (Low != 0) {
+            Previous[Index] = Tails[Low - 1];
+        }
+
+        Tails[Low] = Index;
+        if (Low == AnchorCount) {
+            AnchorCount += 1;
         }
     }
 
-    if ((LineIndexB == FileB->LineCount - 1) &&
-        (FileB->NoNewlineAtEnd != FALSE)) {
+    //
+    // Walk back from the top of the last pile to collect the anchors in
+    // order.
+    //
+
+    Index = Tails[AnchorCount - 1];
+    for (AnchorIndex = AnchorCount - 1; AnchorIndex >= 0; AnchorIndex -= 1) {
+        Tails[AnchorIndex] = Index;
+        Index = Previous[Index];
+    }
+
+    //
+    // Diff the regions between the anchors. The anchors themselves match.
+    //
 
-        if ((LineIndexA != FileA->LineCount - 1) ||
-            (FileA->NoNewlineAtEnd == FALSE)) {
+    for (AnchorIndex = 0; AnchorIndex < AnchorCount; AnchorIndex += 1) {
+        Index = Tails[AnchorIndex];
+        DiffComputePatienceDiff(Comparison,
+                                LowerA,
+                                MatchesA[Index],
+                                LowerB,
+                                MatchesB[Index],
+                                Depth + 1);
+
+        LowerA = MatchesA[Index] + 1;
+        LowerB = MatchesB[Index] + 1;
+    }
 
-            return 1;
+    free(MatchesA);
+    DiffComputePatienceDiff(Comparison,
+                            LowerA,
+                            UpperA,
+                            LowerB,
+                            UpperB,
+                            Depth + 1);
+
+    return;
+}
+
+VOID
+DiffComputeHistogramDiff (
+    PDIFF_COMPARISON Comparison,
+    INTN LowerA,
+    INTN UpperA,
+    INTN LowerB,
+    INTN UpperB
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements histogram diff, an extension of patience diff
+    that tolerates lines which are not unique. It finds the common run of
+    lines whose rarest line appears the fewest times in file A, preferring
+    longer runs on ties, and then works on the regions to either side of it.
+    Regions whose common lines are all too frequent are handed to the Myers'
+    algorithm.
+
+Arguments:
+
+    Comparison - Supplies a pointer to the comparison.
+
+    LowerA - Supplies the starting index within sequence A to work on.
+
+    UpperA - Supplies the ending index within sequence A to work on, exclusive.
+
+    LowerB - Supplies the starting index within sequence B to work on.
+
+    UpperB - Supplies the ending index within sequence B to work on, exclusive.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    INTN BestA;
+    INTN BestB;
+    INTN BestCount;
+    INTN BestLength;
+    BOOL Common;
+    INTN EndA;
+    INTN EndB;
+    ULONG Id;
+    PULONG IdsA;
+    PULONG IdsB;
+    INTN Index;
+    INTN IndexA;
+    INTN NextB;
+    PINTN Occurrences;
+    INTN RegionCount;
+    INTN StartA;
+    INTN StartB;
+
+    IdsA = Comparison->IdsA;
+    IdsB = Comparison->IdsB;
+    Occurrences = Comparison->OccurrencesA;
+
+    //
+    // Recurse on the smaller side of each split and loop on the larger one to
+    // keep the recursion shallow.
+    //
+
+    while (TRUE) {
+        while ((LowerA < UpperA) && (LowerB < UpperB) &&
+               (IdsA[LowerA] == IdsB[LowerB])) {
+
+            LowerA += 1;
+            LowerB += 1;
+        }
+
+        while ((LowerA < UpperA) && (LowerB < UpperB) &&
+               (IdsA[UpperA - 1] == IdsB[UpperB - 1])) {
+
+            UpperA -= 1;
+            UpperB -= 1;
+        }
+
+        if ((LowerA == UpperA) || (LowerB == UpperB)) {
+            DiffMarkModified(Comparison, LowerA, UpperA, LowerB, UpperB);
+            return;
+        }
+
+        //
+        // Build the histogram of lines in A, chaining together the positions
+        // of each line in order.
+        //
+
+        for (Index = UpperA - 1; Index >= LowerA; Index -= 1) {
+            Id = IdsA[Index];
+            Comparison->NextA[Index] = Comparison->FirstA[Id];
+            Comparison->FirstA[Id] = Index;
+            Occurrences[Id] += 1;
+        }
+
+        //
+        // Try every pairing of a line in B with its occurrences in A, and
+        // extend each into the longest common run around it.
+        //
+
+        BestA = 0;
+        BestB = 0;
+        BestCount = DIFF_HISTOGRAM_MAX_CHAIN + 1;
+        BestLength = 0;
+        Common = FALSE;
+        Index = LowerB;
+        while (Index < UpperB) {
+            Id = IdsB[Index];
+            NextB = Index + 1;
+            if (Occurrences[Id] != 0) {
+                Common = TRUE;
+            }
+
+            if ((Occurrences[Id] == 0) || (Occurrences[Id] > BestCount)) {
+                Index = NextB;
+                continue;
+            }
+
+            for (IndexA = Comparison->FirstA[Id];
+                 IndexA != -1;
+                 IndexA = Comparison->NextA[IndexA]) {
+
+                RegionCount = Occurrences[Id];
+                StartA = IndexA;
+                StartB = Index;
+                while ((StartA > LowerA) && (StartB > LowerB) &&
+                       (IdsA[StartA - 1] == IdsB[StartB - 1])) {
+
+                    StartA -= 1;
+                    StartB -= 1;
+                    if (Occurrences[IdsA[StartA]] < RegionCount) {
+                        RegionCount = Occurrences[IdsA[StartA]];
+                    }
+                }
+
+                EndA = IndexA + 1;
+                EndB = Index + 1;
+                while ((EndA < UpperA) && (EndB < UpperB) &&
+                       (IdsA[EndA] == IdsB[EndB])) {
+
+                    if (Occurrences[IdsA[EndA]] < RegionCount) {
+                        RegionCount = Occurrences[IdsA[EndA]];
+                    }
+
+                    EndA += 1;
+                    EndB += 1;
+                }
+
+                //
+                // Lines in B covered by this run would only find the same
+                // run again, so skip past them.
+                //
+
+                if (NextB < EndB) {
+                    NextB = EndB;
+                }
+
+                if ((RegionCount < BestCount) ||
+                    ((RegionCount == BestCount) &&
+                     (EndA - StartA > BestLength))) {
+
+                    BestA = StartA;
+                    BestB = StartB;
+                    BestCount = RegionCount;
+                    BestLength = EndA - StartA;
+                }
+            }
+
+            Index = NextB;
+        }
+
+        for (Index = LowerA; Index < UpperA; Index += 1) {
+            Id = IdsA[Index];
+            Comparison->FirstA[Id] = -1;
+            Occurrences[Id] = 0;
+        }
+
+        //
+        // If nothing is in common, it's all different. If there were common
+        // lines but they were all too popular, fall back to Myers.
+        //
+
+        if (BestLength == 0) {
+            if (Common == FALSE) {
+                DiffMarkModified(Comparison, LowerA, UpperA, LowerB, UpperB);
+
+            } else {
+                DiffComputeLongestCommonSubsequence(Comparison,
+                                                    LowerA,
+                                                    UpperA,
+                                                    LowerB,
+                                                    UpperB);
+            }
+
+            return;
+        }
+
+        if ((BestA - LowerA) + (BestB - LowerB) <
+            (UpperA - BestA) + (UpperB - BestB) - (2 * BestLength)) {
+
+            DiffComputeHistogramDiff(Comparison, LowerA, BestA, LowerB, BestB);
+            LowerA = BestA + BestLength;
+            LowerB = BestB + BestLength;
+
+        } else {
+            DiffComputeHistogramDiff(Comparison,
+                                     BestA + BestLength,
+                                     UpperA,
+                                     BestB + BestLength,
+                                     UpperB);
+
+            UpperA = BestA;
+            UpperB = BestB;
         }
     }
+}
+
+INT
+DiffCompareLines (
+    PDIFF_CONTEXT Context,
+    PDIFF_LINE LineA,
+    PDIFF_LINE LineB
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares the contents of two diff lines for equality.
+
+Arguments:
+
+    Context - Supplies a pointer to the diff application context.
+
+    LineA - Supplies a pointer to the first line.
+
+    LineB - Supplies a pointer to the second line.
+
+Return Value:
+
+    0 if the lines are equal.
+
+    1 if the linse are not equal.
+
+--*/
+
+{
+
+    UINTN IndexA;
+    UINTN IndexB;
+
+    //
+    // If the hashes are not equal, then the lines are definitely not equal.
+    // Easy peasy.
+    //
+
+    if (LineA->Hash != LineB->Hash) {
+        return 1;
+    }
 
     //
     // If not ignoring blanks, then use strcmp, as it's probably a bit more
@@ -3405,36 +4468,38 @@ Return Value:
 
         if (ChangesPresent != FALSE) {
             IndexB = LineB;
+            Marker = ' ';
             for (IndexA = LineA; IndexA < LineA + SizeA; IndexA += 1) {
                 LineData = FileA->Lines[IndexA]->Data;
 
                 //
-                // If the first file is not modified, it's context.
+                // If the first file is not modified, it's context. Skip any
+                // insertions in file B that come before it, as well as its
+                // matching line.
                 //
 
                 if (FileA->Lines[IndexA]->Modified == FALSE) {
                     Marker = ' ';
-                    if ((IndexB < FileB->LineCount) &&
-                        (FileB->Lines[IndexB]->Modified == FALSE)) {
+                    while ((IndexB < FileB->LineCount) &&
+                           (FileB->Lines[IndexB]->Modified != FALSE)) {
 
                         IndexB += 1;
                     }
 
+                    IndexB += 1;
+
                 //
-                // The line in file A is modified, so it's a deletion. Look at
-                // file B to figure out if it's a change or pure deletion.
+                // The line in file A starts a run of deletions. If file B has
+                // insertions at the same spot, the whole run is a change.
+                // Skip past those insertions so the next context line stays
+                // in sync.
                 //
 
-                } else {
-                    if ((IndexB >= FileB->LineCount) ||
-                        (FileB->Lines[IndexB]->Modified == FALSE)) {
-
-                        Marker = '-';
-                        if (IndexB < FileB->LineCount) {
-                            IndexB += 1;
-                        }
+                } else if (Marker == ' ') {
+                    Marker = '-';
+                    while ((IndexB < FileB->LineCount) &&
+                           (FileB->Lines[IndexB]->Modified != FALSE)) {
 
-                    } else {
                         Marker = '!';
                         IndexB += 1;
                     }
@@ -3484,36 +4549,36 @@ Return Value:
 
         if (ChangesPresent != FALSE) {
             IndexA = LineA;
+            Marker = ' ';
             for (IndexB = LineB; IndexB < LineB + SizeB; IndexB += 1) {
                 LineData = FileB->Lines[IndexB]->Data;
 
                 //
-                // If the first file is not modified, it's context.
+                // If the second file is not modified, it's context. Skip any
+                // deletions in file A that come before it, as well as its
+                // matching line.
                 //
 
                 if (FileB->Lines[IndexB]->Modified == FALSE) {
                     Marker = ' ';
-                    if ((IndexA < FileA->LineCount) &&
-                        (FileA->Lines[IndexA]->Modified == FALSE)) {
+                    while ((IndexA < FileA->LineCount) &&
+                           (FileA->Lines[IndexA]->Modified != FALSE)) {
 
                         IndexA += 1;
                     }
 
+                    IndexA += 1;
+
                 //
-                // The line in file B is modified, so it's an insertion. Look at
-                // file A to figure out if it's a change or pure insertion.
+                // The line in file B starts a run of insertions. If file A has
+                // deletions at the same spot, the whole run is a change.
                 //
 
-                } else {
-                    if ((IndexA >= FileA->LineCount) ||
-                        (FileA->Lines[IndexA]->Modified == FALSE)) {
-
-                        Marker = '+';
-                        if (IndexA < FileA->LineCount) {
-                            IndexA += 1;
-                        }
+                } else if (Marker == ' ') {
+                    Marker = '+';
+                    while ((IndexA < FileA->LineCount) &&
+                           (FileA->Lines[IndexA]->Modified != FALSE)) {
 
-                    } else {
                         Marker = '!';
                         IndexA += 1;
                     }
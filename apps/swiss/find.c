@@ -205,11 +205,12 @@ Module Name:
 #define SECONDS_PER_DAY 86400
 
 //
-// Define the maximum number of file paths that are batched up before calling
-// a batched exec.
+// Define the initial number of file paths a batched exec has room for, and the
+// limit on the total size of the paths batched up before the utility is run.
 //
 
-#define FIND_BATCH_SIZE 15
+#define FIND_BATCH_INITIAL_CAPACITY 32
+#define FIND_BATCH_SIZE_LIMIT (128 * _1KB)
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -349,10 +350,16 @@ Structure Description:
 
     NewArguments - Stores an array of the new arguments that exec will be
         called with. This will be at least as large as the above argument count,
-        plus the maximum batch size for batched executes.
+        plus the batch capacity for batched executes, plus a null terminator.
 
     BatchCount - Stores the number of files currently batched in the arguments.
 
+    BatchCapacity - Stores the number of files the new arguments array has
+        room for.
+
+    BatchSize - Stores the total size of the batched file paths in bytes,
+        including their null terminators.
+
 --*/
 
 typedef struct _FIND_NODE_EXECUTE {
@@ -362,6 +369,8 @@ typedef struct _FIND_NODE_EXECUTE {
     BOOL Batch;
     PSTR *NewArguments;
     ULONG BatchCount;
+    ULONG BatchCapacity;
+    UINTN BatchSize;
 } FIND_NODE_EXECUTE, *PFIND_NODE_EXECUTE;
 
 typedef struct _FIND_NODE FIND_NODE, *PFIND_NODE;
@@ -472,6 +481,9 @@ Structure Description:
 
     CurrentTime - Stores the time at instantiation.
 
+    BatchFailed - Stores a boolean indicating whether a batched execute
+        returned a non-zero status, which makes find fail.
+
 --*/
 
 typedef struct _FIND_CONTEXT {
@@ -484,6 +496,7 @@ typedef struct _FIND_CONTEXT {
     ULONG SearchedDirectoryCapacity;
     dev_t RootDevice;
     time_t CurrentTime;
+    BOOL BatchFailed;
 } FIND_CONTEXT, *PFIND_CONTEXT;
 
 //
@@ -530,6 +543,12 @@ FindExecute (
     PINT ReturnValue
     );
 
+INT
+FindRunBatch (
+    PFIND_CONTEXT Context,
+    PFIND_NODE_EXECUTE Execute
+    );
+
 PSTR
 FindSubstitutePath (
     PSTR Argument,
@@ -683,6 +702,10 @@ Return Value:
         }
     }
 
+    if (Context.BatchFailed != FALSE) {
+        Result = 1;
+    }
+
 FindMainEnd:
 
     //
@@ -1340,26 +1363,56 @@ Return Value:
 {
 
     BOOL Answer;
-    ULONG ArgumentCount;
     ULONG ArgumentIndex;
     PFIND_NODE_EXECUTE Execute;
+    ULONG NewCapacity;
+    PSTR *NewArguments;
+    UINTN PathSize;
     INT Result;
     INT ReturnValue;
 
+    assert(Node->Type == FindNodeExecute);
+
     //
-    // For batched commands, add the path to the new arguments, and return
-    // immediately if the batch size isn't big enough.
+    // For batched commands, add the path to the new arguments. Run the
+    // utility first if this path would push the batch over the size limit.
     //
 
-    assert(Node->Type == FindNodeExecute);
-
-    ArgumentCount = 0;
     Execute = &(Node->U.Execute);
     if (Execute->Batch != FALSE) {
         *Match = TRUE;
+        PathSize = strlen(Path) + 1;
+        if ((Execute->BatchCount != 0) &&
+            (Execute->BatchSize + PathSize > FIND_BATCH_SIZE_LIMIT)) {
+
+            Result = FindRunBatch(Context, Execute);
+            if (Result != 0) {
+                goto EvaluateExecuteEnd;
+            }
+        }
+
+        if (Execute->BatchCount == Execute->BatchCapacity) {
+            NewCapacity = Execute->BatchCapacity * 2;
+            NewArguments = realloc(Execute->NewArguments,
+                                   (Execute->ArgumentCount + NewCapacity + 1) *
+                                   sizeof(PSTR));
+
+            if (NewArguments == NULL) {
+                Result = ENOMEM;
+                goto EvaluateExecuteEnd;
+            }
+
+            ArgumentIndex = Execute->ArgumentCount + Execute->BatchCount;
+            memset(&(NewArguments[ArgumentIndex]),
+                   0,
+                   (NewCapacity - Execute->BatchCount + 1) * sizeof(PSTR));
+
+            Execute->NewArguments = NewArguments;
+            Execute->BatchCapacity = NewCapacity;
+        }
+
         ArgumentIndex = Execute->ArgumentCount + Execute->BatchCount;
 
-        assert(Execute->BatchCount < FIND_BATCH_SIZE);
         assert(Execute->NewArguments[ArgumentIndex] == NULL);
 
         Execute->NewArguments[ArgumentIndex] = strdup(Path);
@@ -1369,12 +1422,9 @@ Return Value:
         }
 
         Execute->BatchCount += 1;
-        if (Execute->BatchCount < FIND_BATCH_SIZE) {
-            Result = 0;
-            goto EvaluateExecuteEnd;
-        }
-
-        ArgumentCount = Execute->ArgumentCount + Execute->BatchCount;
+        Execute->BatchSize += PathSize;
+        Result = 0;
+        goto EvaluateExecuteEnd;
     }
 
     //
@@ -1395,30 +1445,29 @@ Return Value:
     }
 
     //
-    // Perform substitutions if needed.
+    // Perform substitutions.
     //
 
-    if (Execute->Batch == FALSE) {
-        for (ArgumentIndex = 0;
-             ArgumentIndex < Execute->ArgumentCount;
-             ArgumentIndex += 1) {
+    for (ArgumentIndex = 0;
+         ArgumentIndex < Execute->ArgumentCount;
+         ArgumentIndex += 1) {
 
-            assert(Execute->NewArguments[ArgumentIndex] == NULL);
+        assert(Execute->NewArguments[ArgumentIndex] == NULL);
 
-            Execute->NewArguments[ArgumentIndex] =
+        Execute->NewArguments[ArgumentIndex] =
                           FindSubstitutePath(Execute->Arguments[ArgumentIndex],
                                              Path);
 
-            if (Execute->NewArguments[ArgumentIndex] == NULL) {
-                Result = ENOMEM;
-                goto EvaluateExecuteEnd;
-            }
+        if (Execute->NewArguments[ArgumentIndex] == NULL) {
+            Result = ENOMEM;
+            goto EvaluateExecuteEnd;
         }
-
-        ArgumentCount = Execute->ArgumentCount;
     }
 
-    Result = FindExecute(Execute->NewArguments, ArgumentCount, &ReturnValue);
+    Result = FindExecute(Execute->NewArguments,
+                         Execute->ArgumentCount,
+                         &ReturnValue);
+
     if (Result != 0) {
         goto EvaluateExecuteEnd;
     }
@@ -1427,26 +1476,13 @@ Return Value:
         *Match = TRUE;
     }
 
+EvaluateExecuteEnd:
+
     //
-    // Wipe out the new arguments. For batched arguments, it's just the
-    // arguments at the end. For non-batched ones, it's all the supplied
-    // arguments.
+    // Wipe out the substituted arguments of a non-batched execute.
     //
 
-    if (Execute->Batch != FALSE) {
-        for (ArgumentIndex = Execute->ArgumentCount;
-             ArgumentIndex < Execute->ArgumentCount + FIND_BATCH_SIZE;
-             ArgumentIndex += 1) {
-
-            if (Execute->NewArguments[ArgumentIndex] != NULL) {
-                free(Execute->NewArguments[ArgumentIndex]);
-                Execute->NewArguments[ArgumentIndex] = NULL;
-            }
-        }
-
-        Execute->BatchCount = 0;
-
-    } else {
+    if (Execute->Batch == FALSE) {
         for (ArgumentIndex = 0;
              ArgumentIndex < Execute->ArgumentCount;
              ArgumentIndex += 1) {
@@ -1458,7 +1494,6 @@ Return Value:
         }
     }
 
-EvaluateExecuteEnd:
     return Result;
 }
 
@@ -1510,6 +1545,57 @@ Return Value:
     return 0;
 }
 
+INT
+FindRunBatch (
+    PFIND_CONTEXT Context,
+    PFIND_NODE_EXECUTE Execute
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the utility of a batched execute on the files batched
+    so far, and then empties the batch.
+
+Arguments:
+
+    Context - Supplies the application context.
+
+    Execute - Supplies a pointer to the batched execute.
+
+Return Value:
+
+    Returns an integer exit code. 0 for success, nonzero otherwise.
+
+--*/
+
+{
+
+    ULONG ArgumentCount;
+    ULONG ArgumentIndex;
+    INT Result;
+    INT ReturnValue;
+
+    ArgumentCount = Execute->ArgumentCount + Execute->BatchCount;
+    Result = FindExecute(Execute->NewArguments, ArgumentCount, &ReturnValue);
+    if ((Result != 0) || (ReturnValue != 0)) {
+        Context->BatchFailed = TRUE;
+    }
+
+    for (ArgumentIndex = Execute->ArgumentCount;
+         ArgumentIndex < ArgumentCount;
+         ArgumentIndex += 1) {
+
+        free(Execute->NewArguments[ArgumentIndex]);
+        Execute->NewArguments[ArgumentIndex] = NULL;
+    }
+
+    Execute->BatchCount = 0;
+    Execute->BatchSize = 0;
+    return Result;
+}
+
 PSTR
 FindSubstitutePath (
     PSTR Argument,
@@ -1665,7 +1751,6 @@ Return Value:
     PLIST_ENTRY CurrentEntry;
     PFIND_NODE_EXECUTE Execute;
     INT Result;
-    INT ReturnValue;
 
     Result = 0;
     switch (Node->Type) {
@@ -1681,16 +1766,15 @@ Return Value:
             CurrentEntry = CurrentEntry->Next;
         }
 
+        break;
+
     case FindNodeExecute:
         Execute = &(Node->U.Execute);
         if ((Execute->Batch == FALSE) || (Execute->BatchCount == 0)) {
             break;
         }
 
-        Result = FindExecute(Execute->NewArguments,
-                             Execute->ArgumentCount + Execute->BatchCount,
-                             &ReturnValue);
-
+        Result = FindRunBatch(Context, Execute);
         break;
 
     default:
@@ -2294,7 +2378,8 @@ Return Value:
         Execute->ArgumentCount = Index - BeginIndex;
         TotalArgumentCount = Execute->ArgumentCount + 1;
         if (Execute->Batch != FALSE) {
-            TotalArgumentCount += FIND_BATCH_SIZE;
+            Execute->BatchCapacity = FIND_BATCH_INITIAL_CAPACITY;
+            TotalArgumentCount += Execute->BatchCapacity;
         }
 
         Execute->NewArguments = malloc(TotalArgumentCount * sizeof(PSTR));
@@ -2549,10 +2634,7 @@ Return Value:
 
     case FindNodeExecute:
         Execute = &(Node->U.Execute);
-        ArgumentCount = Execute->ArgumentCount;
-        if (Execute->Batch != FALSE) {
-            ArgumentCount += FIND_BATCH_SIZE;
-        }
+        ArgumentCount = Execute->ArgumentCount + Execute->BatchCount;
 
         if (Execute->NewArguments != NULL) {
             for (Index = 0; Index < ArgumentCount; Index += 1) {
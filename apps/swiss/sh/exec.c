@@ -54,6 +54,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define how deeply function calls are followed when deciding whether a
+// subshell can run without forking.
+//
+
+#define SHELL_IN_PROCESS_MAX_DEPTH 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -154,6 +161,26 @@ ShApplyRedirections (
     PSHELL_EXECUTION_NODE ExecutionNode
     );
 
+BOOL
+ShIsNodeSafeInProcess (
+    PSHELL Shell,
+    PSHELL_NODE Node,
+    ULONG Depth
+    );
+
+BOOL
+ShIsSimpleCommandSafeInProcess (
+    PSHELL Shell,
+    PSHELL_NODE Node,
+    ULONG Depth
+    );
+
+BOOL
+ShIsWordLiteral (
+    PSTR Word,
+    UINTN WordSize
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -172,6 +199,23 @@ BOOL ShUseSwissBuiltins = TRUE;
 CHAR ShQuotedAtArgumentsString[] =
     {SHELL_CONTROL_QUOTE, '$', '@', SHELL_CONTROL_QUOTE, '\0'};
 
+//
+// Define the builtin commands that reach outside of a subshell's own copy of
+// the shell state, and so force the subshell into its own process.
+//
+
+PSTR ShInProcessUnsafeBuiltins[] = {
+    ".",
+    "alias",
+    "eval",
+    "exec",
+    "export",
+    "trap",
+    "unalias",
+    "unset",
+    NULL
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -436,6 +480,26 @@ Return Value:
             }
         }
 
+        //
+        // Some commands are simple enough to run right here in the shell,
+        // which avoids creating a process for them at all.
+        //
+
+        if ((SwissCommand != NULL) &&
+            ((SwissCommand->Flags & SWISS_APP_IN_PROCESS) != 0) &&
+            (Asynchronous == 0)) {
+
+            SwissRunCommand(SwissCommand,
+                            Arguments,
+                            ArgumentCount,
+                            FALSE,
+                            TRUE,
+                            ReturnValue);
+
+            Status = 0;
+            goto RunCommandEnd;
+        }
+
         if (SwissCommand != NULL) {
             if (SwForkSupported != 0) {
                 Child = SwFork();
@@ -513,7 +577,28 @@ Return Value:
         goto RunCommandEnd;
     }
 
+    //
+    // Spawn the command directly if possible. This avoids copying the whole
+    // shell just to throw the copy away on exec. A failure to launch looks
+    // the same as a forked child exiting with the error.
+    //
+
     if (SwForkSupported != 0) {
+        Status = ShOsSpawnCommand(FullCommandPath,
+                                  Arguments,
+                                  ArgumentCount,
+                                  &Child);
+
+        if (Status != -1) {
+            if (Status != 0) {
+                *ReturnValue = Status;
+                Child = -1;
+            }
+
+            Status = 0;
+            goto RunCommandEnd;
+        }
+
         Child = SwFork();
         if (Child < 0) {
             PRINT_ERROR("sh: Failed to fork: %s\n", strerror(errno));
@@ -591,6 +676,155 @@ Return Value:
     return Status;
 }
 
+BOOL
+ShParseAllInput (
+    PSHELL Shell,
+    PLIST_ENTRY CommandList,
+    PBOOL InProcess
+    )
+
+/*++
+
+Routine Description:
+
+    This routine parses all of the remaining input of a subshell up front, and
+    determines whether the commands can be run inside the parent's process
+    rather than in a forked copy of it. That is the case when every command
+    only touches the subshell's own copy of the shell state, or state that is
+    put back when the subshell is destroyed.
+
+Arguments:
+
+    Shell - Supplies a pointer to the subshell whose input should be parsed.
+
+    CommandList - Supplies a pointer to an initialized list head where the
+        parsed complete commands will be appended.
+
+    InProcess - Supplies a pointer where a boolean will be returned indicating
+        whether all the parsed commands are safe to run without forking.
+
+Return Value:
+
+    TRUE if all of the input was parsed.
+
+    FALSE if a parse error occurred. The commands before the error are still
+    returned in the list.
+
+--*/
+
+{
+
+    PSHELL_NODE Command;
+    BOOL Result;
+
+    *InProcess = TRUE;
+    while (TRUE) {
+        Result = ShParse(Shell, &Command);
+        if ((Result == FALSE) || (Command == NULL)) {
+            break;
+        }
+
+        INSERT_BEFORE(&(Command->SiblingListEntry), CommandList);
+        if ((*InProcess != FALSE) &&
+            (ShIsNodeSafeInProcess(Shell, Command, 0) == FALSE)) {
+
+            *InProcess = FALSE;
+        }
+    }
+
+    return Result;
+}
+
+BOOL
+ShExecuteCommandList (
+    PSHELL Shell,
+    PLIST_ENTRY CommandList,
+    PINT ReturnValue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine executes a list of commands previously parsed out of the
+    shell's input. The list is emptied and the commands released.
+
+Arguments:
+
+    Shell - Supplies a pointer to the shell to execute the commands in.
+
+    CommandList - Supplies a pointer to the list of parsed commands.
+
+    ReturnValue - Supplies a pointer where the return value of the shell will
+        be returned.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if a command failed to execute.
+
+--*/
+
+{
+
+    PSHELL_NODE Command;
+    BOOL Result;
+
+    Result = TRUE;
+    while ((Shell->Exited == FALSE) && (LIST_EMPTY(CommandList) == FALSE)) {
+        ShCheckForSignals(Shell);
+        Command = LIST_VALUE(CommandList->Next, SHELL_NODE, SiblingListEntry);
+        LIST_REMOVE(&(Command->SiblingListEntry));
+        if ((Shell->Options & SHELL_OPTION_NO_EXECUTE) == 0) {
+            Result = ShExecuteNode(Shell, Command);
+        }
+
+        ShReleaseNode(Command);
+        if (Result == FALSE) {
+            break;
+        }
+    }
+
+    ShDestroyCommandList(CommandList);
+    *ReturnValue = Shell->LastReturnValue;
+    return Result;
+}
+
+VOID
+ShDestroyCommandList (
+    PLIST_ENTRY CommandList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases all the commands on a list of parsed commands.
+
+Arguments:
+
+    CommandList - Supplies a pointer to the list of parsed commands.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PSHELL_NODE Command;
+
+    while (LIST_EMPTY(CommandList) == FALSE) {
+        Command = LIST_VALUE(CommandList->Next, SHELL_NODE, SiblingListEntry);
+        LIST_REMOVE(&(Command->SiblingListEntry));
+        ShReleaseNode(Command);
+    }
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -2037,6 +2271,7 @@ Return Value:
     PSHELL_NODE Child;
     pid_t ChildProcess;
     PLIST_ENTRY CurrentEntry;
+    BOOL InProcess;
     PSHELL_NODE Node;
     PSTR OriginalDirectory;
     BOOL Result;
@@ -2054,8 +2289,18 @@ Return Value:
         return FALSE;
     }
 
+    //
+    // Skip the fork if nothing in the subshell can affect the parent once the
+    // subshell's copy of the state is thrown away.
+    //
+
     ChildProcess = -1;
+    InProcess = TRUE;
     if (SwForkSupported != FALSE) {
+        InProcess = ShIsNodeSafeInProcess(Subshell, Node, 0);
+    }
+
+    if (InProcess == FALSE) {
         ChildProcess = SwFork();
 
     } else {
@@ -2082,7 +2327,7 @@ Return Value:
                 break;
             }
 
-            if (Shell->Exited != FALSE) {
+            if (Subshell->Exited != FALSE) {
                 break;
             }
 
@@ -2121,6 +2366,14 @@ Return Value:
         }
 
         ShOsConvertExitStatus(&(Subshell->LastReturnValue));
+
+    //
+    // Truncate the status of a subshell that ran in this process the same
+    // way exiting a process would have.
+    //
+
+    } else {
+        Subshell->LastReturnValue &= SHELL_EXIT_STATUS_MASK;
     }
 
     Shell->ReturnValue = Subshell->LastReturnValue;
@@ -2592,3 +2845,255 @@ Return Value:
     return Result;
 }
 
+BOOL
+ShIsNodeSafeInProcess (
+    PSHELL Shell,
+    PSHELL_NODE Node,
+    ULONG Depth
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a parsed node can be executed by a subshell
+    running inside its parent's process. The check is conservative, anything
+    that cannot be proven safe fails it.
+
+Arguments:
+
+    Shell - Supplies a pointer to the subshell that would execute the node.
+
+    Node - Supplies a pointer to the node to check, along with all its
+        children.
+
+    Depth - Supplies the number of function bodies that have been followed to
+        get to this node.
+
+Return Value:
+
+    TRUE if the node can be executed without forking.
+
+    FALSE if the node needs a process of its own.
+
+--*/
+
+{
+
+    PSHELL_NODE Child;
+    PLIST_ENTRY CurrentEntry;
+    PSHELL_CASE_PATTERN_SET Set;
+
+    if (Node->RunInBackground != FALSE) {
+        return FALSE;
+    }
+
+    if (Node->Type == ShellNodeSimpleCommand) {
+        return ShIsSimpleCommandSafeInProcess(Shell, Node, Depth);
+    }
+
+    if (Node->Type == ShellNodeCase) {
+        CurrentEntry = Node->U.Case.PatternList.Next;
+        while (CurrentEntry != &(Node->U.Case.PatternList)) {
+            Set = LIST_VALUE(CurrentEntry, SHELL_CASE_PATTERN_SET, ListEntry);
+            CurrentEntry = CurrentEntry->Next;
+            if ((Set->Action != NULL) &&
+                (ShIsNodeSafeInProcess(Shell, Set->Action, Depth) == FALSE)) {
+
+                return FALSE;
+            }
+        }
+    }
+
+    CurrentEntry = Node->Children.Next;
+    while (CurrentEntry != &(Node->Children)) {
+        Child = LIST_VALUE(CurrentEntry, SHELL_NODE, SiblingListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (ShIsNodeSafeInProcess(Shell, Child, Depth) == FALSE) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL
+ShIsSimpleCommandSafeInProcess (
+    PSHELL Shell,
+    PSHELL_NODE Node,
+    ULONG Depth
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a simple command can be executed by a
+    subshell running inside its parent's process. External commands are fine,
+    since they get their own process anyway. Functions are fine if their
+    bodies are. Most builtins only touch the subshell's copy of the shell
+    state, but a few reach further and are refused.
+
+Arguments:
+
+    Shell - Supplies a pointer to the subshell that would execute the command.
+
+    Node - Supplies a pointer to the simple command node.
+
+    Depth - Supplies the number of function bodies that have been followed to
+        get to this node.
+
+Return Value:
+
+    TRUE if the command can be executed without forking.
+
+    FALSE if the command needs a process of its own.
+
+--*/
+
+{
+
+    PSTR Arguments;
+    PSHELL_FUNCTION Function;
+    PSTR Name;
+    UINTN NameLength;
+    PSTR Option;
+    UINTN OptionLength;
+    BOOL Result;
+    PSTR *UnsafeBuiltin;
+
+    assert(Node->Type == ShellNodeSimpleCommand);
+
+    //
+    // A command that is nothing but assignments only changes variables.
+    //
+
+    Arguments = Node->U.SimpleCommand.Arguments;
+    if (Arguments == NULL) {
+        return TRUE;
+    }
+
+    //
+    // The command name has to be known now, before it is expanded.
+    //
+
+    NameLength = strcspn(Arguments, " ");
+    if (ShIsWordLiteral(Arguments, NameLength) == FALSE) {
+        return FALSE;
+    }
+
+    Name = SwStringDuplicate(Arguments, NameLength + 1);
+    if (Name == NULL) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    UnsafeBuiltin = ShInProcessUnsafeBuiltins;
+    while (*UnsafeBuiltin != NULL) {
+        if (strcmp(Name, *UnsafeBuiltin) == 0) {
+            goto IsSimpleCommandSafeInProcessEnd;
+        }
+
+        UnsafeBuiltin += 1;
+    }
+
+    //
+    // The command builtin can run anything, including the unsafe builtins.
+    // Allow only its lookup forms, which are common in scripts.
+    //
+
+    if (strcmp(Name, "command") == 0) {
+        Option = Arguments + NameLength;
+        while (*Option == ' ') {
+            Option += 1;
+        }
+
+        OptionLength = strcspn(Option, " ");
+        if ((OptionLength == 2) &&
+            ((strncmp(Option, "-v", OptionLength) == 0) ||
+             (strncmp(Option, "-V", OptionLength) == 0))) {
+
+            Result = TRUE;
+        }
+
+        goto IsSimpleCommandSafeInProcessEnd;
+    }
+
+    if (ShIsBuiltinCommand(Name) != NULL) {
+        Result = TRUE;
+        goto IsSimpleCommandSafeInProcessEnd;
+    }
+
+    Function = ShGetFunction(Shell, Name, NameLength + 1);
+    if (Function != NULL) {
+        if (Depth < SHELL_IN_PROCESS_MAX_DEPTH) {
+            Result = ShIsNodeSafeInProcess(Shell, Function->Node, Depth + 1);
+        }
+
+        goto IsSimpleCommandSafeInProcessEnd;
+    }
+
+    Result = TRUE;
+
+IsSimpleCommandSafeInProcessEnd:
+    free(Name);
+    return Result;
+}
+
+BOOL
+ShIsWordLiteral (
+    PSTR Word,
+    UINTN WordLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a word from a command is plain text that
+    expansion and quote removal would leave alone.
+
+Arguments:
+
+    Word - Supplies a pointer to the word, which need not be null terminated.
+
+    WordLength - Supplies the length of the word in characters, not including
+        any null terminator.
+
+Return Value:
+
+    TRUE if the word is plain text.
+
+    FALSE if the word is empty or contains quotes, expansions, or patterns.
+
+--*/
+
+{
+
+    CHAR Character;
+    UINTN Index;
+
+    if (WordLength == 0) {
+        return FALSE;
+    }
+
+    //
+    // A lone open bracket is the test command, not a pattern.
+    //
+
+    if ((WordLength == 1) && (Word[0] == '[')) {
+        return TRUE;
+    }
+
+    for (Index = 0; Index < WordLength; Index += 1) {
+        Character = Word[Index];
+        if ((Character < ' ') ||
+            (strchr("\"$&'()*;<>?[\\]`{|}~", Character) != NULL)) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
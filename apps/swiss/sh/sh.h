@@ -225,6 +225,13 @@ Module Name:
 
 #define SHELL_ERROR_EXECUTE 126
 
+//
+// Define the bits of a subshell's return value that survive when it exits.
+// This is applied to subshells that run without forking to match.
+//
+
+#define SHELL_EXIT_STATUS_MASK 0xFF
+
 //
 // Define the default size of the input buffer in bytes.
 //
@@ -989,6 +996,92 @@ Return Value:
 
 --*/
 
+BOOL
+ShParseAllInput (
+    PSHELL Shell,
+    PLIST_ENTRY CommandList,
+    PBOOL InProcess
+    );
+
+/*++
+
+Routine Description:
+
+    This routine parses all of the remaining input of a subshell up front, and
+    determines whether the commands can be run inside the parent's process
+    rather than in a forked copy of it.
+
+Arguments:
+
+    Shell - Supplies a pointer to the subshell whose input should be parsed.
+
+    CommandList - Supplies a pointer to an initialized list head where the
+        parsed complete commands will be appended.
+
+    InProcess - Supplies a pointer where a boolean will be returned indicating
+        whether all the parsed commands are safe to run without forking.
+
+Return Value:
+
+    TRUE if all of the input was parsed.
+
+    FALSE if a parse error occurred. The commands before the error are still
+    returned in the list.
+
+--*/
+
+BOOL
+ShExecuteCommandList (
+    PSHELL Shell,
+    PLIST_ENTRY CommandList,
+    PINT ReturnValue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine executes a list of commands previously parsed out of the
+    shell's input. The list is emptied and the commands released.
+
+Arguments:
+
+    Shell - Supplies a pointer to the shell to execute the commands in.
+
+    CommandList - Supplies a pointer to the list of parsed commands.
+
+    ReturnValue - Supplies a pointer where the return value of the shell will
+        be returned.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if a command failed to execute.
+
+--*/
+
+VOID
+ShDestroyCommandList (
+    PLIST_ENTRY CommandList
+    );
+
+/*++
+
+Routine Description:
+
+    This routine releases all the commands on a list of parsed commands.
+
+Arguments:
+
+    CommandList - Supplies a pointer to the list of parsed commands.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Utility functions
 //
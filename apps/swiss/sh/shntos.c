@@ -1080,6 +1080,50 @@ Return Value:
     return;
 }
 
+int
+ShOsSpawnCommand (
+    char *Command,
+    char **Arguments,
+    int ArgumentCount,
+    int *Child
+    )
+
+/*++
+
+Routine Description:
+
+    This routine launches an external command in a new process without first
+    making a copy of the shell. The child gets the signal dispositions the
+    shell originally started with.
+
+Arguments:
+
+    Command - Supplies a pointer to the full path of the command to run.
+
+    Arguments - Supplies the null terminated array of command arguments,
+        including the command name.
+
+    ArgumentCount - Supplies the number of arguments in the array.
+
+    Child - Supplies a pointer where the process ID of the child will be
+        returned on success.
+
+Return Value:
+
+    0 on success.
+
+    -1 if the command cannot be spawned directly, and the caller should fork
+    and exec instead.
+
+    Returns an error number if the command could not be launched.
+
+--*/
+
+{
+
+    return -1;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
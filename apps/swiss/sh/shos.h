@@ -336,8 +336,8 @@ ShPushInputText (
 
 Routine Description:
 
-    This routine forks an executable or thread to push the given input into the
-    given pipe.
+    This routine pushes the given input into the given pipe, either directly
+    or by forking an executable or thread to do it.
 
 Arguments:
 
@@ -347,7 +347,8 @@ Routine Description:
     TextSize - Supplies the number of bytes to write.
 
     Pipe - Supplies the pipe to write into. This routine is responsible for
-        closing the write end of the pipe.
+        closing the write end of the pipe. The read end may be replaced with
+        a different descriptor that reads back the same text.
 
 Return Value:
 
@@ -641,3 +642,42 @@ Return Value:
 
 --*/
 
+int
+ShOsSpawnCommand (
+    char *Command,
+    char **Arguments,
+    int ArgumentCount,
+    int *Child
+    );
+
+/*++
+
+Routine Description:
+
+    This routine launches an external command in a new process without first
+    making a copy of the shell. The child gets the signal dispositions the
+    shell originally started with.
+
+Arguments:
+
+    Command - Supplies a pointer to the full path of the command to run.
+
+    Arguments - Supplies the null terminated array of command arguments,
+        including the command name.
+
+    ArgumentCount - Supplies the number of arguments in the array.
+
+    Child - Supplies a pointer where the process ID of the child will be
+        returned on success.
+
+Return Value:
+
+    0 on success.
+
+    -1 if the command cannot be spawned directly, and the caller should fork
+    and exec instead.
+
+    Returns an error number if the command could not be launched.
+
+--*/
+
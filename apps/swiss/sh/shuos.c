@@ -36,7 +36,9 @@ Module Name:
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
+#include <spawn.h>
 #include <pwd.h>
 #include <sys/times.h>
 #include <sys/wait.h>
@@ -63,6 +65,13 @@ ShConvertToOsSignal (
     SHELL_SIGNAL Signal
     );
 
+int
+ShWriteInputText (
+    int Descriptor,
+    char *Text,
+    unsigned long TextSize
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -87,6 +96,8 @@ int ShOriginalSignalDispositionValid[ShellSignalCount];
 
 int ShExecutableBitSupported = 1;
 
+extern char **environ;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -343,8 +354,10 @@ ShPushInputText (
 
 Routine Description:
 
-    This routine forks an executable or thread to push the given input into the
-    given pipe.
+    This routine pushes the given input into the given pipe. Text that fits in
+    the pipe is written directly. Larger text goes into an unlinked temporary
+    file, which replaces the read end of the pipe. Only if that fails is a
+    process forked to feed the pipe.
 
 Arguments:
 
@@ -354,7 +367,8 @@ Routine Description:
     TextSize - Supplies the number of bytes to write.
 
     Pipe - Supplies the pipe to write into. This routine is responsible for
-        closing the write end of the pipe.
+        closing the write end of the pipe. The read end may be replaced with
+        a different descriptor that reads back the same text.
 
 Return Value:
 
@@ -368,10 +382,62 @@ Return Value:
 
 {
 
-    unsigned long BytesToWrite;
-    ssize_t BytesWritten;
+    unsigned long Capacity;
     pid_t Child;
-    unsigned long TotalBytesWritten;
+    int Descriptor;
+    FILE *File;
+    int Result;
+
+    //
+    // A write into an empty pipe that fits within its capacity never blocks,
+    // so small documents (by far the most common) need no help at all.
+    //
+
+    Capacity = PIPE_BUF;
+
+#ifdef F_GETPIPE_SZ
+
+    Result = fcntl(Pipe[1], F_GETPIPE_SZ);
+    if ((Result > 0) && ((unsigned long)Result > Capacity)) {
+        Capacity = Result;
+    }
+
+#endif
+
+    if (TextSize <= Capacity) {
+        Result = ShWriteInputText(Pipe[1], Text, TextSize);
+        if (Result == 0) {
+            close(Pipe[1]);
+            Pipe[1] = -1;
+            return 0;
+        }
+    }
+
+    //
+    // Put larger documents in a temporary file and read from that instead.
+    //
+
+    File = tmpfile();
+    if (File != NULL) {
+        Descriptor = -1;
+        Result = ShWriteInputText(fileno(File), Text, TextSize);
+        if (Result == 0) {
+            Descriptor = dup(fileno(File));
+        }
+
+        fclose(File);
+        if (Descriptor >= 0) {
+            if (lseek(Descriptor, 0, SEEK_SET) == 0) {
+                close(Pipe[0]);
+                close(Pipe[1]);
+                Pipe[0] = Descriptor;
+                Pipe[1] = -1;
+                return 0;
+            }
+
+            close(Descriptor);
+        }
+    }
 
     //
     // Fork off into a new process that pushes the input into the pipe and
@@ -395,36 +461,12 @@ Return Value:
     }
 
     //
-    // This is the child process. Loop writing to the file descriptor.
+    // This is the child process. Write the text out and exit immediately, as
+    // this was a child process and shouldn't go back to doing shell functions.
     //
 
     close(Pipe[0]);
-    TotalBytesWritten = 0;
-    while (TotalBytesWritten != TextSize) {
-        BytesToWrite = SHELL_INPUT_CHUNK_SIZE;
-        if (TextSize - TotalBytesWritten < BytesToWrite) {
-            BytesToWrite = TextSize - TotalBytesWritten;
-        }
-
-        do {
-            BytesWritten = write(Pipe[1],
-                                 Text + TotalBytesWritten,
-                                 BytesToWrite);
-
-        } while ((BytesWritten < 0) && (errno == EINTR));
-
-        if (BytesWritten <= 0) {
-            break;
-        }
-
-        TotalBytesWritten += BytesWritten;
-    }
-
-    //
-    // Exit immediately, as this was a child process and shouldn't go back to
-    // doing shell functions.
-    //
-
+    ShWriteInputText(Pipe[1], Text, TextSize);
     exit(0);
     return 0;
 }
@@ -950,6 +992,96 @@ Return Value:
     return;
 }
 
+int
+ShOsSpawnCommand (
+    char *Command,
+    char **Arguments,
+    int ArgumentCount,
+    int *Child
+    )
+
+/*++
+
+Routine Description:
+
+    This routine launches an external command in a new process without first
+    making a copy of the shell. The child gets the signal dispositions the
+    shell originally started with.
+
+Arguments:
+
+    Command - Supplies a pointer to the full path of the command to run.
+
+    Arguments - Supplies the null terminated array of command arguments,
+        including the command name.
+
+    ArgumentCount - Supplies the number of arguments in the array.
+
+    Child - Supplies a pointer where the process ID of the child will be
+        returned on success.
+
+Return Value:
+
+    0 on success.
+
+    -1 if the command cannot be spawned directly, and the caller should fork
+    and exec instead.
+
+    Returns an error number if the command could not be launched.
+
+--*/
+
+{
+
+    posix_spawnattr_t Attributes;
+    sigset_t DefaultSignals;
+    struct sigaction *Original;
+    int OsSignalNumber;
+    pid_t Pid;
+    int Result;
+    int SignalIndex;
+
+    //
+    // Anything the shell started out with at the default disposition goes
+    // back to the default in the child. Caught signals are reset by the exec
+    // anyway. A signal that was originally ignored but is now caught cannot
+    // be described to spawn, so leave that rare case to fork.
+    //
+
+    sigemptyset(&DefaultSignals);
+    for (SignalIndex = 0; SignalIndex < ShellSignalCount; SignalIndex += 1) {
+        OsSignalNumber = ShConvertToOsSignal(SignalIndex);
+        if ((OsSignalNumber == 0) ||
+            (ShOriginalSignalDispositionValid[SignalIndex] == 0)) {
+
+            continue;
+        }
+
+        Original = &(ShOriginalSignalDispositions[SignalIndex]);
+        if (Original->sa_handler == SIG_IGN) {
+            return -1;
+        }
+
+        sigaddset(&DefaultSignals, OsSignalNumber);
+    }
+
+    Result = posix_spawnattr_init(&Attributes);
+    if (Result != 0) {
+        return -1;
+    }
+
+    posix_spawnattr_setflags(&Attributes, POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setsigdefault(&Attributes, &DefaultSignals);
+    fflush(NULL);
+    Result = posix_spawn(&Pid, Command, NULL, &Attributes, Arguments, environ);
+    posix_spawnattr_destroy(&Attributes);
+    if (Result == 0) {
+        *Child = Pid;
+    }
+
+    return Result;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1100,3 +1232,62 @@ Return Value:
     return OsSignalNumber;
 }
 
+int
+ShWriteInputText (
+    int Descriptor,
+    char *Text,
+    unsigned long TextSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes all of the given text out to a file descriptor.
+
+Arguments:
+
+    Descriptor - Supplies the file descriptor to write to.
+
+    Text - Supplies a pointer to the text to write.
+
+    TextSize - Supplies the number of bytes to write.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure.
+
+--*/
+
+{
+
+    unsigned long BytesToWrite;
+    ssize_t BytesWritten;
+    unsigned long TotalBytesWritten;
+
+    TotalBytesWritten = 0;
+    while (TotalBytesWritten != TextSize) {
+        BytesToWrite = SHELL_INPUT_CHUNK_SIZE;
+        if (TextSize - TotalBytesWritten < BytesToWrite) {
+            BytesToWrite = TextSize - TotalBytesWritten;
+        }
+
+        do {
+            BytesWritten = write(Descriptor,
+                                 Text + TotalBytesWritten,
+                                 BytesToWrite);
+
+        } while ((BytesWritten < 0) && (errno == EINTR));
+
+        if (BytesWritten <= 0) {
+            return -1;
+        }
+
+        TotalBytesWritten += BytesWritten;
+    }
+
+    return 0;
+}
+
@@ -411,38 +411,117 @@ Return Value:
 {
 
     pid_t Child;
+    LIST_ENTRY CommandList;
+    BOOL InProcess;
     UINTN Index;
     PSTR OriginalDirectory;
+    SHELL_LEXER_STATE OriginalLexer;
     INT OriginalOutput;
     PVOID OutputCollectionHandle;
+    FILE *OutputFile;
     unsigned long OutputSizeLong;
     PSTR OutputString;
+    BOOL ParsedInput;
     INT Pipe[2];
     INT Result;
     INT Status;
 
     Child = -1;
+    INITIALIZE_LIST_HEAD(&CommandList);
+    InProcess = FALSE;
     OriginalDirectory = NULL;
     OriginalOutput = -1;
     *Output = NULL;
     *OutputSize = 0;
+    ParsedInput = TRUE;
     Pipe[0] = -1;
     Pipe[1] = -1;
 
+    //
+    // Parse a copy of the input up front to see whether the subshell can be
+    // run without forking. The original input is put back so that a forked
+    // subshell parses it exactly as it always has, with alias definitions
+    // taking effect as they are run.
+    //
+
+    if ((SwForkSupported != FALSE) && (Subshell->Lexer.InputFile == NULL)) {
+        memcpy(&OriginalLexer, &(Subshell->Lexer), sizeof(SHELL_LEXER_STATE));
+        Result = ShInitializeLexer(&(Subshell->Lexer),
+                                   NULL,
+                                   OriginalLexer.InputBuffer,
+                                   OriginalLexer.InputBufferSize);
+
+        if (Result != FALSE) {
+            ParsedInput = ShParseAllInput(Subshell, &CommandList, &InProcess);
+            ShDestroyLexer(&(Subshell->Lexer));
+        }
+
+        memcpy(&(Subshell->Lexer), &OriginalLexer, sizeof(SHELL_LEXER_STATE));
+
+        //
+        // If the input failed to parse, the error has already been printed.
+        // Have the child run whatever came before the error rather than
+        // parse the input again. Otherwise the child starts over.
+        //
+
+        if (ParsedInput == FALSE) {
+            InProcess = FALSE;
+
+        } else if (InProcess == FALSE) {
+            ShDestroyCommandList(&CommandList);
+        }
+    }
+
+    //
+    // Commands run in this process write to a temporary file rather than a
+    // pipe, since nobody would be reading the other end of a pipe while they
+    // run. Fall back to forking if there is no temporary file to be had.
+    //
+
+    if (InProcess != FALSE) {
+        OutputFile = tmpfile();
+        if (OutputFile != NULL) {
+            Pipe[0] = ShDup(ParentShell, fileno(OutputFile), FALSE);
+            fclose(OutputFile);
+        }
+
+        if (Pipe[0] < 0) {
+            Pipe[0] = -1;
+            InProcess = FALSE;
+        }
+    }
+
     //
     // Create a pipe for reading standard out.
     //
 
-    Result = ShCreatePipe(Pipe);
-    if (Result == FALSE) {
-        goto ExecuteSubshellEnd;
+    if (InProcess == FALSE) {
+        Result = ShCreatePipe(Pipe);
+        if (Result == FALSE) {
+            goto ExecuteSubshellEnd;
+        }
+
+    //
+    // Point standard out at the temporary file. Flush anything already
+    // buffered first so that it goes to the original destination.
+    //
+
+    } else {
+        fflush(stdout);
+        OriginalOutput = ShDup(ParentShell, STDOUT_FILENO, FALSE);
+        if (OriginalOutput < 0) {
+            Result = FALSE;
+            goto ExecuteSubshellEnd;
+        }
+
+        ShDup2(ParentShell, Pipe[0], STDOUT_FILENO);
     }
 
     //
     // Wire up the write end of the pipe to standard output.
     //
 
-    if (Pipe[1] != STDOUT_FILENO) {
+    if ((Pipe[1] != -1) && (Pipe[1] != STDOUT_FILENO)) {
         OriginalOutput = ShDup(ParentShell, STDOUT_FILENO, FALSE);
         if (OriginalOutput < 0) {
             Result = FALSE;
@@ -464,7 +543,27 @@ Return Value:
     }
 
     ShInitializeSignals(Subshell);
-    if (SwForkSupported != FALSE) {
+    if (InProcess != FALSE) {
+        OriginalDirectory = getcwd(NULL, 0);
+        ShSetAllSignalDispositions(Subshell);
+        ShExecuteCommandList(Subshell, &CommandList, ReturnValue);
+        Subshell->Exited = TRUE;
+        ShRunAtExitSignal(Subshell);
+        fflush(stdout);
+
+        //
+        // Mimic the truncation a real exit status would go through.
+        //
+
+        *ReturnValue &= SHELL_EXIT_STATUS_MASK;
+
+        //
+        // Rewind the temporary file so the output can be read back out of it.
+        //
+
+        lseek(Pipe[0], 0, SEEK_SET);
+
+    } else if (SwForkSupported != FALSE) {
         Child = SwFork();
         if (Child == -1) {
             SwPrintError(errno, NULL, "Unable to fork");
@@ -480,12 +579,20 @@ Return Value:
             assert(ParentShell->PostForkCloseDescriptor == -1);
 
             ShClose(ParentShell, Pipe[0]);
-            ShExecute(Subshell, ReturnValue);
+            if (ParsedInput == FALSE) {
+                ShExecuteCommandList(Subshell, &CommandList, ReturnValue);
+
+            } else {
+                ShExecute(Subshell, ReturnValue);
+            }
+
             Subshell->Exited = TRUE;
             ShRunAtExitSignal(Subshell);
             exit(*ReturnValue);
         }
 
+        ShDestroyCommandList(&CommandList);
+
     //
     // Fork is not supported, so just run the command in this process
     // (presuming that the prepare for output collection spawned at least
@@ -558,10 +665,10 @@ Return Value:
     *OutputSize = OutputSizeLong;
 
     //
-    // If fork is supported, wait on the child process.
+    // If the subshell was forked, wait on the child process.
     //
 
-    if (SwForkSupported != FALSE) {
+    if (Child != -1) {
         Result = SwWaitPid(Child, 0, ReturnValue);
         if (Result == -1) {
             *ReturnValue = SHELL_ERROR_OPEN;
@@ -576,6 +683,7 @@ Return Value:
     Result = TRUE;
 
 ExecuteSubshellEnd:
+    ShDestroyCommandList(&CommandList);
     ShSetAllSignalDispositions(ParentShell);
 
     //
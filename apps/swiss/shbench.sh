@@ -0,0 +1,126 @@
+#!/bin/sh
+## Copyright (c) 2026 Minoca Corp.
+##
+##    This file is licensed under the terms of the GNU General Public License
+##    version 3. Alternative licensing terms are available. Contact
+##    info@minocacorp.com for details. See the LICENSE file at the root of this
+##    project for complete licensing information.
+##
+## Script Name:
+##
+##     shbench.sh
+##
+## Abstract:
+##
+##     This script times common shell script idioms that lean on process
+##     creation: command substitution, test loops, here-documents, and
+##     subshell groups. Run it under the shell to be measured, optionally
+##     passing the number of iterations and the names of the cases to run.
+##     The shell used for each case can be overridden with SH.
+##
+##     usage: shbench.sh [iterations] [name...]
+##
+## Environment:
+##
+##     POSIX
+##
+
+SH=${SH:-sh}
+CASES="subst_builtin subst_function subst_external subst_arithmetic \
+test_loop heredoc subshell_group"
+
+##
+## When invoked with --run, run a single case in this process and report the
+## times the shell and its children took.
+##
+
+if [ "$1" = "--run" ]; then
+    name=$2
+    count=$3
+    i=0
+    f() {
+        echo "$1"
+    }
+
+    case "$name" in
+    subst_builtin)
+        while [ $i -lt $count ]; do
+            x=$(echo $i)
+            i=$((i + 1))
+        done
+        ;;
+
+    subst_function)
+        while [ $i -lt $count ]; do
+            x=$(f $i)
+            i=$((i + 1))
+        done
+        ;;
+
+    subst_external)
+        while [ $i -lt $count ]; do
+            x=$(basename /usr/lib/file$i.so .so)
+            i=$((i + 1))
+        done
+        ;;
+
+    subst_arithmetic)
+        while [ $i -lt $count ]; do
+            x=$(expr $i + 1)
+            i=$((i + 1))
+        done
+        ;;
+
+    test_loop)
+        while [ $i -lt $count ]; do
+            if [ -n "$i" ] && test "$i" != "x"; then
+                x=$i
+            fi
+
+            i=$((i + 1))
+        done
+        ;;
+
+    heredoc)
+        while [ $i -lt $count ]; do
+            read x <<EOF
+line $i
+EOF
+            i=$((i + 1))
+        done
+        ;;
+
+    subshell_group)
+        while [ $i -lt $count ]; do
+            (x=$i; cd /)
+            i=$((i + 1))
+        done
+        ;;
+
+    *)
+        echo "$0: Unknown case $name." >&2
+        exit 1
+        ;;
+    esac
+
+    times
+    exit 0
+fi
+
+count=1000
+case "$1" in
+[0-9]*)
+    count=$1
+    shift
+    ;;
+esac
+
+if [ $# -ne 0 ]; then
+    CASES="$*"
+fi
+
+for name in $CASES; do
+    echo "$name ($count iterations):"
+    "$SH" "$0" --run "$name" "$count" || exit 1
+done
+
@@ -13,7 +13,9 @@ Module Name:
 
 Abstract:
 
-    This module implements the sort utility.
+    This module implements the sort utility. Input is read into a bounded
+    buffer, which is sorted in parallel and spilled to a temporary file
+    whenever it fills. The sorted runs are then combined with a k-way merge.
 
 Author:
 
@@ -34,7 +36,10 @@ Module Name:
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -49,7 +54,8 @@ Module Name:
 #define SORT_VERSION_MINOR 0
 
 #define SORT_USAGE                                                             \
-    "usage: sort [-m][-o output][-bdfinru][-t char][-k keydef]... [file...]\n" \
+    "usage: sort [-m][-o output][-bdfinru][-t char][-k keydef]... [-S size]\n" \
+    "            [-T dir][--parallel=n] [file...]\n"                         \
     "       sort -c [-bdfinru][-t char][-k keydef][file]\n\n"                  \
     "The sort utility either sorts all lines in a file, merges line of all \n" \
     "the named (presorted) files together, or checks to see if a single \n"    \
@@ -84,10 +90,17 @@ Module Name:
     "        flag meaning to that specific field.\n"                           \
     "  -t, --field-separator <character> -- Use the given character as a \n"   \
     "        field separator.\n"                                               \
+    "  -S, --buffer-size <size> -- Set the amount of memory used to hold \n"  \
+    "        input lines. Larger inputs are sorted in pieces and spilled to \n"\
+    "        temporary files. The size is in kilobytes unless followed by \n"  \
+    "        b, K, M, or G.\n"                                                 \
+    "  -T, --temporary-directory <dir> -- Use the given directory for \n"     \
+    "        temporary files instead of $TMPDIR or /tmp.\n"                   \
+    "  --parallel=n -- Use up to n threads to sort each buffer.\n"           \
     "  file -- Supplies the input file to sort. If no file is supplied or \n"  \
     "        the file is -, then use stdin.\n\n"
 
-#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:"
+#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:S:T:"
 
 //
 // Set this option to ignore leading blanks in comparisons.
@@ -148,6 +161,56 @@ Module Name:
 #define SORT_INITIAL_ELEMENT_COUNT 32
 #define SORT_INITIAL_STRING_SIZE 32
 
+//
+// Define the default and minimum amount of memory used to hold input lines
+// before they're sorted and spilled to a temporary file.
+//
+
+#define SORT_DEFAULT_BUFFER_SIZE (64 * _1MB)
+#define SORT_MINIMUM_BUFFER_SIZE _64KB
+
+//
+// Define the approximate memory cost of each line beyond its text: the string
+// structure, the record, and the scratch record used during parallel merges.
+//
+
+#define SORT_LINE_OVERHEAD (sizeof(SORT_STRING) + (2 * sizeof(SORT_RECORD)))
+
+//
+// Define the default cap on sort threads, the most that can be requested,
+// and the fewest lines worth handing to a thread.
+//
+
+#define SORT_DEFAULT_MAX_THREADS 8
+#define SORT_MAX_THREADS 64
+#define SORT_MINIMUM_THREAD_LINES 4096
+
+//
+// Define the maximum number of runs merged at once. Larger numbers of runs
+// are merged in several passes to bound the number of open files.
+//
+
+#define SORT_MERGE_FAN_IN 16
+
+#define SORT_DEFAULT_TEMPORARY_DIRECTORY "/tmp"
+#define SORT_TEMPORARY_DIRECTORY_VARIABLE "TMPDIR"
+#define SORT_RUN_NAME_SIZE 48
+#define SORT_RUN_CREATE_ATTEMPTS 100
+#define SORT_RUN_PERMISSIONS 0600
+
+//
+// Define the value of the long-only parallel option.
+//
+
+#define SORT_LONG_OPTION_PARALLEL 256
+
+//
+// Define the bit flipped to turn a signed numeric key into an unsigned
+// prefix with the same ordering.
+//
+
+#define SORT_PREFIX_SIGN_BIT (1ULL << ((sizeof(ULONGLONG) * BITS_PER_BYTE) - 1))
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -222,6 +285,30 @@ typedef struct _SORT_STRING {
 
 /*++
 
+Structure Description:
+
+    This structure defines a line being sorted along with a precomputed prefix
+    of its first key. Comparing prefixes settles most comparisons without
+    chasing the line pointer or re-scanning for fields.
+
+Members:
+
+    Prefix - Stores the first bytes of the first key, mapped so that an
+        unsigned comparison orders them the same way as the full comparison.
+        For numeric keys this is the value itself with its sign bit flipped.
+        This is zero for every line if prefixes are not in use.
+
+    Line - Stores a pointer to the line.
+
+--*/
+
+typedef struct _SORT_RECORD {
+    ULONGLONG Prefix;
+    PSORT_STRING Line;
+} SORT_RECORD, *PSORT_RECORD;
+
+/*++
+
 Structure Description:
 
     This structure defines an input file to the sort utility.
@@ -231,17 +318,57 @@ Structure Description:
     File - Stores the open file pointer, or NULL if the file could not be
         opened.
 
-    Line - Stores a pointer to the string containing the most recent line.
+    Record - Stores the most recent line and its key prefix. The line is NULL
+        once the input is drained.
 
 --*/
 
 typedef struct _SORT_INPUT {
     FILE *File;
-    PSORT_STRING Line;
+    SORT_RECORD Record;
 } SORT_INPUT, *PSORT_INPUT;
 
 /*++
 
+Structure Description:
+
+    This structure defines a unit of work for a sort thread: either sorting a
+    chunk of records in place or merging two adjacent sorted chunks.
+
+Members:
+
+    Thread - Stores the thread performing the work.
+
+    Started - Stores a boolean indicating whether a thread was created for
+        this work.
+
+    Source - Stores a pointer to the records to sort or merge.
+
+    Destination - Stores a pointer where merged records are written, or NULL
+        to sort the source in place.
+
+    Start - Stores the index of the first record of this chunk within the
+        whole buffer.
+
+    Count - Stores the total number of records in this chunk.
+
+    LeftCount - Stores the number of records in the first of the two sorted
+        halves when merging.
+
+--*/
+
+typedef struct _SORT_WORK {
+    pthread_t Thread;
+    BOOL Started;
+    PSORT_RECORD Source;
+    PSORT_RECORD Destination;
+    UINTN Start;
+    UINTN Count;
+    UINTN LeftCount;
+} SORT_WORK, *PSORT_WORK;
+
+/*++
+
 Structure Description:
 
     This structure defines a sort key used by the sort utility.
@@ -294,6 +421,23 @@ Structure Description:
     Separator - Stores the field separator character, or -1 if none was
         supplied.
 
+    BufferSize - Stores the approximate number of bytes of input to hold in
+        memory before spilling a sorted run to a temporary file.
+
+    ThreadCount - Stores the maximum number of threads to sort with.
+
+    TemporaryDirectory - Stores the directory where runs are spilled.
+
+    Run - Stores the array of paths to temporary files holding sorted runs.
+
+    RunCounter - Stores the counter used to name temporary files.
+
+    UsePrefix - Stores a boolean indicating whether key prefixes are computed.
+        They are not for keys skipping characters with -d or -i.
+
+    ReversePrefix - Stores a boolean indicating whether the first key sorts in
+        reverse.
+
 --*/
 
 typedef struct _SORT_CONTEXT {
@@ -302,6 +446,13 @@ typedef struct _SORT_CONTEXT {
     ULONG Options;
     PSTR Output;
     INT Separator;
+    UINTN BufferSize;
+    ULONG ThreadCount;
+    PSTR TemporaryDirectory;
+    SORT_ARRAY Run;
+    ULONG RunCounter;
+    BOOL UsePrefix;
+    BOOL ReversePrefix;
 } SORT_CONTEXT, *PSORT_CONTEXT;
 
 //
@@ -314,12 +465,103 @@ SortCheckFile (
     PSORT_INPUT Input
     );
 
+INT
+SortSortInputs (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    );
+
+INT
+SortSpillRun (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count
+    );
+
+INT
+SortCreateRunFile (
+    PSORT_CONTEXT Context,
+    FILE **File
+    );
+
+VOID
+SortDestroyRunFile (
+    PSTR Path
+    );
+
+VOID
+SortHandleSignals (
+    BOOL Enable
+    );
+
+VOID
+SortSignalHandler (
+    int Signal
+    );
+
+VOID
+SortEndRunUpdate (
+    VOID
+    );
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    );
+
+VOID
+SortSortRecords (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count
+    );
+
+VOID
+SortRunWork (
+    PSORT_WORK Work,
+    UINTN WorkCount
+    );
+
+PVOID
+SortWorkThread (
+    PVOID Parameter
+    );
+
+INT
+SortWriteRecords (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count,
+    FILE *Output
+    );
+
 INT
 SortMergeSortedFiles (
     PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
     FILE *Output
     );
 
+VOID
+SortSiftDown (
+    PSORT_INPUT *Heap,
+    UINTN Count,
+    UINTN Index
+    );
+
+INT
+SortCompareRecords (
+    const VOID *LeftPointer,
+    const VOID *RightPointer
+    );
+
+ULONGLONG
+SortGetKeyPrefix (
+    PSORT_CONTEXT Context,
+    PSORT_STRING Line
+    );
+
 INT
 SortCompareLines (
     const VOID *LeftPointer,
@@ -346,6 +588,12 @@ SortAddKey (
     PSTR Argument
     );
 
+INT
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
+    );
+
 VOID
 SortScanKeyFlags (
     PSTR *Argument,
@@ -413,6 +661,24 @@ SortStringToLong (
 
 PSORT_CONTEXT SortContext;
 
+//
+// Define the signals that remove the temporary run files before terminating
+// the process, and store their original handlers.
+//
+
+int SortCleanupSignals[] = {SIGHUP, SIGINT, SIGPIPE, SIGTERM};
+void *SortOriginalSignalHandlers[sizeof(SortCleanupSignals) / sizeof(int)];
+BOOL SortSignalsHandled;
+
+//
+// Store whether or not the list of runs is being changed, in which case the
+// signal handler can't look at it, and the signal that arrived in the
+// meantime.
+//
+
+volatile sig_atomic_t SortRunUpdateInProgress;
+volatile sig_atomic_t SortPendingSignal;
+
 struct option SortLongOptions[] = {
     {"check", no_argument, 0, 'c'},
     {"merge", no_argument, 0, 'm'},
@@ -426,6 +692,9 @@ struct option SortLongOptions[] = {
     {"ignore-leading-blanks", no_argument, 0, 'b'},
     {"key", required_argument, 0, 'k'},
     {"field-separator", required_argument, 0, 't'},
+    {"buffer-size", required_argument, 0, 'S'},
+    {"temporary-directory", required_argument, 0, 'T'},
+    {"parallel", required_argument, 0, SORT_LONG_OPTION_PARALLEL},
     {"help", no_argument, 0, 'h'},
     {"version", no_argument, 0, 'V'},
     {NULL, 0, 0, 0}
@@ -462,28 +731,38 @@ Return Value:
 
 {
 
+    PSTR AfterScan;
     PSTR Argument;
     ULONG ArgumentIndex;
     SORT_CONTEXT Context;
-    PSORT_INPUT Input;
-    ULONG InputIndex;
-    PSORT_STRING InputLine;
-    SORT_ARRAY InputLines;
-    SORT_STRING InputString;
     PSORT_KEY Key;
     UINTN KeyIndex;
-    UINTN LineIndex;
+    ULONG KeyOptions;
     INT Option;
     FILE *Output;
-    PSORT_STRING PreviousLine;
+    INT ProcessorCount;
     INT Status;
+    LONG ThreadCount;
 
-    Input = NULL;
-    InputLine = NULL;
     memset(&Context, 0, sizeof(SORT_CONTEXT));
-    memset(&InputString, 0, sizeof(SORT_STRING));
-    memset(&InputLines, 0, sizeof(SORT_ARRAY));
     Context.Separator = -1;
+    Context.BufferSize = SORT_DEFAULT_BUFFER_SIZE;
+    ProcessorCount = SwGetProcessorCount(TRUE);
+    if (ProcessorCount < 1) {
+        ProcessorCount = 1;
+
+    } else if (ProcessorCount > SORT_DEFAULT_MAX_THREADS) {
+        ProcessorCount = SORT_DEFAULT_MAX_THREADS;
+    }
+
+    Context.ThreadCount = ProcessorCount;
+    Context.TemporaryDirectory = getenv(SORT_TEMPORARY_DIRECTORY_VARIABLE);
+    if ((Context.TemporaryDirectory == NULL) ||
+        (*(Context.TemporaryDirectory) == '\0')) {
+
+        Context.TemporaryDirectory = SORT_DEFAULT_TEMPORARY_DIRECTORY;
+    }
+
     Output = NULL;
 
     //
@@ -629,6 +908,48 @@ Return Value:
 
             break;
 
+        case 'S':
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            Status = SortParseSize(Argument, &(Context.BufferSize));
+            if (Status != 0) {
+                SwPrintError(0, Argument, "Invalid buffer size");
+                return 2;
+            }
+
+            if (Context.BufferSize < SORT_MINIMUM_BUFFER_SIZE) {
+                Context.BufferSize = SORT_MINIMUM_BUFFER_SIZE;
+            }
+
+            break;
+
+        case 'T':
+            Context.TemporaryDirectory = optarg;
+
+            assert(Context.TemporaryDirectory != NULL);
+
+            break;
+
+        case SORT_LONG_OPTION_PARALLEL:
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            ThreadCount = strtol(Argument, &AfterScan, 10);
+            if ((ThreadCount <= 0) || (*AfterScan != '\0')) {
+                SwPrintError(0, Argument, "Invalid thread count");
+                return 2;
+            }
+
+            if (ThreadCount > SORT_MAX_THREADS) {
+                ThreadCount = SORT_MAX_THREADS;
+            }
+
+            Context.ThreadCount = ThreadCount;
+            break;
+
         case 'V':
             SwPrintVersion(SORT_VERSION_MAJOR, SORT_VERSION_MINOR);
             return 1;
@@ -697,6 +1018,25 @@ Return Value:
         Key->EndOptions |= Context.Options;
     }
 
+    //
+    // Key prefixes can stand in for the first key as long as that key doesn't
+    // skip characters, since then the first bytes of the key aren't known
+    // without scanning the whole thing.
+    //
+
+    Key = Context.Key.Data[0];
+    KeyOptions = Key->StartOptions | Key->EndOptions;
+    if (((KeyOptions & SORT_OPTION_COMPARE_NUMERICALLY) != 0) ||
+        ((KeyOptions & (SORT_OPTION_ONLY_ALPHANUMERICS |
+                        SORT_OPTION_IGNORE_NONPRINTABLE)) == 0)) {
+
+        Context.UsePrefix = TRUE;
+    }
+
+    if ((KeyOptions & SORT_OPTION_REVERSE) != 0) {
+        Context.ReversePrefix = TRUE;
+    }
+
     //
     // Open up the output if needed.
     //
@@ -729,79 +1069,17 @@ Return Value:
         goto MainEnd;
 
     } else if ((Context.Options & SORT_OPTION_MERGE_ONLY) != 0) {
-        Status = SortMergeSortedFiles(&Context, Output);
-        goto MainEnd;
-    }
-
-    //
-    // This is the real sort, not merge or check. Read in all inputs.
-    //
-
-    for (InputIndex = 0; InputIndex < Context.Input.Size; InputIndex += 1) {
-        Input = Context.Input.Data[InputIndex];
-        while (TRUE) {
-            Status = SortReadLine(&Context,
-                                  Input,
-                                  &InputString,
-                                  &InputLine);
-
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read line");
-                goto MainEnd;
-            }
-
-            if (InputLine == NULL) {
-                break;
-            }
-
-            Status = SortArrayAddElement(&InputLines, InputLine);
-            if (Status != 0) {
-                SortDestroyString(InputLine);
-                goto MainEnd;
-            }
-
-            InputLine = NULL;
-        }
-    }
-
-    if (InputLines.Size == 0) {
-        Status = 0;
+        Status = SortMergeSortedFiles(&Context, &(Context.Input), Output);
         goto MainEnd;
     }
 
     //
-    // Do it, sort the arrays.
-    //
-
-    qsort(InputLines.Data, InputLines.Size, sizeof(PVOID), SortCompareLines);
-
-    //
-    // Write all the lines to the output.
+    // This is the real sort, not merge or check.
     //
 
-    PreviousLine = NULL;
-    for (LineIndex = 0; LineIndex < InputLines.Size; LineIndex += 1) {
-        InputLine = InputLines.Data[LineIndex];
-
-        //
-        // If the unique flag is off, this is the first line, or the lines
-        // aren't equal then print the line.
-        //
-
-        if (((Context.Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousLine == NULL) ||
-            (SortCompareLines(&PreviousLine, &InputLine) != 0)) {
-
-            fprintf(Output, "%s\n", InputLine->Data);
-        }
-
-        PreviousLine = InputLine;
-    }
-
-    Status = 0;
+    Status = SortSortInputs(&Context, Output);
 
 MainEnd:
-    SortContext = NULL;
     if ((Output != NULL) && (Output != stdout)) {
         fclose(Output);
     }
@@ -810,12 +1088,13 @@ Return Value:
                      (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
 
     SortDestroyArray(&(Context.Key), free);
-    if (InputString.Data != NULL) {
-        free(InputString.Data);
-    }
+    SortRunUpdateInProgress = TRUE;
+    SortDestroyArray(&(Context.Run),
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyRunFile);
 
-    SortDestroyArray(&InputLines,
-                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyString);
+    SortHandleSignals(FALSE);
+    SortEndRunUpdate();
+    SortContext = NULL;
 
     if ((Status != 0) && (Status != 1)) {
         SwPrintError(Status, NULL, "Sort exiting abnormally");
@@ -922,7 +1201,7 @@ Return Value:
 }
 
 INT
-SortMergeSortedFiles (
+SortSortInputs (
     PSORT_CONTEXT Context,
     FILE *Output
     )
@@ -931,7 +1210,10 @@ SortMergeSortedFiles (
 
 Routine Description:
 
-    This routine merges several files that are already in order.
+    This routine sorts all the inputs into the output. Lines are gathered
+    until the buffer size is reached, at which point they're sorted and
+    spilled to a temporary file. If everything fits in the buffer, the lines
+    are written straight to the output. Otherwise the runs are merged.
 
 Arguments:
 
@@ -949,122 +1231,1274 @@ Return Value:
 
 {
 
-    INT Comparison;
+    UINTN BufferUsed;
     PSORT_INPUT Input;
     UINTN InputIndex;
-    PSORT_STRING PreviousWinner;
+    PSORT_STRING Line;
+    UINTN LineSize;
+    PVOID NewBuffer;
+    UINTN NewCapacity;
+    UINTN RecordCapacity;
+    UINTN RecordCount;
+    UINTN RecordIndex;
+    PSORT_RECORD Records;
     INT Status;
-    PSORT_INPUT Winner;
     SORT_STRING WorkingBuffer;
 
-    PreviousWinner = NULL;
+    BufferUsed = 0;
+    Line = NULL;
+    RecordCapacity = 0;
+    RecordCount = 0;
+    Records = NULL;
     memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
-
-    //
-    // Prime all the inputs by reading their first lines.
-    //
-
     for (InputIndex = 0; InputIndex < Context->Input.Size; InputIndex += 1) {
         Input = Context->Input.Data[InputIndex];
-        Status = SortReadLine(Context,
-                              Input,
-                              &WorkingBuffer,
-                              &(Input->Line));
-
-        if (Status != 0) {
-            SwPrintError(Status, NULL, "Failed to read file");
-            goto MergeSortedFilesEnd;
-        }
-    }
-
-    //
-    // Loop getting the winning line until all files are drained.
-    //
+        while (TRUE) {
+            Status = SortReadLine(Context, Input, &WorkingBuffer, &Line);
+            if (Status != 0) {
+                SwPrintError(Status, NULL, "Failed to read line");
+                goto SortInputsEnd;
+            }
 
-    while (TRUE) {
-        Winner = NULL;
-        for (InputIndex = 0;
-             InputIndex < Context->Input.Size;
-             InputIndex += 1) {
-
-            Input = Context->Input.Data[InputIndex];
-            if (Input->Line == NULL) {
-                continue;
+            if (Line == NULL) {
+                break;
             }
 
-            if (Winner == NULL) {
-                Winner = Input;
+            //
+            // If the buffer is full, sort what's there and spill it out to a
+            // temporary file to make room.
+            //
 
-            } else {
+            LineSize = Line->Capacity + SORT_LINE_OVERHEAD;
+            if ((RecordCount != 0) &&
+                (BufferUsed + LineSize > Context->BufferSize)) {
 
-                //
-                // If this input's line is less than the current winner, set it
-                // to the new winner.
-                //
+                Status = SortSpillRun(Context, Records, RecordCount);
+                for (RecordIndex = 0;
+                     RecordIndex < RecordCount;
+                     RecordIndex += 1) {
+
+                    SortDestroyString(Records[RecordIndex].Line);
+                }
 
-                Comparison = SortCompareLines(&(Input->Line), &(Winner->Line));
-                if (Comparison < 0) {
-                    Winner = Input;
+                RecordCount = 0;
+                BufferUsed = 0;
+                if (Status != 0) {
+                    goto SortInputsEnd;
                 }
             }
-        }
 
-        //
-        // If there is no winner, then all files must be drained. Stop.
-        //
+            if (RecordCount == RecordCapacity) {
+                if (RecordCapacity == 0) {
+                    NewCapacity = SORT_INITIAL_ELEMENT_COUNT;
 
-        if (Winner == NULL) {
-            break;
+                } else {
+                    NewCapacity = RecordCapacity * 2;
+                }
+
+                NewBuffer = realloc(Records, NewCapacity * sizeof(SORT_RECORD));
+                if (NewBuffer == NULL) {
+                    Status = ENOMEM;
+                    goto SortInputsEnd;
+                }
+
+                Records = NewBuffer;
+                RecordCapacity = NewCapacity;
+            }
+
+            Records[RecordCount].Prefix = SortGetKeyPrefix(Context, Line);
+            Records[RecordCount].Line = Line;
+            RecordCount += 1;
+            BufferUsed += LineSize;
+            Line = NULL;
+        }
+    }
+
+    //
+    // If nothing was spilled, then this is the only run. Sort it and write it
+    // out directly.
+    //
+
+    if (Context->Run.Size == 0) {
+        SortSortRecords(Context, Records, RecordCount);
+        Status = SortWriteRecords(Context, Records, RecordCount, Output);
+        goto SortInputsEnd;
+    }
+
+    //
+    // Spill the last run as well and merge all the runs together.
+    //
+
+    if (RecordCount != 0) {
+        Status = SortSpillRun(Context, Records, RecordCount);
+        if (Status != 0) {
+            goto SortInputsEnd;
+        }
+    }
+
+    Status = SortMergeRuns(Context, Output);
+
+SortInputsEnd:
+    if (Line != NULL) {
+        SortDestroyString(Line);
+    }
+
+    for (RecordIndex = 0; RecordIndex < RecordCount; RecordIndex += 1) {
+        SortDestroyString(Records[RecordIndex].Line);
+    }
+
+    if (Records != NULL) {
+        free(Records);
+    }
+
+    if (WorkingBuffer.Data != NULL) {
+        free(WorkingBuffer.Data);
+    }
+
+    return Status;
+}
+
+INT
+SortSpillRun (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts the given records and writes them out to a new
+    temporary file, which is added to the list of runs.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Records - Supplies the records to sort and write.
+
+    Count - Supplies the number of records.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    FILE *File;
+    INT Status;
+
+    SortSortRecords(Context, Records, Count);
+    Status = SortCreateRunFile(Context, &File);
+    if (Status != 0) {
+        return Status;
+    }
+
+    Status = SortWriteRecords(Context, Records, Count, File);
+    if ((fclose(File) != 0) && (Status == 0)) {
+        Status = errno;
+    }
+
+    if (Status != 0) {
+        SwPrintError(Status,
+                     Context->Run.Data[Context->Run.Size - 1],
+                     "Failed to write temporary file");
+    }
+
+    return Status;
+}
+
+INT
+SortCreateRunFile (
+    PSORT_CONTEXT Context,
+    FILE **File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new temporary file to hold a sorted run, and adds
+    its path to the end of the list of runs.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    File - Supplies a pointer where the file opened for writing will be
+        returned on success.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    UINTN Attempt;
+    INT Descriptor;
+    FILE *NewFile;
+    PSTR Path;
+    UINTN PathSize;
+    INT Status;
+
+    *File = NULL;
+    Descriptor = -1;
+    PathSize = strlen(Context->TemporaryDirectory) + SORT_RUN_NAME_SIZE;
+    Path = malloc(PathSize);
+    if (Path == NULL) {
+        Status = ENOMEM;
+        goto CreateRunFileEnd;
+    }
+
+    //
+    // Make sure the run files get cleaned up if the process is killed, for
+    // instance by a broken pipe when the output is cut short. Signals wait
+    // until the new file is on the list of runs.
+    //
+
+    SortHandleSignals(TRUE);
+    SortRunUpdateInProgress = TRUE;
+
+    Status = EEXIST;
+    for (Attempt = 0; Attempt < SORT_RUN_CREATE_ATTEMPTS; Attempt += 1) {
+        snprintf(Path,
+                 PathSize,
+                 "%s/sort%lu.%lu",
+                 Context->TemporaryDirectory,
+                 (unsigned long)SwGetProcessId(),
+                 (unsigned long)Context->RunCounter);
+
+        Context->RunCounter += 1;
+        Descriptor = SwOpen(Path,
+                            O_RDWR | O_CREAT | O_EXCL | O_BINARY,
+                            SORT_RUN_PERMISSIONS);
+
+        if (Descriptor >= 0) {
+            Status = 0;
+            break;
+        }
+
+        Status = errno;
+        if (Status != EEXIST) {
+            break;
+        }
+    }
+
+    if (Status != 0) {
+        SwPrintError(Status, Path, "Failed to create temporary file");
+        goto CreateRunFileEnd;
+    }
+
+    Status = SortArrayAddElement(&(Context->Run), Path);
+    if (Status != 0) {
+        SwUnlink(Path);
+        goto CreateRunFileEnd;
+    }
+
+    Path = NULL;
+    NewFile = fdopen(Descriptor, "wb");
+    if (NewFile == NULL) {
+        Status = errno;
+        goto CreateRunFileEnd;
+    }
+
+    Descriptor = -1;
+    *File = NewFile;
+
+CreateRunFileEnd:
+    if (Descriptor >= 0) {
+        close(Descriptor);
+    }
+
+    if (Path != NULL) {
+        free(Path);
+    }
+
+    SortEndRunUpdate();
+    return Status;
+}
+
+VOID
+SortDestroyRunFile (
+    PSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine deletes a temporary run file and frees its path.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the run file.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    SwUnlink(Path);
+    free(Path);
+    return;
+}
+
+VOID
+SortHandleSignals (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine installs or removes the signal handlers that delete the
+    temporary run files when the process is terminated. Signals that were
+    being ignored stay ignored.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to install the handlers
+        (TRUE) or restore the original ones (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Count;
+    UINTN Index;
+    void *OriginalHandler;
+
+    if (Enable == SortSignalsHandled) {
+        return;
+    }
+
+    Count = sizeof(SortCleanupSignals) / sizeof(SortCleanupSignals[0]);
+    for (Index = 0; Index < Count; Index += 1) {
+        if (Enable != FALSE) {
+            OriginalHandler = signal(SortCleanupSignals[Index],
+                                     SortSignalHandler);
+
+            if (OriginalHandler == SIG_IGN) {
+                signal(SortCleanupSignals[Index], SIG_IGN);
+            }
+
+            SortOriginalSignalHandlers[Index] = OriginalHandler;
+
+        } else if (SortOriginalSignalHandlers[Index] != SIG_ERR) {
+            signal(SortCleanupSignals[Index],
+                   SortOriginalSignalHandlers[Index]);
+        }
+    }
+
+    SortSignalsHandled = Enable;
+    return;
+}
+
+VOID
+SortSignalHandler (
+    int Signal
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles a signal that terminates the process by deleting
+    all the temporary run files and then terminating the process with the
+    same signal. If the list of runs is being changed, the signal is put off
+    until the change is done.
+
+Arguments:
+
+    Signal - Supplies the signal number that fired.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+    PSORT_ARRAY Runs;
+
+    if (SortRunUpdateInProgress != FALSE) {
+        SortPendingSignal = Signal;
+        return;
+    }
+
+    if (SortContext != NULL) {
+        Runs = &(SortContext->Run);
+        for (Index = 0; Index < Runs->Size; Index += 1) {
+            SwUnlink(Runs->Data[Index]);
+        }
+    }
+
+    signal(Signal, SIG_DFL);
+    raise(Signal);
+    return;
+}
+
+VOID
+SortEndRunUpdate (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks the end of a change to the list of runs, and handles
+    any signal that arrived during the change.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    int Signal;
+
+    SortRunUpdateInProgress = FALSE;
+    Signal = SortPendingSignal;
+    if (Signal != 0) {
+        SortPendingSignal = 0;
+        SortSignalHandler(Signal);
+    }
+
+    return;
+}
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges all the spilled runs into the output. If there are
+    too many runs to open at once, the oldest runs are merged into new runs
+    until few enough remain.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN Count;
+    FILE *Destination;
+    PSORT_INPUT Input;
+    SORT_ARRAY Inputs;
+    UINTN RunIndex;
+    INT Status;
+
+    Destination = NULL;
+    Input = NULL;
+    memset(&Inputs, 0, sizeof(SORT_ARRAY));
+    while (TRUE) {
+        Count = Context->Run.Size;
+        if (Count > SORT_MERGE_FAN_IN) {
+            Count = SORT_MERGE_FAN_IN;
+        }
+
+        for (RunIndex = 0; RunIndex < Count; RunIndex += 1) {
+            Input = malloc(sizeof(SORT_INPUT));
+            if (Input == NULL) {
+                Status = ENOMEM;
+                goto MergeRunsEnd;
+            }
+
+            memset(Input, 0, sizeof(SORT_INPUT));
+            Input->File = fopen(Context->Run.Data[RunIndex], "rb");
+            if (Input->File == NULL) {
+                Status = errno;
+                SwPrintError(Status,
+                             Context->Run.Data[RunIndex],
+                             "Failed to open temporary file");
+
+                goto MergeRunsEnd;
+            }
+
+            Status = SortArrayAddElement(&Inputs, Input);
+            if (Status != 0) {
+                goto MergeRunsEnd;
+            }
+
+            Input = NULL;
+        }
+
+        //
+        // The last merge goes to the output. Earlier ones go to a new run,
+        // which lands at the end of the list.
+        //
+
+        if (Count == Context->Run.Size) {
+            Status = SortMergeSortedFiles(Context, &Inputs, Output);
+            break;
+        }
+
+        Status = SortCreateRunFile(Context, &Destination);
+        if (Status != 0) {
+            goto MergeRunsEnd;
+        }
+
+        Status = SortMergeSortedFiles(Context, &Inputs, Destination);
+        if ((fclose(Destination) != 0) && (Status == 0)) {
+            Status = errno;
+        }
+
+        Destination = NULL;
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to write temporary file");
+            goto MergeRunsEnd;
+        }
+
+        //
+        // Close and delete the runs that were just merged.
+        //
+
+        SortDestroyArray(&Inputs,
+                         (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
+
+        SortRunUpdateInProgress = TRUE;
+        for (RunIndex = 0; RunIndex < Count; RunIndex += 1) {
+            SortDestroyRunFile(Context->Run.Data[RunIndex]);
+        }
+
+        memmove(Context->Run.Data,
+                Context->Run.Data + Count,
+                (Context->Run.Size - Count) * sizeof(PVOID));
+
+        Context->Run.Size -= Count;
+        SortEndRunUpdate();
+    }
+
+MergeRunsEnd:
+    if (Input != NULL) {
+        SortDestroyInput(Input);
+    }
+
+    SortDestroyArray(&Inputs,
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
+
+    return Status;
+}
+
+VOID
+SortSortRecords (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of records. Large arrays are split into
+    chunks that are sorted on separate threads, and then merged pairwise, also
+    in parallel. Small arrays, or any failure to get resources for the
+    parallel sort, fall back to sorting on this thread.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Records - Supplies the records to sort.
+
+    Count - Supplies the number of records.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN ChunkCount;
+    UINTN ChunkSize;
+    PSORT_RECORD Destination;
+    UINTN Index;
+    UINTN LeftCount;
+    PSORT_RECORD Scratch;
+    PSORT_RECORD Source;
+    UINTN Start;
+    PSORT_RECORD Swap;
+    UINTN ThreadCount;
+    UINTN TotalCount;
+    PSORT_WORK Work;
+    UINTN WorkCount;
+
+    Scratch = NULL;
+    Work = NULL;
+    ThreadCount = Count / SORT_MINIMUM_THREAD_LINES;
+    if (ThreadCount > Context->ThreadCount) {
+        ThreadCount = Context->ThreadCount;
+    }
+
+    if (ThreadCount > 1) {
+        Scratch = malloc(Count * sizeof(SORT_RECORD));
+        Work = malloc(ThreadCount * sizeof(SORT_WORK));
+    }
+
+    if ((Scratch == NULL) || (Work == NULL)) {
+        qsort(Records, Count, sizeof(SORT_RECORD), SortCompareRecords);
+        goto SortRecordsEnd;
+    }
+
+    //
+    // Sort each chunk in place.
+    //
+
+    ChunkSize = Count / ThreadCount;
+    for (Index = 0; Index < ThreadCount; Index += 1) {
+        Work[Index].Source = Records + (Index * ChunkSize);
+        Work[Index].Destination = NULL;
+        Work[Index].Start = Index * ChunkSize;
+        Work[Index].Count = ChunkSize;
+        Work[Index].LeftCount = 0;
+    }
+
+    Work[ThreadCount - 1].Count = Count - Work[ThreadCount - 1].Start;
+    SortRunWork(Work, ThreadCount);
+
+    //
+    // Merge pairs of adjacent chunks back and forth between the records and
+    // the scratch buffer until there's only one left.
+    //
+
+    ChunkCount = ThreadCount;
+    Source = Records;
+    Destination = Scratch;
+    while (ChunkCount > 1) {
+        WorkCount = 0;
+        for (Index = 0; Index < ChunkCount; Index += 2) {
+            Start = Work[Index].Start;
+            LeftCount = Work[Index].Count;
+            TotalCount = LeftCount;
+            if (Index + 1 < ChunkCount) {
+                TotalCount += Work[Index + 1].Count;
+            }
+
+            Work[WorkCount].Source = Source + Start;
+            Work[WorkCount].Destination = Destination + Start;
+            Work[WorkCount].Start = Start;
+            Work[WorkCount].Count = TotalCount;
+            Work[WorkCount].LeftCount = LeftCount;
+            WorkCount += 1;
+        }
+
+        SortRunWork(Work, WorkCount);
+        ChunkCount = WorkCount;
+        Swap = Source;
+        Source = Destination;
+        Destination = Swap;
+    }
+
+    if (Source != Records) {
+        memcpy(Records, Source, Count * sizeof(SORT_RECORD));
+    }
+
+SortRecordsEnd:
+    if (Scratch != NULL) {
+        free(Scratch);
+    }
+
+    if (Work != NULL) {
+        free(Work);
+    }
+
+    return;
+}
+
+VOID
+SortRunWork (
+    PSORT_WORK Work,
+    UINTN WorkCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs an array of sort work items in parallel, and waits
+    for them all to finish. The first item runs on the current thread, as do
+    any items a thread could not be created for.
+
+Arguments:
+
+    Work - Supplies the array of work items.
+
+    WorkCount - Supplies the number of elements in the array.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+    INT Status;
+
+    for (Index = 1; Index < WorkCount; Index += 1) {
+        Work[Index].Started = FALSE;
+        Status = pthread_create(&(Work[Index].Thread),
+                                NULL,
+                                SortWorkThread,
+                                &(Work[Index]));
+
+        if (Status == 0) {
+            Work[Index].Started = TRUE;
+        }
+    }
+
+    SortWorkThread(&(Work[0]));
+    for (Index = 1; Index < WorkCount; Index += 1) {
+        if (Work[Index].Started != FALSE) {
+            pthread_join(Work[Index].Thread, NULL);
+
+        } else {
+            SortWorkThread(&(Work[Index]));
+        }
+    }
+
+    return;
+}
+
+PVOID
+SortWorkThread (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a single sort work item, either sorting a chunk in
+    place or merging two adjacent sorted chunks into the destination.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the work item.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PSORT_RECORD Destination;
+    PSORT_RECORD Left;
+    PSORT_RECORD LeftEnd;
+    PSORT_RECORD Right;
+    PSORT_RECORD RightEnd;
+    PSORT_WORK Work;
+
+    Work = Parameter;
+    if (Work->Destination == NULL) {
+        qsort(Work->Source,
+              Work->Count,
+              sizeof(SORT_RECORD),
+              SortCompareRecords);
+
+        return NULL;
+    }
+
+    //
+    // Take from the right side only when it is strictly less, so equal lines
+    // keep their relative order.
+    //
+
+    Destination = Work->Destination;
+    Left = Work->Source;
+    LeftEnd = Left + Work->LeftCount;
+    Right = LeftEnd;
+    RightEnd = Work->Source + Work->Count;
+    while ((Left < LeftEnd) && (Right < RightEnd)) {
+        if (SortCompareRecords(Right, Left) < 0) {
+            *Destination = *Right;
+            Right += 1;
+
+        } else {
+            *Destination = *Left;
+            Left += 1;
+        }
+
+        Destination += 1;
+    }
+
+    if (Left < LeftEnd) {
+        memcpy(Destination, Left, (LeftEnd - Left) * sizeof(SORT_RECORD));
+
+    } else if (Right < RightEnd) {
+        memcpy(Destination, Right, (RightEnd - Right) * sizeof(SORT_RECORD));
+    }
+
+    return NULL;
+}
+
+INT
+SortWriteRecords (
+    PSORT_CONTEXT Context,
+    PSORT_RECORD Records,
+    UINTN Count,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes sorted records out to a file, dropping duplicates if
+    the unique option is set.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Records - Supplies the sorted records to write.
+
+    Count - Supplies the number of records.
+
+    Output - Supplies a pointer to the file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number if the file could not be written.
+
+--*/
+
+{
+
+    UINTN Index;
+
+    for (Index = 0; Index < Count; Index += 1) {
+
+        //
+        // If the unique flag is off, this is the first line, or the lines
+        // aren't equal then print the line.
+        //
+
+        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
+            (Index == 0) ||
+            (SortCompareRecords(&(Records[Index - 1]), &(Records[Index])) !=
+             0)) {
+
+            fputs(Records[Index].Line->Data, Output);
+            fputc('\n', Output);
+        }
+    }
+
+    if (ferror(Output) != 0) {
+        return errno;
+    }
+
+    return 0;
+}
+
+INT
+SortMergeSortedFiles (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges several files that are already in order. The inputs
+    are kept in a binary heap ordered by their current line, so each line
+    out costs a logarithmic number of comparisons in the number of inputs.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Inputs - Supplies a pointer to the array of inputs to merge.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSORT_INPUT *Heap;
+    UINTN HeapSize;
+    PSORT_INPUT Input;
+    UINTN InputIndex;
+    SORT_RECORD PreviousWinner;
+    INT Status;
+    PSORT_INPUT Winner;
+    SORT_STRING WorkingBuffer;
+
+    HeapSize = 0;
+    memset(&PreviousWinner, 0, sizeof(SORT_RECORD));
+    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    Heap = malloc((Inputs->Size + 1) * sizeof(PSORT_INPUT));
+    if (Heap == NULL) {
+        Status = ENOMEM;
+        goto MergeSortedFilesEnd;
+    }
+
+    //
+    // Prime all the inputs by reading their first lines, and put the ones
+    // that aren't empty in the heap.
+    //
+
+    for (InputIndex = 0; InputIndex < Inputs->Size; InputIndex += 1) {
+        Input = Inputs->Data[InputIndex];
+        Status = SortReadLine(Context,
+                              Input,
+                              &WorkingBuffer,
+                              &(Input->Record.Line));
+
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to read file");
+            goto MergeSortedFilesEnd;
+        }
+
+        if (Input->Record.Line != NULL) {
+            Input->Record.Prefix = SortGetKeyPrefix(Context,
+                                                    Input->Record.Line);
+
+            Heap[HeapSize] = Input;
+            HeapSize += 1;
         }
+    }
+
+    for (InputIndex = HeapSize / 2; InputIndex > 0; InputIndex -= 1) {
+        SortSiftDown(Heap, HeapSize, InputIndex - 1);
+    }
+
+    //
+    // Loop taking the winning line off the top of the heap until all files
+    // are drained.
+    //
+
+    while (HeapSize != 0) {
+        Winner = Heap[0];
 
         //
         // Print the line.
         //
 
         if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousWinner == NULL) ||
-            (SortCompareLines(&(Winner->Line), &PreviousWinner) != 0)) {
+            (PreviousWinner.Line == NULL) ||
+            (SortCompareRecords(&(Winner->Record), &PreviousWinner) != 0)) {
 
-            fprintf(Output, "%s\n", Winner->Line->Data);
+            fputs(Winner->Record.Line->Data, Output);
+            fputc('\n', Output);
         }
 
         //
         // Set the new previous winner, and read a new line from that winning
-        // file.
+        // file. If the file is drained, replace it with the last element of
+        // the heap.
         //
 
-        if (PreviousWinner != NULL) {
-            SortDestroyString(PreviousWinner);
+        if (PreviousWinner.Line != NULL) {
+            SortDestroyString(PreviousWinner.Line);
         }
 
-        PreviousWinner = Winner->Line;
-        if (Winner->Line != NULL) {
-            Status = SortReadLine(Context,
-                                  Winner,
-                                  &WorkingBuffer,
-                                  &(Winner->Line));
+        PreviousWinner = Winner->Record;
+        Status = SortReadLine(Context,
+                              Winner,
+                              &WorkingBuffer,
+                              &(Winner->Record.Line));
+
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to read file");
+            goto MergeSortedFilesEnd;
+        }
 
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read file");
-                goto MergeSortedFilesEnd;
-            }
+        if (Winner->Record.Line != NULL) {
+            Winner->Record.Prefix = SortGetKeyPrefix(Context,
+                                                     Winner->Record.Line);
+
+        } else {
+            HeapSize -= 1;
+            Heap[0] = Heap[HeapSize];
         }
+
+        SortSiftDown(Heap, HeapSize, 0);
     }
 
     Status = 0;
+    if (ferror(Output) != 0) {
+        Status = errno;
+    }
 
 MergeSortedFilesEnd:
-    if (PreviousWinner != NULL) {
-        SortDestroyString(PreviousWinner);
+    if (PreviousWinner.Line != NULL) {
+        SortDestroyString(PreviousWinner.Line);
     }
 
     if (WorkingBuffer.Data != NULL) {
         free(WorkingBuffer.Data);
     }
 
+    if (Heap != NULL) {
+        free(Heap);
+    }
+
     return Status;
 }
 
+VOID
+SortSiftDown (
+    PSORT_INPUT *Heap,
+    UINTN Count,
+    UINTN Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves an element of the merge heap down until neither of its
+    children has a smaller line.
+
+Arguments:
+
+    Heap - Supplies the heap of inputs.
+
+    Count - Supplies the number of elements in the heap.
+
+    Index - Supplies the index of the element to move down.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Child;
+    PSORT_INPUT Swap;
+
+    while (TRUE) {
+        Child = (Index * 2) + 1;
+        if (Child >= Count) {
+            break;
+        }
+
+        if ((Child + 1 < Count) &&
+            (SortCompareRecords(&(Heap[Child + 1]->Record),
+                                &(Heap[Child]->Record)) < 0)) {
+
+            Child += 1;
+        }
+
+        if (SortCompareRecords(&(Heap[Child]->Record),
+                               &(Heap[Index]->Record)) >= 0) {
+
+            break;
+        }
+
+        Swap = Heap[Index];
+        Heap[Index] = Heap[Child];
+        Heap[Child] = Swap;
+        Index = Child;
+    }
+
+    return;
+}
+
+INT
+SortCompareRecords (
+    const VOID *LeftPointer,
+    const VOID *RightPointer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two sort records. The key prefixes are compared
+    first, and the full lines are only compared if the prefixes match.
+
+Arguments:
+
+    LeftPointer - Supplies a pointer to the left record of the comparison.
+
+    RightPointer - Supplies a pointer to the right record of the comparison.
+
+Return Value:
+
+    1 if Left > Right.
+
+    0 if Left == Right.
+
+    -1 if Left < Right.
+
+--*/
+
+{
+
+    PSORT_RECORD Left;
+    INT Result;
+    PSORT_RECORD Right;
+
+    Left = (PSORT_RECORD)LeftPointer;
+    Right = (PSORT_RECORD)RightPointer;
+    if (Left->Prefix != Right->Prefix) {
+        Result = 1;
+        if (Left->Prefix < Right->Prefix) {
+            Result = -1;
+        }
+
+        if (SortContext->ReversePrefix != FALSE) {
+            Result = -Result;
+        }
+
+        return Result;
+    }
+
+    return SortCompareLines(&(Left->Line), &(Right->Line));
+}
+
+ULONGLONG
+SortGetKeyPrefix (
+    PSORT_CONTEXT Context,
+    PSORT_STRING Line
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the prefix of the first key of a line. This mirrors
+    the first key comparison in the compare lines routine, so lines whose
+    prefixes differ compare the same way their prefixes do.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Line - Supplies a pointer to the line.
+
+Return Value:
+
+    Returns the key prefix, or 0 if prefixes are not in use.
+
+--*/
+
+{
+
+    CHAR Character;
+    ULONG EndIndex;
+    UINTN Index;
+    PSORT_KEY Key;
+    ULONG Options;
+    ULONGLONG Prefix;
+    ULONG StartIndex;
+
+    if (Context->UsePrefix == FALSE) {
+        return 0;
+    }
+
+    Key = Context->Key.Data[0];
+    Options = Key->StartOptions | Key->EndOptions;
+    SortGetFieldOffset(Line,
+                       Context->Separator,
+                       Key->StartField,
+                       Key->StartCharacter,
+                       &StartIndex);
+
+    SortGetFieldOffset(Line,
+                       Context->Separator,
+                       Key->EndField,
+                       Key->EndCharacter,
+                       &EndIndex);
+
+    if ((Options & SORT_OPTION_IGNORE_LEADING_BLANKS) != 0) {
+        while ((StartIndex < EndIndex) && (isblank(Line->Data[StartIndex]))) {
+            StartIndex += 1;
+        }
+    }
+
+    if ((Options & SORT_OPTION_COMPARE_NUMERICALLY) != 0) {
+        Prefix = (LONGLONG)SortStringToLong(Line, Options, StartIndex);
+        return Prefix ^ SORT_PREFIX_SIGN_BIT;
+    }
+
+    //
+    // Pack the first characters in big endian order, padding with the same
+    // zero the comparison uses past the end of a key. Subtracting the minimum
+    // character value preserves the signedness of the character comparison.
+    //
+
+    Prefix = 0;
+    for (Index = 0; Index < sizeof(ULONGLONG); Index += 1) {
+        Character = 0;
+        if (StartIndex < EndIndex) {
+            Character = Line->Data[StartIndex];
+            StartIndex += 1;
+        }
+
+        if ((Options & SORT_OPTION_UPPERCASE_EVERYTHING) != 0) {
+            Character = toupper(Character);
+        }
+
+        Prefix = (Prefix << BITS_PER_BYTE) | (UCHAR)(Character - CHAR_MIN);
+    }
+
+    return Prefix;
+}
+
 INT
 SortCompareLines (
     const VOID *LeftPointer,
@@ -1592,6 +3026,87 @@ Return Value:
     return Status;
 }
 
+INT
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine parses a buffer size argument. The number is in kilobytes
+    unless followed by a suffix of b for bytes, or K, M, or G.
+
+Arguments:
+
+    Argument - Supplies a pointer to the size argument.
+
+    Size - Supplies a pointer where the size in bytes will be returned.
+
+Return Value:
+
+    0 on success.
+
+    EINVAL if the argument is not a valid size.
+
+--*/
+
+{
+
+    PSTR AfterScan;
+    ULONGLONG Multiplier;
+    ULONGLONG Value;
+
+    if (!isdigit(*Argument)) {
+        return EINVAL;
+    }
+
+    Value = strtoull(Argument, &AfterScan, 10);
+    switch (*AfterScan) {
+    case 'b':
+        Multiplier = 1;
+        break;
+
+    case '\0':
+    case 'k':
+    case 'K':
+        Multiplier = _1KB;
+        break;
+
+    case 'm':
+    case 'M':
+        Multiplier = _1MB;
+        break;
+
+    case 'g':
+    case 'G':
+        Multiplier = _1GB;
+        break;
+
+    default:
+        return EINVAL;
+    }
+
+    if ((*AfterScan != '\0') && (*(AfterScan + 1) != '\0')) {
+        return EINVAL;
+    }
+
+    //
+    // Clip sizes that don't fit in the address space.
+    //
+
+    if (Value > (MAX_UINTN / Multiplier)) {
+        *Size = MAX_UINTN;
+
+    } else {
+        *Size = Value * Multiplier;
+    }
+
+    return 0;
+}
+
 VOID
 SortScanKeyFlags (
     PSTR *Argument,
@@ -1942,8 +3457,8 @@ Return Value:
         fclose(Input->File);
     }
 
-    if (Input->Line != NULL) {
-        SortDestroyString(Input->Line);
+    if (Input->Record.Line != NULL) {
+        SortDestroyString(Input->Record.Line);
     }
 
     free(Input);
@@ -43,6 +43,14 @@ Module Name:
 
 #define SWISS_APP_HIDDEN 0x00000002
 
+//
+// Set this flag if the command can be run directly inside the shell's process.
+// Such commands must not call exit, must free everything they allocate, and
+// must not depend on global state like getopt's that persists between runs.
+//
+
+#define SWISS_APP_IN_PROCESS 0x00000004
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -76,6 +76,14 @@ SwpCopyRegularFile (
     struct stat *DestinationStat
     );
 
+INT
+SwpCopyFileRanges (
+    int SourceFile,
+    off_t SourceSize,
+    int DestinationFile,
+    off_t *CopiedSize
+    );
+
 INT
 SwpCopyNonRegularFile (
     ULONG Options,
@@ -614,6 +622,7 @@ Return Value:
     ssize_t BytesRead;
     ssize_t BytesWritten;
     int CloseStatus;
+    off_t CopiedSize;
     mode_t CreatePermissions;
     int DestinationFile;
     PSTR QuotedDestination;
@@ -711,6 +720,45 @@ Return Value:
         goto CopyRegularFileEnd;
     }
 
+    //
+    // Try to have the operating system copy the data directly, which also
+    // preserves any holes in the source. Files that claim to be empty (like
+    // many in /proc) may not be, so just read those. Either way, reading and
+    // writing picks up from wherever the direct copy left off, which also
+    // catches anything the source gained during the copy. Looking for holes
+    // moves the source's file position, so always put it back.
+    //
+
+    if (SourceStat->st_size != 0) {
+        Result = SwpCopyFileRanges(SourceFile,
+                                   SourceStat->st_size,
+                                   DestinationFile,
+                                   &CopiedSize);
+
+        if (Result == ENOSYS) {
+            CopiedSize = 0;
+            Result = 0;
+
+        } else if (Result != 0) {
+            SwPrintError(Result, Destination, "Failed to write to");
+            goto CopyRegularFileEnd;
+        }
+
+        if (lseek(SourceFile, CopiedSize, SEEK_SET) != CopiedSize) {
+            Result = errno;
+            SwPrintError(Result, Source, "Cannot seek");
+            goto CopyRegularFileEnd;
+        }
+
+        if ((CopiedSize != 0) &&
+            (lseek(DestinationFile, CopiedSize, SEEK_SET) != CopiedSize)) {
+
+            Result = errno;
+            SwPrintError(Result, Destination, "Cannot seek");
+            goto CopyRegularFileEnd;
+        }
+    }
+
     //
     // Repeatedly copy blocks from the source file to the destination file.
     //
@@ -802,6 +850,135 @@ Return Value:
     return Result;
 }
 
+INT
+SwpCopyFileRanges (
+    int SourceFile,
+    off_t SourceSize,
+    int DestinationFile,
+    off_t *CopiedSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine has the operating system copy the contents of one regular
+    file to another. Only the regions of the source that contain data are
+    copied, so holes in the source remain holes in the destination.
+
+Arguments:
+
+    SourceFile - Supplies the open source file descriptor.
+
+    SourceSize - Supplies the size of the source file.
+
+    DestinationFile - Supplies the open destination file descriptor, which is
+        expected to be empty.
+
+    CopiedSize - Supplies a pointer where the offset the copy got up to will be
+        returned on success. The file positions of the descriptors are not
+        moved. Anything the source gained beyond its original size still
+        needs to be copied by the caller.
+
+Return Value:
+
+    0 on success.
+
+    ENOSYS if the operating system cannot copy between these files. Nothing
+    has been written to the destination in this case.
+
+    Returns an error number on other failures.
+
+--*/
+
+{
+
+    ssize_t BytesCopied;
+    BOOL Copied;
+    off_t DataEnd;
+    off_t DataStart;
+    off_t DestinationOffset;
+    off_t Offset;
+
+    Copied = FALSE;
+    *CopiedSize = 0;
+    Offset = 0;
+    while (Offset < SourceSize) {
+
+        //
+        // Find the next region of data. If the system doesn't know where the
+        // holes are, treat the whole rest of the file as data.
+        //
+
+        DataEnd = SourceSize;
+        DataStart = SwSeekData(SourceFile, Offset, FALSE);
+        if (DataStart < 0) {
+            if (errno == ENXIO) {
+                break;
+
+            } else if (errno != ENOSYS) {
+                return errno;
+            }
+
+            DataStart = Offset;
+
+        } else {
+            DataEnd = SwSeekData(SourceFile, DataStart, TRUE);
+            if ((DataEnd < 0) || (DataEnd > SourceSize)) {
+                DataEnd = SourceSize;
+            }
+        }
+
+        Offset = DataStart;
+        DestinationOffset = DataStart;
+        while (Offset < DataEnd) {
+            BytesCopied = SwCopyFileRange(SourceFile,
+                                          &Offset,
+                                          DestinationFile,
+                                          &DestinationOffset,
+                                          DataEnd - Offset);
+
+            if (BytesCopied < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                if ((errno == ENOSYS) && (Copied != FALSE)) {
+                    return EIO;
+                }
+
+                return errno;
+            }
+
+            //
+            // Stop if the source got shorter out from under the copy.
+            //
+
+            if (BytesCopied == 0) {
+                *CopiedSize = Offset;
+                return 0;
+            }
+
+            Copied = TRUE;
+        }
+    }
+
+    //
+    // Extend the destination over any hole at the end of the source.
+    //
+
+    if (Offset < SourceSize) {
+        if (ftruncate(DestinationFile, SourceSize) != 0) {
+            return errno;
+        }
+
+        Offset = SourceSize;
+    }
+
+    *CopiedSize = Offset;
+    return 0;
+}
+
 INT
 SwpCopyNonRegularFile (
     ULONG Options,
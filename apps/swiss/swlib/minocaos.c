@@ -32,6 +32,7 @@ Module Name:
 
 #include <assert.h>
 #include <errno.h>
+#include <stdio.h>
 #include <unistd.h>
 
 #include <minoca/lib/minocaos.h>
@@ -284,6 +285,114 @@ Return Value:
     return closefrom(Descriptor);
 }
 
+ssize_t
+SwCopyFileRange (
+    int InputDescriptor,
+    off_t *InputOffset,
+    int OutputDescriptor,
+    off_t *OutputOffset,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one file descriptor to another inside the
+    kernel, without passing it through a user mode buffer.
+
+Arguments:
+
+    InputDescriptor - Supplies the file descriptor to read from.
+
+    InputOffset - Supplies a pointer to the offset to read from. This is
+        advanced by the number of bytes copied.
+
+    OutputDescriptor - Supplies the file descriptor to write to.
+
+    OutputOffset - Supplies a pointer to the offset to write to. This is
+        advanced by the number of bytes copied.
+
+    Size - Supplies the number of bytes to copy.
+
+Return Value:
+
+    Returns the number of bytes copied, which is zero at the end of the input.
+
+    -1 on failure, and errno will be set to contain more information. If the
+    operating system cannot copy between these descriptors, errno will be
+    ENOSYS and the caller should fall back to reading and writing.
+
+--*/
+
+{
+
+    ssize_t Result;
+
+    Result = copy_file_range(InputDescriptor,
+                             InputOffset,
+                             OutputDescriptor,
+                             OutputOffset,
+                             Size,
+                             0);
+
+    //
+    // The kernel fails with EINVAL if either descriptor is something other
+    // than a file or block device, or if the ranges overlap. Either way the
+    // caller can still get the job done by reading and writing.
+    //
+
+    if ((Result < 0) && ((errno == EINVAL) || (errno == EXDEV))) {
+        errno = ENOSYS;
+    }
+
+    return Result;
+}
+
+
+off_t
+SwSeekData (
+    int Descriptor,
+    off_t Offset,
+    int Hole
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the next region of data or the next hole in a file at
+    or after the given offset, and moves the file position there.
+
+Arguments:
+
+    Descriptor - Supplies the open file descriptor.
+
+    Offset - Supplies the offset to start searching from.
+
+    Hole - Supplies a boolean indicating whether to find the next hole (TRUE)
+        or the next region of data (FALSE). The end of the file always counts
+        as a hole.
+
+Return Value:
+
+    Returns the offset of the data or hole on success.
+
+    -1 on failure, and errno will be set to contain more information. The
+    errno is ENXIO if the offset is at or beyond the end of the file, and
+    ENOSYS if the operating system cannot report holes.
+
+--*/
+
+{
+
+    if (Hole != FALSE) {
+        return lseek(Descriptor, Offset, SEEK_HOLE);
+    }
+
+    return lseek(Descriptor, Offset, SEEK_DATA);
+}
+
 int
 SwResetSystem (
     SWISS_REBOOT_TYPE RebootType
@@ -1503,8 +1503,19 @@ Return Value:
 
     } else {
         Result = execvp(Command, (char *const *)Arguments);
-        fprintf(stderr, "Unable to exec %s: %s\n", Command, strerror(errno));
-        exit(errno);
+        Result = errno;
+        fprintf(stderr, "Unable to exec %s: %s\n", Command, strerror(Result));
+
+        //
+        // Exit the way shells do so the caller can tell a missing command
+        // (127) apart from one that could not be run (126).
+        //
+
+        if (Result == ENOENT) {
+            _exit(127);
+        }
+
+        _exit(126);
     }
 
     return Result;
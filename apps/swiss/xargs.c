@@ -69,11 +69,14 @@ Module Name:
     "     last one takes effect.\n"                                            \
     "  -n, --max-args=number -- Invoke the utility using up to the given \n"   \
     "     number of arguments.\n"                                              \
+    "  -P, --max-procs=number -- Run up to the given number of invocations \n" \
+    "     of the utility at once. Zero runs as many as possible. The \n"      \
+    "     default is one.\n"                                                   \
     "  -p, --interactive prompt -- Prompt the user to execute each \n"         \
     "     invocation.\n"                                                       \
     "  -s, --max-chars=size -- Use at most the given size number of \n"        \
     "     characters per command line, including the command and initial \n"   \
-    "     arguments.\n"                                                        \
+    "     arguments. The default is 131072.\n"                                 \
     "  -t, --verbose -- Print each command before it's executed.\n"            \
     "  -x, --exit -- Exit is the size (-s) option is exceeded.\n"              \
     "  --help -- Show this help text and exit.\n"                              \
@@ -84,13 +87,26 @@ Module Name:
 // initial command line arguments.
 //
 
-#define XARGS_OPTIONS_STRING "+0d:E:I:L:n:ps:tx"
+#define XARGS_OPTIONS_STRING "+0d:E:I:L:n:P:ps:tx"
 
 #define XARGS_DEFAULT_UTILITY "/bin/echo"
 
 #define XARGS_INITIAL_ARGUMENT_SIZE 64
 #define XARGS_INITIAL_ARGUMENT_COUNT 32
 
+//
+// Define the default limit on the size of a command line, which is comfortably
+// under the argument limits of the systems swiss runs on.
+//
+
+#define XARGS_DEFAULT_SIZE_LIMIT (128 * _1KB)
+
+//
+// Define the process limit used for -P 0.
+//
+
+#define XARGS_UNLIMITED_PROCESSES MAX_ULONG
+
 //
 // Define xargs options.
 //
@@ -198,6 +214,13 @@ Structure Description:
     AtEnd - Stores a boolean indicating if the last argument ever has been
         encountered.
 
+    Utility - Stores a pointer to the name of the utility being run.
+
+    MaxProcesses - Stores the maximum number of invocations to run at once.
+
+    RunningCount - Stores the number of invocations started in the
+        background that have not yet been waited on.
+
 --*/
 
 typedef struct _XARGS_CONTEXT {
@@ -206,6 +229,9 @@ typedef struct _XARGS_CONTEXT {
     LONG Limit;
     PSTR EndString;
     BOOL AtEnd;
+    PSTR Utility;
+    ULONG MaxProcesses;
+    ULONG RunningCount;
 } XARGS_CONTEXT, *PXARGS_CONTEXT;
 
 //
@@ -238,6 +264,23 @@ XargsRunCommand (
     UINTN ArgumentCount
     );
 
+INT
+XargsWaitForCommand (
+    PXARGS_CONTEXT Context
+    );
+
+INT
+XargsGetCommandStatus (
+    PXARGS_CONTEXT Context,
+    INT ReturnValue
+    );
+
+INT
+XargsMergeStatus (
+    INT TotalStatus,
+    INT Status
+    );
+
 UINTN
 XargsPrintCommand (
     PSTR *Arguments,
@@ -264,6 +307,7 @@ struct option XargsLongOptions[] = {
     {"null", no_argument, 0, '0'},
     {"delimiter", required_argument, 0, 'd'},
     {"max-args", required_argument, 0, 'n'},
+    {"max-procs", required_argument, 0, 'P'},
     {"interactive", no_argument, 0, 'p'},
     {"max-chars", required_argument, 0, 's'},
     {"help", no_argument, 0, 'h'},
@@ -310,12 +354,14 @@ Return Value:
     PSTR *Array;
     UINTN ArrayCapacity;
     CHAR Character;
+    BOOL CommandRun;
     XARGS_CONTEXT Context;
     UINTN CurrentCount;
     PSTR DefaultArguments[2];
     CHAR Digit;
     UINTN DigitIndex;
     UINTN InitialSize;
+    LONG MaxProcesses;
     PSTR *NewArray;
     PSTR NextArgument;
     INT Option;
@@ -333,13 +379,15 @@ Return Value:
     ArgumentIndex = 0;
     Array = NULL;
     ArrayCapacity = 0;
+    CommandRun = FALSE;
     memset(&Context, 0, sizeof(XARGS_CONTEXT));
     Context.Delimiter = -1;
     Context.Limit = -1;
+    Context.MaxProcesses = 1;
     NextArgument = NULL;
     ReadArgument = NULL;
     ReplaceString = NULL;
-    SizeLimit = 0;
+    SizeLimit = XARGS_DEFAULT_SIZE_LIMIT;
     Status = 0;
     TotalStatus = 0;
 
@@ -481,6 +529,21 @@ Return Value:
             Context.Options &= ~XARGS_OPTION_LIMIT_LINES;
             break;
 
+        case 'P':
+            MaxProcesses = strtol(optarg, &AfterScan, 10);
+            if ((AfterScan == optarg) || (MaxProcesses < 0)) {
+                SwPrintError(0, optarg, "Invalid process limit");
+                TotalStatus = 1;
+                goto MainEnd;
+            }
+
+            Context.MaxProcesses = MaxProcesses;
+            if (MaxProcesses == 0) {
+                Context.MaxProcesses = XARGS_UNLIMITED_PROCESSES;
+            }
+
+            break;
+
         case 'p':
             Context.Options |= XARGS_OPTION_PROMPT | XARGS_OPTION_TRACE;
             break;
@@ -526,6 +589,17 @@ Return Value:
         goto MainEnd;
     }
 
+    //
+    // Running in parallel requires waiting on children, which not every OS
+    // can do. Prompting needs the terminal, so it also runs one at a time.
+    //
+
+    if ((SwForkSupported == 0) ||
+        ((Context.Options & XARGS_OPTION_PROMPT) != 0)) {
+
+        Context.MaxProcesses = 1;
+    }
+
     //
     // Figure out the base template, including the utility and initial
     // arguments.
@@ -543,6 +617,8 @@ Return Value:
         TemplateCount = 1;
     }
 
+    Context.Utility = Template[0];
+
     //
     // Allocate a new argument array.
     //
@@ -602,12 +678,10 @@ Return Value:
             }
 
             Status = XargsRunCommand(&Context, Array, TemplateCount);
-            if (Status != 0) {
-                TotalStatus = Status;
-            }
-
+            TotalStatus = XargsMergeStatus(TotalStatus, Status);
             XargsFreeArrayElements(Array, 1, TemplateCount);
             if (Status == XARGS_EXIT_COMMAND_255) {
+                Status = 0;
                 goto MainEnd;
             }
         }
@@ -728,20 +802,39 @@ Return Value:
                 CurrentCount += 1;
             }
 
-            Array[ArgumentIndex] = NULL;
-            Status = XargsRunCommand(&Context, Array, ArgumentIndex);
-            if (Status != 0) {
-                TotalStatus = Status;
+            //
+            // The utility runs once even with no input, but input running
+            // out right at the end of a full command doesn't warrant another
+            // invocation with no arguments.
+            //
+
+            if ((CurrentCount == 0) && (CommandRun != FALSE)) {
+                break;
             }
 
+            Array[ArgumentIndex] = NULL;
+            Status = XargsRunCommand(&Context, Array, ArgumentIndex);
+            CommandRun = TRUE;
+            TotalStatus = XargsMergeStatus(TotalStatus, Status);
             XargsFreeArrayElements(Array, TemplateCount, ArgumentIndex);
             if (Status == XARGS_EXIT_COMMAND_255) {
+                Status = 0;
                 goto MainEnd;
             }
         }
     }
 
 MainEnd:
+
+    //
+    // Wait for any invocations still running in the background.
+    //
+
+    while (Context.RunningCount != 0) {
+        TotalStatus = XargsMergeStatus(TotalStatus,
+                                       XargsWaitForCommand(&Context));
+    }
+
     if (NextArgument != NULL) {
 
         assert(NextArgument != ReadArgument);
@@ -1105,7 +1198,9 @@ XargsRunCommand (
 
 Routine Description:
 
-    This routine runs the given command.
+    This routine runs the given command. If more than one invocation is
+    allowed at once, the command is started in the background, after first
+    waiting for a running invocation to finish if the limit has been reached.
 
 Arguments:
 
@@ -1119,7 +1214,8 @@ Return Value:
 
     0 on success.
 
-    Returns an XARGS_EXIT_* value.
+    Returns an XARGS_EXIT_* value. When running in the background, this is
+    the status of any invocations that were waited on.
 
 --*/
 
@@ -1127,6 +1223,7 @@ Return Value:
 
     INT ReturnValue;
     INT Status;
+    INT TotalStatus;
 
     if ((Context->Options & XARGS_OPTION_TRACE) != 0) {
         XargsPrintCommand(Arguments, ArgumentCount);
@@ -1139,37 +1236,184 @@ Return Value:
         }
     }
 
+    if (Context->MaxProcesses == 1) {
+        Status = SwRunCommand(Arguments[0],
+                              Arguments,
+                              ArgumentCount,
+                              0,
+                              &ReturnValue);
+
+        if (Status != 0) {
+            SwPrintError(Status, Arguments[0], "Unable to run");
+            if (Status == ENOENT) {
+                return XARGS_EXIT_COMMAND_NOT_FOUND;
+            }
+
+            return XARGS_EXIT_COMMAND_RUN_FAILURE;
+        }
+
+        return XargsGetCommandStatus(Context, ReturnValue);
+    }
+
+    TotalStatus = 0;
+    while (Context->RunningCount >= Context->MaxProcesses) {
+        Status = XargsWaitForCommand(Context);
+        TotalStatus = XargsMergeStatus(TotalStatus, Status);
+    }
+
     Status = SwRunCommand(Arguments[0],
                           Arguments,
                           ArgumentCount,
-                          0,
+                          1,
                           &ReturnValue);
 
     if (Status != 0) {
         SwPrintError(Status, Arguments[0], "Unable to run");
-        return XARGS_EXIT_COMMAND_RUN_FAILURE;
+        if (Status == ENOENT) {
+            Status = XARGS_EXIT_COMMAND_NOT_FOUND;
+
+        } else {
+            Status = XARGS_EXIT_COMMAND_RUN_FAILURE;
+        }
+
+        return XargsMergeStatus(TotalStatus, Status);
     }
 
-    if (ReturnValue == 0) {
-        return ReturnValue;
+    Context->RunningCount += 1;
+    return TotalStatus;
+}
+
+INT
+XargsWaitForCommand (
+    PXARGS_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits for any invocation running in the background to
+    finish.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    0 if the invocation succeeded.
+
+    Returns an XARGS_EXIT_* value.
+
+--*/
+
+{
+
+    pid_t Child;
+    INT ReturnValue;
+
+    assert(Context->RunningCount != 0);
+
+    Child = SwWaitPid(-1, 0, &ReturnValue);
+    if (Child == -1) {
+        SwPrintError(errno, Context->Utility, "Failed to wait for child");
+        Context->RunningCount = 0;
+        return XARGS_EXIT_COMMAND_RUN_FAILURE;
     }
 
-    if (ReturnValue == XARGS_EXIT_COMMAND_NOT_FOUND) {
-        SwPrintError(0, Arguments[0], "Command not found");
+    Context->RunningCount -= 1;
+    return XargsGetCommandStatus(Context, ReturnValue);
+}
+
+INT
+XargsGetCommandStatus (
+    PXARGS_CONTEXT Context,
+    INT ReturnValue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the status of a finished invocation into an xargs
+    exit code, printing a message for abnormal terminations.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ReturnValue - Supplies the wait status of the invocation.
+
+Return Value:
+
+    0 if the invocation succeeded.
+
+    Returns an XARGS_EXIT_* value.
+
+--*/
+
+{
+
+    if (ReturnValue == 0) {
         return ReturnValue;
     }
 
     if (WIFSIGNALED(ReturnValue)) {
-        SwPrintError(0, Arguments[0], "Terminated by signal");
+        SwPrintError(0, Context->Utility, "Terminated by signal");
         return XARGS_EXIT_COMMAND_SIGNALED;
     }
 
+    if (WEXITSTATUS(ReturnValue) == XARGS_EXIT_COMMAND_NOT_FOUND) {
+        SwPrintError(0, Context->Utility, "Command not found");
+        return XARGS_EXIT_COMMAND_NOT_FOUND;
+    }
+
+    if (WEXITSTATUS(ReturnValue) == XARGS_EXIT_COMMAND_RUN_FAILURE) {
+        SwPrintError(0, Context->Utility, "Command could not be run");
+        return XARGS_EXIT_COMMAND_RUN_FAILURE;
+    }
+
     if (WEXITSTATUS(ReturnValue) == 255) {
-        SwPrintError(0, Arguments[0], "Returned 255");
+        SwPrintError(0, Context->Utility, "Returned 255");
         return XARGS_EXIT_COMMAND_255;
     }
 
-    return 1;
+    return XARGS_EXIT_COMMAND_FAILED;
+}
+
+INT
+XargsMergeStatus (
+    INT TotalStatus,
+    INT Status
+    )
+
+/*++
+
+Routine Description:
+
+    This routine combines the status of one invocation with the overall exit
+    status. The more severe status wins, so the result does not depend on the
+    order in which parallel invocations finish.
+
+Arguments:
+
+    TotalStatus - Supplies the exit status so far.
+
+    Status - Supplies the XARGS_EXIT_* status of an invocation.
+
+Return Value:
+
+    Returns the new overall exit status.
+
+--*/
+
+{
+
+    if (Status > TotalStatus) {
+        return Status;
+    }
+
+    return TotalStatus;
 }
 
 UINTN
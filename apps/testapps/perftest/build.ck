@@ -39,10 +39,12 @@ function build() {
         "copy.c",
         "create.c",
         "dlopen.c",
+        "dlsym.c",
         "dup.c",
         "getppid.c",
         "exec.c",
         "fork.c",
+        "getc.c",
         "malloc.c",
         "mmap.c",
         "mutex.c",
@@ -55,6 +57,7 @@ function build() {
         "rename.c",
         "signal.c",
         "stat.c",
+        "string.c",
         "write.c"
     ];
 
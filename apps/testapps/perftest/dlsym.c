@@ -0,0 +1,168 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    dlsym.c
+
+Abstract:
+
+    This module implements the performance benchmark test for looking up
+    symbols in the global scope with the dlsym() C library routine.
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <stdlib.h>
+#include <errno.h>
+#include <dlfcn.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define PT_DLSYM_SYMBOL_COUNT \
+    (sizeof(PtDlsymSymbols) / sizeof(PtDlsymSymbols[0]))
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Define the set of symbols looked up by the test. These all live in the C
+// library, so each lookup has to get past the executable first.
+//
+
+const char *PtDlsymSymbols[] = {
+    "malloc",
+    "free",
+    "memcpy",
+    "strlen",
+    "printf",
+    "fopen",
+    "pthread_create",
+    "qsort",
+    "getenv",
+    "strtol",
+    "open",
+    "close",
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+DlsymMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the dynamic symbol lookup performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    void *Address;
+    void *Handle;
+    size_t Index;
+    unsigned long long Iterations;
+    int Status;
+
+    Iterations = 0;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    Handle = dlopen(NULL, RTLD_NOW);
+    if (Handle == NULL) {
+        Result->Status = ENOENT;
+        goto MainEnd;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the performance of the dlsym() C library routine by counting
+    // the number of symbols that can be looked up.
+    //
+
+    Index = 0;
+    while (PtIsTimedTestRunning() != 0) {
+        Address = dlsym(Handle, PtDlsymSymbols[Index]);
+        if (Address == NULL) {
+            Result->Status = ENOSYS;
+            break;
+        }
+
+        Index += 1;
+        if (Index == PT_DLSYM_SYMBOL_COUNT) {
+            Index = 0;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (Handle != NULL) {
+        dlclose(Handle);
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -14,7 +14,7 @@ Module Name:
 Abstract:
 
     This module implements the performance benchmark tests for the fork()
-    C library call.
+    and vfork() C library calls.
 
 Author:
 
@@ -32,6 +32,7 @@ Module Name:
 
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
@@ -41,6 +42,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the amount of memory the large variants touch before they start, to
+// give the process a resident set worth copying.
+//
+
+#define PT_FORK_LARGE_RESIDENT_SIZE (64 * 1024 * 1024)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -67,7 +75,7 @@ ForkMain (
 
 Routine Description:
 
-    This routine performs the fork performance benchmark test.
+    This routine performs the fork and vfork performance benchmark tests.
 
 Arguments:
 
@@ -86,11 +94,41 @@ Return Value:
 
     pid_t Child;
     unsigned long long Iterations;
+    void *ResidentBuffer;
     int Status;
+    int UseVfork;
 
     Iterations = 0;
+    ResidentBuffer = NULL;
     Result->Type = PtResultIterations;
     Result->Status = 0;
+    UseVfork = 0;
+    switch (Test->TestType) {
+    case PtTestVfork:
+    case PtTestVforkLarge:
+        UseVfork = 1;
+        break;
+
+    default:
+        break;
+    }
+
+    //
+    // The large variants fault in a big chunk of memory first, which is what
+    // a fork has to copy (or at least mark copy-on-write) on every iteration.
+    //
+
+    if ((Test->TestType == PtTestForkLarge) ||
+        (Test->TestType == PtTestVforkLarge)) {
+
+        ResidentBuffer = malloc(PT_FORK_LARGE_RESIDENT_SIZE);
+        if (ResidentBuffer == NULL) {
+            Result->Status = ENOMEM;
+            goto MainEnd;
+        }
+
+        memset(ResidentBuffer, 1, PT_FORK_LARGE_RESIDENT_SIZE);
+    }
 
     //
     // Start the test. This snaps resource usage and starts the clock ticking.
@@ -105,16 +143,27 @@ Return Value:
     //
     // Measure the performance of the fork() C library routine by counting the
     // number of times a forked child can be waited on during the given
-    // duration. The child, in this case, exits immediately.
+    // duration. The child, in this case, exits immediately. A vfork child
+    // shares the parent's memory, so it must use _exit.
     //
 
     while (PtIsTimedTestRunning() != 0) {
-        Child = fork();
+        if (UseVfork != 0) {
+            Child = vfork();
+
+        } else {
+            Child = fork();
+        }
+
         if (Child < 0) {
             Result->Status = errno;
             break;
 
         } else if (Child == 0) {
+            if (UseVfork != 0) {
+                _exit(0);
+            }
+
             exit(0);
 
         } else {
@@ -143,6 +192,10 @@ Return Value:
     }
 
 MainEnd:
+    if (ResidentBuffer != NULL) {
+        free(ResidentBuffer);
+    }
+
     Result->Data.Iterations = Iterations;
     return;
 }
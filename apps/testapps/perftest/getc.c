@@ -0,0 +1,250 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    getc.c
+
+Abstract:
+
+    This module implements the performance benchmark test for reading a file
+    one character at a time through the getc() C library routine.
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define PT_GETC_TEST_FILE_NAME_LENGTH 48
+#define PT_GETC_TEST_FILE_SIZE (2 * 1024 * 1024)
+#define PT_GETC_TEST_BUFFER_SIZE 4096
+
+//
+// Define the total number of bytes to read. The test stops early if it gets
+// through this much before the duration expires.
+//
+
+#define PT_GETC_TEST_TOTAL_SIZE (1024ULL * 1024 * 1024)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+GetcMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the getc performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Buffer;
+    ssize_t BytesWritten;
+    int Character;
+    int FileCreated;
+    int FileDescriptor;
+    char FileName[PT_GETC_TEST_FILE_NAME_LENGTH];
+    int Index;
+    pid_t ProcessId;
+    int Status;
+    FILE *Stream;
+    unsigned long long TotalBytes;
+
+    FileCreated = 0;
+    FileDescriptor = -1;
+    Stream = NULL;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    TotalBytes = 0;
+    Buffer = malloc(PT_GETC_TEST_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    for (Index = 0; Index < PT_GETC_TEST_BUFFER_SIZE; Index += 1) {
+        Buffer[Index] = 'a' + (Index % 26);
+    }
+
+    //
+    // Get the process ID and create a process safe file path.
+    //
+
+    ProcessId = getpid();
+    Status = snprintf(FileName,
+                      PT_GETC_TEST_FILE_NAME_LENGTH,
+                      "getc_%d.txt",
+                      ProcessId);
+
+    if (Status < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    FileDescriptor = open(FileName,
+                          O_RDWR | O_CREAT | O_TRUNC,
+                          S_IRUSR | S_IWUSR);
+
+    if (FileDescriptor < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    FileCreated = 1;
+
+    //
+    // Fill the file so that the reads come out of the system's cache.
+    //
+
+    for (Index = 0;
+         Index < (PT_GETC_TEST_FILE_SIZE / PT_GETC_TEST_BUFFER_SIZE);
+         Index += 1) {
+
+        do {
+            BytesWritten = write(FileDescriptor,
+                                 Buffer,
+                                 PT_GETC_TEST_BUFFER_SIZE);
+
+        } while ((BytesWritten < 0) && (errno == EINTR));
+
+        if (BytesWritten < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        if (BytesWritten != PT_GETC_TEST_BUFFER_SIZE) {
+            Result->Status = EIO;
+            goto MainEnd;
+        }
+    }
+
+    Status = fsync(FileDescriptor);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    close(FileDescriptor);
+    FileDescriptor = -1;
+    Stream = fopen(FileName, "r");
+    if (Stream == NULL) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the performance of the getc() C library routine by counting the
+    // number of bytes that can be read, rewinding at the end of the file.
+    //
+
+    while ((PtIsTimedTestRunning() != 0) &&
+           (TotalBytes < PT_GETC_TEST_TOTAL_SIZE)) {
+
+        Character = getc(Stream);
+        if (Character == EOF) {
+            if (ferror(Stream) != 0) {
+                Result->Status = errno;
+                break;
+            }
+
+            rewind(Stream);
+            continue;
+        }
+
+        TotalBytes += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (Stream != NULL) {
+        fclose(Stream);
+    }
+
+    if (FileDescriptor >= 0) {
+        close(FileDescriptor);
+    }
+
+    if (FileCreated != 0) {
+        remove(FileName);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    Result->Data.Bytes = TotalBytes;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -211,6 +211,27 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtResultIterations,
      EXEC_TEST_DEFAULT_DURATION},
 
+    {FORK_LARGE_TEST_NAME,
+     FORK_LARGE_TEST_DESCRIPTION,
+     ForkMain,
+     PtTestForkLarge,
+     PtResultIterations,
+     FORK_LARGE_TEST_DEFAULT_DURATION},
+
+    {VFORK_TEST_NAME,
+     VFORK_TEST_DESCRIPTION,
+     ForkMain,
+     PtTestVfork,
+     PtResultIterations,
+     VFORK_TEST_DEFAULT_DURATION},
+
+    {VFORK_LARGE_TEST_NAME,
+     VFORK_LARGE_TEST_DESCRIPTION,
+     ForkMain,
+     PtTestVforkLarge,
+     PtResultIterations,
+     VFORK_LARGE_TEST_DEFAULT_DURATION},
+
     {OPEN_TEST_NAME,
      OPEN_TEST_DESCRIPTION,
      OpenMain,
@@ -253,6 +274,20 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtResultIterations,
      PIPE_IO_TEST_DEFAULT_DURATION},
 
+    {PIPE_IO_LARGE_TEST_NAME,
+     PIPE_IO_LARGE_TEST_DESCRIPTION,
+     PipeIoMain,
+     PtTestPipeIoLarge,
+     PtResultBytes,
+     PIPE_IO_LARGE_TEST_DEFAULT_DURATION},
+
+    {PIPE_IO_GIFT_TEST_NAME,
+     PIPE_IO_GIFT_TEST_DESCRIPTION,
+     PipeIoMain,
+     PtTestPipeIoGift,
+     PtResultBytes,
+     PIPE_IO_GIFT_TEST_DEFAULT_DURATION},
+
     {READ_TEST_NAME,
      READ_TEST_DESCRIPTION,
      ReadMain,
@@ -413,6 +448,55 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtTestSignalRestart,
      PtResultIterations,
      SIGNAL_RESTART_DEFAULT_DURATION},
+
+    {STRING_LENGTH_NAME,
+     STRING_LENGTH_DESCRIPTION,
+     StringMain,
+     PtTestStringLength,
+     PtResultBytes,
+     STRING_LENGTH_DEFAULT_DURATION},
+
+    {STRING_FIND_NAME,
+     STRING_FIND_DESCRIPTION,
+     StringMain,
+     PtTestStringFind,
+     PtResultBytes,
+     STRING_FIND_DEFAULT_DURATION},
+
+    {MEMORY_FIND_NAME,
+     MEMORY_FIND_DESCRIPTION,
+     StringMain,
+     PtTestMemoryFind,
+     PtResultBytes,
+     MEMORY_FIND_DEFAULT_DURATION},
+
+    {MEMORY_COMPARE_NAME,
+     MEMORY_COMPARE_DESCRIPTION,
+     StringMain,
+     PtTestMemoryCompare,
+     PtResultBytes,
+     MEMORY_COMPARE_DEFAULT_DURATION},
+
+    {MEMORY_COPY_NAME,
+     MEMORY_COPY_DESCRIPTION,
+     StringMain,
+     PtTestMemoryCopy,
+     PtResultBytes,
+     MEMORY_COPY_DEFAULT_DURATION},
+
+    {GETC_TEST_NAME,
+     GETC_TEST_DESCRIPTION,
+     GetcMain,
+     PtTestGetc,
+     PtResultBytes,
+     GETC_TEST_DEFAULT_DURATION},
+
+    {DLSYM_TEST_NAME,
+     DLSYM_TEST_DESCRIPTION,
+     DlsymMain,
+     PtTestDlsym,
+     PtResultIterations,
+     DLSYM_TEST_DEFAULT_DURATION},
 };
 
 //
@@ -39,6 +39,16 @@ Module Name:
 #define ALL_TEST_DESCRIPTION "Runs all of the performance tests in sequence."
 #define FORK_TEST_NAME "fork"
 #define FORK_TEST_DESCRIPTION "Benchmarks the fork() C library routine."
+#define FORK_LARGE_TEST_NAME "fork_large"
+#define FORK_LARGE_TEST_DESCRIPTION \
+    "Benchmarks the fork() C library routine from a process with a large RSS."
+
+#define VFORK_TEST_NAME "vfork"
+#define VFORK_TEST_DESCRIPTION "Benchmarks the vfork() C library routine."
+#define VFORK_LARGE_TEST_NAME "vfork_large"
+#define VFORK_LARGE_TEST_DESCRIPTION \
+    "Benchmarks the vfork() C library routine from a process with a large RSS."
+
 #define EXEC_TEST_NAME "exec"
 #define EXEC_TEST_DESCRIPTION "Benchmarks the exec() C library routine."
 #define OPEN_TEST_NAME "open"
@@ -57,6 +67,14 @@ Module Name:
 #define GETPPID_TEST_DESCRIPTION "Benchmarks the getppid() C library routine."
 #define PIPE_IO_TEST_NAME "pipe_io"
 #define PIPE_IO_TEST_DESCRIPTION "Benchmarks pipe I/O throughput."
+#define PIPE_IO_LARGE_TEST_NAME "pipe_io_large"
+#define PIPE_IO_LARGE_TEST_DESCRIPTION \
+    "Benchmarks pipe I/O throughput with large transfers and a resized pipe."
+
+#define PIPE_IO_GIFT_TEST_NAME "pipe_io_gift"
+#define PIPE_IO_GIFT_TEST_DESCRIPTION \
+    "Benchmarks pipe I/O throughput with vmsplice() gifted pages."
+
 #define READ_TEST_NAME "read"
 #define READ_TEST_DESCRIPTION "Benchmarks read() throughput."
 #define WRITE_TEST_NAME "write"
@@ -145,11 +163,42 @@ Module Name:
 #define SIGNAL_RESTART_DESCRIPTION \
     "Benchmarks how many system call restarts can be made."
 
+#define STRING_LENGTH_NAME "strlen"
+#define STRING_LENGTH_DESCRIPTION \
+    "Benchmarks the strlen() C library routine across sizes and alignments."
+
+#define STRING_FIND_NAME "strchr"
+#define STRING_FIND_DESCRIPTION \
+    "Benchmarks the strchr() C library routine across sizes and alignments."
+
+#define MEMORY_FIND_NAME "memchr"
+#define MEMORY_FIND_DESCRIPTION \
+    "Benchmarks the memchr() C library routine across sizes and alignments."
+
+#define MEMORY_COMPARE_NAME "memcmp"
+#define MEMORY_COMPARE_DESCRIPTION \
+    "Benchmarks the memcmp() C library routine across sizes and alignments."
+
+#define MEMORY_COPY_NAME "memcpy"
+#define MEMORY_COPY_DESCRIPTION \
+    "Benchmarks the memcpy() C library routine across sizes and alignments."
+
+#define GETC_TEST_NAME "getc"
+#define GETC_TEST_DESCRIPTION \
+    "Benchmarks reading a file one byte at a time with getc()."
+
+#define DLSYM_TEST_NAME "dlsym"
+#define DLSYM_TEST_DESCRIPTION \
+    "Benchmarks looking up global symbols with dlsym()."
+
 //
 // Default test durations, in seconds.
 //
 
 #define FORK_TEST_DEFAULT_DURATION 60
+#define FORK_LARGE_TEST_DEFAULT_DURATION 30
+#define VFORK_TEST_DEFAULT_DURATION 30
+#define VFORK_LARGE_TEST_DEFAULT_DURATION 30
 #define EXEC_TEST_DEFAULT_DURATION 60
 #define OPEN_TEST_DEFAULT_DURATION 30
 #define CREATE_TEST_DEFAULT_DURATION 30
@@ -157,6 +206,8 @@ Module Name:
 #define RENAME_TEST_DEFAULT_DURATION 30
 #define GETPPID_TEST_DEFAULT_DURATION 10
 #define PIPE_IO_TEST_DEFAULT_DURATION 30
+#define PIPE_IO_LARGE_TEST_DEFAULT_DURATION 30
+#define PIPE_IO_GIFT_TEST_DEFAULT_DURATION 30
 #define READ_TEST_DEFAULT_DURATION 60
 #define WRITE_TEST_DEFAULT_DURATION 60
 #define COPY_TEST_DEFAULT_DURATION 60
@@ -180,6 +231,13 @@ Module Name:
 #define SIGNAL_IGNORED_DEFAULT_DURATION 30
 #define SIGNAL_HANDLED_DEFAULT_DURATION 30
 #define SIGNAL_RESTART_DEFAULT_DURATION 30
+#define STRING_LENGTH_DEFAULT_DURATION 30
+#define STRING_FIND_DEFAULT_DURATION 30
+#define MEMORY_FIND_DEFAULT_DURATION 30
+#define MEMORY_COMPARE_DEFAULT_DURATION 30
+#define MEMORY_COPY_DEFAULT_DURATION 30
+#define GETC_TEST_DEFAULT_DURATION 60
+#define DLSYM_TEST_DEFAULT_DURATION 30
 
 //
 // Define the number of variables supplied to an iteration of the execute test
@@ -196,12 +254,17 @@ typedef enum _PT_TEST_TYPE {
     PtTestAll,
     PtTestFork,
     PtTestExec,
+    PtTestForkLarge,
+    PtTestVfork,
+    PtTestVforkLarge,
     PtTestOpen,
     PtTestCreate,
     PtTestDup,
     PtTestRename,
     PtTestGetppid,
     PtTestPipeIo,
+    PtTestPipeIoLarge,
+    PtTestPipeIoGift,
     PtTestRead,
     PtTestWrite,
     PtTestCopy,
@@ -225,6 +288,13 @@ typedef enum _PT_TEST_TYPE {
     PtTestSignalIgnored,
     PtTestSignalHandled,
     PtTestSignalRestart,
+    PtTestStringLength,
+    PtTestStringFind,
+    PtTestMemoryFind,
+    PtTestMemoryCompare,
+    PtTestMemoryCopy,
+    PtTestGetc,
+    PtTestDlsym,
     PtTestTypeCount
 } PT_TEST_TYPE, *PPT_TEST_TYPE;
 
@@ -529,7 +599,7 @@ ForkMain (
 
 Routine Description:
 
-    This routine performs the fork performance benchmark test.
+    This routine performs the fork and vfork performance benchmark tests.
 
 Arguments:
 
@@ -1021,3 +1091,79 @@ Return Value:
 
 --*/
 
+void
+StringMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the string and memory routine performance benchmark
+    tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+GetcMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the getc performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+DlsymMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the dynamic symbol lookup performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -13,7 +13,8 @@ Module Name:
 
 Abstract:
 
-    This module implements the performance benchmark tests pipe I/O throughput.
+    This module implements the performance benchmark tests for pipe I/O
+    throughput.
 
 Author:
 
@@ -31,8 +32,11 @@ Module Name:
 
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 
 #include "perftest.h"
 
@@ -41,6 +45,8 @@ Module Name:
 //
 
 #define PT_PIPE_IO_BUFFER_SIZE 4096
+#define PT_PIPE_IO_LARGE_BUFFER_SIZE (256 * 1024)
+#define PT_PIPE_IO_LARGE_PIPE_SIZE (1024 * 1024)
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -50,6 +56,13 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+void
+PipeIoGiftReader (
+    int Descriptor,
+    char *Buffer,
+    size_t BufferSize
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -68,7 +81,7 @@ PipeIoMain (
 
 Routine Description:
 
-    This routine performs the pipe I/O performance benchmark test.
+    This routine performs the pipe I/O performance benchmark tests.
 
 Arguments:
 
@@ -86,24 +99,51 @@ Return Value:
 {
 
     char *Buffer;
+    size_t BufferSize;
     ssize_t BytesCompleted;
+    pid_t Child;
+    struct iovec IoVector;
     unsigned long long Iterations;
     int PipeCreated;
     int PipeDescriptors[2];
     int Status;
+    unsigned long long TotalBytes;
 
+    Buffer = NULL;
+    Child = -1;
     Iterations = 0;
     PipeCreated = 0;
-    Result->Type = PtResultIterations;
+    TotalBytes = 0;
     Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestPipeIo:
+        Result->Type = PtResultIterations;
+        BufferSize = PT_PIPE_IO_BUFFER_SIZE;
+        break;
+
+    case PtTestPipeIoLarge:
+    case PtTestPipeIoGift:
+        Result->Type = PtResultBytes;
+        BufferSize = PT_PIPE_IO_LARGE_BUFFER_SIZE;
+        break;
+
+    default:
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
 
     //
-    // Allocate a scratch buffer to use for reads and writes.
+    // Allocate a scratch buffer to use for reads and writes. Gifted buffers
+    // are page aligned so the reader copies out of whole pages.
     //
 
-    Buffer = malloc(PT_PIPE_IO_BUFFER_SIZE);
-    if (Buffer == NULL) {
-        Result->Status = ENOMEM;
+    Status = posix_memalign((void **)&Buffer,
+                            sysconf(_SC_PAGE_SIZE),
+                            BufferSize);
+
+    if (Status != 0) {
+        Buffer = NULL;
+        Result->Status = Status;
         goto MainEnd;
     }
 
@@ -119,6 +159,42 @@ Return Value:
 
     PipeCreated = 1;
 
+    //
+    // The large transfer tests need a pipe that can hold an entire buffer.
+    //
+
+    if (Test->TestType != PtTestPipeIo) {
+        Status = fcntl(PipeDescriptors[1],
+                       F_SETPIPE_SZ,
+                       PT_PIPE_IO_LARGE_PIPE_SIZE);
+
+        if (Status < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+    }
+
+    //
+    // The gift test needs a concurrent reader, since the writer does not
+    // return until the reader has consumed the gifted pages.
+    //
+
+    if (Test->TestType == PtTestPipeIoGift) {
+        Child = fork();
+        if (Child < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+
+        } else if (Child == 0) {
+            close(PipeDescriptors[1]);
+            PipeIoGiftReader(PipeDescriptors[0], Buffer, BufferSize);
+            exit(0);
+        }
+
+        close(PipeDescriptors[0]);
+        PipeDescriptors[0] = -1;
+    }
+
     //
     // Start the test. This snaps resource usage and starts the clock ticking.
     //
@@ -130,19 +206,42 @@ Return Value:
     }
 
     //
-    // Measure the performance of pipe I/O throughput by alternating between
-    // writing to and reading from a pipe.
+    // Measure the performance of pipe I/O throughput. The gift test hands the
+    // buffer to the reader process, the others alternate between writing to
+    // and reading from the pipe.
     //
 
     while (PtIsTimedTestRunning() != 0) {
+        if (Test->TestType == PtTestPipeIoGift) {
+            IoVector.iov_base = Buffer;
+            IoVector.iov_len = BufferSize;
+            do {
+                BytesCompleted = vmsplice(PipeDescriptors[1],
+                                          &IoVector,
+                                          1,
+                                          SPLICE_F_GIFT);
+
+            } while ((BytesCompleted < 0) && (errno == EINTR));
+
+            if (BytesCompleted != BufferSize) {
+                if (errno == 0) {
+                    errno = EIO;
+                }
+
+                Result->Status = errno;
+                break;
+            }
+
+            TotalBytes += BytesCompleted;
+            continue;
+        }
+
         do {
-            BytesCompleted = write(PipeDescriptors[1],
-                                   Buffer,
-                                   PT_PIPE_IO_BUFFER_SIZE);
+            BytesCompleted = write(PipeDescriptors[1], Buffer, BufferSize);
 
         } while ((BytesCompleted < 0) && (errno == EINTR));
 
-        if (BytesCompleted != PT_PIPE_IO_BUFFER_SIZE) {
+        if (BytesCompleted != BufferSize) {
             if (errno == 0) {
                 errno = EIO;
             }
@@ -152,13 +251,11 @@ Return Value:
         }
 
         do {
-            BytesCompleted = read(PipeDescriptors[0],
-                                  Buffer,
-                                  PT_PIPE_IO_BUFFER_SIZE);
+            BytesCompleted = read(PipeDescriptors[0], Buffer, BufferSize);
 
         } while ((BytesCompleted < 0) && (errno == EINTR));
 
-        if (BytesCompleted != PT_PIPE_IO_BUFFER_SIZE) {
+        if (BytesCompleted != BufferSize) {
             if (errno == 0) {
                 errno = EIO;
             }
@@ -168,6 +265,7 @@ Return Value:
         }
 
         Iterations += 1;
+        TotalBytes += BytesCompleted;
     }
 
     Status = PtFinishTimedTest(Result);
@@ -177,15 +275,35 @@ Return Value:
 
 MainEnd:
     if (PipeCreated != 0) {
-        close(PipeDescriptors[0]);
+        if (PipeDescriptors[0] >= 0) {
+            close(PipeDescriptors[0]);
+        }
+
         close(PipeDescriptors[1]);
     }
 
+    //
+    // Closing the write end causes the reader child to see end-of-file and
+    // exit.
+    //
+
+    if (Child > 0) {
+        while ((waitpid(Child, &Status, 0) < 0) && (errno == EINTR)) {
+            continue;
+        }
+    }
+
     if (Buffer != NULL) {
         free(Buffer);
     }
 
-    Result->Data.Iterations = Iterations;
+    if (Result->Type == PtResultBytes) {
+        Result->Data.Bytes = TotalBytes;
+
+    } else {
+        Result->Data.Iterations = Iterations;
+    }
+
     return;
 }
 
@@ -193,3 +311,49 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+void
+PipeIoGiftReader (
+    int Descriptor,
+    char *Buffer,
+    size_t BufferSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine drains the given pipe until the writer closes it.
+
+Arguments:
+
+    Descriptor - Supplies the read end of the pipe.
+
+    Buffer - Supplies a pointer to a scratch buffer to read into.
+
+    BufferSize - Supplies the size of the scratch buffer in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ssize_t BytesCompleted;
+
+    while (1) {
+        BytesCompleted = read(Descriptor, Buffer, BufferSize);
+        if (BytesCompleted == 0) {
+            break;
+        }
+
+        if ((BytesCompleted < 0) && (errno != EINTR)) {
+            break;
+        }
+    }
+
+    close(Descriptor);
+    return;
+}
+
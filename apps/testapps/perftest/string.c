@@ -0,0 +1,264 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    string.c
+
+Abstract:
+
+    This module implements the performance benchmark tests for the string and
+    memory C library routines.
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of different alignments each size is run at.
+//
+
+#define PT_STRING_TEST_ALIGNMENT_COUNT 16
+
+//
+// Define the size of the test buffers, which must hold the largest test size
+// at the largest alignment plus a terminator.
+//
+
+#define PT_STRING_TEST_BUFFER_SIZE \
+    ((64 * 1024) + PT_STRING_TEST_ALIGNMENT_COUNT + 1)
+
+//
+// Define the character the buffers are filled with, and one that never
+// appears so that searches scan the whole buffer.
+//
+
+#define PT_STRING_TEST_FILL_CHARACTER 'a'
+#define PT_STRING_TEST_MISSING_CHARACTER 'z'
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the sizes each test cycles through, from short strings up to large
+// buffers.
+//
+
+const size_t StringTestSizes[] = {
+    1,
+    3,
+    8,
+    15,
+    16,
+    31,
+    64,
+    100,
+    256,
+    1000,
+    4096,
+    16384,
+    65536
+};
+
+//
+// Store a sink for the results of the routines being measured, so that the
+// compiler cannot optimize the calls away.
+//
+
+volatile size_t StringTestSink;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+StringMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the string and memory routine performance benchmark
+    tests. Each iteration operates on the next size and alignment in turn, so
+    the result covers a spread of both.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Alignment;
+    unsigned long long Bytes;
+    char *Destination;
+    char *DestinationBuffer;
+    size_t Size;
+    size_t SizeCount;
+    size_t SizeIndex;
+    char *Source;
+    char *SourceBuffer;
+    int Status;
+
+    Bytes = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    SourceBuffer = malloc(PT_STRING_TEST_BUFFER_SIZE);
+    DestinationBuffer = malloc(PT_STRING_TEST_BUFFER_SIZE);
+    if ((SourceBuffer == NULL) || (DestinationBuffer == NULL)) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    memset(SourceBuffer,
+           PT_STRING_TEST_FILL_CHARACTER,
+           PT_STRING_TEST_BUFFER_SIZE);
+
+    memset(DestinationBuffer,
+           PT_STRING_TEST_FILL_CHARACTER,
+           PT_STRING_TEST_BUFFER_SIZE);
+
+    Alignment = 0;
+    SizeCount = sizeof(StringTestSizes) / sizeof(StringTestSizes[0]);
+    SizeIndex = 0;
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    while (PtIsTimedTestRunning() != 0) {
+        Size = StringTestSizes[SizeIndex];
+        Source = SourceBuffer + Alignment;
+
+        //
+        // Skew the destination alignment so that the two buffers are not
+        // always aligned the same way.
+        //
+
+        Destination = DestinationBuffer +
+                      ((Alignment * 7) % PT_STRING_TEST_ALIGNMENT_COUNT);
+
+        switch (Test->TestType) {
+        case PtTestStringLength:
+            Source[Size] = '\0';
+            StringTestSink += strlen(Source);
+            Source[Size] = PT_STRING_TEST_FILL_CHARACTER;
+            break;
+
+        case PtTestStringFind:
+            Source[Size] = '\0';
+            StringTestSink += (size_t)strchr(Source,
+                                             PT_STRING_TEST_MISSING_CHARACTER);
+
+            Source[Size] = PT_STRING_TEST_FILL_CHARACTER;
+            break;
+
+        case PtTestMemoryFind:
+            StringTestSink += (size_t)memchr(Source,
+                                             PT_STRING_TEST_MISSING_CHARACTER,
+                                             Size);
+
+            break;
+
+        case PtTestMemoryCompare:
+            StringTestSink += memcmp(Source, Destination, Size);
+            break;
+
+        case PtTestMemoryCopy:
+            memcpy(Destination, Source, Size);
+            break;
+
+        default:
+
+            assert(0);
+
+            Result->Status = EINVAL;
+            break;
+        }
+
+        if (Result->Status != 0) {
+            break;
+        }
+
+        Bytes += Size;
+        Alignment += 1;
+        if (Alignment == PT_STRING_TEST_ALIGNMENT_COUNT) {
+            Alignment = 0;
+            SizeIndex += 1;
+            if (SizeIndex == SizeCount) {
+                SizeIndex = 0;
+            }
+        }
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (SourceBuffer != NULL) {
+        free(SourceBuffer);
+    }
+
+    if (DestinationBuffer != NULL) {
+        free(DestinationBuffer);
+    }
+
+    Result->Data.Bytes = Bytes;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -31,6 +31,7 @@ Module Name:
 //
 
 #include <minoca/kernel/driver.h>
+#include <minoca/intrface/pci.h>
 #include <minoca/storage/ata.h>
 #include "ahci.h"
 
@@ -136,11 +137,27 @@ AhcipStartPort (
     PAHCI_PORT Port
     );
 
+KSTATUS
+AhcipConnectInterrupts (
+    PIRP Irp,
+    PAHCI_CONTROLLER Controller
+    );
+
+VOID
+AhcipProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
 
 PDRIVER AhciDriver = NULL;
+UUID AhciPciMsiInterfaceUuid = UUID_PCI_MESSAGE_SIGNALED_INTERRUPTS;
 
 DRIVER_FUNCTION_TABLE AhciDriverFunctionTable = {
     DRIVER_FUNCTION_TABLE_VERSION,
@@ -255,10 +272,11 @@ Return Value:
 
     RtlZeroMemory(Controller, sizeof(AHCI_CONTROLLER));
     Controller->Type = AhciContextController;
-    Controller->InterruptHandle = INVALID_HANDLE;
     Controller->InterruptVector = INVALID_INTERRUPT_VECTOR;
     Controller->InterruptLine = INVALID_INTERRUPT_LINE;
     for (Index = 0; Index < AHCI_PORT_COUNT; Index += 1) {
+        Controller->Interrupts[Index].Controller = Controller;
+        Controller->Interrupts[Index].Handle = INVALID_HANDLE;
         Controller->Ports[Index].Controller = Controller;
         KeInitializeSpinLock(&(Controller->Ports[Index].DpcLock));
         INITIALIZE_LIST_HEAD(&(Controller->Ports[Index].IrpQueue));
@@ -909,8 +927,10 @@ AhcipProcessResourceRequirements (
 Routine Description:
 
     This routine filters through the resource requirements presented by the
-    bus for an AHCI controller. It adds an interrupt vector requirement for
-    any interrupt line requested.
+    bus for an AHCI controller. If the controller supports message signaled
+    interrupts, it requests a block of vectors so that each port can get its
+    own. Otherwise it adds an interrupt vector requirement for any interrupt
+    line requested.
 
 Arguments:
 
@@ -926,8 +946,12 @@ Return Value:
 
 {
 
+    PINTERFACE_PCI_MSI MsiInterface;
+    PCI_MSI_INFORMATION MsiInformation;
+    PCI_MSI_TYPE MsiType;
     PRESOURCE_CONFIGURATION_LIST Requirements;
     KSTATUS Status;
+    ULONGLONG VectorCount;
     RESOURCE_REQUIREMENT VectorRequirement;
 
     ASSERT((Irp->MajorCode == IrpMajorStateChange) &&
@@ -944,15 +968,82 @@ Return Value:
     VectorRequirement.Length = 1;
 
     //
-    // Loop through all configuration lists, creating a vector for each line.
+    // Register for the MSI interface. If the controller has one, it shows up
+    // immediately.
     //
 
+    if ((Controller->PciMsiFlags &
+         AHCI_PCI_MSI_FLAG_INTERFACE_REGISTERED) == 0) {
+
+        Status = IoRegisterForInterfaceNotifications(
+                                &AhciPciMsiInterfaceUuid,
+                                AhcipProcessPciMsiInterfaceChangeNotification,
+                                Irp->Device,
+                                Controller,
+                                TRUE);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Controller->PciMsiFlags |= AHCI_PCI_MSI_FLAG_INTERFACE_REGISTERED;
+    }
+
     Requirements = Irp->U.QueryResources.ResourceRequirements;
-    Status = IoCreateAndAddInterruptVectorsForLines(Requirements,
-                                                    &VectorRequirement);
+    if ((Controller->PciMsiFlags &
+         AHCI_PCI_MSI_FLAG_INTERFACE_AVAILABLE) != 0) {
 
-    if (!KSUCCESS(Status)) {
-        goto ProcessResourceRequirementsEnd;
+        //
+        // The port count lives in the memory mapped registers, which are not
+        // available yet. Ask for as many vectors as the device advertises, up
+        // to one per possible port. AHCI routes port N to message N.
+        //
+
+        VectorCount = 1;
+        MsiInterface = &(Controller->PciMsiInterface);
+        for (MsiType = PciMsiTypeBasic;
+             MsiType <= PciMsiTypeExtended;
+             MsiType += 1) {
+
+            RtlZeroMemory(&MsiInformation, sizeof(PCI_MSI_INFORMATION));
+            MsiInformation.Version = PCI_MSI_INTERFACE_INFORMATION_VERSION;
+            MsiInformation.MsiType = MsiType;
+            Status = MsiInterface->GetSetInformation(MsiInterface->DeviceToken,
+                                                     &MsiInformation,
+                                                     FALSE);
+
+            if ((KSUCCESS(Status)) &&
+                (MsiInformation.MaxVectorCount > VectorCount)) {
+
+                VectorCount = MsiInformation.MaxVectorCount;
+            }
+        }
+
+        if (VectorCount > AHCI_PORT_COUNT) {
+            VectorCount = AHCI_PORT_COUNT;
+        }
+
+        Status = IoCreateAndAddMessageSignaledInterruptVectors(
+                                                            Requirements,
+                                                            (ULONG)VectorCount);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Controller->PciMsiFlags |= AHCI_PCI_MSI_FLAG_RESOURCES_REQUESTED;
+
+    //
+    // Loop through all configuration lists, creating a vector for each line.
+    //
+
+    } else {
+        Status = IoCreateAndAddInterruptVectorsForLines(Requirements,
+                                                        &VectorRequirement);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
     }
 
 ProcessResourceRequirementsEnd:
@@ -989,7 +1080,6 @@ Return Value:
     PRESOURCE_ALLOCATION Allocation;
     PRESOURCE_ALLOCATION_LIST AllocationList;
     ULONG BarCount;
-    IO_CONNECT_INTERRUPT_PARAMETERS Connect;
     PRESOURCE_ALLOCATION ControllerBase;
     PHYSICAL_ADDRESS EndAddress;
     PRESOURCE_ALLOCATION LineAllocation;
@@ -1035,14 +1125,27 @@ Return Value:
             ASSERT((Controller->InterruptVector == INVALID_INTERRUPT_VECTOR) ||
                    (Controller->InterruptVector == Allocation->Allocation));
 
-            ASSERT(Allocation->OwningAllocation != NULL);
-
             //
-            // Save the line and vector number.
+            // A vector without an owning line is the block of message
+            // signaled vectors. Otherwise save the line and vector number.
             //
 
             LineAllocation = Allocation->OwningAllocation;
-            Controller->InterruptLine = LineAllocation->Allocation;
+            if (LineAllocation == NULL) {
+
+                ASSERT((Controller->PciMsiFlags &
+                        AHCI_PCI_MSI_FLAG_RESOURCES_REQUESTED) != 0);
+
+                Controller->InterruptLine = INVALID_INTERRUPT_LINE;
+                Controller->InterruptCount = (ULONG)Allocation->Length;
+                Controller->PciMsiFlags |=
+                                        AHCI_PCI_MSI_FLAG_RESOURCES_ALLOCATED;
+
+            } else {
+                Controller->InterruptLine = LineAllocation->Allocation;
+                Controller->InterruptCount = 1;
+            }
+
             Controller->InterruptVector = Allocation->Allocation;
 
         } else if ((Allocation->Type == ResourceTypePhysicalAddressSpace) ||
@@ -1116,22 +1219,14 @@ Return Value:
         goto StartControllerEnd;
     }
 
-    if (Controller->InterruptHandle == INVALID_HANDLE) {
-        RtlZeroMemory(&Connect, sizeof(IO_CONNECT_INTERRUPT_PARAMETERS));
-        Connect.Version = IO_CONNECT_INTERRUPT_PARAMETERS_VERSION;
-        Connect.Device = Irp->Device;
-        Connect.InterruptServiceRoutine = AhciInterruptService;
-        Connect.DispatchServiceRoutine = AhciInterruptServiceDpc;
-        Connect.Context = Controller;
-        Connect.LineNumber = Controller->InterruptLine;
-        Connect.Vector = Controller->InterruptVector;
-        Connect.Interrupt = &(Controller->InterruptHandle);
-        Status = IoConnectInterrupt(&Connect);
+    if (Controller->Interrupts[0].Handle == INVALID_HANDLE) {
+        Status = AhcipConnectInterrupts(Irp, Controller);
         if (!KSUCCESS(Status)) {
             goto StartControllerEnd;
         }
     }
 
+    AhcipEnableInterrupts(Controller);
     Status = STATUS_SUCCESS;
 
 StartControllerEnd:
@@ -1300,3 +1395,188 @@ Return Value:
     return;
 }
 
+KSTATUS
+AhcipConnectInterrupts (
+    PIRP Irp,
+    PAHCI_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enables message signaled interrupts if they were allocated,
+    routes the controller's ports to its interrupt vectors, and connects each
+    vector.
+
+Arguments:
+
+    Irp - Supplies a pointer to the start IRP.
+
+    Controller - Supplies a pointer to the AHCI controller.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    IO_CONNECT_INTERRUPT_PARAMETERS Connect;
+    ULONG Control;
+    ULONG Index;
+    PAHCI_INTERRUPT Interrupt;
+    PINTERFACE_PCI_MSI MsiInterface;
+    PCI_MSI_TYPE MsiType;
+    KSTATUS Status;
+
+    //
+    // Enable the message signaled vectors through PCI. MSI-X steers each port
+    // vector at a different processor. If the whole block cannot be enabled,
+    // settle for a single vector shared by all the ports.
+    //
+
+    if (Controller->InterruptLine == INVALID_INTERRUPT_LINE) {
+
+        ASSERT((Controller->PciMsiFlags &
+                AHCI_PCI_MSI_FLAG_RESOURCES_ALLOCATED) != 0);
+
+        MsiInterface = &(Controller->PciMsiInterface);
+        Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                             Controller->InterruptVector,
+                                             Controller->InterruptCount,
+                                             NULL,
+                                             &MsiType);
+
+        if ((!KSUCCESS(Status)) && (Controller->InterruptCount > 1)) {
+            Controller->InterruptCount = 1;
+            Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                                 Controller->InterruptVector,
+                                                 1,
+                                                 NULL,
+                                                 &MsiType);
+        }
+
+        if (!KSUCCESS(Status)) {
+            goto ConnectInterruptsEnd;
+        }
+
+        //
+        // The controller may have decided it did not get enough messages and
+        // reverted to sending everything on the first one.
+        //
+
+        Control = AHCI_READ_GLOBAL(Controller, AhciHostControl);
+        if ((Control & AHCI_HOST_CONTROL_MSI_SINGLE_MESSAGE) != 0) {
+            Controller->InterruptCount = 1;
+        }
+    }
+
+    ASSERT((Controller->InterruptCount != 0) &&
+           (Controller->InterruptCount <= AHCI_PORT_COUNT));
+
+    //
+    // Port N interrupts on vector N, and any ports beyond the last vector
+    // share the last vector.
+    //
+
+    for (Index = 0; Index < Controller->InterruptCount; Index += 1) {
+        Interrupt = &(Controller->Interrupts[Index]);
+        Interrupt->PortMask = 1 << Index;
+        if (Index == Controller->InterruptCount - 1) {
+            Interrupt->PortMask = ~(Interrupt->PortMask - 1);
+        }
+
+        RtlZeroMemory(&Connect, sizeof(IO_CONNECT_INTERRUPT_PARAMETERS));
+        Connect.Version = IO_CONNECT_INTERRUPT_PARAMETERS_VERSION;
+        Connect.Device = Irp->Device;
+        Connect.InterruptServiceRoutine = AhciInterruptService;
+        Connect.DispatchServiceRoutine = AhciInterruptServiceDpc;
+        Connect.Context = Interrupt;
+        Connect.LineNumber = Controller->InterruptLine;
+        Connect.Vector = Controller->InterruptVector + Index;
+        Connect.Interrupt = &(Interrupt->Handle);
+        Status = IoConnectInterrupt(&Connect);
+        if (!KSUCCESS(Status)) {
+            goto ConnectInterruptsEnd;
+        }
+    }
+
+    Status = STATUS_SUCCESS;
+
+ConnectInterruptsEnd:
+    if (!KSUCCESS(Status)) {
+        for (Index = 0; Index < AHCI_PORT_COUNT; Index += 1) {
+            Interrupt = &(Controller->Interrupts[Index]);
+            if (Interrupt->Handle != INVALID_HANDLE) {
+                IoDisconnectInterrupt(Interrupt->Handle);
+                Interrupt->Handle = INVALID_HANDLE;
+            }
+        }
+    }
+
+    return Status;
+}
+
+VOID
+AhcipProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a PCI MSI interface changes in availability.
+
+Arguments:
+
+    Context - Supplies the caller's context pointer, supplied when the caller
+        requested interface notifications.
+
+    Device - Supplies a pointer to the device exposing or deleting the
+        interface.
+
+    InterfaceBuffer - Supplies a pointer to the interface buffer of the
+        interface.
+
+    InterfaceBufferSize - Supplies the buffer size.
+
+    Arrival - Supplies TRUE if a new interface is arriving, or FALSE if an
+        interface is departing.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PAHCI_CONTROLLER Controller;
+
+    Controller = (PAHCI_CONTROLLER)Context;
+    if (Arrival != FALSE) {
+        if (InterfaceBufferSize >= sizeof(INTERFACE_PCI_MSI)) {
+
+            ASSERT((Controller->PciMsiFlags &
+                    AHCI_PCI_MSI_FLAG_INTERFACE_AVAILABLE) == 0);
+
+            RtlCopyMemory(&(Controller->PciMsiInterface),
+                          InterfaceBuffer,
+                          sizeof(INTERFACE_PCI_MSI));
+
+            Controller->PciMsiFlags |= AHCI_PCI_MSI_FLAG_INTERFACE_AVAILABLE;
+        }
+
+    } else {
+        Controller->PciMsiFlags &= ~AHCI_PCI_MSI_FLAG_INTERFACE_AVAILABLE;
+    }
+
+    return;
+}
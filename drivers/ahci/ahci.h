@@ -105,6 +105,16 @@ Module Name:
 
 #define AHCI_PORT_COUNT 32
 
+//
+// Define flags describing the state of message signaled interrupts on the
+// controller.
+//
+
+#define AHCI_PCI_MSI_FLAG_INTERFACE_REGISTERED 0x00000001
+#define AHCI_PCI_MSI_FLAG_INTERFACE_AVAILABLE  0x00000002
+#define AHCI_PCI_MSI_FLAG_RESOURCES_REQUESTED  0x00000004
+#define AHCI_PCI_MSI_FLAG_RESOURCES_ALLOCATED  0x00000008
+
 //
 // Define the maximum number of command headers, as defined by the spec.
 //
@@ -1070,6 +1080,34 @@ typedef struct _AHCI_PORT {
 
 /*++
 
+Structure Description:
+
+    This structure defines state associated with one of the controller's
+    interrupt vectors. With message signaled interrupts the controller can
+    dedicate a vector to each port, otherwise a single vector serves them all.
+
+Members:
+
+    Controller - Stores a pointer to the parent controller.
+
+    PortMask - Stores the mask of ports whose interrupts arrive on this vector.
+
+    PendingInterrupts - Stores the mask of ports serviced by this vector with
+        a pending interrupt.
+
+    Handle - Stores the handle received when the vector was connected.
+
+--*/
+
+typedef struct _AHCI_INTERRUPT {
+    PAHCI_CONTROLLER Controller;
+    ULONG PortMask;
+    volatile ULONG PendingInterrupts;
+    HANDLE Handle;
+} AHCI_INTERRUPT, *PAHCI_INTERRUPT;
+
+/*++
+
 Structure Description:
 
     This structure defines state associated with an ATA controller.
@@ -1081,19 +1119,23 @@ Structure Description:
 
     ControllerBase - Stores the mapping to the controller registers.
 
-    PendingInterrupts - Stores the mask of ports with a pending interrupt.
-
     InterruptLine - Stores the interrupt line that this controller's interrupt
-        comes in on.
+        comes in on, or INVALID_INTERRUPT_LINE if message signaled interrupts
+        are in use.
 
-    InterruptVector - Stores the interrupt vector that this controller's
-        interrupt comes in on.
+    InterruptVector - Stores the first interrupt vector that this controller's
+        interrupts come in on.
 
-    InterruptFound - Stores a boolean indicating whether or not the interrupt
-        line and interrupt vector fields are valid.
+    InterruptCount - Stores the number of contiguous interrupt vectors in use,
+        starting at the interrupt vector.
 
-    InterruptHandle - Stores a pointer to the handle received when the
-        interrupt was connected.
+    Interrupts - Stores the array of per-vector interrupt state.
+
+    PciMsiFlags - Stores a bitmask of flags describing the message signaled
+        interrupt state. See AHCI_PCI_MSI_FLAG_* for definitions.
+
+    PciMsiInterface - Stores the interface used to enable PCI message signaled
+        interrupts.
 
     Ports - Stores the array of port structures.
 
@@ -1114,10 +1156,12 @@ Structure Description:
 struct _AHCI_CONTROLLER {
     AHCI_CONTEXT_TYPE Type;
     PVOID ControllerBase;
-    volatile ULONG PendingInterrupts;
     ULONGLONG InterruptLine;
     ULONGLONG InterruptVector;
-    HANDLE InterruptHandle;
+    ULONG InterruptCount;
+    AHCI_INTERRUPT Interrupts[AHCI_PORT_COUNT];
+    ULONG PciMsiFlags;
+    INTERFACE_PCI_MSI PciMsiInterface;
     AHCI_PORT Ports[AHCI_PORT_COUNT];
     ULONG PortCount;
     ULONG ImplementedPorts;
@@ -1151,7 +1195,7 @@ Routine Description:
 
     Context - Supplies the context pointer given to the system when the
         interrupt was connected. In this case, this points to the AHCI
-        controller.
+        interrupt vector state.
 
 Return Value:
 
@@ -1172,8 +1216,8 @@ Routine Description:
 
 Arguments:
 
-    Parameter - Supplies the context, in this case the AHCI controller
-        structure.
+    Parameter - Supplies the context, in this case the AHCI interrupt vector
+        state.
 
 Return Value:
 
@@ -1202,6 +1246,28 @@ Return Value:
 
 --*/
 
+VOID
+AhcipEnableInterrupts (
+    PAHCI_CONTROLLER Controller
+    );
+
+/*++
+
+Routine Description:
+
+    This routine enables interrupts globally on the AHCI controller. It should
+    be called once all interrupt vectors have been connected.
+
+Arguments:
+
+    Controller - Supplies a pointer to the AHCI controller.
+
+Return Value:
+
+    None.
+
+--*/
+
 KSTATUS
 AhcipProbePort (
     PAHCI_CONTROLLER Controller,
@@ -30,6 +30,7 @@ Module Name:
 //
 
 #include <minoca/kernel/driver.h>
+#include <minoca/intrface/pci.h>
 #include <minoca/storage/ata.h>
 #include "ahci.h"
 
@@ -123,7 +124,7 @@ Routine Description:
 
     Context - Supplies the context pointer given to the system when the
         interrupt was connected. In this case, this points to the AHCI
-        controller.
+        interrupt vector state.
 
 Return Value:
 
@@ -135,18 +136,28 @@ Return Value:
 
     ULONG Bit;
     PAHCI_CONTROLLER Controller;
+    PAHCI_INTERRUPT Interrupt;
     PAHCI_PORT Port;
     ULONG PortStatus;
     ULONG RemainingStatus;
     ULONG Status;
 
-    Controller = (PAHCI_CONTROLLER)Context;
-    Status = AHCI_READ_GLOBAL(Controller, AhciInterruptStatus);
+    Interrupt = (PAHCI_INTERRUPT)Context;
+    Controller = Interrupt->Controller;
+
+    //
+    // Only look at the ports routed to this vector. With per-port vectors,
+    // other processors may be servicing the remaining ports concurrently.
+    //
+
+    Status = AHCI_READ_GLOBAL(Controller, AhciInterruptStatus) &
+             Interrupt->PortMask;
+
     if (Status == 0) {
         return InterruptStatusNotClaimed;
     }
 
-    RtlAtomicOr32(&(Controller->PendingInterrupts), Status);
+    RtlAtomicOr32(&(Interrupt->PendingInterrupts), Status);
 
     //
     // Go read and clear the port status bits for each interrupting port,
@@ -202,8 +213,8 @@ Routine Description:
 
 Arguments:
 
-    Parameter - Supplies the context, in this case the AHCI controller
-        structure.
+    Parameter - Supplies the context, in this case the AHCI interrupt vector
+        state.
 
 Return Value:
 
@@ -214,16 +225,21 @@ Return Value:
 {
 
     PAHCI_CONTROLLER Controller;
+    PAHCI_INTERRUPT Interrupt;
     ULONG Port;
     ULONG StatusBits;
 
-    Controller = Parameter;
-    StatusBits = RtlAtomicExchange32(&(Controller->PendingInterrupts), 0);
+    Interrupt = Parameter;
+    Controller = Interrupt->Controller;
+    StatusBits = RtlAtomicExchange32(&(Interrupt->PendingInterrupts), 0);
     if (StatusBits == 0) {
         return InterruptStatusNotClaimed;
     }
 
-    for (Port = 0; Port < AHCI_PORT_COUNT; Port += 1) {
+    for (Port = RtlCountTrailingZeros32(StatusBits);
+         Port < AHCI_PORT_COUNT;
+         Port += 1) {
+
         if ((StatusBits & (1 << Port)) == 0) {
             continue;
         }
@@ -457,19 +473,49 @@ Return Value:
     }
 
     //
-    // Enable interrupts globally.
+    // Clear any stale global interrupt status. Interrupts are enabled
+    // globally once the vectors are connected.
     //
 
     AHCI_WRITE_GLOBAL(Controller, AhciInterruptStatus, 0xFFFFFFFF);
-    Control = AHCI_READ_GLOBAL(Controller, AhciHostControl);
-    Control |= AHCI_HOST_CONTROL_INTERRUPT_ENABLE;
-    AHCI_WRITE_GLOBAL(Controller, AhciHostControl, Control);
     Status = STATUS_SUCCESS;
 
 ResetControllerEnd:
     return Status;
 }
 
+VOID
+AhcipEnableInterrupts (
+    PAHCI_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enables interrupts globally on the AHCI controller. It should
+    be called once all interrupt vectors have been connected.
+
+Arguments:
+
+    Controller - Supplies a pointer to the AHCI controller.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Control;
+
+    Control = AHCI_READ_GLOBAL(Controller, AhciHostControl);
+    Control |= AHCI_HOST_CONTROL_INTERRUPT_ENABLE;
+    AHCI_WRITE_GLOBAL(Controller, AhciHostControl, Control);
+    return;
+}
+
 KSTATUS
 AhcipProbePort (
     PAHCI_CONTROLLER Controller,
@@ -480,6 +480,7 @@ Return Value:
 {
 
     PNET_PACKET_SIZE_INFORMATION PacketSizeInformation;
+    NET_POLL_PROPERTIES PollProperties;
     NET_LINK_PROPERTIES Properties;
     KSTATUS Status;
 
@@ -515,6 +516,25 @@ Return Value:
         goto AddNetworkDeviceEnd;
     }
 
+    //
+    // Received frames are processed by the networking core polling the
+    // receive ring, which also adapts the receive moderation timer.
+    //
+
+    RtlZeroMemory(&PollProperties, sizeof(NET_POLL_PROPERTIES));
+    PollProperties.Version = NET_POLL_PROPERTIES_VERSION;
+    PollProperties.DeviceContext = Device;
+    PollProperties.Budget = NET_POLL_DEFAULT_BUDGET;
+    PollProperties.Interface.Poll = AtlpPollReceive;
+    PollProperties.Interface.EnableReceiveInterrupt =
+                                                AtlpEnableReceiveInterrupt;
+
+    PollProperties.Interface.SetInterruptRate = AtlpSetInterruptRate;
+    Status = NetCreatePoll(Device->NetworkLink, &PollProperties);
+    if (!KSUCCESS(Status)) {
+        goto AddNetworkDeviceEnd;
+    }
+
 AddNetworkDeviceEnd:
     if (!KSUCCESS(Status)) {
         if (Device->NetworkLink != NULL) {
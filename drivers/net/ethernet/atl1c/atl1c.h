@@ -996,7 +996,12 @@ Structure Description:
     PendingInterrupts - Stores the bitfield of status bits that have yet to be
         dealt with by software.
 
-    EnabledInterrupts - Stores the bitfield of enabled interrupts.
+    EnabledInterrupts - Stores the bitfield of enabled interrupts. The
+        receive packet interrupts are removed while the networking core is
+        polling for received frames.
+
+    ReceiveInterruptTimer - Stores the receive interrupt moderation timer
+        value, in microseconds.
 
     Speed - Stores the current speed of the link.
 
@@ -1039,6 +1044,7 @@ typedef struct _ATL1C_DEVICE {
     KSPIN_LOCK InterruptLock;
     volatile ULONG PendingInterrupts;
     ULONG EnabledInterrupts;
+    ULONG ReceiveInterruptTimer;
     ATL_SPEED Speed;
     ATL_DUPLEX_MODE Duplex;
     BYTE EepromMacAddress[ETHERNET_ADDRESS_SIZE];
@@ -1216,6 +1222,78 @@ Return Value:
 
 --*/
 
+ULONG
+AtlpPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    );
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupts are masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+VOID
+AtlpEnableReceiveInterrupt (
+    PVOID DeviceContext
+    );
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+AtlpSetInterruptRate (
+    PVOID DeviceContext,
+    ULONG InterruptsPerSecond
+    );
+
+/*++
+
+Routine Description:
+
+    This routine programs the receive interrupt moderation timer.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+    InterruptsPerSecond - Supplies the maximum number of receive interrupts
+        per second, or zero to disable moderation.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Administrative functions called by the hardware side.
 //
@@ -64,8 +64,14 @@ AtlpSendPendingPackets (
     PATL1C_DEVICE Device
     );
 
-VOID
+ULONG
 AtlpReapReceivedFrames (
+    PATL1C_DEVICE Device,
+    ULONG Budget
+    );
+
+VOID
+AtlpProgramInterruptTimers (
     PATL1C_DEVICE Device
     );
 
@@ -456,6 +462,7 @@ Return Value:
     Device->Speed = AtlSpeedOff;
     Device->Duplex = AtlDuplexInvalid;
     Device->EnabledInterrupts = ATL_INTERRUPT_DEFAULT_MASK;
+    Device->ReceiveInterruptTimer = ATL_RECEIVE_INTERRUPT_TIMER_VALUE;
 
     //
     // Allocate the transmit and receive locks.
@@ -799,14 +806,7 @@ Return Value:
     // Set up the interrupt moderator timer.
     //
 
-    Value = ((ATL_MICROSECONDS(ATL_TRANSMIT_INTERRUPT_TIMER_VALUE) &
-              ATL_INTERRUPT_TIMER_TRANSMIT_MASK) <<
-             ATL_INTERRUPT_TIMER_TRANSMIT_SHIFT) |
-            ((ATL_MICROSECONDS(ATL_RECEIVE_INTERRUPT_TIMER_VALUE) &
-              ATL_INTERRUPT_TIMER_RECEIVE_MASK) <<
-             ATL_INTERRUPT_TIMER_RECEIVE_SHIFT);
-
-    ATL_WRITE_REGISTER32(Device, AtlRegisterInterruptTimers, Value);
+    AtlpProgramInterruptTimers(Device);
 
     //
     // Set the timers to be enabled, and disable interrupt status clear on
@@ -1057,6 +1057,7 @@ Return Value:
 {
 
     PATL1C_DEVICE Device;
+    RUNLEVEL OldRunLevel;
     ULONG PendingBits;
     INTERRUPT_STATUS Status;
 
@@ -1080,11 +1081,20 @@ Return Value:
     }
 
     //
-    // If the interrupt indicates new packets are coming in, grab them.
+    // If the interrupt indicates new packets are coming in, mask the receive
+    // interrupts and let the networking core poll for them until the ring is
+    // drained.
     //
 
     if ((PendingBits & ATL_INTERRUPT_RECEIVE_PACKET_MASK) != 0) {
-        AtlpReapReceivedFrames(Device);
+        OldRunLevel = AtlpAcquireInterruptLock(Device);
+        Device->EnabledInterrupts &= ~ATL_INTERRUPT_RECEIVE_PACKET_MASK;
+        ATL_WRITE_REGISTER32(Device,
+                             AtlRegisterInterruptMask,
+                             Device->EnabledInterrupts);
+
+        AtlpReleaseInterruptLock(Device, OldRunLevel);
+        NetSchedulePoll(Device->NetworkLink);
     }
 
     //
@@ -1120,6 +1130,114 @@ Return Value:
     return Status;
 }
 
+ULONG
+AtlpPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupts are masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+{
+
+    return AtlpReapReceivedFrames(DeviceContext, Budget);
+}
+
+VOID
+AtlpEnableReceiveInterrupt (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PATL1C_DEVICE Device;
+    RUNLEVEL OldRunLevel;
+
+    Device = DeviceContext;
+    OldRunLevel = AtlpAcquireInterruptLock(Device);
+    Device->EnabledInterrupts |= ATL_INTERRUPT_RECEIVE_PACKET_MASK;
+    ATL_WRITE_REGISTER32(Device,
+                         AtlRegisterInterruptMask,
+                         Device->EnabledInterrupts);
+
+    AtlpReleaseInterruptLock(Device, OldRunLevel);
+    return;
+}
+
+VOID
+AtlpSetInterruptRate (
+    PVOID DeviceContext,
+    ULONG InterruptsPerSecond
+    )
+
+/*++
+
+Routine Description:
+
+    This routine programs the receive interrupt moderation timer.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the ATL1c device.
+
+    InterruptsPerSecond - Supplies the maximum number of receive interrupts
+        per second, or zero to disable moderation.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PATL1C_DEVICE Device;
+
+    Device = DeviceContext;
+    Device->ReceiveInterruptTimer = 0;
+    if (InterruptsPerSecond != 0) {
+        Device->ReceiveInterruptTimer = (ULONG)MICROSECONDS_PER_SECOND /
+                                        InterruptsPerSecond;
+    }
+
+    AtlpProgramInterruptTimers(Device);
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1287,24 +1405,27 @@ Return Value:
     return;
 }
 
-VOID
+ULONG
 AtlpReapReceivedFrames (
-    PATL1C_DEVICE Device
+    PATL1C_DEVICE Device,
+    ULONG Budget
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes any received frames from the network.
+    This routine processes received frames from the network.
 
 Arguments:
 
     Device - Supplies a pointer to the device.
 
+    Budget - Supplies the maximum number of frames to process.
+
 Return Value:
 
-    None.
+    Returns the number of frames processed.
 
 --*/
 
@@ -1329,7 +1450,7 @@ Return Value:
     Packet.Flags = 0;
     KeAcquireQueuedLock(Device->ReceiveLock);
     OriginalNextToClean = Device->ReceiveNextToClean;
-    while (TRUE) {
+    while (FramesProcessed < Budget) {
         CurrentIndex = Device->ReceiveNextToClean;
         ReceivedPacket = &(Device->ReceivedPacket[CurrentIndex]);
 
@@ -1412,6 +1533,47 @@ Return Value:
     }
 
     KeReleaseQueuedLock(Device->ReceiveLock);
+    return FramesProcessed;
+}
+
+VOID
+AtlpProgramInterruptTimers (
+    PATL1C_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes the transmit and receive interrupt moderation timers
+    to the device.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG ReceiveTimer;
+    ULONG Value;
+
+    ReceiveTimer = ATL_MICROSECONDS(Device->ReceiveInterruptTimer);
+    if (ReceiveTimer > ATL_INTERRUPT_TIMER_RECEIVE_MASK) {
+        ReceiveTimer = ATL_INTERRUPT_TIMER_RECEIVE_MASK;
+    }
+
+    Value = ((ATL_MICROSECONDS(ATL_TRANSMIT_INTERRUPT_TIMER_VALUE) &
+              ATL_INTERRUPT_TIMER_TRANSMIT_MASK) <<
+             ATL_INTERRUPT_TIMER_TRANSMIT_SHIFT) |
+            (ReceiveTimer << ATL_INTERRUPT_TIMER_RECEIVE_SHIFT);
+
+    ATL_WRITE_REGISTER32(Device, AtlRegisterInterruptTimers, Value);
     return;
 }
 
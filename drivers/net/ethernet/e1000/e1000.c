@@ -101,7 +101,8 @@ E1000DestroyLink (
 
 KSTATUS
 E1000pProcessResourceRequirements (
-    PIRP Irp
+    PIRP Irp,
+    PE1000_DEVICE Device
     );
 
 KSTATUS
@@ -110,11 +111,21 @@ E1000pStartDevice (
     PE1000_DEVICE Device
     );
 
+VOID
+E1000pProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
 
 PDRIVER E1000Driver = NULL;
+UUID E1000PciMsiInterfaceUuid = UUID_PCI_MESSAGE_SIGNALED_INTERRUPTS;
 
 //
 // List the supported PCI devices and what is known about them. All are assumed
@@ -332,7 +343,7 @@ Return Value:
     if (Irp->Direction == IrpUp) {
         switch (Irp->MinorCode) {
         case IrpMinorQueryResources:
-            Status = E1000pProcessResourceRequirements(Irp);
+            Status = E1000pProcessResourceRequirements(Irp, DeviceContext);
             if (!KSUCCESS(Status)) {
                 IoCompleteIrp(E1000Driver, Irp, Status);
             }
@@ -574,6 +585,7 @@ Return Value:
 
 {
 
+    NET_POLL_PROPERTIES PollProperties;
     NET_LINK_PROPERTIES Properties;
     KSTATUS Status;
 
@@ -608,6 +620,25 @@ Return Value:
         goto AddNetworkDeviceEnd;
     }
 
+    //
+    // Receive frames are processed by the networking core polling the
+    // receive ring, which also adapts the interrupt throttling rate.
+    //
+
+    RtlZeroMemory(&PollProperties, sizeof(NET_POLL_PROPERTIES));
+    PollProperties.Version = NET_POLL_PROPERTIES_VERSION;
+    PollProperties.DeviceContext = Device;
+    PollProperties.Budget = NET_POLL_DEFAULT_BUDGET;
+    PollProperties.Interface.Poll = E1000pPollReceive;
+    PollProperties.Interface.EnableReceiveInterrupt =
+                                                E1000pEnableReceiveInterrupt;
+
+    PollProperties.Interface.SetInterruptRate = E1000pSetInterruptRate;
+    Status = NetCreatePoll(Device->NetworkLink, &PollProperties);
+    if (!KSUCCESS(Status)) {
+        goto AddNetworkDeviceEnd;
+    }
+
 AddNetworkDeviceEnd:
     if (!KSUCCESS(Status)) {
         if (Device->NetworkLink != NULL) {
@@ -625,7 +656,8 @@ Return Value:
 
 KSTATUS
 E1000pProcessResourceRequirements (
-    PIRP Irp
+    PIRP Irp,
+    PE1000_DEVICE Device
     )
 
 /*++
@@ -633,13 +665,16 @@ E1000pProcessResourceRequirements (
 Routine Description:
 
     This routine filters through the resource requirements presented by the
-    bus for an e1000 LAN controller. It adds an interrupt vector requirement for
-    any interrupt line requested.
+    bus for an e1000 LAN controller. It prefers a message signaled interrupt
+    if the device supports one, and otherwise adds an interrupt vector
+    requirement for any interrupt line requested.
 
 Arguments:
 
     Irp - Supplies a pointer to the I/O request packet.
 
+    Device - Supplies a pointer to the device information.
+
 Return Value:
 
     Status code.
@@ -666,15 +701,50 @@ Return Value:
     VectorRequirement.Length = 1;
 
     //
-    // Loop through all configuration lists, creating a vector for each line.
+    // PCI Express e1000 parts support MSI. If the interface is ever going to
+    // show up, it shows up during registration.
+    //
+
+    if ((Device->PciMsiFlags & E1000_PCI_MSI_FLAG_INTERFACE_REGISTERED) == 0) {
+        Status = IoRegisterForInterfaceNotifications(
+                                &E1000PciMsiInterfaceUuid,
+                                E1000pProcessPciMsiInterfaceChangeNotification,
+                                Irp->Device,
+                                Device,
+                                TRUE);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Device->PciMsiFlags |= E1000_PCI_MSI_FLAG_INTERFACE_REGISTERED;
+    }
+
+    //
+    // The driver services all causes from a single interrupt, so one message
+    // signaled vector is enough. Legacy vectors are added as alternatives.
     //
 
     Requirements = Irp->U.QueryResources.ResourceRequirements;
-    Status = IoCreateAndAddInterruptVectorsForLines(Requirements,
-                                                    &VectorRequirement);
+    if ((Device->PciMsiFlags & E1000_PCI_MSI_FLAG_INTERFACE_AVAILABLE) != 0) {
+        Status = IoCreateAndAddMessageSignaledInterruptVectors(Requirements, 1);
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
 
-    if (!KSUCCESS(Status)) {
-        goto ProcessResourceRequirementsEnd;
+        Device->PciMsiFlags |= E1000_PCI_MSI_FLAG_RESOURCES_REQUESTED;
+
+    //
+    // Loop through all configuration lists, creating a vector for each line.
+    //
+
+    } else {
+        Status = IoCreateAndAddInterruptVectorsForLines(Requirements,
+                                                        &VectorRequirement);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
     }
 
 ProcessResourceRequirementsEnd:
@@ -715,6 +785,8 @@ Return Value:
     PHYSICAL_ADDRESS EndAddress;
     PRESOURCE_ALLOCATION FlashBase;
     PRESOURCE_ALLOCATION LineAllocation;
+    PINTERFACE_PCI_MSI MsiInterface;
+    PCI_MSI_TYPE MsiType;
     ULONG PageSize;
     PHYSICAL_ADDRESS PhysicalAddress;
     ULONG Size;
@@ -733,8 +805,8 @@ Return Value:
     while (Allocation != NULL) {
 
         //
-        // If the resource is an interrupt vector, then it should have an
-        // owning interrupt line allocation.
+        // If the resource is an interrupt vector, then it should either have
+        // an owning interrupt line allocation or be a message signaled vector.
         //
 
         if (Allocation->Type == ResourceTypeInterruptVector) {
@@ -744,14 +816,24 @@ Return Value:
             //
 
             ASSERT(Device->InterruptResourcesFound == FALSE);
-            ASSERT(Allocation->OwningAllocation != NULL);
 
             //
             // Save the line and vector number.
             //
 
             LineAllocation = Allocation->OwningAllocation;
-            Device->InterruptLine = LineAllocation->Allocation;
+            if (LineAllocation == NULL) {
+
+                ASSERT((Device->PciMsiFlags &
+                        E1000_PCI_MSI_FLAG_RESOURCES_REQUESTED) != 0);
+
+                Device->InterruptLine = INVALID_INTERRUPT_LINE;
+                Device->PciMsiFlags |= E1000_PCI_MSI_FLAG_RESOURCES_ALLOCATED;
+
+            } else {
+                Device->InterruptLine = LineAllocation->Allocation;
+            }
+
             Device->InterruptVector = Allocation->Allocation;
             Device->InterruptResourcesFound = TRUE;
 
@@ -887,6 +969,28 @@ Return Value:
         goto StartDeviceEnd;
     }
 
+    //
+    // If an MSI vector was allocated, it additionally needs to be enabled
+    // through the PCI interface.
+    //
+
+    if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
+
+        ASSERT((Device->PciMsiFlags &
+                E1000_PCI_MSI_FLAG_RESOURCES_ALLOCATED) != 0);
+
+        MsiInterface = &(Device->PciMsiInterface);
+        Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                             Device->InterruptVector,
+                                             1,
+                                             NULL,
+                                             &MsiType);
+
+        if (!KSUCCESS(Status)) {
+            goto StartDeviceEnd;
+        }
+    }
+
     ASSERT(Device->NetworkLink != NULL);
 
     E1000pEnableInterrupts(Device);
@@ -895,3 +999,64 @@ Return Value:
     return Status;
 }
 
+VOID
+E1000pProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a PCI MSI interface changes in availability.
+
+Arguments:
+
+    Context - Supplies the caller's context pointer, supplied when the caller
+        requested interface notifications.
+
+    Device - Supplies a pointer to the device exposing or deleting the
+        interface.
+
+    InterfaceBuffer - Supplies a pointer to the interface buffer of the
+        interface.
+
+    InterfaceBufferSize - Supplies the buffer size.
+
+    Arrival - Supplies TRUE if a new interface is arriving, or FALSE if an
+        interface is departing.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PE1000_DEVICE E1000Device;
+
+    E1000Device = (PE1000_DEVICE)Context;
+    if (Arrival != FALSE) {
+        if (InterfaceBufferSize >= sizeof(INTERFACE_PCI_MSI)) {
+
+            ASSERT((E1000Device->PciMsiFlags &
+                    E1000_PCI_MSI_FLAG_INTERFACE_AVAILABLE) == 0);
+
+            RtlCopyMemory(&(E1000Device->PciMsiInterface),
+                          InterfaceBuffer,
+                          sizeof(INTERFACE_PCI_MSI));
+
+            E1000Device->PciMsiFlags |= E1000_PCI_MSI_FLAG_INTERFACE_AVAILABLE;
+        }
+
+    } else {
+        E1000Device->PciMsiFlags &= ~E1000_PCI_MSI_FLAG_INTERFACE_AVAILABLE;
+    }
+
+    return;
+}
@@ -26,6 +26,8 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+#include <minoca/intrface/pci.h>
+
 //
 // --------------------------------------------------------------------- Macros
 //
@@ -57,6 +59,16 @@ Module Name:
 
 #define E1000_ALLOCATION_TAG 0x6B314549
 
+//
+// Define a set of flags used to determine if MSI/MSI-X interrupt should be
+// used.
+//
+
+#define E1000_PCI_MSI_FLAG_INTERFACE_REGISTERED 0x00000001
+#define E1000_PCI_MSI_FLAG_INTERFACE_AVAILABLE  0x00000002
+#define E1000_PCI_MSI_FLAG_RESOURCES_REQUESTED  0x00000004
+#define E1000_PCI_MSI_FLAG_RESOURCES_ALLOCATED  0x00000008
+
 //
 // Define the size of receive frame data.
 //
@@ -536,6 +548,20 @@ Module Name:
 #define E1000_INTERRUPT_TX_LOW_THRESHOLD (1 << 15)
 #define E1000_INTERRUPT_SMALL_RX_PACKET (1 << 16)
 
+//
+// Define the mask of interrupts that signal received frames. These are left
+// masked while the networking core polls the receive ring.
+//
+
+#define E1000_INTERRUPT_RECEIVE_MASK \
+    (E1000_INTERRUPT_RX_TIMER | E1000_INTERRUPT_RX_MIN_THRESHOLD)
+
+//
+// Define the unit of the interrupt throttling rate register, in nanoseconds.
+//
+
+#define E1000_INTERRUPT_THROTTLE_UNIT_NANOSECONDS 256
+
 //
 // Define the mask of interrupts to enable here.
 //
@@ -952,7 +978,8 @@ Structure Description:
     OsDevice - Stores a pointer to the OS device object.
 
     InterruptLine - Stores the interrupt line that this controller's interrupt
-        comes in on.
+        comes in on. This is INVALID_INTERRUPT_LINE if the controller is using
+        a message signaled interrupt.
 
     InterruptVector - Stores the interrupt vector that this controller's
         interrupt comes in on.
@@ -1034,6 +1061,12 @@ Structure Description:
     ConfigurationLock - Stores a queued lock that synchronizes changes to the
         enabled capabilities field and their supporting hardware registers.
 
+    PciMsiFlags - Stores a bitmask of flags indicating whether or not MSI/MSI-X
+        interrupts should be used. See E1000_PCI_MSI_FLAG_* for definitions.
+
+    PciMsiInterface - Stores the interface to enable PCI message signaled
+        interrupts.
+
 --*/
 
 typedef struct _E1000_DEVICE {
@@ -1070,6 +1103,8 @@ typedef struct _E1000_DEVICE {
     ULONG SupportedCapabilities;
     ULONG EnabledCapabilities;
     PQUEUED_LOCK ConfigurationLock;
+    ULONG PciMsiFlags;
+    INTERFACE_PCI_MSI PciMsiInterface;
 } E1000_DEVICE, *PE1000_DEVICE;
 
 //
@@ -1262,6 +1297,78 @@ Return Value:
 
 --*/
 
+ULONG
+E1000pPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    );
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupt is masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+VOID
+E1000pEnableReceiveInterrupt (
+    PVOID DeviceContext
+    );
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+E1000pSetInterruptRate (
+    PVOID DeviceContext,
+    ULONG InterruptsPerSecond
+    );
+
+/*++
+
+Routine Description:
+
+    This routine programs the interrupt throttling rate.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+    InterruptsPerSecond - Supplies the maximum number of interrupts per
+        second, or zero to disable throttling.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Administrative functions called by the hardware side.
 //
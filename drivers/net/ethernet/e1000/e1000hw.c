@@ -183,9 +183,10 @@ E1000pReapTxDescriptors (
     PE1000_DEVICE Device
     );
 
-VOID
+ULONG
 E1000pReapReceivedFrames (
-    PE1000_DEVICE Device
+    PE1000_DEVICE Device,
+    ULONG Budget
     );
 
 VOID
@@ -1050,10 +1051,13 @@ Return Value:
     }
 
     //
-    // Process new receive frames.
+    // Hand received frames off to the networking core, which polls the
+    // receive ring with the receive interrupts masked until it is drained.
     //
 
-    E1000pReapReceivedFrames(Device);
+    if ((PendingBits & E1000_INTERRUPT_RECEIVE_MASK) != 0) {
+        NetSchedulePoll(Device->NetworkLink);
+    }
 
     //
     // If the command unit finished what it was up to, reap that memory.
@@ -1064,13 +1068,125 @@ Return Value:
     }
 
     //
-    // Re-enable interrupts now that they've been serviced.
+    // Re-enable interrupts now that they've been serviced. The receive
+    // interrupts are re-enabled when the poll completes.
     //
 
-    E1000_WRITE(Device, E1000InterruptMaskSet, PendingBits);
+    PendingBits &= ~E1000_INTERRUPT_RECEIVE_MASK;
+    if (PendingBits != 0) {
+        E1000_WRITE(Device, E1000InterruptMaskSet, PendingBits);
+    }
+
     return InterruptStatusClaimed;
 }
 
+ULONG
+E1000pPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupt is masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+{
+
+    return E1000pReapReceivedFrames(DeviceContext, Budget);
+}
+
+VOID
+E1000pEnableReceiveInterrupt (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PE1000_DEVICE Device;
+
+    Device = DeviceContext;
+    E1000_WRITE(Device, E1000InterruptMaskSet, E1000_INTERRUPT_RECEIVE_MASK);
+    return;
+}
+
+VOID
+E1000pSetInterruptRate (
+    PVOID DeviceContext,
+    ULONG InterruptsPerSecond
+    )
+
+/*++
+
+Routine Description:
+
+    This routine programs the interrupt throttling rate.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the e1000 device.
+
+    InterruptsPerSecond - Supplies the maximum number of interrupts per
+        second, or zero to disable throttling.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PE1000_DEVICE Device;
+    ULONG Interval;
+
+    Device = DeviceContext;
+    Interval = 0;
+    if (InterruptsPerSecond != 0) {
+        Interval = (ULONG)NANOSECONDS_PER_SECOND /
+                   (InterruptsPerSecond *
+                    E1000_INTERRUPT_THROTTLE_UNIT_NANOSECONDS);
+
+        if (Interval > MAX_USHORT) {
+            Interval = MAX_USHORT;
+        }
+    }
+
+    E1000_WRITE(Device, E1000InterruptThrottlingRate, Interval);
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -2669,39 +2785,46 @@ Return Value:
     return;
 }
 
-VOID
+ULONG
 E1000pReapReceivedFrames (
-    PE1000_DEVICE Device
+    PE1000_DEVICE Device,
+    ULONG Budget
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes any received frames from the network.
+    This routine processes received frames from the network.
 
 Arguments:
 
     Device - Supplies a pointer to the device.
 
+    Budget - Supplies the maximum number of frames to process.
+
 Return Value:
 
-    None.
+    Returns the number of frames processed.
 
 --*/
 
 {
 
+    ULONG Count;
     PE1000_RX_DESCRIPTOR Descriptor;
     ULONG DescriptorIndex;
     ULONG Flags;
     ULONG NewTail;
     PNET_PACKET_BUFFER Packet;
 
+    Count = 0;
     KeAcquireQueuedLock(Device->RxListLock);
     DescriptorIndex = Device->RxListBegin;
     Descriptor = &(Device->RxDescriptors[DescriptorIndex]);
-    while ((Descriptor->Status & E1000_RX_STATUS_DONE) != 0) {
+    while ((Count < Budget) &&
+           ((Descriptor->Status & E1000_RX_STATUS_DONE) != 0)) {
+
 
         //
         // Handling packets that spawn multiple descriptors is not currently
@@ -2762,6 +2885,7 @@ Return Value:
 
         Packet->Flags = Flags;
         NetProcessReceivedPacket(Device->NetworkLink, Packet);
+        Count += 1;
         Descriptor->Status = 0;
         DescriptorIndex += 1;
         if (DescriptorIndex == E1000_RX_RING_SIZE) {
@@ -2789,7 +2913,7 @@ Return Value:
     }
 
     KeReleaseQueuedLock(Device->RxListLock);
-    return;
+    return Count;
 }
 
 VOID
@@ -492,6 +492,7 @@ Return Value:
 {
 
     PNET_PACKET_SIZE_INFORMATION PacketSizeInformation;
+    NET_POLL_PROPERTIES PollProperties;
     NET_LINK_PROPERTIES Properties;
     KSTATUS Status;
 
@@ -531,6 +532,25 @@ Return Value:
         goto AddNetworkDeviceEnd;
     }
 
+    //
+    // Received frames are processed by the networking core polling the
+    // receive ring. The RTL81xx has no interrupt throttling register, so the
+    // interrupt rate is left alone.
+    //
+
+    RtlZeroMemory(&PollProperties, sizeof(NET_POLL_PROPERTIES));
+    PollProperties.Version = NET_POLL_PROPERTIES_VERSION;
+    PollProperties.DeviceContext = Device;
+    PollProperties.Budget = NET_POLL_DEFAULT_BUDGET;
+    PollProperties.Interface.Poll = Rtl81pPollReceive;
+    PollProperties.Interface.EnableReceiveInterrupt =
+                                                Rtl81pEnableReceiveInterrupt;
+
+    Status = NetCreatePoll(Device->NetworkLink, &PollProperties);
+    if (!KSUCCESS(Status)) {
+        goto AddNetworkDeviceEnd;
+    }
+
 AddNetworkDeviceEnd:
     if (!KSUCCESS(Status)) {
         if (Device->NetworkLink != NULL) {
@@ -605,14 +625,7 @@ Return Value:
 {
 
     PRESOURCE_CONFIGURATION_LIST ConfigurationList;
-    ULONGLONG EdgeTriggered;
-    ULONGLONG LineCharacteristics;
-    PRESOURCE_REQUIREMENT NextRequirement;
-    PRESOURCE_REQUIREMENT Requirement;
-    PRESOURCE_REQUIREMENT_LIST RequirementList;
     KSTATUS Status;
-    ULONGLONG VectorCharacteristics;
-    PRESOURCE_REQUIREMENT VectorRequirement;
     RESOURCE_REQUIREMENT VectorTemplate;
 
     ASSERT((Irp->MajorCode == IrpMajorStateChange) &&
@@ -651,78 +664,18 @@ Return Value:
     //
     // If the MSI interface is ever going to be present, then it should have
     // been registered immediately. Prepare the device to prefer MSI interrupts.
+    // The RTL81xx devices only ever need one interrupt vector. Legacy vectors
+    // are added as alternatives in case the MSI vector cannot be allocated.
     //
 
     ConfigurationList = Irp->U.QueryResources.ResourceRequirements;
     if ((Device->PciMsiFlags & RTL81_PCI_MSI_FLAG_INTERFACE_AVAILABLE) != 0) {
+        Status = IoCreateAndAddMessageSignaledInterruptVectors(
+                                                            ConfigurationList,
+                                                            1);
 
-        //
-        // The RTl81xx devices only ever need one interrupt vector. Create one
-        // for every configuration.
-        //
-
-        RequirementList = IoGetNextResourceConfiguration(ConfigurationList,
-                                                         NULL);
-
-        while (RequirementList != NULL) {
-            VectorTemplate.Characteristics = INTERRUPT_VECTOR_EDGE_TRIGGERED;
-            VectorTemplate.OwningRequirement = NULL;
-            Status = IoCreateAndAddResourceRequirement(&VectorTemplate,
-                                                       RequirementList,
-                                                       &VectorRequirement);
-
-            if (!KSUCCESS(Status)) {
-                goto ProcessResourceRequirementsEnd;
-            }
-
-            //
-            // Now, just in case the above vector allocation fails, prepare to
-            // fall back to legacy interrupts by allocating an alternative
-            // vector for each interrupt in the requirement list.
-            //
-
-            Requirement = IoGetNextResourceRequirement(RequirementList, NULL);
-            while (Requirement != NULL) {
-                NextRequirement = IoGetNextResourceRequirement(RequirementList,
-                                                               Requirement);
-
-                if (Requirement->Type != ResourceTypeInterruptLine) {
-                    Requirement = NextRequirement;
-                    continue;
-                }
-
-                VectorCharacteristics = 0;
-                LineCharacteristics = Requirement->Characteristics;
-                if ((LineCharacteristics & INTERRUPT_LINE_ACTIVE_LOW) != 0) {
-                    VectorCharacteristics |= INTERRUPT_VECTOR_ACTIVE_LOW;
-                }
-
-                if ((LineCharacteristics & INTERRUPT_LINE_ACTIVE_HIGH) != 0) {
-                    VectorCharacteristics |= INTERRUPT_VECTOR_ACTIVE_HIGH;
-                }
-
-                EdgeTriggered = LineCharacteristics &
-                                INTERRUPT_LINE_EDGE_TRIGGERED;
-
-                if (EdgeTriggered != 0) {
-                    VectorCharacteristics |= INTERRUPT_VECTOR_EDGE_TRIGGERED;
-                }
-
-                VectorTemplate.Characteristics = VectorCharacteristics;
-                VectorTemplate.OwningRequirement = Requirement;
-                Status = IoCreateAndAddResourceRequirementAlternative(
-                                                            &VectorTemplate,
-                                                            VectorRequirement);
-
-                if (!KSUCCESS(Status)) {
-                    goto ProcessResourceRequirementsEnd;
-                }
-
-                Requirement = NextRequirement;
-            }
-
-            RequirementList = IoGetNextResourceConfiguration(ConfigurationList,
-                                                             RequirementList);
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
         }
 
         Device->PciMsiFlags |= RTL81_PCI_MSI_FLAG_RESOURCES_REQUESTED;
@@ -783,12 +736,10 @@ Return Value:
     PHYSICAL_ADDRESS EndAddress;
     BOOL Initialized;
     PRESOURCE_ALLOCATION LineAllocation;
-    PCI_MSI_INFORMATION MsiInformation;
     PINTERFACE_PCI_MSI MsiInterface;
     PCI_MSI_TYPE MsiType;
     ULONG PageSize;
     PHYSICAL_ADDRESS PhysicalAddress;
-    PROCESSOR_SET ProcessorSet;
     ULONG Size;
     KSTATUS Status;
 
@@ -934,7 +885,7 @@ Return Value:
 
     //
     // If MSI/MSI-X resources were allocated, then those additionally need to
-    // be enabled through the PCI interface. Prefer MSI and fall back to MSI-X.
+    // be enabled through the PCI interface.
     //
 
     if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
@@ -942,38 +893,12 @@ Return Value:
         ASSERT((Device->PciMsiFlags &
                 RTL81_PCI_MSI_FLAG_RESOURCES_ALLOCATED) != 0);
 
-        ProcessorSet.Target = ProcessorTargetAny;
-        MsiType = PciMsiTypeBasic;
         MsiInterface = &(Device->PciMsiInterface);
-        Status = MsiInterface->SetVectors(MsiInterface->DeviceToken,
-                                          MsiType,
-                                          Device->InterruptVector,
-                                          0,
-                                          1,
-                                          &ProcessorSet);
-
-        if (!KSUCCESS(Status)) {
-            MsiType = PciMsiTypeExtended;
-            Status = MsiInterface->SetVectors(MsiInterface->DeviceToken,
-                                              MsiType,
-                                              Device->InterruptVector,
-                                              0,
-                                              1,
-                                              &ProcessorSet);
-
-            if (!KSUCCESS(Status)) {
-                goto StartDeviceEnd;
-            }
-        }
-
-        RtlZeroMemory(&MsiInformation, sizeof(PCI_MSI_INFORMATION));
-        MsiInformation.Version = PCI_MSI_INTERFACE_INFORMATION_VERSION;
-        MsiInformation.MsiType = MsiType;
-        MsiInformation.Flags = PCI_MSI_INTERFACE_FLAG_ENABLED;
-        MsiInformation.VectorCount = 1;
-        Status = MsiInterface->GetSetInformation(MsiInterface->DeviceToken,
-                                                 &MsiInformation,
-                                                 TRUE);
+        Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                             Device->InterruptVector,
+                                             1,
+                                             NULL,
+                                             &MsiType);
 
         if (!KSUCCESS(Status)) {
             goto StartDeviceEnd;
@@ -985,6 +985,9 @@ Structure Description:
     InterruptHandle - Stores a pointer to the handle received when the
         interrupt was connected.
 
+    InterruptLock - Stores a spin lock, synchronized with the interrupt, that
+        protects the interrupt mask.
+
     TransmitLock - Stores a queued lock that protects access to the transmit
         packet list and various other values.
 
@@ -1000,6 +1003,10 @@ Structure Description:
     ReceiveInterruptMask - Stores a mask of interrupt status bits that trigger
         the processing of received frames.
 
+    InterruptMask - Stores the mask of currently enabled interrupts. The
+        receive interrupts are removed while the networking core is polling
+        for received frames.
+
     PciMsiFlags - Stores a bitmask of flags indicating whether or not MSI/MSI-X
         interrupts should be used. See RTL81_PCI_MSI_FLAG_* for definitions.
 
@@ -1042,11 +1049,13 @@ typedef struct _RTL81_DEVICE {
     ULONGLONG InterruptVector;
     BOOL InterruptResourcesFound;
     HANDLE InterruptHandle;
+    KSPIN_LOCK InterruptLock;
     PQUEUED_LOCK TransmitLock;
     PQUEUED_LOCK ReceiveLock;
     PQUEUED_LOCK ConfigurationLock;
     USHORT TransmitInterruptMask;
     USHORT ReceiveInterruptMask;
+    USHORT InterruptMask;
     ULONG PciMsiFlags;
     INTERFACE_PCI_MSI PciMsiInterface;
     volatile ULONG PendingInterrupts;
@@ -1250,6 +1259,53 @@ Return Value:
 
 --*/
 
+ULONG
+Rtl81pPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    );
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupts are masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the RTL81xx device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+VOID
+Rtl81pEnableReceiveInterrupt (
+    PVOID DeviceContext
+    );
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the RTL81xx device.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Administrative functions called by the hardware side.
 //
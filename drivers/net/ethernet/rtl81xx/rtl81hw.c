@@ -102,19 +102,22 @@ Rtl81pSendPacketsDefault (
     PRTL81_DEVICE Device
     );
 
-VOID
+ULONG
 Rtl81pReapReceivedFrames (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     );
 
-VOID
+ULONG
 Rtl81pReapReceivedFramesLegacy (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     );
 
-VOID
+ULONG
 Rtl81pReapReceivedFramesDefault (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     );
 
 VOID
@@ -474,6 +477,9 @@ Return Value:
         goto InitializeDeviceStructuresEnd;
     }
 
+    KeInitializeSpinLock(&(Device->InterruptLock));
+    Device->InterruptMask = RTL81_DEFAULT_INTERRUPT_MASK;
+
     ASSERT(Device->ReceiveLock == NULL);
 
     Device->ReceiveLock = KeCreateQueuedLock();
@@ -1038,7 +1044,7 @@ Return Value:
 
     RTL81_WRITE_REGISTER16(Device,
                            Rtl81RegisterInterruptMask,
-                           RTL81_DEFAULT_INTERRUPT_MASK);
+                           Device->InterruptMask);
 
     Status = STATUS_SUCCESS;
 
@@ -1080,12 +1086,29 @@ Return Value:
     // Read the status register, and if nothing is set then return immediately.
     //
 
+    //
+    // Masked receive status bits are left latched while the networking core
+    // polls, so that unmasking them fires an interrupt if more frames
+    // arrived.
+    //
+
+    KeAcquireSpinLock(&(Device->InterruptLock));
     PendingBits = RTL81_READ_REGISTER16(Device, Rtl81RegisterInterruptStatus);
-    PendingBits &= RTL81_DEFAULT_INTERRUPT_MASK;
+    PendingBits &= Device->InterruptMask;
     if (PendingBits == 0) {
+        KeReleaseSpinLock(&(Device->InterruptLock));
         return InterruptStatusNotClaimed;
     }
 
+    //
+    // Mask the receive interrupts until the networking core has drained the
+    // receive ring.
+    //
+
+    if ((PendingBits & Device->ReceiveInterruptMask) != 0) {
+        Device->InterruptMask &= ~(Device->ReceiveInterruptMask);
+    }
+
     //
     // The RTL81xx devices that use MSIs require interrupts to be disabled and
     // enabled after each interrupt, otherwise the interrupts eventually stop
@@ -1097,8 +1120,9 @@ Return Value:
     RTL81_WRITE_REGISTER16(Device, Rtl81RegisterInterruptStatus, PendingBits);
     RTL81_WRITE_REGISTER16(Device,
                            Rtl81RegisterInterruptMask,
-                           RTL81_DEFAULT_INTERRUPT_MASK);
+                           Device->InterruptMask);
 
+    KeReleaseSpinLock(&(Device->InterruptLock));
     RtlAtomicOr32(&(Device->PendingInterrupts), PendingBits);
     return InterruptStatusClaimed;
 }
@@ -1163,11 +1187,12 @@ Return Value:
     }
 
     //
-    // If a packet was received, process it.
+    // If a packet was received, have the networking core poll for it. The
+    // receive interrupts stay masked until the poll drains the ring.
     //
 
     if ((PendingBits & Device->ReceiveInterruptMask) != 0) {
-        Rtl81pReapReceivedFrames(Device);
+        NetSchedulePoll(Device->NetworkLink);
     }
 
     //
@@ -1182,6 +1207,79 @@ Return Value:
     return InterruptStatusClaimed;
 }
 
+ULONG
+Rtl81pPollReceive (
+    PVOID DeviceContext,
+    ULONG Budget
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes received frames on behalf of the networking core
+    while the receive interrupts are masked.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the RTL81xx device.
+
+    Budget - Supplies the maximum number of frames to process.
+
+Return Value:
+
+    Returns the number of frames processed.
+
+--*/
+
+{
+
+    return Rtl81pReapReceivedFrames(DeviceContext, Budget);
+}
+
+VOID
+Rtl81pEnableReceiveInterrupt (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the receive interrupts once the networking core has
+    drained the receive ring.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the RTL81xx device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PRTL81_DEVICE Device;
+    RUNLEVEL OldRunLevel;
+
+    Device = DeviceContext;
+
+    ASSERT(Device->InterruptHandle != INVALID_HANDLE);
+
+    OldRunLevel = IoRaiseToInterruptRunLevel(Device->InterruptHandle);
+    KeAcquireSpinLock(&(Device->InterruptLock));
+    Device->InterruptMask |= Device->ReceiveInterruptMask;
+    RTL81_WRITE_REGISTER16(Device,
+                           Rtl81RegisterInterruptMask,
+                           Device->InterruptMask);
+
+    KeReleaseSpinLock(&(Device->InterruptLock));
+    KeLowerRunLevel(OldRunLevel);
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1907,9 +2005,10 @@ Return Value:
     return;
 }
 
-VOID
+ULONG
 Rtl81pReapReceivedFrames (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     )
 
 /*++
@@ -1923,14 +2022,18 @@ Routine Description:
 
     Device - Supplies a pointer to the RTL81xx device.
 
+    Budget - Supplies the maximum number of frames to reap.
+
 Return Value:
 
-    None.
+    Returns the number of frames reaped.
 
 --*/
 
 {
 
+    ULONG Count;
+
     KeAcquireQueuedLock(Device->ReceiveLock);
 
     //
@@ -1939,19 +2042,20 @@ Return Value:
     //
 
     if ((Device->Flags & RTL81_FLAG_TRANSMIT_MODE_LEGACY) != 0) {
-        Rtl81pReapReceivedFramesLegacy(Device);
+        Count = Rtl81pReapReceivedFramesLegacy(Device, Budget);
 
     } else {
-        Rtl81pReapReceivedFramesDefault(Device);
+        Count = Rtl81pReapReceivedFramesDefault(Device, Budget);
     }
 
     KeReleaseQueuedLock(Device->ReceiveLock);
-    return;
+    return Count;
 }
 
-VOID
+ULONG
 Rtl81pReapReceivedFramesLegacy (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     )
 
 /*++
@@ -1965,9 +2069,11 @@ Routine Description:
 
     Device - Supplies a pointer to the RTL81xx device.
 
+    Budget - Supplies the maximum number of frames to reap.
+
 Return Value:
 
-    None.
+    Returns the number of frames reaped.
 
 --*/
 
@@ -1976,6 +2082,7 @@ Return Value:
     USHORT AlignedOffset;
     USHORT BytesReaped;
     BYTE CommandRegister;
+    ULONG Count;
     ULONG CurrentOffset;
     BYTE EarlyStatus;
     USHORT EndOffset;
@@ -2034,13 +2141,16 @@ Return Value:
     PhysicalAddress = Fragment->PhysicalAddress;
 
     //
-    // Loop until the buffer is empty according to the command register or
-    // until the maximum bytes have been reaped.
+    // Loop until the buffer is empty according to the command register, until
+    // the maximum bytes have been reaped, or until the budget runs out.
     //
 
     BytesReaped = 0;
+    Count = 0;
     CommandRegister = RTL81_READ_REGISTER8(Device, Rtl81RegisterCommand);
-    while ((CommandRegister & RTL81_COMMAND_REGISTER_BUFFER_EMPTY) == 0) {
+    while ((Count < Budget) &&
+           ((CommandRegister & RTL81_COMMAND_REGISTER_BUFFER_EMPTY) == 0)) {
+
         Header = (PRTL81_PACKET_HEADER)(VirtualAddress + CurrentOffset);
 
         //
@@ -2157,6 +2267,7 @@ Return Value:
         Packet.DataOffset = 0;
         Packet.FooterOffset = PacketLength;
         NetProcessReceivedPacket(Device->NetworkLink, &Packet);
+        Count += 1;
 
         //
         // Move past this packet. The current offset is set to the end of the
@@ -2199,12 +2310,13 @@ Return Value:
         CommandRegister = RTL81_READ_REGISTER8(Device, Rtl81RegisterCommand);
     }
 
-    return;
+    return Count;
 }
 
-VOID
+ULONG
 Rtl81pReapReceivedFramesDefault (
-    PRTL81_DEVICE Device
+    PRTL81_DEVICE Device,
+    ULONG Budget
     )
 
 /*++
@@ -2219,15 +2331,18 @@ Routine Description:
 
     Device - Supplies a pointer to the RTL81xx device.
 
+    Budget - Supplies the maximum number of frames to reap.
+
 Return Value:
 
-    None.
+    Returns the number of frames reaped.
 
 --*/
 
 {
 
     ULONG Command;
+    ULONG Count;
     PRTL81_DEFAULT_DATA DefaultData;
     PRTL81_RECEIVE_DESCRIPTOR Descriptor;
     ULONG Flags;
@@ -2240,6 +2355,7 @@ Return Value:
 
     ASSERT((Device->Flags & RTL81_FLAG_TRANSMIT_MODE_LEGACY) == 0);
 
+    Count = 0;
     Packet.IoBuffer = NULL;
     Packet.ListEntry.Next = NULL;
     Descriptor = NULL;
@@ -2267,6 +2383,10 @@ Return Value:
             Descriptor->Command = Command;
         }
 
+        if (Count >= Budget) {
+            break;
+        }
+
         //
         // Try to harvest the packet in te next descriptor.
         //
@@ -2384,9 +2504,10 @@ Return Value:
         Packet.DataOffset = 0;
         Packet.FooterOffset = Size;
         NetProcessReceivedPacket(Device->NetworkLink, &Packet);
+        Count += 1;
     }
 
-    return;
+    return Count;
 }
 
 VOID
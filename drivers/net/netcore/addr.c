@@ -813,6 +813,20 @@ Return Value:
         goto GetSetLinkDeviceInformationEnd;
     }
 
+    if ((Link->Poll != NULL) &&
+        (RtlAreUuidsEqual(Uuid, &NetPollInformationUuid) != FALSE)) {
+
+        if (*DataSize < sizeof(NETWORK_POLL_INFORMATION)) {
+            *DataSize = sizeof(NETWORK_POLL_INFORMATION);
+            Status = STATUS_BUFFER_TOO_SMALL;
+            goto GetSetLinkDeviceInformationEnd;
+        }
+
+        *DataSize = sizeof(NETWORK_POLL_INFORMATION);
+        Status = NetpGetSetPollInformation(Link, Data, Set);
+        goto GetSetLinkDeviceInformationEnd;
+    }
+
 GetSetLinkDeviceInformationEnd:
     return Status;
 }
@@ -854,6 +868,8 @@ Return Value:
                                 &NetNetworkDeviceInformationUuid,
                                 FALSE);
 
+    NetDestroyPoll(Link);
+
     //
     // If the link is still up, then send out the notice that is is actually
     // down.
@@ -2672,6 +2688,7 @@ Return Value:
     PNET_NETWORK_ENTRY Network;
     PRED_BLACK_TREE_NODE NextNode;
     PNET_SOCKET NextSocket;
+    PNET_PACKET_BUFFER Packet;
     PRED_BLACK_TREE_NODE PreviousNode;
     PNET_SOCKET PreviousSocket;
     PNET_PROTOCOL_ENTRY Protocol;
@@ -2963,6 +2980,21 @@ Return Value:
             } else {
                 if (FoundSocket->BindingType == SocketFullyBound) {
                     Protocol->LastSocket = FoundSocket;
+
+                    //
+                    // Remember the flow hash so that reads from the socket
+                    // can steer the flow to the reading processor.
+                    //
+
+                    Packet = ReceiveContext->Packet;
+                    if ((Packet != NULL) &&
+                        ((Packet->Flags &
+                          NET_PACKET_FLAG_FLOW_HASH_VALID) != 0)) {
+
+                        FoundSocket->FlowHash = Packet->FlowHash;
+                        RtlAtomicOr32(&(FoundSocket->Flags),
+                                      NET_SOCKET_FLAG_FLOW_HASH_VALID);
+                    }
                 }
 
                 Status = STATUS_SUCCESS;
@@ -52,7 +52,9 @@ function build() {
         "netlink/netlink.c",
         "netlink/genctrl.c",
         "netlink/generic.c",
+        "poll.c",
         "raw.c",
+        "rss.c",
         "tcp.c",
         "tcpcong.c",
         "udp.c"
@@ -357,6 +357,11 @@ Return Value:
         goto DriverEntryEnd;
     }
 
+    Status = NetpInitializePolling();
+    if (!KSUCCESS(Status)) {
+        goto DriverEntryEnd;
+    }
+
     //
     // Set up the built in protocols, networks, data links and miscellaneous
     // components.
@@ -388,6 +393,13 @@ Return Value:
 
     NetpNetlinkGenericInitialize(1);
 
+    //
+    // Receive side scaling is an optimization; packets are processed inline
+    // if it fails to initialize.
+    //
+
+    NetpRssInitialize();
+
 DriverEntryEnd:
     if (!KSUCCESS(Status)) {
         if (NetPluginListLock != NULL) {
@@ -1205,6 +1217,15 @@ Return Value:
 
 {
 
+    //
+    // Hand the packet off to the receive queue for its flow if receive side
+    // scaling is enabled.
+    //
+
+    if (NetpRssSteerPacket(Link, Packet) != FALSE) {
+        return;
+    }
+
     //
     // Call the data link layer to process the packet.
     //
@@ -2000,6 +2021,10 @@ Return Value:
                                                     Parameters,
                                                     IoBuffer);
 
+    if (KSUCCESS(Status)) {
+        NetpRssUpdateFlow(NetSocket);
+    }
+
     if (NetGlobalDebug != FALSE) {
         RtlDebugPrint("Net: Received %ld on socket 0x%x: %d.\n",
                       Parameters->BytesCompleted,
@@ -76,6 +76,12 @@ extern LIST_ENTRY NetNetworkList;
 extern LIST_ENTRY NetDataLinkList;
 extern PSHARED_EXCLUSIVE_LOCK NetPluginListLock;
 
+//
+// Define the identifier for receive polling device information.
+//
+
+extern UUID NetPollInformationUuid;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -144,6 +150,133 @@ Return Value:
 
 --*/
 
+KSTATUS
+NetpInitializePolling (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for polled network devices.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+NetpGetSetPollInformation (
+    PNET_LINK Link,
+    PNETWORK_POLL_INFORMATION Information,
+    BOOL Set
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the receive polling information for a link.
+
+Arguments:
+
+    Link - Supplies a pointer to the link.
+
+    Information - Supplies a pointer that either receives the poll
+        information or contains the new settings.
+
+    Set - Supplies a boolean indicating whether to get the information (FALSE)
+        or set the information (TRUE).
+
+Return Value:
+
+    Status code. STATUS_NOT_HANDLED is returned if the link is not polled.
+
+--*/
+
+KSTATUS
+NetpRssInitialize (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes receive side scaling. On multiprocessor systems
+    it creates one receive queue per processor. Steering starts out disabled,
+    and is turned on through netlink.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+BOOL
+NetpRssSteerPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet
+    );
+
+/*++
+
+Routine Description:
+
+    This routine attempts to hand a received packet off to the receive queue
+    its flow is steered to. Packets of the same flow always land on the same
+    queue, so they are processed in order.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet. The packet is copied,
+        and is not referenced after this routine returns.
+
+Return Value:
+
+    TRUE if the packet was queued or dropped.
+
+    FALSE if the packet was not steered and should be processed by the caller.
+
+--*/
+
+VOID
+NetpRssUpdateFlow (
+    PNET_SOCKET Socket
+    );
+
+/*++
+
+Routine Description:
+
+    This routine steers the flow of the given socket to the receive queue of
+    the current processor. It is called when a thread consumes data from the
+    socket, so that received packets are processed where they are read.
+    The flow is only moved once its old queue has processed every packet
+    queued for it.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that was read.
+
+Return Value:
+
+    None.
+
+--*/
+
 COMPARISON_RESULT
 NetpCompareNetworkAddresses (
     PNETWORK_ADDRESS FirstAddress,
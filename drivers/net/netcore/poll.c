@@ -0,0 +1,607 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    poll.c
+
+Abstract:
+
+    This module implements budgeted receive polling and adaptive interrupt
+    moderation for network devices.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "netcore.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define how often adaptive moderation re-evaluates the traffic, in sampling
+// intervals per second.
+//
+
+#define NET_POLL_ADAPTIVE_INTERVALS_PER_SECOND 10
+
+//
+// Define the packet rates, in packets per second, separating the adaptive
+// moderation traffic classes.
+//
+
+#define NET_POLL_LOW_LATENCY_PACKET_RATE 10000
+#define NET_POLL_BULK_PACKET_RATE 100000
+
+//
+// Define the interrupt rates, in interrupts per second, used for each
+// adaptive moderation traffic class.
+//
+
+#define NET_POLL_LOWEST_LATENCY_INTERRUPT_RATE 70000
+#define NET_POLL_LOW_LATENCY_INTERRUPT_RATE 20000
+#define NET_POLL_BULK_INTERRUPT_RATE 8000
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+NetpPollWorker (
+    PVOID Parameter
+    );
+
+VOID
+NetpPollUpdateInterruptRate (
+    PNET_POLL Poll,
+    BOOL Force
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store a pointer to the work queue on which devices are polled.
+//
+
+PWORK_QUEUE NetPollWorkQueue;
+
+UUID NetPollInformationUuid = NETWORK_POLL_INFORMATION_UUID;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+NET_API
+KSTATUS
+NetCreatePoll (
+    PNET_LINK Link,
+    PNET_POLL_PROPERTIES Properties
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets a link up for budgeted receive polling. Rather than
+    processing received packets straight from its interrupt, the device masks
+    its receive interrupt and calls NetSchedulePoll. The networking core then
+    polls the device until it is drained, re-enables the receive interrupt,
+    and adjusts the device's interrupt throttling to the traffic.
+
+Arguments:
+
+    Link - Supplies a pointer to the link to poll.
+
+    Properties - Supplies a pointer to the poll properties. This memory will
+        not be referenced after the function returns.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PNET_POLL Poll;
+    KSTATUS Status;
+
+    Poll = NULL;
+    if ((Properties->Version < NET_POLL_PROPERTIES_VERSION) ||
+        (Properties->Interface.Poll == NULL) ||
+        (Properties->Interface.EnableReceiveInterrupt == NULL)) {
+
+        Status = STATUS_INVALID_PARAMETER;
+        goto CreatePollEnd;
+    }
+
+    if (Link->Poll != NULL) {
+        Status = STATUS_RESOURCE_IN_USE;
+        goto CreatePollEnd;
+    }
+
+    Poll = MmAllocateNonPagedPool(sizeof(NET_POLL), NET_CORE_ALLOCATION_TAG);
+    if (Poll == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreatePollEnd;
+    }
+
+    RtlZeroMemory(Poll, sizeof(NET_POLL));
+    Poll->Link = Link;
+    RtlCopyMemory(&(Poll->Properties), Properties, sizeof(NET_POLL_PROPERTIES));
+    if (Poll->Properties.Budget == 0) {
+        Poll->Properties.Budget = NET_POLL_DEFAULT_BUDGET;
+
+    } else if (Poll->Properties.Budget > NET_POLL_MAX_BUDGET) {
+        Poll->Properties.Budget = NET_POLL_MAX_BUDGET;
+    }
+
+    Poll->State = NET_POLL_STATE_IDLE;
+    Poll->WorkItem = KeCreateWorkItem(NetPollWorkQueue,
+                                      WorkPriorityHigh,
+                                      NetpPollWorker,
+                                      Poll,
+                                      NET_CORE_ALLOCATION_TAG);
+
+    if (Poll->WorkItem == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreatePollEnd;
+    }
+
+    //
+    // Throttle adaptively if the device can throttle at all.
+    //
+
+    Poll->Moderation = NetworkInterruptModerationOff;
+    if (Poll->Properties.Interface.SetInterruptRate != NULL) {
+        Poll->Moderation = NetworkInterruptModerationAdaptive;
+    }
+
+    Poll->FixedInterruptRate = NET_POLL_LOW_LATENCY_INTERRUPT_RATE;
+    Poll->IntervalStart = HlQueryTimeCounter();
+    NetpPollUpdateInterruptRate(Poll, TRUE);
+    Status = IoRegisterDeviceInformation(Link->Properties.Device,
+                                         &NetPollInformationUuid,
+                                         TRUE);
+
+    if (!KSUCCESS(Status)) {
+        goto CreatePollEnd;
+    }
+
+    Link->Poll = Poll;
+
+CreatePollEnd:
+    if (!KSUCCESS(Status)) {
+        if (Poll != NULL) {
+            if (Poll->WorkItem != NULL) {
+                KeDestroyWorkItem(Poll->WorkItem);
+            }
+
+            MmFreeNonPagedPool(Poll);
+        }
+    }
+
+    return Status;
+}
+
+NET_API
+VOID
+NetDestroyPoll (
+    PNET_LINK Link
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tears down receive polling for a link. The device must have
+    its receive interrupt disabled and no longer call NetSchedulePoll.
+
+Arguments:
+
+    Link - Supplies a pointer to the link.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PNET_POLL Poll;
+
+    Poll = Link->Poll;
+    if (Poll == NULL) {
+        return;
+    }
+
+    IoRegisterDeviceInformation(Link->Properties.Device,
+                                &NetPollInformationUuid,
+                                FALSE);
+
+    //
+    // A running poll may re-queue itself. Wait for the device to drain, at
+    // which point the work item stops re-queuing.
+    //
+
+    while (Poll->State != NET_POLL_STATE_IDLE) {
+        KeFlushWorkItem(Poll->WorkItem);
+    }
+
+    Link->Poll = NULL;
+    KeDestroyWorkItem(Poll->WorkItem);
+    MmFreeNonPagedPool(Poll);
+    return;
+}
+
+NET_API
+VOID
+NetSchedulePoll (
+    PNET_LINK Link
+    )
+
+/*++
+
+Routine Description:
+
+    This routine schedules a poll of a link's device. The device calls this
+    after taking a receive interrupt and masking further receive interrupts.
+    This routine must be called at or below dispatch level.
+
+Arguments:
+
+    Link - Supplies a pointer to the link to poll.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG OldState;
+    PNET_POLL Poll;
+    KSTATUS Status;
+
+    Poll = Link->Poll;
+
+    ASSERT(Poll != NULL);
+    ASSERT(KeGetRunLevel() <= RunLevelDispatch);
+
+    Poll->InterruptCount += 1;
+    OldState = RtlAtomicCompareExchange32(&(Poll->State),
+                                          NET_POLL_STATE_SCHEDULED,
+                                          NET_POLL_STATE_IDLE);
+
+    if (OldState == NET_POLL_STATE_IDLE) {
+        Status = KeQueueWorkItem(Poll->WorkItem);
+
+        ASSERT(KSUCCESS(Status));
+    }
+
+    return;
+}
+
+KSTATUS
+NetpInitializePolling (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for polled network devices.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    NetPollWorkQueue = KeCreateWorkQueue(WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL,
+                                         "NetPollWorker");
+
+    if (NetPollWorkQueue == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+NetpGetSetPollInformation (
+    PNET_LINK Link,
+    PNETWORK_POLL_INFORMATION Information,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the receive polling information for a link.
+
+Arguments:
+
+    Link - Supplies a pointer to the link.
+
+    Information - Supplies a pointer that either receives the poll
+        information or contains the new settings.
+
+    Set - Supplies a boolean indicating whether to get the information (FALSE)
+        or set the information (TRUE).
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_HANDLED if the link is not polled.
+
+    STATUS_VERSION_MISMATCH if the information version is not supported.
+
+    STATUS_INVALID_PARAMETER if a setting is not valid.
+
+    STATUS_NOT_SUPPORTED if moderation was requested on a device that cannot
+    throttle its interrupts.
+
+--*/
+
+{
+
+    ULONG Budget;
+    PNET_POLL Poll;
+
+    Poll = Link->Poll;
+    if (Poll == NULL) {
+        return STATUS_NOT_HANDLED;
+    }
+
+    if (Information->Version < NETWORK_POLL_INFORMATION_VERSION) {
+        return STATUS_VERSION_MISMATCH;
+    }
+
+    if (Set != FALSE) {
+        if ((Information->Moderation <= NetworkInterruptModerationInvalid) ||
+            (Information->Moderation > NetworkInterruptModerationAdaptive)) {
+
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        if ((Information->Moderation != NetworkInterruptModerationOff) &&
+            (Poll->Properties.Interface.SetInterruptRate == NULL)) {
+
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Budget = Information->Budget;
+        if ((Budget == 0) || (Budget > NET_POLL_MAX_BUDGET)) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        //
+        // The worker reads the budget and moderation without synchronization,
+        // so a poll in flight may see either the old or new values, which is
+        // harmless.
+        //
+
+        Poll->Properties.Budget = Budget;
+        Poll->Moderation = Information->Moderation;
+        if (Information->Moderation == NetworkInterruptModerationFixed) {
+            Poll->FixedInterruptRate = Information->InterruptRate;
+        }
+
+        NetpPollUpdateInterruptRate(Poll, TRUE);
+    }
+
+    Information->Moderation = Poll->Moderation;
+    Information->InterruptRate = Poll->InterruptRate;
+    Information->Budget = Poll->Properties.Budget;
+    Information->InterruptCount = Poll->InterruptCount;
+    Information->PollCount = Poll->PollCount;
+    Information->PacketCount = Poll->PacketCount;
+    Information->BudgetExhaustedCount = Poll->BudgetExhaustedCount;
+    Information->RateChangeCount = Poll->RateChangeCount;
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+NetpPollWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine polls a device for received packets. If the device used its
+    whole budget, the work item re-queues itself so that other work gets a
+    turn. Otherwise the device is drained and its receive interrupt is
+    re-enabled.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the poll.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Budget;
+    ULONG Count;
+    PNET_POLL Poll;
+    KSTATUS Status;
+
+    Poll = Parameter;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(Poll->State == NET_POLL_STATE_SCHEDULED);
+
+    Budget = Poll->Properties.Budget;
+    Count = Poll->Properties.Interface.Poll(Poll->Properties.DeviceContext,
+                                            Budget);
+
+    Poll->PollCount += 1;
+    Poll->PacketCount += Count;
+    Poll->IntervalPackets += Count;
+    if (Count >= Budget) {
+        Poll->BudgetExhaustedCount += 1;
+        Status = KeQueueWorkItem(Poll->WorkItem);
+
+        ASSERT(KSUCCESS(Status));
+
+        return;
+    }
+
+    //
+    // Mark the poll idle before enabling the interrupt, so that an interrupt
+    // arriving right after is not lost.
+    //
+
+    NetpPollUpdateInterruptRate(Poll, FALSE);
+    RtlAtomicExchange32(&(Poll->State), NET_POLL_STATE_IDLE);
+    Poll->Properties.Interface.EnableReceiveInterrupt(
+                                             Poll->Properties.DeviceContext);
+
+    return;
+}
+
+VOID
+NetpPollUpdateInterruptRate (
+    PNET_POLL Poll,
+    BOOL Force
+    )
+
+/*++
+
+Routine Description:
+
+    This routine picks the interrupt rate for a device based on its
+    moderation mode and, in adaptive mode, on the recent packet rate. Low
+    packet rates get a high interrupt rate for latency, and high packet rates
+    get a low interrupt rate so each interrupt picks up a batch of packets.
+
+Arguments:
+
+    Poll - Supplies a pointer to the poll.
+
+    Force - Supplies a boolean indicating whether to reprogram the device
+        even if the rate did not change, and to skip waiting for the sampling
+        interval to end.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Elapsed;
+    ULONGLONG Frequency;
+    ULONGLONG PacketRate;
+    ULONG Rate;
+    ULONGLONG Time;
+
+    if (Poll->Properties.Interface.SetInterruptRate == NULL) {
+        return;
+    }
+
+    Rate = Poll->InterruptRate;
+    switch (Poll->Moderation) {
+    case NetworkInterruptModerationOff:
+        Rate = 0;
+        break;
+
+    case NetworkInterruptModerationFixed:
+        Rate = Poll->FixedInterruptRate;
+        break;
+
+    case NetworkInterruptModerationAdaptive:
+        Time = HlQueryTimeCounter();
+        Frequency = HlQueryTimeCounterFrequency();
+        Elapsed = Time - Poll->IntervalStart;
+        if ((Force == FALSE) &&
+            (Elapsed < Frequency / NET_POLL_ADAPTIVE_INTERVALS_PER_SECOND)) {
+
+            return;
+        }
+
+        PacketRate = 0;
+        if (Elapsed != 0) {
+            PacketRate = (Poll->IntervalPackets * Frequency) / Elapsed;
+        }
+
+        Poll->IntervalStart = Time;
+        Poll->IntervalPackets = 0;
+        if (PacketRate < NET_POLL_LOW_LATENCY_PACKET_RATE) {
+            Rate = NET_POLL_LOWEST_LATENCY_INTERRUPT_RATE;
+
+        } else if (PacketRate < NET_POLL_BULK_PACKET_RATE) {
+            Rate = NET_POLL_LOW_LATENCY_INTERRUPT_RATE;
+
+        } else {
+            Rate = NET_POLL_BULK_INTERRUPT_RATE;
+        }
+
+        break;
+
+    default:
+
+        ASSERT(FALSE);
+
+        return;
+    }
+
+    if ((Rate == Poll->InterruptRate) && (Force == FALSE)) {
+        return;
+    }
+
+    if (Rate != Poll->InterruptRate) {
+        Poll->RateChangeCount += 1;
+    }
+
+    Poll->InterruptRate = Rate;
+    Poll->Properties.Interface.SetInterruptRate(Poll->Properties.DeviceContext,
+                                                Rate);
+
+    return;
+}
+
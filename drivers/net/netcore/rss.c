@@ -0,0 +1,1107 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    rss.c
+
+Abstract:
+
+    This module implements receive side scaling, which spreads the processing
+    of received packets across several receive queues based on a hash of each
+    packet's flow.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "netcore.h"
+#include <minoca/net/netlink.h>
+#include <minoca/net/ip4.h>
+#include <minoca/net/ip6.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of entries in the steering table. This must be a power of
+// two.
+//
+
+#define NET_RSS_TABLE_SIZE 128
+
+//
+// Define the maximum number of receive queues.
+//
+
+#define NET_RSS_MAX_QUEUES 32
+
+//
+// Define the number of packets each receive queue can hold before dropping.
+//
+
+#define NET_RSS_BACKLOG_SIZE 1024
+
+//
+// Define the size of the Toeplitz hash key, and the maximum number of input
+// bytes the key can hash.
+//
+
+#define NET_RSS_KEY_SIZE 40
+#define NET_RSS_MAX_HASH_INPUT (NET_RSS_KEY_SIZE - sizeof(ULONG))
+
+//
+// Define the size of an ethernet header.
+//
+
+#define NET_RSS_ETHERNET_HEADER_SIZE \
+    ((2 * ETHERNET_ADDRESS_SIZE) + sizeof(USHORT))
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a packet waiting on a receive queue.
+
+Members:
+
+    Link - Stores a pointer to the link that received the packet. A reference
+        is held on the link while the packet is queued.
+
+    Packet - Stores a pointer to the packet, which is owned by the queue.
+
+--*/
+
+typedef struct _NET_RSS_QUEUE_ENTRY {
+    PNET_LINK Link;
+    PNET_PACKET_BUFFER Packet;
+} NET_RSS_QUEUE_ENTRY, *PNET_RSS_QUEUE_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure defines a receive queue.
+
+Members:
+
+    Lock - Stores a pointer to the lock protecting the queue.
+
+    WorkQueue - Stores a pointer to the work queue whose worker thread
+        processes this queue's packets.
+
+    WorkItem - Stores a pointer to the work item that drains the queue.
+
+    Scheduled - Stores a boolean indicating whether the work item is queued
+        or running.
+
+    Head - Stores the index of the oldest packet in the queue.
+
+    Count - Stores the number of packets in the queue.
+
+    PacketCount - Stores the number of packets steered to this queue. This
+        also serves as the sequence number of the most recently queued packet.
+
+    ProcessedCount - Stores the number of packets the worker has finished
+        passing up the stack.
+
+    DropCount - Stores the number of packets dropped because the queue was
+        full.
+
+    Entries - Stores the ring of queued packets.
+
+--*/
+
+typedef struct _NET_RSS_QUEUE {
+    PQUEUED_LOCK Lock;
+    PWORK_QUEUE WorkQueue;
+    PWORK_ITEM WorkItem;
+    BOOL Scheduled;
+    ULONG Head;
+    ULONG Count;
+    ULONGLONG PacketCount;
+    ULONGLONG ProcessedCount;
+    ULONGLONG DropCount;
+    NET_RSS_QUEUE_ENTRY Entries[NET_RSS_BACKLOG_SIZE];
+} NET_RSS_QUEUE, *PNET_RSS_QUEUE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+NetpRssWorker (
+    PVOID Parameter
+    );
+
+BOOL
+NetpRssComputeHash (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet,
+    PULONG Hash
+    );
+
+ULONG
+NetpRssToeplitzHash (
+    PUCHAR Input,
+    ULONG Length
+    );
+
+KSTATUS
+NetpRssNetlinkGet (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    );
+
+KSTATUS
+NetpRssNetlinkSet (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    );
+
+KSTATUS
+NetpRssNetlinkSendState (
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the receive queues. Queue N is nominally associated with processor N,
+// though the scheduler decides where each queue's worker thread runs.
+//
+
+PNET_RSS_QUEUE NetRssQueues;
+ULONG NetRssQueueCount;
+
+//
+// Store whether or not received packets are steered across the queues. This
+// is off by default: every steered packet is copied and handed to a worker
+// thread, which only pays off once drivers supply flow hashes or the workers
+// are bound to their processors.
+//
+
+BOOL NetRssEnabled;
+
+//
+// Store the steering table, which maps the low bits of a flow hash to a
+// receive queue index.
+//
+
+UCHAR NetRssTable[NET_RSS_TABLE_SIZE];
+
+//
+// Store, for each steering table entry, the sequence number of the last
+// packet queued for it. An entry is only moved to another queue once its
+// current queue has processed that packet, so a flow is never reordered.
+//
+
+ULONGLONG NetRssLastPacket[NET_RSS_TABLE_SIZE];
+
+//
+// Store the Toeplitz hash key. This is the key commonly programmed into
+// hardware, so that software and hardware hashes agree.
+//
+
+UCHAR NetRssKey[NET_RSS_KEY_SIZE] = {
+    0x6D, 0x5A, 0x56, 0xDA, 0x25, 0x5B, 0x0E, 0xC2,
+    0x41, 0x67, 0x25, 0x3D, 0x43, 0xA3, 0x8F, 0xB0,
+    0xD0, 0xCA, 0x2B, 0xCB, 0xAE, 0x7B, 0x30, 0xB4,
+    0x77, 0xCB, 0x2D, 0xA3, 0x80, 0x30, 0xF2, 0x0C,
+    0x6A, 0x42, 0xB7, 0x3B, 0xBE, 0xAC, 0x01, 0xFA
+};
+
+NETLINK_GENERIC_COMMAND NetRssNetlinkCommands[] = {
+    {
+        NETLINK_RSS_COMMAND_GET,
+        0,
+        NetpRssNetlinkGet
+    },
+
+    {
+        NETLINK_RSS_COMMAND_SET,
+        0,
+        NetpRssNetlinkSet
+    },
+};
+
+NETLINK_GENERIC_FAMILY_PROPERTIES NetRssNetlinkFamilyProperties = {
+    NETLINK_GENERIC_FAMILY_PROPERTIES_VERSION,
+    0,
+    sizeof(NETLINK_GENERIC_RSS_NAME),
+    NETLINK_GENERIC_RSS_NAME,
+    NetRssNetlinkCommands,
+    sizeof(NetRssNetlinkCommands) / sizeof(NetRssNetlinkCommands[0]),
+    NULL,
+    0
+};
+
+PNETLINK_GENERIC_FAMILY NetRssNetlinkFamily;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+NetpRssInitialize (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes receive side scaling. On multiprocessor systems
+    it creates one receive queue per processor. Steering starts out disabled,
+    and is turned on through netlink.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Index;
+    ULONG ProcessorCount;
+    PNET_RSS_QUEUE Queue;
+    ULONG QueueCount;
+    KSTATUS Status;
+
+    ProcessorCount = KeGetActiveProcessorCount();
+    QueueCount = ProcessorCount;
+    if (QueueCount > NET_RSS_MAX_QUEUES) {
+        QueueCount = NET_RSS_MAX_QUEUES;
+    }
+
+    if (QueueCount > 1) {
+        AllocationSize = QueueCount * sizeof(NET_RSS_QUEUE);
+        NetRssQueues = MmAllocateNonPagedPool(AllocationSize,
+                                              NET_CORE_ALLOCATION_TAG);
+
+        if (NetRssQueues == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto InitializeEnd;
+        }
+
+        RtlZeroMemory(NetRssQueues, AllocationSize);
+        for (Index = 0; Index < QueueCount; Index += 1) {
+            Queue = &(NetRssQueues[Index]);
+            Queue->Lock = KeCreateQueuedLock();
+            if (Queue->Lock == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto InitializeEnd;
+            }
+
+            Queue->WorkQueue = KeCreateWorkQueue(0, "NetReceiveWorker");
+            if (Queue->WorkQueue == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto InitializeEnd;
+            }
+
+            Queue->WorkItem = KeCreateWorkItem(Queue->WorkQueue,
+                                               WorkPriorityHigh,
+                                               NetpRssWorker,
+                                               Queue,
+                                               NET_CORE_ALLOCATION_TAG);
+
+            if (Queue->WorkItem == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto InitializeEnd;
+            }
+        }
+
+        for (Index = 0; Index < NET_RSS_TABLE_SIZE; Index += 1) {
+            NetRssTable[Index] = Index % QueueCount;
+        }
+
+        NetRssQueueCount = QueueCount;
+    }
+
+    Status = NetlinkGenericRegisterFamily(&NetRssNetlinkFamilyProperties,
+                                          &NetRssNetlinkFamily);
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeEnd;
+    }
+
+InitializeEnd:
+    if (!KSUCCESS(Status)) {
+        NetRssEnabled = FALSE;
+        NetRssQueueCount = 0;
+        if (NetRssQueues != NULL) {
+            for (Index = 0; Index < QueueCount; Index += 1) {
+                Queue = &(NetRssQueues[Index]);
+                if (Queue->WorkItem != NULL) {
+                    KeDestroyWorkItem(Queue->WorkItem);
+                }
+
+                if (Queue->WorkQueue != NULL) {
+                    KeDestroyWorkQueue(Queue->WorkQueue);
+                }
+
+                if (Queue->Lock != NULL) {
+                    KeDestroyQueuedLock(Queue->Lock);
+                }
+            }
+
+            MmFreeNonPagedPool(NetRssQueues);
+            NetRssQueues = NULL;
+        }
+    }
+
+    return Status;
+}
+
+BOOL
+NetpRssSteerPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to hand a received packet off to the receive queue
+    its flow is steered to. Packets of the same flow always land on the same
+    queue, so they are processed in order.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet. The packet is copied,
+        and is not referenced after this routine returns.
+
+Return Value:
+
+    TRUE if the packet was queued or dropped.
+
+    FALSE if the packet was not steered and should be processed by the caller.
+
+--*/
+
+{
+
+    PNET_PACKET_BUFFER Copy;
+    PNET_RSS_QUEUE_ENTRY Entry;
+    ULONG Hash;
+    ULONG Index;
+    PNET_RSS_QUEUE Queue;
+    ULONG QueueIndex;
+    BOOL Schedule;
+    ULONG Size;
+    KSTATUS Status;
+
+    if (NetRssEnabled == FALSE) {
+        return FALSE;
+    }
+
+    if ((Packet->Flags & NET_PACKET_FLAG_FLOW_HASH_VALID) != 0) {
+        Hash = Packet->FlowHash;
+
+    } else if (NetpRssComputeHash(Link, Packet, &Hash) == FALSE) {
+        return FALSE;
+    }
+
+    //
+    // The driver reclaims its buffer when this routine returns, so the
+    // queued packet must be a copy.
+    //
+
+    Size = Packet->FooterOffset - Packet->DataOffset;
+    Status = NetAllocateBuffer(0, Size, 0, NULL, 0, &Copy);
+    if (!KSUCCESS(Status)) {
+        return FALSE;
+    }
+
+    RtlCopyMemory(Copy->Buffer, Packet->Buffer + Packet->DataOffset, Size);
+    Copy->Flags = Packet->Flags | NET_PACKET_FLAG_FLOW_HASH_VALID;
+    Copy->FlowHash = Hash;
+    NetLinkAddReference(Link);
+    Schedule = FALSE;
+
+    //
+    // The table entry only changes with its current queue's lock held, so
+    // make sure the entry still points at the locked queue.
+    //
+
+    Index = Hash & (NET_RSS_TABLE_SIZE - 1);
+    while (TRUE) {
+        QueueIndex = NetRssTable[Index];
+        Queue = &(NetRssQueues[QueueIndex]);
+        KeAcquireQueuedLock(Queue->Lock);
+        if (NetRssTable[Index] == QueueIndex) {
+            break;
+        }
+
+        KeReleaseQueuedLock(Queue->Lock);
+    }
+
+    if (Queue->Count == NET_RSS_BACKLOG_SIZE) {
+        Queue->DropCount += 1;
+        KeReleaseQueuedLock(Queue->Lock);
+        NetLinkReleaseReference(Link);
+        NetFreeBuffer(Copy);
+        return TRUE;
+    }
+
+    Entry = &(Queue->Entries[(Queue->Head + Queue->Count) %
+                             NET_RSS_BACKLOG_SIZE]);
+
+    Entry->Link = Link;
+    Entry->Packet = Copy;
+    Queue->Count += 1;
+    Queue->PacketCount += 1;
+    NetRssLastPacket[Index] = Queue->PacketCount;
+    if (Queue->Scheduled == FALSE) {
+        Queue->Scheduled = TRUE;
+        Schedule = TRUE;
+    }
+
+    KeReleaseQueuedLock(Queue->Lock);
+    if (Schedule != FALSE) {
+        Status = KeQueueWorkItem(Queue->WorkItem);
+
+        ASSERT(KSUCCESS(Status));
+
+    }
+
+    return TRUE;
+}
+
+VOID
+NetpRssUpdateFlow (
+    PNET_SOCKET Socket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine steers the flow of the given socket to the receive queue of
+    the current processor. It is called when a thread consumes data from the
+    socket, so that received packets are processed where they are read.
+    The flow is only moved once its old queue has finished processing every
+    packet queued for it, so packets are never reordered. Until then the flow
+    stays where it is, and a later read tries again.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that was read.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PNET_RSS_QUEUE OldQueue;
+    ULONG OldQueueIndex;
+    ULONG QueueIndex;
+
+    if ((NetRssEnabled == FALSE) ||
+        ((Socket->Flags & NET_SOCKET_FLAG_FLOW_HASH_VALID) == 0)) {
+
+        return;
+    }
+
+    Index = Socket->FlowHash & (NET_RSS_TABLE_SIZE - 1);
+    QueueIndex = KeGetCurrentProcessorNumber() % NetRssQueueCount;
+    OldQueueIndex = NetRssTable[Index];
+    if (OldQueueIndex == QueueIndex) {
+        return;
+    }
+
+    OldQueue = &(NetRssQueues[OldQueueIndex]);
+    KeAcquireQueuedLock(OldQueue->Lock);
+    if ((NetRssTable[Index] == OldQueueIndex) &&
+        (OldQueue->ProcessedCount >= NetRssLastPacket[Index])) {
+
+        NetRssTable[Index] = QueueIndex;
+    }
+
+    KeReleaseQueuedLock(OldQueue->Lock);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+NetpRssWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine drains a receive queue, passing each packet up the stack.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the receive queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    NET_RSS_QUEUE_ENTRY Entry;
+    PNET_LINK Link;
+    PNET_RSS_QUEUE Queue;
+
+    Queue = Parameter;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    KeAcquireQueuedLock(Queue->Lock);
+    while (Queue->Count != 0) {
+        Entry = Queue->Entries[Queue->Head];
+        Queue->Head = (Queue->Head + 1) % NET_RSS_BACKLOG_SIZE;
+        Queue->Count -= 1;
+        KeReleaseQueuedLock(Queue->Lock);
+        Link = Entry.Link;
+        Link->DataLinkEntry->Interface.ProcessReceivedPacket(
+                                                         Link->DataLinkContext,
+                                                         Entry.Packet);
+
+        NetFreeBuffer(Entry.Packet);
+        NetLinkReleaseReference(Link);
+        KeAcquireQueuedLock(Queue->Lock);
+        Queue->ProcessedCount += 1;
+    }
+
+    Queue->Scheduled = FALSE;
+    KeReleaseQueuedLock(Queue->Lock);
+    return;
+}
+
+BOOL
+NetpRssComputeHash (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet,
+    PULONG Hash
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the Toeplitz flow hash of a received ethernet frame.
+    TCP and UDP packets hash the addresses and ports, fragments and other IP
+    packets hash only the addresses.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet.
+
+    Hash - Supplies a pointer where the hash is returned.
+
+Return Value:
+
+    TRUE if the hash was computed.
+
+    FALSE if the packet is not an IP packet, and should not be steered.
+
+--*/
+
+{
+
+    PUCHAR Data;
+    ULONG HeaderLength;
+    UCHAR Input[NET_RSS_MAX_HASH_INPUT];
+    ULONG InputLength;
+    PIP4_HEADER Ip4Header;
+    PIP6_HEADER Ip6Header;
+    ULONG Length;
+    USHORT NetworkProtocol;
+    UCHAR Protocol;
+    PUCHAR Transport;
+
+    if (Link->Properties.DataLinkType != NetDomainEthernet) {
+        return FALSE;
+    }
+
+    Data = Packet->Buffer + Packet->DataOffset;
+    Length = Packet->FooterOffset - Packet->DataOffset;
+    if (Length < NET_RSS_ETHERNET_HEADER_SIZE) {
+        return FALSE;
+    }
+
+    NetworkProtocol = *((PUSHORT)(Data + (2 * ETHERNET_ADDRESS_SIZE)));
+    NetworkProtocol = NETWORK_TO_CPU16(NetworkProtocol);
+    Data += NET_RSS_ETHERNET_HEADER_SIZE;
+    Length -= NET_RSS_ETHERNET_HEADER_SIZE;
+    Transport = NULL;
+    if (NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        if (Length < sizeof(IP4_HEADER)) {
+            return FALSE;
+        }
+
+        Ip4Header = (PIP4_HEADER)Data;
+        if ((Ip4Header->VersionAndHeaderLength & IP4_VERSION_MASK) !=
+            IP4_VERSION) {
+
+            return FALSE;
+        }
+
+        HeaderLength = (Ip4Header->VersionAndHeaderLength &
+                        IP4_HEADER_LENGTH_MASK) * sizeof(ULONG);
+
+        RtlCopyMemory(Input,
+                      Data + FIELD_OFFSET(IP4_HEADER, SourceAddress),
+                      2 * sizeof(ULONG));
+
+        InputLength = 2 * sizeof(ULONG);
+        if (((NETWORK_TO_CPU16(Ip4Header->FragmentOffset) &
+              ((IP4_FLAG_MORE_FRAGMENTS << IP4_FRAGMENT_FLAGS_SHIFT) |
+               IP4_FRAGMENT_OFFSET_MASK)) == 0) &&
+            (Length >= HeaderLength + (2 * sizeof(USHORT)))) {
+
+            Protocol = Ip4Header->Protocol;
+            Transport = Data + HeaderLength;
+        }
+
+    } else if (NetworkProtocol == IP6_PROTOCOL_NUMBER) {
+        if (Length < sizeof(IP6_HEADER)) {
+            return FALSE;
+        }
+
+        Ip6Header = (PIP6_HEADER)Data;
+        RtlCopyMemory(Input,
+                      Data + FIELD_OFFSET(IP6_HEADER, SourceAddress),
+                      2 * IP6_ADDRESS_SIZE);
+
+        InputLength = 2 * IP6_ADDRESS_SIZE;
+
+        //
+        // Only look for ports directly after the fixed header. Packets with
+        // extension headers just hash the addresses.
+        //
+
+        if (Length >= sizeof(IP6_HEADER) + (2 * sizeof(USHORT))) {
+            Protocol = Ip6Header->NextHeader;
+            Transport = Data + sizeof(IP6_HEADER);
+        }
+
+    } else {
+        return FALSE;
+    }
+
+    //
+    // TCP and UDP both start with the source and destination ports.
+    //
+
+    if ((Transport != NULL) &&
+        ((Protocol == SOCKET_INTERNET_PROTOCOL_TCP) ||
+         (Protocol == SOCKET_INTERNET_PROTOCOL_UDP))) {
+
+        RtlCopyMemory(Input + InputLength, Transport, 2 * sizeof(USHORT));
+        InputLength += 2 * sizeof(USHORT);
+    }
+
+    *Hash = NetpRssToeplitzHash(Input, InputLength);
+    return TRUE;
+}
+
+ULONG
+NetpRssToeplitzHash (
+    PUCHAR Input,
+    ULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes a Toeplitz hash. For every set bit of the input, the
+    32 bits of the key starting at that bit position are exclusive ORed into
+    the result.
+
+Arguments:
+
+    Input - Supplies a pointer to the bytes to hash.
+
+    Length - Supplies the number of bytes to hash. This must not be more than
+        NET_RSS_MAX_HASH_INPUT.
+
+Return Value:
+
+    Returns the hash value.
+
+--*/
+
+{
+
+    ULONG Bit;
+    UCHAR Byte;
+    ULONG Index;
+    UCHAR NextKey;
+    ULONG Result;
+    ULONG Window;
+
+    ASSERT(Length <= NET_RSS_MAX_HASH_INPUT);
+
+    Result = 0;
+    Window = (NetRssKey[0] << 24) | (NetRssKey[1] << 16) |
+             (NetRssKey[2] << 8) | NetRssKey[3];
+
+    for (Index = 0; Index < Length; Index += 1) {
+        Byte = Input[Index];
+        NextKey = NetRssKey[Index + sizeof(ULONG)];
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            if ((Byte & (0x80 >> Bit)) != 0) {
+                Result ^= Window;
+            }
+
+            Window = (Window << 1) | ((NextKey >> (7 - Bit)) & 0x1);
+        }
+    }
+
+    return Result;
+}
+
+KSTATUS
+NetpRssNetlinkGet (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles a netlink request for the receive side scaling
+    state.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that received the packet.
+
+    Packet - Supplies a pointer to the request packet.
+
+    Command - Supplies a pointer to the command information.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    return NetpRssNetlinkSendState(Command);
+}
+
+KSTATUS
+NetpRssNetlinkSet (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles a netlink request to change the receive side scaling
+    settings. The new state is sent back in reply. Network administrator
+    privileges are required.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that received the packet.
+
+    Packet - Supplies a pointer to the request packet.
+
+    Command - Supplies a pointer to the command information.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PVOID Attributes;
+    ULONG AttributesLength;
+    PVOID Data;
+    USHORT DataLength;
+    PULONG Enabled;
+    ULONG Index;
+    PUCHAR Table;
+    KSTATUS Status;
+
+    Status = PsCheckPermission(PERMISSION_NET_ADMINISTRATOR);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Attributes = Packet->Buffer + Packet->DataOffset;
+    AttributesLength = Packet->FooterOffset - Packet->DataOffset;
+    Enabled = NULL;
+    Status = NetlinkGetAttribute(Attributes,
+                                 AttributesLength,
+                                 NETLINK_RSS_ATTRIBUTE_ENABLED,
+                                 &Data,
+                                 &DataLength);
+
+    if (KSUCCESS(Status)) {
+        if (DataLength != sizeof(ULONG)) {
+            return STATUS_DATA_LENGTH_MISMATCH;
+        }
+
+        Enabled = Data;
+        if ((*Enabled != FALSE) && (NetRssQueueCount <= 1)) {
+            return STATUS_NOT_SUPPORTED;
+        }
+    }
+
+    Table = NULL;
+    Status = NetlinkGetAttribute(Attributes,
+                                 AttributesLength,
+                                 NETLINK_RSS_ATTRIBUTE_TABLE,
+                                 &Data,
+                                 &DataLength);
+
+    if (KSUCCESS(Status)) {
+        if (DataLength != NET_RSS_TABLE_SIZE) {
+            return STATUS_DATA_LENGTH_MISMATCH;
+        }
+
+        Table = Data;
+        for (Index = 0; Index < NET_RSS_TABLE_SIZE; Index += 1) {
+            if (Table[Index] >= NetRssQueueCount) {
+                return STATUS_INVALID_PARAMETER;
+            }
+        }
+    }
+
+    Status = NetlinkGetAttribute(Attributes,
+                                 AttributesLength,
+                                 NETLINK_RSS_ATTRIBUTE_KEY,
+                                 &Data,
+                                 &DataLength);
+
+    if (KSUCCESS(Status)) {
+        if (DataLength != NET_RSS_KEY_SIZE) {
+            return STATUS_DATA_LENGTH_MISMATCH;
+        }
+
+        RtlCopyMemory(NetRssKey, Data, NET_RSS_KEY_SIZE);
+    }
+
+    if (Table != NULL) {
+        RtlCopyMemory(NetRssTable, Table, NET_RSS_TABLE_SIZE);
+    }
+
+    if (Enabled != NULL) {
+        NetRssEnabled = FALSE;
+        if (*Enabled != FALSE) {
+            NetRssEnabled = TRUE;
+        }
+    }
+
+    return NetpRssNetlinkSendState(Command);
+}
+
+KSTATUS
+NetpRssNetlinkSendState (
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends the receive side scaling state to the source of a
+    netlink request.
+
+Arguments:
+
+    Command - Supplies a pointer to the information of the command being
+        replied to.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Enabled;
+    ULONG Index;
+    PNET_PACKET_BUFFER Packet;
+    ULONG PayloadLength;
+    PULONGLONG Statistics;
+    ULONG StatisticsSize;
+    KSTATUS Status;
+
+    Packet = NULL;
+    Statistics = NULL;
+    StatisticsSize = NetRssQueueCount * sizeof(ULONGLONG);
+    PayloadLength = NETLINK_ATTRIBUTE_SIZE(sizeof(ULONG)) +
+                    NETLINK_ATTRIBUTE_SIZE(sizeof(ULONG)) +
+                    NETLINK_ATTRIBUTE_SIZE(NET_RSS_TABLE_SIZE) +
+                    NETLINK_ATTRIBUTE_SIZE(NET_RSS_KEY_SIZE);
+
+    if (NetRssQueueCount != 0) {
+        PayloadLength += 2 * NETLINK_ATTRIBUTE_SIZE(StatisticsSize);
+        Statistics = MmAllocatePagedPool(StatisticsSize,
+                                         NET_CORE_ALLOCATION_TAG);
+
+        if (Statistics == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto NetlinkSendStateEnd;
+        }
+    }
+
+    Status = NetAllocateBuffer(0,
+                               NETLINK_HEADER_LENGTH +
+                               NETLINK_GENERIC_HEADER_LENGTH +
+                               PayloadLength,
+                               0,
+                               NULL,
+                               0,
+                               &Packet);
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    Status = NetlinkGenericAppendHeaders(NetRssNetlinkFamily,
+                                         Packet,
+                                         PayloadLength,
+                                         Command->Message.SequenceNumber,
+                                         0,
+                                         NETLINK_RSS_COMMAND_STATE,
+                                         0);
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    Enabled = NetRssEnabled;
+    Status = NetlinkAppendAttribute(Packet,
+                                    NETLINK_RSS_ATTRIBUTE_ENABLED,
+                                    &Enabled,
+                                    sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    Status = NetlinkAppendAttribute(Packet,
+                                    NETLINK_RSS_ATTRIBUTE_QUEUE_COUNT,
+                                    &NetRssQueueCount,
+                                    sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    Status = NetlinkAppendAttribute(Packet,
+                                    NETLINK_RSS_ATTRIBUTE_TABLE,
+                                    NetRssTable,
+                                    NET_RSS_TABLE_SIZE);
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    Status = NetlinkAppendAttribute(Packet,
+                                    NETLINK_RSS_ATTRIBUTE_KEY,
+                                    NetRssKey,
+                                    NET_RSS_KEY_SIZE);
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSendStateEnd;
+    }
+
+    if (NetRssQueueCount != 0) {
+        for (Index = 0; Index < NetRssQueueCount; Index += 1) {
+            Statistics[Index] = NetRssQueues[Index].PacketCount;
+        }
+
+        Status = NetlinkAppendAttribute(Packet,
+                                        NETLINK_RSS_ATTRIBUTE_QUEUE_PACKETS,
+                                        Statistics,
+                                        StatisticsSize);
+
+        if (!KSUCCESS(Status)) {
+            goto NetlinkSendStateEnd;
+        }
+
+        for (Index = 0; Index < NetRssQueueCount; Index += 1) {
+            Statistics[Index] = NetRssQueues[Index].DropCount;
+        }
+
+        Status = NetlinkAppendAttribute(Packet,
+                                        NETLINK_RSS_ATTRIBUTE_QUEUE_DROPS,
+                                        Statistics,
+                                        StatisticsSize);
+
+        if (!KSUCCESS(Status)) {
+            goto NetlinkSendStateEnd;
+        }
+    }
+
+    Status = NetlinkGenericSendCommand(NetRssNetlinkFamily,
+                                       Packet,
+                                       Command->Message.SourceAddress);
+
+NetlinkSendStateEnd:
+    if (Packet != NULL) {
+        NetFreeBuffer(Packet);
+    }
+
+    if (Statistics != NULL) {
+        MmFreePagedPool(Statistics);
+    }
+
+    return Status;
+}
+
@@ -162,6 +162,15 @@ PcipMsiIsVectorPending (
     PBOOL Pending
     );
 
+KSTATUS
+PcipMsiEnableVectors (
+    PVOID DeviceToken,
+    ULONGLONG Vector,
+    ULONGLONG VectorCount,
+    PPROCESSOR_SET Processors,
+    PPCI_MSI_TYPE MsiType
+    );
+
 KSTATUS
 PcipMapMsiXTable (
     PPCI_MSI_CONTEXT MsiContext
@@ -434,6 +443,7 @@ Return Value:
     MsiInterface->IsVectorMasked = PcipMsiIsVectorMasked;
     MsiInterface->IsVectorPending = PcipMsiIsVectorPending;
     MsiInterface->DeviceToken = PciDevice;
+    MsiInterface->EnableVectors = PcipMsiEnableVectors;
     MsiContext->MsiOffset = MsiOffset;
     MsiContext->MsiXOffset = MsiXOffset;
     MsiContext->MsiFlags = MsiFlags;
@@ -1704,6 +1714,180 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+PcipMsiEnableVectors (
+    PVOID DeviceToken,
+    ULONGLONG Vector,
+    ULONGLONG VectorCount,
+    PPROCESSOR_SET Processors,
+    PPCI_MSI_TYPE MsiType
+    )
+
+/*++
+
+Routine Description:
+
+    This routine programs and enables a contiguous block of message signaled
+    interrupt vectors for the given PCI device, starting at vector table index
+    zero. A single vector prefers MSI. Multiple vectors prefer MSI-X, as only
+    MSI-X allows each vector to be steered at a different processor. If
+    MSI-X is not available, multiple vectors fall back to multi-message MSI,
+    where every vector targets the first processor set.
+
+Arguments:
+
+    DeviceToken - Supplies the device token supplied when the interface was
+        acquired.
+
+    Vector - Supplies the first vector of the block, as allocated to the
+        device through its interrupt vector resource.
+
+    VectorCount - Supplies the number of contiguous vectors to enable.
+
+    Processors - Supplies an optional array of processor sets, one for each
+        vector, that the vectors should target. If NULL, the vectors are
+        distributed round-robin across the active processors.
+
+    MsiType - Supplies a pointer where the type of message signaled
+        interrupts that ended up being enabled is returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the device cannot provide the requested number of
+    vectors through either MSI or MSI-X.
+
+    Other error codes on failure.
+
+--*/
+
+{
+
+    BOOL BasicCapable;
+    BOOL ExtendedCapable;
+    ULONGLONG Index;
+    PCI_MSI_INFORMATION Information;
+    PPCI_MSI_CONTEXT MsiContext;
+    PPCI_DEVICE PciDevice;
+    ULONG ProcessorCount;
+    PROCESSOR_SET ProcessorSet;
+    KSTATUS Status;
+    PPROCESSOR_SET Target;
+    PCI_MSI_TYPE Type;
+
+    *MsiType = PciMsiTypeInvalid;
+    PciDevice = (PPCI_DEVICE)DeviceToken;
+    MsiContext = PciDevice->MsiContext;
+    if (MsiContext == NULL) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    if (VectorCount == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    //
+    // Multi-message MSI hands the device a single data value and lets it OR
+    // the message number into the low bits, so the block must be a naturally
+    // aligned power of two.
+    //
+
+    BasicCapable = FALSE;
+    if ((MsiContext->MsiOffset != 0) &&
+        (VectorCount <= MsiContext->MsiMaxVectorCount) &&
+        (POWER_OF_2(VectorCount) != FALSE) &&
+        (IS_ALIGNED(Vector, VectorCount) != FALSE)) {
+
+        BasicCapable = TRUE;
+    }
+
+    ExtendedCapable = FALSE;
+    if ((MsiContext->MsiXOffset != 0) &&
+        (VectorCount <= MsiContext->MsiXMaxVectorCount)) {
+
+        ExtendedCapable = TRUE;
+    }
+
+    if ((ExtendedCapable != FALSE) &&
+        ((VectorCount > 1) || (BasicCapable == FALSE))) {
+
+        Type = PciMsiTypeExtended;
+
+    } else if (BasicCapable != FALSE) {
+        Type = PciMsiTypeBasic;
+
+    } else {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    //
+    // Program the vectors. MSI only has one address and data pair, so the
+    // whole block goes wherever the first vector goes. MSI-X gets a table
+    // entry per vector, which is where the per-vector steering happens.
+    //
+
+    ProcessorCount = KeGetActiveProcessorCount();
+    ProcessorSet.Target = ProcessorTargetAny;
+    if (Type == PciMsiTypeBasic) {
+        Target = &ProcessorSet;
+        if (Processors != NULL) {
+            Target = &(Processors[0]);
+        }
+
+        Status = PcipMsiSetVectors(DeviceToken,
+                                   Type,
+                                   Vector,
+                                   0,
+                                   VectorCount,
+                                   Target);
+
+        if (!KSUCCESS(Status)) {
+            goto MsiEnableVectorsEnd;
+        }
+
+    } else {
+        for (Index = 0; Index < VectorCount; Index += 1) {
+            if (Processors != NULL) {
+                Target = &(Processors[Index]);
+
+            } else {
+                Target = &ProcessorSet;
+                if (ProcessorCount > 1) {
+                    ProcessorSet.Target = ProcessorTargetSingleProcessor;
+                    ProcessorSet.U.Number = (ULONG)(Index % ProcessorCount);
+                }
+            }
+
+            Status = PcipMsiSetVectors(DeviceToken,
+                                       Type,
+                                       Vector + Index,
+                                       Index,
+                                       1,
+                                       Target);
+
+            if (!KSUCCESS(Status)) {
+                goto MsiEnableVectorsEnd;
+            }
+        }
+    }
+
+    RtlZeroMemory(&Information, sizeof(PCI_MSI_INFORMATION));
+    Information.Version = PCI_MSI_INTERFACE_INFORMATION_VERSION;
+    Information.MsiType = Type;
+    Information.Flags = PCI_MSI_INTERFACE_FLAG_ENABLED;
+    Information.VectorCount = VectorCount;
+    Status = PcipMsiGetSetInformation(DeviceToken, &Information, TRUE);
+    if (!KSUCCESS(Status)) {
+        goto MsiEnableVectorsEnd;
+    }
+
+    *MsiType = Type;
+
+MsiEnableVectorsEnd:
+    return Status;
+}
+
 KSTATUS
 PcipMapMsiXTable (
     PPCI_MSI_CONTEXT MsiContext
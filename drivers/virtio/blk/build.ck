@@ -0,0 +1,50 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    Virtio Block
+
+Abstract:
+
+    This module implements the virtio block device driver.
+
+Environment:
+
+    Kernel
+
+--*/
+
+from menv import driver;
+
+function build() {
+    var drv;
+    var dynlibs;
+    var entries;
+    var name = "virtblk";
+    var sources;
+
+    sources = [
+        "virtblk.c",
+        "virtblkhw.c"
+    ];
+
+    dynlibs = [
+        "drivers/virtio/core:virtio"
+    ];
+
+    drv = {
+        "label": name,
+        "inputs": sources + dynlibs,
+    };
+
+    entries = driver(drv);
+    return entries;
+}
+
@@ -0,0 +1,987 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtblk.c
+
+Abstract:
+
+    This module implements the virtio block device driver, which exposes a
+    virtio-blk PCI device as a disk.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "virtblk.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtblkAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    );
+
+VOID
+VirtblkDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtblkDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtblkDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtblkDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtblkDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtblkpDispatchControllerStateChange (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    );
+
+VOID
+VirtblkpDispatchDiskStateChange (
+    PIRP Irp,
+    PVIRTIO_BLOCK_DISK Disk
+    );
+
+VOID
+VirtblkpDispatchDiskSystemControl (
+    PIRP Irp,
+    PVIRTIO_BLOCK_DISK Disk
+    );
+
+KSTATUS
+VirtblkpStartController (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    );
+
+VOID
+VirtblkpEnumerateDisk (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PDRIVER VirtioBlockDriver = NULL;
+
+DRIVER_FUNCTION_TABLE VirtioBlockDriverFunctionTable = {
+    DRIVER_FUNCTION_TABLE_VERSION,
+    NULL,
+    VirtblkAddDevice,
+    NULL,
+    NULL,
+    VirtblkDispatchStateChange,
+    VirtblkDispatchOpen,
+    VirtblkDispatchClose,
+    VirtblkDispatchIo,
+    VirtblkDispatchSystemControl,
+    NULL
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+__USED
+KSTATUS
+DriverEntry (
+    PDRIVER Driver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for the virtio block driver. It registers
+    its other dispatch functions, and performs driver-wide initialization.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver object.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code on error.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    VirtioBlockDriver = Driver;
+    Status = IoRegisterDriverFunctions(Driver, &VirtioBlockDriverFunctionTable);
+    return Status;
+}
+
+KSTATUS
+VirtblkAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a device is detected for which the virtio
+    block driver acts as the function driver. The driver will attach itself
+    to the stack.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver being called.
+
+    DeviceId - Supplies a pointer to a string with the device ID.
+
+    ClassId - Supplies a pointer to a string containing the device's class ID.
+
+    CompatibleIds - Supplies a pointer to a string containing device IDs
+        that would be compatible with this device.
+
+    DeviceToken - Supplies an opaque token that the driver can use to identify
+        the device in the system. This token should be used when attaching to
+        the stack.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code if the driver was unsuccessful in attaching itself.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    VIRTIO_INITIALIZATION_BLOCK Parameters;
+    KSTATUS Status;
+
+    Controller = MmAllocateNonPagedPool(sizeof(VIRTIO_BLOCK_CONTROLLER),
+                                        VIRTIO_BLOCK_ALLOCATION_TAG);
+
+    if (Controller == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    RtlZeroMemory(Controller, sizeof(VIRTIO_BLOCK_CONTROLLER));
+    Controller->Type = VirtioBlockContextController;
+    Controller->OsDevice = DeviceToken;
+    Controller->Disk.Type = VirtioBlockContextDisk;
+    Controller->Disk.Controller = Controller;
+
+    //
+    // Ask for an interrupt group per processor. The number of queues is not
+    // known until the device is started.
+    //
+
+    RtlZeroMemory(&Parameters, sizeof(VIRTIO_INITIALIZATION_BLOCK));
+    Parameters.Version = VIRTIO_INITIALIZATION_BLOCK_VERSION;
+    Parameters.OsDevice = DeviceToken;
+    Parameters.ConsumerContext = Controller;
+    Parameters.MaxInterruptGroups = VIRTIO_BLOCK_MAX_QUEUES;
+    Controller->Virtio = VirtioCreateDevice(&Parameters);
+    if (Controller->Virtio == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    Status = IoAttachDriverToDevice(Driver, DeviceToken, Controller);
+    if (!KSUCCESS(Status)) {
+        goto AddDeviceEnd;
+    }
+
+AddDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Controller != NULL) {
+            if (Controller->Virtio != NULL) {
+                VirtioDestroyDevice(Controller->Virtio);
+            }
+
+            MmFreeNonPagedPool(Controller);
+        }
+    }
+
+    return Status;
+}
+
+VOID
+VirtblkDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles State Change IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+
+    Controller = DeviceContext;
+    switch (Controller->Type) {
+    case VirtioBlockContextController:
+        VirtblkpDispatchControllerStateChange(Irp, Controller);
+        break;
+
+    case VirtioBlockContextDisk:
+        VirtblkpDispatchDiskStateChange(Irp, (PVIRTIO_BLOCK_DISK)Controller);
+        break;
+
+    default:
+
+        ASSERT(FALSE);
+
+        IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_INVALID_CONFIGURATION);
+        break;
+    }
+
+    return;
+}
+
+VOID
+VirtblkDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Open IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_DISK Disk;
+
+    //
+    // Only the disk can be opened or closed.
+    //
+
+    Disk = (PVIRTIO_BLOCK_DISK)DeviceContext;
+    if (Disk->Type != VirtioBlockContextDisk) {
+        return;
+    }
+
+    Irp->U.Open.DeviceContext = Disk;
+    IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_SUCCESS);
+    return;
+}
+
+VOID
+VirtblkDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Close IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_DISK Disk;
+
+    //
+    // Only the disk can be opened or closed.
+    //
+
+    Disk = (PVIRTIO_BLOCK_DISK)DeviceContext;
+    if (Disk->Type != VirtioBlockContextDisk) {
+        return;
+    }
+
+    IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_SUCCESS);
+    return;
+}
+
+VOID
+VirtblkDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles I/O IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL CompleteIrp;
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    PVIRTIO_BLOCK_DISK Disk;
+    ULONG IrpReadWriteFlags;
+    BOOL PmReferenceAdded;
+    KSTATUS Status;
+    BOOL Write;
+
+    Disk = (PVIRTIO_BLOCK_DISK)Irp->U.ReadWrite.DeviceContext;
+    if (Disk->Type != VirtioBlockContextDisk) {
+        return;
+    }
+
+    Controller = Disk->Controller;
+    CompleteIrp = TRUE;
+    Write = FALSE;
+    if (Irp->MinorCode == IrpMinorIoWrite) {
+        Write = TRUE;
+    }
+
+    //
+    // If this IRP is on the way down, always add a power management reference.
+    //
+
+    PmReferenceAdded = FALSE;
+    if (Irp->Direction == IrpDown) {
+        if ((Write != FALSE) &&
+            ((Controller->Flags & VIRTIO_BLOCK_FLAG_READ_ONLY) != 0)) {
+
+            Status = STATUS_ACCESS_DENIED;
+            goto DispatchIoEnd;
+        }
+
+        Status = PmDeviceAddReference(Disk->OsDevice);
+        if (!KSUCCESS(Status)) {
+            goto DispatchIoEnd;
+        }
+
+        PmReferenceAdded = TRUE;
+    }
+
+    //
+    // Set the IRP read/write flags for the preparation and completion steps.
+    //
+
+    IrpReadWriteFlags = IRP_READ_WRITE_FLAG_DMA;
+    if (Write != FALSE) {
+        IrpReadWriteFlags |= IRP_READ_WRITE_FLAG_WRITE;
+    }
+
+    //
+    // If the IRP is on the way up, then clean up after the DMA as this IRP is
+    // still sitting in the channel. An IRP going up is already complete.
+    //
+
+    if (Irp->Direction == IrpUp) {
+        CompleteIrp = FALSE;
+        PmDeviceReleaseReference(Disk->OsDevice);
+        Status = IoCompleteReadWriteIrp(&(Irp->U.ReadWrite), IrpReadWriteFlags);
+        if (!KSUCCESS(Status)) {
+            IoUpdateIrpStatus(Irp, Status);
+        }
+
+    //
+    // Start the DMA on the way down.
+    //
+
+    } else {
+        Irp->U.ReadWrite.NewIoOffset = Irp->U.ReadWrite.IoOffset;
+
+        //
+        // Virtio devices can reach all of physical memory, so the only
+        // requirement is block alignment.
+        //
+
+        Status = IoPrepareReadWriteIrp(&(Irp->U.ReadWrite),
+                                       Controller->BlockSize,
+                                       0,
+                                       MAX_ULONGLONG,
+                                       IrpReadWriteFlags);
+
+        if (!KSUCCESS(Status)) {
+            goto DispatchIoEnd;
+        }
+
+        CompleteIrp = FALSE;
+        Status = VirtblkpEnqueueIrp(Controller, Irp);
+        if (!KSUCCESS(Status)) {
+            IoCompleteReadWriteIrp(&(Irp->U.ReadWrite), IrpReadWriteFlags);
+            CompleteIrp = TRUE;
+        }
+    }
+
+DispatchIoEnd:
+    if (CompleteIrp != FALSE) {
+        if (PmReferenceAdded != FALSE) {
+            PmDeviceReleaseReference(Disk->OsDevice);
+        }
+
+        IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+    }
+
+    return;
+}
+
+VOID
+VirtblkDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_DISK Disk;
+
+    ASSERT(Irp->MajorCode == IrpMajorSystemControl);
+
+    Disk = (PVIRTIO_BLOCK_DISK)DeviceContext;
+    if (Disk->Type == VirtioBlockContextDisk) {
+        VirtblkpDispatchDiskSystemControl(Irp, Disk);
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+VirtblkpDispatchControllerStateChange (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles state change IRPs for a virtio block controller.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Controller - Supplies a pointer to the controller context.
+
+Return Value:
+
+    None. The routine completes the IRP if appropriate.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    if (Irp->Direction == IrpUp) {
+        if (!KSUCCESS(IoGetIrpStatus(Irp))) {
+            return;
+        }
+
+        switch (Irp->MinorCode) {
+        case IrpMinorQueryResources:
+            Status = VirtioProcessResourceRequirements(Controller->Virtio, Irp);
+            if (!KSUCCESS(Status)) {
+                IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+            }
+
+            break;
+
+        case IrpMinorStartDevice:
+            Status = VirtblkpStartController(Irp, Controller);
+            if (!KSUCCESS(Status)) {
+                IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+            }
+
+            break;
+
+        case IrpMinorQueryChildren:
+            VirtblkpEnumerateDisk(Irp, Controller);
+            break;
+
+        case IrpMinorIdle:
+        case IrpMinorSuspend:
+        case IrpMinorResume:
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+VirtblkpDispatchDiskStateChange (
+    PIRP Irp,
+    PVIRTIO_BLOCK_DISK Disk
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles state change IRPs for a virtio block disk device.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Disk - Supplies a pointer to the disk.
+
+Return Value:
+
+    None. The routine completes the IRP if appropriate.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    if (Irp->Direction == IrpDown) {
+        switch (Irp->MinorCode) {
+        case IrpMinorStartDevice:
+
+            ASSERT(Disk->OsDevice == Irp->Device);
+
+            Status = PmInitialize(Irp->Device);
+            IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+            break;
+
+        case IrpMinorQueryResources:
+        case IrpMinorQueryChildren:
+        case IrpMinorIdle:
+        case IrpMinorSuspend:
+        case IrpMinorResume:
+        case IrpMinorRemoveDevice:
+            IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+VirtblkpDispatchDiskSystemControl (
+    PIRP Irp,
+    PVIRTIO_BLOCK_DISK Disk
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs for a virtio block disk.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Disk - Supplies a pointer to the disk.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG BlockCount;
+    ULONG BlockSize;
+    PVOID Context;
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    PSYSTEM_CONTROL_FILE_OPERATION FileOperation;
+    PSYSTEM_CONTROL_LOOKUP Lookup;
+    PFILE_PROPERTIES Properties;
+    ULONGLONG PropertiesFileSize;
+    KSTATUS Status;
+
+    Context = Irp->U.SystemControl.SystemContext;
+    Controller = Disk->Controller;
+    if (Irp->Direction == IrpUp) {
+
+        ASSERT(Irp->MinorCode == IrpMinorSystemControlSynchronize);
+
+        PmDeviceReleaseReference(Disk->OsDevice);
+        return;
+    }
+
+    BlockSize = Controller->BlockSize;
+    BlockCount = (Controller->Capacity * VIRTIO_BLOCK_SECTOR_SIZE) / BlockSize;
+    switch (Irp->MinorCode) {
+    case IrpMinorSystemControlLookup:
+        Lookup = (PSYSTEM_CONTROL_LOOKUP)Context;
+        Status = STATUS_PATH_NOT_FOUND;
+        if (Lookup->Root != FALSE) {
+
+            //
+            // Enable opening of the root as a single file.
+            //
+
+            Properties = Lookup->Properties;
+            Properties->FileId = 0;
+            Properties->Type = IoObjectBlockDevice;
+            Properties->HardLinkCount = 1;
+            Properties->BlockSize = BlockSize;
+            Properties->BlockCount = BlockCount;
+            Properties->Size = BlockCount * BlockSize;
+            Status = STATUS_SUCCESS;
+        }
+
+        IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+        break;
+
+    //
+    // Writes to the disk's properties are not allowed. Fail if the data
+    // has changed.
+    //
+
+    case IrpMinorSystemControlWriteFileProperties:
+        FileOperation = (PSYSTEM_CONTROL_FILE_OPERATION)Context;
+        Properties = FileOperation->FileProperties;
+        PropertiesFileSize = Properties->Size;
+        if ((Properties->FileId != 0) ||
+            (Properties->Type != IoObjectBlockDevice) ||
+            (Properties->HardLinkCount != 1) ||
+            (Properties->BlockSize != BlockSize) ||
+            (Properties->BlockCount != BlockCount) ||
+            (PropertiesFileSize != (BlockCount * BlockSize))) {
+
+            Status = STATUS_NOT_SUPPORTED;
+
+        } else {
+            Status = STATUS_SUCCESS;
+        }
+
+        IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+        break;
+
+    //
+    // Do not support disk device truncation.
+    //
+
+    case IrpMinorSystemControlTruncate:
+        IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_NOT_SUPPORTED);
+        break;
+
+    //
+    // Gather and return device information.
+    //
+
+    case IrpMinorSystemControlDeviceInformation:
+        break;
+
+    //
+    // Send a flush request to the device upon getting a synchronize request.
+    // Devices without a write cache do not offer flush, and have nothing to
+    // do.
+    //
+
+    case IrpMinorSystemControlSynchronize:
+        if ((Controller->Flags & VIRTIO_BLOCK_FLAG_FLUSH) == 0) {
+            IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_SUCCESS);
+            break;
+        }
+
+        Status = PmDeviceAddReference(Disk->OsDevice);
+        if (!KSUCCESS(Status)) {
+            IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+            break;
+        }
+
+        Status = VirtblkpEnqueueIrp(Controller, Irp);
+        if (!KSUCCESS(Status)) {
+            PmDeviceReleaseReference(Disk->OsDevice);
+            IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+        }
+
+        break;
+
+    //
+    // Ignore everything unrecognized.
+    //
+
+    default:
+
+        ASSERT(FALSE);
+
+        break;
+    }
+
+    return;
+}
+
+KSTATUS
+VirtblkpStartController (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts a virtio block controller.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Controller - Supplies a pointer to the controller.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    //
+    // Resetting the device would tear down the live queues, so a started
+    // controller is left alone.
+    //
+
+    if ((Controller->Flags & VIRTIO_BLOCK_FLAG_STARTED) != 0) {
+        return STATUS_SUCCESS;
+    }
+
+    Status = VirtioStartDevice(Controller->Virtio, Irp);
+    if (!KSUCCESS(Status)) {
+        goto StartControllerEnd;
+    }
+
+    Status = VirtblkpInitializeController(Controller);
+    if (!KSUCCESS(Status)) {
+        goto StartControllerEnd;
+    }
+
+    Controller->Flags |= VIRTIO_BLOCK_FLAG_STARTED;
+
+StartControllerEnd:
+    return Status;
+}
+
+VOID
+VirtblkpEnumerateDisk (
+    PIRP Irp,
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reports the single disk behind a virtio block controller.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Controller - Supplies a pointer to the controller.
+
+Return Value:
+
+    None. The IRP is completed with the appropriate status.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_DISK Disk;
+    KSTATUS Status;
+
+    Disk = &(Controller->Disk);
+    if (Disk->OsDevice == NULL) {
+        Status = IoCreateDevice(VirtioBlockDriver,
+                                Disk,
+                                Irp->Device,
+                                "Disk",
+                                DISK_CLASS_ID,
+                                NULL,
+                                &(Disk->OsDevice));
+
+        if (!KSUCCESS(Status)) {
+            goto EnumerateDiskEnd;
+        }
+    }
+
+    Status = IoMergeChildArrays(Irp,
+                                &(Disk->OsDevice),
+                                1,
+                                VIRTIO_BLOCK_ALLOCATION_TAG);
+
+EnumerateDiskEnd:
+    IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+    return;
+}
+
@@ -0,0 +1,378 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtblk.h
+
+Abstract:
+
+    This header contains definitions for the virtio block device driver.
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/virtio/virtio.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define VIRTIO_BLOCK_ALLOCATION_TAG 0x6B6C4256 // 'klBV'
+
+//
+// Define the size of a virtio block sector. Request offsets are always in
+// these units, regardless of the device's logical block size.
+//
+
+#define VIRTIO_BLOCK_SECTOR_SIZE 512
+
+//
+// Define the virtio block device feature bits.
+//
+
+#define VIRTIO_BLOCK_FEATURE_SIZE_MAX   (1ULL << 1)
+#define VIRTIO_BLOCK_FEATURE_SEG_MAX    (1ULL << 2)
+#define VIRTIO_BLOCK_FEATURE_READ_ONLY  (1ULL << 5)
+#define VIRTIO_BLOCK_FEATURE_BLOCK_SIZE (1ULL << 6)
+#define VIRTIO_BLOCK_FEATURE_FLUSH      (1ULL << 9)
+#define VIRTIO_BLOCK_FEATURE_MULTIQUEUE (1ULL << 12)
+
+#define VIRTIO_BLOCK_DRIVER_FEATURES     \
+    (VIRTIO_BLOCK_FEATURE_SIZE_MAX |     \
+     VIRTIO_BLOCK_FEATURE_SEG_MAX |      \
+     VIRTIO_BLOCK_FEATURE_READ_ONLY |    \
+     VIRTIO_BLOCK_FEATURE_BLOCK_SIZE |   \
+     VIRTIO_BLOCK_FEATURE_FLUSH |        \
+     VIRTIO_BLOCK_FEATURE_MULTIQUEUE)
+
+//
+// Define the offsets of the fields in the device configuration space.
+//
+
+#define VIRTIO_BLOCK_CONFIG_CAPACITY    0
+#define VIRTIO_BLOCK_CONFIG_SIZE_MAX    8
+#define VIRTIO_BLOCK_CONFIG_SEG_MAX     12
+#define VIRTIO_BLOCK_CONFIG_BLOCK_SIZE  20
+#define VIRTIO_BLOCK_CONFIG_QUEUE_COUNT 34
+
+//
+// Define the request types.
+//
+
+#define VIRTIO_BLOCK_REQUEST_READ  0
+#define VIRTIO_BLOCK_REQUEST_WRITE 1
+#define VIRTIO_BLOCK_REQUEST_FLUSH 4
+
+//
+// Define the request status values written by the device.
+//
+
+#define VIRTIO_BLOCK_STATUS_OK          0
+#define VIRTIO_BLOCK_STATUS_IO_ERROR    1
+#define VIRTIO_BLOCK_STATUS_UNSUPPORTED 2
+
+//
+// Define the maximum number of request queues the driver will use.
+//
+
+#define VIRTIO_BLOCK_MAX_QUEUES 16
+
+//
+// Define the maximum number of data segments in a single request.
+//
+
+#define VIRTIO_BLOCK_MAX_SEGMENTS 64
+
+//
+// Define the maximum number of requests outstanding on one queue.
+//
+
+#define VIRTIO_BLOCK_MAX_REQUESTS 64
+
+//
+// Define the number of descriptors a request uses besides its data: the
+// header and the status byte.
+//
+
+#define VIRTIO_BLOCK_REQUEST_OVERHEAD 2
+
+//
+// Define virtio block controller flags.
+//
+
+#define VIRTIO_BLOCK_FLAG_READ_ONLY 0x00000001
+#define VIRTIO_BLOCK_FLAG_FLUSH     0x00000002
+#define VIRTIO_BLOCK_FLAG_STARTED   0x00000004
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef enum _VIRTIO_BLOCK_CONTEXT_TYPE {
+    VirtioBlockContextInvalid,
+    VirtioBlockContextController,
+    VirtioBlockContextDisk
+} VIRTIO_BLOCK_CONTEXT_TYPE, *PVIRTIO_BLOCK_CONTEXT_TYPE;
+
+typedef struct _VIRTIO_BLOCK_CONTROLLER
+    VIRTIO_BLOCK_CONTROLLER, *PVIRTIO_BLOCK_CONTROLLER;
+
+typedef struct _VIRTIO_BLOCK_QUEUE VIRTIO_BLOCK_QUEUE, *PVIRTIO_BLOCK_QUEUE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the header that starts every virtio block request.
+    This structure is defined by the virtio specification.
+
+Members:
+
+    Type - Stores the request type. See VIRTIO_BLOCK_REQUEST_* definitions.
+
+    Reserved - Stores a reserved field that must be zero.
+
+    Sector - Stores the starting sector of the request, in 512 byte units.
+
+--*/
+
+typedef struct _VIRTIO_BLOCK_REQUEST_HEADER {
+    ULONG Type;
+    ULONG Reserved;
+    ULONGLONG Sector;
+} PACKED VIRTIO_BLOCK_REQUEST_HEADER, *PVIRTIO_BLOCK_REQUEST_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure defines the device visible portion of a request: the
+    header the device reads and the status byte it writes back.
+
+Members:
+
+    Header - Stores the request header.
+
+    Status - Stores the completion status. See VIRTIO_BLOCK_STATUS_*
+        definitions.
+
+--*/
+
+typedef struct _VIRTIO_BLOCK_COMMAND {
+    VIRTIO_BLOCK_REQUEST_HEADER Header;
+    UCHAR Status;
+} PACKED VIRTIO_BLOCK_COMMAND, *PVIRTIO_BLOCK_COMMAND;
+
+/*++
+
+Structure Description:
+
+    This structure defines the software state of a request slot.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous free requests.
+
+    Irp - Stores a pointer to the IRP the request is working on.
+
+    IoSize - Stores the number of bytes being transferred by the request.
+
+    Command - Stores a pointer to the command memory for the request.
+
+    CommandPhysical - Stores the physical address of the command memory.
+
+--*/
+
+typedef struct _VIRTIO_BLOCK_REQUEST {
+    LIST_ENTRY ListEntry;
+    PIRP Irp;
+    UINTN IoSize;
+    volatile VIRTIO_BLOCK_COMMAND *Command;
+    PHYSICAL_ADDRESS CommandPhysical;
+} VIRTIO_BLOCK_REQUEST, *PVIRTIO_BLOCK_REQUEST;
+
+/*++
+
+Structure Description:
+
+    This structure defines a virtio block request queue. Each processor
+    submits I/O to its own queue, whose completions interrupt back on the
+    same processor.
+
+Members:
+
+    Controller - Stores a pointer to the controller that owns the queue.
+
+    Queue - Stores a pointer to the virtqueue.
+
+    Lock - Stores the spin lock serializing access to the queue.
+
+    IrpQueue - Stores the list of IRPs waiting for a free request slot.
+
+    FreeRequests - Stores the list of free request slots.
+
+    Requests - Stores the array of request slots.
+
+    RequestCount - Stores the number of request slots.
+
+    CommandIoBuffer - Stores the I/O buffer holding the command memory of all
+        the request slots.
+
+    Buffers - Stores a scratch array used to build descriptor chains.
+
+--*/
+
+struct _VIRTIO_BLOCK_QUEUE {
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    PVIRTIO_QUEUE Queue;
+    KSPIN_LOCK Lock;
+    LIST_ENTRY IrpQueue;
+    LIST_ENTRY FreeRequests;
+    PVIRTIO_BLOCK_REQUEST Requests;
+    ULONG RequestCount;
+    PIO_BUFFER CommandIoBuffer;
+    PVIRTIO_BUFFER Buffers;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines the disk child device of a virtio block
+    controller.
+
+Members:
+
+    Type - Stores the context type, which is always disk.
+
+    Controller - Stores a pointer to the parent controller.
+
+    OsDevice - Stores a pointer to the OS device for the disk.
+
+--*/
+
+typedef struct _VIRTIO_BLOCK_DISK {
+    VIRTIO_BLOCK_CONTEXT_TYPE Type;
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    PDEVICE OsDevice;
+} VIRTIO_BLOCK_DISK, *PVIRTIO_BLOCK_DISK;
+
+/*++
+
+Structure Description:
+
+    This structure defines the context for a virtio block controller.
+
+Members:
+
+    Type - Stores the context type, which is always controller.
+
+    OsDevice - Stores a pointer to the OS device for the controller.
+
+    Virtio - Stores a pointer to the virtio transport device.
+
+    Disk - Stores the disk child device.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_BLOCK_FLAG_* definitions.
+
+    Capacity - Stores the size of the disk in 512 byte sectors.
+
+    BlockSize - Stores the logical block size of the disk.
+
+    SegmentMax - Stores the maximum number of data segments per request.
+
+    SizeMax - Stores the maximum size of a single data segment.
+
+    QueueCount - Stores the number of request queues in use.
+
+    Queues - Stores the array of request queues.
+
+--*/
+
+struct _VIRTIO_BLOCK_CONTROLLER {
+    VIRTIO_BLOCK_CONTEXT_TYPE Type;
+    PDEVICE OsDevice;
+    PVIRTIO_DEVICE Virtio;
+    VIRTIO_BLOCK_DISK Disk;
+    ULONG Flags;
+    ULONGLONG Capacity;
+    ULONG BlockSize;
+    ULONG SegmentMax;
+    ULONG SizeMax;
+    ULONG QueueCount;
+    PVIRTIO_BLOCK_QUEUE Queues;
+};
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+extern PDRIVER VirtioBlockDriver;
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+KSTATUS
+VirtblkpInitializeController (
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    );
+
+/*++
+
+Routine Description:
+
+    This routine negotiates features with a started virtio block device,
+    reads its geometry, and creates its request queues.
+
+Arguments:
+
+    Controller - Supplies a pointer to the controller.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+VirtblkpEnqueueIrp (
+    PVIRTIO_BLOCK_CONTROLLER Controller,
+    PIRP Irp
+    );
+
+/*++
+
+Routine Description:
+
+    This routine begins I/O on a fresh IRP, submitting it to the current
+    processor's queue.
+
+Arguments:
+
+    Controller - Supplies a pointer to the controller.
+
+    Irp - Supplies a pointer to the read/write or synchronize IRP.
+
+Return Value:
+
+    STATUS_SUCCESS if the IRP was successfully started or even queued.
+
+    Error code on failure.
+
+--*/
+
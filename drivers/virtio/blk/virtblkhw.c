@@ -0,0 +1,943 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtblkhw.c
+
+Abstract:
+
+    This module implements the request queues of the virtio block driver.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "virtblk.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtblkpInitializeQueue (
+    PVIRTIO_BLOCK_CONTROLLER Controller,
+    ULONG Index
+    );
+
+VOID
+VirtblkpServiceQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    );
+
+VOID
+VirtblkpStartRequest (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request,
+    PIRP Irp
+    );
+
+VOID
+VirtblkpPerformDmaIo (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    );
+
+VOID
+VirtblkpExecuteFlush (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    );
+
+VOID
+VirtblkpCompleteRequest (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    );
+
+VOID
+VirtblkpBeginNextIrp (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+VirtblkpInitializeController (
+    PVIRTIO_BLOCK_CONTROLLER Controller
+    )
+
+/*++
+
+Routine Description:
+
+    This routine negotiates features with a started virtio block device,
+    reads its geometry, and creates its request queues.
+
+Arguments:
+
+    Controller - Supplies a pointer to the controller.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG BlockSize;
+    ULONG Index;
+    USHORT QueueCount;
+    ULONG SegmentMax;
+    UINTN Size;
+    ULONG SizeMax;
+    KSTATUS Status;
+    PVIRTIO_DEVICE Virtio;
+
+    Virtio = Controller->Virtio;
+    Status = VirtioNegotiateFeatures(Virtio, VIRTIO_BLOCK_DRIVER_FEATURES);
+    if (!KSUCCESS(Status)) {
+        goto InitializeControllerEnd;
+    }
+
+    Status = VirtioReadDeviceConfiguration(Virtio,
+                                           VIRTIO_BLOCK_CONFIG_CAPACITY,
+                                           sizeof(ULONGLONG),
+                                           &(Controller->Capacity));
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeControllerEnd;
+    }
+
+    Controller->BlockSize = VIRTIO_BLOCK_SECTOR_SIZE;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_BLOCK_SIZE)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_BLOCK_CONFIG_BLOCK_SIZE,
+                                               sizeof(ULONG),
+                                               &BlockSize);
+
+        if ((KSUCCESS(Status)) &&
+            (BlockSize >= VIRTIO_BLOCK_SECTOR_SIZE) &&
+            (POWER_OF_2(BlockSize))) {
+
+            Controller->BlockSize = BlockSize;
+        }
+    }
+
+    Controller->SegmentMax = VIRTIO_BLOCK_MAX_SEGMENTS;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_SEG_MAX)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_BLOCK_CONFIG_SEG_MAX,
+                                               sizeof(ULONG),
+                                               &SegmentMax);
+
+        if ((KSUCCESS(Status)) && (SegmentMax != 0) &&
+            (SegmentMax < Controller->SegmentMax)) {
+
+            Controller->SegmentMax = SegmentMax;
+        }
+    }
+
+    //
+    // Segments must stay block aligned so that every request is a whole
+    // number of blocks.
+    //
+
+    Controller->SizeMax = MAX_ULONG;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_SIZE_MAX)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_BLOCK_CONFIG_SIZE_MAX,
+                                               sizeof(ULONG),
+                                               &SizeMax);
+
+        if ((KSUCCESS(Status)) && (SizeMax >= Controller->BlockSize)) {
+            Controller->SizeMax = SizeMax;
+        }
+    }
+
+    Controller->SizeMax = ALIGN_RANGE_DOWN(Controller->SizeMax,
+                                           Controller->BlockSize);
+
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_READ_ONLY)) {
+        Controller->Flags |= VIRTIO_BLOCK_FLAG_READ_ONLY;
+    }
+
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_FLUSH)) {
+        Controller->Flags |= VIRTIO_BLOCK_FLAG_FLUSH;
+    }
+
+    //
+    // Use a queue per processor, up to what the device offers.
+    //
+
+    QueueCount = 1;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_BLOCK_FEATURE_MULTIQUEUE)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_BLOCK_CONFIG_QUEUE_COUNT,
+                                               sizeof(USHORT),
+                                               &QueueCount);
+
+        if ((!KSUCCESS(Status)) || (QueueCount == 0)) {
+            QueueCount = 1;
+        }
+    }
+
+    Controller->QueueCount = QueueCount;
+    if (Controller->QueueCount > KeGetActiveProcessorCount()) {
+        Controller->QueueCount = KeGetActiveProcessorCount();
+    }
+
+    if (Controller->QueueCount > VIRTIO_BLOCK_MAX_QUEUES) {
+        Controller->QueueCount = VIRTIO_BLOCK_MAX_QUEUES;
+    }
+
+    if (Controller->QueueCount > Virtio->QueueCount) {
+        Controller->QueueCount = Virtio->QueueCount;
+    }
+
+    Size = sizeof(VIRTIO_BLOCK_QUEUE) * Controller->QueueCount;
+    Controller->Queues = MmAllocateNonPagedPool(Size,
+                                                VIRTIO_BLOCK_ALLOCATION_TAG);
+
+    if (Controller->Queues == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeControllerEnd;
+    }
+
+    RtlZeroMemory(Controller->Queues, Size);
+    for (Index = 0; Index < Controller->QueueCount; Index += 1) {
+        Status = VirtblkpInitializeQueue(Controller, Index);
+        if (!KSUCCESS(Status)) {
+            goto InitializeControllerEnd;
+        }
+    }
+
+    VirtioSetDriverReady(Virtio);
+    Status = STATUS_SUCCESS;
+
+InitializeControllerEnd:
+    return Status;
+}
+
+KSTATUS
+VirtblkpEnqueueIrp (
+    PVIRTIO_BLOCK_CONTROLLER Controller,
+    PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine begins I/O on a fresh IRP, submitting it to the current
+    processor's queue.
+
+Arguments:
+
+    Controller - Supplies a pointer to the controller.
+
+    Irp - Supplies a pointer to the read/write or synchronize IRP.
+
+Return Value:
+
+    STATUS_SUCCESS if the IRP was successfully started or even queued.
+
+    Error code on failure.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_QUEUE BlockQueue;
+    RUNLEVEL OldRunLevel;
+    PVIRTIO_BLOCK_REQUEST Request;
+
+    IoPendIrp(VirtioBlockDriver, Irp);
+
+    //
+    // Submit on the current processor's queue so that the completion
+    // interrupt comes back to the same processor. Once at dispatch the
+    // processor cannot change.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    BlockQueue = &(Controller->Queues[KeGetCurrentProcessorNumber() %
+                                      Controller->QueueCount]);
+
+    KeAcquireSpinLock(&(BlockQueue->Lock));
+
+    //
+    // If all the request slots are busy, queue the IRP. The next completion
+    // picks it up.
+    //
+
+    if (LIST_EMPTY(&(BlockQueue->FreeRequests))) {
+        INSERT_BEFORE(&(Irp->ListEntry), &(BlockQueue->IrpQueue));
+
+    } else {
+        Request = LIST_VALUE(BlockQueue->FreeRequests.Next,
+                             VIRTIO_BLOCK_REQUEST,
+                             ListEntry);
+
+        LIST_REMOVE(&(Request->ListEntry));
+        VirtblkpStartRequest(BlockQueue, Request, Irp);
+        VirtioQueueKick(BlockQueue->Queue);
+    }
+
+    KeReleaseSpinLock(&(BlockQueue->Lock));
+    KeLowerRunLevel(OldRunLevel);
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+VirtblkpInitializeQueue (
+    PVIRTIO_BLOCK_CONTROLLER Controller,
+    ULONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a request queue and its request slots.
+
+Arguments:
+
+    Controller - Supplies a pointer to the controller.
+
+    Index - Supplies the index of the queue to create.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_QUEUE BlockQueue;
+    PUCHAR Commands;
+    PHYSICAL_ADDRESS CommandsPhysical;
+    ULONG Descriptors;
+    ULONG RequestIndex;
+    PVIRTIO_BLOCK_REQUEST Request;
+    UINTN Size;
+    KSTATUS Status;
+
+    BlockQueue = &(Controller->Queues[Index]);
+    BlockQueue->Controller = Controller;
+    KeInitializeSpinLock(&(BlockQueue->Lock));
+    INITIALIZE_LIST_HEAD(&(BlockQueue->IrpQueue));
+    INITIALIZE_LIST_HEAD(&(BlockQueue->FreeRequests));
+
+    //
+    // Queue N belongs to interrupt group N, which is pinned to processor N.
+    //
+
+    Status = VirtioCreateQueue(Controller->Virtio,
+                               Index,
+                               0,
+                               Index,
+                               VirtblkpServiceQueue,
+                               BlockQueue,
+                               &(BlockQueue->Queue));
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeQueueEnd;
+    }
+
+    //
+    // Size the request slots so that a full request can always be added
+    // without running out of descriptors.
+    //
+
+    Descriptors = BlockQueue->Queue->Size;
+    if (Controller->SegmentMax + VIRTIO_BLOCK_REQUEST_OVERHEAD > Descriptors) {
+        Controller->SegmentMax = Descriptors - VIRTIO_BLOCK_REQUEST_OVERHEAD;
+    }
+
+    if (Controller->SegmentMax == 0) {
+        Status = STATUS_NOT_SUPPORTED;
+        goto InitializeQueueEnd;
+    }
+
+    Descriptors /= Controller->SegmentMax + VIRTIO_BLOCK_REQUEST_OVERHEAD;
+    BlockQueue->RequestCount = Descriptors;
+
+    if (BlockQueue->RequestCount > VIRTIO_BLOCK_MAX_REQUESTS) {
+        BlockQueue->RequestCount = VIRTIO_BLOCK_MAX_REQUESTS;
+    }
+
+    Size = sizeof(VIRTIO_BLOCK_REQUEST) * BlockQueue->RequestCount;
+    BlockQueue->Requests = MmAllocateNonPagedPool(Size,
+                                                  VIRTIO_BLOCK_ALLOCATION_TAG);
+
+    if (BlockQueue->Requests == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueueEnd;
+    }
+
+    RtlZeroMemory(BlockQueue->Requests, Size);
+    Size = sizeof(VIRTIO_BUFFER) *
+           (Controller->SegmentMax + VIRTIO_BLOCK_REQUEST_OVERHEAD);
+
+    BlockQueue->Buffers = MmAllocateNonPagedPool(Size,
+                                                 VIRTIO_BLOCK_ALLOCATION_TAG);
+
+    if (BlockQueue->Buffers == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueueEnd;
+    }
+
+    Size = sizeof(VIRTIO_BLOCK_COMMAND) * BlockQueue->RequestCount;
+    BlockQueue->CommandIoBuffer = MmAllocateNonPagedIoBuffer(
+                                         0,
+                                         MAX_ULONGLONG,
+                                         sizeof(ULONGLONG),
+                                         Size,
+                                         IO_BUFFER_FLAG_PHYSICALLY_CONTIGUOUS);
+
+    if (BlockQueue->CommandIoBuffer == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueueEnd;
+    }
+
+    ASSERT(BlockQueue->CommandIoBuffer->FragmentCount == 1);
+
+    Commands = BlockQueue->CommandIoBuffer->Fragment[0].VirtualAddress;
+    CommandsPhysical = BlockQueue->CommandIoBuffer->Fragment[0].PhysicalAddress;
+    RtlZeroMemory(Commands, Size);
+    for (RequestIndex = 0;
+         RequestIndex < BlockQueue->RequestCount;
+         RequestIndex += 1) {
+
+        Request = &(BlockQueue->Requests[RequestIndex]);
+        Request->Command = (PVOID)Commands;
+        Request->CommandPhysical = CommandsPhysical;
+        INSERT_BEFORE(&(Request->ListEntry), &(BlockQueue->FreeRequests));
+        Commands += sizeof(VIRTIO_BLOCK_COMMAND);
+        CommandsPhysical += sizeof(VIRTIO_BLOCK_COMMAND);
+    }
+
+    Status = STATUS_SUCCESS;
+
+InitializeQueueEnd:
+    return Status;
+}
+
+VOID
+VirtblkpServiceQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called at dispatch level when the device has completed
+    requests on a queue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the virtqueue.
+
+    Context - Supplies a pointer to the block queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BLOCK_QUEUE BlockQueue;
+    ULONG Length;
+    PVIRTIO_BLOCK_REQUEST Request;
+
+    BlockQueue = Context;
+    KeAcquireSpinLock(&(BlockQueue->Lock));
+
+    //
+    // Keep interrupts off while draining, then turn them back on and drain
+    // again if anything slipped in.
+    //
+
+    do {
+        VirtioQueueDisableNotifications(Queue);
+        while (TRUE) {
+            Request = VirtioQueueGetUsed(Queue, &Length);
+            if (Request == NULL) {
+                break;
+            }
+
+            VirtblkpCompleteRequest(BlockQueue, Request);
+        }
+
+    } while (VirtioQueueEnableNotifications(Queue) != FALSE);
+
+    //
+    // Completions may have started new requests. Tell the device about all of
+    // them at once.
+    //
+
+    VirtioQueueKick(Queue);
+    KeReleaseSpinLock(&(BlockQueue->Lock));
+    return;
+}
+
+VOID
+VirtblkpStartRequest (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request,
+    PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts work on a new IRP using the given request slot. The
+    queue lock must be held. The caller is responsible for kicking the queue.
+
+Arguments:
+
+    BlockQueue - Supplies a pointer to the block queue.
+
+    Request - Supplies a pointer to the free request slot.
+
+    Irp - Supplies a pointer to the IRP to start.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT(KeIsSpinLockHeld(&(BlockQueue->Lock)) != FALSE);
+
+    Request->Irp = Irp;
+    if (Irp->MajorCode == IrpMajorIo) {
+        VirtblkpPerformDmaIo(BlockQueue, Request);
+
+    } else {
+
+        ASSERT((Irp->MajorCode == IrpMajorSystemControl) &&
+               (Irp->MinorCode == IrpMinorSystemControlSynchronize));
+
+        VirtblkpExecuteFlush(BlockQueue, Request);
+    }
+
+    return;
+}
+
+VOID
+VirtblkpPerformDmaIo (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills out and submits a read or write request for the next
+    portion of the request's IRP.
+
+Arguments:
+
+    BlockQueue - Supplies a pointer to the block queue.
+
+    Request - Supplies a pointer to the request slot.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BUFFER Buffers;
+    UINTN BytesPreviouslyCompleted;
+    UINTN BytesToComplete;
+    volatile VIRTIO_BLOCK_COMMAND *Command;
+    PVIRTIO_BLOCK_CONTROLLER Controller;
+    UINTN EntrySize;
+    PIO_BUFFER_FRAGMENT Fragment;
+    UINTN FragmentIndex;
+    UINTN FragmentOffset;
+    PIO_BUFFER IoBuffer;
+    UINTN IoBufferOffset;
+    ULONGLONG IoOffset;
+    PIRP Irp;
+    ULONG SegmentCount;
+    KSTATUS Status;
+    UINTN TransferSize;
+    UINTN TransferSizeRemaining;
+    BOOL Write;
+
+    Controller = BlockQueue->Controller;
+    Irp = Request->Irp;
+    IoBuffer = Irp->U.ReadWrite.IoBuffer;
+    BytesPreviouslyCompleted = Irp->U.ReadWrite.IoBytesCompleted;
+    BytesToComplete = Irp->U.ReadWrite.IoSizeInBytes;
+    IoOffset = Irp->U.ReadWrite.NewIoOffset;
+
+    ASSERT(IoOffset == (Irp->U.ReadWrite.IoOffset + BytesPreviouslyCompleted));
+    ASSERT(IS_ALIGNED(IoOffset, Controller->BlockSize) != FALSE);
+    ASSERT(IS_ALIGNED(BytesToComplete, Controller->BlockSize) != FALSE);
+
+    TransferSize = BytesToComplete - BytesPreviouslyCompleted;
+    if (TransferSize == 0) {
+        Request->Irp = NULL;
+        IoCompleteIrp(VirtioBlockDriver, Irp, STATUS_SUCCESS);
+        VirtblkpBeginNextIrp(BlockQueue, Request);
+        return;
+    }
+
+    Write = FALSE;
+    if (Irp->MinorCode == IrpMinorIoWrite) {
+        Write = TRUE;
+    }
+
+    //
+    // Get to the current spot in the I/O buffer.
+    //
+
+    IoBufferOffset = MmGetIoBufferCurrentOffset(IoBuffer);
+    IoBufferOffset += BytesPreviouslyCompleted;
+    FragmentIndex = 0;
+    FragmentOffset = 0;
+    while (IoBufferOffset != 0) {
+
+        ASSERT(FragmentIndex < IoBuffer->FragmentCount);
+
+        Fragment = &(IoBuffer->Fragment[FragmentIndex]);
+        if (IoBufferOffset < Fragment->Size) {
+            FragmentOffset = IoBufferOffset;
+            break;
+        }
+
+        IoBufferOffset -= Fragment->Size;
+        FragmentIndex += 1;
+    }
+
+    //
+    // The header goes first, then a descriptor per data segment, then the
+    // status byte.
+    //
+
+    Buffers = BlockQueue->Buffers;
+    Buffers[0].Address = Request->CommandPhysical;
+    Buffers[0].Length = sizeof(VIRTIO_BLOCK_REQUEST_HEADER);
+    SegmentCount = 0;
+    TransferSizeRemaining = TransferSize;
+    while ((TransferSizeRemaining != 0) &&
+           (SegmentCount < Controller->SegmentMax)) {
+
+        ASSERT(FragmentIndex < IoBuffer->FragmentCount);
+
+        Fragment = &(IoBuffer->Fragment[FragmentIndex]);
+        EntrySize = TransferSizeRemaining;
+        if (EntrySize > (Fragment->Size - FragmentOffset)) {
+            EntrySize = Fragment->Size - FragmentOffset;
+        }
+
+        if (EntrySize > Controller->SizeMax) {
+            EntrySize = Controller->SizeMax;
+        }
+
+        ASSERT(IS_ALIGNED(EntrySize, VIRTIO_BLOCK_SECTOR_SIZE) != FALSE);
+
+        SegmentCount += 1;
+        Buffers[SegmentCount].Address = Fragment->PhysicalAddress +
+                                        FragmentOffset;
+
+        Buffers[SegmentCount].Length = EntrySize;
+        TransferSizeRemaining -= EntrySize;
+        FragmentOffset += EntrySize;
+        if (FragmentOffset >= Fragment->Size) {
+            FragmentIndex += 1;
+            FragmentOffset = 0;
+        }
+    }
+
+    ASSERT(SegmentCount != 0);
+
+    TransferSize -= TransferSizeRemaining;
+    Request->IoSize = TransferSize;
+    Command = Request->Command;
+    Command->Header.Type = VIRTIO_BLOCK_REQUEST_READ;
+    if (Write != FALSE) {
+        Command->Header.Type = VIRTIO_BLOCK_REQUEST_WRITE;
+    }
+
+    Command->Header.Reserved = 0;
+    Command->Header.Sector = IoOffset / VIRTIO_BLOCK_SECTOR_SIZE;
+    Command->Status = MAX_UCHAR;
+    Buffers[SegmentCount + 1].Address = Request->CommandPhysical +
+                                        FIELD_OFFSET(VIRTIO_BLOCK_COMMAND,
+                                                     Status);
+
+    Buffers[SegmentCount + 1].Length = sizeof(UCHAR);
+
+    //
+    // For a write the device reads the header and data. For a read it only
+    // reads the header.
+    //
+
+    if (Write != FALSE) {
+        Status = VirtioQueueAdd(BlockQueue->Queue,
+                                Buffers,
+                                SegmentCount + 1,
+                                1,
+                                Request);
+
+    } else {
+        Status = VirtioQueueAdd(BlockQueue->Queue,
+                                Buffers,
+                                1,
+                                SegmentCount + 1,
+                                Request);
+    }
+
+    //
+    // Request slots are sized so that the queue never runs out of
+    // descriptors.
+    //
+
+    ASSERT(KSUCCESS(Status));
+
+    return;
+}
+
+VOID
+VirtblkpExecuteFlush (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    )
+
+/*++
+
+Routine Description:
+
+    This routine submits a cache flush request.
+
+Arguments:
+
+    BlockQueue - Supplies a pointer to the block queue.
+
+    Request - Supplies a pointer to the request slot.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_BUFFER Buffers;
+    volatile VIRTIO_BLOCK_COMMAND *Command;
+    KSTATUS Status;
+
+    Request->IoSize = 0;
+    Command = Request->Command;
+    Command->Header.Type = VIRTIO_BLOCK_REQUEST_FLUSH;
+    Command->Header.Reserved = 0;
+    Command->Header.Sector = 0;
+    Command->Status = MAX_UCHAR;
+    Buffers = BlockQueue->Buffers;
+    Buffers[0].Address = Request->CommandPhysical;
+    Buffers[0].Length = sizeof(VIRTIO_BLOCK_REQUEST_HEADER);
+    Buffers[1].Address = Request->CommandPhysical +
+                         FIELD_OFFSET(VIRTIO_BLOCK_COMMAND, Status);
+
+    Buffers[1].Length = sizeof(UCHAR);
+    Status = VirtioQueueAdd(BlockQueue->Queue, Buffers, 1, 1, Request);
+
+    ASSERT(KSUCCESS(Status));
+
+    return;
+}
+
+VOID
+VirtblkpCompleteRequest (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes a request the device has finished, either
+    continuing its IRP or completing it. The queue lock must be held.
+
+Arguments:
+
+    BlockQueue - Supplies a pointer to the block queue.
+
+    Request - Supplies a pointer to the finished request.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PIRP Irp;
+    UINTN IoSize;
+    KSTATUS Status;
+
+    ASSERT(KeIsSpinLockHeld(&(BlockQueue->Lock)) != FALSE);
+
+    Irp = Request->Irp;
+    IoSize = Request->IoSize;
+    Request->IoSize = 0;
+
+    ASSERT(Irp != NULL);
+
+    switch (Request->Command->Status) {
+    case VIRTIO_BLOCK_STATUS_OK:
+        Status = STATUS_SUCCESS;
+        break;
+
+    case VIRTIO_BLOCK_STATUS_UNSUPPORTED:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+
+    case VIRTIO_BLOCK_STATUS_IO_ERROR:
+    default:
+        RtlDebugPrint("VirtioBlk: I/O error %d\n", Request->Command->Status);
+        Status = STATUS_DEVICE_IO_ERROR;
+        break;
+    }
+
+    if ((KSUCCESS(Status)) && (Irp->MajorCode == IrpMajorIo)) {
+        Irp->U.ReadWrite.IoBytesCompleted += IoSize;
+        Irp->U.ReadWrite.NewIoOffset += IoSize;
+
+        //
+        // If this is a synchronized write, then send a flush along with it.
+        // Use the IoSize as a hint as to whether or not the flush part has
+        // already gone around.
+        //
+
+        if ((Irp->MinorCode == IrpMinorIoWrite) &&
+            ((Irp->U.ReadWrite.IoFlags & IO_FLAG_DATA_SYNCHRONIZED) != 0) &&
+            (Irp->U.ReadWrite.IoBytesCompleted >=
+             Irp->U.ReadWrite.IoSizeInBytes) &&
+            (IoSize != 0) &&
+            ((BlockQueue->Controller->Flags & VIRTIO_BLOCK_FLAG_FLUSH) != 0)) {
+
+            VirtblkpExecuteFlush(BlockQueue, Request);
+            return;
+        }
+
+        //
+        // If the IRP is not finished, queue up the next part.
+        //
+
+        if (Irp->U.ReadWrite.IoBytesCompleted <
+            Irp->U.ReadWrite.IoSizeInBytes) {
+
+            VirtblkpPerformDmaIo(BlockQueue, Request);
+            return;
+        }
+    }
+
+    Request->Irp = NULL;
+    IoCompleteIrp(VirtioBlockDriver, Irp, Status);
+    VirtblkpBeginNextIrp(BlockQueue, Request);
+    return;
+}
+
+VOID
+VirtblkpBeginNextIrp (
+    PVIRTIO_BLOCK_QUEUE BlockQueue,
+    PVIRTIO_BLOCK_REQUEST Request
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts the next queued IRP on the given request slot, or
+    frees the slot if there is no more work to do. The queue lock must be
+    held.
+
+Arguments:
+
+    BlockQueue - Supplies a pointer to the block queue.
+
+    Request - Supplies a pointer to the now idle request slot.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PIRP Irp;
+
+    ASSERT(KeIsSpinLockHeld(&(BlockQueue->Lock)) != FALSE);
+
+    if (!LIST_EMPTY(&(BlockQueue->IrpQueue))) {
+        Irp = LIST_VALUE(BlockQueue->IrpQueue.Next, IRP, ListEntry);
+        LIST_REMOVE(&(Irp->ListEntry));
+        VirtblkpStartRequest(BlockQueue, Request, Irp);
+
+    } else {
+        INSERT_BEFORE(&(Request->ListEntry), &(BlockQueue->FreeRequests));
+    }
+
+    return;
+}
+
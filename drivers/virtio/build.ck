@@ -0,0 +1,43 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    Virtio
+
+Abstract:
+
+    This directory is responsible for building the virtio transport library
+    and the paravirtual device drivers built on it.
+
+Environment:
+
+    Kernel
+
+--*/
+
+from menv import group, mconfig;
+
+function build() {
+    var arch = mconfig.arch;
+    var entries;
+    var virtioDrivers = [];
+
+    if ((arch == "x86") || (arch == "x64")) {
+        virtioDrivers = [
+            "drivers/virtio/core:virtio",
+            "drivers/virtio/blk:virtblk",
+            "drivers/virtio/net:virtnet"
+        ];
+    }
+
+    entries = group("virtio_drivers", virtioDrivers);
+    return entries;
+}
+
@@ -0,0 +1,46 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    Virtio
+
+Abstract:
+
+    This module implements the virtio PCI transport library, which is
+    imported by the virtio device drivers.
+
+Environment:
+
+    Kernel
+
+--*/
+
+from menv import driver;
+
+function build() {
+    var drv;
+    var entries;
+    var name = "virtio";
+    var sources;
+
+    sources = [
+        "queue.c",
+        "virtio.c"
+    ];
+
+    drv = {
+        "label": name,
+        "inputs": sources,
+    };
+
+    entries = driver(drv);
+    return entries;
+}
+
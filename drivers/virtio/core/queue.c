@@ -0,0 +1,1053 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    queue.c
+
+Abstract:
+
+    This module implements virtqueues for the virtio library, in both the
+    split and packed ring layouts, along with event index based notification
+    suppression.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "virtiop.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro returns the packed descriptor flags that mark a descriptor as
+// available given the current available wrap counter.
+//
+
+#define VIRTIO_PACKED_AVAILABLE_FLAGS(_WrapCounter) \
+    (((_WrapCounter) != FALSE) ? VIRTIO_PACKED_DESCRIPTOR_AVAILABLE : \
+                                 VIRTIO_PACKED_DESCRIPTOR_USED)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the alignment of the ring memory. The descriptor table needs 16
+// bytes and the used ring 4, so the whole allocation is just page aligned.
+//
+
+#define VIRTIO_QUEUE_ALIGNMENT 0x1000
+#define VIRTIO_USED_RING_ALIGNMENT 4
+
+//
+// Define the value terminating the free list.
+//
+
+#define VIRTIO_QUEUE_END 0xFFFF
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtiopAddSplit (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    );
+
+KSTATUS
+VirtiopAddPacked (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    );
+
+PVOID
+VirtiopGetUsedSplit (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    );
+
+PVOID
+VirtiopGetUsedPacked (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    );
+
+BOOL
+VirtiopIsUsedPending (
+    PVIRTIO_QUEUE Queue
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VIRTIO_API
+KSTATUS
+VirtioQueueAdd (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a chain of buffers to a virtqueue. The device is not
+    notified until the queue is kicked.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Buffers - Supplies an array of buffers. The buffers the device reads come
+        first, followed by the buffers the device writes.
+
+    OutCount - Supplies the number of buffers the device reads.
+
+    InCount - Supplies the number of buffers the device writes.
+
+    Token - Supplies a non-null token returned when the device uses the chain.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_RESOURCE_IN_USE if there are not enough free descriptors.
+
+--*/
+
+{
+
+    ULONG Count;
+
+    ASSERT(Token != NULL);
+
+    Count = OutCount + InCount;
+    if ((Count == 0) || (Count > Queue->Size)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Count > Queue->FreeCount) {
+        return STATUS_RESOURCE_IN_USE;
+    }
+
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+        return VirtiopAddPacked(Queue, Buffers, OutCount, InCount, Token);
+    }
+
+    return VirtiopAddSplit(Queue, Buffers, OutCount, InCount, Token);
+}
+
+VIRTIO_API
+VOID
+VirtioQueueKick (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine notifies the device of the buffers added since the last
+    kick, unless the device has suppressed notifications.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    USHORT Event;
+    USHORT EventFlags;
+    USHORT EventWrap;
+    BOOL NeedsKick;
+    USHORT New;
+    USHORT Old;
+
+    if (Queue->AddedCount == 0) {
+        return;
+    }
+
+    //
+    // The device must see the new available entries before the driver reads
+    // the suppression state, or a notification could be lost.
+    //
+
+    RtlMemoryBarrier();
+    New = Queue->NextAvailable;
+    Old = New - Queue->AddedCount;
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+        EventFlags = Queue->DeviceEvent->Flags;
+        if (EventFlags == VIRTIO_PACKED_EVENT_DESCRIPTOR) {
+            Event = Queue->DeviceEvent->Descriptor;
+            EventWrap = Event >> VIRTIO_PACKED_EVENT_WRAP_SHIFT;
+            Event &= ~(1 << VIRTIO_PACKED_EVENT_WRAP_SHIFT);
+            if (EventWrap != Queue->AvailableWrapCounter) {
+                Event -= Queue->Size;
+            }
+
+            NeedsKick = VIRTIO_NEED_EVENT(Event, New, Old);
+
+        } else {
+            NeedsKick = (EventFlags != VIRTIO_PACKED_EVENT_DISABLE);
+        }
+
+    } else if ((Queue->Flags & VIRTIO_QUEUE_FLAG_EVENT_INDEX) != 0) {
+        Event = *(Queue->AvailableEvent);
+        NeedsKick = VIRTIO_NEED_EVENT(Event, New, Old);
+
+    } else {
+        NeedsKick = ((*(Queue->UsedFlags) & VIRTIO_USED_NO_NOTIFY) == 0);
+    }
+
+    Queue->AddedCount = 0;
+    if (NeedsKick != FALSE) {
+        HlWriteRegister16(Queue->NotifyAddress, Queue->Index);
+    }
+
+    return;
+}
+
+VIRTIO_API
+PVOID
+VirtioQueueGetUsed (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects the next buffer chain the device has finished with.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Length - Supplies a pointer where the number of bytes the device wrote
+        into the chain is returned.
+
+Return Value:
+
+    Returns the token of the used chain.
+
+    NULL if the device has not used any more chains.
+
+--*/
+
+{
+
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+        return VirtiopGetUsedPacked(Queue, Length);
+    }
+
+    return VirtiopGetUsedSplit(Queue, Length);
+}
+
+VIRTIO_API
+VOID
+VirtioQueueDisableNotifications (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine asks the device not to interrupt when it uses buffers in the
+    queue. This is only a hint, the device may still interrupt.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON) == 0) {
+        return;
+    }
+
+    Queue->Flags &= ~VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON;
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+        Queue->DriverEvent->Flags = VIRTIO_PACKED_EVENT_DISABLE;
+
+    //
+    // With event indices the flag is ignored, so set the event to the point
+    // furthest from the next used entry instead.
+    //
+
+    } else if ((Queue->Flags & VIRTIO_QUEUE_FLAG_EVENT_INDEX) != 0) {
+        *(Queue->UsedEvent) = Queue->LastUsed - 1 - (USHORT)Queue->Size;
+
+    } else {
+        *(Queue->AvailableFlags) |= VIRTIO_AVAILABLE_NO_INTERRUPT;
+    }
+
+    return;
+}
+
+VIRTIO_API
+BOOL
+VirtioQueueEnableNotifications (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine asks the device to interrupt again when it uses the next
+    buffer in the queue. Callers should collect used buffers again if this
+    routine returns TRUE, since the device may have used them before seeing
+    the request.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    TRUE if there are used buffers waiting to be collected.
+
+    FALSE if the queue is idle.
+
+--*/
+
+{
+
+    USHORT Descriptor;
+
+    Queue->Flags |= VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON;
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+        if ((Queue->Flags & VIRTIO_QUEUE_FLAG_EVENT_INDEX) != 0) {
+            Descriptor = Queue->LastUsed |
+                         (Queue->UsedWrapCounter <<
+                          VIRTIO_PACKED_EVENT_WRAP_SHIFT);
+
+            Queue->DriverEvent->Descriptor = Descriptor;
+            RtlMemoryBarrier();
+            Queue->DriverEvent->Flags = VIRTIO_PACKED_EVENT_DESCRIPTOR;
+
+        } else {
+            Queue->DriverEvent->Flags = VIRTIO_PACKED_EVENT_ENABLE;
+        }
+
+    } else if ((Queue->Flags & VIRTIO_QUEUE_FLAG_EVENT_INDEX) != 0) {
+        *(Queue->UsedEvent) = Queue->LastUsed;
+
+    } else {
+        *(Queue->AvailableFlags) &= ~VIRTIO_AVAILABLE_NO_INTERRUPT;
+    }
+
+    //
+    // Make the request visible before checking for entries that slipped in
+    // while notifications were off.
+    //
+
+    RtlMemoryBarrier();
+    return VirtiopIsUsedPending(Queue);
+}
+
+VIRTIO_API
+ULONG
+VirtioQueueGetFreeCount (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of free descriptors in a virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    Returns the number of buffers that can currently be added.
+
+--*/
+
+{
+
+    return Queue->FreeCount;
+}
+
+KSTATUS
+VirtiopInitializeQueue (
+    PVIRTIO_QUEUE Queue,
+    BOOL Packed,
+    BOOL EventIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates the rings for a virtqueue and initializes its
+    software state. The queue's device, index, and size must already be set.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue to initialize.
+
+    Packed - Supplies a boolean indicating whether to use the packed ring
+        layout (TRUE) or the split ring layout (FALSE).
+
+    EventIndex - Supplies a boolean indicating whether the event index feature
+        was negotiated.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN AvailableSize;
+    UINTN DescriptorSize;
+    ULONG Index;
+    PUCHAR Rings;
+    ULONG Size;
+    KSTATUS Status;
+    UINTN TotalSize;
+    UINTN UsedOffset;
+
+    Size = Queue->Size;
+
+    ASSERT((Size != 0) && (Size <= VIRTIO_MAX_QUEUE_SIZE));
+
+    Queue->Entries = MmAllocateNonPagedPool(sizeof(VIRTIO_QUEUE_ENTRY) * Size,
+                                            VIRTIO_ALLOCATION_TAG);
+
+    if (Queue->Entries == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueueEnd;
+    }
+
+    RtlZeroMemory(Queue->Entries, sizeof(VIRTIO_QUEUE_ENTRY) * Size);
+
+    //
+    // The packed ring is just the descriptor ring followed by the driver and
+    // device event suppression structures. The split ring is the descriptor
+    // table, then the available ring, then the used ring.
+    //
+
+    if (Packed != FALSE) {
+        DescriptorSize = sizeof(VIRTIO_PACKED_DESCRIPTOR) * Size;
+        TotalSize = DescriptorSize + (sizeof(VIRTIO_PACKED_EVENT) * 2);
+        UsedOffset = 0;
+
+    } else {
+
+        ASSERT(POWER_OF_2(Size));
+
+        DescriptorSize = sizeof(VIRTIO_SPLIT_DESCRIPTOR) * Size;
+        AvailableSize = (sizeof(USHORT) * 3) + (sizeof(USHORT) * Size);
+        UsedOffset = ALIGN_RANGE_UP(DescriptorSize + AvailableSize,
+                                    VIRTIO_USED_RING_ALIGNMENT);
+
+        TotalSize = UsedOffset + (sizeof(USHORT) * 3) +
+                    (sizeof(VIRTIO_USED_ELEMENT) * Size);
+    }
+
+    Queue->IoBuffer = MmAllocateNonPagedIoBuffer(
+                                         0,
+                                         MAX_ULONGLONG,
+                                         VIRTIO_QUEUE_ALIGNMENT,
+                                         TotalSize,
+                                         IO_BUFFER_FLAG_PHYSICALLY_CONTIGUOUS);
+
+    if (Queue->IoBuffer == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueueEnd;
+    }
+
+    ASSERT(Queue->IoBuffer->FragmentCount == 1);
+
+    Rings = Queue->IoBuffer->Fragment[0].VirtualAddress;
+    RtlZeroMemory(Rings, TotalSize);
+    Queue->FreeCount = Size;
+    Queue->FreeHead = 0;
+    Queue->AddedCount = 0;
+    Queue->LastUsed = 0;
+    Queue->NextAvailable = 0;
+    Queue->Flags = VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON;
+    if (EventIndex != FALSE) {
+        Queue->Flags |= VIRTIO_QUEUE_FLAG_EVENT_INDEX;
+    }
+
+    if (Packed != FALSE) {
+        Queue->Flags |= VIRTIO_QUEUE_FLAG_PACKED;
+        Queue->PackedDescriptors = (PVOID)Rings;
+        Queue->DriverEvent = (PVOID)(Rings + DescriptorSize);
+        Queue->DeviceEvent = (PVOID)(Rings + DescriptorSize +
+                                     sizeof(VIRTIO_PACKED_EVENT));
+
+        Queue->AvailableWrapCounter = TRUE;
+        Queue->UsedWrapCounter = TRUE;
+        for (Index = 0; Index < Size; Index += 1) {
+            Queue->Entries[Index].Next = Index + 1;
+        }
+
+        Queue->Entries[Size - 1].Next = VIRTIO_QUEUE_END;
+
+    } else {
+        Queue->Descriptors = (PVOID)Rings;
+        Rings += DescriptorSize;
+        Queue->AvailableFlags = (PVOID)Rings;
+        Queue->AvailableIndex = Queue->AvailableFlags + 1;
+        Queue->AvailableRing = Queue->AvailableIndex + 1;
+        Queue->UsedEvent = Queue->AvailableRing + Size;
+        Rings = (PUCHAR)Queue->Descriptors + UsedOffset;
+        Queue->UsedFlags = (PVOID)Rings;
+        Queue->UsedIndex = Queue->UsedFlags + 1;
+        Queue->UsedRing = (PVOID)(Queue->UsedIndex + 1);
+        Queue->AvailableEvent = (PVOID)(Queue->UsedRing + Size);
+        for (Index = 0; Index < Size; Index += 1) {
+            Queue->Descriptors[Index].Next = Index + 1;
+        }
+
+        Queue->Descriptors[Size - 1].Next = VIRTIO_QUEUE_END;
+    }
+
+    Status = STATUS_SUCCESS;
+
+InitializeQueueEnd:
+    return Status;
+}
+
+VOID
+VirtiopDestroyQueue (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees a virtqueue. The device must already have been reset.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Queue->IoBuffer != NULL) {
+        MmFreeIoBuffer(Queue->IoBuffer);
+        Queue->IoBuffer = NULL;
+    }
+
+    if (Queue->Entries != NULL) {
+        MmFreeNonPagedPool(Queue->Entries);
+        Queue->Entries = NULL;
+    }
+
+    MmFreeNonPagedPool(Queue);
+    return;
+}
+
+PHYSICAL_ADDRESS
+VirtiopGetQueueAddress (
+    PVIRTIO_QUEUE Queue,
+    VIRTIO_COMMON_REGISTER Register
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the physical address of one of the areas of a
+    virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Register - Supplies the low register the address is destined for, which
+        identifies the descriptor, driver, or device area.
+
+Return Value:
+
+    Returns the physical address of the area.
+
+--*/
+
+{
+
+    PHYSICAL_ADDRESS Base;
+    PVOID Area;
+
+    Base = Queue->IoBuffer->Fragment[0].PhysicalAddress;
+    switch (Register) {
+    case VirtioCommonQueueDriverLow:
+        if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+            Area = (PVOID)Queue->DriverEvent;
+
+        } else {
+            Area = (PVOID)Queue->AvailableFlags;
+        }
+
+        break;
+
+    case VirtioCommonQueueDeviceLow:
+        if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) != 0) {
+            Area = (PVOID)Queue->DeviceEvent;
+
+        } else {
+            Area = (PVOID)Queue->UsedFlags;
+        }
+
+        break;
+
+    case VirtioCommonQueueDescriptorLow:
+    default:
+
+        ASSERT(Register == VirtioCommonQueueDescriptorLow);
+
+        return Base;
+    }
+
+    return Base + ((UINTN)Area -
+                   (UINTN)Queue->IoBuffer->Fragment[0].VirtualAddress);
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+VirtiopAddSplit (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a chain of buffers to a split virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Buffers - Supplies an array of buffers, device readable ones first.
+
+    OutCount - Supplies the number of buffers the device reads.
+
+    InCount - Supplies the number of buffers the device writes.
+
+    Token - Supplies the token to return when the chain is used.
+
+Return Value:
+
+    STATUS_SUCCESS always. The caller has already checked for space.
+
+--*/
+
+{
+
+    ULONG Count;
+    PVIRTIO_SPLIT_DESCRIPTOR Descriptor;
+    USHORT Flags;
+    USHORT Head;
+    ULONG Index;
+    USHORT Last;
+    USHORT Next;
+
+    Count = OutCount + InCount;
+    Head = Queue->FreeHead;
+    Next = Head;
+    Last = Head;
+    for (Index = 0; Index < Count; Index += 1) {
+
+        ASSERT(Next != VIRTIO_QUEUE_END);
+
+        Descriptor = &(Queue->Descriptors[Next]);
+        Descriptor->Address = Buffers[Index].Address;
+        Descriptor->Length = Buffers[Index].Length;
+        Flags = VIRTIO_DESCRIPTOR_NEXT;
+        if (Index >= OutCount) {
+            Flags |= VIRTIO_DESCRIPTOR_WRITE;
+        }
+
+        Descriptor->Flags = Flags;
+        Last = Next;
+        Next = Descriptor->Next;
+    }
+
+    Queue->Descriptors[Last].Flags &= ~VIRTIO_DESCRIPTOR_NEXT;
+    Queue->FreeHead = Next;
+    Queue->FreeCount -= Count;
+    Queue->Entries[Head].Token = Token;
+    Queue->Entries[Head].Count = Count;
+
+    //
+    // Publish the chain in the available ring, then make it visible to the
+    // device by bumping the index.
+    //
+
+    Queue->AvailableRing[Queue->NextAvailable & (Queue->Size - 1)] = Head;
+    Queue->NextAvailable += 1;
+    RtlMemoryBarrier();
+    *(Queue->AvailableIndex) = Queue->NextAvailable;
+    Queue->AddedCount += 1;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+VirtiopAddPacked (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a chain of buffers to a packed virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Buffers - Supplies an array of buffers, device readable ones first.
+
+    OutCount - Supplies the number of buffers the device reads.
+
+    InCount - Supplies the number of buffers the device writes.
+
+    Token - Supplies the token to return when the chain is used.
+
+Return Value:
+
+    STATUS_SUCCESS always. The caller has already checked for space.
+
+--*/
+
+{
+
+    ULONG Count;
+    volatile VIRTIO_PACKED_DESCRIPTOR *Descriptor;
+    USHORT Flags;
+    USHORT Head;
+    USHORT HeadFlags;
+    USHORT Id;
+    ULONG Index;
+    USHORT Position;
+    BOOL WrapCounter;
+
+    Count = OutCount + InCount;
+    Id = Queue->FreeHead;
+
+    ASSERT(Id != VIRTIO_QUEUE_END);
+
+    Head = Queue->NextAvailable;
+    Position = Head;
+    WrapCounter = Queue->AvailableWrapCounter;
+    HeadFlags = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        Descriptor = &(Queue->PackedDescriptors[Position]);
+        Descriptor->Address = Buffers[Index].Address;
+        Descriptor->Length = Buffers[Index].Length;
+        Descriptor->Id = Id;
+        Flags = VIRTIO_PACKED_AVAILABLE_FLAGS(WrapCounter);
+        if (Index + 1 < Count) {
+            Flags |= VIRTIO_DESCRIPTOR_NEXT;
+        }
+
+        if (Index >= OutCount) {
+            Flags |= VIRTIO_DESCRIPTOR_WRITE;
+        }
+
+        //
+        // Hold back the head's flags so the device cannot see a partial
+        // chain.
+        //
+
+        if (Index == 0) {
+            HeadFlags = Flags;
+
+        } else {
+            Descriptor->Flags = Flags;
+        }
+
+        Position += 1;
+        if (Position >= Queue->Size) {
+            Position = 0;
+            WrapCounter = !WrapCounter;
+        }
+    }
+
+    Queue->FreeHead = Queue->Entries[Id].Next;
+    Queue->FreeCount -= Count;
+    Queue->Entries[Id].Token = Token;
+    Queue->Entries[Id].Count = Count;
+    Queue->NextAvailable = Position;
+    Queue->AvailableWrapCounter = WrapCounter;
+    RtlMemoryBarrier();
+    Queue->PackedDescriptors[Head].Flags = HeadFlags;
+    Queue->AddedCount += Count;
+    return STATUS_SUCCESS;
+}
+
+PVOID
+VirtiopGetUsedSplit (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects the next used chain from a split virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Length - Supplies a pointer where the number of bytes written by the
+        device is returned.
+
+Return Value:
+
+    Returns the token of the used chain, or NULL if there is none.
+
+--*/
+
+{
+
+    ULONG Count;
+    USHORT Head;
+    ULONG Index;
+    USHORT Last;
+    PVOID Token;
+    volatile VIRTIO_USED_ELEMENT *Used;
+
+    if (Queue->LastUsed == *(Queue->UsedIndex)) {
+        return NULL;
+    }
+
+    //
+    // Don't read the element before the index that covers it.
+    //
+
+    RtlMemoryBarrier();
+    Used = &(Queue->UsedRing[Queue->LastUsed & (Queue->Size - 1)]);
+    Head = (USHORT)Used->Id;
+    *Length = Used->Length;
+
+    ASSERT(Head < Queue->Size);
+
+    Token = Queue->Entries[Head].Token;
+    Count = Queue->Entries[Head].Count;
+    Queue->Entries[Head].Token = NULL;
+
+    //
+    // Return the chain to the free list.
+    //
+
+    Last = Head;
+    for (Index = 1; Index < Count; Index += 1) {
+        Last = Queue->Descriptors[Last].Next;
+    }
+
+    Queue->Descriptors[Last].Next = Queue->FreeHead;
+    Queue->FreeHead = Head;
+    Queue->FreeCount += Count;
+    Queue->LastUsed += 1;
+    if ((Queue->Flags &
+         (VIRTIO_QUEUE_FLAG_EVENT_INDEX |
+          VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON)) ==
+        (VIRTIO_QUEUE_FLAG_EVENT_INDEX | VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON)) {
+
+        *(Queue->UsedEvent) = Queue->LastUsed;
+    }
+
+    return Token;
+}
+
+PVOID
+VirtiopGetUsedPacked (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects the next used chain from a packed virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Length - Supplies a pointer where the number of bytes written by the
+        device is returned.
+
+Return Value:
+
+    Returns the token of the used chain, or NULL if there is none.
+
+--*/
+
+{
+
+    ULONG Count;
+    volatile VIRTIO_PACKED_DESCRIPTOR *Descriptor;
+    USHORT Id;
+    PVOID Token;
+
+    if (VirtiopIsUsedPending(Queue) == FALSE) {
+        return NULL;
+    }
+
+    RtlMemoryBarrier();
+    Descriptor = &(Queue->PackedDescriptors[Queue->LastUsed]);
+    Id = Descriptor->Id;
+    *Length = Descriptor->Length;
+
+    ASSERT(Id < Queue->Size);
+
+    Token = Queue->Entries[Id].Token;
+    Count = Queue->Entries[Id].Count;
+    Queue->Entries[Id].Token = NULL;
+    Queue->Entries[Id].Next = Queue->FreeHead;
+    Queue->FreeHead = Id;
+    Queue->FreeCount += Count;
+
+    //
+    // The device writes one used descriptor per chain, but skips the ring
+    // forward by the length of the chain.
+    //
+
+    Queue->LastUsed += Count;
+    if (Queue->LastUsed >= Queue->Size) {
+        Queue->LastUsed -= Queue->Size;
+        Queue->UsedWrapCounter = !Queue->UsedWrapCounter;
+    }
+
+    if ((Queue->Flags &
+         (VIRTIO_QUEUE_FLAG_EVENT_INDEX |
+          VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON)) ==
+        (VIRTIO_QUEUE_FLAG_EVENT_INDEX | VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON)) {
+
+        Queue->DriverEvent->Descriptor =
+                     Queue->LastUsed |
+                     (Queue->UsedWrapCounter << VIRTIO_PACKED_EVENT_WRAP_SHIFT);
+    }
+
+    return Token;
+}
+
+BOOL
+VirtiopIsUsedPending (
+    PVIRTIO_QUEUE Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the device has used chains waiting to be
+    collected.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    TRUE if there are used chains to collect.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    BOOL Available;
+    USHORT Flags;
+    BOOL Used;
+
+    if ((Queue->Flags & VIRTIO_QUEUE_FLAG_PACKED) == 0) {
+        return (Queue->LastUsed != *(Queue->UsedIndex));
+    }
+
+    //
+    // A packed descriptor is used when its available and used bits both
+    // match the used wrap counter.
+    //
+
+    Flags = Queue->PackedDescriptors[Queue->LastUsed].Flags;
+    Available = ((Flags & VIRTIO_PACKED_DESCRIPTOR_AVAILABLE) != 0);
+    Used = ((Flags & VIRTIO_PACKED_DESCRIPTOR_USED) != 0);
+    return ((Available == Used) && (Used == Queue->UsedWrapCounter));
+}
+
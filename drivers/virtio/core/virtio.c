@@ -0,0 +1,1958 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtio.c
+
+Abstract:
+
+    This module implements the virtio PCI transport library. It finds and
+    maps the virtio structures advertised in PCI configuration space, runs the
+    device status and feature negotiation protocol, sets up virtqueues, and
+    routes MSI-X or legacy interrupts to the queues of the device drivers
+    built on top of it.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "virtiop.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtiopMapCapabilities (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    );
+
+PVOID
+VirtiopMapStructure (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp,
+    ULONG Capability,
+    PULONG Length
+    );
+
+KSTATUS
+VirtiopMapBar (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp,
+    ULONG BarIndex
+    );
+
+KSTATUS
+VirtiopResetDevice (
+    PVIRTIO_DEVICE Device
+    );
+
+VOID
+VirtiopSetStatus (
+    PVIRTIO_DEVICE Device,
+    UCHAR Status
+    );
+
+KSTATUS
+VirtiopConnectInterrupts (
+    PVIRTIO_DEVICE Device
+    );
+
+VOID
+VirtiopDisconnectInterrupts (
+    PVIRTIO_DEVICE Device
+    );
+
+INTERRUPT_STATUS
+VirtiopInterruptService (
+    PVOID Context
+    );
+
+INTERRUPT_STATUS
+VirtiopInterruptServiceWorker (
+    PVOID Context
+    );
+
+VOID
+VirtiopServiceQueues (
+    PVIRTIO_DEVICE Device,
+    USHORT Vector
+    );
+
+VOID
+VirtiopProcessPciConfigInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    );
+
+VOID
+VirtiopProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PDRIVER VirtioDriver = NULL;
+UUID VirtioPciConfigurationInterfaceUuid = UUID_PCI_CONFIG_ACCESS;
+UUID VirtioPciMsiInterfaceUuid = UUID_PCI_MESSAGE_SIGNALED_INTERRUPTS;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+__USED
+KSTATUS
+DriverEntry (
+    PDRIVER Driver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for the virtio library. The library does
+    not drive any devices on its own, it is imported by the virtio device
+    drivers.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver object.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code on error.
+
+--*/
+
+{
+
+    VirtioDriver = Driver;
+    return STATUS_SUCCESS;
+}
+
+VIRTIO_API
+PVIRTIO_DEVICE
+VirtioCreateDevice (
+    PVIRTIO_INITIALIZATION_BLOCK Parameters
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new virtio device object.
+
+Arguments:
+
+    Parameters - Supplies a pointer to the parameters to use when creating the
+        device. This can be stack allocated.
+
+Return Value:
+
+    Returns a pointer to the device on success.
+
+    NULL on allocation failure or if the parameters are invalid.
+
+--*/
+
+{
+
+    PVIRTIO_DEVICE Device;
+
+    if ((Parameters->Version < VIRTIO_INITIALIZATION_BLOCK_VERSION) ||
+        (Parameters->OsDevice == NULL)) {
+
+        return NULL;
+    }
+
+    Device = MmAllocateNonPagedPool(sizeof(VIRTIO_DEVICE),
+                                    VIRTIO_ALLOCATION_TAG);
+
+    if (Device == NULL) {
+        return NULL;
+    }
+
+    RtlZeroMemory(Device, sizeof(VIRTIO_DEVICE));
+    Device->OsDevice = Parameters->OsDevice;
+    Device->ConsumerContext = Parameters->ConsumerContext;
+    Device->ConfigurationChangeRoutine =
+                                      Parameters->ConfigurationChangeRoutine;
+
+    Device->Flags = Parameters->Flags & VIRTIO_DEVICE_FLAG_LOW_LEVEL_INTERRUPTS;
+    Device->MaxInterruptGroups = Parameters->MaxInterruptGroups;
+    if (Device->MaxInterruptGroups == 0) {
+        Device->MaxInterruptGroups = 1;
+    }
+
+    Device->InterruptLine = INVALID_INTERRUPT_LINE;
+    Device->InterruptVector = INVALID_INTERRUPT_VECTOR;
+    return Device;
+}
+
+VIRTIO_API
+VOID
+VirtioDestroyDevice (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resets and destroys a virtio device object, including all of
+    its queues and interrupts.
+
+Arguments:
+
+    Device - Supplies a pointer to the device to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    //
+    // Reset the device first so that it stops touching the rings.
+    //
+
+    if (Device->CommonConfiguration != NULL) {
+        VirtiopResetDevice(Device);
+    }
+
+    VirtiopDisconnectInterrupts(Device);
+    if (Device->Queues != NULL) {
+        for (Index = 0; Index < Device->QueueCount; Index += 1) {
+            if (Device->Queues[Index] != NULL) {
+                VirtiopDestroyQueue(Device->Queues[Index]);
+                Device->Queues[Index] = NULL;
+            }
+        }
+
+        MmFreeNonPagedPool(Device->Queues);
+        Device->Queues = NULL;
+    }
+
+    for (Index = 0; Index < VIRTIO_PCI_BAR_COUNT; Index += 1) {
+        if (Device->BarMapping[Index] != NULL) {
+            MmUnmapAddress(Device->BarMapping[Index],
+                           Device->BarMappingSize[Index]);
+
+            Device->BarMapping[Index] = NULL;
+        }
+    }
+
+    if ((Device->PciFlags & VIRTIO_PCI_FLAG_CONFIG_INTERFACE_REGISTERED) != 0) {
+        IoUnregisterForInterfaceNotifications(
+                           &VirtioPciConfigurationInterfaceUuid,
+                           VirtiopProcessPciConfigInterfaceChangeNotification,
+                           Device->OsDevice,
+                           Device);
+    }
+
+    if ((Device->PciFlags & VIRTIO_PCI_FLAG_MSI_INTERFACE_REGISTERED) != 0) {
+        IoUnregisterForInterfaceNotifications(
+                              &VirtioPciMsiInterfaceUuid,
+                              VirtiopProcessPciMsiInterfaceChangeNotification,
+                              Device->OsDevice,
+                              Device);
+    }
+
+    MmFreeNonPagedPool(Device);
+    return;
+}
+
+VIRTIO_API
+KSTATUS
+VirtioProcessResourceRequirements (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine filters through the resource requirements presented by the
+    bus for a virtio device. It requests one MSI-X vector for configuration
+    changes plus one per queue interrupt group if possible, and otherwise
+    adds a vector for the legacy interrupt line.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the query resources IRP, on its way up.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG GroupCount;
+    PINTERFACE_PCI_MSI MsiInterface;
+    PCI_MSI_INFORMATION MsiInformation;
+    PRESOURCE_CONFIGURATION_LIST Requirements;
+    KSTATUS Status;
+    ULONGLONG VectorCount;
+    RESOURCE_REQUIREMENT VectorRequirement;
+
+    ASSERT((Irp->MajorCode == IrpMajorStateChange) &&
+           (Irp->MinorCode == IrpMinorQueryResources));
+
+    //
+    // The virtio structures are found by walking PCI configuration space, so
+    // the configuration access interface is required.
+    //
+
+    if ((Device->PciFlags &
+         VIRTIO_PCI_FLAG_CONFIG_INTERFACE_REGISTERED) == 0) {
+
+        Status = IoRegisterForInterfaceNotifications(
+                           &VirtioPciConfigurationInterfaceUuid,
+                           VirtiopProcessPciConfigInterfaceChangeNotification,
+                           Irp->Device,
+                           Device,
+                           TRUE);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Device->PciFlags |= VIRTIO_PCI_FLAG_CONFIG_INTERFACE_REGISTERED;
+    }
+
+    if ((Device->PciFlags & VIRTIO_PCI_FLAG_CONFIG_INTERFACE_AVAILABLE) == 0) {
+        Status = STATUS_NOT_CONFIGURED;
+        goto ProcessResourceRequirementsEnd;
+    }
+
+    if ((Device->PciFlags & VIRTIO_PCI_FLAG_MSI_INTERFACE_REGISTERED) == 0) {
+        Status = IoRegisterForInterfaceNotifications(
+                              &VirtioPciMsiInterfaceUuid,
+                              VirtiopProcessPciMsiInterfaceChangeNotification,
+                              Irp->Device,
+                              Device,
+                              TRUE);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Device->PciFlags |= VIRTIO_PCI_FLAG_MSI_INTERFACE_REGISTERED;
+    }
+
+    //
+    // Virtio only delivers message signaled interrupts through MSI-X. Ask for
+    // a vector for configuration changes plus one for each interrupt group,
+    // but there is no sense having more groups than processors.
+    //
+
+    Requirements = Irp->U.QueryResources.ResourceRequirements;
+    VectorCount = 0;
+    if ((Device->PciFlags & VIRTIO_PCI_FLAG_MSI_INTERFACE_AVAILABLE) != 0) {
+        MsiInterface = &(Device->PciMsiInterface);
+        RtlZeroMemory(&MsiInformation, sizeof(PCI_MSI_INFORMATION));
+        MsiInformation.Version = PCI_MSI_INTERFACE_INFORMATION_VERSION;
+        MsiInformation.MsiType = PciMsiTypeExtended;
+        Status = MsiInterface->GetSetInformation(MsiInterface->DeviceToken,
+                                                 &MsiInformation,
+                                                 FALSE);
+
+        if (KSUCCESS(Status)) {
+            GroupCount = Device->MaxInterruptGroups;
+            if (GroupCount > KeGetActiveProcessorCount()) {
+                GroupCount = KeGetActiveProcessorCount();
+            }
+
+            VectorCount = GroupCount + 1;
+            if (VectorCount > MsiInformation.MaxVectorCount) {
+                VectorCount = MsiInformation.MaxVectorCount;
+            }
+        }
+    }
+
+    if (VectorCount != 0) {
+        Status = IoCreateAndAddMessageSignaledInterruptVectors(
+                                                            Requirements,
+                                                            (ULONG)VectorCount);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+
+        Device->PciFlags |= VIRTIO_PCI_FLAG_MSI_RESOURCES_REQUESTED;
+
+    //
+    // Loop through all configuration lists, creating a vector for each line.
+    //
+
+    } else {
+        RtlZeroMemory(&VectorRequirement, sizeof(RESOURCE_REQUIREMENT));
+        VectorRequirement.Type = ResourceTypeInterruptVector;
+        VectorRequirement.Minimum = 0;
+        VectorRequirement.Maximum = -1;
+        VectorRequirement.Length = 1;
+        Status = IoCreateAndAddInterruptVectorsForLines(Requirements,
+                                                        &VectorRequirement);
+
+        if (!KSUCCESS(Status)) {
+            goto ProcessResourceRequirementsEnd;
+        }
+    }
+
+    Status = STATUS_SUCCESS;
+
+ProcessResourceRequirementsEnd:
+    return Status;
+}
+
+VIRTIO_API
+KSTATUS
+VirtioStartDevice (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine maps the virtio structures of a device, resets it, connects
+    its interrupts, and reads the features it offers. On success the device
+    is in the acknowledged state, ready for feature negotiation.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the start device IRP, on its way up.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PRESOURCE_ALLOCATION Allocation;
+    PRESOURCE_ALLOCATION_LIST AllocationList;
+    ULONG FeaturesHigh;
+    ULONG FeaturesLow;
+    PRESOURCE_ALLOCATION LineAllocation;
+    UINTN Size;
+    KSTATUS Status;
+    USHORT Vector;
+
+    ASSERT((Irp->MajorCode == IrpMajorStateChange) &&
+           (Irp->MinorCode == IrpMinorStartDevice));
+
+    //
+    // Find the interrupt resources.
+    //
+
+    AllocationList = Irp->U.StartDevice.ProcessorLocalResources;
+    Allocation = IoGetNextResourceAllocation(AllocationList, NULL);
+    while (Allocation != NULL) {
+        if (Allocation->Type == ResourceTypeInterruptVector) {
+
+            ASSERT((Device->InterruptVector == INVALID_INTERRUPT_VECTOR) ||
+                   (Device->InterruptVector == Allocation->Allocation));
+
+            //
+            // A vector without an owning line is the block of message
+            // signaled vectors.
+            //
+
+            LineAllocation = Allocation->OwningAllocation;
+            if (LineAllocation == NULL) {
+
+                ASSERT((Device->PciFlags &
+                        VIRTIO_PCI_FLAG_MSI_RESOURCES_REQUESTED) != 0);
+
+                Device->InterruptLine = INVALID_INTERRUPT_LINE;
+                Device->InterruptCount = (ULONG)Allocation->Length;
+                Device->PciFlags |= VIRTIO_PCI_FLAG_MSI_RESOURCES_ALLOCATED;
+
+            } else {
+                Device->InterruptLine = LineAllocation->Allocation;
+                Device->InterruptCount = 1;
+            }
+
+            Device->InterruptVector = Allocation->Allocation;
+        }
+
+        Allocation = IoGetNextResourceAllocation(AllocationList, Allocation);
+    }
+
+    if (Device->InterruptVector == INVALID_INTERRUPT_VECTOR) {
+        RtlDebugPrint("Virtio: Missing interrupt resources.\n");
+        Status = STATUS_INVALID_CONFIGURATION;
+        goto StartDeviceEnd;
+    }
+
+    if ((Device->Flags & VIRTIO_DEVICE_FLAG_MAPPED) == 0) {
+        Status = VirtiopMapCapabilities(Device, Irp);
+        if (!KSUCCESS(Status)) {
+            goto StartDeviceEnd;
+        }
+
+        Device->Flags |= VIRTIO_DEVICE_FLAG_MAPPED;
+    }
+
+    //
+    // Put the device into a known state and announce the driver.
+    //
+
+    Status = VirtiopResetDevice(Device);
+    if (!KSUCCESS(Status)) {
+        goto StartDeviceEnd;
+    }
+
+    VirtiopSetStatus(Device, VIRTIO_STATUS_ACKNOWLEDGE);
+    VirtiopSetStatus(Device, VIRTIO_STATUS_DRIVER);
+    if (Device->Queues == NULL) {
+        Device->QueueCount = VIRTIO_READ_COMMON16(Device,
+                                                  VirtioCommonQueueCount);
+
+        if (Device->QueueCount == 0) {
+            Status = STATUS_NOT_SUPPORTED;
+            goto StartDeviceEnd;
+        }
+
+        Size = sizeof(PVIRTIO_QUEUE) * Device->QueueCount;
+        Device->Queues = MmAllocateNonPagedPool(Size, VIRTIO_ALLOCATION_TAG);
+        if (Device->Queues == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto StartDeviceEnd;
+        }
+
+        RtlZeroMemory(Device->Queues, Size);
+    }
+
+    if (Device->Interrupts == NULL) {
+        Status = VirtiopConnectInterrupts(Device);
+        if (!KSUCCESS(Status)) {
+            goto StartDeviceEnd;
+        }
+    }
+
+    //
+    // Configuration changes always go to the first MSI-X vector. The device
+    // reads back no vector if it could not map it.
+    //
+
+    if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
+        VIRTIO_WRITE_COMMON16(Device, VirtioCommonConfigurationVector, 0);
+        Vector = VIRTIO_READ_COMMON16(Device, VirtioCommonConfigurationVector);
+        if (Vector == VIRTIO_MSI_NO_VECTOR) {
+            RtlDebugPrint("Virtio: Device refused configuration vector.\n");
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto StartDeviceEnd;
+        }
+    }
+
+    //
+    // Read the 64 bits of offered features.
+    //
+
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonDeviceFeatureSelect, 0);
+    FeaturesLow = VIRTIO_READ_COMMON32(Device, VirtioCommonDeviceFeature);
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonDeviceFeatureSelect, 1);
+    FeaturesHigh = VIRTIO_READ_COMMON32(Device, VirtioCommonDeviceFeature);
+    Device->DeviceFeatures = ((ULONGLONG)FeaturesHigh << 32) | FeaturesLow;
+    Device->Features = 0;
+    Status = STATUS_SUCCESS;
+
+StartDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Device->CommonConfiguration != NULL) {
+            VirtiopSetStatus(Device, VIRTIO_STATUS_FAILED);
+        }
+    }
+
+    return Status;
+}
+
+VIRTIO_API
+KSTATUS
+VirtioNegotiateFeatures (
+    PVIRTIO_DEVICE Device,
+    ULONGLONG DriverFeatures
+    )
+
+/*++
+
+Routine Description:
+
+    This routine negotiates the feature set with the device. The transport
+    features (version 1, event index and packed rings) are added to the
+    driver features automatically.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    DriverFeatures - Supplies the device specific features the driver
+        supports.
+
+Return Value:
+
+    STATUS_SUCCESS if the device accepted the negotiated features, which are
+    stored in the device's features member.
+
+    STATUS_NOT_SUPPORTED if the device rejected them.
+
+--*/
+
+{
+
+    ULONGLONG Features;
+    UCHAR Status;
+
+    Features = Device->DeviceFeatures &
+               (DriverFeatures | VIRTIO_TRANSPORT_FEATURES);
+
+    //
+    // Only modern devices are supported, which always offer version 1.
+    //
+
+    if ((Features & VIRTIO_FEATURE_VERSION_1) == 0) {
+        RtlDebugPrint("Virtio: Device does not offer version 1.\n");
+        VirtiopSetStatus(Device, VIRTIO_STATUS_FAILED);
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonDriverFeatureSelect, 0);
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonDriverFeature, (ULONG)Features);
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonDriverFeatureSelect, 1);
+    VIRTIO_WRITE_COMMON32(Device,
+                          VirtioCommonDriverFeature,
+                          (ULONG)(Features >> 32));
+
+    VirtiopSetStatus(Device, VIRTIO_STATUS_FEATURES_OK);
+    Status = VIRTIO_READ_COMMON8(Device, VirtioCommonDeviceStatus);
+    if ((Status & VIRTIO_STATUS_FEATURES_OK) == 0) {
+        RtlDebugPrint("Virtio: Device rejected features 0x%I64x.\n", Features);
+        VirtiopSetStatus(Device, VIRTIO_STATUS_FAILED);
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    Device->Features = Features;
+    return STATUS_SUCCESS;
+}
+
+VIRTIO_API
+KSTATUS
+VirtioReadDeviceConfiguration (
+    PVIRTIO_DEVICE Device,
+    ULONG Offset,
+    ULONG Size,
+    PVOID Buffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads a field from the device specific configuration space,
+    retrying if the device changes the configuration in the middle.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Offset - Supplies the byte offset of the field.
+
+    Size - Supplies the size of the field. Sizes of 1, 2, 4, and 8 are read
+        with accesses of the natural width. Other sizes are read a byte at a
+        time.
+
+    Buffer - Supplies a pointer where the field is returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the field lies outside the configuration
+    space.
+
+--*/
+
+{
+
+    PUCHAR Base;
+    UCHAR Generation;
+    ULONG Index;
+    ULONG High;
+    ULONG Low;
+
+    if ((Device->DeviceConfiguration == NULL) ||
+        (Offset + Size < Offset) ||
+        (Offset + Size > Device->DeviceConfigurationSize)) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Base = (PUCHAR)Device->DeviceConfiguration + Offset;
+    do {
+        Generation = VIRTIO_READ_COMMON8(Device, VirtioCommonConfigGeneration);
+        switch (Size) {
+        case sizeof(UCHAR):
+            *((PUCHAR)Buffer) = HlReadRegister8(Base);
+            break;
+
+        case sizeof(USHORT):
+            *((PUSHORT)Buffer) = HlReadRegister16(Base);
+            break;
+
+        case sizeof(ULONG):
+            *((PULONG)Buffer) = HlReadRegister32(Base);
+            break;
+
+        //
+        // 64-bit fields are read as two 32-bit halves. The generation check
+        // catches a change between the two reads.
+        //
+
+        case sizeof(ULONGLONG):
+            Low = HlReadRegister32(Base);
+            High = HlReadRegister32(Base + sizeof(ULONG));
+            *((PULONGLONG)Buffer) = ((ULONGLONG)High << 32) | Low;
+            break;
+
+        default:
+            for (Index = 0; Index < Size; Index += 1) {
+                ((PUCHAR)Buffer)[Index] = HlReadRegister8(Base + Index);
+            }
+
+            break;
+        }
+
+    } while (Generation !=
+             VIRTIO_READ_COMMON8(Device, VirtioCommonConfigGeneration));
+
+    return STATUS_SUCCESS;
+}
+
+VIRTIO_API
+KSTATUS
+VirtioCreateQueue (
+    PVIRTIO_DEVICE Device,
+    ULONG Index,
+    ULONG Size,
+    ULONG Group,
+    PVIRTIO_QUEUE_SERVICE_ROUTINE ServiceRoutine,
+    PVOID ServiceContext,
+    PVIRTIO_QUEUE *Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates and enables a virtqueue. This must be called after
+    the features are negotiated and before the device is set ready.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Index - Supplies the index of the queue to create.
+
+    Size - Supplies the desired number of entries, or 0 to use the default.
+        The device's maximum caps this value.
+
+    Group - Supplies the interrupt group the queue belongs to. Queues in the
+        same group share an interrupt vector.
+
+    ServiceRoutine - Supplies an optional pointer to the routine to call when
+        the device uses buffers. If this is NULL, the queue does not interrupt
+        and must be polled.
+
+    ServiceContext - Supplies the context pointer passed to the service
+        routine.
+
+    Queue - Supplies a pointer where a pointer to the queue is returned.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PHYSICAL_ADDRESS Address;
+    BOOL EventIndex;
+    ULONG MaxSize;
+    PVIRTIO_QUEUE NewQueue;
+    USHORT NotifyOffset;
+    BOOL Packed;
+    KSTATUS Status;
+    USHORT Vector;
+
+    NewQueue = NULL;
+    if ((Index >= Device->QueueCount) || (Device->Queues[Index] != NULL)) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto CreateQueueEnd;
+    }
+
+    VIRTIO_WRITE_COMMON16(Device, VirtioCommonQueueSelect, Index);
+    MaxSize = VIRTIO_READ_COMMON16(Device, VirtioCommonQueueSize);
+    if (MaxSize == 0) {
+        Status = STATUS_NOT_SUPPORTED;
+        goto CreateQueueEnd;
+    }
+
+    if (Size == 0) {
+        Size = VIRTIO_DEFAULT_QUEUE_SIZE;
+    }
+
+    if (Size > VIRTIO_MAX_QUEUE_SIZE) {
+        Size = VIRTIO_MAX_QUEUE_SIZE;
+    }
+
+    if (Size > MaxSize) {
+        Size = MaxSize;
+    }
+
+    //
+    // Split rings must be a power of two in size.
+    //
+
+    Packed = VIRTIO_HAS_FEATURE(Device, VIRTIO_FEATURE_RING_PACKED);
+    EventIndex = VIRTIO_HAS_FEATURE(Device, VIRTIO_FEATURE_EVENT_INDEX);
+    if (Packed == FALSE) {
+        while (POWER_OF_2(Size) == FALSE) {
+            Size &= Size - 1;
+        }
+    }
+
+    NewQueue = MmAllocateNonPagedPool(sizeof(VIRTIO_QUEUE),
+                                      VIRTIO_ALLOCATION_TAG);
+
+    if (NewQueue == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateQueueEnd;
+    }
+
+    RtlZeroMemory(NewQueue, sizeof(VIRTIO_QUEUE));
+    NewQueue->Device = Device;
+    NewQueue->Index = Index;
+    NewQueue->Size = Size;
+    NewQueue->ServiceRoutine = ServiceRoutine;
+    NewQueue->ServiceContext = ServiceContext;
+    Status = VirtiopInitializeQueue(NewQueue, Packed, EventIndex);
+    if (!KSUCCESS(Status)) {
+        goto CreateQueueEnd;
+    }
+
+    //
+    // Pick the MSI-X vector. Vector zero belongs to configuration changes
+    // unless it is the only one, in which case everything shares it. Polled
+    // queues and line based interrupts use no vector.
+    //
+
+    Vector = VIRTIO_MSI_NO_VECTOR;
+    if ((ServiceRoutine != NULL) &&
+        (Device->InterruptLine == INVALID_INTERRUPT_LINE)) {
+
+        Vector = 0;
+        if (Device->InterruptCount > 1) {
+            Vector = 1 + (Group % (Device->InterruptCount - 1));
+        }
+    }
+
+    NewQueue->Vector = Vector;
+    VIRTIO_WRITE_COMMON16(Device, VirtioCommonQueueSize, Size);
+    if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
+        VIRTIO_WRITE_COMMON16(Device, VirtioCommonQueueVector, Vector);
+        if ((Vector != VIRTIO_MSI_NO_VECTOR) &&
+            (VIRTIO_READ_COMMON16(Device, VirtioCommonQueueVector) !=
+             Vector)) {
+
+            RtlDebugPrint("Virtio: Queue %d refused vector %d.\n",
+                          Index,
+                          Vector);
+
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto CreateQueueEnd;
+        }
+    }
+
+    Address = VirtiopGetQueueAddress(NewQueue, VirtioCommonQueueDescriptorLow);
+    VIRTIO_WRITE_COMMON32(Device,
+                          VirtioCommonQueueDescriptorLow,
+                          (ULONG)Address);
+
+    VIRTIO_WRITE_COMMON32(Device,
+                          VirtioCommonQueueDescriptorHigh,
+                          (ULONG)(Address >> 32));
+
+    Address = VirtiopGetQueueAddress(NewQueue, VirtioCommonQueueDriverLow);
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonQueueDriverLow, (ULONG)Address);
+    VIRTIO_WRITE_COMMON32(Device,
+                          VirtioCommonQueueDriverHigh,
+                          (ULONG)(Address >> 32));
+
+    Address = VirtiopGetQueueAddress(NewQueue, VirtioCommonQueueDeviceLow);
+    VIRTIO_WRITE_COMMON32(Device, VirtioCommonQueueDeviceLow, (ULONG)Address);
+    VIRTIO_WRITE_COMMON32(Device,
+                          VirtioCommonQueueDeviceHigh,
+                          (ULONG)(Address >> 32));
+
+    NotifyOffset = VIRTIO_READ_COMMON16(Device, VirtioCommonQueueNotifyOffset);
+    NewQueue->NotifyAddress = (PUCHAR)Device->NotifyBase +
+                              (NotifyOffset * Device->NotifyMultiplier);
+
+    VIRTIO_WRITE_COMMON16(Device, VirtioCommonQueueEnable, 1);
+    Device->Queues[Index] = NewQueue;
+    Status = STATUS_SUCCESS;
+
+CreateQueueEnd:
+    if (!KSUCCESS(Status)) {
+        if (NewQueue != NULL) {
+            VirtiopDestroyQueue(NewQueue);
+            NewQueue = NULL;
+        }
+    }
+
+    *Queue = NewQueue;
+    return Status;
+}
+
+VIRTIO_API
+VOID
+VirtioSetDriverReady (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tells the device that the driver is fully set up, making the
+    device live.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RtlMemoryBarrier();
+    VirtiopSetStatus(Device, VIRTIO_STATUS_DRIVER_OK);
+    return;
+}
+
+VIRTIO_API
+ULONG
+VirtioGetInterruptGroupCount (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of queue interrupt groups that got their
+    own interrupt vector. Group N is serviced on processor N modulo the
+    number of active processors.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    Returns the number of distinct interrupt groups, which is at least one.
+
+--*/
+
+{
+
+    if (Device->InterruptCount > 1) {
+        return Device->InterruptCount - 1;
+    }
+
+    return 1;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+VirtiopMapCapabilities (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine walks the device's PCI capability list looking for the virtio
+    structures, and maps the BARs they live in.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the start device IRP.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Length;
+    KSTATUS Status;
+
+    Device->CommonConfiguration = VirtiopMapStructure(
+                                    Device,
+                                    Irp,
+                                    VIRTIO_PCI_CAPABILITY_COMMON_CONFIGURATION,
+                                    &Length);
+
+    Device->NotifyBase = VirtiopMapStructure(
+                                    Device,
+                                    Irp,
+                                    VIRTIO_PCI_CAPABILITY_NOTIFY_CONFIGURATION,
+                                    &Length);
+
+    Device->IsrStatus = VirtiopMapStructure(
+                                       Device,
+                                       Irp,
+                                       VIRTIO_PCI_CAPABILITY_ISR_CONFIGURATION,
+                                       &Length);
+
+    //
+    // Not every device type has device specific configuration.
+    //
+
+    Device->DeviceConfiguration = VirtiopMapStructure(
+                                    Device,
+                                    Irp,
+                                    VIRTIO_PCI_CAPABILITY_DEVICE_CONFIGURATION,
+                                    &Length);
+
+    Device->DeviceConfigurationSize = 0;
+    if (Device->DeviceConfiguration != NULL) {
+        Device->DeviceConfigurationSize = Length;
+    }
+
+    if ((Device->CommonConfiguration == NULL) ||
+        (Device->NotifyBase == NULL) ||
+        (Device->IsrStatus == NULL)) {
+
+        RtlDebugPrint("Virtio: Legacy-only devices are not supported.\n");
+        Status = STATUS_NOT_SUPPORTED;
+        goto MapCapabilitiesEnd;
+    }
+
+    Status = STATUS_SUCCESS;
+
+MapCapabilitiesEnd:
+    return Status;
+}
+
+PVOID
+VirtiopMapStructure (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp,
+    ULONG Capability,
+    PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the first virtio capability of the given type that
+    lives in a usable memory BAR, and returns the mapped address of the
+    structure it describes.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the start device IRP.
+
+    Capability - Supplies the virtio capability type to find. See
+        VIRTIO_PCI_CAPABILITY_* definitions.
+
+    Length - Supplies a pointer where the length of the structure is returned.
+
+Return Value:
+
+    Returns the virtual address of the structure on success.
+
+    NULL if the capability could not be found or mapped.
+
+--*/
+
+{
+
+    ULONGLONG Bar;
+    PINTERFACE_PCI_CONFIG_ACCESS Interface;
+    ULONGLONG Multiplier;
+    ULONGLONG Offset;
+    ULONGLONG Pointer;
+    ULONG SearchCount;
+    KSTATUS Status;
+    ULONGLONG StructureLength;
+    ULONGLONG StructureOffset;
+    ULONGLONG Type;
+    ULONGLONG Value;
+
+    Interface = &(Device->PciConfigInterface);
+    Status = Interface->ReadPciConfig(Interface->DeviceToken,
+                                      VIRTIO_PCI_STATUS_OFFSET,
+                                      sizeof(USHORT),
+                                      &Value);
+
+    if ((!KSUCCESS(Status)) ||
+        ((Value & VIRTIO_PCI_STATUS_CAPABILITIES_LIST) == 0)) {
+
+        return NULL;
+    }
+
+    Status = Interface->ReadPciConfig(Interface->DeviceToken,
+                                      VIRTIO_PCI_CAPABILITIES_POINTER_OFFSET,
+                                      sizeof(UCHAR),
+                                      &Pointer);
+
+    if (!KSUCCESS(Status)) {
+        return NULL;
+    }
+
+    //
+    // Bound the walk in case the list loops.
+    //
+
+    SearchCount = 0;
+    Pointer &= ~0x3;
+    while ((Pointer != 0) && (SearchCount < 48)) {
+        SearchCount += 1;
+        Offset = Pointer;
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_NEXT,
+                                 sizeof(UCHAR),
+                                 &Pointer);
+
+        Pointer &= ~0x3;
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_ID,
+                                 sizeof(UCHAR),
+                                 &Value);
+
+        if (Value != VIRTIO_PCI_CAPABILITY_VENDOR) {
+            continue;
+        }
+
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_TYPE,
+                                 sizeof(UCHAR),
+                                 &Type);
+
+        if (Type != Capability) {
+            continue;
+        }
+
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_BAR,
+                                 sizeof(UCHAR),
+                                 &Bar);
+
+        if (Bar >= VIRTIO_PCI_BAR_COUNT) {
+            continue;
+        }
+
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_OFFSET,
+                                 sizeof(ULONG),
+                                 &StructureOffset);
+
+        Interface->ReadPciConfig(Interface->DeviceToken,
+                                 Offset + VIRTIO_PCI_CAPABILITY_LENGTH,
+                                 sizeof(ULONG),
+                                 &StructureLength);
+
+        //
+        // Skip structures in BARs that cannot be mapped, like I/O ports. A
+        // later capability may describe the same structure elsewhere.
+        //
+
+        Status = VirtiopMapBar(Device, Irp, (ULONG)Bar);
+        if (!KSUCCESS(Status)) {
+            continue;
+        }
+
+        if (StructureOffset + StructureLength >
+            Device->BarMappingSize[Bar]) {
+
+            continue;
+        }
+
+        if (Capability == VIRTIO_PCI_CAPABILITY_NOTIFY_CONFIGURATION) {
+            Interface->ReadPciConfig(
+                               Interface->DeviceToken,
+                               Offset + VIRTIO_PCI_CAPABILITY_NOTIFY_MULTIPLIER,
+                               sizeof(ULONG),
+                               &Multiplier);
+
+            Device->NotifyMultiplier = (ULONG)Multiplier;
+        }
+
+        *Length = (ULONG)StructureLength;
+        return (PUCHAR)Device->BarBase[Bar] + StructureOffset;
+    }
+
+    return NULL;
+}
+
+KSTATUS
+VirtiopMapBar (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp,
+    ULONG BarIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine maps the given memory BAR if it is not already mapped. The
+    BAR's address is read from configuration space and matched against the
+    bus local resources to find the processor local allocation to map.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the start device IRP.
+
+    BarIndex - Supplies the index of the BAR to map.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN AlignmentOffset;
+    PRESOURCE_ALLOCATION BusAllocation;
+    PRESOURCE_ALLOCATION_LIST BusList;
+    PHYSICAL_ADDRESS EndAddress;
+    PINTERFACE_PCI_CONFIG_ACCESS Interface;
+    PVOID Mapping;
+    UINTN PageSize;
+    ULONGLONG PhysicalAddress;
+    PRESOURCE_ALLOCATION ProcessorAllocation;
+    PRESOURCE_ALLOCATION_LIST ProcessorList;
+    UINTN Size;
+    KSTATUS Status;
+    ULONGLONG Value;
+
+    if (Device->BarBase[BarIndex] != NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    Interface = &(Device->PciConfigInterface);
+    Status = Interface->ReadPciConfig(
+                                 Interface->DeviceToken,
+                                 VIRTIO_PCI_BAR_OFFSET + (BarIndex * 4),
+                                 sizeof(ULONG),
+                                 &Value);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if ((Value & VIRTIO_PCI_BAR_IO_SPACE) != 0) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    PhysicalAddress = Value;
+    if (((Value & VIRTIO_PCI_BAR_MEMORY_TYPE_MASK) ==
+         VIRTIO_PCI_BAR_MEMORY_64_BIT) &&
+        (BarIndex + 1 < VIRTIO_PCI_BAR_COUNT)) {
+
+        Status = Interface->ReadPciConfig(
+                                Interface->DeviceToken,
+                                VIRTIO_PCI_BAR_OFFSET + ((BarIndex + 1) * 4),
+                                sizeof(ULONG),
+                                &Value);
+
+        if (!KSUCCESS(Status)) {
+            return Status;
+        }
+
+        PhysicalAddress |= Value << 32;
+    }
+
+    PhysicalAddress &= VIRTIO_PCI_BAR_MEMORY_ADDRESS_MASK;
+    if (PhysicalAddress == 0) {
+        return STATUS_INVALID_CONFIGURATION;
+    }
+
+    //
+    // The bus and processor local lists run in parallel. Find the bus
+    // allocation the PCI driver programmed into the BAR.
+    //
+
+    BusList = Irp->U.StartDevice.BusLocalResources;
+    ProcessorList = Irp->U.StartDevice.ProcessorLocalResources;
+    BusAllocation = IoGetNextResourceAllocation(BusList, NULL);
+    ProcessorAllocation = IoGetNextResourceAllocation(ProcessorList, NULL);
+    while ((BusAllocation != NULL) && (ProcessorAllocation != NULL)) {
+        if ((BusAllocation->Type == ResourceTypePhysicalAddressSpace) &&
+            (BusAllocation->Length != 0) &&
+            (BusAllocation->Allocation == PhysicalAddress)) {
+
+            break;
+        }
+
+        BusAllocation = IoGetNextResourceAllocation(BusList, BusAllocation);
+        ProcessorAllocation = IoGetNextResourceAllocation(ProcessorList,
+                                                          ProcessorAllocation);
+    }
+
+    if ((BusAllocation == NULL) || (ProcessorAllocation == NULL)) {
+        return STATUS_INVALID_CONFIGURATION;
+    }
+
+    //
+    // Page align the mapping request.
+    //
+
+    PageSize = MmPageSize();
+    PhysicalAddress = ProcessorAllocation->Allocation;
+    EndAddress = PhysicalAddress + ProcessorAllocation->Length;
+    PhysicalAddress = ALIGN_RANGE_DOWN(PhysicalAddress, PageSize);
+    AlignmentOffset = ProcessorAllocation->Allocation - PhysicalAddress;
+    EndAddress = ALIGN_RANGE_UP(EndAddress, PageSize);
+    Size = (UINTN)(EndAddress - PhysicalAddress);
+    Mapping = MmMapPhysicalAddress(PhysicalAddress, Size, TRUE, FALSE, TRUE);
+    if (Mapping == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    Device->BarMapping[BarIndex] = Mapping;
+    Device->BarMappingSize[BarIndex] = Size;
+    Device->BarBase[BarIndex] = (PUCHAR)Mapping + AlignmentOffset;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+VirtiopResetDevice (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resets a virtio device and waits for the reset to finish.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_TIMEOUT if the device never finished resetting.
+
+--*/
+
+{
+
+    ULONGLONG Time;
+    ULONGLONG Timeout;
+
+    VIRTIO_WRITE_COMMON8(Device, VirtioCommonDeviceStatus, 0);
+    Time = HlQueryTimeCounter();
+    Timeout = Time + ((HlQueryTimeCounterFrequency() *
+                       VIRTIO_RESET_TIMEOUT_MS) /
+                      MILLISECONDS_PER_SECOND);
+
+    while (VIRTIO_READ_COMMON8(Device, VirtioCommonDeviceStatus) != 0) {
+        if (HlQueryTimeCounter() > Timeout) {
+            RtlDebugPrint("Virtio: Reset timed out.\n");
+            return STATUS_TIMEOUT;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+VirtiopSetStatus (
+    PVIRTIO_DEVICE Device,
+    UCHAR Status
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds the given bits to the device status register.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Status - Supplies the status bits to set.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Status |= VIRTIO_READ_COMMON8(Device, VirtioCommonDeviceStatus);
+    VIRTIO_WRITE_COMMON8(Device, VirtioCommonDeviceStatus, Status);
+    return;
+}
+
+KSTATUS
+VirtiopConnectInterrupts (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enables the MSI-X vectors if they were allocated, steering
+    the configuration vector at the first processor and each queue group
+    vector at its own processor, and connects every vector.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    IO_CONNECT_INTERRUPT_PARAMETERS Connect;
+    ULONG Index;
+    PVIRTIO_INTERRUPT Interrupt;
+    PINTERFACE_PCI_MSI MsiInterface;
+    PCI_MSI_TYPE MsiType;
+    ULONG ProcessorCount;
+    PPROCESSOR_SET Processors;
+    UINTN Size;
+    KSTATUS Status;
+
+    ASSERT(Device->Interrupts == NULL);
+
+    Processors = NULL;
+    if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
+
+        ASSERT((Device->PciFlags &
+                VIRTIO_PCI_FLAG_MSI_RESOURCES_ALLOCATED) != 0);
+
+        //
+        // Group N is pinned to processor N. The configuration vector is
+        // rare, so it just goes to the first processor.
+        //
+
+        Size = sizeof(PROCESSOR_SET) * Device->InterruptCount;
+        Processors = MmAllocateNonPagedPool(Size, VIRTIO_ALLOCATION_TAG);
+        if (Processors == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ConnectInterruptsEnd;
+        }
+
+        ProcessorCount = KeGetActiveProcessorCount();
+        for (Index = 0; Index < Device->InterruptCount; Index += 1) {
+            Processors[Index].Target = ProcessorTargetSingleProcessor;
+            Processors[Index].U.Number = 0;
+            if (Index != 0) {
+                Processors[Index].U.Number = (Index - 1) % ProcessorCount;
+            }
+        }
+
+        MsiInterface = &(Device->PciMsiInterface);
+        Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                             Device->InterruptVector,
+                                             Device->InterruptCount,
+                                             Processors,
+                                             &MsiType);
+
+        if ((!KSUCCESS(Status)) && (Device->InterruptCount > 1)) {
+            Device->InterruptCount = 1;
+            Status = MsiInterface->EnableVectors(MsiInterface->DeviceToken,
+                                                 Device->InterruptVector,
+                                                 1,
+                                                 Processors,
+                                                 &MsiType);
+        }
+
+        if (!KSUCCESS(Status)) {
+            goto ConnectInterruptsEnd;
+        }
+
+        if (MsiType != PciMsiTypeExtended) {
+            RtlDebugPrint("Virtio: MSI-X not enabled.\n");
+            Status = STATUS_NOT_SUPPORTED;
+            goto ConnectInterruptsEnd;
+        }
+    }
+
+    Size = sizeof(VIRTIO_INTERRUPT) * Device->InterruptCount;
+    Device->Interrupts = MmAllocateNonPagedPool(Size, VIRTIO_ALLOCATION_TAG);
+    if (Device->Interrupts == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto ConnectInterruptsEnd;
+    }
+
+    for (Index = 0; Index < Device->InterruptCount; Index += 1) {
+        Interrupt = &(Device->Interrupts[Index]);
+        Interrupt->Device = Device;
+        Interrupt->Index = Index;
+        Interrupt->Handle = INVALID_HANDLE;
+    }
+
+    for (Index = 0; Index < Device->InterruptCount; Index += 1) {
+        Interrupt = &(Device->Interrupts[Index]);
+        RtlZeroMemory(&Connect, sizeof(IO_CONNECT_INTERRUPT_PARAMETERS));
+        Connect.Version = IO_CONNECT_INTERRUPT_PARAMETERS_VERSION;
+        Connect.Device = Device->OsDevice;
+        Connect.LineNumber = Device->InterruptLine;
+        Connect.Vector = Device->InterruptVector + Index;
+        Connect.InterruptServiceRoutine = VirtiopInterruptService;
+        if ((Device->Flags & VIRTIO_DEVICE_FLAG_LOW_LEVEL_INTERRUPTS) != 0) {
+            Connect.LowLevelServiceRoutine = VirtiopInterruptServiceWorker;
+
+        } else {
+            Connect.DispatchServiceRoutine = VirtiopInterruptServiceWorker;
+        }
+
+        Connect.Context = Interrupt;
+        Connect.Interrupt = &(Interrupt->Handle);
+        Status = IoConnectInterrupt(&Connect);
+        if (!KSUCCESS(Status)) {
+            goto ConnectInterruptsEnd;
+        }
+    }
+
+    Status = STATUS_SUCCESS;
+
+ConnectInterruptsEnd:
+    if (!KSUCCESS(Status)) {
+        VirtiopDisconnectInterrupts(Device);
+    }
+
+    if (Processors != NULL) {
+        MmFreeNonPagedPool(Processors);
+    }
+
+    return Status;
+}
+
+VOID
+VirtiopDisconnectInterrupts (
+    PVIRTIO_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine disconnects and frees any connected interrupts.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PVIRTIO_INTERRUPT Interrupt;
+
+    if (Device->Interrupts == NULL) {
+        return;
+    }
+
+    for (Index = 0; Index < Device->InterruptCount; Index += 1) {
+        Interrupt = &(Device->Interrupts[Index]);
+        if (Interrupt->Handle != INVALID_HANDLE) {
+            IoDisconnectInterrupt(Interrupt->Handle);
+            Interrupt->Handle = INVALID_HANDLE;
+        }
+    }
+
+    MmFreeNonPagedPool(Device->Interrupts);
+    Device->Interrupts = NULL;
+    return;
+}
+
+INTERRUPT_STATUS
+VirtiopInterruptService (
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the virtio interrupt service routine.
+
+Arguments:
+
+    Context - Supplies the context pointer given to the system when the
+        interrupt was connected. In this case, this points to the virtio
+        interrupt state.
+
+Return Value:
+
+    Interrupt status.
+
+--*/
+
+{
+
+    PVIRTIO_DEVICE Device;
+    PVIRTIO_INTERRUPT Interrupt;
+    UCHAR Status;
+
+    Interrupt = (PVIRTIO_INTERRUPT)Context;
+    Device = Interrupt->Device;
+
+    //
+    // MSI-X vectors are not shared and need no acknowledgement.
+    //
+
+    if (Device->InterruptLine == INVALID_INTERRUPT_LINE) {
+        return InterruptStatusClaimed;
+    }
+
+    //
+    // Reading the ISR status deasserts the line.
+    //
+
+    Status = HlReadRegister8(Device->IsrStatus);
+    if (Status == 0) {
+        return InterruptStatusNotClaimed;
+    }
+
+    RtlAtomicOr32(&(Device->PendingStatus), Status);
+    return InterruptStatusClaimed;
+}
+
+INTERRUPT_STATUS
+VirtiopInterruptServiceWorker (
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes virtio interrupts at dispatch or low level,
+    calling the service routines of the queues routed to the vector.
+
+Arguments:
+
+    Context - Supplies the context pointer given to the system when the
+        interrupt was connected. In this case, this points to the virtio
+        interrupt state.
+
+Return Value:
+
+    Interrupt status.
+
+--*/
+
+{
+
+    PVIRTIO_DEVICE Device;
+    PVIRTIO_INTERRUPT Interrupt;
+    ULONG Status;
+
+    Interrupt = (PVIRTIO_INTERRUPT)Context;
+    Device = Interrupt->Device;
+    if (Device->InterruptLine != INVALID_INTERRUPT_LINE) {
+        Status = RtlAtomicExchange32(&(Device->PendingStatus), 0);
+        if (Status == 0) {
+            return InterruptStatusNotClaimed;
+        }
+
+        if ((Status & VIRTIO_ISR_QUEUE) != 0) {
+            VirtiopServiceQueues(Device, VIRTIO_MSI_NO_VECTOR);
+        }
+
+    //
+    // With a single vector everything shares it, and the ISR status is the
+    // only way to tell whether the configuration changed.
+    //
+
+    } else if (Device->InterruptCount == 1) {
+        Status = HlReadRegister8(Device->IsrStatus);
+        VirtiopServiceQueues(Device, VIRTIO_MSI_NO_VECTOR);
+
+    } else if (Interrupt->Index == 0) {
+        Status = VIRTIO_ISR_CONFIGURATION;
+
+    } else {
+        Status = 0;
+        VirtiopServiceQueues(Device, Interrupt->Index);
+    }
+
+    if (((Status & VIRTIO_ISR_CONFIGURATION) != 0) &&
+        (Device->ConfigurationChangeRoutine != NULL)) {
+
+        Device->ConfigurationChangeRoutine(Device, Device->ConsumerContext);
+    }
+
+    return InterruptStatusClaimed;
+}
+
+VOID
+VirtiopServiceQueues (
+    PVIRTIO_DEVICE Device,
+    USHORT Vector
+    )
+
+/*++
+
+Routine Description:
+
+    This routine calls the service routine of each queue on the given vector.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Vector - Supplies the MSI-X table entry that interrupted, or
+        VIRTIO_MSI_NO_VECTOR to service every queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PVIRTIO_QUEUE Queue;
+
+    for (Index = 0; Index < Device->QueueCount; Index += 1) {
+        Queue = Device->Queues[Index];
+        if ((Queue == NULL) || (Queue->ServiceRoutine == NULL)) {
+            continue;
+        }
+
+        if ((Vector != VIRTIO_MSI_NO_VECTOR) && (Queue->Vector != Vector)) {
+            continue;
+        }
+
+        Queue->ServiceRoutine(Queue, Queue->ServiceContext);
+    }
+
+    return;
+}
+
+VOID
+VirtiopProcessPciConfigInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a PCI configuration space access interface
+    changes in availability.
+
+Arguments:
+
+    Context - Supplies the caller's context pointer, supplied when the caller
+        requested interface notifications.
+
+    Device - Supplies a pointer to the device exposing or deleting the
+        interface.
+
+    InterfaceBuffer - Supplies a pointer to the interface buffer of the
+        interface.
+
+    InterfaceBufferSize - Supplies the buffer size.
+
+    Arrival - Supplies TRUE if a new interface is arriving, or FALSE if an
+        interface is departing.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_DEVICE VirtioDevice;
+
+    VirtioDevice = (PVIRTIO_DEVICE)Context;
+    if (Arrival != FALSE) {
+        if (InterfaceBufferSize >= sizeof(INTERFACE_PCI_CONFIG_ACCESS)) {
+
+            ASSERT((VirtioDevice->PciFlags &
+                    VIRTIO_PCI_FLAG_CONFIG_INTERFACE_AVAILABLE) == 0);
+
+            RtlCopyMemory(&(VirtioDevice->PciConfigInterface),
+                          InterfaceBuffer,
+                          sizeof(INTERFACE_PCI_CONFIG_ACCESS));
+
+            VirtioDevice->PciFlags |=
+                                    VIRTIO_PCI_FLAG_CONFIG_INTERFACE_AVAILABLE;
+        }
+
+    } else {
+        VirtioDevice->PciFlags &= ~VIRTIO_PCI_FLAG_CONFIG_INTERFACE_AVAILABLE;
+    }
+
+    return;
+}
+
+VOID
+VirtiopProcessPciMsiInterfaceChangeNotification (
+    PVOID Context,
+    PDEVICE Device,
+    PVOID InterfaceBuffer,
+    ULONG InterfaceBufferSize,
+    BOOL Arrival
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a PCI MSI interface changes in availability.
+
+Arguments:
+
+    Context - Supplies the caller's context pointer, supplied when the caller
+        requested interface notifications.
+
+    Device - Supplies a pointer to the device exposing or deleting the
+        interface.
+
+    InterfaceBuffer - Supplies a pointer to the interface buffer of the
+        interface.
+
+    InterfaceBufferSize - Supplies the buffer size.
+
+    Arrival - Supplies TRUE if a new interface is arriving, or FALSE if an
+        interface is departing.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_DEVICE VirtioDevice;
+
+    VirtioDevice = (PVIRTIO_DEVICE)Context;
+    if (Arrival != FALSE) {
+        if (InterfaceBufferSize >= sizeof(INTERFACE_PCI_MSI)) {
+
+            ASSERT((VirtioDevice->PciFlags &
+                    VIRTIO_PCI_FLAG_MSI_INTERFACE_AVAILABLE) == 0);
+
+            RtlCopyMemory(&(VirtioDevice->PciMsiInterface),
+                          InterfaceBuffer,
+                          sizeof(INTERFACE_PCI_MSI));
+
+            VirtioDevice->PciFlags |= VIRTIO_PCI_FLAG_MSI_INTERFACE_AVAILABLE;
+        }
+
+    } else {
+        VirtioDevice->PciFlags &= ~VIRTIO_PCI_FLAG_MSI_INTERFACE_AVAILABLE;
+    }
+
+    return;
+}
+
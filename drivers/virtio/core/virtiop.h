@@ -0,0 +1,167 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtiop.h
+
+Abstract:
+
+    This header contains internal definitions for the virtio library. This
+    file should only be included by the library itself, not by external
+    consumers of the library.
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define VIRTIO_API __DLLEXPORT
+
+#include <minoca/virtio/virtio.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// These macros read from and write to the common configuration registers.
+//
+
+#define VIRTIO_READ_COMMON8(_Device, _Register) \
+    HlReadRegister8((PUCHAR)(_Device)->CommonConfiguration + (_Register))
+
+#define VIRTIO_READ_COMMON16(_Device, _Register) \
+    HlReadRegister16((PUCHAR)(_Device)->CommonConfiguration + (_Register))
+
+#define VIRTIO_READ_COMMON32(_Device, _Register) \
+    HlReadRegister32((PUCHAR)(_Device)->CommonConfiguration + (_Register))
+
+#define VIRTIO_WRITE_COMMON8(_Device, _Register, _Value)                  \
+    HlWriteRegister8((PUCHAR)(_Device)->CommonConfiguration + (_Register), \
+                     (_Value))
+
+#define VIRTIO_WRITE_COMMON16(_Device, _Register, _Value)                  \
+    HlWriteRegister16((PUCHAR)(_Device)->CommonConfiguration + (_Register), \
+                      (_Value))
+
+#define VIRTIO_WRITE_COMMON32(_Device, _Register, _Value)                  \
+    HlWriteRegister32((PUCHAR)(_Device)->CommonConfiguration + (_Register), \
+                      (_Value))
+
+//
+// This macro determines whether or not the device asked to be notified given
+// the event index it published, the new available index, and the available
+// index at the last notification.
+//
+
+#define VIRTIO_NEED_EVENT(_Event, _New, _Old) \
+    ((USHORT)((_New) - (_Event) - 1) < (USHORT)((_New) - (_Old)))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the amount of time to wait for the device to finish a reset, in
+// milliseconds.
+//
+
+#define VIRTIO_RESET_TIMEOUT_MS 1000
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+KSTATUS
+VirtiopInitializeQueue (
+    PVIRTIO_QUEUE Queue,
+    BOOL Packed,
+    BOOL EventIndex
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates the rings for a virtqueue and initializes its
+    software state. The queue's device, index, and size must already be set.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue to initialize.
+
+    Packed - Supplies a boolean indicating whether to use the packed ring
+        layout (TRUE) or the split ring layout (FALSE).
+
+    EventIndex - Supplies a boolean indicating whether the event index feature
+        was negotiated.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VOID
+VirtiopDestroyQueue (
+    PVIRTIO_QUEUE Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine frees a virtqueue. The device must already have been reset.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+PHYSICAL_ADDRESS
+VirtiopGetQueueAddress (
+    PVIRTIO_QUEUE Queue,
+    VIRTIO_COMMON_REGISTER Register
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the physical address of one of the areas of a
+    virtqueue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Register - Supplies the low register the address is destined for, which
+        identifies the descriptor, driver, or device area.
+
+Return Value:
+
+    Returns the physical address of the area.
+
+--*/
+
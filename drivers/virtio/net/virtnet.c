@@ -0,0 +1,666 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtnet.c
+
+Abstract:
+
+    This module implements the virtio network device driver.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include <minoca/net/netdrv.h>
+#include "virtnet.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtnetAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    );
+
+VOID
+VirtnetDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtnetDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtnetDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtnetDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtnetDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+VirtnetDestroyLink (
+    PVOID DeviceContext
+    );
+
+KSTATUS
+VirtnetpStartDevice (
+    PIRP Irp,
+    PVIRTIO_NET_DEVICE Device
+    );
+
+KSTATUS
+VirtnetpAddNetworkDevice (
+    PVIRTIO_NET_DEVICE Device
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PDRIVER VirtioNetDriver = NULL;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+__USED
+KSTATUS
+DriverEntry (
+    PDRIVER Driver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for the virtio network driver. It registers
+    its other dispatch functions, and performs driver-wide initialization.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver object.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code on error.
+
+--*/
+
+{
+
+    DRIVER_FUNCTION_TABLE FunctionTable;
+    KSTATUS Status;
+
+    VirtioNetDriver = Driver;
+    RtlZeroMemory(&FunctionTable, sizeof(DRIVER_FUNCTION_TABLE));
+    FunctionTable.Version = DRIVER_FUNCTION_TABLE_VERSION;
+    FunctionTable.AddDevice = VirtnetAddDevice;
+    FunctionTable.DispatchStateChange = VirtnetDispatchStateChange;
+    FunctionTable.DispatchOpen = VirtnetDispatchOpen;
+    FunctionTable.DispatchClose = VirtnetDispatchClose;
+    FunctionTable.DispatchIo = VirtnetDispatchIo;
+    FunctionTable.DispatchSystemControl = VirtnetDispatchSystemControl;
+    Status = IoRegisterDriverFunctions(Driver, &FunctionTable);
+    return Status;
+}
+
+KSTATUS
+VirtnetAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a device is detected for which the virtio
+    network driver acts as the function driver. The driver will attach itself
+    to the stack.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver being called.
+
+    DeviceId - Supplies a pointer to a string with the device ID.
+
+    ClassId - Supplies a pointer to a string containing the device's class ID.
+
+    CompatibleIds - Supplies a pointer to a string containing device IDs
+        that would be compatible with this device.
+
+    DeviceToken - Supplies an opaque token that the driver can use to identify
+        the device in the system. This token should be used when attaching to
+        the stack.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code if the driver was unsuccessful in attaching itself.
+
+--*/
+
+{
+
+    PVIRTIO_NET_DEVICE Device;
+    VIRTIO_INITIALIZATION_BLOCK Parameters;
+    KSTATUS Status;
+
+    Device = MmAllocateNonPagedPool(sizeof(VIRTIO_NET_DEVICE),
+                                    VIRTIO_NET_ALLOCATION_TAG);
+
+    if (Device == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    RtlZeroMemory(Device, sizeof(VIRTIO_NET_DEVICE));
+    Device->OsDevice = DeviceToken;
+    Device->ConfigurationLock = KeCreateQueuedLock();
+    if (Device->ConfigurationLock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    //
+    // Ask for an interrupt group per queue pair. The networking core sends
+    // and receives at low level, so have the queues serviced there too.
+    //
+
+    RtlZeroMemory(&Parameters, sizeof(VIRTIO_INITIALIZATION_BLOCK));
+    Parameters.Version = VIRTIO_INITIALIZATION_BLOCK_VERSION;
+    Parameters.OsDevice = DeviceToken;
+    Parameters.ConsumerContext = Device;
+    Parameters.ConfigurationChangeRoutine = VirtnetpConfigurationChange;
+    Parameters.Flags = VIRTIO_DEVICE_FLAG_LOW_LEVEL_INTERRUPTS;
+    Parameters.MaxInterruptGroups = VIRTIO_NET_MAX_QUEUE_PAIRS;
+    Device->Virtio = VirtioCreateDevice(&Parameters);
+    if (Device->Virtio == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    Status = IoAttachDriverToDevice(Driver, DeviceToken, Device);
+    if (!KSUCCESS(Status)) {
+        goto AddDeviceEnd;
+    }
+
+AddDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Device != NULL) {
+            if (Device->Virtio != NULL) {
+                VirtioDestroyDevice(Device->Virtio);
+            }
+
+            if (Device->ConfigurationLock != NULL) {
+                KeDestroyQueuedLock(Device->ConfigurationLock);
+            }
+
+            MmFreeNonPagedPool(Device);
+        }
+    }
+
+    return Status;
+}
+
+VOID
+VirtnetDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles State Change IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_NET_DEVICE Device;
+    KSTATUS Status;
+
+    ASSERT(Irp->MajorCode == IrpMajorStateChange);
+
+    Device = DeviceContext;
+    if (Irp->Direction == IrpUp) {
+        if (!KSUCCESS(IoGetIrpStatus(Irp))) {
+            return;
+        }
+
+        switch (Irp->MinorCode) {
+        case IrpMinorQueryResources:
+            Status = VirtioProcessResourceRequirements(Device->Virtio, Irp);
+            if (!KSUCCESS(Status)) {
+                IoCompleteIrp(VirtioNetDriver, Irp, Status);
+            }
+
+            break;
+
+        case IrpMinorStartDevice:
+            Status = VirtnetpStartDevice(Irp, Device);
+            if (!KSUCCESS(Status)) {
+                IoCompleteIrp(VirtioNetDriver, Irp, Status);
+            }
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+VirtnetDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Open IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+VirtnetDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Close IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+VirtnetDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles I/O IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+VirtnetDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_NET_DEVICE Device;
+    PSYSTEM_CONTROL_DEVICE_INFORMATION DeviceInformationRequest;
+    KSTATUS Status;
+
+    ASSERT(Irp->MajorCode == IrpMajorSystemControl);
+
+    Device = DeviceContext;
+    if (Irp->Direction == IrpDown) {
+        switch (Irp->MinorCode) {
+        case IrpMinorSystemControlDeviceInformation:
+            DeviceInformationRequest = Irp->U.SystemControl.SystemContext;
+            Status = NetGetSetLinkDeviceInformation(
+                                         Device->NetworkLink,
+                                         &(DeviceInformationRequest->Uuid),
+                                         DeviceInformationRequest->Data,
+                                         &(DeviceInformationRequest->DataSize),
+                                         DeviceInformationRequest->Set);
+
+            IoCompleteIrp(VirtioNetDriver, Irp, Status);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+VirtnetDestroyLink (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine notifies the device layer that the networking core is in the
+    process of destroying the link and will no longer call into the device for
+    this link. This allows the device layer to release any context that was
+    supporting the device link interface.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link being destroyed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+VirtnetpStartDevice (
+    PIRP Irp,
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts a virtio network device.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    //
+    // Resetting the device would tear down the live queues, so a started
+    // device is left alone.
+    //
+
+    if ((Device->Flags & VIRTIO_NET_FLAG_STARTED) != 0) {
+        return STATUS_SUCCESS;
+    }
+
+    Status = VirtioStartDevice(Device->Virtio, Irp);
+    if (!KSUCCESS(Status)) {
+        goto StartDeviceEnd;
+    }
+
+    Status = VirtnetpInitializeDevice(Device);
+    if (!KSUCCESS(Status)) {
+        goto StartDeviceEnd;
+    }
+
+    //
+    // The link must exist before receive buffers can be allocated for it.
+    //
+
+    Status = VirtnetpAddNetworkDevice(Device);
+    if (!KSUCCESS(Status)) {
+        goto StartDeviceEnd;
+    }
+
+    Status = VirtnetpStartNetwork(Device);
+    if (!KSUCCESS(Status)) {
+        goto StartDeviceEnd;
+    }
+
+    Device->Flags |= VIRTIO_NET_FLAG_STARTED;
+
+StartDeviceEnd:
+    return Status;
+}
+
+KSTATUS
+VirtnetpAddNetworkDevice (
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds the device to core networking's available links.
+
+Arguments:
+
+    Device - Supplies a pointer to the device to add.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    NET_LINK_PROPERTIES Properties;
+    KSTATUS Status;
+
+    if (Device->NetworkLink != NULL) {
+        Status = STATUS_SUCCESS;
+        goto AddNetworkDeviceEnd;
+    }
+
+    //
+    // Add a link to the core networking library. Every transmitted packet
+    // carries the virtio header in front of the ethernet frame.
+    //
+
+    RtlZeroMemory(&Properties, sizeof(NET_LINK_PROPERTIES));
+    Properties.Version = NET_LINK_PROPERTIES_VERSION;
+    Properties.TransmitAlignment = 1;
+    Properties.Device = Device->OsDevice;
+    Properties.DeviceContext = Device;
+    Properties.PacketSizeInformation.MaxPacketSize =
+                                                VIRTIO_NET_RECEIVE_BUFFER_SIZE;
+
+    Properties.PacketSizeInformation.HeaderSize = sizeof(VIRTIO_NET_HEADER);
+    Properties.DataLinkType = NetDomainEthernet;
+    Properties.MaxPhysicalAddress = MAX_ULONGLONG;
+    Properties.PhysicalAddress.Domain = NetDomainEthernet;
+    RtlCopyMemory(&(Properties.PhysicalAddress.Address),
+                  &(Device->MacAddress),
+                  sizeof(Device->MacAddress));
+
+    Properties.Interface.Send = VirtnetSend;
+    Properties.Interface.GetSetInformation = VirtnetGetSetInformation;
+    Properties.Interface.DestroyLink = VirtnetDestroyLink;
+    Properties.Capabilities = Device->SupportedCapabilities;
+    Status = NetAddLink(&Properties, &(Device->NetworkLink));
+    if (!KSUCCESS(Status)) {
+        goto AddNetworkDeviceEnd;
+    }
+
+AddNetworkDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Device->NetworkLink != NULL) {
+            NetRemoveLink(Device->NetworkLink);
+            Device->NetworkLink = NULL;
+        }
+    }
+
+    return Status;
+}
+
@@ -0,0 +1,474 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtnet.h
+
+Abstract:
+
+    This header contains definitions for the virtio network device driver.
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/virtio/virtio.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// These macros return the virtqueue indices of the given queue pair.
+//
+
+#define VIRTIO_NET_RECEIVE_QUEUE_INDEX(_Pair) ((_Pair) * 2)
+#define VIRTIO_NET_TRANSMIT_QUEUE_INDEX(_Pair) (((_Pair) * 2) + 1)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define VIRTIO_NET_ALLOCATION_TAG 0x744E7456 // 'tNtV'
+
+//
+// Define the virtio network device feature bits.
+//
+
+#define VIRTIO_NET_FEATURE_CSUM         (1ULL << 0)
+#define VIRTIO_NET_FEATURE_GUEST_CSUM   (1ULL << 1)
+#define VIRTIO_NET_FEATURE_MAC          (1ULL << 5)
+#define VIRTIO_NET_FEATURE_GUEST_TSO4   (1ULL << 7)
+#define VIRTIO_NET_FEATURE_GUEST_TSO6   (1ULL << 8)
+#define VIRTIO_NET_FEATURE_HOST_TSO4    (1ULL << 11)
+#define VIRTIO_NET_FEATURE_HOST_TSO6    (1ULL << 12)
+#define VIRTIO_NET_FEATURE_STATUS       (1ULL << 16)
+#define VIRTIO_NET_FEATURE_CONTROL      (1ULL << 17)
+#define VIRTIO_NET_FEATURE_CONTROL_RX   (1ULL << 18)
+#define VIRTIO_NET_FEATURE_MULTIQUEUE   (1ULL << 22)
+
+//
+// Define the features the driver asks for. The segmentation offload features
+// are not requested, as the networking core never hands down packets larger
+// than the link MTU and does not take coalesced receive packets.
+//
+
+#define VIRTIO_NET_DRIVER_FEATURES       \
+    (VIRTIO_NET_FEATURE_CSUM |           \
+     VIRTIO_NET_FEATURE_GUEST_CSUM |     \
+     VIRTIO_NET_FEATURE_MAC |            \
+     VIRTIO_NET_FEATURE_STATUS |         \
+     VIRTIO_NET_FEATURE_CONTROL |        \
+     VIRTIO_NET_FEATURE_CONTROL_RX |     \
+     VIRTIO_NET_FEATURE_MULTIQUEUE)
+
+//
+// Define the offsets of the fields in the device configuration space.
+//
+
+#define VIRTIO_NET_CONFIG_MAC         0
+#define VIRTIO_NET_CONFIG_STATUS      6
+#define VIRTIO_NET_CONFIG_QUEUE_PAIRS 8
+
+//
+// Define the link status bits.
+//
+
+#define VIRTIO_NET_STATUS_LINK_UP 0x0001
+
+//
+// Define the packet header flags.
+//
+
+#define VIRTIO_NET_HEADER_NEEDS_CSUM 0x01
+#define VIRTIO_NET_HEADER_DATA_VALID 0x02
+
+//
+// Define the control queue command classes, commands and acknowledgements.
+//
+
+#define VIRTIO_NET_CONTROL_RX 0
+#define VIRTIO_NET_CONTROL_RX_PROMISCUOUS 0
+#define VIRTIO_NET_CONTROL_RX_ALL_MULTICAST 1
+
+#define VIRTIO_NET_CONTROL_MULTIQUEUE 4
+#define VIRTIO_NET_CONTROL_MULTIQUEUE_PAIRS_SET 0
+
+#define VIRTIO_NET_CONTROL_OK 0
+#define VIRTIO_NET_CONTROL_ERROR 1
+
+//
+// Define how long to wait for the device to answer a control command.
+//
+
+#define VIRTIO_NET_CONTROL_TIMEOUT_MS 1000
+
+//
+// Define the maximum number of queue pairs the driver will use.
+//
+
+#define VIRTIO_NET_MAX_QUEUE_PAIRS 16
+
+//
+// Define the size of the receive buffers, which must hold the virtio header
+// plus a full ethernet frame.
+//
+
+#define VIRTIO_NET_RECEIVE_BUFFER_SIZE 2048
+
+//
+// Define the maximum number of receive buffers posted to a queue.
+//
+
+#define VIRTIO_NET_MAX_RECEIVE_BUFFERS 256
+
+//
+// Define the maximum number of packets that can be waiting for transmit
+// descriptors on a queue pair before the driver starts dropping them.
+//
+
+#define VIRTIO_NET_MAX_TRANSMIT_PACKET_LIST_COUNT 512
+
+//
+// Define the ethernet values needed to locate the transport header for
+// checksum offload.
+//
+
+#define VIRTIO_NET_ETHERNET_HEADER_SIZE 14
+#define VIRTIO_NET_ETHERNET_TYPE_OFFSET 12
+
+//
+// Define the offsets of the checksum fields within the TCP and UDP headers.
+//
+
+#define VIRTIO_NET_TCP_CHECKSUM_OFFSET 16
+#define VIRTIO_NET_UDP_CHECKSUM_OFFSET 6
+
+#define VIRTIO_NET_IP_PROTOCOL_TCP 6
+#define VIRTIO_NET_IP_PROTOCOL_UDP 17
+
+//
+// Define virtio network device flags.
+//
+
+#define VIRTIO_NET_FLAG_STARTED 0x00000001
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef struct _VIRTIO_NET_DEVICE VIRTIO_NET_DEVICE, *PVIRTIO_NET_DEVICE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the header that precedes every packet on the
+    receive and transmit queues. This structure is defined by the virtio
+    specification.
+
+Members:
+
+    Flags - Stores a bitmask of flags. See VIRTIO_NET_HEADER_* definitions.
+
+    GsoType - Stores the segmentation offload type, which is always none.
+
+    HeaderLength - Stores the length of the headers for segmentation offload.
+
+    GsoSize - Stores the segment size for segmentation offload.
+
+    ChecksumStart - Stores the offset from the start of the frame where the
+        device should start checksumming.
+
+    ChecksumOffset - Stores the offset after the checksum start where the
+        device should store the checksum.
+
+    BufferCount - Stores the number of merged receive buffers.
+
+--*/
+
+typedef struct _VIRTIO_NET_HEADER {
+    UCHAR Flags;
+    UCHAR GsoType;
+    USHORT HeaderLength;
+    USHORT GsoSize;
+    USHORT ChecksumStart;
+    USHORT ChecksumOffset;
+    USHORT BufferCount;
+} PACKED VIRTIO_NET_HEADER, *PVIRTIO_NET_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure defines the device visible portion of a control command.
+
+Members:
+
+    Class - Stores the command class. See VIRTIO_NET_CONTROL_* definitions.
+
+    Command - Stores the command within the class.
+
+    Data - Stores the command data.
+
+    Acknowledge - Stores the status written back by the device.
+
+--*/
+
+typedef struct _VIRTIO_NET_CONTROL_COMMAND {
+    UCHAR Class;
+    UCHAR Command;
+    UCHAR Data[2];
+    UCHAR Acknowledge;
+} PACKED VIRTIO_NET_CONTROL_COMMAND, *PVIRTIO_NET_CONTROL_COMMAND;
+
+/*++
+
+Structure Description:
+
+    This structure defines a receive and transmit virtqueue pair. Each pair
+    interrupts on its own processor.
+
+Members:
+
+    Device - Stores a pointer to the device that owns the pair.
+
+    ReceiveQueue - Stores a pointer to the receive virtqueue.
+
+    TransmitQueue - Stores a pointer to the transmit virtqueue.
+
+    ReceiveLock - Stores a pointer to the queued lock serializing access to
+        the receive queue.
+
+    TransmitLock - Stores a pointer to the queued lock serializing access to
+        the transmit queue and packet list.
+
+    TransmitPacketList - Stores the list of packets waiting for transmit
+        descriptors.
+
+--*/
+
+typedef struct _VIRTIO_NET_QUEUE_PAIR {
+    PVIRTIO_NET_DEVICE Device;
+    PVIRTIO_QUEUE ReceiveQueue;
+    PVIRTIO_QUEUE TransmitQueue;
+    PQUEUED_LOCK ReceiveLock;
+    PQUEUED_LOCK TransmitLock;
+    NET_PACKET_LIST TransmitPacketList;
+} VIRTIO_NET_QUEUE_PAIR, *PVIRTIO_NET_QUEUE_PAIR;
+
+/*++
+
+Structure Description:
+
+    This structure defines the context for a virtio network device.
+
+Members:
+
+    OsDevice - Stores a pointer to the OS device.
+
+    Virtio - Stores a pointer to the virtio transport device.
+
+    NetworkLink - Stores a pointer to the core networking link.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_NET_FLAG_* definitions.
+
+    MacAddress - Stores the ethernet address of the device.
+
+    LinkActive - Stores a boolean indicating whether the link is up.
+
+    SupportedCapabilities - Stores the set of capabilities that this device
+        supports. See NET_LINK_CAPABILITY_* for definitions.
+
+    EnabledCapabilities - Stores the currently enabled capabilities on the
+        devices. See NET_LINK_CAPABILITY_* for definitions.
+
+    ConfigurationLock - Stores a queued lock that synchronizes changes to the
+        enabled capabilities field and the control queue.
+
+    PairCount - Stores the number of queue pairs in use.
+
+    Pairs - Stores the array of queue pairs.
+
+    ControlQueue - Stores a pointer to the control virtqueue, if present.
+
+    ControlIoBuffer - Stores the I/O buffer holding the control command.
+
+    ControlCommand - Stores a pointer to the control command memory.
+
+--*/
+
+struct _VIRTIO_NET_DEVICE {
+    PDEVICE OsDevice;
+    PVIRTIO_DEVICE Virtio;
+    PNET_LINK NetworkLink;
+    ULONG Flags;
+    BYTE MacAddress[ETHERNET_ADDRESS_SIZE];
+    BOOL LinkActive;
+    ULONG SupportedCapabilities;
+    ULONG EnabledCapabilities;
+    PQUEUED_LOCK ConfigurationLock;
+    ULONG PairCount;
+    PVIRTIO_NET_QUEUE_PAIR Pairs;
+    PVIRTIO_QUEUE ControlQueue;
+    PIO_BUFFER ControlIoBuffer;
+    volatile VIRTIO_NET_CONTROL_COMMAND *ControlCommand;
+};
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+extern PDRIVER VirtioNetDriver;
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+KSTATUS
+VirtnetSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sends data through the network.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link down which this data is to be sent.
+
+    PacketList - Supplies a pointer to a list of network packets to send. Data
+        in these packets may be modified by this routine, but must not be used
+        once this routine returns.
+
+Return Value:
+
+    STATUS_SUCCESS if all packets were sent.
+
+    STATUS_RESOURCE_IN_USE if some or all of the packets were dropped due to
+    the hardware being backed up with too many packets to send.
+
+    Other failure codes indicate that none of the packets were sent.
+
+--*/
+
+KSTATUS
+VirtnetGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the network device layer's link information.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link for which information is being set or queried.
+
+    InformationType - Supplies the type of information being queried or set.
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the data
+        buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or a
+        set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+VirtnetpInitializeDevice (
+    PVIRTIO_NET_DEVICE Device
+    );
+
+/*++
+
+Routine Description:
+
+    This routine negotiates features with a started virtio network device,
+    reads its address, and creates its queues.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+VirtnetpStartNetwork (
+    PVIRTIO_NET_DEVICE Device
+    );
+
+/*++
+
+Routine Description:
+
+    This routine fills the receive queues, makes the device live, and reports
+    the initial link state. The network link must already be added.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VOID
+VirtnetpConfigurationChange (
+    PVIRTIO_DEVICE Virtio,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called when the device configuration changes, and
+    updates the link state.
+
+Arguments:
+
+    Virtio - Supplies a pointer to the virtio device.
+
+    Context - Supplies the network device context.
+
+Return Value:
+
+    None.
+
+--*/
+
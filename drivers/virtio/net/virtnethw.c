@@ -0,0 +1,1397 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtnethw.c
+
+Abstract:
+
+    This module implements the queue handling portion of the virtio network
+    driver.
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include <minoca/net/netdrv.h>
+#include <minoca/net/ip4.h>
+#include <minoca/net/ip6.h>
+#include "virtnet.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Assume a fast link, as virtio does not report a speed unless asked.
+//
+
+#define VIRTIO_NET_LINK_SPEED (NET_SPEED_1000_MBPS * 10)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+VirtnetpInitializeQueuePair (
+    PVIRTIO_NET_DEVICE Device,
+    ULONG Index
+    );
+
+KSTATUS
+VirtnetpInitializeControlQueue (
+    PVIRTIO_NET_DEVICE Device,
+    ULONG Index
+    );
+
+KSTATUS
+VirtnetpFillReceiveQueue (
+    PVIRTIO_NET_DEVICE Device,
+    PVIRTIO_NET_QUEUE_PAIR Pair
+    );
+
+VOID
+VirtnetpServiceReceiveQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    );
+
+VOID
+VirtnetpServiceTransmitQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    );
+
+VOID
+VirtnetpSendPendingPackets (
+    PVIRTIO_NET_QUEUE_PAIR Pair
+    );
+
+VOID
+VirtnetpPrepareTransmitHeader (
+    PVIRTIO_NET_DEVICE Device,
+    PNET_PACKET_BUFFER Packet
+    );
+
+KSTATUS
+VirtnetpSendControlCommand (
+    PVIRTIO_NET_DEVICE Device,
+    UCHAR Class,
+    UCHAR Command,
+    PVOID Data,
+    ULONG DataSize
+    );
+
+KSTATUS
+VirtnetpUpdateFilterMode (
+    PVIRTIO_NET_DEVICE Device
+    );
+
+VOID
+VirtnetpCheckLink (
+    PVIRTIO_NET_DEVICE Device
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+VirtnetSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends data through the network.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link down which this data is to be sent.
+
+    PacketList - Supplies a pointer to a list of network packets to send. Data
+        in these packets may be modified by this routine, but must not be used
+        once this routine returns.
+
+Return Value:
+
+    STATUS_SUCCESS if all packets were sent.
+
+    STATUS_RESOURCE_IN_USE if some or all of the packets were dropped due to
+    the hardware being backed up with too many packets to send.
+
+    Other failure codes indicate that none of the packets were sent.
+
+--*/
+
+{
+
+    PVIRTIO_NET_DEVICE Device;
+    PVIRTIO_NET_QUEUE_PAIR Pair;
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Device = (PVIRTIO_NET_DEVICE)DeviceContext;
+    if (Device->LinkActive == FALSE) {
+        return STATUS_NO_NETWORK_CONNECTION;
+    }
+
+    //
+    // Send on the current processor's queue pair. The thread may migrate
+    // after this, which costs only locality, as the lock protects the pair.
+    //
+
+    Pair = &(Device->Pairs[KeGetCurrentProcessorNumber() % Device->PairCount]);
+    KeAcquireQueuedLock(Pair->TransmitLock);
+
+    //
+    // If there is any room in the packet list, add all of the packets to the
+    // list waiting to be sent.
+    //
+
+    if (Pair->TransmitPacketList.Count <
+        VIRTIO_NET_MAX_TRANSMIT_PACKET_LIST_COUNT) {
+
+        NET_APPEND_PACKET_LIST(PacketList, &(Pair->TransmitPacketList));
+        VirtnetpSendPendingPackets(Pair);
+        Status = STATUS_SUCCESS;
+
+    //
+    // Otherwise report that the resource is use as it is too busy to handle
+    // more packets.
+    //
+
+    } else {
+        Status = STATUS_RESOURCE_IN_USE;
+    }
+
+    KeReleaseQueuedLock(Pair->TransmitLock);
+    return Status;
+}
+
+KSTATUS
+VirtnetGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the network device layer's link information.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link for which information is being set or queried.
+
+    InformationType - Supplies the type of information being queried or set.
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the data
+        buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or a
+        set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PULONG BooleanOption;
+    ULONG Capabilities;
+    ULONG Capability;
+    PVIRTIO_NET_DEVICE Device;
+    PULONG Flags;
+    ULONG OldCapabilities;
+    KSTATUS Status;
+
+    Device = (PVIRTIO_NET_DEVICE)DeviceContext;
+    switch (InformationType) {
+    case NetLinkInformationChecksumOffload:
+        if (*DataSize != sizeof(ULONG)) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        if (Set != FALSE) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Flags = (PULONG)Data;
+        *Flags = Device->EnabledCapabilities &
+                 NET_LINK_CAPABILITY_CHECKSUM_MASK;
+
+        Status = STATUS_SUCCESS;
+        break;
+
+    case NetLinkInformationMulticastAll:
+    case NetLinkInformationPromiscuousMode:
+        if (*DataSize != sizeof(ULONG)) {
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Capability = NET_LINK_CAPABILITY_PROMISCUOUS_MODE;
+        if (InformationType == NetLinkInformationMulticastAll) {
+            Capability = NET_LINK_CAPABILITY_MULTICAST_ALL;
+        }
+
+        Status = STATUS_SUCCESS;
+        BooleanOption = (PULONG)Data;
+        if (Set == FALSE) {
+            if ((Device->EnabledCapabilities & Capability) != 0) {
+                *BooleanOption = TRUE;
+
+            } else {
+                *BooleanOption = FALSE;
+            }
+
+            break;
+        }
+
+        //
+        // Fail if the capability is not supported.
+        //
+
+        if ((Device->SupportedCapabilities & Capability) == 0) {
+            Status = STATUS_NOT_SUPPORTED;
+            break;
+        }
+
+        KeAcquireQueuedLock(Device->ConfigurationLock);
+        OldCapabilities = Device->EnabledCapabilities;
+        Capabilities = OldCapabilities;
+        if (*BooleanOption != FALSE) {
+            Capabilities |= Capability;
+
+        } else {
+            Capabilities &= ~Capability;
+        }
+
+        if ((Capabilities ^ OldCapabilities) != 0) {
+            Device->EnabledCapabilities = Capabilities;
+            Status = VirtnetpUpdateFilterMode(Device);
+            if (!KSUCCESS(Status)) {
+                Device->EnabledCapabilities = OldCapabilities;
+            }
+        }
+
+        KeReleaseQueuedLock(Device->ConfigurationLock);
+        break;
+
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+    return Status;
+}
+
+KSTATUS
+VirtnetpInitializeDevice (
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine negotiates features with a started virtio network device,
+    reads its address, and creates its queues.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Index;
+    USHORT MaxPairs;
+    ULONG Size;
+    KSTATUS Status;
+    PVIRTIO_DEVICE Virtio;
+
+    Virtio = Device->Virtio;
+    Status = VirtioNegotiateFeatures(Virtio, VIRTIO_NET_DRIVER_FEATURES);
+    if (!KSUCCESS(Status)) {
+        goto InitializeDeviceEnd;
+    }
+
+    //
+    // Use the device's address if it has one, or make one up.
+    //
+
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_MAC)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_NET_CONFIG_MAC,
+                                               ETHERNET_ADDRESS_SIZE,
+                                               Device->MacAddress);
+
+        if (!KSUCCESS(Status)) {
+            goto InitializeDeviceEnd;
+        }
+    }
+
+    if (NetIsEthernetAddressValid(Device->MacAddress) == FALSE) {
+        NetCreateEthernetAddress(Device->MacAddress);
+    }
+
+    //
+    // Use a queue pair per processor, up to what the device and the interrupt
+    // vectors allow. The control queue follows the last pair the device
+    // offers, not the last one in use.
+    //
+
+    MaxPairs = 1;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_MULTIQUEUE)) {
+        Status = VirtioReadDeviceConfiguration(Virtio,
+                                               VIRTIO_NET_CONFIG_QUEUE_PAIRS,
+                                               sizeof(USHORT),
+                                               &MaxPairs);
+
+        if (!KSUCCESS(Status)) {
+            goto InitializeDeviceEnd;
+        }
+
+        if (MaxPairs == 0) {
+            MaxPairs = 1;
+        }
+    }
+
+    Device->PairCount = MaxPairs;
+    if (Device->PairCount > KeGetActiveProcessorCount()) {
+        Device->PairCount = KeGetActiveProcessorCount();
+    }
+
+    if (Device->PairCount > VirtioGetInterruptGroupCount(Virtio)) {
+        Device->PairCount = VirtioGetInterruptGroupCount(Virtio);
+    }
+
+    if (Device->PairCount > VIRTIO_NET_MAX_QUEUE_PAIRS) {
+        Device->PairCount = VIRTIO_NET_MAX_QUEUE_PAIRS;
+    }
+
+    if (Device->PairCount * 2 > Virtio->QueueCount) {
+        Device->PairCount = Virtio->QueueCount / 2;
+    }
+
+    if (Device->PairCount == 0) {
+        Status = STATUS_NOT_SUPPORTED;
+        goto InitializeDeviceEnd;
+    }
+
+    Size = sizeof(VIRTIO_NET_QUEUE_PAIR) * Device->PairCount;
+    Device->Pairs = MmAllocateNonPagedPool(Size, VIRTIO_NET_ALLOCATION_TAG);
+    if (Device->Pairs == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeDeviceEnd;
+    }
+
+    RtlZeroMemory(Device->Pairs, Size);
+    for (Index = 0; Index < Device->PairCount; Index += 1) {
+        Status = VirtnetpInitializeQueuePair(Device, Index);
+        if (!KSUCCESS(Status)) {
+            goto InitializeDeviceEnd;
+        }
+    }
+
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_CONTROL)) {
+        Status = VirtnetpInitializeControlQueue(Device, MaxPairs * 2);
+        if (!KSUCCESS(Status)) {
+            goto InitializeDeviceEnd;
+        }
+    }
+
+    //
+    // Figure out the offloads. The transmit side only handles TCP and UDP;
+    // IPv4 header checksums stay in software. Received packets are marked
+    // valid per packet, which covers both TCP and UDP.
+    //
+
+    Device->SupportedCapabilities = 0;
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_CSUM)) {
+        Device->SupportedCapabilities |=
+                            NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD |
+                            NET_LINK_CAPABILITY_TRANSMIT_UDP_CHECKSUM_OFFLOAD;
+    }
+
+    if (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_GUEST_CSUM)) {
+        Device->SupportedCapabilities |=
+                             NET_LINK_CAPABILITY_RECEIVE_TCP_CHECKSUM_OFFLOAD |
+                             NET_LINK_CAPABILITY_RECEIVE_UDP_CHECKSUM_OFFLOAD;
+    }
+
+    if ((Device->ControlQueue != NULL) &&
+        (VIRTIO_HAS_FEATURE(Virtio, VIRTIO_NET_FEATURE_CONTROL_RX))) {
+
+        Device->SupportedCapabilities |= NET_LINK_CAPABILITY_PROMISCUOUS_MODE |
+                                         NET_LINK_CAPABILITY_MULTICAST_ALL;
+    }
+
+    Device->EnabledCapabilities = Device->SupportedCapabilities &
+                                  NET_LINK_CAPABILITY_CHECKSUM_MASK;
+
+    Status = STATUS_SUCCESS;
+
+InitializeDeviceEnd:
+    return Status;
+}
+
+KSTATUS
+VirtnetpStartNetwork (
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills the receive queues, makes the device live, and reports
+    the initial link state. The network link must already be added.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Index;
+    USHORT PairCount;
+    KSTATUS Status;
+
+    ASSERT(Device->NetworkLink != NULL);
+
+    for (Index = 0; Index < Device->PairCount; Index += 1) {
+        Status = VirtnetpFillReceiveQueue(Device, &(Device->Pairs[Index]));
+        if (!KSUCCESS(Status)) {
+            goto StartNetworkEnd;
+        }
+    }
+
+    VirtioSetDriverReady(Device->Virtio);
+
+    //
+    // The device only uses the first pair until told otherwise.
+    //
+
+    if ((Device->PairCount > 1) && (Device->ControlQueue != NULL)) {
+        PairCount = Device->PairCount;
+        KeAcquireQueuedLock(Device->ConfigurationLock);
+        Status = VirtnetpSendControlCommand(
+                                       Device,
+                                       VIRTIO_NET_CONTROL_MULTIQUEUE,
+                                       VIRTIO_NET_CONTROL_MULTIQUEUE_PAIRS_SET,
+                                       &PairCount,
+                                       sizeof(USHORT));
+
+        KeReleaseQueuedLock(Device->ConfigurationLock);
+        if (!KSUCCESS(Status)) {
+            RtlDebugPrint("VirtioNet: Failed to enable %d queues: %d\n",
+                          Device->PairCount,
+                          Status);
+
+            Device->PairCount = 1;
+        }
+    }
+
+    VirtnetpCheckLink(Device);
+    Status = STATUS_SUCCESS;
+
+StartNetworkEnd:
+    return Status;
+}
+
+VOID
+VirtnetpConfigurationChange (
+    PVIRTIO_DEVICE Virtio,
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when the device configuration changes, and
+    updates the link state.
+
+Arguments:
+
+    Virtio - Supplies a pointer to the virtio device.
+
+    Context - Supplies the network device context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_NET_DEVICE Device;
+
+    Device = Context;
+    if (Device->NetworkLink != NULL) {
+        VirtnetpCheckLink(Device);
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+VirtnetpInitializeQueuePair (
+    PVIRTIO_NET_DEVICE Device,
+    ULONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the receive and transmit queues of a queue pair.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+    Index - Supplies the index of the queue pair.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PVIRTIO_NET_QUEUE_PAIR Pair;
+    KSTATUS Status;
+
+    Pair = &(Device->Pairs[Index]);
+    Pair->Device = Device;
+    NET_INITIALIZE_PACKET_LIST(&(Pair->TransmitPacketList));
+    Pair->ReceiveLock = KeCreateQueuedLock();
+    Pair->TransmitLock = KeCreateQueuedLock();
+    if ((Pair->ReceiveLock == NULL) || (Pair->TransmitLock == NULL)) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeQueuePairEnd;
+    }
+
+    //
+    // Both queues of pair N share interrupt group N, so a flow's receive
+    // processing and transmit completions happen on the same processor.
+    //
+
+    Status = VirtioCreateQueue(Device->Virtio,
+                               VIRTIO_NET_RECEIVE_QUEUE_INDEX(Index),
+                               0,
+                               Index,
+                               VirtnetpServiceReceiveQueue,
+                               Pair,
+                               &(Pair->ReceiveQueue));
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeQueuePairEnd;
+    }
+
+    Status = VirtioCreateQueue(Device->Virtio,
+                               VIRTIO_NET_TRANSMIT_QUEUE_INDEX(Index),
+                               0,
+                               Index,
+                               VirtnetpServiceTransmitQueue,
+                               Pair,
+                               &(Pair->TransmitQueue));
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeQueuePairEnd;
+    }
+
+    //
+    // Transmit completions are reaped on the next send. Interrupts are only
+    // wanted when packets are stuck waiting for descriptors.
+    //
+
+    VirtioQueueDisableNotifications(Pair->TransmitQueue);
+
+InitializeQueuePairEnd:
+    return Status;
+}
+
+KSTATUS
+VirtnetpInitializeControlQueue (
+    PVIRTIO_NET_DEVICE Device,
+    ULONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the polled control queue and its command memory.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+    Index - Supplies the virtqueue index of the control queue.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    Status = VirtioCreateQueue(Device->Virtio,
+                               Index,
+                               0,
+                               0,
+                               NULL,
+                               NULL,
+                               &(Device->ControlQueue));
+
+    if (!KSUCCESS(Status)) {
+        goto InitializeControlQueueEnd;
+    }
+
+    VirtioQueueDisableNotifications(Device->ControlQueue);
+    Device->ControlIoBuffer = MmAllocateNonPagedIoBuffer(
+                                         0,
+                                         MAX_ULONGLONG,
+                                         sizeof(ULONGLONG),
+                                         sizeof(VIRTIO_NET_CONTROL_COMMAND),
+                                         IO_BUFFER_FLAG_PHYSICALLY_CONTIGUOUS);
+
+    if (Device->ControlIoBuffer == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializeControlQueueEnd;
+    }
+
+    ASSERT(Device->ControlIoBuffer->FragmentCount == 1);
+
+    Device->ControlCommand =
+                          Device->ControlIoBuffer->Fragment[0].VirtualAddress;
+
+InitializeControlQueueEnd:
+    return Status;
+}
+
+KSTATUS
+VirtnetpFillReceiveQueue (
+    PVIRTIO_NET_DEVICE Device,
+    PVIRTIO_NET_QUEUE_PAIR Pair
+    )
+
+/*++
+
+Routine Description:
+
+    This routine posts receive buffers to a pair's receive queue.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+    Pair - Supplies a pointer to the queue pair.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    VIRTIO_BUFFER Buffer;
+    ULONG Count;
+    ULONG Index;
+    PNET_PACKET_BUFFER Packet;
+    KSTATUS Status;
+
+    Count = Pair->ReceiveQueue->Size;
+    if (Count > VIRTIO_NET_MAX_RECEIVE_BUFFERS) {
+        Count = VIRTIO_NET_MAX_RECEIVE_BUFFERS;
+    }
+
+    Status = STATUS_SUCCESS;
+    KeAcquireQueuedLock(Pair->ReceiveLock);
+    for (Index = 0; Index < Count; Index += 1) {
+        Status = NetAllocateBuffer(0,
+                                   VIRTIO_NET_RECEIVE_BUFFER_SIZE,
+                                   0,
+                                   Device->NetworkLink,
+                                   0,
+                                   &Packet);
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Buffer.Address = Packet->BufferPhysicalAddress;
+        Buffer.Length = VIRTIO_NET_RECEIVE_BUFFER_SIZE;
+        Status = VirtioQueueAdd(Pair->ReceiveQueue, &Buffer, 0, 1, Packet);
+        if (!KSUCCESS(Status)) {
+            NetFreeBuffer(Packet);
+            break;
+        }
+    }
+
+    VirtioQueueKick(Pair->ReceiveQueue);
+    KeReleaseQueuedLock(Pair->ReceiveLock);
+    return Status;
+}
+
+VOID
+VirtnetpServiceReceiveQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes any received frames from the network and hands
+    their buffers back to the device.
+
+Arguments:
+
+    Queue - Supplies a pointer to the receive queue.
+
+    Context - Supplies a pointer to the queue pair.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    VIRTIO_BUFFER Buffer;
+    PVIRTIO_NET_DEVICE Device;
+    ULONG Flags;
+    PVIRTIO_NET_HEADER Header;
+    ULONG Length;
+    PNET_PACKET_BUFFER Packet;
+    PVIRTIO_NET_QUEUE_PAIR Pair;
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Pair = Context;
+    Device = Pair->Device;
+    KeAcquireQueuedLock(Pair->ReceiveLock);
+    do {
+        VirtioQueueDisableNotifications(Queue);
+        while (TRUE) {
+            Packet = VirtioQueueGetUsed(Queue, &Length);
+            if (Packet == NULL) {
+                break;
+            }
+
+            if (Length > sizeof(VIRTIO_NET_HEADER)) {
+                Header = Packet->Buffer;
+                Flags = 0;
+                if (((Header->Flags & VIRTIO_NET_HEADER_DATA_VALID) != 0) &&
+                    ((Device->EnabledCapabilities &
+                      NET_LINK_CAPABILITY_CHECKSUM_RECEIVE_MASK) != 0)) {
+
+                    Flags |= NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD |
+                             NET_PACKET_FLAG_UDP_CHECKSUM_OFFLOAD;
+                }
+
+                Packet->DataSize = Length;
+                Packet->DataOffset = sizeof(VIRTIO_NET_HEADER);
+                Packet->FooterOffset = Packet->DataSize;
+                Packet->Flags = Flags;
+                NetProcessReceivedPacket(Device->NetworkLink, Packet);
+            }
+
+            //
+            // Give the buffer straight back to the device. There is always
+            // room, since the buffer just came out of the queue.
+            //
+
+            Buffer.Address = Packet->BufferPhysicalAddress;
+            Buffer.Length = VIRTIO_NET_RECEIVE_BUFFER_SIZE;
+            Status = VirtioQueueAdd(Queue, &Buffer, 0, 1, Packet);
+
+            ASSERT(KSUCCESS(Status));
+        }
+
+    } while (VirtioQueueEnableNotifications(Queue) != FALSE);
+
+    VirtioQueueKick(Queue);
+    KeReleaseQueuedLock(Pair->ReceiveLock);
+    return;
+}
+
+VOID
+VirtnetpServiceTransmitQueue (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when the transmit queue frees up descriptors that
+    packets were waiting on.
+
+Arguments:
+
+    Queue - Supplies a pointer to the transmit queue.
+
+    Context - Supplies a pointer to the queue pair.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVIRTIO_NET_QUEUE_PAIR Pair;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Pair = Context;
+    KeAcquireQueuedLock(Pair->TransmitLock);
+    VirtnetpSendPendingPackets(Pair);
+    KeReleaseQueuedLock(Pair->TransmitLock);
+    return;
+}
+
+VOID
+VirtnetpSendPendingPackets (
+    PVIRTIO_NET_QUEUE_PAIR Pair
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees completed transmit packets and moves as many pending
+    packets as fit onto the transmit queue. This routine assumes the pair's
+    transmit lock is held.
+
+Arguments:
+
+    Pair - Supplies a pointer to the queue pair.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL Added;
+    VIRTIO_BUFFER Buffer;
+    PVIRTIO_NET_DEVICE Device;
+    ULONG Length;
+    PNET_PACKET_BUFFER Packet;
+    PVIRTIO_QUEUE Queue;
+    KSTATUS Status;
+
+    Device = Pair->Device;
+    Queue = Pair->TransmitQueue;
+    Added = FALSE;
+    while (TRUE) {
+
+        //
+        // Reap whatever the device has finished sending.
+        //
+
+        while (TRUE) {
+            Packet = VirtioQueueGetUsed(Queue, &Length);
+            if (Packet == NULL) {
+                break;
+            }
+
+            NetFreeBuffer(Packet);
+        }
+
+        while ((NET_PACKET_LIST_EMPTY(&(Pair->TransmitPacketList)) == FALSE) &&
+               (VirtioQueueGetFreeCount(Queue) != 0)) {
+
+            Packet = LIST_VALUE(Pair->TransmitPacketList.Head.Next,
+                                NET_PACKET_BUFFER,
+                                ListEntry);
+
+            VirtnetpPrepareTransmitHeader(Device, Packet);
+            Buffer.Address = Packet->BufferPhysicalAddress + Packet->DataOffset;
+            Buffer.Length = Packet->FooterOffset - Packet->DataOffset;
+            Status = VirtioQueueAdd(Queue, &Buffer, 1, 0, Packet);
+            if (!KSUCCESS(Status)) {
+                break;
+            }
+
+            NET_REMOVE_PACKET_FROM_LIST(Packet, &(Pair->TransmitPacketList));
+            Added = TRUE;
+        }
+
+        //
+        // Only ask for an interrupt if packets are left waiting on the ring.
+        // If descriptors came free in the meantime, go around again.
+        //
+
+        if (NET_PACKET_LIST_EMPTY(&(Pair->TransmitPacketList)) != FALSE) {
+            VirtioQueueDisableNotifications(Queue);
+            break;
+        }
+
+        if (VirtioQueueEnableNotifications(Queue) == FALSE) {
+            break;
+        }
+    }
+
+    if (Added != FALSE) {
+        VirtioQueueKick(Queue);
+    }
+
+    return;
+}
+
+VOID
+VirtnetpPrepareTransmitHeader (
+    PVIRTIO_NET_DEVICE Device,
+    PNET_PACKET_BUFFER Packet
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills in the virtio header in front of an outgoing frame. If
+    the networking core left a TCP or UDP checksum to the link, the header
+    asks the device to compute it, and the checksum field is seeded with the
+    pseudo-header sum as the device expects.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+    Packet - Supplies a pointer to the packet. On return, its data offset
+        points at the virtio header.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PUCHAR Frame;
+    ULONG FrameLength;
+    PVIRTIO_NET_HEADER Header;
+    ULONG HeaderLength;
+    PIP4_HEADER Ip4Header;
+    PIP6_HEADER Ip6Header;
+    ULONG PacketFlags;
+    UCHAR Protocol;
+    PUSHORT SourceWords;
+    ULONG Sum;
+    PUSHORT TransportChecksum;
+    ULONG TransportLength;
+    ULONG TransportOffset;
+    USHORT Type;
+    ULONG WordCount;
+    ULONG WordIndex;
+
+    ASSERT(Packet->DataOffset >= sizeof(VIRTIO_NET_HEADER));
+
+    Frame = Packet->Buffer + Packet->DataOffset;
+    FrameLength = Packet->FooterOffset - Packet->DataOffset;
+    Packet->DataOffset -= sizeof(VIRTIO_NET_HEADER);
+    Header = Packet->Buffer + Packet->DataOffset;
+    RtlZeroMemory(Header, sizeof(VIRTIO_NET_HEADER));
+    PacketFlags = Packet->Flags & (NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD |
+                                   NET_PACKET_FLAG_UDP_CHECKSUM_OFFLOAD);
+
+    if (PacketFlags == 0) {
+        return;
+    }
+
+    if (FrameLength < VIRTIO_NET_ETHERNET_HEADER_SIZE) {
+        goto PrepareTransmitHeaderEnd;
+    }
+
+    //
+    // Sum the pseudo-header words in network order. The one's complement sum
+    // comes out right regardless of the processor's byte order.
+    //
+
+    Type = *((PUSHORT)(Frame + VIRTIO_NET_ETHERNET_TYPE_OFFSET));
+    TransportOffset = VIRTIO_NET_ETHERNET_HEADER_SIZE;
+    if (Type == CPU_TO_NETWORK16(IP4_PROTOCOL_NUMBER)) {
+        if (FrameLength < TransportOffset + sizeof(IP4_HEADER)) {
+            goto PrepareTransmitHeaderEnd;
+        }
+
+        Ip4Header = (PIP4_HEADER)(Frame + TransportOffset);
+        HeaderLength = (Ip4Header->VersionAndHeaderLength &
+                        IP4_HEADER_LENGTH_MASK) * sizeof(ULONG);
+
+        Protocol = Ip4Header->Protocol;
+        TransportLength = NETWORK_TO_CPU16(Ip4Header->TotalLength) -
+                          HeaderLength;
+
+        SourceWords = (PUSHORT)((PUCHAR)Ip4Header +
+                                FIELD_OFFSET(IP4_HEADER, SourceAddress));
+
+        WordCount = (sizeof(ULONG) * 2) / sizeof(USHORT);
+
+    } else if (Type == CPU_TO_NETWORK16(IP6_PROTOCOL_NUMBER)) {
+        if (FrameLength < TransportOffset + sizeof(IP6_HEADER)) {
+            goto PrepareTransmitHeaderEnd;
+        }
+
+        //
+        // TCP and UDP are never sent behind IPv6 extension headers, so the
+        // transport header directly follows the fixed header.
+        //
+
+        Ip6Header = (PIP6_HEADER)(Frame + TransportOffset);
+        HeaderLength = sizeof(IP6_HEADER);
+        Protocol = Ip6Header->NextHeader;
+        TransportLength = NETWORK_TO_CPU16(Ip6Header->PayloadLength);
+        SourceWords = (PUSHORT)(Ip6Header->SourceAddress);
+        WordCount = (IP6_ADDRESS_SIZE * 2) / sizeof(USHORT);
+
+    } else {
+        goto PrepareTransmitHeaderEnd;
+    }
+
+    TransportOffset += HeaderLength;
+    if (Protocol == VIRTIO_NET_IP_PROTOCOL_TCP) {
+        Header->ChecksumOffset = VIRTIO_NET_TCP_CHECKSUM_OFFSET;
+
+    } else if (Protocol == VIRTIO_NET_IP_PROTOCOL_UDP) {
+        Header->ChecksumOffset = VIRTIO_NET_UDP_CHECKSUM_OFFSET;
+
+    } else {
+        goto PrepareTransmitHeaderEnd;
+    }
+
+    if (TransportOffset + Header->ChecksumOffset + sizeof(USHORT) >
+        FrameLength) {
+
+        goto PrepareTransmitHeaderEnd;
+    }
+
+    Sum = CPU_TO_NETWORK16(Protocol) + CPU_TO_NETWORK16(TransportLength);
+    for (WordIndex = 0; WordIndex < WordCount; WordIndex += 1) {
+        Sum += SourceWords[WordIndex];
+    }
+
+    while ((Sum >> 16) != 0) {
+        Sum = (Sum & 0xFFFF) + (Sum >> 16);
+    }
+
+    TransportChecksum = (PUSHORT)(Frame + TransportOffset +
+                                  Header->ChecksumOffset);
+
+    *TransportChecksum = (USHORT)Sum;
+    Header->Flags = VIRTIO_NET_HEADER_NEEDS_CSUM;
+    Header->ChecksumStart = TransportOffset;
+    return;
+
+PrepareTransmitHeaderEnd:
+
+    //
+    // The networking core only offloads checksums of TCP and UDP over IP, so
+    // a frame that cannot be parsed here is a bug upstream.
+    //
+
+    ASSERT(FALSE);
+
+    RtlDebugPrint("VirtioNet: Cannot offload checksum, type 0x%x\n",
+                  NETWORK_TO_CPU16(Type));
+
+    return;
+}
+
+KSTATUS
+VirtnetpSendControlCommand (
+    PVIRTIO_NET_DEVICE Device,
+    UCHAR Class,
+    UCHAR Command,
+    PVOID Data,
+    ULONG DataSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends a command on the control queue and polls for its
+    completion. This routine assumes the configuration lock is held.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+    Class - Supplies the command class.
+
+    Command - Supplies the command within the class.
+
+    Data - Supplies a pointer to the command data.
+
+    DataSize - Supplies the size of the command data in bytes.
+
+Return Value:
+
+    STATUS_SUCCESS if the device accepted the command.
+
+    STATUS_NOT_SUPPORTED if the device has no control queue.
+
+    STATUS_UNSUCCESSFUL if the device rejected the command.
+
+    STATUS_TIMEOUT if the device did not answer.
+
+--*/
+
+{
+
+    VIRTIO_BUFFER Buffers[2];
+    volatile VIRTIO_NET_CONTROL_COMMAND *ControlCommand;
+    ULONG Length;
+    PHYSICAL_ADDRESS PhysicalAddress;
+    KSTATUS Status;
+    ULONGLONG Timeout;
+
+    ASSERT(KeIsQueuedLockHeld(Device->ConfigurationLock) != FALSE);
+    ASSERT(DataSize <= sizeof(Device->ControlCommand->Data));
+
+    if (Device->ControlQueue == NULL) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    ControlCommand = Device->ControlCommand;
+    ControlCommand->Class = Class;
+    ControlCommand->Command = Command;
+    RtlCopyMemory((PVOID)(ControlCommand->Data), Data, DataSize);
+    ControlCommand->Acknowledge = VIRTIO_NET_CONTROL_ERROR;
+    PhysicalAddress = Device->ControlIoBuffer->Fragment[0].PhysicalAddress;
+    Buffers[0].Address = PhysicalAddress;
+    Buffers[0].Length = FIELD_OFFSET(VIRTIO_NET_CONTROL_COMMAND, Data) +
+                        DataSize;
+
+    Buffers[1].Address = PhysicalAddress +
+                         FIELD_OFFSET(VIRTIO_NET_CONTROL_COMMAND, Acknowledge);
+
+    Buffers[1].Length = sizeof(UCHAR);
+    Status = VirtioQueueAdd(Device->ControlQueue, Buffers, 1, 1, Device);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    VirtioQueueKick(Device->ControlQueue);
+    Timeout = HlQueryTimeCounter() +
+              ((HlQueryTimeCounterFrequency() *
+                VIRTIO_NET_CONTROL_TIMEOUT_MS) / MILLISECONDS_PER_SECOND);
+
+    Status = STATUS_TIMEOUT;
+    do {
+        if (VirtioQueueGetUsed(Device->ControlQueue, &Length) != NULL) {
+            Status = STATUS_SUCCESS;
+            if (ControlCommand->Acknowledge != VIRTIO_NET_CONTROL_OK) {
+                Status = STATUS_UNSUCCESSFUL;
+            }
+
+            break;
+        }
+
+        KeYield();
+
+    } while (HlQueryTimeCounter() <= Timeout);
+
+    return Status;
+}
+
+KSTATUS
+VirtnetpUpdateFilterMode (
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine updates the device's receive filter to match the enabled
+    capabilities. This routine assumes the configuration lock is held.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UCHAR Enable;
+    KSTATUS Status;
+
+    Enable = FALSE;
+    if ((Device->EnabledCapabilities &
+         NET_LINK_CAPABILITY_PROMISCUOUS_MODE) != 0) {
+
+        Enable = TRUE;
+    }
+
+    Status = VirtnetpSendControlCommand(Device,
+                                        VIRTIO_NET_CONTROL_RX,
+                                        VIRTIO_NET_CONTROL_RX_PROMISCUOUS,
+                                        &Enable,
+                                        sizeof(UCHAR));
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Enable = FALSE;
+    if ((Device->EnabledCapabilities &
+         NET_LINK_CAPABILITY_MULTICAST_ALL) != 0) {
+
+        Enable = TRUE;
+    }
+
+    Status = VirtnetpSendControlCommand(Device,
+                                        VIRTIO_NET_CONTROL_RX,
+                                        VIRTIO_NET_CONTROL_RX_ALL_MULTICAST,
+                                        &Enable,
+                                        sizeof(UCHAR));
+
+    return Status;
+}
+
+VOID
+VirtnetpCheckLink (
+    PVIRTIO_NET_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads the link status from the device configuration and
+    reports any change to the networking core.
+
+Arguments:
+
+    Device - Supplies a pointer to the device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL LinkActive;
+    USHORT LinkStatus;
+    KSTATUS Status;
+
+    LinkStatus = VIRTIO_NET_STATUS_LINK_UP;
+    if (VIRTIO_HAS_FEATURE(Device->Virtio, VIRTIO_NET_FEATURE_STATUS)) {
+        Status = VirtioReadDeviceConfiguration(Device->Virtio,
+                                               VIRTIO_NET_CONFIG_STATUS,
+                                               sizeof(USHORT),
+                                               &LinkStatus);
+
+        if (!KSUCCESS(Status)) {
+            return;
+        }
+    }
+
+    LinkActive = FALSE;
+    if ((LinkStatus & VIRTIO_NET_STATUS_LINK_UP) != 0) {
+        LinkActive = TRUE;
+    }
+
+    if (LinkActive == Device->LinkActive) {
+        return;
+    }
+
+    Device->LinkActive = LinkActive;
+    if (LinkActive != FALSE) {
+        NetSetLinkState(Device->NetworkLink, TRUE, VIRTIO_NET_LINK_SPEED);
+
+    } else {
+        NetSetLinkState(Device->NetworkLink, FALSE, 0);
+    }
+
+    return;
+}
+
@@ -78,6 +78,15 @@ Module Name:
 
 #define NETWORK_80211_MAX_SSID_LENGTH 32
 
+//
+// Define the UUID and version for the network receive polling information.
+//
+
+#define NETWORK_POLL_INFORMATION_UUID \
+    {{0x5B3E1C27, 0x8D4A4F6E, 0x9C21A7B3, 0x40E6D58F}}
+
+#define NETWORK_POLL_INFORMATION_VERSION 0x00010000
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -162,6 +171,13 @@ typedef enum _NETWORK_ENCRYPTION_TYPE {
     NetworkEncryptionInvalid
 } NETWORK_ENCRYPTION_TYPE, *PNETWORK_ENCRYPTION_TYPE;
 
+typedef enum _NETWORK_INTERRUPT_MODERATION {
+    NetworkInterruptModerationInvalid,
+    NetworkInterruptModerationOff,
+    NetworkInterruptModerationFixed,
+    NetworkInterruptModerationAdaptive
+} NETWORK_INTERRUPT_MODERATION, *PNETWORK_INTERRUPT_MODERATION;
+
 /*++
 
 Structure Description:
@@ -212,6 +228,54 @@ typedef struct _NETWORK_80211_DEVICE_INFORMATION {
     NETWORK_ENCRYPTION_TYPE GroupEncryption;
 } NETWORK_80211_DEVICE_INFORMATION, *PNETWORK_80211_DEVICE_INFORMATION;
 
+/*++
+
+Structure Description:
+
+    This structure defines the receive polling statistics and interrupt
+    moderation settings of a network link that supports polling. Only the
+    moderation, interrupt rate and budget fields can be set.
+
+Members:
+
+    Version - Stores the table version. Future revisions will be backwards
+        compatible. Set to NETWORK_POLL_INFORMATION_VERSION.
+
+    Moderation - Stores the interrupt moderation mode.
+
+    InterruptRate - Stores the maximum number of receive interrupts per second
+        the device is allowed to generate. When setting, this is only used in
+        fixed moderation mode. Zero means unthrottled.
+
+    Budget - Stores the maximum number of packets handled in one poll before
+        the link yields to other work.
+
+    InterruptCount - Stores the number of receive interrupts taken.
+
+    PollCount - Stores the number of times the link was polled.
+
+    PacketCount - Stores the number of packets received through polling.
+
+    BudgetExhaustedCount - Stores the number of polls that used their entire
+        budget, leaving the link in polled mode.
+
+    RateChangeCount - Stores the number of times the interrupt rate was
+        changed.
+
+--*/
+
+typedef struct _NETWORK_POLL_INFORMATION {
+    ULONG Version;
+    NETWORK_INTERRUPT_MODERATION Moderation;
+    ULONG InterruptRate;
+    ULONG Budget;
+    ULONGLONG InterruptCount;
+    ULONGLONG PollCount;
+    ULONGLONG PacketCount;
+    ULONGLONG BudgetExhaustedCount;
+    ULONGLONG RateChangeCount;
+} NETWORK_POLL_INFORMATION, *PNETWORK_POLL_INFORMATION;
+
 //
 // -------------------------------------------------------------------- Globals
 //
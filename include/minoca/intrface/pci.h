@@ -461,6 +461,55 @@ Return Value:
 
 --*/
 
+typedef
+KSTATUS
+(*PMSI_ENABLE_VECTORS) (
+    PVOID DeviceToken,
+    ULONGLONG Vector,
+    ULONGLONG VectorCount,
+    PPROCESSOR_SET Processors,
+    PPCI_MSI_TYPE MsiType
+    );
+
+/*++
+
+Routine Description:
+
+    This routine programs and enables a contiguous block of message signaled
+    interrupt vectors for the given PCI device, starting at vector table index
+    zero. A single vector prefers MSI. Multiple vectors prefer MSI-X, as only
+    MSI-X allows each vector to be steered at a different processor. If
+    MSI-X is not available, multiple vectors fall back to multi-message MSI,
+    where every vector targets the first processor set.
+
+Arguments:
+
+    DeviceToken - Supplies the device token supplied when the interface was
+        acquired.
+
+    Vector - Supplies the first vector of the block, as allocated to the
+        device through its interrupt vector resource.
+
+    VectorCount - Supplies the number of contiguous vectors to enable.
+
+    Processors - Supplies an optional array of processor sets, one for each
+        vector, that the vectors should target. If NULL, the vectors are
+        distributed round-robin across the active processors.
+
+    MsiType - Supplies a pointer where the type of message signaled
+        interrupts that ended up being enabled is returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the device cannot provide the requested number of
+    vectors through either MSI or MSI-X.
+
+    Other error codes on failure.
+
+--*/
+
 /*++
 
 Structure Description:
@@ -541,6 +590,10 @@ Structure Description:
     DeviceToken - Stores an oqaque token passed to the query and set functions
         that uniquely identifies the device.
 
+    EnableVectors - Stores a pointer to a function that can be used to program
+        and enable a block of vectors in one go, optionally steering each
+        vector at a particular processor.
+
 --*/
 
 typedef struct _INTERFACE_PCI_MSI {
@@ -550,6 +603,7 @@ typedef struct _INTERFACE_PCI_MSI {
     PMSI_IS_VECTOR_MASKED IsVectorMasked;
     PMSI_IS_VECTOR_PENDING IsVectorPending;
     PVOID DeviceToken;
+    PMSI_ENABLE_VECTORS EnableVectors;
 } INTERFACE_PCI_MSI, *PINTERFACE_PCI_MSI;
 
 //
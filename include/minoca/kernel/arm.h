@@ -391,6 +391,14 @@ Module Name:
 #define CPUID_PROCESSOR1_GENERIC_TIMER_MASK             0x000F0000
 #define CPUID_PROCESSOR1_GENERIC_TIMER_UNSUPPORTED      0x00000000
 
+//
+// Define instruction set attribute bits. ID_ISAR5 is only populated on
+// ARMv8 processors running in AArch32 state, and reads as zero otherwise.
+//
+
+#define CPUID_ISA5_CRC32_MASK                           0x000F0000
+#define CPUID_ISA5_CRC32_UNSUPPORTED                    0x00000000
+
 //
 // Define bits in the ARMv7 Cache Type Register (CTR).
 //
@@ -770,6 +770,43 @@ Return Value:
 
 --*/
 
+KERNEL_API
+KSTATUS
+IoCreateAndAddMessageSignaledInterruptVectors (
+    PRESOURCE_CONFIGURATION_LIST ConfigurationList,
+    ULONG VectorCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds a requirement for a contiguous block of message signaled
+    interrupt vectors to each configuration in the given list. These vectors
+    have no owning interrupt line. Every interrupt line in a configuration
+    also gets a legacy vector added as an alternative to the block, so that
+    the device can fall back to line based interrupts if the block cannot be
+    allocated.
+
+Arguments:
+
+    ConfigurationList - Supplies a pointer to the resource configuration list
+        to iterate through.
+
+    VectorCount - Supplies the number of message signaled vectors to request.
+        The block is aligned to the next power of two so that it can be used
+        for multi-message MSI as well as MSI-X.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if parameter validation failed.
+
+    STATUS_INSUFFICIENT_RESOURCES if the required memory could not be allocated.
+
+--*/
+
 KERNEL_API
 PRESOURCE_REQUIREMENT
 IoGetNextResourceRequirement (
@@ -355,6 +355,14 @@ Module Name:
 
 #define IO_FLAG_FS_METADATA 0x00000010
 
+//
+// This flag indicates that the caller is handing the pages of a write over
+// by reference rather than having them copied. It is only honored by pipes,
+// which may hold on to the pages until a reader consumes them.
+//
+
+#define IO_FLAG_GIFT 0x00000020
+
 //
 // Set this flag if the IRP needs to execute in a no-allocate code path. As a
 // result none of the data or code it touches can be pagable.
@@ -832,6 +840,14 @@ Module Name:
 
 #define PIPE_ATOMIC_WRITE_SIZE 4096
 
+//
+// Define the default capacity of a pipe, and the default limit on how large
+// an unprivileged caller can make one.
+//
+
+#define PIPE_DEFAULT_SIZE (64 * _1KB)
+#define PIPE_DEFAULT_MAX_SIZE _1MB
+
 //
 // Define I/O test hook bits.
 //
@@ -961,6 +977,8 @@ typedef enum _SEEK_COMMAND {
     SeekCommandFromBeginning,
     SeekCommandFromCurrentOffset,
     SeekCommandFromEnd,
+    SeekCommandData,
+    SeekCommandHole,
 } SEEK_COMMAND, *PSEEK_COMMAND;
 
 typedef enum _TERMINAL_CONTROL_CHARACTER {
@@ -1047,6 +1065,7 @@ typedef enum _IO_INFORMATION_TYPE {
     IoInformationBoot,
     IoInformationMountPoints,
     IoInformationCacheStatistics,
+    IoInformationPipeSizeLimit,
 } IO_INFORMATION_TYPE, *PIO_INFORMATION_TYPE;
 
 typedef enum _SHARED_MEMORY_COMMAND {
@@ -4377,6 +4396,63 @@ Return Value:
 
 --*/
 
+KERNEL_API
+KSTATUS
+IoCopyFileRange (
+    PIO_HANDLE InputHandle,
+    IO_OFFSET InputOffset,
+    PIO_HANDLE OutputHandle,
+    IO_OFFSET OutputOffset,
+    UINTN SizeInBytes,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one file or block device to another without
+    passing it through user mode. Reads from the input are satisfied with the
+    input's page cache entries directly where possible, so the data is only
+    copied once, into the output.
+
+Arguments:
+
+    InputHandle - Supplies the open I/O handle to read from.
+
+    InputOffset - Supplies the offset in the input to start reading from.
+        Supply IO_OFFSET_NONE to use and update the handle's current offset.
+
+    OutputHandle - Supplies the open I/O handle to write to.
+
+    OutputOffset - Supplies the offset in the output to start writing at.
+        Supply IO_OFFSET_NONE to use and update the handle's current offset.
+
+    SizeInBytes - Supplies the number of bytes to copy.
+
+    Flags - Supplies flags regarding the I/O operation. See IO_FLAG_*
+        definitions.
+
+    BytesCompleted - Supplies a pointer where the number of bytes copied will
+        be returned. This may be less than requested if the end of the input
+        is reached or a signal is pending.
+
+Return Value:
+
+    STATUS_SUCCESS if some bytes were copied or the input is at its end.
+
+    STATUS_NOT_SUPPORTED if either handle is not a regular file, block device,
+    or shared memory object. The caller should fall back to reading and
+    writing.
+
+    STATUS_INVALID_PARAMETER if the input and output are the same file and the
+    ranges overlap.
+
+    Other error codes on failure, in which case no bytes were copied.
+
+--*/
+
 KERNEL_API
 KSTATUS
 IoFlush (
@@ -4434,7 +4510,8 @@ Routine Description:
 
     SeekCommand - Supplies the reference point for the seek offset. Usual
         reference points are the beginning of the file, current file position,
-        and the end of the file.
+        and the end of the file. The data and hole commands seek to the next
+        data or hole at or after the given offset from the beginning.
 
     Offset - Supplies the offset from the reference point to move in bytes.
 
@@ -4443,7 +4520,8 @@ Routine Description:
 
 Return Value:
 
-    Status code.
+    Status code. STATUS_END_OF_FILE is returned for the data and hole commands
+    if the offset is at or beyond the end of the file.
 
 --*/
 
@@ -5652,6 +5730,32 @@ Return Value:
 
 --*/
 
+INTN
+IoSysCopyFileRange (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies a range of one file to another for user mode.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or the number of bytes copied (a positive integer) on
+    success.
+
+    Error status code (a negative integer) on failure.
+
+--*/
+
 INTN
 IoSysFlush (
     PVOID SystemCallParameter
@@ -7477,6 +7581,89 @@ Return Value:
 
 --*/
 
+KSTATUS
+IoGiftStreamBuffer (
+    PSTREAM_BUFFER StreamBuffer,
+    PIO_BUFFER IoBuffer,
+    UINTN ByteCount,
+    ULONG TimeoutInMilliseconds,
+    BOOL NonBlocking,
+    PUINTN BytesWritten
+    );
+
+/*++
+
+Routine Description:
+
+    This routine writes to a stream buffer by handing it the pages of the
+    given I/O buffer rather than copying them into the stream. The pages are
+    locked and readers copy directly out of them, saving a copy. This routine
+    does not return until the readers have consumed the data, an error
+    occurs, or the timeout expires. Small or non-blocking writes fall back to
+    a regular copying write. This routine must be called at low level.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer to write to.
+
+    IoBuffer - Supplies a pointer to the I/O buffer containing the data to
+        hand over to the stream buffer.
+
+    ByteCount - Supplies the number of bytes to write.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds that the I/O
+        operation should be waited on before timing out. Use
+        WAIT_TIME_INDEFINITE to wait forever on the I/O.
+
+    NonBlocking - Supplies a boolean indicating if this write should avoid
+        blocking.
+
+    BytesWritten - Supplies a pointer where the number of bytes actually
+        consumed by readers will be returned.
+
+Return Value:
+
+    Status code. If a failing status code is returned, then check the number of
+    bytes written to see if any valid data was consumed.
+
+--*/
+
+KSTATUS
+IoGetSetStreamBufferSize (
+    PSTREAM_BUFFER StreamBuffer,
+    BOOL Set,
+    PULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of a stream buffer. Resizing
+    preserves any data currently in the buffer.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    Set - Supplies a boolean indicating whether to get the size (FALSE) or
+        set it (TRUE).
+
+    Size - Supplies a pointer that on input contains the new capacity in bytes
+        for set operations. The capacity is never made smaller than the atomic
+        write size. On output, returns the current capacity.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_RESOURCE_IN_USE if the buffer currently holds more data than the
+    requested size.
+
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
 KSTATUS
 IoStreamBufferConnect (
     PSTREAM_BUFFER StreamBuffer
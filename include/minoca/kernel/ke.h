@@ -140,6 +140,35 @@ Module Name:
 
 #define X86_FEATURE_FXSAVE   0x00000008
 
+//
+// This bit is set if the processor supports SSE2 instructions and the kernel
+// preserves their registers across context switches.
+//
+
+#define X86_FEATURE_SSE2     0x00000010
+
+//
+// This bit is set if the processor supports the carry-less multiply
+// instruction (PCLMULQDQ) and the kernel preserves the SSE registers across
+// context switches.
+//
+
+#define X86_FEATURE_PCLMULQDQ 0x00000020
+
+//
+// This bit is set if the processor supports the AES instructions and SSSE3,
+// and the kernel preserves the SSE registers across context switches.
+//
+
+#define X86_FEATURE_AES       0x00000040
+
+//
+// This bit is set if the processor supports the SHA instructions, SSSE3, and
+// SSE4.1, and the kernel preserves the SSE registers across context switches.
+//
+
+#define X86_FEATURE_SHA       0x00000080
+
 //
 // This bit is set if the kernel is ARMv7.
 //
@@ -165,6 +194,12 @@ Module Name:
 
 #define ARM_FEATURE_NEON32     0x00000008
 
+//
+// This bit is set if the processor supports the ARMv8 CRC32 instructions.
+//
+
+#define ARM_FEATURE_CRC32      0x00000010
+
 //
 // Define the set of DCP flags.
 //
@@ -2283,6 +2318,7 @@ Return Value:
 
 --*/
 
+KERNEL_API
 ULONG
 KeGetActiveProcessorCount (
     VOID
@@ -531,6 +531,14 @@ Module Name:
 
 #define FORK_FLAG_REALM_UTS 0x00000001
 
+//
+// Set this flag to have the child process run in the parent's address space
+// rather than a copy of it. The calling thread is suspended until the child
+// executes a new image or exits.
+//
+
+#define FORK_FLAG_VFORK 0x00000002
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1439,6 +1447,14 @@ Structure Description:
 
     Realm - Stores the set of realms the process belongs to.
 
+    VforkAddressSpace - Stores a pointer to the process' own address space
+        while it is borrowing its parent's address space after a vfork. This
+        is NULL if the process is running in its own address space.
+
+    VforkEvent - Stores an optional pointer to the event signaled when a
+        vfork child stops using its parent's address space, either by
+        executing a new image or by exiting.
+
 --*/
 
 struct _KPROCESS {
@@ -1485,6 +1501,8 @@ struct _KPROCESS {
     ULONG Umask;
     PVOID ControllingTerminal;
     PROCESS_REALMS Realm;
+    PADDRESS_SPACE VforkAddressSpace;
+    PVOID VforkEvent;
 };
 
 /*++
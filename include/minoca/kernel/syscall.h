@@ -151,7 +151,8 @@ Module Name:
 //
 
 #define SYS_IO_FLAG_WRITE 0x00000001
-#define SYS_IO_FLAG_MASK  0x00000001
+#define SYS_IO_FLAG_GIFT  0x00000002
+#define SYS_IO_FLAG_MASK  0x00000003
 
 //
 // Define flush flags.
@@ -357,6 +358,7 @@ typedef enum _SYSTEM_CALL_NUMBER {
     SystemCallSetITimer,
     SystemCallSetResourceLimit,
     SystemCallSetBreak,
+    SystemCallCopyFileRange,
     SystemCallCount
 } SYSTEM_CALL_NUMBER, *PSYSTEM_CALL_NUMBER;
 
@@ -410,6 +412,8 @@ typedef enum _FILE_CONTROL_COMMAND {
     FileControlCommandSetDirectoryFlag,
     FileControlCommandCloseFrom,
     FileControlCommandGetPath,
+    FileControlCommandGetPipeSize,
+    FileControlCommandSetPipeSize,
     FileControlCommandCount
 } FILE_CONTROL_COMMAND, *PFILE_CONTROL_COMMAND;
 
@@ -1245,6 +1249,10 @@ Structure Description:
     Owner - Stores the ID of the process to receive signals on asynchronous
         I/O events.
 
+    PipeSize - Stores the capacity of a pipe, in bytes. On input for set
+        operations this is the requested capacity, and on output it returns
+        the actual capacity.
+
 --*/
 
 typedef union _FILE_CONTROL_PARAMETERS_UNION {
@@ -1254,6 +1262,7 @@ typedef union _FILE_CONTROL_PARAMETERS_UNION {
     ULONG Flags;
     FILE_PATH FilePath;
     PROCESS_ID Owner;
+    ULONG PipeSize;
 } FILE_CONTROL_PARAMETERS_UNION, *PFILE_CONTROL_PARAMETERS_UNION;
 
 /*++
@@ -2484,6 +2493,41 @@ typedef struct _SYSTEM_CALL_SET_BREAK {
 
 /*++
 
+Structure Description:
+
+    This structure defines the system call parameters for copying a range of
+    one file to another within the kernel.
+
+Members:
+
+    InputHandle - Stores the handle to read from.
+
+    OutputHandle - Stores the handle to write to.
+
+    InputOffset - Stores the offset in the input to copy from. Supply -1ULL to
+        use and update the input's current file pointer offset.
+
+    OutputOffset - Stores the offset in the output to copy to. Supply -1ULL to
+        use and update the output's current file pointer offset.
+
+    Size - Stores the number of bytes to copy.
+
+    Flags - Stores flags governing the copy. No flags are currently defined,
+        so this must be zero.
+
+--*/
+
+typedef struct _SYSTEM_CALL_COPY_FILE_RANGE {
+    HANDLE InputHandle;
+    HANDLE OutputHandle;
+    IO_OFFSET InputOffset;
+    IO_OFFSET OutputOffset;
+    INTN Size;
+    ULONG Flags;
+} SYSCALL_STRUCT SYSTEM_CALL_COPY_FILE_RANGE, *PSYSTEM_CALL_COPY_FILE_RANGE;
+
+/*++
+
 Structure Description:
 
     This structure defines the system call parameters for getting or setting
@@ -2589,6 +2633,7 @@ typedef union _SYSTEM_CALL_PARAMETER_UNION {
     SYSTEM_CALL_SET_ITIMER SetITimer;
     SYSTEM_CALL_SET_RESOURCE_LIMIT SetResourceLimit;
     SYSTEM_CALL_SET_BREAK SetBreak;
+    SYSTEM_CALL_COPY_FILE_RANGE CopyFileRange;
 } SYSCALL_STRUCT SYSTEM_CALL_PARAMETER_UNION, *PSYSTEM_CALL_PARAMETER_UNION;
 
 typedef
@@ -238,6 +238,7 @@ Module Name:
 #define X86_CPUID_IDENTIFICATION 0x00000000
 #define X86_CPUID_BASIC_INFORMATION 0x00000001
 #define X86_CPUID_MWAIT 0x00000005
+#define X86_CPUID_EXTENDED_FEATURES 0x00000007
 #define X86_CPUID_EXTENDED_IDENTIFICATION 0x80000000
 #define X86_CPUID_EXTENDED_INFORMATION 0x80000001
 #define X86_CPUID_ADVANCED_POWER_MANAGEMENT 0x80000007
@@ -256,10 +257,21 @@ Module Name:
 #define X86_CPUID_BASIC_EAX_EXTENDED_FAMILY_MASK (0xFF << 20)
 #define X86_CPUID_BASIC_EAX_EXTENDED_FAMILY_SHIFT 20
 
+#define X86_CPUID_BASIC_ECX_PCLMULQDQ (1 << 1)
 #define X86_CPUID_BASIC_ECX_MONITOR (1 << 3)
+#define X86_CPUID_BASIC_ECX_SSSE3 (1 << 9)
+#define X86_CPUID_BASIC_ECX_SSE4_1 (1 << 19)
+#define X86_CPUID_BASIC_ECX_AES (1 << 25)
 #define X86_CPUID_BASIC_EDX_SYSENTER (1 << 11)
 #define X86_CPUID_BASIC_EDX_CMOV (1 << 15)
 #define X86_CPUID_BASIC_EDX_FX_SAVE_RESTORE (1 << 24)
+#define X86_CPUID_BASIC_EDX_SSE2 (1 << 26)
+
+//
+// Define structured extended feature CPUID bits (eax is 7, ecx is 0).
+//
+
+#define X86_CPUID_EXTENDED_FEATURES_EBX_SHA (1 << 29)
 
 //
 // Define known CPU vendors.
@@ -475,6 +475,11 @@ Structure Description:
         over 100, it's expressed as a number over 1024 to avoid the divide.
         So 50% would be 512 for instance.
 
+    NurserySize - Stores the number of bytes that can be allocated before
+        a young generation garbage collection is performed. Young collections
+        only look at newly allocated objects, so they are much quicker than
+        full collections. Set this to 0 to always perform full collections.
+
     Flags - Stores a bitfield of flags governing the operation of the
         interpreter See CK_CONFIGURATION_* definitions.
 
@@ -491,6 +496,7 @@ typedef struct _CK_CONFIGURATION {
     UINTN InitialHeapSize;
     UINTN MinimumHeapSize;
     ULONG HeapGrowthPercent;
+    UINTN NurserySize;
     ULONG Flags;
 } CK_CONFIGURATION, *PCK_CONFIGURATION;
 
@@ -1276,6 +1282,36 @@ Return Value:
 
 --*/
 
+CK_API
+VOID
+CkInternString (
+    PCK_VM Vm,
+    INTN StackIndex
+    );
+
+/*++
+
+Routine Description:
+
+    This routine replaces the string at the given stack index with the
+    interned copy of that string. Interning strings that are used over and
+    over, such as dictionary keys, saves memory and speeds up lookups. If the
+    value at the given stack index is not a string, nothing happens. Strings
+    pushed as buffers must be finalized before being interned.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    StackIndex - Supplies the stack index of the string to intern. Negative
+        values reference stack indices from the end of the stack.
+
+Return Value:
+
+    None.
+
+--*/
+
 CK_API
 VOID
 CkPushDict (
@@ -898,6 +898,33 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CyAesEnableHardware (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the AES routines use the processor's
+    AES instructions where this library has a version that does. It is off by
+    default. The caller must have determined that the processor supports the
+    instructions and that the vector registers are preserved, which is not the
+    case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
 CRYPTO_API
 VOID
 CySha1ComputeHmac (
@@ -1090,6 +1117,33 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CySha1EnableHardware (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the SHA-1 routines use the processor's
+    SHA instructions where this library has a version that does. It is off by
+    default. The caller must have determined that the processor supports the
+    instructions and that the vector registers are preserved, which is not the
+    case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
 CRYPTO_API
 VOID
 CySha256Initialize (
@@ -1168,6 +1222,33 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CySha256EnableHardware (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the SHA-256 routines use the
+    processor's SHA instructions where this library has a version that does. It
+    is off by default. The caller must have determined that the processor
+    supports the instructions and that the vector registers are preserved,
+    which is not the case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
 CRYPTO_API
 VOID
 CySha512Initialize (
@@ -522,6 +522,10 @@ Structure Description:
     ScopeCapacity - Stores the maximum number of elements that can be put in
         the scope tree before it will have to be reallocated.
 
+    SymbolCache - Stores an optional pointer to a cache of the symbols most
+        recently looked up by name in this image's scope. This is owned by
+        the image library.
+
 --*/
 
 struct _LOADED_IMAGE {
@@ -568,6 +572,7 @@ struct _LOADED_IMAGE {
     PLOADED_IMAGE *Scope;
     UINTN ScopeSize;
     UINTN ScopeCapacity;
+    PVOID SymbolCache;
 };
 
 /*++
@@ -1063,6 +1068,75 @@ Return Value:
 
 --*/
 
+typedef
+KSTATUS
+(*PIM_SAVE_FILE) (
+    PVOID SystemContext,
+    PCSTR Path,
+    PVOID Buffer,
+    UINTN Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine replaces the contents of a file with the given buffer. The
+    replacement should be atomic: anyone opening the file should see either
+    the old contents or the new contents, never a mixture.
+
+Arguments:
+
+    SystemContext - Supplies the context pointer passed to the load executable
+        function.
+
+    Path - Supplies a pointer to the path of the file to write.
+
+    Buffer - Supplies a pointer to the new file contents.
+
+    Size - Supplies the size of the buffer in bytes.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+typedef
+KSTATUS
+(*PIM_OPEN_CACHE_FILE) (
+    PVOID SystemContext,
+    PCSTR Path,
+    PIMAGE_FILE_INFORMATION File
+    );
+
+/*++
+
+Routine Description:
+
+    This routine opens a cache file previously written with the save file
+    routine. Since the image library trusts what it reads from a cache, the
+    file is only opened if nobody but the current user or the administrator
+    could have written it.
+
+Arguments:
+
+    SystemContext - Supplies the context pointer passed to the load executable
+        function.
+
+    Path - Supplies a pointer to the path of the file to open.
+
+    File - Supplies a pointer where the information for the file including its
+        open handle will be returned.
+
+Return Value:
+
+    STATUS_ACCESS_DENIED if the file cannot be trusted.
+
+    Other status codes.
+
+--*/
+
 /*++
 
 Structure Description:
@@ -1123,6 +1197,14 @@ Structure Description:
     ResolvePltEntry - Stores an optional pointer to an assembly function used
         to resolve procedure linkage table entries on the fly.
 
+    SaveFile - Stores an optional pointer to a function used to persist
+        caches the image library builds, such as the relocation cache. If this
+        is NULL, nothing is cached across loads.
+
+    OpenCacheFile - Stores an optional pointer to a function used to open
+        files written by the save file function. If this is NULL, nothing is
+        cached across loads.
+
 --*/
 
 typedef struct _IM_IMPORT_TABLE {
@@ -1143,6 +1225,8 @@ typedef struct _IM_IMPORT_TABLE {
     PIM_GET_ENVIRONMENT_VARIABLE GetEnvironmentVariable;
     PIM_FINALIZE_SEGMENTS FinalizeSegments;
     PIM_RESOLVE_PLT_ENTRY ResolvePltEntry;
+    PIM_SAVE_FILE SaveFile;
+    PIM_OPEN_CACHE_FILE OpenCacheFile;
 } IM_IMPORT_TABLE, *PIM_IMPORT_TABLE;
 
 //
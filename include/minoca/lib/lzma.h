@@ -290,8 +290,10 @@ Structure Description:
         or not. For decoders, stores whether or not to expect an end marker.
         The default is TRUE.
 
-    ThreadCount - Stores the thread count to use while encoding. Valid values
-        are 1 and 2. The default is 2.
+    ThreadCount - Stores the thread count to use while encoding. The encoder
+        itself always runs on the calling thread, so callers that want to
+        compress in parallel should split the input into independent blocks,
+        as the lzma utility does. The default is 1.
 
 --*/
 
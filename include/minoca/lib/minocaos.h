@@ -84,6 +84,7 @@ typedef enum _OS_ARM_PROCESSOR_FEATURE {
     OsArmVfp,
     OsArmVfp3,
     OsArmNeon32,
+    OsArmCrc32,
     OsArmFeatureCount
 } OS_ARM_PROCESSOR_FEATURE, *POS_ARM_PROCESSOR_FEATURE;
 
@@ -92,6 +93,10 @@ typedef enum _OS_X86_PROCESSOR_FEATURE {
     OsX86Sysenter,
     OsX86I686,
     OsX86FxSave,
+    OsX86Sse2,
+    OsX86Pclmulqdq,
+    OsX86Aes,
+    OsX86Sha,
     OsX86FeatureCount
 } OS_X86_PROCESSOR_FEATURE, *POS_X86_PROCESSOR_FEATURE;
 
@@ -495,6 +500,60 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsCopyFileRange (
+    HANDLE InputHandle,
+    IO_OFFSET InputOffset,
+    HANDLE OutputHandle,
+    IO_OFFSET OutputOffset,
+    UINTN Size,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one open file or block device to another
+    within the kernel, without passing it through user mode.
+
+Arguments:
+
+    InputHandle - Supplies the handle to read from.
+
+    InputOffset - Supplies the offset in the input to start reading from. Set
+        this to IO_OFFSET_NONE to use and update the input's current file
+        position.
+
+    OutputHandle - Supplies the handle to write to.
+
+    OutputOffset - Supplies the offset in the output to start writing at. Set
+        this to IO_OFFSET_NONE to use and update the output's current file
+        position.
+
+    Size - Supplies the number of bytes to copy.
+
+    Flags - Supplies a bitfield of flags. No flags are currently defined, so
+        this must be zero.
+
+    BytesCompleted - Supplies a pointer where the number of bytes copied will
+        be returned. This may be less than requested, and is zero at the end
+        of the input.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if either handle is not a regular file, block device,
+    or shared memory object. The caller should fall back to reading and
+    writing.
+
+    Other error codes on failure.
+
+--*/
+
 OS_API
 KSTATUS
 OsFlush (
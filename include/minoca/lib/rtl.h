@@ -521,6 +521,13 @@ Module Name:
 
 #define RED_BLACK_TREE_FLAG_PERIODIC_VALIDATION 0x00000001
 
+//
+// Define the number of CRC-32 lookup tables, which allows the CRC to be
+// computed eight bytes at a time.
+//
+
+#define RTL_CRC32_TABLE_COUNT 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1546,6 +1553,14 @@ typedef struct _SYSTEM_VERSION_INFORMATION {
 // -------------------------------------------------------------------- Globals
 //
 
+//
+// Store the CRC-32 lookup tables. The first is the classic byte at a time
+// table, and each subsequent table advances the previous one by another zero
+// byte.
+//
+
+RTL_API extern const ULONG RtlCrcTable[RTL_CRC32_TABLE_COUNT][256];
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -1580,6 +1595,33 @@ Return Value:
 
 --*/
 
+RTL_API
+VOID
+RtlEnableHardwareCrc32 (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not RtlComputeCrc32 uses the processor's
+    CRC instructions: carry-less multiply (PCLMULQDQ) on x86, and the ARMv8
+    CRC32 instructions on ARM. It is off by default. The caller must have
+    determined that the processor supports the instructions, and on x86 that
+    the SSE registers are preserved, which is not the case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the lookup tables (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
 RTL_API
 VOID
 RtlRaiseAssertion (
@@ -151,6 +151,27 @@ Module Name:
 
 #define NET_LINK_PROPERTIES_VERSION 1
 
+//
+// Define the current version number of the net poll properties structure.
+//
+
+#define NET_POLL_PROPERTIES_VERSION 1
+
+//
+// Define the default and maximum number of packets a device handles in a
+// single poll.
+//
+
+#define NET_POLL_DEFAULT_BUDGET 64
+#define NET_POLL_MAX_BUDGET 1024
+
+//
+// Define the receive polling states.
+//
+
+#define NET_POLL_STATE_IDLE      0
+#define NET_POLL_STATE_SCHEDULED 1
+
 //
 // Define some common network link speeds.
 //
@@ -192,6 +213,7 @@ Module Name:
 #define NET_SOCKET_FLAG_NETWORK_HEADER_INCLUDED 0x00000100
 #define NET_SOCKET_FLAG_KERNEL                  0x00000200
 #define NET_SOCKET_FLAG_MULTICAST_LOOPBACK      0x00000400
+#define NET_SOCKET_FLAG_FLOW_HASH_VALID         0x00000800
 
 //
 // Define the set of network socket flags that should be carried over to a
@@ -226,6 +248,7 @@ Module Name:
 #define NET_PACKET_FLAG_ROUTER_ALERT         0x00000200
 #define NET_PACKET_FLAG_LINK_LOCAL_HOP_LIMIT 0x00000400
 #define NET_PACKET_FLAG_MAX_HOP_LIMIT        0x00000800
+#define NET_PACKET_FLAG_FLOW_HASH_VALID      0x00001000
 
 #define NET_PACKET_FLAG_CHECKSUM_OFFLOAD_MASK \
     (NET_PACKET_FLAG_IP_CHECKSUM_OFFLOAD |    \
@@ -444,6 +467,10 @@ Structure Description:
         beginning of the footer data (ie the location to store the first byte
         of new footer).
 
+    FlowHash - Stores the receive flow hash of the packet. This is only valid
+        if NET_PACKET_FLAG_FLOW_HASH_VALID is set. Devices that compute a
+        Toeplitz receive side scaling hash in hardware can supply it here.
+
 --*/
 
 typedef struct _NET_PACKET_BUFFER {
@@ -456,6 +483,7 @@ typedef struct _NET_PACKET_BUFFER {
     ULONG DataSize;
     ULONG DataOffset;
     ULONG FooterOffset;
+    ULONG FlowHash;
 } NET_PACKET_BUFFER, *PNET_PACKET_BUFFER;
 
 /*++
@@ -680,6 +708,201 @@ typedef struct _NET_LINK_MULTICAST_GROUP {
     NETWORK_ADDRESS Address;
 } NET_LINK_MULTICAST_GROUP, *PNET_LINK_MULTICAST_GROUP;
 
+typedef
+ULONG
+(*PNET_DEVICE_POLL) (
+    PVOID DeviceContext,
+    ULONG Budget
+    );
+
+/*++
+
+Routine Description:
+
+    This routine processes received packets on a device whose receive
+    interrupt is disabled. It is called at low level.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context given when the
+        poll was created.
+
+    Budget - Supplies the maximum number of packets to process.
+
+Return Value:
+
+    Returns the number of packets processed. Returning less than the budget
+    indicates that the device is drained, in which case the networking core
+    will call the device to re-enable its receive interrupt.
+
+--*/
+
+typedef
+VOID
+(*PNET_DEVICE_ENABLE_RECEIVE_INTERRUPT) (
+    PVOID DeviceContext
+    );
+
+/*++
+
+Routine Description:
+
+    This routine re-enables a device's receive interrupt after the networking
+    core has finished polling it. It is called at low level.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context given when the
+        poll was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+typedef
+VOID
+(*PNET_DEVICE_SET_INTERRUPT_RATE) (
+    PVOID DeviceContext,
+    ULONG InterruptsPerSecond
+    );
+
+/*++
+
+Routine Description:
+
+    This routine programs a device's interrupt throttling. It is called at low
+    level.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context given when the
+        poll was created.
+
+    InterruptsPerSecond - Supplies the maximum number of interrupts per second
+        the device should generate, or zero to disable throttling.
+
+Return Value:
+
+    None.
+
+--*/
+
+/*++
+
+Structure Description:
+
+    This structure defines the interface to a polled device from the core
+    networking library.
+
+Members:
+
+    Poll - Stores a pointer to a function used to process received packets.
+
+    EnableReceiveInterrupt - Stores a pointer to a function used to re-enable
+        the receive interrupt once the device is drained.
+
+    SetInterruptRate - Stores an optional pointer to a function used to
+        program the device's interrupt throttling. Devices that cannot throttle
+        interrupts leave this NULL.
+
+--*/
+
+typedef struct _NET_DEVICE_POLL_INTERFACE {
+    PNET_DEVICE_POLL Poll;
+    PNET_DEVICE_ENABLE_RECEIVE_INTERRUPT EnableReceiveInterrupt;
+    PNET_DEVICE_SET_INTERRUPT_RATE SetInterruptRate;
+} NET_DEVICE_POLL_INTERFACE, *PNET_DEVICE_POLL_INTERFACE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the characteristics of a polled device.
+
+Members:
+
+    Version - Stores the version number of the structure. Set this to
+        NET_POLL_PROPERTIES_VERSION.
+
+    DeviceContext - Stores a pointer to device-specific context passed to the
+        interface routines.
+
+    Budget - Stores the number of packets to process per poll, or 0 to use
+        the default.
+
+    Interface - Stores the list of functions used by the core networking
+        library to call into the device.
+
+--*/
+
+typedef struct _NET_POLL_PROPERTIES {
+    ULONG Version;
+    PVOID DeviceContext;
+    ULONG Budget;
+    NET_DEVICE_POLL_INTERFACE Interface;
+} NET_POLL_PROPERTIES, *PNET_POLL_PROPERTIES;
+
+/*++
+
+Structure Description:
+
+    This structure defines the receive polling state of a network link.
+
+Members:
+
+    Link - Stores a pointer to the link being polled.
+
+    Properties - Stores the poll properties supplied by the device.
+
+    WorkItem - Stores a pointer to the work item that runs the poll.
+
+    State - Stores the polling state. See NET_POLL_STATE_* definitions.
+
+    Moderation - Stores the interrupt moderation mode.
+
+    FixedInterruptRate - Stores the interrupt rate used in fixed mode.
+
+    InterruptRate - Stores the interrupt rate currently programmed into the
+        device.
+
+    IntervalStart - Stores the time counter value when the current adaptive
+        moderation sampling interval began.
+
+    IntervalPackets - Stores the number of packets received during the
+        current adaptive moderation sampling interval.
+
+    InterruptCount - Stores the number of receive interrupts taken.
+
+    PollCount - Stores the number of times the device was polled.
+
+    PacketCount - Stores the number of packets received through polling.
+
+    BudgetExhaustedCount - Stores the number of polls that used their entire
+        budget.
+
+    RateChangeCount - Stores the number of interrupt rate changes.
+
+--*/
+
+typedef struct _NET_POLL {
+    struct _NET_LINK *Link;
+    NET_POLL_PROPERTIES Properties;
+    PWORK_ITEM WorkItem;
+    volatile ULONG State;
+    NETWORK_INTERRUPT_MODERATION Moderation;
+    ULONG FixedInterruptRate;
+    ULONG InterruptRate;
+    ULONGLONG IntervalStart;
+    ULONGLONG IntervalPackets;
+    ULONGLONG InterruptCount;
+    ULONGLONG PollCount;
+    ULONGLONG PacketCount;
+    ULONGLONG BudgetExhaustedCount;
+    ULONGLONG RateChangeCount;
+} NET_POLL, *PNET_POLL;
+
 typedef struct _NET_DATA_LINK_ENTRY NET_DATA_LINK_ENTRY, *PNET_DATA_LINK_ENTRY;
 
 /*++
@@ -728,6 +951,9 @@ Structure Description:
     MulticastGroupList - Stores a list of the multicast groups to which this
         link belongs.
 
+    Poll - Stores an optional pointer to the receive polling state of the
+        link, if the device supports polling.
+
 --*/
 
 typedef struct _NET_LINK {
@@ -743,6 +969,7 @@ typedef struct _NET_LINK {
     PKEVENT AddressTranslationEvent;
     RED_BLACK_TREE AddressTranslationTree;
     LIST_ENTRY MulticastGroupList;
+    PNET_POLL Poll;
 } NET_LINK, *PNET_LINK;
 
 typedef
@@ -1273,6 +1500,11 @@ Structure Description:
     MulticastGroupList - Stores the head of the list of multicast groups to
         which the socket belongs.
 
+    FlowHash - Stores the receive flow hash of the last packet delivered to
+        this socket. This is only valid if NET_SOCKET_FLAG_FLOW_HASH_VALID is
+        set, and is used to steer the flow's receive processing to the
+        processor consuming the socket's data.
+
 --*/
 
 typedef struct _NET_SOCKET {
@@ -1300,6 +1532,7 @@ typedef struct _NET_SOCKET {
     NET_SOCKET_LINK_OVERRIDE MulticastInterface;
     volatile PQUEUED_LOCK MulticastLock;
     LIST_ENTRY MulticastGroupList;
+    ULONG FlowHash;
 } NET_SOCKET, *PNET_SOCKET;
 
 typedef
@@ -3065,6 +3298,83 @@ Return Value:
 
 --*/
 
+NET_API
+KSTATUS
+NetCreatePoll (
+    PNET_LINK Link,
+    PNET_POLL_PROPERTIES Properties
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sets a link up for budgeted receive polling. Rather than
+    processing received packets straight from its interrupt, the device masks
+    its receive interrupt and calls NetSchedulePoll. The networking core then
+    polls the device until it is drained, re-enables the receive interrupt,
+    and adjusts the device's interrupt throttling to the traffic.
+
+Arguments:
+
+    Link - Supplies a pointer to the link to poll.
+
+    Properties - Supplies a pointer to the poll properties. This memory will
+        not be referenced after the function returns.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+NET_API
+VOID
+NetDestroyPoll (
+    PNET_LINK Link
+    );
+
+/*++
+
+Routine Description:
+
+    This routine tears down receive polling for a link. The device must have
+    its receive interrupt disabled and no longer call NetSchedulePoll.
+
+Arguments:
+
+    Link - Supplies a pointer to the link.
+
+Return Value:
+
+    None.
+
+--*/
+
+NET_API
+VOID
+NetSchedulePoll (
+    PNET_LINK Link
+    );
+
+/*++
+
+Routine Description:
+
+    This routine schedules a poll of a link's device. The device calls this
+    after taking a receive interrupt and masking further receive interrupts.
+    This routine must be called at or below dispatch level.
+
+Arguments:
+
+    Link - Supplies a pointer to the link to poll.
+
+Return Value:
+
+    None.
+
+--*/
+
 NET_API
 KSTATUS
 NetFindLinkForLocalAddress (
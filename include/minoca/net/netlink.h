@@ -209,6 +209,7 @@ Module Name:
 
 #define NETLINK_GENERIC_CONTROL_NAME "nlctrl"
 #define NETLINK_GENERIC_80211_NAME   "nl80211"
+#define NETLINK_GENERIC_RSS_NAME     "nlrss"
 
 //
 // Define the generic control command values.
@@ -293,6 +294,31 @@ Module Name:
 
 #define NETLINK_80211_MULTICAST_SCAN_NAME "scan"
 
+//
+// Define the generic receive side scaling command values. The state command
+// is sent in reply to both the get and set commands.
+//
+
+#define NETLINK_RSS_COMMAND_GET 1
+#define NETLINK_RSS_COMMAND_SET 2
+#define NETLINK_RSS_COMMAND_STATE 3
+#define NETLINK_RSS_COMMAND_MAX 255
+
+//
+// Define the generic receive side scaling attributes. The table is an array
+// of UCHAR queue indices, one per steering table entry, indexed by the low
+// bits of a flow's hash. The per-queue statistics are arrays of ULONGLONG
+// values, one per queue. Only the enabled, table, and key attributes can be
+// set.
+//
+
+#define NETLINK_RSS_ATTRIBUTE_ENABLED 1
+#define NETLINK_RSS_ATTRIBUTE_QUEUE_COUNT 2
+#define NETLINK_RSS_ATTRIBUTE_TABLE 3
+#define NETLINK_RSS_ATTRIBUTE_KEY 4
+#define NETLINK_RSS_ATTRIBUTE_QUEUE_PACKETS 5
+#define NETLINK_RSS_ATTRIBUTE_QUEUE_DROPS 6
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
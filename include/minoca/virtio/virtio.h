@@ -0,0 +1,1161 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    virtio.h
+
+Abstract:
+
+    This header contains definitions for the virtio PCI transport library,
+    which is shared by the paravirtual virtio device drivers.
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/intrface/pci.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro determines whether the given 64-bit feature bit was negotiated.
+//
+
+#define VIRTIO_HAS_FEATURE(_Device, _Feature) \
+    (((_Device)->Features & (_Feature)) != 0)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the API decorator.
+//
+
+#ifndef VIRTIO_API
+
+#define VIRTIO_API __DLLIMPORT
+
+#endif
+
+#define VIRTIO_ALLOCATION_TAG 0x6F497456 // 'oItV'
+
+//
+// Define the version of the virtio initialization block.
+//
+
+#define VIRTIO_INITIALIZATION_BLOCK_VERSION 1
+
+//
+// Define the PCI vendor ID used by all virtio devices.
+//
+
+#define VIRTIO_PCI_VENDOR_ID 0x1AF4
+
+//
+// Define the standard PCI configuration space offsets used to find the virtio
+// capabilities and BARs.
+//
+
+#define VIRTIO_PCI_STATUS_OFFSET 0x06
+#define VIRTIO_PCI_BAR_OFFSET 0x10
+#define VIRTIO_PCI_CAPABILITIES_POINTER_OFFSET 0x34
+#define VIRTIO_PCI_BAR_COUNT 6
+
+#define VIRTIO_PCI_STATUS_CAPABILITIES_LIST 0x0010
+
+#define VIRTIO_PCI_BAR_IO_SPACE 0x00000001
+#define VIRTIO_PCI_BAR_MEMORY_64_BIT 0x00000004
+#define VIRTIO_PCI_BAR_MEMORY_TYPE_MASK 0x00000006
+#define VIRTIO_PCI_BAR_MEMORY_ADDRESS_MASK (~0xFULL)
+
+//
+// Define the vendor specific capability that carries virtio structures, and
+// the offsets of its fields.
+//
+
+#define VIRTIO_PCI_CAPABILITY_VENDOR 0x09
+
+#define VIRTIO_PCI_CAPABILITY_ID 0
+#define VIRTIO_PCI_CAPABILITY_NEXT 1
+#define VIRTIO_PCI_CAPABILITY_TYPE 3
+#define VIRTIO_PCI_CAPABILITY_BAR 4
+#define VIRTIO_PCI_CAPABILITY_OFFSET 8
+#define VIRTIO_PCI_CAPABILITY_LENGTH 12
+#define VIRTIO_PCI_CAPABILITY_NOTIFY_MULTIPLIER 16
+
+//
+// Define the virtio PCI capability types.
+//
+
+#define VIRTIO_PCI_CAPABILITY_COMMON_CONFIGURATION 1
+#define VIRTIO_PCI_CAPABILITY_NOTIFY_CONFIGURATION 2
+#define VIRTIO_PCI_CAPABILITY_ISR_CONFIGURATION    3
+#define VIRTIO_PCI_CAPABILITY_DEVICE_CONFIGURATION 4
+
+//
+// Define the device status bits.
+//
+
+#define VIRTIO_STATUS_ACKNOWLEDGE        0x01
+#define VIRTIO_STATUS_DRIVER             0x02
+#define VIRTIO_STATUS_DRIVER_OK          0x04
+#define VIRTIO_STATUS_FEATURES_OK        0x08
+#define VIRTIO_STATUS_DEVICE_NEEDS_RESET 0x40
+#define VIRTIO_STATUS_FAILED             0x80
+
+//
+// Define the ISR status bits, used only with legacy interrupts.
+//
+
+#define VIRTIO_ISR_QUEUE         0x01
+#define VIRTIO_ISR_CONFIGURATION 0x02
+
+//
+// Define the value used to tell the device not to use an MSI-X vector.
+//
+
+#define VIRTIO_MSI_NO_VECTOR 0xFFFF
+
+//
+// Define the device independent feature bits.
+//
+
+#define VIRTIO_FEATURE_INDIRECT_DESCRIPTORS (1ULL << 28)
+#define VIRTIO_FEATURE_EVENT_INDEX          (1ULL << 29)
+#define VIRTIO_FEATURE_VERSION_1            (1ULL << 32)
+#define VIRTIO_FEATURE_ACCESS_PLATFORM      (1ULL << 33)
+#define VIRTIO_FEATURE_RING_PACKED          (1ULL << 34)
+#define VIRTIO_FEATURE_IN_ORDER             (1ULL << 35)
+
+//
+// Define the features the transport library handles on behalf of every
+// device driver.
+//
+
+#define VIRTIO_TRANSPORT_FEATURES \
+    (VIRTIO_FEATURE_EVENT_INDEX | \
+     VIRTIO_FEATURE_VERSION_1 |   \
+     VIRTIO_FEATURE_RING_PACKED)
+
+//
+// Define split virtqueue descriptor flags.
+//
+
+#define VIRTIO_DESCRIPTOR_NEXT     0x0001
+#define VIRTIO_DESCRIPTOR_WRITE    0x0002
+#define VIRTIO_DESCRIPTOR_INDIRECT 0x0004
+
+//
+// Define the additional packed virtqueue descriptor flags.
+//
+
+#define VIRTIO_PACKED_DESCRIPTOR_AVAILABLE 0x0080
+#define VIRTIO_PACKED_DESCRIPTOR_USED      0x8000
+
+//
+// Define the split virtqueue available and used ring flags.
+//
+
+#define VIRTIO_AVAILABLE_NO_INTERRUPT 0x0001
+#define VIRTIO_USED_NO_NOTIFY         0x0001
+
+//
+// Define the packed virtqueue event suppression flags. The wrap counter
+// lives in the high bit of the event descriptor offset.
+//
+
+#define VIRTIO_PACKED_EVENT_ENABLE     0x0
+#define VIRTIO_PACKED_EVENT_DISABLE    0x1
+#define VIRTIO_PACKED_EVENT_DESCRIPTOR 0x2
+
+#define VIRTIO_PACKED_EVENT_WRAP_SHIFT 15
+
+//
+// Define the default and maximum number of entries the library will put in a
+// virtqueue.
+//
+
+#define VIRTIO_DEFAULT_QUEUE_SIZE 256
+#define VIRTIO_MAX_QUEUE_SIZE 1024
+
+//
+// Define virtio device flags.
+//
+
+//
+// Set this flag to have the queue service routines called at low level
+// rather than at dispatch level.
+//
+
+#define VIRTIO_DEVICE_FLAG_LOW_LEVEL_INTERRUPTS 0x00000001
+
+//
+// This flag is set internally once the device's PCI capabilities have been
+// parsed and mapped.
+//
+
+#define VIRTIO_DEVICE_FLAG_MAPPED 0x00000002
+
+//
+// Define virtio queue flags.
+//
+
+#define VIRTIO_QUEUE_FLAG_PACKED              0x00000001
+#define VIRTIO_QUEUE_FLAG_EVENT_INDEX         0x00000002
+#define VIRTIO_QUEUE_FLAG_NOTIFICATIONS_ON    0x00000004
+
+//
+// Define the flags describing the state of the PCI interfaces.
+//
+
+#define VIRTIO_PCI_FLAG_CONFIG_INTERFACE_REGISTERED 0x00000001
+#define VIRTIO_PCI_FLAG_CONFIG_INTERFACE_AVAILABLE  0x00000002
+#define VIRTIO_PCI_FLAG_MSI_INTERFACE_REGISTERED    0x00000004
+#define VIRTIO_PCI_FLAG_MSI_INTERFACE_AVAILABLE     0x00000008
+#define VIRTIO_PCI_FLAG_MSI_RESOURCES_REQUESTED     0x00000010
+#define VIRTIO_PCI_FLAG_MSI_RESOURCES_ALLOCATED     0x00000020
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef struct _VIRTIO_DEVICE VIRTIO_DEVICE, *PVIRTIO_DEVICE;
+typedef struct _VIRTIO_QUEUE VIRTIO_QUEUE, *PVIRTIO_QUEUE;
+
+//
+// Define the register offsets within the common configuration structure.
+//
+
+typedef enum _VIRTIO_COMMON_REGISTER {
+    VirtioCommonDeviceFeatureSelect = 0x00,
+    VirtioCommonDeviceFeature       = 0x04,
+    VirtioCommonDriverFeatureSelect = 0x08,
+    VirtioCommonDriverFeature       = 0x0C,
+    VirtioCommonConfigurationVector = 0x10,
+    VirtioCommonQueueCount          = 0x12,
+    VirtioCommonDeviceStatus        = 0x14,
+    VirtioCommonConfigGeneration    = 0x15,
+    VirtioCommonQueueSelect         = 0x16,
+    VirtioCommonQueueSize           = 0x18,
+    VirtioCommonQueueVector         = 0x1A,
+    VirtioCommonQueueEnable         = 0x1C,
+    VirtioCommonQueueNotifyOffset   = 0x1E,
+    VirtioCommonQueueDescriptorLow  = 0x20,
+    VirtioCommonQueueDescriptorHigh = 0x24,
+    VirtioCommonQueueDriverLow      = 0x28,
+    VirtioCommonQueueDriverHigh     = 0x2C,
+    VirtioCommonQueueDeviceLow      = 0x30,
+    VirtioCommonQueueDeviceHigh     = 0x34,
+} VIRTIO_COMMON_REGISTER, *PVIRTIO_COMMON_REGISTER;
+
+/*++
+
+Structure Description:
+
+    This structure defines a split virtqueue descriptor. This structure is
+    defined by the virtio specification.
+
+Members:
+
+    Address - Stores the physical address of the buffer.
+
+    Length - Stores the length of the buffer in bytes.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_DESCRIPTOR_* definitions.
+
+    Next - Stores the index of the next descriptor in the chain if the next
+        flag is set.
+
+--*/
+
+typedef struct _VIRTIO_SPLIT_DESCRIPTOR {
+    ULONGLONG Address;
+    ULONG Length;
+    USHORT Flags;
+    USHORT Next;
+} PACKED VIRTIO_SPLIT_DESCRIPTOR, *PVIRTIO_SPLIT_DESCRIPTOR;
+
+/*++
+
+Structure Description:
+
+    This structure defines an element of the split virtqueue used ring. This
+    structure is defined by the virtio specification.
+
+Members:
+
+    Id - Stores the index of the head of the descriptor chain that was used.
+
+    Length - Stores the number of bytes the device wrote into the chain.
+
+--*/
+
+typedef struct _VIRTIO_USED_ELEMENT {
+    ULONG Id;
+    ULONG Length;
+} PACKED VIRTIO_USED_ELEMENT, *PVIRTIO_USED_ELEMENT;
+
+/*++
+
+Structure Description:
+
+    This structure defines a packed virtqueue descriptor. This structure is
+    defined by the virtio specification.
+
+Members:
+
+    Address - Stores the physical address of the buffer.
+
+    Length - Stores the length of the buffer in bytes. In a used descriptor,
+        this is the number of bytes the device wrote.
+
+    Id - Stores the buffer ID, which is returned in the used descriptor.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_DESCRIPTOR_* and
+        VIRTIO_PACKED_DESCRIPTOR_* definitions.
+
+--*/
+
+typedef struct _VIRTIO_PACKED_DESCRIPTOR {
+    ULONGLONG Address;
+    ULONG Length;
+    USHORT Id;
+    USHORT Flags;
+} PACKED VIRTIO_PACKED_DESCRIPTOR, *PVIRTIO_PACKED_DESCRIPTOR;
+
+/*++
+
+Structure Description:
+
+    This structure defines the packed virtqueue event suppression structure.
+    This structure is defined by the virtio specification.
+
+Members:
+
+    Descriptor - Stores the descriptor ring offset and wrap counter at which
+        to send an event, when descriptor specific events are enabled.
+
+    Flags - Stores the event suppression mode. See VIRTIO_PACKED_EVENT_*
+        definitions.
+
+--*/
+
+typedef struct _VIRTIO_PACKED_EVENT {
+    USHORT Descriptor;
+    USHORT Flags;
+} PACKED VIRTIO_PACKED_EVENT, *PVIRTIO_PACKED_EVENT;
+
+/*++
+
+Structure Description:
+
+    This structure defines a buffer to be handed to the device.
+
+Members:
+
+    Address - Stores the physical address of the buffer.
+
+    Length - Stores the length of the buffer in bytes.
+
+--*/
+
+typedef struct _VIRTIO_BUFFER {
+    PHYSICAL_ADDRESS Address;
+    ULONG Length;
+} VIRTIO_BUFFER, *PVIRTIO_BUFFER;
+
+typedef
+VOID
+(*PVIRTIO_QUEUE_SERVICE_ROUTINE) (
+    PVIRTIO_QUEUE Queue,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called when the device signals that it has used buffers
+    in a virtqueue. It runs at dispatch level, or at low level if the device
+    was created with the low level interrupts flag.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue that has used buffers.
+
+    Context - Supplies the context pointer supplied when the queue was
+        created.
+
+Return Value:
+
+    None.
+
+--*/
+
+typedef
+VOID
+(*PVIRTIO_CONFIGURATION_CHANGE_ROUTINE) (
+    PVIRTIO_DEVICE Device,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called when the device signals that its device specific
+    configuration space has changed.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Context - Supplies the consumer context supplied when the device was
+        created.
+
+Return Value:
+
+    None.
+
+--*/
+
+/*++
+
+Structure Description:
+
+    This structure defines the per-entry software state of a virtqueue.
+
+Members:
+
+    Token - Stores the caller's token for the buffer chain starting here.
+
+    Next - Stores the index of the next free entry. For split queues the free
+        list is threaded through the descriptors themselves, so this is only
+        used by packed queues.
+
+    Count - Stores the number of descriptors in the chain.
+
+--*/
+
+typedef struct _VIRTIO_QUEUE_ENTRY {
+    PVOID Token;
+    USHORT Next;
+    USHORT Count;
+} VIRTIO_QUEUE_ENTRY, *PVIRTIO_QUEUE_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure defines a virtqueue. The caller must serialize all access
+    to a given queue.
+
+Members:
+
+    Device - Stores a pointer to the device that owns the queue.
+
+    Index - Stores the queue index within the device.
+
+    Size - Stores the number of descriptors in the queue.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_QUEUE_FLAG_* definitions.
+
+    Vector - Stores the MSI-X table entry the queue interrupts on, or
+        VIRTIO_MSI_NO_VECTOR.
+
+    ServiceRoutine - Stores an optional pointer to the routine called when the
+        device uses buffers.
+
+    ServiceContext - Stores the context passed to the service routine.
+
+    IoBuffer - Stores a pointer to the I/O buffer holding the rings.
+
+    NotifyAddress - Stores the mapped address of the queue's notification
+        register.
+
+    Entries - Stores the array of per-entry software state.
+
+    FreeCount - Stores the number of free descriptors.
+
+    FreeHead - Stores the index of the first free descriptor (split) or
+        buffer ID (packed).
+
+    AddedCount - Stores the number of descriptor chains (split) or
+        descriptors (packed) added since the last kick.
+
+    LastUsed - Stores the index of the next used entry to collect.
+
+    Descriptors - Stores a pointer to the split descriptor table.
+
+    AvailableFlags - Stores a pointer to the split available ring flags.
+
+    AvailableIndex - Stores a pointer to the split available ring index.
+
+    AvailableRing - Stores a pointer to the split available ring array.
+
+    UsedEvent - Stores a pointer to the used event index, written by the
+        driver.
+
+    UsedFlags - Stores a pointer to the split used ring flags.
+
+    UsedIndex - Stores a pointer to the split used ring index.
+
+    UsedRing - Stores a pointer to the split used ring array.
+
+    AvailableEvent - Stores a pointer to the available event index, written by
+        the device.
+
+    NextAvailable - Stores the driver's shadow copy of the available index.
+
+    PackedDescriptors - Stores a pointer to the packed descriptor ring.
+
+    DriverEvent - Stores a pointer to the packed driver event suppression
+        structure.
+
+    DeviceEvent - Stores a pointer to the packed device event suppression
+        structure.
+
+    AvailableWrapCounter - Stores the packed available wrap counter.
+
+    UsedWrapCounter - Stores the packed used wrap counter.
+
+--*/
+
+struct _VIRTIO_QUEUE {
+    PVIRTIO_DEVICE Device;
+    ULONG Index;
+    ULONG Size;
+    ULONG Flags;
+    USHORT Vector;
+    PVIRTIO_QUEUE_SERVICE_ROUTINE ServiceRoutine;
+    PVOID ServiceContext;
+    PIO_BUFFER IoBuffer;
+    PVOID NotifyAddress;
+    PVIRTIO_QUEUE_ENTRY Entries;
+    ULONG FreeCount;
+    USHORT FreeHead;
+    USHORT AddedCount;
+    USHORT LastUsed;
+    PVIRTIO_SPLIT_DESCRIPTOR Descriptors;
+    volatile USHORT *AvailableFlags;
+    volatile USHORT *AvailableIndex;
+    volatile USHORT *AvailableRing;
+    volatile USHORT *UsedEvent;
+    volatile USHORT *UsedFlags;
+    volatile USHORT *UsedIndex;
+    volatile VIRTIO_USED_ELEMENT *UsedRing;
+    volatile USHORT *AvailableEvent;
+    USHORT NextAvailable;
+    volatile VIRTIO_PACKED_DESCRIPTOR *PackedDescriptors;
+    volatile VIRTIO_PACKED_EVENT *DriverEvent;
+    volatile VIRTIO_PACKED_EVENT *DeviceEvent;
+    BOOL AvailableWrapCounter;
+    BOOL UsedWrapCounter;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines the state of one interrupt vector connected by the
+    virtio library.
+
+Members:
+
+    Device - Stores a pointer to the device that owns the interrupt.
+
+    Index - Stores the MSI-X table entry of the vector. This is always zero
+        for a line based interrupt.
+
+    Handle - Stores the connected interrupt handle.
+
+--*/
+
+typedef struct _VIRTIO_INTERRUPT {
+    PVIRTIO_DEVICE Device;
+    ULONG Index;
+    HANDLE Handle;
+} VIRTIO_INTERRUPT, *PVIRTIO_INTERRUPT;
+
+/*++
+
+Structure Description:
+
+    This structure defines a virtio PCI device.
+
+Members:
+
+    OsDevice - Stores a pointer to the OS device.
+
+    ConsumerContext - Stores the context pointer passed to the configuration
+        change routine.
+
+    ConfigurationChangeRoutine - Stores an optional pointer to a routine
+        called when the device configuration changes.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_DEVICE_FLAG_* definitions.
+
+    PciFlags - Stores a bitmask of PCI interface state. See VIRTIO_PCI_FLAG_*
+        definitions.
+
+    PciConfigInterface - Stores the PCI configuration space interface.
+
+    PciMsiInterface - Stores the PCI message signaled interrupt interface.
+
+    BarMapping - Stores the page aligned virtual address of each mapped BAR.
+
+    BarMappingSize - Stores the size of each BAR mapping, in bytes.
+
+    BarBase - Stores the virtual address of the start of each mapped BAR.
+
+    CommonConfiguration - Stores the mapped common configuration structure.
+
+    NotifyBase - Stores the mapped base of the notification region.
+
+    NotifyMultiplier - Stores the value each queue's notification offset is
+        multiplied by.
+
+    IsrStatus - Stores the mapped ISR status register.
+
+    DeviceConfiguration - Stores the mapped device specific configuration.
+
+    DeviceConfigurationSize - Stores the size of the device specific
+        configuration region.
+
+    DeviceFeatures - Stores the features offered by the device.
+
+    Features - Stores the negotiated features.
+
+    QueueCount - Stores the number of queues the device supports.
+
+    Queues - Stores an array of pointers to created queues, indexed by queue
+        number.
+
+    MaxInterruptGroups - Stores the maximum number of queue interrupt groups
+        the driver would like.
+
+    InterruptLine - Stores the interrupt line, or INVALID_INTERRUPT_LINE if
+        message signaled interrupts are in use.
+
+    InterruptVector - Stores the first interrupt vector.
+
+    InterruptCount - Stores the number of interrupt vectors connected.
+
+    Interrupts - Stores the array of connected interrupts.
+
+    PendingStatus - Stores the ISR status bits collected by the interrupt
+        service routine for line based interrupts.
+
+--*/
+
+struct _VIRTIO_DEVICE {
+    PDEVICE OsDevice;
+    PVOID ConsumerContext;
+    PVIRTIO_CONFIGURATION_CHANGE_ROUTINE ConfigurationChangeRoutine;
+    ULONG Flags;
+    ULONG PciFlags;
+    INTERFACE_PCI_CONFIG_ACCESS PciConfigInterface;
+    INTERFACE_PCI_MSI PciMsiInterface;
+    PVOID BarMapping[VIRTIO_PCI_BAR_COUNT];
+    UINTN BarMappingSize[VIRTIO_PCI_BAR_COUNT];
+    PVOID BarBase[VIRTIO_PCI_BAR_COUNT];
+    PVOID CommonConfiguration;
+    PVOID NotifyBase;
+    ULONG NotifyMultiplier;
+    PVOID IsrStatus;
+    PVOID DeviceConfiguration;
+    ULONG DeviceConfigurationSize;
+    ULONGLONG DeviceFeatures;
+    ULONGLONG Features;
+    ULONG QueueCount;
+    PVIRTIO_QUEUE *Queues;
+    ULONG MaxInterruptGroups;
+    ULONGLONG InterruptLine;
+    ULONGLONG InterruptVector;
+    ULONG InterruptCount;
+    PVIRTIO_INTERRUPT Interrupts;
+    volatile ULONG PendingStatus;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines the parameters passed to create a virtio device.
+
+Members:
+
+    Version - Stores the version of this structure. Set to
+        VIRTIO_INITIALIZATION_BLOCK_VERSION.
+
+    OsDevice - Stores a pointer to the OS device.
+
+    ConsumerContext - Stores a context pointer passed to the configuration
+        change routine.
+
+    ConfigurationChangeRoutine - Stores an optional pointer to a routine
+        called when the device configuration changes.
+
+    Flags - Stores a bitmask of flags. See VIRTIO_DEVICE_FLAG_* definitions.
+
+    MaxInterruptGroups - Stores the number of queue interrupt groups the
+        driver would like. Each group gets its own MSI-X vector if the device
+        and system allow it, steered to its own processor. Queues are placed
+        in groups when they are created.
+
+--*/
+
+typedef struct _VIRTIO_INITIALIZATION_BLOCK {
+    ULONG Version;
+    PDEVICE OsDevice;
+    PVOID ConsumerContext;
+    PVIRTIO_CONFIGURATION_CHANGE_ROUTINE ConfigurationChangeRoutine;
+    ULONG Flags;
+    ULONG MaxInterruptGroups;
+} VIRTIO_INITIALIZATION_BLOCK, *PVIRTIO_INITIALIZATION_BLOCK;
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+VIRTIO_API
+PVIRTIO_DEVICE
+VirtioCreateDevice (
+    PVIRTIO_INITIALIZATION_BLOCK Parameters
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new virtio device object.
+
+Arguments:
+
+    Parameters - Supplies a pointer to the parameters to use when creating the
+        device. This can be stack allocated.
+
+Return Value:
+
+    Returns a pointer to the device on success.
+
+    NULL on allocation failure or if the parameters are invalid.
+
+--*/
+
+VIRTIO_API
+VOID
+VirtioDestroyDevice (
+    PVIRTIO_DEVICE Device
+    );
+
+/*++
+
+Routine Description:
+
+    This routine resets and destroys a virtio device object, including all of
+    its queues and interrupts.
+
+Arguments:
+
+    Device - Supplies a pointer to the device to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioProcessResourceRequirements (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    );
+
+/*++
+
+Routine Description:
+
+    This routine filters through the resource requirements presented by the
+    bus for a virtio device. It requests one MSI-X vector for configuration
+    changes plus one per queue interrupt group if possible, and otherwise
+    adds a vector for the legacy interrupt line.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the query resources IRP, on its way up.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioStartDevice (
+    PVIRTIO_DEVICE Device,
+    PIRP Irp
+    );
+
+/*++
+
+Routine Description:
+
+    This routine maps the virtio structures of a device, resets it, connects
+    its interrupts, and reads the features it offers. On success the device
+    is in the acknowledged state, ready for feature negotiation.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Irp - Supplies a pointer to the start device IRP, on its way up.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioNegotiateFeatures (
+    PVIRTIO_DEVICE Device,
+    ULONGLONG DriverFeatures
+    );
+
+/*++
+
+Routine Description:
+
+    This routine negotiates the feature set with the device. The transport
+    features (version 1, event index and packed rings) are added to the
+    driver features automatically.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    DriverFeatures - Supplies the device specific features the driver
+        supports.
+
+Return Value:
+
+    STATUS_SUCCESS if the device accepted the negotiated features, which are
+    stored in the device's features member.
+
+    STATUS_NOT_SUPPORTED if the device rejected them.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioReadDeviceConfiguration (
+    PVIRTIO_DEVICE Device,
+    ULONG Offset,
+    ULONG Size,
+    PVOID Buffer
+    );
+
+/*++
+
+Routine Description:
+
+    This routine reads a field from the device specific configuration space,
+    retrying if the device changes the configuration in the middle.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Offset - Supplies the byte offset of the field.
+
+    Size - Supplies the size of the field. Sizes of 1, 2, 4, and 8 are read
+        with accesses of the natural width. Other sizes are read a byte at a
+        time.
+
+    Buffer - Supplies a pointer where the field is returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the field lies outside the configuration
+    space.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioCreateQueue (
+    PVIRTIO_DEVICE Device,
+    ULONG Index,
+    ULONG Size,
+    ULONG Group,
+    PVIRTIO_QUEUE_SERVICE_ROUTINE ServiceRoutine,
+    PVOID ServiceContext,
+    PVIRTIO_QUEUE *Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates and enables a virtqueue. This must be called after
+    the features are negotiated and before the device is set ready.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+    Index - Supplies the index of the queue to create.
+
+    Size - Supplies the desired number of entries, or 0 to use the default.
+        The device's maximum caps this value.
+
+    Group - Supplies the interrupt group the queue belongs to. Queues in the
+        same group share an interrupt vector.
+
+    ServiceRoutine - Supplies an optional pointer to the routine to call when
+        the device uses buffers. If this is NULL, the queue does not interrupt
+        and must be polled.
+
+    ServiceContext - Supplies the context pointer passed to the service
+        routine.
+
+    Queue - Supplies a pointer where a pointer to the queue is returned.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VIRTIO_API
+VOID
+VirtioSetDriverReady (
+    PVIRTIO_DEVICE Device
+    );
+
+/*++
+
+Routine Description:
+
+    This routine tells the device that the driver is fully set up, making the
+    device live.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    None.
+
+--*/
+
+VIRTIO_API
+ULONG
+VirtioGetInterruptGroupCount (
+    PVIRTIO_DEVICE Device
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of queue interrupt groups that got their
+    own interrupt vector. Group N is serviced on processor N modulo the
+    number of active processors.
+
+Arguments:
+
+    Device - Supplies a pointer to the virtio device.
+
+Return Value:
+
+    Returns the number of distinct interrupt groups, which is at least one.
+
+--*/
+
+VIRTIO_API
+KSTATUS
+VirtioQueueAdd (
+    PVIRTIO_QUEUE Queue,
+    PVIRTIO_BUFFER Buffers,
+    ULONG OutCount,
+    ULONG InCount,
+    PVOID Token
+    );
+
+/*++
+
+Routine Description:
+
+    This routine exposes a chain of buffers to the device. The device does not
+    see the buffers until the queue is kicked.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Buffers - Supplies an array of buffers. The device reads from the first
+        out count buffers and writes to the following in count buffers.
+
+    OutCount - Supplies the number of device readable buffers.
+
+    InCount - Supplies the number of device writable buffers.
+
+    Token - Supplies a non-null token returned when the device has used the
+        chain.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_RESOURCE_IN_USE if the queue does not have enough free descriptors.
+
+--*/
+
+VIRTIO_API
+VOID
+VirtioQueueKick (
+    PVIRTIO_QUEUE Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine publishes any added buffers and notifies the device, unless
+    the device has asked to have its notifications suppressed.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+VIRTIO_API
+PVOID
+VirtioQueueGetUsed (
+    PVIRTIO_QUEUE Queue,
+    PULONG Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine collects the next buffer chain the device has finished with.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+    Length - Supplies an optional pointer where the number of bytes the device
+        wrote into the chain is returned.
+
+Return Value:
+
+    Returns the token that was supplied when the chain was added.
+
+    NULL if the device has not used any more chains.
+
+--*/
+
+VIRTIO_API
+VOID
+VirtioQueueDisableNotifications (
+    PVIRTIO_QUEUE Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine asks the device not to interrupt when it uses buffers in the
+    given queue. This is only a hint, the device may interrupt anyway.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    None.
+
+--*/
+
+VIRTIO_API
+BOOL
+VirtioQueueEnableNotifications (
+    PVIRTIO_QUEUE Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine asks the device to interrupt the next time it uses a buffer
+    in the given queue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    TRUE if there are already used buffers waiting to be collected, in which
+    case the caller should process them rather than wait for an interrupt.
+
+    FALSE if the queue is idle.
+
+--*/
+
+VIRTIO_API
+ULONG
+VirtioQueueGetFreeCount (
+    PVIRTIO_QUEUE Queue
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of free descriptors in the queue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue.
+
+Return Value:
+
+    Returns the number of free descriptors.
+
+--*/
+
@@ -76,6 +76,7 @@ Return Value:
 {
 
     ULONG Architecture;
+    ARM_CPUID CpuInformation;
     PUSER_SHARED_DATA Data;
     ULONG MainId;
 
@@ -86,6 +87,12 @@ Return Value:
 
     if (Architecture == ARM_MAIN_ID_ARCHITECTURE_CPUID) {
         Data->ProcessorFeatures |= ARM_FEATURE_V7;
+        ArCpuid(&CpuInformation);
+        if ((CpuInformation.IsaFeatures[5] & CPUID_ISA5_CRC32_MASK) !=
+            CPUID_ISA5_CRC32_UNSUPPORTED) {
+
+            Data->ProcessorFeatures |= ARM_FEATURE_CRC32;
+        }
     }
 
     ArInitializeVfpSupport();
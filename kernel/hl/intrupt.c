@@ -1008,11 +1008,18 @@ Return Value:
     }
 
     //
-    // Get the default CPU interrupt line and associated flags.
+    // Get the default CPU interrupt line and associated flags. If the vectors
+    // are being steered at a specific processor, use fixed delivery so that
+    // the hardware does not arbitrate them away to another core.
     //
 
     HlpInterruptGetStandardCpuLine(&OutputLine);
     Flags = INTERRUPT_LINE_STATE_FLAG_LOWEST_PRIORITY;
+    if ((Processors->Target == ProcessorTargetSingleProcessor) ||
+        (Processors->Target == ProcessorTargetSelf)) {
+
+        Flags = 0;
+    }
 
     //
     // Find an interrupt controller that supports MSI/MSI-X. There should
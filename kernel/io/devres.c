@@ -546,6 +546,153 @@ Return Value:
     return Status;
 }
 
+KERNEL_API
+KSTATUS
+IoCreateAndAddMessageSignaledInterruptVectors (
+    PRESOURCE_CONFIGURATION_LIST ConfigurationList,
+    ULONG VectorCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a requirement for a contiguous block of message signaled
+    interrupt vectors to each configuration in the given list. These vectors
+    have no owning interrupt line. Every interrupt line in a configuration
+    also gets a legacy vector added as an alternative to the block, so that
+    the device can fall back to line based interrupts if the block cannot be
+    allocated.
+
+Arguments:
+
+    ConfigurationList - Supplies a pointer to the resource configuration list
+        to iterate through.
+
+    VectorCount - Supplies the number of message signaled vectors to request.
+        The block is aligned to the next power of two so that it can be used
+        for multi-message MSI as well as MSI-X.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if parameter validation failed.
+
+    STATUS_INSUFFICIENT_RESOURCES if the required memory could not be allocated.
+
+--*/
+
+{
+
+    ULONGLONG Alignment;
+    ULONGLONG LineCharacteristics;
+    PRESOURCE_REQUIREMENT Requirement;
+    PRESOURCE_REQUIREMENT_LIST RequirementList;
+    KSTATUS Status;
+    ULONGLONG VectorCharacteristics;
+    PRESOURCE_REQUIREMENT VectorRequirement;
+    RESOURCE_REQUIREMENT VectorTemplate;
+
+    if (VectorCount == 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto CreateAndAddMessageSignaledInterruptVectorsEnd;
+    }
+
+    if (ConfigurationList == NULL) {
+        Status = STATUS_SUCCESS;
+        goto CreateAndAddMessageSignaledInterruptVectorsEnd;
+    }
+
+    Alignment = 1;
+    while (Alignment < VectorCount) {
+        Alignment <<= 1;
+    }
+
+    RtlZeroMemory(&VectorTemplate, sizeof(RESOURCE_REQUIREMENT));
+    VectorTemplate.Type = ResourceTypeInterruptVector;
+    VectorTemplate.Minimum = 0;
+    VectorTemplate.Maximum = -1;
+    RequirementList = IoGetNextResourceConfiguration(ConfigurationList, NULL);
+    while (RequirementList != NULL) {
+
+        //
+        // Message signaled interrupts are always edge triggered, and the
+        // vectors cannot be shared since there is no line to chain them on.
+        //
+
+        VectorTemplate.Alignment = Alignment;
+        VectorTemplate.Length = VectorCount;
+        VectorTemplate.Characteristics = INTERRUPT_VECTOR_EDGE_TRIGGERED;
+        VectorTemplate.Flags = RESOURCE_FLAG_NOT_SHAREABLE;
+        VectorTemplate.OwningRequirement = NULL;
+        Status = IoCreateAndAddResourceRequirement(&VectorTemplate,
+                                                   RequirementList,
+                                                   &VectorRequirement);
+
+        if (!KSUCCESS(Status)) {
+            goto CreateAndAddMessageSignaledInterruptVectorsEnd;
+        }
+
+        //
+        // Add a single legacy vector alternative for each interrupt line in
+        // case the block above cannot be satisfied.
+        //
+
+        Requirement = IoGetNextResourceRequirement(RequirementList, NULL);
+        while (Requirement != NULL) {
+            if (Requirement->Type != ResourceTypeInterruptLine) {
+                Requirement = IoGetNextResourceRequirement(RequirementList,
+                                                           Requirement);
+
+                continue;
+            }
+
+            VectorCharacteristics = 0;
+            LineCharacteristics = Requirement->Characteristics;
+            if ((LineCharacteristics & INTERRUPT_LINE_ACTIVE_LOW) != 0) {
+                VectorCharacteristics |= INTERRUPT_VECTOR_ACTIVE_LOW;
+            }
+
+            if ((LineCharacteristics & INTERRUPT_LINE_ACTIVE_HIGH) != 0) {
+                VectorCharacteristics |= INTERRUPT_VECTOR_ACTIVE_HIGH;
+            }
+
+            if ((LineCharacteristics & INTERRUPT_LINE_EDGE_TRIGGERED) != 0) {
+                VectorCharacteristics |= INTERRUPT_VECTOR_EDGE_TRIGGERED;
+            }
+
+            VectorTemplate.Alignment = 1;
+            VectorTemplate.Length = 1;
+            VectorTemplate.Characteristics = VectorCharacteristics;
+            VectorTemplate.Flags = 0;
+            if ((LineCharacteristics & INTERRUPT_LINE_SECONDARY) != 0) {
+                VectorTemplate.Flags |= RESOURCE_FLAG_NOT_SHAREABLE;
+            }
+
+            VectorTemplate.OwningRequirement = Requirement;
+            Status = IoCreateAndAddResourceRequirementAlternative(
+                                                            &VectorTemplate,
+                                                            VectorRequirement);
+
+            if (!KSUCCESS(Status)) {
+                goto CreateAndAddMessageSignaledInterruptVectorsEnd;
+            }
+
+            Requirement = IoGetNextResourceRequirement(RequirementList,
+                                                       Requirement);
+        }
+
+        RequirementList = IoGetNextResourceConfiguration(ConfigurationList,
+                                                         RequirementList);
+    }
+
+    Status = STATUS_SUCCESS;
+
+CreateAndAddMessageSignaledInterruptVectorsEnd:
+    return Status;
+}
+
 KERNEL_API
 PRESOURCE_REQUIREMENT
 IoGetNextResourceRequirement (
@@ -59,6 +59,13 @@ IopGetCacheStatistics (
     BOOL Set
     );
 
+KSTATUS
+IopGetSetPipeSizeLimit (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -128,6 +135,10 @@ Return Value:
         Status = IopGetCacheStatistics(Data, DataSize, Set);
         break;
 
+    case IoInformationPipeSizeLimit:
+        Status = IopGetSetPipeSizeLimit(Data, DataSize, Set);
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         *DataSize = 0;
@@ -231,3 +242,67 @@ Return Value:
     return IoGetCacheStatistics(Data);
 }
 
+KSTATUS
+IopGetSetPipeSizeLimit (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the largest capacity an unprivileged caller can
+    give a pipe.
+
+Arguments:
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Limit;
+    ULONG PageSize;
+    KSTATUS Status;
+
+    if (*DataSize != sizeof(ULONG)) {
+        *DataSize = sizeof(ULONG);
+        return STATUS_DATA_LENGTH_MISMATCH;
+    }
+
+    if (Set == FALSE) {
+        *((PULONG)Data) = IoPipeMaxSize;
+        return STATUS_SUCCESS;
+    }
+
+    Status = PsCheckPermission(PERMISSION_RESOURCES);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    PageSize = MmPageSize();
+    Limit = *((PULONG)Data);
+    if ((Limit < PageSize) ||
+        (Limit > ALIGN_RANGE_DOWN(MAX_ULONG, PageSize))) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    IoPipeMaxSize = ALIGN_RANGE_UP(Limit, PageSize);
+    return STATUS_SUCCESS;
+}
+
@@ -40,6 +40,14 @@ Module Name:
 
 #define IO_RENAME_ATTEMPTS_MAX 10000
 
+//
+// Define the number of bytes moved at a time by a file range copy. This is a
+// multiple of any page size, so that after the first chunk reads stay page
+// aligned and can be satisfied directly by page cache entries.
+//
+
+#define IO_COPY_FILE_RANGE_CHUNK_SIZE (256 * _1KB)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -114,6 +122,11 @@ IopFixMountPointDirectoryEntries (
     UINTN BufferSize
     );
 
+BOOL
+IopIsFileRangeCopySupported (
+    PFILE_OBJECT FileObject
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -823,6 +836,212 @@ Return Value:
     return Status;
 }
 
+KERNEL_API
+KSTATUS
+IoCopyFileRange (
+    PIO_HANDLE InputHandle,
+    IO_OFFSET InputOffset,
+    PIO_HANDLE OutputHandle,
+    IO_OFFSET OutputOffset,
+    UINTN SizeInBytes,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data from one file or block device to another without
+    passing it through user mode. Reads from the input are satisfied with the
+    input's page cache entries directly where possible, so the data is only
+    copied once, into the output.
+
+Arguments:
+
+    InputHandle - Supplies the open I/O handle to read from.
+
+    InputOffset - Supplies the offset in the input to start reading from.
+        Supply IO_OFFSET_NONE to use and update the handle's current offset.
+
+    OutputHandle - Supplies the open I/O handle to write to.
+
+    OutputOffset - Supplies the offset in the output to start writing at.
+        Supply IO_OFFSET_NONE to use and update the handle's current offset.
+
+    SizeInBytes - Supplies the number of bytes to copy.
+
+    Flags - Supplies flags regarding the I/O operation. See IO_FLAG_*
+        definitions.
+
+    BytesCompleted - Supplies a pointer where the number of bytes copied will
+        be returned. This may be less than requested if the end of the input
+        is reached or a signal is pending.
+
+Return Value:
+
+    STATUS_SUCCESS if some bytes were copied or the input is at its end.
+
+    STATUS_NOT_SUPPORTED if either handle is not a regular file, block device,
+    or shared memory object. The caller should fall back to reading and
+    writing.
+
+    STATUS_INVALID_PARAMETER if the input and output are the same file and the
+    ranges overlap.
+
+    Other error codes on failure, in which case no bytes were copied.
+
+--*/
+
+{
+
+    UINTN BytesRead;
+    UINTN BytesThisRound;
+    UINTN BytesWritten;
+    PIO_BUFFER IoBuffer;
+    ULONG PageSize;
+    KSTATUS Status;
+    PKTHREAD Thread;
+    UINTN TotalBytesCopied;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    IoBuffer = NULL;
+    TotalBytesCopied = 0;
+    if ((InputHandle->HandleType != IoHandleTypeDefault) ||
+        (OutputHandle->HandleType != IoHandleTypeDefault) ||
+        (IopIsFileRangeCopySupported(InputHandle->FileObject) == FALSE) ||
+        (IopIsFileRangeCopySupported(OutputHandle->FileObject) == FALSE)) {
+
+        Status = STATUS_NOT_SUPPORTED;
+        goto CopyFileRangeEnd;
+    }
+
+    //
+    // Copying a file onto itself is only allowed with explicit ranges that
+    // don't overlap.
+    //
+
+    if (InputHandle->FileObject == OutputHandle->FileObject) {
+        if ((InputOffset == IO_OFFSET_NONE) ||
+            (OutputOffset == IO_OFFSET_NONE) ||
+            ((InputOffset < OutputOffset + SizeInBytes) &&
+             (OutputOffset < InputOffset + SizeInBytes))) {
+
+            Status = STATUS_INVALID_PARAMETER;
+            goto CopyFileRangeEnd;
+        }
+    }
+
+    PageSize = MmPageSize();
+    Thread = KeGetCurrentThread();
+    Status = STATUS_SUCCESS;
+    while (TotalBytesCopied < SizeInBytes) {
+        if ((TotalBytesCopied != 0) &&
+            (Thread->SignalPending != ThreadNoSignalPending)) {
+
+            break;
+        }
+
+        //
+        // Size the first chunk so that the following reads start on a page
+        // boundary if the input offset is known.
+        //
+
+        BytesThisRound = IO_COPY_FILE_RANGE_CHUNK_SIZE;
+        if ((InputOffset != IO_OFFSET_NONE) && (TotalBytesCopied == 0)) {
+            BytesThisRound -= REMAINDER(InputOffset, PageSize);
+        }
+
+        if (BytesThisRound > SizeInBytes - TotalBytesCopied) {
+            BytesThisRound = SizeInBytes - TotalBytesCopied;
+        }
+
+        //
+        // An uninitialized I/O buffer can be filled in with the input's page
+        // cache entries rather than having the data copied into it.
+        //
+
+        IoBuffer = MmAllocateUninitializedIoBuffer(
+                                      ALIGN_RANGE_UP(BytesThisRound, PageSize),
+                                      0);
+
+        if (IoBuffer == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            break;
+        }
+
+        Status = IoReadAtOffset(InputHandle,
+                                IoBuffer,
+                                InputOffset,
+                                BytesThisRound,
+                                Flags,
+                                WAIT_TIME_INDEFINITE,
+                                &BytesRead,
+                                NULL);
+
+        if ((Status == STATUS_END_OF_FILE) || (BytesRead == 0)) {
+            Status = STATUS_SUCCESS;
+            break;
+        }
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Status = IoWriteAtOffset(OutputHandle,
+                                 IoBuffer,
+                                 OutputOffset,
+                                 BytesRead,
+                                 Flags,
+                                 WAIT_TIME_INDEFINITE,
+                                 &BytesWritten,
+                                 NULL);
+
+        MmFreeIoBuffer(IoBuffer);
+        IoBuffer = NULL;
+        TotalBytesCopied += BytesWritten;
+        if (InputOffset != IO_OFFSET_NONE) {
+            InputOffset += BytesWritten;
+
+        //
+        // Put back anything that was read from the input's current position
+        // but didn't make it out.
+        //
+
+        } else if (BytesWritten != BytesRead) {
+            IoSeek(InputHandle,
+                   SeekCommandFromCurrentOffset,
+                   -(IO_OFFSET)(BytesRead - BytesWritten),
+                   NULL);
+        }
+
+        if (OutputOffset != IO_OFFSET_NONE) {
+            OutputOffset += BytesWritten;
+        }
+
+        if ((!KSUCCESS(Status)) || (BytesWritten != BytesRead)) {
+            break;
+        }
+    }
+
+    //
+    // Report partial progress as success.
+    //
+
+    if (TotalBytesCopied != 0) {
+        Status = STATUS_SUCCESS;
+    }
+
+CopyFileRangeEnd:
+    if (IoBuffer != NULL) {
+        MmFreeIoBuffer(IoBuffer);
+    }
+
+    *BytesCompleted = TotalBytesCopied;
+    return Status;
+}
+
 KERNEL_API
 KSTATUS
 IoFlush (
@@ -971,7 +1190,8 @@ Routine Description:
 
     SeekCommand - Supplies the reference point for the seek offset. Usual
         reference points are the beginning of the file, current file position,
-        and the end of the file.
+        and the end of the file. The data and hole commands seek to the next
+        data or hole at or after the given offset from the beginning.
 
     Offset - Supplies the offset from the reference point to move in bytes.
 
@@ -980,7 +1200,8 @@ Routine Description:
 
 Return Value:
 
-    Status code.
+    Status code. STATUS_END_OF_FILE is returned for the data and hole commands
+    if the offset is at or beyond the end of the file.
 
 --*/
 
@@ -1038,6 +1259,28 @@ Return Value:
             LocalNewOffset = Offset;
             break;
 
+        //
+        // None of the file systems leave unallocated holes in files, so
+        // everything up to the end of the file is data and the only hole is
+        // the implicit one at the end.
+        //
+
+        case SeekCommandData:
+        case SeekCommandHole:
+            FileSize = FileObject->Properties.Size;
+            if ((Offset < 0) || (Offset >= FileSize)) {
+                LocalNewOffset = OldOffset;
+                Status = STATUS_END_OF_FILE;
+                goto SeekEnd;
+            }
+
+            LocalNewOffset = Offset;
+            if (SeekCommand == SeekCommandHole) {
+                LocalNewOffset = FileSize;
+            }
+
+            break;
+
         default:
             LocalNewOffset = 0;
             Status = STATUS_INVALID_PARAMETER;
@@ -6024,3 +6267,47 @@ Return Value:
     return;
 }
 
+BOOL
+IopIsFileRangeCopySupported (
+    PFILE_OBJECT FileObject
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the given file object can be the
+    source or destination of a file range copy.
+
+Arguments:
+
+    FileObject - Supplies a pointer to the file object.
+
+Return Value:
+
+    TRUE if the object is a regular file, block device, or shared memory
+    object.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    if (FileObject == NULL) {
+        return FALSE;
+    }
+
+    switch (FileObject->Properties.Type) {
+    case IoObjectBlockDevice:
+    case IoObjectRegularFile:
+    case IoObjectSharedMemoryObject:
+        return TRUE;
+
+    default:
+        break;
+    }
+
+    return FALSE;
+}
+
@@ -1205,6 +1205,13 @@ extern POBJECT_HEADER IoIrpDirectory;
 
 extern POBJECT_HEADER IoPipeDirectory;
 
+//
+// Store the largest capacity a caller without the resources permission can
+// give a pipe.
+//
+
+extern ULONG IoPipeMaxSize;
+
 //
 // Store the saved boot information.
 //
@@ -3210,6 +3217,44 @@ Return Value:
 
 --*/
 
+KSTATUS
+IopGetSetPipeSize (
+    PIO_HANDLE Handle,
+    BOOL Set,
+    PULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of a pipe.
+
+Arguments:
+
+    Handle - Supplies a pointer to an I/O handle to the pipe.
+
+    Set - Supplies a boolean indicating whether to get the size (FALSE) or
+        set it (TRUE).
+
+    Size - Supplies a pointer that on input contains the requested capacity in
+        bytes for set operations. This is rounded up to a page. On output,
+        returns the actual capacity of the pipe.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the handle does not refer to a pipe.
+
+    STATUS_PERMISSION_DENIED if the requested size exceeds the pipe size
+    limit and the caller lacks the resources permission.
+
+    STATUS_RESOURCE_IN_USE if the pipe holds more data than the requested
+    size.
+
+--*/
+
 KSTATUS
 IopInitializeTerminalSupport (
     VOID
@@ -116,6 +116,13 @@ IopDestroyPipe (
 
 POBJECT_HEADER IoPipeDirectory;
 
+//
+// Store the largest capacity a caller without the resources permission can
+// give a pipe. This is adjustable through the system information interface.
+//
+
+ULONG IoPipeMaxSize = PIPE_DEFAULT_MAX_SIZE;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -387,7 +394,7 @@ Return Value:
 
     NewPipe->StreamBuffer = IoCreateStreamBuffer((*FileObject)->IoState,
                                                  0,
-                                                 0,
+                                                 PIPE_DEFAULT_SIZE,
                                                  PIPE_ATOMIC_WRITE_SIZE);
 
     if (NewPipe->StreamBuffer == NULL) {
@@ -793,6 +800,19 @@ Return Value:
         if (Pipe->ReaderCount == 0) {
             Status = STATUS_BROKEN_PIPE;
 
+        //
+        // Writers that promise not to touch their buffer until the write
+        // completes can have the readers copy straight out of it.
+        //
+
+        } else if ((IoContext->Flags & IO_FLAG_GIFT) != 0) {
+            Status = IoGiftStreamBuffer(Pipe->StreamBuffer,
+                                        IoContext->IoBuffer,
+                                        IoContext->SizeInBytes,
+                                        IoContext->TimeoutInMilliseconds,
+                                        NonBlocking,
+                                        &PipeBytesCompleted);
+
         } else {
             Status = IoWriteStreamBuffer(Pipe->StreamBuffer,
                                          IoContext->IoBuffer,
@@ -826,6 +846,86 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+IopGetSetPipeSize (
+    PIO_HANDLE Handle,
+    BOOL Set,
+    PULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of a pipe.
+
+Arguments:
+
+    Handle - Supplies a pointer to an I/O handle to the pipe.
+
+    Set - Supplies a boolean indicating whether to get the size (FALSE) or
+        set it (TRUE).
+
+    Size - Supplies a pointer that on input contains the requested capacity in
+        bytes for set operations. This is rounded up to a page. On output,
+        returns the actual capacity of the pipe.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the handle does not refer to a pipe.
+
+    STATUS_PERMISSION_DENIED if the requested size exceeds the pipe size
+    limit and the caller lacks the resources permission.
+
+    STATUS_RESOURCE_IN_USE if the pipe holds more data than the requested
+    size.
+
+--*/
+
+{
+
+    PFILE_OBJECT FileObject;
+    ULONG PageSize;
+    PPIPE Pipe;
+    ULONG RequestedSize;
+    KSTATUS Status;
+
+    FileObject = Handle->FileObject;
+    if (FileObject->Properties.Type != IoObjectPipe) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Pipe = FileObject->SpecialIo;
+
+    ASSERT(Pipe != NULL);
+
+    if (Set != FALSE) {
+        PageSize = MmPageSize();
+        RequestedSize = *Size;
+        if (RequestedSize < PageSize) {
+            RequestedSize = PageSize;
+        }
+
+        if (RequestedSize > ALIGN_RANGE_DOWN(MAX_ULONG, PageSize)) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        RequestedSize = ALIGN_RANGE_UP(RequestedSize, PageSize);
+        if (RequestedSize > IoPipeMaxSize) {
+            Status = PsCheckPermission(PERMISSION_RESOURCES);
+            if (!KSUCCESS(Status)) {
+                return Status;
+            }
+        }
+
+        *Size = RequestedSize;
+    }
+
+    return IoGetSetStreamBufferSize(Pipe->StreamBuffer, Set, Size);
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -44,6 +44,30 @@ Module Name:
 
 /*++
 
+Structure Description:
+
+    This structure describes a writer's buffer that was handed to a stream
+    buffer by reference. Readers copy straight out of the writer's locked
+    pages rather than out of the stream's own buffer.
+
+Members:
+
+    IoBuffer - Stores a pointer to the locked I/O buffer holding the data.
+
+    Offset - Stores the number of bytes the readers have consumed so far.
+
+    Size - Stores the total number of bytes being handed over.
+
+--*/
+
+typedef struct _STREAM_BUFFER_GIFT {
+    PIO_BUFFER IoBuffer;
+    UINTN Offset;
+    UINTN Size;
+} STREAM_BUFFER_GIFT, *PSTREAM_BUFFER_GIFT;
+
+/*++
+
 Structure Description:
 
     This structure describes characteristics about a data stream buffer.
@@ -71,6 +95,11 @@ Structure Description:
 
     IoState - Stores a pointer to the I/O object state.
 
+    Gift - Stores an optional pointer to a writer's buffer that has been
+        handed to the stream by reference. Its data logically follows
+        everything currently in the buffer, and other writers wait until the
+        readers have drained it.
+
 --*/
 
 struct _STREAM_BUFFER {
@@ -82,12 +111,23 @@ struct _STREAM_BUFFER {
     ULONG AtomicWriteSize;
     PQUEUED_LOCK Lock;
     PIO_OBJECT_STATE IoState;
+    PSTREAM_BUFFER_GIFT Gift;
 };
 
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+ULONG
+IopGetStreamBufferFreeSpace (
+    PSTREAM_BUFFER StreamBuffer
+    );
+
+VOID
+IopUpdateStreamBufferEvents (
+    PSTREAM_BUFFER StreamBuffer
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -305,8 +345,9 @@ Return Value:
 
     ULONG BytesAvailable;
     ULONG BytesReadHere;
-    ULONG BytesToRead;
+    UINTN BytesToRead;
     ULONG EventsMask;
+    PSTREAM_BUFFER_GIFT Gift;
     ULONG NextWriteOffset;
     ULONG ReturnedEvents;
     KSTATUS Status;
@@ -350,6 +391,54 @@ Return Value:
 
         KeAcquireQueuedLock(StreamBuffer->Lock);
 
+        //
+        // If the buffer has been drained and a writer handed over its pages,
+        // copy straight out of those.
+        //
+
+        if ((StreamBuffer->NextReadOffset == StreamBuffer->NextWriteOffset) &&
+            (StreamBuffer->Gift != NULL)) {
+
+            Gift = StreamBuffer->Gift;
+            BytesToRead = Gift->Size - Gift->Offset;
+            if (ByteCount < BytesToRead) {
+                BytesToRead = ByteCount;
+            }
+
+            Status = MmCopyIoBuffer(IoBuffer,
+                                    *BytesRead,
+                                    Gift->IoBuffer,
+                                    Gift->Offset,
+                                    BytesToRead);
+
+            if (KSUCCESS(Status)) {
+                Gift->Offset += BytesToRead;
+                if (Gift->Offset == Gift->Size) {
+                    StreamBuffer->Gift = NULL;
+                }
+
+                *BytesRead += BytesToRead;
+                BytesReadHere += BytesToRead;
+                ByteCount -= BytesToRead;
+            }
+
+            //
+            // Finishing the gift wakes its writer, which is waiting for the
+            // out event.
+            //
+
+            if ((ReturnedEvents & POLL_ERROR_EVENTS) == 0) {
+                IopUpdateStreamBufferEvents(StreamBuffer);
+            }
+
+            KeReleaseQueuedLock(StreamBuffer->Lock);
+            if (!KSUCCESS(Status)) {
+                return Status;
+            }
+
+            continue;
+        }
+
         //
         // Start over if there's nothing to read.
         //
@@ -486,14 +575,21 @@ Return Value:
 
         //
         // Signal the write event (since more space was just made), and signal
-        // the read event if there is still data left to be read. Don't do
-        // this if the error events are set, as this is probably a disconnected
-        // pipe with some data left in it.
+        // the read event if there is still data left to be read. Writers stay
+        // blocked while a gift is pending. Don't do this if the error events
+        // are set, as this is probably a disconnected pipe with some data left
+        // in it.
         //
 
         if ((ReturnedEvents & POLL_ERROR_EVENTS) == 0) {
-            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
-            if (StreamBuffer->NextReadOffset != StreamBuffer->NextWriteOffset) {
+            if (StreamBuffer->Gift == NULL) {
+                IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
+            }
+
+            if ((StreamBuffer->NextReadOffset !=
+                 StreamBuffer->NextWriteOffset) ||
+                (StreamBuffer->Gift != NULL)) {
+
                 IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
 
             } else {
@@ -643,11 +739,13 @@ Return Value:
         //
         // Start over if the buffer is full. The stream stipulates that it will
         // always be able to write at least the atomic size without
-        // interleaving.
+        // interleaving. Data handed over by reference must be drained before
+        // anything else can be written behind it.
         //
 
-        if ((TotalBytesAvailable < ByteCount) &&
-            (TotalBytesAvailable < StreamBuffer->AtomicWriteSize)) {
+        if ((StreamBuffer->Gift != NULL) ||
+            ((TotalBytesAvailable < ByteCount) &&
+             (TotalBytesAvailable < StreamBuffer->AtomicWriteSize))) {
 
             IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
             KeReleaseQueuedLock(StreamBuffer->Lock);
@@ -778,81 +876,326 @@ Return Value:
 }
 
 KSTATUS
-IoStreamBufferConnect (
-    PSTREAM_BUFFER StreamBuffer
+IoGiftStreamBuffer (
+    PSTREAM_BUFFER StreamBuffer,
+    PIO_BUFFER IoBuffer,
+    UINTN ByteCount,
+    ULONG TimeoutInMilliseconds,
+    BOOL NonBlocking,
+    PUINTN BytesWritten
     )
 
 /*++
 
 Routine Description:
 
-    This routine resets the I/O object state when someone connects to a stream
-    buffer.
+    This routine writes to a stream buffer by handing it the pages of the
+    given I/O buffer rather than copying them into the stream. The pages are
+    locked and readers copy directly out of them, saving a copy. This routine
+    does not return until the readers have consumed the data, an error
+    occurs, or the timeout expires. Small or non-blocking writes fall back to
+    a regular copying write. This routine must be called at low level.
 
 Arguments:
 
-    StreamBuffer - Supplies a pointer to the stream buffer.
+    StreamBuffer - Supplies a pointer to the stream buffer to write to.
+
+    IoBuffer - Supplies a pointer to the I/O buffer containing the data to
+        hand over to the stream buffer.
+
+    ByteCount - Supplies the number of bytes to write.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds that the I/O
+        operation should be waited on before timing out. Use
+        WAIT_TIME_INDEFINITE to wait forever on the I/O.
+
+    NonBlocking - Supplies a boolean indicating if this write should avoid
+        blocking.
+
+    BytesWritten - Supplies a pointer where the number of bytes actually
+        consumed by readers will be returned.
 
 Return Value:
 
-    Status code.
+    Status code. If a failing status code is returned, then check the number of
+    bytes written to see if any valid data was consumed.
 
 --*/
 
 {
 
-    ULONG TotalBytesAvailable;
+    ULONG EventsMask;
+    STREAM_BUFFER_GIFT Gift;
+    BOOL LockedCopy;
+    PIO_BUFFER LockedIoBuffer;
+    BOOL Published;
+    ULONG ReturnedEvents;
+    KSTATUS Status;
 
-    KeAcquireQueuedLock(StreamBuffer->Lock);
+    *BytesWritten = 0;
+    if ((NonBlocking != FALSE) || (ByteCount < MmPageSize())) {
+        return IoWriteStreamBuffer(StreamBuffer,
+                                   IoBuffer,
+                                   ByteCount,
+                                   TimeoutInMilliseconds,
+                                   NonBlocking,
+                                   BytesWritten);
+    }
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
 
     //
-    // Figure out how much space there is.
+    // Pin the writer's pages so the readers can get at them from their own
+    // process context. If the buffer could not simply be locked, copy it
+    // normally instead.
     //
 
-    if (StreamBuffer->NextReadOffset <= StreamBuffer->NextWriteOffset) {
+    LockedIoBuffer = IoBuffer;
+    Status = MmValidateIoBuffer(0,
+                                MAX_ULONGLONG,
+                                0,
+                                ByteCount,
+                                FALSE,
+                                &LockedIoBuffer,
+                                &LockedCopy);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if ((LockedIoBuffer != IoBuffer) && (LockedCopy == FALSE)) {
+        MmFreeIoBuffer(LockedIoBuffer);
+        return IoWriteStreamBuffer(StreamBuffer,
+                                   IoBuffer,
+                                   ByteCount,
+                                   TimeoutInMilliseconds,
+                                   NonBlocking,
+                                   BytesWritten);
+    }
+
+    Gift.IoBuffer = LockedIoBuffer;
+    Gift.Offset = 0;
+    Gift.Size = ByteCount;
+    EventsMask = POLL_EVENT_OUT | POLL_ERROR_EVENTS;
+    Published = FALSE;
+    while (TRUE) {
+        ReturnedEvents = 0;
+        Status = IoWaitForIoObjectState(StreamBuffer->IoState,
+                                        EventsMask,
+                                        TRUE,
+                                        TimeoutInMilliseconds,
+                                        &ReturnedEvents);
+
+        KeAcquireQueuedLock(StreamBuffer->Lock);
 
         //
-        // The total available is the entire buffer (minus one) minus the
-        // distance between the read and write pointers.
+        // Once published, the readers unhook the gift when they are done with
+        // it.
         //
 
-        TotalBytesAvailable = (StreamBuffer->Size - 1) -
-                              (StreamBuffer->NextWriteOffset -
-                               StreamBuffer->NextReadOffset);
+        if ((Published != FALSE) && (StreamBuffer->Gift != &Gift)) {
 
-    } else {
+            ASSERT(Gift.Offset == Gift.Size);
+
+            KeReleaseQueuedLock(StreamBuffer->Lock);
+            Status = STATUS_SUCCESS;
+            break;
+        }
+
+        if (KSUCCESS(Status) && (ReturnedEvents != POLL_EVENT_OUT)) {
+            Status = STATUS_BROKEN_PIPE;
+        }
 
         //
-        // The total available space is the distance between the write
-        // catching up to the read, minus the one buffer byte.
+        // On failure, take back whatever the readers have not consumed yet.
         //
 
-        TotalBytesAvailable = StreamBuffer->NextReadOffset -
-                              StreamBuffer->NextWriteOffset - 1;
+        if (!KSUCCESS(Status)) {
+            if (Published != FALSE) {
+                StreamBuffer->Gift = NULL;
+                if ((ReturnedEvents & POLL_ERROR_EVENTS) == 0) {
+                    IopUpdateStreamBufferEvents(StreamBuffer);
+                }
+            }
+
+            KeReleaseQueuedLock(StreamBuffer->Lock);
+            break;
+        }
+
+        //
+        // Publish the gift if nobody else's is pending. Anything already in
+        // the buffer gets read first, and other writers hold off until the
+        // gift is drained.
+        //
+
+        if ((Published == FALSE) && (StreamBuffer->Gift == NULL)) {
+            StreamBuffer->Gift = &Gift;
+            Published = TRUE;
+        }
+
+        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
+        if (Published != FALSE) {
+            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
+        }
+
+        KeReleaseQueuedLock(StreamBuffer->Lock);
+    }
+
+    *BytesWritten = Gift.Offset;
+    if (LockedIoBuffer != IoBuffer) {
+        MmFreeIoBuffer(LockedIoBuffer);
+    }
+
+    return Status;
+}
+
+KSTATUS
+IoGetSetStreamBufferSize (
+    PSTREAM_BUFFER StreamBuffer,
+    BOOL Set,
+    PULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of a stream buffer. Resizing
+    preserves any data currently in the buffer.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    Set - Supplies a boolean indicating whether to get the size (FALSE) or
+        set it (TRUE).
+
+    Size - Supplies a pointer that on input contains the new capacity in bytes
+        for set operations. The capacity is never made smaller than the atomic
+        write size. On output, returns the current capacity.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_RESOURCE_IN_USE if the buffer currently holds more data than the
+    requested size.
+
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
+{
+
+    ULONG BytesToCopy;
+    ULONG BytesUsed;
+    PVOID NewBuffer;
+    ULONG NewSize;
+    PVOID OldBuffer;
+
+    if (Set == FALSE) {
+        *Size = StreamBuffer->Size - 1;
+        return STATUS_SUCCESS;
     }
 
     //
-    // Signal the write event if there's space to be written.
+    // One byte of the buffer is always wasted.
     //
 
-    if (TotalBytesAvailable >= StreamBuffer->AtomicWriteSize) {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
+    NewSize = *Size;
+    if (NewSize < StreamBuffer->AtomicWriteSize) {
+        NewSize = StreamBuffer->AtomicWriteSize;
+    }
 
-    } else {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
+    if (NewSize + 1 < NewSize) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    NewSize += 1;
+    NewBuffer = MmAllocatePagedPool(NewSize, FI_ALLOCATION_TAG);
+    if (NewBuffer == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    KeAcquireQueuedLock(StreamBuffer->Lock);
+    BytesUsed = (StreamBuffer->Size - 1) -
+                IopGetStreamBufferFreeSpace(StreamBuffer);
+
+    if (BytesUsed >= NewSize) {
+        KeReleaseQueuedLock(StreamBuffer->Lock);
+        MmFreePagedPool(NewBuffer);
+        *Size = StreamBuffer->Size - 1;
+        return STATUS_RESOURCE_IN_USE;
     }
 
     //
-    // Signal the read event if there's data in there.
+    // Copy the existing contents to the start of the new buffer, unwrapping
+    // them if they wrapped around the end of the old one.
     //
 
-    if (TotalBytesAvailable != StreamBuffer->Size - 1) {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
+    if (BytesUsed != 0) {
+        BytesToCopy = StreamBuffer->Size - StreamBuffer->NextReadOffset;
+        if (BytesToCopy > BytesUsed) {
+            BytesToCopy = BytesUsed;
+        }
 
-    } else {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, FALSE);
+        RtlCopyMemory(NewBuffer,
+                      StreamBuffer->Buffer + StreamBuffer->NextReadOffset,
+                      BytesToCopy);
+
+        if (BytesToCopy != BytesUsed) {
+            RtlCopyMemory(NewBuffer + BytesToCopy,
+                          StreamBuffer->Buffer,
+                          BytesUsed - BytesToCopy);
+        }
     }
 
+    OldBuffer = StreamBuffer->Buffer;
+    StreamBuffer->Buffer = NewBuffer;
+    StreamBuffer->Size = NewSize;
+    StreamBuffer->NextReadOffset = 0;
+    StreamBuffer->NextWriteOffset = BytesUsed;
+
+    //
+    // Leave the events alone if an error is set, as the other side is gone.
+    //
+
+    if ((StreamBuffer->IoState->Events & POLL_ERROR_EVENTS) == 0) {
+        IopUpdateStreamBufferEvents(StreamBuffer);
+    }
+
+    KeReleaseQueuedLock(StreamBuffer->Lock);
+    MmFreePagedPool(OldBuffer);
+    *Size = NewSize - 1;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+IoStreamBufferConnect (
+    PSTREAM_BUFFER StreamBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resets the I/O object state when someone connects to a stream
+    buffer.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KeAcquireQueuedLock(StreamBuffer->Lock);
+    IopUpdateStreamBufferEvents(StreamBuffer);
     KeReleaseQueuedLock(StreamBuffer->Lock);
     return STATUS_SUCCESS;
 }
@@ -887,3 +1230,111 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+ULONG
+IopGetStreamBufferFreeSpace (
+    PSTREAM_BUFFER StreamBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the amount of free space in the stream buffer. The
+    caller must hold the stream buffer lock.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+Return Value:
+
+    Returns the number of bytes that can be written to the buffer.
+
+--*/
+
+{
+
+    ULONG TotalBytesAvailable;
+
+    if (StreamBuffer->NextReadOffset <= StreamBuffer->NextWriteOffset) {
+
+        //
+        // The total available is the entire buffer (minus one) minus the
+        // distance between the read and write pointers.
+        //
+
+        TotalBytesAvailable = (StreamBuffer->Size - 1) -
+                              (StreamBuffer->NextWriteOffset -
+                               StreamBuffer->NextReadOffset);
+
+    } else {
+
+        //
+        // The total available space is the distance between the write
+        // catching up to the read, minus the one buffer byte.
+        //
+
+        TotalBytesAvailable = StreamBuffer->NextReadOffset -
+                              StreamBuffer->NextWriteOffset - 1;
+    }
+
+    return TotalBytesAvailable;
+}
+
+VOID
+IopUpdateStreamBufferEvents (
+    PSTREAM_BUFFER StreamBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets the in and out events of a stream buffer to match its
+    contents. The caller must hold the stream buffer lock.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG TotalBytesAvailable;
+
+    TotalBytesAvailable = IopGetStreamBufferFreeSpace(StreamBuffer);
+
+    //
+    // Signal the write event if there's space to be written and nobody's
+    // gift is waiting to be drained.
+    //
+
+    if ((TotalBytesAvailable >= StreamBuffer->AtomicWriteSize) &&
+        (StreamBuffer->Gift == NULL)) {
+
+        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
+
+    } else {
+        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
+    }
+
+    //
+    // Signal the read event if there's data in there.
+    //
+
+    if ((TotalBytesAvailable != StreamBuffer->Size - 1) ||
+        (StreamBuffer->Gift != NULL)) {
+
+        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
+
+    } else {
+        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, FALSE);
+    }
+
+    return;
+}
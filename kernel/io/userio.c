@@ -501,6 +501,7 @@ Return Value:
     PKPROCESS CurrentProcess;
     PIO_HANDLE HandleValue;
     IO_BUFFER IoBuffer;
+    ULONG IoFlags;
     PSYSTEM_CALL_PERFORM_IO Parameters;
     INTN Result;
     INTN Size;
@@ -564,11 +565,16 @@ Return Value:
     //
 
     if ((Parameters->Flags & SYS_IO_FLAG_WRITE) != 0) {
+        IoFlags = 0;
+        if ((Parameters->Flags & SYS_IO_FLAG_GIFT) != 0) {
+            IoFlags |= IO_FLAG_GIFT;
+        }
+
         Status = IoWriteAtOffset(HandleValue,
                                  &IoBuffer,
                                  Parameters->Offset,
                                  Size,
-                                 0,
+                                 IoFlags,
                                  Timeout,
                                  &BytesCompleted,
                                  NULL);
@@ -666,6 +672,7 @@ Return Value:
     PKPROCESS CurrentProcess;
     PIO_HANDLE HandleValue;
     PIO_BUFFER IoBuffer;
+    ULONG IoFlags;
     PSYSTEM_CALL_PERFORM_VECTORED_IO Parameters;
     INTN Result;
     INTN Size;
@@ -720,11 +727,16 @@ Return Value:
     //
 
     if ((Parameters->Flags & SYS_IO_FLAG_WRITE) != 0) {
+        IoFlags = 0;
+        if ((Parameters->Flags & SYS_IO_FLAG_GIFT) != 0) {
+            IoFlags |= IO_FLAG_GIFT;
+        }
+
         Status = IoWriteAtOffset(HandleValue,
                                  IoBuffer,
                                  Parameters->Offset,
                                  (UINTN)Size,
-                                 0,
+                                 IoFlags,
                                  Timeout,
                                  &BytesCompleted,
                                  NULL);
@@ -794,6 +806,113 @@ Return Value:
     return Result;
 }
 
+INTN
+IoSysCopyFileRange (
+    PVOID SystemCallParameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies a range of one file to another for user mode.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or the number of bytes copied (a positive integer) on
+    success.
+
+    Error status code (a negative integer) on failure.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    PKPROCESS CurrentProcess;
+    PIO_HANDLE InputHandle;
+    PIO_HANDLE OutputHandle;
+    PSYSTEM_CALL_COPY_FILE_RANGE Parameters;
+    KSTATUS Status;
+
+    CurrentProcess = PsGetCurrentProcess();
+    Parameters = (PSYSTEM_CALL_COPY_FILE_RANGE)SystemCallParameter;
+    BytesCompleted = 0;
+    OutputHandle = NULL;
+    InputHandle = ObGetHandleValue(CurrentProcess->HandleTable,
+                                   Parameters->InputHandle,
+                                   NULL);
+
+    if (InputHandle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto SysCopyFileRangeEnd;
+    }
+
+    OutputHandle = ObGetHandleValue(CurrentProcess->HandleTable,
+                                    Parameters->OutputHandle,
+                                    NULL);
+
+    if (OutputHandle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto SysCopyFileRangeEnd;
+    }
+
+    if ((Parameters->Flags != 0) ||
+        ((Parameters->InputOffset < 0) &&
+         (Parameters->InputOffset != IO_OFFSET_NONE)) ||
+        ((Parameters->OutputOffset < 0) &&
+         (Parameters->OutputOffset != IO_OFFSET_NONE))) {
+
+        Status = STATUS_INVALID_PARAMETER;
+        goto SysCopyFileRangeEnd;
+    }
+
+    if (Parameters->Size <= 0) {
+        Status = STATUS_SUCCESS;
+        goto SysCopyFileRangeEnd;
+    }
+
+    Status = IoCopyFileRange(InputHandle,
+                             Parameters->InputOffset,
+                             OutputHandle,
+                             Parameters->OutputOffset,
+                             Parameters->Size,
+                             0,
+                             &BytesCompleted);
+
+SysCopyFileRangeEnd:
+    if (InputHandle != NULL) {
+        IoIoHandleReleaseReference(InputHandle);
+    }
+
+    if (OutputHandle != NULL) {
+        IoIoHandleReleaseReference(OutputHandle);
+    }
+
+    //
+    // If the copy got interrupted before anything moved, then the system call
+    // can be restarted if the signal handler allows.
+    //
+
+    if ((Status == STATUS_INTERRUPTED) && (BytesCompleted == 0)) {
+        Status = STATUS_RESTART_AFTER_SIGNAL;
+    }
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    ASSERT(BytesCompleted <= (UINTN)MAX_INTN);
+
+    return (INTN)BytesCompleted;
+}
+
 INTN
 IoSysFlush (
     PVOID SystemCallParameter
@@ -2195,6 +2314,41 @@ Return Value:
 
         break;
 
+    case FileControlCommandGetPipeSize:
+        Status = IopGetSetPipeSize(IoHandle,
+                                   FALSE,
+                                   &(LocalParameters.PipeSize));
+
+        if (KSUCCESS(Status)) {
+            CopyOutSize = sizeof(ULONG);
+        }
+
+        break;
+
+    case FileControlCommandSetPipeSize:
+        if (FileControl->Parameters == NULL) {
+            Status = STATUS_INVALID_PARAMETER;
+            goto SysFileControlEnd;
+        }
+
+        Status = MmCopyFromUserMode(&LocalParameters,
+                                    FileControl->Parameters,
+                                    sizeof(ULONG));
+
+        if (!KSUCCESS(Status)) {
+            goto SysFileControlEnd;
+        }
+
+        Status = IopGetSetPipeSize(IoHandle,
+                                   TRUE,
+                                   &(LocalParameters.PipeSize));
+
+        if (KSUCCESS(Status)) {
+            CopyOutSize = sizeof(ULONG);
+        }
+
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         break;
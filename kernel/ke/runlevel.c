@@ -56,6 +56,7 @@ Module Name:
 // --------------------------------------------------------- Internal Functions
 //
 
+KERNEL_API
 ULONG
 KeGetActiveProcessorCount (
     VOID
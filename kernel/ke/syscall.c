@@ -221,6 +221,7 @@ SYSTEM_CALL_TABLE_ENTRY KeSystemCallTable[SystemCallCount] = {
     {MmSysSetBreak,
         sizeof(SYSTEM_CALL_SET_BREAK),
         sizeof(SYSTEM_CALL_SET_BREAK)},
+    {IoSysCopyFileRange, sizeof(SYSTEM_CALL_COPY_FILE_RANGE), 0},
 };
 
 //
@@ -58,6 +58,13 @@ Module Name:
 
 #define MAX_PROCESS_NAME_LENGTH 11
 
+//
+// Define the maximum size of the stack region that a vfork caller can ask the
+// kernel to preserve for it.
+//
+
+#define PS_VFORK_MAX_FRAME_RESTORE_SIZE 0x1000
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -72,6 +79,11 @@ PspProcessChildrenOfTerminatingProcess (
     PKPROCESS Process
     );
 
+BOOL
+PspReleaseVforkAddressSpace (
+    PKPROCESS Process
+    );
+
 VOID
 PspLoaderThread (
     PVOID Context
@@ -380,7 +392,9 @@ Routine Description:
 
     This routine duplicates the current process, including all allocated
     address space and open file handles. Only the current thread's execution
-    continues in the new process.
+    continues in the new process. For vfork, the child shares the address space
+    and the calling thread does not return until the child executes a new
+    image or exits.
 
 Arguments:
 
@@ -399,14 +413,62 @@ Return Value:
 {
 
     PKTHREAD CurrentThread;
+    PVOID FrameRestore;
+    UINTN FrameRestoreSize;
     PKPROCESS NewProcess;
     INTN NewProcessId;
     PSYSTEM_CALL_FORK Parameters;
+    PVOID StackPointer;
     KSTATUS Status;
 
     CurrentThread = KeGetCurrentThread();
+    FrameRestore = NULL;
+    FrameRestoreSize = 0;
     NewProcess = NULL;
     Parameters = (PSYSTEM_CALL_FORK)SystemCallParameter;
+    StackPointer = NULL;
+
+    //
+    // For vfork, save the region of stack between the caller's stack pointer
+    // and the supplied base. The child runs on that same stack and will
+    // scribble over it on the way to executing its new image.
+    //
+
+    if (((Parameters->Flags & FORK_FLAG_VFORK) != 0) &&
+        (Parameters->FrameRestoreBase != NULL)) {
+
+        StackPointer = PspArchGetUserStackPointer(CurrentThread->TrapFrame);
+        if ((Parameters->FrameRestoreBase < StackPointer) ||
+            (Parameters->FrameRestoreBase > USER_VA_END)) {
+
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        FrameRestoreSize = (UINTN)(Parameters->FrameRestoreBase) -
+                           (UINTN)StackPointer;
+
+        if (FrameRestoreSize > PS_VFORK_MAX_FRAME_RESTORE_SIZE) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        if (FrameRestoreSize != 0) {
+            FrameRestore = MmAllocatePagedPool(FrameRestoreSize,
+                                               PS_ALLOCATION_TAG);
+
+            if (FrameRestore == NULL) {
+                return STATUS_INSUFFICIENT_RESOURCES;
+            }
+
+            Status = MmCopyFromUserMode(FrameRestore,
+                                        StackPointer,
+                                        FrameRestoreSize);
+
+            if (!KSUCCESS(Status)) {
+                goto SysForkProcessEnd;
+            }
+        }
+    }
+
     Status = PspCopyProcess(CurrentThread->OwningProcess,
                             CurrentThread,
                             CurrentThread->TrapFrame,
@@ -415,10 +477,35 @@ Return Value:
 
     if (!KSUCCESS(Status)) {
         RtlDebugPrint("Failed to fork %d\n", Status);
-        return Status;
+        goto SysForkProcessEnd;
     }
 
     NewProcessId = NewProcess->Identifiers.ProcessId;
+
+    //
+    // A vfork parent sleeps until the child is done with the address space,
+    // then puts back the stack the child may have trashed. The wait is not
+    // interruptible, as returning to user mode while the child is still
+    // running on the same stack would corrupt both of them.
+    //
+
+    if ((Parameters->Flags & FORK_FLAG_VFORK) != 0) {
+        KeWaitForEvent(NewProcess->VforkEvent, FALSE, WAIT_TIME_INDEFINITE);
+        ObReleaseReference(NewProcess);
+        if (FrameRestore != NULL) {
+            Status = MmCopyToUserMode(StackPointer,
+                                      FrameRestore,
+                                      FrameRestoreSize);
+
+            MmFreePagedPool(FrameRestore);
+            if (!KSUCCESS(Status)) {
+                return Status;
+            }
+        }
+
+        return NewProcessId;
+    }
+
     ObReleaseReference(NewProcess);
 
     //
@@ -430,6 +517,13 @@ Return Value:
 
     KeYield();
     return NewProcessId;
+
+SysForkProcessEnd:
+    if (FrameRestore != NULL) {
+        MmFreePagedPool(FrameRestore);
+    }
+
+    return Status;
 }
 
 INTN
@@ -615,9 +709,19 @@ Return Value:
 
     Process->SignalHandlerRoutine = NULL;
     INITIALIZE_SIGNAL_SET(Process->HandledSignals);
-    PspSetThreadUserStackSize(Thread, 0);
-    PspImUnloadAllImages(Process);
-    MmCleanUpProcessMemory(Process->AddressSpace, FALSE);
+
+    //
+    // A vfork child gives the parent's address space back here and moves into
+    // its own pristine one, waking the parent. Otherwise, tear down the old
+    // image in place.
+    //
+
+    if (PspReleaseVforkAddressSpace(Process) == FALSE) {
+        PspSetThreadUserStackSize(Thread, 0);
+        PspImUnloadAllImages(Process);
+        MmCleanUpProcessMemory(Process->AddressSpace, FALSE);
+    }
+
     NewName = RtlStringFindCharacterRight(NewEnvironment->ImageName,
                                           '/',
                                           NewEnvironment->ImageNameLength);
@@ -1960,23 +2064,48 @@ Return Value:
     }
 
     //
-    // Copy the process address space.
+    // A vfork child borrows the parent's address space outright rather than
+    // copying it. Its own (empty) address space is stashed away until the
+    // child executes a new image or exits, at which point the parent is woken
+    // up. The image list is not copied, as the child is not allowed to load
+    // or unload anything in the borrowed address space.
     //
 
-    Status = MmCloneAddressSpace(Process->AddressSpace,
-                                 NewProcess->AddressSpace);
+    if ((Flags & FORK_FLAG_VFORK) != 0) {
+        NewProcess->VforkEvent = KeCreateEvent(NULL);
+        if (NewProcess->VforkEvent == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto CopyProcessEnd;
+        }
 
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
-    }
+        MmUpdatePageDirectory(Process->AddressSpace,
+                              KernelStack,
+                              DEFAULT_KERNEL_STACK_SIZE);
 
-    //
-    // Copy the image list.
-    //
+        NewProcess->VforkAddressSpace = NewProcess->AddressSpace;
+        NewProcess->AddressSpace = Process->AddressSpace;
 
-    Status = PspImCloneProcessImages(Process, NewProcess);
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
+    } else {
+
+        //
+        // Copy the process address space.
+        //
+
+        Status = MmCloneAddressSpace(Process->AddressSpace,
+                                     NewProcess->AddressSpace);
+
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
+
+        //
+        // Copy the image list.
+        //
+
+        Status = PspImCloneProcessImages(Process, NewProcess);
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
     }
 
     //
@@ -2946,6 +3075,68 @@ Return Value:
     return Status;
 }
 
+BOOL
+PspReleaseVforkAddressSpace (
+    PKPROCESS Process
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a borrowed address space to the parent of a vfork
+    child, switches the child over to its own address space, and wakes up the
+    parent.
+
+Arguments:
+
+    Process - Supplies a pointer to the process that may be a vfork child.
+
+Return Value:
+
+    TRUE if the process was borrowing its parent's address space. The process
+    now has its own empty address space.
+
+    FALSE if the process already had its own address space.
+
+--*/
+
+{
+
+    PADDRESS_SPACE AddressSpace;
+    RUNLEVEL OldRunLevel;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    AddressSpace = Process->VforkAddressSpace;
+    if (AddressSpace == NULL) {
+        return FALSE;
+    }
+
+    //
+    // The memory map limit is normally inherited via the address space clone.
+    // Carry it over by hand instead.
+    //
+
+    AddressSpace->MaxMemoryMap = Process->AddressSpace->MaxMemoryMap;
+
+    //
+    // Swap the address space at dispatch so that the context switch code
+    // cannot observe the process pointer and the processor disagreeing.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Process->VforkAddressSpace = NULL;
+    Process->AddressSpace = AddressSpace;
+    if (KeGetCurrentThread()->OwningProcess == Process) {
+        MmSwitchAddressSpace(KeGetCurrentProcessorBlock(), AddressSpace);
+    }
+
+    KeLowerRunLevel(OldRunLevel);
+    KeSignalEvent(Process->VforkEvent, SignalOptionSignalAll);
+    return TRUE;
+}
+
 VOID
 PspProcessTermination (
     PKPROCESS Process
@@ -2978,7 +3169,17 @@ Return Value:
     PspDestroyProcessTimers(Process);
     PspImUnloadAllImages(Process);
     IoCloseProcessHandles(Process, 0);
-    MmCleanUpProcessMemory(Process->AddressSpace, TRUE);
+
+    //
+    // A vfork child that never executed anything hands the address space back
+    // to its parent. Its own address space was never used, so there is
+    // nothing in it to clean up.
+    //
+
+    if (PspReleaseVforkAddressSpace(Process) == FALSE) {
+        MmCleanUpProcessMemory(Process->AddressSpace, TRUE);
+    }
+
     if (PsIsSessionLeader(Process)) {
         IoTerminalDisassociate(Process);
     }
@@ -3343,6 +3544,10 @@ Return Value:
 
     ASSERT(Process->AddressSpace->ResidentSet <= 1);
 
+    if (Process->VforkEvent != NULL) {
+        KeDestroyEvent(Process->VforkEvent);
+    }
+
     //
     // Clean up the debug data if present.
     //
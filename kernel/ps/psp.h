@@ -980,6 +980,28 @@ Return Value:
 
 --*/
 
+PVOID
+PspArchGetUserStackPointer (
+    PTRAP_FRAME TrapFrame
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the user mode stack pointer from the given trap
+    frame.
+
+Arguments:
+
+    TrapFrame - Supplies a pointer to a user mode trap frame.
+
+Return Value:
+
+    Returns the user mode stack pointer.
+
+--*/
+
 KSTATUS
 PspArchGetDebugBreakInformation (
     PTRAP_FRAME TrapFrame
@@ -1140,12 +1140,15 @@ Return Value:
 
     //
     // The user stack is presumed to be set up in the new process at the same
-    // place.
+    // place. A vfork child runs on the parent's stack but does not own it.
     //
 
     NewThread->BlockedSignals = Thread->BlockedSignals;
-    NewThread->UserStack = Thread->UserStack;
-    NewThread->UserStackSize = Thread->UserStackSize;
+    if (DestinationProcess->VforkAddressSpace == NULL) {
+        NewThread->UserStack = Thread->UserStack;
+        NewThread->UserStackSize = Thread->UserStackSize;
+    }
+
     PspPrepareThreadForFirstRun(NewThread, TrapFrame, FALSE);
     NewThread->ThreadPointer = Thread->ThreadPointer;
     NewThread->ThreadIdPointer = Thread->ThreadIdPointer;
@@ -75,7 +75,49 @@ Return Value:
 
 {
 
+    PUSER_SHARED_DATA Data;
+    ULONG Eax;
+    ULONG Ebx;
+    ULONG Ecx;
+    ULONG Edx;
     ULONGLONG Efer;
+    ULONG ExtendedFeatures;
+
+    //
+    // FXSAVE and SSE2 are part of the base 64-bit architecture. Pick up the
+    // optional instructions that use the SSE registers.
+    //
+
+    Data = MmGetUserSharedData();
+    Data->ProcessorFeatures |= X86_FEATURE_FXSAVE | X86_FEATURE_SSE2;
+    Eax = X86_CPUID_IDENTIFICATION;
+    ArCpuid(&Eax, &Ebx, &Ecx, &Edx);
+    ExtendedFeatures = 0;
+    if (Eax >= X86_CPUID_EXTENDED_FEATURES) {
+        Eax = X86_CPUID_EXTENDED_FEATURES;
+        Ecx = 0;
+        ArCpuid(&Eax, &Ebx, &Ecx, &Edx);
+        ExtendedFeatures = Ebx;
+    }
+
+    Eax = X86_CPUID_BASIC_INFORMATION;
+    ArCpuid(&Eax, &Ebx, &Ecx, &Edx);
+    if ((Ecx & X86_CPUID_BASIC_ECX_PCLMULQDQ) != 0) {
+        Data->ProcessorFeatures |= X86_FEATURE_PCLMULQDQ;
+    }
+
+    if (((Ecx & X86_CPUID_BASIC_ECX_AES) != 0) &&
+        ((Ecx & X86_CPUID_BASIC_ECX_SSSE3) != 0)) {
+
+        Data->ProcessorFeatures |= X86_FEATURE_AES;
+    }
+
+    if (((ExtendedFeatures & X86_CPUID_EXTENDED_FEATURES_EBX_SHA) != 0) &&
+        ((Ecx & X86_CPUID_BASIC_ECX_SSSE3) != 0) &&
+        ((Ecx & X86_CPUID_BASIC_ECX_SSE4_1) != 0)) {
+
+        Data->ProcessorFeatures |= X86_FEATURE_SHA;
+    }
 
     //
     // Set up the syscall mechanism.
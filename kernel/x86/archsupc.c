@@ -80,6 +80,7 @@ Return Value:
     ULONG Ebx;
     ULONG Ecx;
     ULONG Edx;
+    ULONG ExtendedFeatures;
     PPROCESSOR_BLOCK ProcessorBlock;
     PTSS Tss;
 
@@ -90,6 +91,19 @@ Return Value:
         return;
     }
 
+    //
+    // Grab the structured extended features first, since the basic
+    // information registers are needed through the rest of the function.
+    //
+
+    ExtendedFeatures = 0;
+    if (Eax >= X86_CPUID_EXTENDED_FEATURES) {
+        Eax = X86_CPUID_EXTENDED_FEATURES;
+        Ecx = 0;
+        ArCpuid(&Eax, &Ebx, &Ecx, &Edx);
+        ExtendedFeatures = Ebx;
+    }
+
     Eax = X86_CPUID_BASIC_INFORMATION;
     ArCpuid(&Eax, &Ebx, &Ecx, &Edx);
 
@@ -105,6 +119,33 @@ Return Value:
         Data->ProcessorFeatures |= X86_FEATURE_I686;
     }
 
+    //
+    // SSE registers are only saved across context switches if FXSAVE is in
+    // use, so only advertise SSE2 if both are present.
+    //
+
+    if (((Edx & X86_CPUID_BASIC_EDX_SSE2) != 0) &&
+        ((Edx & X86_CPUID_BASIC_EDX_FX_SAVE_RESTORE) != 0)) {
+
+        Data->ProcessorFeatures |= X86_FEATURE_SSE2;
+        if ((Ecx & X86_CPUID_BASIC_ECX_PCLMULQDQ) != 0) {
+            Data->ProcessorFeatures |= X86_FEATURE_PCLMULQDQ;
+        }
+
+        if (((Ecx & X86_CPUID_BASIC_ECX_AES) != 0) &&
+            ((Ecx & X86_CPUID_BASIC_ECX_SSSE3) != 0)) {
+
+            Data->ProcessorFeatures |= X86_FEATURE_AES;
+        }
+
+        if (((ExtendedFeatures & X86_CPUID_EXTENDED_FEATURES_EBX_SHA) != 0) &&
+            ((Ecx & X86_CPUID_BASIC_ECX_SSSE3) != 0) &&
+            ((Ecx & X86_CPUID_BASIC_ECX_SSE4_1) != 0)) {
+
+            Data->ProcessorFeatures |= X86_FEATURE_SHA;
+        }
+    }
+
     //
     // In 32-bit mode, shoot for sysenter, and then syscall. (Note that in
     // long mode, syscall is just assumed to be present architecturally).
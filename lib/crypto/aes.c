@@ -79,6 +79,41 @@ Module Name:
      (_F8) ^= AES_ROTATE2(_F4),                             \
      (_F8) ^ AES_ROTATE1(_F9))
 
+//
+// This macro computes one column of a full encryption round given the state
+// columns that feed each of its rows after the row shift.
+//
+
+#define AES_ENCRYPT_COLUMN(_Value0, _Value1, _Value2, _Value3, _Key)  \
+    (CyAesEncryptTable[(_Value0) >> 24] ^                           \
+     AES_ROTATE1(CyAesEncryptTable[((_Value1) >> 16) & 0xFF]) ^     \
+     AES_ROTATE2(CyAesEncryptTable[((_Value2) >> 8) & 0xFF]) ^      \
+     AES_ROTATE3(CyAesEncryptTable[(_Value3) & 0xFF]) ^             \
+     (_Key))
+
+//
+// This macro computes one column of a full round of the equivalent inverse
+// cipher.
+//
+
+#define AES_DECRYPT_COLUMN(_Value0, _Value1, _Value2, _Value3, _Key)  \
+    (CyAesDecryptTable[(_Value0) >> 24] ^                           \
+     AES_ROTATE1(CyAesDecryptTable[((_Value1) >> 16) & 0xFF]) ^     \
+     AES_ROTATE2(CyAesDecryptTable[((_Value2) >> 8) & 0xFF]) ^      \
+     AES_ROTATE3(CyAesDecryptTable[(_Value3) & 0xFF]) ^             \
+     (_Key))
+
+//
+// This macro performs the byte substitution and row shift steps for one
+// column, as done in the final round.
+//
+
+#define AES_SUBSTITUTE_COLUMN(_Sbox, _Value0, _Value1, _Value2, _Value3) \
+    (((ULONG)(_Sbox)[(_Value0) >> 24] << 24) |                          \
+     ((ULONG)(_Sbox)[((_Value1) >> 16) & 0xFF] << 16) |                 \
+     ((ULONG)(_Sbox)[((_Value2) >> 8) & 0xFF] << 8) |                   \
+     (ULONG)(_Sbox)[(_Value3) & 0xFF])
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -103,11 +138,6 @@ CypAesDecryptBlock (
     PULONG Block
     );
 
-UCHAR
-CypAesXtime (
-    UCHAR Value
-    );
-
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -186,6 +216,105 @@ static const UCHAR CyAesInvertedSbox[256] = {
     0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
 };
 
+//
+// Define the combined substitution and mix columns tables. Each entry holds
+// the mix columns coefficients {2, 1, 1, 3} (or {E, 9, D, B} for decryption)
+// multiplied by the S-Box (or inverse S-Box) value of the index. The tables
+// for the other three rows of a column are byte rotations of these.
+//
+
+static const ULONG CyAesEncryptTable[256] = {
+    0xC66363A5, 0xF87C7C84, 0xEE777799, 0xF67B7B8D, 0xFFF2F20D, 0xD66B6BBD,
+    0xDE6F6FB1, 0x91C5C554, 0x60303050, 0x02010103, 0xCE6767A9, 0x562B2B7D,
+    0xE7FEFE19, 0xB5D7D762, 0x4DABABE6, 0xEC76769A, 0x8FCACA45, 0x1F82829D,
+    0x89C9C940, 0xFA7D7D87, 0xEFFAFA15, 0xB25959EB, 0x8E4747C9, 0xFBF0F00B,
+    0x41ADADEC, 0xB3D4D467, 0x5FA2A2FD, 0x45AFAFEA, 0x239C9CBF, 0x53A4A4F7,
+    0xE4727296, 0x9BC0C05B, 0x75B7B7C2, 0xE1FDFD1C, 0x3D9393AE, 0x4C26266A,
+    0x6C36365A, 0x7E3F3F41, 0xF5F7F702, 0x83CCCC4F, 0x6834345C, 0x51A5A5F4,
+    0xD1E5E534, 0xF9F1F108, 0xE2717193, 0xABD8D873, 0x62313153, 0x2A15153F,
+    0x0804040C, 0x95C7C752, 0x46232365, 0x9DC3C35E, 0x30181828, 0x379696A1,
+    0x0A05050F, 0x2F9A9AB5, 0x0E070709, 0x24121236, 0x1B80809B, 0xDFE2E23D,
+    0xCDEBEB26, 0x4E272769, 0x7FB2B2CD, 0xEA75759F, 0x1209091B, 0x1D83839E,
+    0x582C2C74, 0x341A1A2E, 0x361B1B2D, 0xDC6E6EB2, 0xB45A5AEE, 0x5BA0A0FB,
+    0xA45252F6, 0x763B3B4D, 0xB7D6D661, 0x7DB3B3CE, 0x5229297B, 0xDDE3E33E,
+    0x5E2F2F71, 0x13848497, 0xA65353F5, 0xB9D1D168, 0x00000000, 0xC1EDED2C,
+    0x40202060, 0xE3FCFC1F, 0x79B1B1C8, 0xB65B5BED, 0xD46A6ABE, 0x8DCBCB46,
+    0x67BEBED9, 0x7239394B, 0x944A4ADE, 0x984C4CD4, 0xB05858E8, 0x85CFCF4A,
+    0xBBD0D06B, 0xC5EFEF2A, 0x4FAAAAE5, 0xEDFBFB16, 0x864343C5, 0x9A4D4DD7,
+    0x66333355, 0x11858594, 0x8A4545CF, 0xE9F9F910, 0x04020206, 0xFE7F7F81,
+    0xA05050F0, 0x783C3C44, 0x259F9FBA, 0x4BA8A8E3, 0xA25151F3, 0x5DA3A3FE,
+    0x804040C0, 0x058F8F8A, 0x3F9292AD, 0x219D9DBC, 0x70383848, 0xF1F5F504,
+    0x63BCBCDF, 0x77B6B6C1, 0xAFDADA75, 0x42212163, 0x20101030, 0xE5FFFF1A,
+    0xFDF3F30E, 0xBFD2D26D, 0x81CDCD4C, 0x180C0C14, 0x26131335, 0xC3ECEC2F,
+    0xBE5F5FE1, 0x359797A2, 0x884444CC, 0x2E171739, 0x93C4C457, 0x55A7A7F2,
+    0xFC7E7E82, 0x7A3D3D47, 0xC86464AC, 0xBA5D5DE7, 0x3219192B, 0xE6737395,
+    0xC06060A0, 0x19818198, 0x9E4F4FD1, 0xA3DCDC7F, 0x44222266, 0x542A2A7E,
+    0x3B9090AB, 0x0B888883, 0x8C4646CA, 0xC7EEEE29, 0x6BB8B8D3, 0x2814143C,
+    0xA7DEDE79, 0xBC5E5EE2, 0x160B0B1D, 0xADDBDB76, 0xDBE0E03B, 0x64323256,
+    0x743A3A4E, 0x140A0A1E, 0x924949DB, 0x0C06060A, 0x4824246C, 0xB85C5CE4,
+    0x9FC2C25D, 0xBDD3D36E, 0x43ACACEF, 0xC46262A6, 0x399191A8, 0x319595A4,
+    0xD3E4E437, 0xF279798B, 0xD5E7E732, 0x8BC8C843, 0x6E373759, 0xDA6D6DB7,
+    0x018D8D8C, 0xB1D5D564, 0x9C4E4ED2, 0x49A9A9E0, 0xD86C6CB4, 0xAC5656FA,
+    0xF3F4F407, 0xCFEAEA25, 0xCA6565AF, 0xF47A7A8E, 0x47AEAEE9, 0x10080818,
+    0x6FBABAD5, 0xF0787888, 0x4A25256F, 0x5C2E2E72, 0x381C1C24, 0x57A6A6F1,
+    0x73B4B4C7, 0x97C6C651, 0xCBE8E823, 0xA1DDDD7C, 0xE874749C, 0x3E1F1F21,
+    0x964B4BDD, 0x61BDBDDC, 0x0D8B8B86, 0x0F8A8A85, 0xE0707090, 0x7C3E3E42,
+    0x71B5B5C4, 0xCC6666AA, 0x904848D8, 0x06030305, 0xF7F6F601, 0x1C0E0E12,
+    0xC26161A3, 0x6A35355F, 0xAE5757F9, 0x69B9B9D0, 0x17868691, 0x99C1C158,
+    0x3A1D1D27, 0x279E9EB9, 0xD9E1E138, 0xEBF8F813, 0x2B9898B3, 0x22111133,
+    0xD26969BB, 0xA9D9D970, 0x078E8E89, 0x339494A7, 0x2D9B9BB6, 0x3C1E1E22,
+    0x15878792, 0xC9E9E920, 0x87CECE49, 0xAA5555FF, 0x50282878, 0xA5DFDF7A,
+    0x038C8C8F, 0x59A1A1F8, 0x09898980, 0x1A0D0D17, 0x65BFBFDA, 0xD7E6E631,
+    0x844242C6, 0xD06868B8, 0x824141C3, 0x299999B0, 0x5A2D2D77, 0x1E0F0F11,
+    0x7BB0B0CB, 0xA85454FC, 0x6DBBBBD6, 0x2C16163A
+};
+
+static const ULONG CyAesDecryptTable[256] = {
+    0x51F4A750, 0x7E416553, 0x1A17A4C3, 0x3A275E96, 0x3BAB6BCB, 0x1F9D45F1,
+    0xACFA58AB, 0x4BE30393, 0x2030FA55, 0xAD766DF6, 0x88CC7691, 0xF5024C25,
+    0x4FE5D7FC, 0xC52ACBD7, 0x26354480, 0xB562A38F, 0xDEB15A49, 0x25BA1B67,
+    0x45EA0E98, 0x5DFEC0E1, 0xC32F7502, 0x814CF012, 0x8D4697A3, 0x6BD3F9C6,
+    0x038F5FE7, 0x15929C95, 0xBF6D7AEB, 0x955259DA, 0xD4BE832D, 0x587421D3,
+    0x49E06929, 0x8EC9C844, 0x75C2896A, 0xF48E7978, 0x99583E6B, 0x27B971DD,
+    0xBEE14FB6, 0xF088AD17, 0xC920AC66, 0x7DCE3AB4, 0x63DF4A18, 0xE51A3182,
+    0x97513360, 0x62537F45, 0xB16477E0, 0xBB6BAE84, 0xFE81A01C, 0xF9082B94,
+    0x70486858, 0x8F45FD19, 0x94DE6C87, 0x527BF8B7, 0xAB73D323, 0x724B02E2,
+    0xE31F8F57, 0x6655AB2A, 0xB2EB2807, 0x2FB5C203, 0x86C57B9A, 0xD33708A5,
+    0x302887F2, 0x23BFA5B2, 0x02036ABA, 0xED16825C, 0x8ACF1C2B, 0xA779B492,
+    0xF307F2F0, 0x4E69E2A1, 0x65DAF4CD, 0x0605BED5, 0xD134621F, 0xC4A6FE8A,
+    0x342E539D, 0xA2F355A0, 0x058AE132, 0xA4F6EB75, 0x0B83EC39, 0x4060EFAA,
+    0x5E719F06, 0xBD6E1051, 0x3E218AF9, 0x96DD063D, 0xDD3E05AE, 0x4DE6BD46,
+    0x91548DB5, 0x71C45D05, 0x0406D46F, 0x605015FF, 0x1998FB24, 0xD6BDE997,
+    0x894043CC, 0x67D99E77, 0xB0E842BD, 0x07898B88, 0xE7195B38, 0x79C8EEDB,
+    0xA17C0A47, 0x7C420FE9, 0xF8841EC9, 0x00000000, 0x09808683, 0x322BED48,
+    0x1E1170AC, 0x6C5A724E, 0xFD0EFFFB, 0x0F853856, 0x3DAED51E, 0x362D3927,
+    0x0A0FD964, 0x685CA621, 0x9B5B54D1, 0x24362E3A, 0x0C0A67B1, 0x9357E70F,
+    0xB4EE96D2, 0x1B9B919E, 0x80C0C54F, 0x61DC20A2, 0x5A774B69, 0x1C121A16,
+    0xE293BA0A, 0xC0A02AE5, 0x3C22E043, 0x121B171D, 0x0E090D0B, 0xF28BC7AD,
+    0x2DB6A8B9, 0x141EA9C8, 0x57F11985, 0xAF75074C, 0xEE99DDBB, 0xA37F60FD,
+    0xF701269F, 0x5C72F5BC, 0x44663BC5, 0x5BFB7E34, 0x8B432976, 0xCB23C6DC,
+    0xB6EDFC68, 0xB8E4F163, 0xD731DCCA, 0x42638510, 0x13972240, 0x84C61120,
+    0x854A247D, 0xD2BB3DF8, 0xAEF93211, 0xC729A16D, 0x1D9E2F4B, 0xDCB230F3,
+    0x0D8652EC, 0x77C1E3D0, 0x2BB3166C, 0xA970B999, 0x119448FA, 0x47E96422,
+    0xA8FC8CC4, 0xA0F03F1A, 0x567D2CD8, 0x223390EF, 0x87494EC7, 0xD938D1C1,
+    0x8CCAA2FE, 0x98D40B36, 0xA6F581CF, 0xA57ADE28, 0xDAB78E26, 0x3FADBFA4,
+    0x2C3A9DE4, 0x5078920D, 0x6A5FCC9B, 0x547E4662, 0xF68D13C2, 0x90D8B8E8,
+    0x2E39F75E, 0x82C3AFF5, 0x9F5D80BE, 0x69D0937C, 0x6FD52DA9, 0xCF2512B3,
+    0xC8AC993B, 0x10187DA7, 0xE89C636E, 0xDB3BBB7B, 0xCD267809, 0x6E5918F4,
+    0xEC9AB701, 0x834F9AA8, 0xE6956E65, 0xAAFFE67E, 0x21BCCF08, 0xEF15E8E6,
+    0xBAE79BD9, 0x4A6F36CE, 0xEA9F09D4, 0x29B07CD6, 0x31A4B2AF, 0x2A3F2331,
+    0xC6A59430, 0x35A266C0, 0x744EBC37, 0xFC82CAA6, 0xE090D0B0, 0x33A7D815,
+    0xF104984A, 0x41ECDAF7, 0x7FCD500E, 0x1791F62F, 0x764DD68D, 0x43EFB04D,
+    0xCCAA4D54, 0xE49604DF, 0x9ED1B5E3, 0x4C6A881B, 0xC12C1FB8, 0x4665517F,
+    0x9D5EEA04, 0x018C355D, 0xFA877473, 0xFB0B412E, 0xB3671D5A, 0x92DBD252,
+    0xE9105633, 0x6DD64713, 0x9AD7618C, 0x37A10C7A, 0x59F8148E, 0xEB133C89,
+    0xCEA927EE, 0xB761C935, 0xE11CE5ED, 0x7A47B13C, 0x9CD2DF59, 0x55F2733F,
+    0x1814CE79, 0x73C737BF, 0x53F7CDEA, 0x5FFDAA5B, 0xDF3D6F14, 0x7844DB86,
+    0xCAAFF381, 0xB968C43E, 0x3824342C, 0xC2A3405F, 0x161DC372, 0xBCE2250C,
+    0x283C498B, 0xFF0D9541, 0x39A80171, 0x080CB3DE, 0xD8B4E49C, 0x6456C190,
+    0x7BCB8461, 0xD532B670, 0x486C5C74, 0xD0B85742
+};
+
 static const UCHAR CyAesRcon[30]= {
     0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
     0x1B, 0x36, 0x6C, 0xD8, 0xAB, 0x4D, 0x9A, 0x2F,
@@ -193,6 +322,12 @@ static const UCHAR CyAesRcon[30]= {
     0xB3, 0x7D, 0xFA, 0xEF, 0xC5, 0x91,
 };
 
+//
+// Store whether or not to use the processor's AES instructions.
+//
+
+BOOL CyAesHardwareEnabled = FALSE;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -420,6 +555,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CyAesHardwareEnabled != FALSE) {
+        CypAesCbcEncryptHardware(Context, Plaintext, Ciphertext, Length);
+        return;
+    }
+
+#endif
+
     RtlCopyMemory(InitializationVector,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -531,6 +675,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CyAesHardwareEnabled != FALSE) {
+        CypAesCbcDecryptHardware(Context, Ciphertext, Plaintext, Length);
+        return;
+    }
+
+#endif
+
     RtlCopyMemory(InitializationVector,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -639,6 +792,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CyAesHardwareEnabled != FALSE) {
+        CypAesEcbEncryptHardware(Context, Plaintext, Ciphertext, Length);
+        return;
+    }
+
+#endif
+
     //
     // Loop over and encrypt each block.
     //
@@ -714,6 +876,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CyAesHardwareEnabled != FALSE) {
+        CypAesEcbDecryptHardware(Context, Ciphertext, Plaintext, Length);
+        return;
+    }
+
+#endif
+
     //
     // Decrypt each block.
     //
@@ -792,6 +963,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CyAesHardwareEnabled != FALSE) {
+        CypAesCtrHardware(Context, Plaintext, Ciphertext, Length);
+        return;
+    }
+
+#endif
+
     RtlCopyMemory(Counter,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -903,6 +1083,39 @@ Return Value:
     return;
 }
 
+CRYPTO_API
+VOID
+CyAesEnableHardware (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the AES routines use the processor's
+    AES instructions where this library has a version that does. It is off by
+    default. The caller must have determined that the processor supports the
+    instructions and that the vector registers are preserved, which is not the
+    case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CyAesHardwareEnabled = Enable;
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -934,13 +1147,15 @@ Return Value:
 {
 
     PULONG Key;
-    UCHAR OriginalVector0;
     INT Round;
-    INT Row;
-    UCHAR SboxIndex;
-    UCHAR Vector[4];
-    ULONG WorkingBlock[4];
-    ULONG XorAll;
+    ULONG Value0;
+    ULONG Value1;
+    ULONG Value2;
+    ULONG Value3;
+    ULONG Working0;
+    ULONG Working1;
+    ULONG Working2;
+    ULONG Working3;
 
     Key = (PULONG)(Context->Keys);
 
@@ -948,59 +1163,56 @@ Return Value:
     // Perform pre-round key addition.
     //
 
-    for (Row = 0; Row < 4; Row += 1) {
-        Block[Row] ^= *Key;
-        Key += 1;
-    }
+    Value0 = Block[0] ^ Key[0];
+    Value1 = Block[1] ^ Key[1];
+    Value2 = Block[2] ^ Key[2];
+    Value3 = Block[3] ^ Key[3];
+    Key += 4;
 
     //
-    // Loop through and encrypt the block.
+    // Each full round performs the byte substitution, row shift, mix columns,
+    // and key addition steps together with four table lookups per column.
     //
 
-    for (Round = 0; Round < Context->Rounds; Round += 1) {
-        for (Row = 0; Row < 4; Row += 1) {
-
-            //
-            // Perform the byte substitution and row shift operations together.
-            //
-
-            SboxIndex = (UCHAR)(Block[Row % 4] >> 24);
-            Vector[0] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 1) % 4] >> 16);
-            Vector[1] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 2) % 4] >> 8);
-            Vector[2] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 3) % 4]);
-            Vector[3] = CyAesSbox[SboxIndex];
-
-            //
-            // If this is not the last round, perform the mix columns operation.
-            //
-
-            if (Round != Context->Rounds - 1) {
-                XorAll = Vector[0] ^ Vector[1] ^ Vector[2] ^ Vector[3];
-                OriginalVector0 = Vector[0];
-                Vector[0] ^= XorAll ^ CypAesXtime(Vector[0] ^ Vector[1]);
-                Vector[1] ^= XorAll ^ CypAesXtime(Vector[1] ^ Vector[2]);
-                Vector[2] ^= XorAll ^ CypAesXtime(Vector[2] ^ Vector[3]);
-                Vector[3] ^= XorAll ^ CypAesXtime(Vector[3] ^ OriginalVector0);
-            }
-
-            WorkingBlock[Row] = ((ULONG)Vector[0] << 24) |
-                                ((ULONG)Vector[1] << 16) |
-                                ((ULONG)Vector[2] << 8) |
-                                Vector[3];
-        }
+    for (Round = 1; Round < Context->Rounds; Round += 1) {
+        Working0 = AES_ENCRYPT_COLUMN(Value0, Value1, Value2, Value3, Key[0]);
+        Working1 = AES_ENCRYPT_COLUMN(Value1, Value2, Value3, Value0, Key[1]);
+        Working2 = AES_ENCRYPT_COLUMN(Value2, Value3, Value0, Value1, Key[2]);
+        Working3 = AES_ENCRYPT_COLUMN(Value3, Value0, Value1, Value2, Key[3]);
+        Value0 = Working0;
+        Value1 = Working1;
+        Value2 = Working2;
+        Value3 = Working3;
+        Key += 4;
+    }
 
-        //
-        // Perform key addition now that the mix column operation is complete.
-        //
+    //
+    // The last round has no mix columns step, so use the plain S-Box.
+    //
 
-        for (Row = 0; Row < 4; Row += 1) {
-            Block[Row] = WorkingBlock[Row] ^ *Key;
-            Key += 1;
-        }
-    }
+    Block[0] = AES_SUBSTITUTE_COLUMN(CyAesSbox,
+                                     Value0,
+                                     Value1,
+                                     Value2,
+                                     Value3) ^ Key[0];
+
+    Block[1] = AES_SUBSTITUTE_COLUMN(CyAesSbox,
+                                     Value1,
+                                     Value2,
+                                     Value3,
+                                     Value0) ^ Key[1];
+
+    Block[2] = AES_SUBSTITUTE_COLUMN(CyAesSbox,
+                                     Value2,
+                                     Value3,
+                                     Value0,
+                                     Value1) ^ Key[2];
+
+    Block[3] = AES_SUBSTITUTE_COLUMN(CyAesSbox,
+                                     Value3,
+                                     Value0,
+                                     Value1,
+                                     Value2) ^ Key[3];
 
     return;
 }
@@ -1015,7 +1227,10 @@ CypAesDecryptBlock (
 
 Routine Description:
 
-    This routine decrypts a single block of data using the AES cipher.
+    This routine decrypts a single block of data using the AES cipher. The
+    round keys must have been converted with CyAesConvertKeyForDecryption,
+    which allows the inverse cipher to be computed in the same order as the
+    forward cipher.
 
 Arguments:
 
@@ -1033,124 +1248,67 @@ Return Value:
 
     PULONG Key;
     INT Round;
-    INT Row;
-    UCHAR SboxIndex;
-    UCHAR Vector[4];
-    ULONG WorkingBlock[4];
-    UCHAR XorValue0;
-    UCHAR XorValue1;
-    UCHAR XorValue2;
-    UCHAR XorValue3;
-    UCHAR XorValue4;
-    UCHAR XorValue5;
-    UCHAR XorValue6;
-
-    Key = Context->Keys + ((Context->Rounds + 1) * 4);
+    ULONG Value0;
+    ULONG Value1;
+    ULONG Value2;
+    ULONG Value3;
+    ULONG Working0;
+    ULONG Working1;
+    ULONG Working2;
+    ULONG Working3;
+
+    Key = Context->Keys + (Context->Rounds * 4);
 
     //
     // Perform pre-round key addition.
     //
 
-    for (Row = 4; Row > 0; Row -= 1) {
-        Key -= 1;
-        Block[Row - 1] ^= *Key;
-    }
+    Value0 = Block[0] ^ Key[0];
+    Value1 = Block[1] ^ Key[1];
+    Value2 = Block[2] ^ Key[2];
+    Value3 = Block[3] ^ Key[3];
 
     //
-    // Loop through and decrypt the block.
+    // Loop through and decrypt the block, walking the round keys backwards.
     //
 
-    for (Round = 0; Round < Context->Rounds; Round += 1) {
-        for (Row = 4; Row > 0; Row -= 1) {
-
-            //
-            // Perform the byte substitution and row shift operations together.
-            //
-
-            SboxIndex = (UCHAR)(Block[(Row + 3) % 4] >> 24);
-            Vector[0] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 2) % 4] >> 16);
-            Vector[1] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 1) % 4] >> 8);
-            Vector[2] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[Row % 4]);
-            Vector[3] = CyAesInvertedSbox[SboxIndex];
-
-            //
-            // Perform the Mix Column operation if this is not the last round.
-            //
-
-            if (Round < (Context->Rounds - 1)) {
-                XorValue0 = CypAesXtime(Vector[0] ^ Vector[1]);
-                XorValue1 = CypAesXtime(Vector[1] ^ Vector[2]);
-                XorValue2 = CypAesXtime(Vector[2] ^ Vector[3]);
-                XorValue3 = CypAesXtime(Vector[3] ^ Vector[0]);
-                XorValue4 = CypAesXtime(XorValue0 ^ XorValue1);
-                XorValue5 = CypAesXtime(XorValue1 ^ XorValue2);
-                XorValue6 = CypAesXtime(XorValue4 ^ XorValue5);
-                XorValue0 ^= Vector[1] ^ Vector[2] ^ Vector[3] ^ XorValue4 ^
-                             XorValue6;
-
-                XorValue1 ^= Vector[0] ^ Vector[2] ^ Vector[3] ^ XorValue5 ^
-                             XorValue6;
-
-                XorValue2 ^= Vector[0] ^ Vector[1] ^ Vector[3] ^ XorValue4 ^
-                             XorValue6;
-
-                XorValue3 ^= Vector[0] ^ Vector[1] ^ Vector[2] ^ XorValue5 ^
-                             XorValue6;
-
-                WorkingBlock[Row - 1] = ((ULONG)XorValue0 << 24) |
-                                        ((ULONG)XorValue1 << 16) |
-                                        ((ULONG)XorValue2 << 8) |
-                                        XorValue3;
-
-            } else {
-                WorkingBlock[Row - 1] = ((ULONG)Vector[0] << 24) |
-                                        ((ULONG)Vector[1] << 16) |
-                                        ((ULONG)Vector[2] << 8) |
-                                        Vector[3];
-            }
-        }
-
-        for (Row = 4; Row > 0; Row -= 1) {
-            Key -= 1;
-            Block[Row - 1] = WorkingBlock[Row - 1] ^ *Key;
-        }
+    for (Round = 1; Round < Context->Rounds; Round += 1) {
+        Key -= 4;
+        Working0 = AES_DECRYPT_COLUMN(Value0, Value3, Value2, Value1, Key[0]);
+        Working1 = AES_DECRYPT_COLUMN(Value1, Value0, Value3, Value2, Key[1]);
+        Working2 = AES_DECRYPT_COLUMN(Value2, Value1, Value0, Value3, Key[2]);
+        Working3 = AES_DECRYPT_COLUMN(Value3, Value2, Value1, Value0, Key[3]);
+        Value0 = Working0;
+        Value1 = Working1;
+        Value2 = Working2;
+        Value3 = Working3;
     }
 
-    return;
-}
-
-UCHAR
-CypAesXtime (
-    UCHAR Value
-    )
-
-/*++
-
-Routine Description:
-
-    This routine performs doubling of an 8 bit value in a Galois Field GF(2^8)
-    using the irreducible polynomial x^8 + x^4 + x^3 + x + 1. This basically
-    means multiply by 2 and exclusive OR with 0x1B if it rolls over.
-
-Arguments:
-
-    Value - Supplies the value to multiply by 2 in the finite field.
-
-Return Value:
-
-    Returns the value multiplied by 2 in the finite field.
+    Key -= 4;
+    Block[0] = AES_SUBSTITUTE_COLUMN(CyAesInvertedSbox,
+                                     Value0,
+                                     Value3,
+                                     Value2,
+                                     Value1) ^ Key[0];
+
+    Block[1] = AES_SUBSTITUTE_COLUMN(CyAesInvertedSbox,
+                                     Value1,
+                                     Value0,
+                                     Value3,
+                                     Value2) ^ Key[1];
+
+    Block[2] = AES_SUBSTITUTE_COLUMN(CyAesInvertedSbox,
+                                     Value2,
+                                     Value1,
+                                     Value0,
+                                     Value3) ^ Key[2];
+
+    Block[3] = AES_SUBSTITUTE_COLUMN(CyAesInvertedSbox,
+                                     Value3,
+                                     Value2,
+                                     Value1,
+                                     Value0) ^ Key[3];
 
---*/
-
-{
-
-    if ((Value & 0x80) != 0) {
-        return (Value << 1) ^ 0x1B;
-    }
-
-    return Value << 1;
+    return;
 }
 
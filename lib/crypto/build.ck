@@ -26,13 +26,17 @@ Module Name:
 
 --*/
 
-from menv import kernelLibrary, staticLibrary;
+from menv import mconfig, kernelLibrary, staticLibrary;
 
 function build() {
+    var arch = mconfig.arch;
     var buildLib;
+    var buildSources;
     var entries;
     var lib;
     var sources;
+    var targetSources;
+    var x86Sources;
 
     sources = [
         "aes.c",
@@ -44,15 +48,34 @@ function build() {
         "sha512.c"
     ];
 
+    //
+    // The processor accelerated routines are shared between x86 and x64.
+    //
+
+    x86Sources = [
+        "x86/aesni.c",
+        "x86/shani.c"
+    ];
+
+    targetSources = sources;
+    if ((arch == "x86") || (arch == "x64")) {
+        targetSources = sources + x86Sources;
+    }
+
+    buildSources = sources;
+    if ((mconfig.build_arch == "x86") || (mconfig.build_arch == "x64")) {
+        buildSources = sources + x86Sources;
+    }
+
     lib = {
         "label": "crypto",
-        "inputs": sources,
+        "inputs": targetSources,
     };
 
     buildLib = {
         "label": "build_crypto",
         "output": "crypto",
-        "inputs": sources,
+        "inputs": buildSources,
         "build": true,
         "prefix": "build"
     };
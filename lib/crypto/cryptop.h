@@ -47,6 +47,17 @@ Module Name:
 #define BIG_INTEGER_P_OFFSET 1
 #define BIG_INTEGER_Q_OFFSET 2
 
+//
+// Define whether or not this architecture has versions of the AES and SHA
+// routines that use the processor's cryptographic instructions.
+//
+
+#if defined(__i386) || defined(__amd64)
+
+#define CY_HARDWARE_ROUTINES 1
+
+#endif
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -55,6 +66,8 @@ Module Name:
 // -------------------------------------------------------------------- Globals
 //
 
+extern const ULONG CySha256KConstants[64];
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -475,3 +488,231 @@ Return Value:
 
 --*/
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+//
+// Processor accelerated functions
+//
+
+VOID
+CypAesEcbEncryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts a byte sequence using the AES codebook and the
+    processor's AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesEcbDecryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decrypts a byte sequence using the AES codebook and the
+    processor's AES instructions. The round keys must have been converted for
+    decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesCbcEncryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts a byte sequence using AES cipher block chaining and
+    the processor's AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The initialization
+        vector is updated to continue the chain.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesCbcDecryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decrypts a byte sequence using AES cipher block chaining and
+    the processor's AES instructions. The round keys must have been converted
+    for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The initialization
+        vector is updated to continue the chain.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesCtrHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts a byte sequence using AES counter mode
+    and the processor's AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The counter is advanced
+        past the blocks processed.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Length - Supplies the length of the input and output buffers, in bytes.
+        This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypSha1ProcessBlocksHardware (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds whole message blocks to a SHA-1 digest using the
+    processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypSha256ProcessBlocksHardware (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds whole message blocks to a SHA-256 digest using the
+    processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+#endif
@@ -42,6 +42,40 @@ Module Name:
 #define SHA1_ROTATE32(_Value, _ShiftCount) \
     (((_Value) << (_ShiftCount)) | ((_Value) >> (32 - (_ShiftCount))))
 
+//
+// These macros define the round functions used in each quarter of the
+// compression function.
+//
+
+#define SHA1_CH(_ValueB, _ValueC, _ValueD) \
+    ((((_ValueC) ^ (_ValueD)) & (_ValueB)) ^ (_ValueD))
+
+#define SHA1_PARITY(_ValueB, _ValueC, _ValueD) \
+    ((_ValueB) ^ (_ValueC) ^ (_ValueD))
+
+#define SHA1_MAJ(_ValueB, _ValueC, _ValueD) \
+    (((_ValueB) & (_ValueC)) | (((_ValueB) | (_ValueC)) & (_ValueD)))
+
+//
+// This macro performs one round of the compression function. Rather than
+// shifting all five working variables down each round, the caller rotates the
+// arguments, so the value in _ValueE becomes the new A.
+//
+
+#define SHA1_ROUND(_Function,                                           \
+                   _ValueA,                                             \
+                   _ValueB,                                             \
+                   _ValueC,                                             \
+                   _ValueD,                                             \
+                   _ValueE,                                             \
+                   _Constant,                                           \
+                   _Word)                                               \
+                                                                        \
+    ((_ValueE) += SHA1_ROTATE32(_ValueA, 5) +                           \
+                  _Function(_ValueB, _ValueC, _ValueD) +                \
+                  (_Constant) + (_Word),                                \
+     (_ValueB) = SHA1_ROTATE32(_ValueB, 30))
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -56,7 +90,8 @@ Module Name:
 
 VOID
 CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+    PSHA1_CONTEXT Context,
+    PCUCHAR Data
     );
 
 VOID
@@ -75,6 +110,12 @@ const ULONG CySha1KConstants[4] = {
     0xCA62C1D6UL
 };
 
+//
+// Store whether or not to use the processor's SHA instructions.
+//
+
+BOOL CySha1HardwareEnabled = FALSE;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -144,16 +185,65 @@ Return Value:
 
 {
 
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Message;
-        Context->BlockIndex += 1;
-        Context->Length += BITS_PER_BYTE;
-        if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha1ProcessMessage(Context);
+    UINTN Size;
+
+    Context->Length += (ULONGLONG)Length * BITS_PER_BYTE;
+
+    //
+    // Top off a partially filled message block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
         }
 
-        Message += 1;
-        Length -= 1;
+        RtlCopyMemory(Context->MessageBlock + Context->BlockIndex,
+                      Message,
+                      Size);
+
+        Context->BlockIndex += Size;
+        Message += Size;
+        Length -= Size;
+        if (Context->BlockIndex != sizeof(Context->MessageBlock)) {
+            return;
+        }
+
+        CypSha1ProcessMessage(Context, Context->MessageBlock);
+        Context->BlockIndex = 0;
+    }
+
+    //
+    // Hash whole blocks directly out of the caller's buffer, and save any
+    // remainder for later.
+    //
+
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if ((CySha1HardwareEnabled != FALSE) &&
+        (Length >= sizeof(Context->MessageBlock))) {
+
+        Size = ALIGN_RANGE_DOWN(Length, sizeof(Context->MessageBlock));
+        CypSha1ProcessBlocksHardware(Context->IntermediateHash,
+                                     Message,
+                                     Size / sizeof(Context->MessageBlock));
+
+        Message += Size;
+        Length -= Size;
+    }
+
+#endif
+
+    while (Length >= sizeof(Context->MessageBlock)) {
+        CypSha1ProcessMessage(Context, Message);
+        Message += sizeof(Context->MessageBlock);
+        Length -= sizeof(Context->MessageBlock);
+    }
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Message, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -205,26 +295,60 @@ Return Value:
     return;
 }
 
+CRYPTO_API
+VOID
+CySha1EnableHardware (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the SHA-1 routines use the
+    processor's SHA instructions where this library has a version that does. It
+    is off by default. The caller must have determined that the processor
+    supports the instructions and that the vector registers are preserved,
+    which is not the case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CySha1HardwareEnabled = Enable;
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
 VOID
 CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+    PSHA1_CONTEXT Context,
+    PCUCHAR Data
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes a 512 bit message block and adds it to the digest.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-1 context with a full
-        message block.
+    Context - Supplies a pointer to the initialized SHA-1 context.
+
+    Data - Supplies a pointer to the 64 byte message block to process.
 
 Return Value:
 
@@ -243,15 +367,26 @@ Return Value:
     INT Index;
     ULONG Value;
 
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CySha1HardwareEnabled != FALSE) {
+        CypSha1ProcessBlocksHardware(Context->IntermediateHash, Data, 1);
+                                     return;
+                                     }
+
+#endif
+
     //
     // Initialize the first 16 words in the block array.
     //
 
     for (Index = 0; Index < 16; Index += 1) {
-        Block[Index] = ((ULONG)Context->MessageBlock[Index * 4] << 24) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 1] << 16) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 2] << 8) |
-                       (Context->MessageBlock[(Index * 4) + 3]);
+        Block[Index] = ((ULONG)Data[0] << 24) |
+                       ((ULONG)Data[1] << 16) |
+                       ((ULONG)Data[2] << 8) |
+                       Data[3];
+
+        Data += 4;
     }
 
     for (Index = 16; Index < 80; Index += 1) {
@@ -266,50 +401,72 @@ Return Value:
     BlockC = Context->IntermediateHash[2];
     BlockD = Context->IntermediateHash[3];
     BlockE = Context->IntermediateHash[4];
-    for (Index = 0; Index < 20; Index += 1) {
-        Value = SHA1_ROTATE32(BlockA, 5) +
-                ((BlockB & BlockC) | ((~BlockB) & BlockD)) +
-                BlockE + Block[Index] + CySha1KConstants[0];
-
-        BlockE = BlockD;
-        BlockD = BlockC;
-        BlockC = SHA1_ROTATE32(BlockB, 30);
-        BlockB = BlockA;
-        BlockA = Value;
+    for (Index = 0; Index < 20; Index += 5) {
+        SHA1_ROUND(SHA1_CH, BlockA, BlockB, BlockC, BlockD, BlockE,
+                   CySha1KConstants[0], Block[Index]);
+
+        SHA1_ROUND(SHA1_CH, BlockE, BlockA, BlockB, BlockC, BlockD,
+                   CySha1KConstants[0], Block[Index + 1]);
+
+        SHA1_ROUND(SHA1_CH, BlockD, BlockE, BlockA, BlockB, BlockC,
+                   CySha1KConstants[0], Block[Index + 2]);
+
+        SHA1_ROUND(SHA1_CH, BlockC, BlockD, BlockE, BlockA, BlockB,
+                   CySha1KConstants[0], Block[Index + 3]);
+
+        SHA1_ROUND(SHA1_CH, BlockB, BlockC, BlockD, BlockE, BlockA,
+                   CySha1KConstants[0], Block[Index + 4]);
     }
 
-    for (Index = 20; Index < 40; Index += 1) {
-        Value = SHA1_ROTATE32(BlockA, 5) + (BlockB ^ BlockC ^ BlockD) +
-                BlockE + Block[Index] + CySha1KConstants[1];
+    for (Index = 20; Index < 40; Index += 5) {
+        SHA1_ROUND(SHA1_PARITY, BlockA, BlockB, BlockC, BlockD, BlockE,
+                   CySha1KConstants[1], Block[Index]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockE, BlockA, BlockB, BlockC, BlockD,
+                   CySha1KConstants[1], Block[Index + 1]);
 
-        BlockE = BlockD;
-        BlockD = BlockC;
-        BlockC = SHA1_ROTATE32(BlockB, 30);
-        BlockB = BlockA;
-        BlockA = Value;
+        SHA1_ROUND(SHA1_PARITY, BlockD, BlockE, BlockA, BlockB, BlockC,
+                   CySha1KConstants[1], Block[Index + 2]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockC, BlockD, BlockE, BlockA, BlockB,
+                   CySha1KConstants[1], Block[Index + 3]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockB, BlockC, BlockD, BlockE, BlockA,
+                   CySha1KConstants[1], Block[Index + 4]);
     }
 
-    for (Index = 40; Index < 60; Index += 1) {
-        Value = SHA1_ROTATE32(BlockA, 5) +
-                ((BlockB & BlockC) | (BlockB & BlockD) | (BlockC & BlockD)) +
-                BlockE + Block[Index] + CySha1KConstants[2];
+    for (Index = 40; Index < 60; Index += 5) {
+        SHA1_ROUND(SHA1_MAJ, BlockA, BlockB, BlockC, BlockD, BlockE,
+                   CySha1KConstants[2], Block[Index]);
+
+        SHA1_ROUND(SHA1_MAJ, BlockE, BlockA, BlockB, BlockC, BlockD,
+                   CySha1KConstants[2], Block[Index + 1]);
+
+        SHA1_ROUND(SHA1_MAJ, BlockD, BlockE, BlockA, BlockB, BlockC,
+                   CySha1KConstants[2], Block[Index + 2]);
+
+        SHA1_ROUND(SHA1_MAJ, BlockC, BlockD, BlockE, BlockA, BlockB,
+                   CySha1KConstants[2], Block[Index + 3]);
 
-        BlockE = BlockD;
-        BlockD = BlockC;
-        BlockC = SHA1_ROTATE32(BlockB, 30);
-        BlockB = BlockA;
-        BlockA = Value;
+        SHA1_ROUND(SHA1_MAJ, BlockB, BlockC, BlockD, BlockE, BlockA,
+                   CySha1KConstants[2], Block[Index + 4]);
     }
 
-    for (Index = 60; Index < 80; Index += 1) {
-        Value = SHA1_ROTATE32(BlockA, 5) + (BlockB ^ BlockC ^ BlockD) +
-                BlockE + Block[Index] + CySha1KConstants[3];
+    for (Index = 60; Index < 80; Index += 5) {
+        SHA1_ROUND(SHA1_PARITY, BlockA, BlockB, BlockC, BlockD, BlockE,
+                   CySha1KConstants[3], Block[Index]);
 
-        BlockE = BlockD;
-        BlockD = BlockC;
-        BlockC = SHA1_ROTATE32(BlockB, 30);
-        BlockB = BlockA;
-        BlockA = Value;
+        SHA1_ROUND(SHA1_PARITY, BlockE, BlockA, BlockB, BlockC, BlockD,
+                   CySha1KConstants[3], Block[Index + 1]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockD, BlockE, BlockA, BlockB, BlockC,
+                   CySha1KConstants[3], Block[Index + 2]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockC, BlockD, BlockE, BlockA, BlockB,
+                   CySha1KConstants[3], Block[Index + 3]);
+
+        SHA1_ROUND(SHA1_PARITY, BlockB, BlockC, BlockD, BlockE, BlockA,
+                   CySha1KConstants[3], Block[Index + 4]);
     }
 
     Context->IntermediateHash[0] += BlockA;
@@ -317,7 +474,6 @@ Return Value:
     Context->IntermediateHash[2] += BlockC;
     Context->IntermediateHash[3] += BlockD;
     Context->IntermediateHash[4] += BlockE;
-    Context->BlockIndex = 0;
     return;
 }
 
@@ -361,7 +517,8 @@ Return Value:
             Context->BlockIndex += 1;
         }
 
-        CypSha1ProcessMessage(Context);
+        CypSha1ProcessMessage(Context, Context->MessageBlock);
+        Context->BlockIndex = 0;
         while (Context->BlockIndex < 56) {
             Context->MessageBlock[Context->BlockIndex] = 0;
             Context->BlockIndex += 1;
@@ -388,7 +545,8 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha1ProcessMessage(Context);
+    CypSha1ProcessMessage(Context, Context->MessageBlock);
+    Context->BlockIndex = 0;
     return;
 }
 
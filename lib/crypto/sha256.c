@@ -42,11 +42,10 @@ Module Name:
     (((_Value) >> (_Count)) | ((_Value) << (32 - (_Count))))
 
 #define SHA256_CH(_ValueX, _ValueY, _ValueZ) \
-    (((_ValueX) & (_ValueY)) ^ (~(_ValueX) & (_ValueZ)))
+    ((((_ValueY) ^ (_ValueZ)) & (_ValueX)) ^ (_ValueZ))
 
-#define SHA256_MAJ(_ValueX, _ValueY, _ValueZ)               \
-    (((_ValueX) & (_ValueY)) ^ ((_ValueX) & (_ValueZ)) ^    \
-     ((_ValueY) & (_ValueZ)))
+#define SHA256_MAJ(_ValueX, _ValueY, _ValueZ) \
+    (((_ValueX) & (_ValueY)) | (((_ValueX) | (_ValueY)) & (_ValueZ)))
 
 #define SHA256_EP0(_Value)              \
     (SHA256_ROTATE_RIGHT(_Value, 2) ^   \
@@ -68,6 +67,30 @@ Module Name:
      SHA256_ROTATE_RIGHT(_Value, 19) ^  \
      ((_Value) >> 10))
 
+//
+// This macro performs one round of the compression function. Rather than
+// shifting all eight working variables down each round, the caller rotates
+// the arguments, so the value in _ValueH becomes the new A and _ValueD becomes
+// the new E.
+//
+
+#define SHA256_ROUND(_ValueA,                                       \
+                     _ValueB,                                       \
+                     _ValueC,                                       \
+                     _ValueD,                                       \
+                     _ValueE,                                       \
+                     _ValueF,                                       \
+                     _ValueG,                                       \
+                     _ValueH,                                       \
+                     _Index)                                        \
+                                                                    \
+    ((_ValueH) += SHA256_EP1(_ValueE) +                             \
+                  SHA256_CH(_ValueE, _ValueF, _ValueG) +            \
+                  CySha256KConstants[_Index] + Block[_Index],       \
+     (_ValueD) += (_ValueH),                                        \
+     (_ValueH) += SHA256_EP0(_ValueA) +                             \
+                  SHA256_MAJ(_ValueA, _ValueB, _ValueC))
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -82,7 +105,8 @@ Module Name:
 
 VOID
 CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+    PSHA256_CONTEXT Context,
+    PCUCHAR Data
     );
 
 VOID
@@ -108,6 +132,12 @@ const ULONG CySha256KConstants[64] = {
     0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
 };
 
+//
+// Store whether or not to use the processor's SHA instructions.
+//
+
+BOOL CySha256HardwareEnabled = FALSE;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -181,19 +211,65 @@ Return Value:
 {
 
     PUCHAR Bytes;
+    UINTN Size;
 
     Bytes = Message;
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Bytes;
-        Context->BlockIndex += 1;
-        if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha256ProcessMessage(Context);
-            Context->Length += sizeof(Context->MessageBlock) * BITS_PER_BYTE;
-            Context->BlockIndex = 0;
+
+    //
+    // Top off a partially filled message block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
+        }
+
+        RtlCopyMemory(Context->MessageBlock + Context->BlockIndex, Bytes, Size);
+        Context->BlockIndex += Size;
+        Bytes += Size;
+        Length -= Size;
+        if (Context->BlockIndex != sizeof(Context->MessageBlock)) {
+            return;
         }
 
-        Bytes += 1;
-        Length -= 1;
+        CypSha256ProcessMessage(Context, Context->MessageBlock);
+        Context->Length += sizeof(Context->MessageBlock) * BITS_PER_BYTE;
+        Context->BlockIndex = 0;
+    }
+
+    //
+    // Hash whole blocks directly out of the caller's buffer, and save any
+    // remainder for later.
+    //
+
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if ((CySha256HardwareEnabled != FALSE) &&
+        (Length >= sizeof(Context->MessageBlock))) {
+
+        Size = ALIGN_RANGE_DOWN(Length, sizeof(Context->MessageBlock));
+        CypSha256ProcessBlocksHardware(Context->IntermediateHash,
+                                       Bytes,
+                                       Size / sizeof(Context->MessageBlock));
+
+        Context->Length += Size * BITS_PER_BYTE;
+        Bytes += Size;
+        Length -= Size;
+    }
+
+#endif
+
+    while (Length >= sizeof(Context->MessageBlock)) {
+        CypSha256ProcessMessage(Context, Bytes);
+        Context->Length += sizeof(Context->MessageBlock) * BITS_PER_BYTE;
+        Bytes += sizeof(Context->MessageBlock);
+        Length -= sizeof(Context->MessageBlock);
+    }
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Bytes, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -250,26 +326,60 @@ Return Value:
     return;
 }
 
+CRYPTO_API
+VOID
+CySha256EnableHardware (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine selects whether or not the SHA-256 routines use the
+    processor's SHA instructions where this library has a version that does. It
+    is off by default. The caller must have determined that the processor
+    supports the instructions and that the vector registers are preserved,
+    which is not the case in the kernel.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether to use the processor's
+        instructions (TRUE) or the portable C routines (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CySha256HardwareEnabled = Enable;
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
 VOID
 CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+    PSHA256_CONTEXT Context,
+    PCUCHAR Data
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes a 512 bit message block and adds it to the digest.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-256 context with a full
-        message block.
+    Context - Supplies a pointer to the initialized SHA-256 context.
+
+    Data - Supplies a pointer to the 64 byte message block to process.
 
 Return Value:
 
@@ -289,18 +399,23 @@ Return Value:
     ULONG BlockG;
     ULONG BlockH;
     UINTN BlockIndex;
-    UINTN ByteIndex;
-    ULONG Working1;
-    ULONG Working2;
 
-    ByteIndex = 0;
+#if defined(CY_HARDWARE_ROUTINES)
+
+    if (CySha256HardwareEnabled != FALSE) {
+        CypSha256ProcessBlocksHardware(Context->IntermediateHash, Data, 1);
+                                       return;
+                                       }
+
+#endif
+
     for (BlockIndex = 0; BlockIndex < 16; BlockIndex += 1) {
-        Block[BlockIndex] = (Context->MessageBlock[ByteIndex] << 24) |
-                            (Context->MessageBlock[ByteIndex + 1] << 16) |
-                            (Context->MessageBlock[ByteIndex + 2] << 8) |
-                            Context->MessageBlock[ByteIndex + 3];
+        Block[BlockIndex] = ((ULONG)Data[0] << 24) |
+                            ((ULONG)Data[1] << 16) |
+                            ((ULONG)Data[2] << 8) |
+                            Data[3];
 
-        ByteIndex += 4;
+        Data += 4;
     }
 
     while (BlockIndex < 64) {
@@ -320,22 +435,38 @@ Return Value:
     BlockF = Context->IntermediateHash[5];
     BlockG = Context->IntermediateHash[6];
     BlockH = Context->IntermediateHash[7];
-    for (BlockIndex = 0; BlockIndex < 64; BlockIndex += 1) {
-        Working1 = BlockH +
-                   SHA256_EP1(BlockE) +
-                   SHA256_CH(BlockE, BlockF, BlockG) +
-                   CySha256KConstants[BlockIndex] +
-                   Block[BlockIndex];
-
-        Working2 = SHA256_EP0(BlockA) + SHA256_MAJ(BlockA, BlockB, BlockC);
-        BlockH = BlockG;
-        BlockG = BlockF;
-        BlockF = BlockE;
-        BlockE = BlockD + Working1;
-        BlockD = BlockC;
-        BlockC = BlockB;
-        BlockB = BlockA;
-        BlockA = Working1 + Working2;
+    for (BlockIndex = 0; BlockIndex < 64; BlockIndex += 8) {
+        SHA256_ROUND(BlockA, BlockB, BlockC, BlockD,
+                     BlockE, BlockF, BlockG, BlockH,
+                     BlockIndex);
+
+        SHA256_ROUND(BlockH, BlockA, BlockB, BlockC,
+                     BlockD, BlockE, BlockF, BlockG,
+                     BlockIndex + 1);
+
+        SHA256_ROUND(BlockG, BlockH, BlockA, BlockB,
+                     BlockC, BlockD, BlockE, BlockF,
+                     BlockIndex + 2);
+
+        SHA256_ROUND(BlockF, BlockG, BlockH, BlockA,
+                     BlockB, BlockC, BlockD, BlockE,
+                     BlockIndex + 3);
+
+        SHA256_ROUND(BlockE, BlockF, BlockG, BlockH,
+                     BlockA, BlockB, BlockC, BlockD,
+                     BlockIndex + 4);
+
+        SHA256_ROUND(BlockD, BlockE, BlockF, BlockG,
+                     BlockH, BlockA, BlockB, BlockC,
+                     BlockIndex + 5);
+
+        SHA256_ROUND(BlockC, BlockD, BlockE, BlockF,
+                     BlockG, BlockH, BlockA, BlockB,
+                     BlockIndex + 6);
+
+        SHA256_ROUND(BlockB, BlockC, BlockD, BlockE,
+                     BlockF, BlockG, BlockH, BlockA,
+                     BlockIndex + 7);
     }
 
     Context->IntermediateHash[0] += BlockA;
@@ -400,7 +531,7 @@ Return Value:
             Index += 1;
         }
 
-        CypSha256ProcessMessage(Context);
+        CypSha256ProcessMessage(Context, Context->MessageBlock);
         RtlZeroMemory(Context->MessageBlock, 56);
     }
 
@@ -418,7 +549,7 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha256ProcessMessage(Context);
+    CypSha256ProcessMessage(Context, Context->MessageBlock);
     return;
 }
 
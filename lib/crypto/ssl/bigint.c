@@ -64,6 +64,29 @@ Module Name:
 
 #define BIG_INTEGER_LONG_COMPONENT_MAX 0xFFFFFFFFFFFFFFFFULL
 
+//
+// Define the exponent size below which exponents are assumed to be public
+// (like the usual RSA public exponent of 65537), and are processed a bit at a
+// time without regard to timing.
+//
+
+#define BIG_INTEGER_PUBLIC_EXPONENT_BITS 64
+
+//
+// Define the exponent size at or above which the largest fixed window is used
+// for Montgomery exponentiation.
+//
+
+#define BIG_INTEGER_LARGE_EXPONENT_BITS 512
+
+//
+// Define the fixed window sizes, in bits, used for Montgomery exponentiation
+// of secret exponents.
+//
+
+#define BIG_INTEGER_SMALL_WINDOW_BITS 4
+#define BIG_INTEGER_LARGE_WINDOW_BITS 5
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -174,6 +197,52 @@ CypBiComputeExponentTable (
     PBIG_INTEGER Value
     );
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    );
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    PBIG_INTEGER_COMPONENT Modulus,
+    UINTN Size,
+    BIG_INTEGER_COMPONENT Inverse,
+    PBIG_INTEGER_COMPONENT Scratch
+    );
+
+BIG_INTEGER_COMPONENT
+CypBiComputeMontgomeryInverse (
+    BIG_INTEGER_COMPONENT Value
+    );
+
+UINTN
+CypBiGetExponentWindow (
+    PBIG_INTEGER Exponent,
+    UINTN BitIndex,
+    UINTN WindowSize
+    );
+
+VOID
+CypBiSelectTableEntry (
+    PBIG_INTEGER_COMPONENT Destination,
+    PBIG_INTEGER_COMPONENT Table,
+    UINTN TableSize,
+    UINTN Size,
+    UINTN Index
+    );
+
+VOID
+CypBiCopyComponents (
+    PBIG_INTEGER_COMPONENT Destination,
+    PBIG_INTEGER Source,
+    UINTN Size
+    );
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
@@ -515,7 +584,10 @@ CypBiExponentiateModulo (
 
 Routine Description:
 
-    This routine performs exponentiation, modulo a value.
+    This routine performs exponentiation, modulo a value. Odd moduli (which
+    include all RSA moduli and primes) use Montgomery multiplication, and
+    even moduli fall back to sliding window exponentiation with Barrett
+    reduction.
 
 Arguments:
 
@@ -540,6 +612,7 @@ Return Value:
     INTN BitIndex;
     UINTN Index;
     INTN LeadingBit;
+    PBIG_INTEGER Modulus;
     PBIG_INTEGER NewValue;
     INTN NextBit;
     INTN PartialExponent;
@@ -552,6 +625,11 @@ Return Value:
 
     ASSERT(LeadingBit > 0);
 
+    Modulus = Context->Modulus[Context->ModOffset];
+    if ((Modulus->Components[0] & 0x1) != 0) {
+        return CypBiExponentiateMontgomery(Context, Value, Exponent);
+    }
+
     Result = CypBiCreateFromInteger(Context, 1);
     if (Result == NULL) {
         return NULL;
@@ -2510,6 +2588,599 @@ Return Value:
     return Status;
 }
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs exponentiation modulo an odd value using
+    Montgomery multiplication. Secret sized exponents are processed with a
+    fixed window, and each window's table entry is read with a scan of the
+    whole table, so the sequence of operations and memory accesses does not
+    depend on the exponent bits.
+
+Arguments:
+
+    Context - Supplies a pointer to the big integer context. The current
+        modulus must be odd.
+
+    Value - Supplies a pointer to the value to reduce. A reference on this
+        value will be released on success.
+
+    Exponent - Supplies the exponent to raise the value to. A reference on this
+        value will be released on success.
+
+Return Value:
+
+    Returns a pointer to the exponentiated value on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PBIG_INTEGER_COMPONENT Accumulator;
+    UINTN AllocationSize;
+    INTN BitIndex;
+    PBIG_INTEGER_COMPONENT Buffer;
+    UINTN Index;
+    BIG_INTEGER_COMPONENT Inverse;
+    INTN LeadingBit;
+    PBIG_INTEGER Modulus;
+    PBIG_INTEGER_COMPONENT ModulusComponents;
+    PBIG_INTEGER_COMPONENT One;
+    PBIG_INTEGER Reduced;
+    PBIG_INTEGER Result;
+    PBIG_INTEGER_COMPONENT Scratch;
+    PBIG_INTEGER_COMPONENT Selected;
+    UINTN Size;
+    PBIG_INTEGER_COMPONENT Table;
+    UINTN TableSize;
+    UINTN Window;
+    UINTN WindowCount;
+    UINTN WindowSize;
+
+    Modulus = Context->Modulus[Context->ModOffset];
+    ModulusComponents = Modulus->Components;
+    Size = Modulus->Size;
+    Result = NULL;
+
+    ASSERT((ModulusComponents[0] & 0x1) != 0);
+
+    LeadingBit = CypBiFindLeadingBit(Exponent);
+    if (LeadingBit < BIG_INTEGER_PUBLIC_EXPONENT_BITS) {
+        WindowSize = 1;
+
+    } else if (LeadingBit < BIG_INTEGER_LARGE_EXPONENT_BITS) {
+        WindowSize = BIG_INTEGER_SMALL_WINDOW_BITS;
+
+    } else {
+        WindowSize = BIG_INTEGER_LARGE_WINDOW_BITS;
+    }
+
+    //
+    // Allocate the table of powers, the accumulator, the selected table
+    // entry, the value one, and the multiplication scratch space together.
+    //
+
+    TableSize = 1 << WindowSize;
+    AllocationSize = (((TableSize + 4) * Size) + 2) *
+                     sizeof(BIG_INTEGER_COMPONENT);
+
+    Buffer = Context->AllocateMemory(AllocationSize);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    RtlZeroMemory(Buffer, AllocationSize);
+    Table = Buffer;
+    Accumulator = Table + (TableSize * Size);
+    Selected = Accumulator + Size;
+    One = Selected + Size;
+    Scratch = One + Size;
+    One[0] = 1;
+    Inverse = CypBiComputeMontgomeryInverse(ModulusComponents[0]);
+
+    //
+    // Compute R^2 mod M, where R is the radix raised to the size of the
+    // modulus. Multiplying by this converts values into Montgomery form.
+    //
+
+    Reduced = CypBiCreate(Context, (Size * 2) + 1);
+    if (Reduced == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    RtlZeroMemory(Reduced->Components,
+                  Reduced->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    Reduced->Components[Size * 2] = 1;
+    Reduced = CypBiModulo(Context, Reduced);
+    if (Reduced == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    CypBiCopyComponents(Selected, Reduced, Size);
+    CypBiReleaseReference(Context, Reduced);
+
+    //
+    // Reduce a copy of the value, which may be larger than the modulus when
+    // called for the Chinese Remainder Theorem.
+    //
+
+    Reduced = CypBiClone(Context, Value);
+    if (Reduced == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    Reduced = CypBiModulo(Context, Reduced);
+    if (Reduced == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    CypBiCopyComponents(Accumulator, Reduced, Size);
+    CypBiReleaseReference(Context, Reduced);
+
+    //
+    // Build the table of powers in Montgomery form. The first entry is one,
+    // which is R mod M in Montgomery form.
+    //
+
+    CypBiMontgomeryMultiply(Table,
+                            Selected,
+                            One,
+                            ModulusComponents,
+                            Size,
+                            Inverse,
+                            Scratch);
+
+    CypBiMontgomeryMultiply(Table + Size,
+                            Accumulator,
+                            Selected,
+                            ModulusComponents,
+                            Size,
+                            Inverse,
+                            Scratch);
+
+    for (Index = 2; Index < TableSize; Index += 1) {
+        CypBiMontgomeryMultiply(Table + (Index * Size),
+                                Table + ((Index - 1) * Size),
+                                Table + Size,
+                                ModulusComponents,
+                                Size,
+                                Inverse,
+                                Scratch);
+    }
+
+    RtlCopyMemory(Accumulator, Table, Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    //
+    // Public exponents are short, so just square and multiply a bit at a
+    // time.
+    //
+
+    if (WindowSize == 1) {
+        for (BitIndex = LeadingBit; BitIndex >= 0; BitIndex -= 1) {
+            CypBiMontgomeryMultiply(Accumulator,
+                                    Accumulator,
+                                    Accumulator,
+                                    ModulusComponents,
+                                    Size,
+                                    Inverse,
+                                    Scratch);
+
+            if (CypBiTestBit(Exponent, BitIndex) != FALSE) {
+                CypBiMontgomeryMultiply(Accumulator,
+                                        Accumulator,
+                                        Table + Size,
+                                        ModulusComponents,
+                                        Size,
+                                        Inverse,
+                                        Scratch);
+            }
+        }
+
+    //
+    // For secret exponents, always square once per bit and multiply once per
+    // window, even when the window is zero. Use the allocated size of the
+    // exponent rather than its leading bit so that doesn't leak either.
+    //
+
+    } else {
+        WindowCount = ((Exponent->Size * BIG_INTEGER_COMPONENT_BITS) +
+                       WindowSize - 1) / WindowSize;
+
+        while (WindowCount != 0) {
+            WindowCount -= 1;
+            for (Index = 0; Index < WindowSize; Index += 1) {
+                CypBiMontgomeryMultiply(Accumulator,
+                                        Accumulator,
+                                        Accumulator,
+                                        ModulusComponents,
+                                        Size,
+                                        Inverse,
+                                        Scratch);
+            }
+
+            Window = CypBiGetExponentWindow(Exponent,
+                                            WindowCount * WindowSize,
+                                            WindowSize);
+
+            CypBiSelectTableEntry(Selected, Table, TableSize, Size, Window);
+            CypBiMontgomeryMultiply(Accumulator,
+                                    Accumulator,
+                                    Selected,
+                                    ModulusComponents,
+                                    Size,
+                                    Inverse,
+                                    Scratch);
+        }
+    }
+
+    //
+    // Multiplying by one converts back out of Montgomery form.
+    //
+
+    CypBiMontgomeryMultiply(Accumulator,
+                            Accumulator,
+                            One,
+                            ModulusComponents,
+                            Size,
+                            Inverse,
+                            Scratch);
+
+    Result = CypBiCreate(Context, Size);
+    if (Result == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    RtlCopyMemory(Result->Components,
+                  Accumulator,
+                  Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    CypBiTrim(Result);
+    CypBiReleaseReference(Context, Value);
+    CypBiReleaseReference(Context, Exponent);
+
+BiExponentiateMontgomeryEnd:
+
+    //
+    // Zero out the intermediate values to avoid leaking state.
+    //
+
+    RtlZeroMemory(Buffer, AllocationSize);
+    Context->FreeMemory(Buffer);
+    return Result;
+}
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    PBIG_INTEGER_COMPONENT Modulus,
+    UINTN Size,
+    BIG_INTEGER_COMPONENT Inverse,
+    PBIG_INTEGER_COMPONENT Scratch
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes (Left * Right) / R mod M, where R is the radix
+    raised to the size of the modulus. The multiplication and reduction are
+    interleaved a component at a time.
+
+Arguments:
+
+    Result - Supplies a pointer where the product will be returned. This may
+        be the same as either input.
+
+    Left - Supplies a pointer to the left value, which must be less than the
+        modulus.
+
+    Right - Supplies a pointer to the right value, which must be less than
+        the modulus.
+
+    Modulus - Supplies a pointer to the odd modulus.
+
+    Size - Supplies the number of components in the modulus and each value.
+
+    Inverse - Supplies the negative inverse of the lowest modulus component,
+        modulo the radix.
+
+    Scratch - Supplies a pointer to scratch space of at least two components
+        more than the size.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Borrow;
+    BIG_INTEGER_COMPONENT Carry;
+    BIG_INTEGER_LONG_COMPONENT Difference;
+    UINTN Index;
+    BIG_INTEGER_COMPONENT Mask;
+    BIG_INTEGER_COMPONENT Multiplier;
+    BIG_INTEGER_LONG_COMPONENT Product;
+    UINTN RightIndex;
+    BIG_INTEGER_COMPONENT RightValue;
+
+    RtlZeroMemory(Scratch, (Size + 2) * sizeof(BIG_INTEGER_COMPONENT));
+    for (RightIndex = 0; RightIndex < Size; RightIndex += 1) {
+
+        //
+        // Add the left value times the next right component.
+        //
+
+        RightValue = Right[RightIndex];
+        Carry = 0;
+        for (Index = 0; Index < Size; Index += 1) {
+            Product = ((BIG_INTEGER_LONG_COMPONENT)Left[Index] * RightValue) +
+                      Scratch[Index] + Carry;
+
+            Scratch[Index] = (BIG_INTEGER_COMPONENT)Product;
+            Carry = Product >> BIG_INTEGER_COMPONENT_BITS;
+        }
+
+        Product = (BIG_INTEGER_LONG_COMPONENT)Scratch[Size] + Carry;
+        Scratch[Size] = (BIG_INTEGER_COMPONENT)Product;
+        Scratch[Size + 1] = Product >> BIG_INTEGER_COMPONENT_BITS;
+
+        //
+        // Add the multiple of the modulus that zeroes the lowest component,
+        // and shift everything down by a component.
+        //
+
+        Multiplier = Scratch[0] * Inverse;
+        Product = ((BIG_INTEGER_LONG_COMPONENT)Modulus[0] * Multiplier) +
+                  Scratch[0];
+
+        Carry = Product >> BIG_INTEGER_COMPONENT_BITS;
+        for (Index = 1; Index < Size; Index += 1) {
+            Product = ((BIG_INTEGER_LONG_COMPONENT)Modulus[Index] *
+                       Multiplier) + Scratch[Index] + Carry;
+
+            Scratch[Index - 1] = (BIG_INTEGER_COMPONENT)Product;
+            Carry = Product >> BIG_INTEGER_COMPONENT_BITS;
+        }
+
+        Product = (BIG_INTEGER_LONG_COMPONENT)Scratch[Size] + Carry;
+        Scratch[Size - 1] = (BIG_INTEGER_COMPONENT)Product;
+        Scratch[Size] = Scratch[Size + 1] +
+                        (BIG_INTEGER_COMPONENT)(Product >>
+                                                BIG_INTEGER_COMPONENT_BITS);
+    }
+
+    //
+    // The total is now less than twice the modulus. Subtract the modulus,
+    // and keep the original instead if that went negative. Select with a
+    // mask rather than a branch so the timing doesn't depend on the value.
+    //
+
+    Borrow = 0;
+    for (Index = 0; Index < Size; Index += 1) {
+        Difference = (BIG_INTEGER_LONG_COMPONENT)Scratch[Index] -
+                     Modulus[Index] - Borrow;
+
+        Result[Index] = (BIG_INTEGER_COMPONENT)Difference;
+        Borrow = (BIG_INTEGER_COMPONENT)(Difference >>
+                                         BIG_INTEGER_COMPONENT_BITS) & 0x1;
+    }
+
+    Mask = (BIG_INTEGER_COMPONENT)0 - (Borrow & (Scratch[Size] ^ 0x1));
+    for (Index = 0; Index < Size; Index += 1) {
+        Result[Index] = (Scratch[Index] & Mask) | (Result[Index] & ~Mask);
+    }
+
+    return;
+}
+
+BIG_INTEGER_COMPONENT
+CypBiComputeMontgomeryInverse (
+    BIG_INTEGER_COMPONENT Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the negative multiplicative inverse of the given
+    odd value modulo the radix.
+
+Arguments:
+
+    Value - Supplies the odd value to invert.
+
+Return Value:
+
+    Returns the value that, when multiplied by the given value, produces
+    negative one modulo the radix.
+
+--*/
+
+{
+
+    UINTN Index;
+    BIG_INTEGER_COMPONENT Inverse;
+
+    //
+    // Every odd value is its own inverse modulo 8. Each Newton iteration then
+    // doubles the number of correct bits: 6, 12, 24, and then 48.
+    //
+
+    Inverse = Value;
+    for (Index = 0; Index < 4; Index += 1) {
+        Inverse *= 2 - (Value * Inverse);
+    }
+
+    ASSERT((BIG_INTEGER_COMPONENT)(Value * Inverse) == 1);
+
+    return (BIG_INTEGER_COMPONENT)0 - Inverse;
+}
+
+UINTN
+CypBiGetExponentWindow (
+    PBIG_INTEGER Exponent,
+    UINTN BitIndex,
+    UINTN WindowSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine extracts a window of bits from the exponent without
+    branching on the bit values.
+
+Arguments:
+
+    Exponent - Supplies a pointer to the exponent.
+
+    BitIndex - Supplies the index of the lowest bit in the window.
+
+    WindowSize - Supplies the number of bits in the window.
+
+Return Value:
+
+    Returns the value of the window. Bits beyond the end of the exponent read
+    as zero.
+
+--*/
+
+{
+
+    UINTN Bit;
+    UINTN ComponentIndex;
+    UINTN Window;
+
+    Window = 0;
+    for (Bit = BitIndex + WindowSize; Bit > BitIndex; Bit -= 1) {
+        Window <<= 1;
+        ComponentIndex = (Bit - 1) / BIG_INTEGER_COMPONENT_BITS;
+        if (ComponentIndex < Exponent->Size) {
+            Window |= (Exponent->Components[ComponentIndex] >>
+                       ((Bit - 1) % BIG_INTEGER_COMPONENT_BITS)) & 0x1;
+        }
+    }
+
+    return Window;
+}
+
+VOID
+CypBiSelectTableEntry (
+    PBIG_INTEGER_COMPONENT Destination,
+    PBIG_INTEGER_COMPONENT Table,
+    UINTN TableSize,
+    UINTN Size,
+    UINTN Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies an entry out of a table of values, reading every
+    entry so that the memory access pattern does not reveal the index.
+
+Arguments:
+
+    Destination - Supplies a pointer where the entry will be returned.
+
+    Table - Supplies a pointer to the table of values, stored back to back.
+
+    TableSize - Supplies the number of entries in the table.
+
+    Size - Supplies the number of components in each entry.
+
+    Index - Supplies the index of the entry to select.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN ComponentIndex;
+    UINTN Entry;
+    BIG_INTEGER_COMPONENT Mask;
+
+    RtlZeroMemory(Destination, Size * sizeof(BIG_INTEGER_COMPONENT));
+    for (Entry = 0; Entry < TableSize; Entry += 1) {
+
+        //
+        // The mask is all ones only when the entry and index are equal,
+        // since only then does subtracting one borrow out of the top bit.
+        //
+
+        Mask = (BIG_INTEGER_COMPONENT)0 -
+               (BIG_INTEGER_COMPONENT)(((Entry ^ Index) - 1) >>
+                                       ((sizeof(UINTN) * BITS_PER_BYTE) - 1));
+
+        for (ComponentIndex = 0; ComponentIndex < Size; ComponentIndex += 1) {
+            Destination[ComponentIndex] |= *Table & Mask;
+            Table += 1;
+        }
+    }
+
+    return;
+}
+
+VOID
+CypBiCopyComponents (
+    PBIG_INTEGER_COMPONENT Destination,
+    PBIG_INTEGER Source,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies the components of a big integer into a fixed size
+    array, padding it out with zeros.
+
+Arguments:
+
+    Destination - Supplies a pointer to the array to fill.
+
+    Source - Supplies a pointer to the big integer to copy, which must not be
+        larger than the array.
+
+    Size - Supplies the number of components in the array.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT(Source->Size <= Size);
+
+    RtlZeroMemory(Destination, Size * sizeof(BIG_INTEGER_COMPONENT));
+    RtlCopyMemory(Destination,
+                  Source->Components,
+                  Source->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    return;
+}
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
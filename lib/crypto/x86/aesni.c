@@ -0,0 +1,804 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    aesni.c
+
+Abstract:
+
+    This module implements the AES cipher modes using the processor's AES
+    instructions. It is shared between x86 and x64.
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "../cryptop.h"
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro applies an AES round instruction to each of the blocks in
+// flight. The blocks are independent, so the processor can overlap the
+// latency of one round instruction with the next.
+//
+
+#define AESNI_ROUND_BLOCKS(_Instruction, _Key)      \
+    Block0 = _Instruction(Block0, (_Key));          \
+    Block1 = _Instruction(Block1, (_Key));          \
+    Block2 = _Instruction(Block2, (_Key));          \
+    Block3 = _Instruction(Block3, (_Key))
+
+//
+// This macro advances a 128-bit big-endian counter held as two native 64-bit
+// halves.
+//
+
+#define AESNI_INCREMENT_COUNTER(_High, _Low) \
+    (_Low) += 1;                             \
+    (_High) += ((_Low) == 0)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// The AES instructions are not part of the baseline instruction set on either
+// architecture, and the kernel builds x64 without SSE, so these routines must
+// be compiled for them explicitly. They are only called once the processor
+// has been confirmed to support them.
+//
+
+#define AESNI_ROUTINE __attribute__((__target__("aes,ssse3")))
+
+//
+// The 32-bit stack is only guaranteed to be word aligned, so the routines
+// called from outside this file realign it for the vector values they keep
+// there.
+//
+
+#if defined(__i386)
+
+#define AESNI_ENTRY __attribute__((__force_align_arg_pointer__))
+
+#else
+
+#define AESNI_ENTRY
+
+#endif
+
+//
+// Define the number of blocks the codebook, counter, and chained decryption
+// routines keep in flight at once. Four blocks along with a round key fit in
+// the eight vector registers available on x86.
+//
+
+#define AESNI_PARALLEL_BLOCKS 4
+#define AESNI_PARALLEL_SIZE (AESNI_PARALLEL_BLOCKS * AES_BLOCK_SIZE)
+
+//
+// Define the shuffle masks that reverse the bytes of each 32-bit word and of
+// the whole 128-bit value.
+//
+
+#define AESNI_WORD_SWAP_HIGH 0x0C0D0E0F08090A0BLL
+#define AESNI_WORD_SWAP_LOW 0x0405060700010203LL
+#define AESNI_BYTE_SWAP_HIGH 0x0001020304050607LL
+#define AESNI_BYTE_SWAP_LOW 0x08090A0B0C0D0E0FLL
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+AESNI_ROUTINE
+VOID
+CypAesniLoadKeys (
+    PAES_CONTEXT Context,
+    BOOL Decrypt,
+    __m128i *Keys
+    );
+
+AESNI_ROUTINE
+VOID
+CypAesniEncryptBlocks (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Blocks
+    );
+
+AESNI_ROUTINE
+VOID
+CypAesniDecryptBlocks (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Blocks
+    );
+
+AESNI_ROUTINE
+VOID
+CypAesniEncryptBlock (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Block
+    );
+
+AESNI_ROUTINE
+VOID
+CypAesniDecryptBlock (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Block
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+AESNI_ROUTINE
+AESNI_ENTRY
+VOID
+CypAesEcbEncryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts a byte sequence using the AES codebook and the
+    processor's AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Blocks[AESNI_PARALLEL_BLOCKS];
+    UINTN Index;
+    __m128i Keys[AES_MAX_ROUNDS + 1];
+
+    CypAesniLoadKeys(Context, FALSE, Keys);
+    while (Length >= AESNI_PARALLEL_SIZE) {
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Blocks[Index] = _mm_loadu_si128((const __m128i *)Plaintext + Index);
+        }
+
+        CypAesniEncryptBlocks(Keys, Context->Rounds, Blocks);
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            _mm_storeu_si128((__m128i *)Ciphertext + Index, Blocks[Index]);
+        }
+
+        Plaintext += AESNI_PARALLEL_SIZE;
+        Ciphertext += AESNI_PARALLEL_SIZE;
+        Length -= AESNI_PARALLEL_SIZE;
+    }
+
+    while (Length != 0) {
+        Blocks[0] = _mm_loadu_si128((const __m128i *)Plaintext);
+        CypAesniEncryptBlock(Keys, Context->Rounds, &(Blocks[0]));
+        _mm_storeu_si128((__m128i *)Ciphertext, Blocks[0]);
+        Plaintext += AES_BLOCK_SIZE;
+        Ciphertext += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    return;
+}
+
+AESNI_ROUTINE
+AESNI_ENTRY
+VOID
+CypAesEcbDecryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts a byte sequence using the AES codebook and the
+    processor's AES instructions. The round keys must have been converted for
+    decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Blocks[AESNI_PARALLEL_BLOCKS];
+    UINTN Index;
+    __m128i Keys[AES_MAX_ROUNDS + 1];
+
+    CypAesniLoadKeys(Context, TRUE, Keys);
+    while (Length >= AESNI_PARALLEL_SIZE) {
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Blocks[Index] = _mm_loadu_si128((const __m128i *)Ciphertext +
+                                            Index);
+        }
+
+        CypAesniDecryptBlocks(Keys, Context->Rounds, Blocks);
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            _mm_storeu_si128((__m128i *)Plaintext + Index, Blocks[Index]);
+        }
+
+        Ciphertext += AESNI_PARALLEL_SIZE;
+        Plaintext += AESNI_PARALLEL_SIZE;
+        Length -= AESNI_PARALLEL_SIZE;
+    }
+
+    while (Length != 0) {
+        Blocks[0] = _mm_loadu_si128((const __m128i *)Ciphertext);
+        CypAesniDecryptBlock(Keys, Context->Rounds, &(Blocks[0]));
+        _mm_storeu_si128((__m128i *)Plaintext, Blocks[0]);
+        Ciphertext += AES_BLOCK_SIZE;
+        Plaintext += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    return;
+}
+
+AESNI_ROUTINE
+AESNI_ENTRY
+VOID
+CypAesCbcEncryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts a byte sequence using AES cipher block chaining and
+    the processor's AES instructions. Each block depends on the one before
+    it, so the blocks are encrypted one at a time.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The initialization
+        vector is updated to continue the chain.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Chain;
+    __m128i Keys[AES_MAX_ROUNDS + 1];
+
+    CypAesniLoadKeys(Context, FALSE, Keys);
+    Chain = _mm_loadu_si128((const __m128i *)(Context->InitializationVector));
+    while (Length != 0) {
+        Chain = _mm_xor_si128(Chain,
+                              _mm_loadu_si128((const __m128i *)Plaintext));
+
+        CypAesniEncryptBlock(Keys, Context->Rounds, &Chain);
+        _mm_storeu_si128((__m128i *)Ciphertext, Chain);
+        Plaintext += AES_BLOCK_SIZE;
+        Ciphertext += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    _mm_storeu_si128((__m128i *)(Context->InitializationVector), Chain);
+    return;
+}
+
+AESNI_ROUTINE
+AESNI_ENTRY
+VOID
+CypAesCbcDecryptHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts a byte sequence using AES cipher block chaining and
+    the processor's AES instructions. The round keys must have been converted
+    for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The initialization
+        vector is updated to continue the chain.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Blocks[AESNI_PARALLEL_BLOCKS];
+    __m128i Chain;
+    UINTN Index;
+    __m128i Input[AESNI_PARALLEL_BLOCKS];
+    __m128i Keys[AES_MAX_ROUNDS + 1];
+
+    CypAesniLoadKeys(Context, TRUE, Keys);
+    Chain = _mm_loadu_si128((const __m128i *)(Context->InitializationVector));
+
+    //
+    // Unlike encryption, decryption only chains in the previous ciphertext
+    // after the cipher, so several blocks can be decrypted at once. Load all
+    // of the ciphertext before storing any plaintext in case the buffers are
+    // the same.
+    //
+
+    while (Length >= AESNI_PARALLEL_SIZE) {
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Input[Index] = _mm_loadu_si128((const __m128i *)Ciphertext +
+                                           Index);
+
+            Blocks[Index] = Input[Index];
+        }
+
+        CypAesniDecryptBlocks(Keys, Context->Rounds, Blocks);
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Blocks[Index] = _mm_xor_si128(Blocks[Index], Chain);
+            Chain = Input[Index];
+            _mm_storeu_si128((__m128i *)Plaintext + Index, Blocks[Index]);
+        }
+
+        Ciphertext += AESNI_PARALLEL_SIZE;
+        Plaintext += AESNI_PARALLEL_SIZE;
+        Length -= AESNI_PARALLEL_SIZE;
+    }
+
+    while (Length != 0) {
+        Input[0] = _mm_loadu_si128((const __m128i *)Ciphertext);
+        Blocks[0] = Input[0];
+        CypAesniDecryptBlock(Keys, Context->Rounds, &(Blocks[0]));
+        Blocks[0] = _mm_xor_si128(Blocks[0], Chain);
+        Chain = Input[0];
+        _mm_storeu_si128((__m128i *)Plaintext, Blocks[0]);
+        Ciphertext += AES_BLOCK_SIZE;
+        Plaintext += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    _mm_storeu_si128((__m128i *)(Context->InitializationVector), Chain);
+    return;
+}
+
+AESNI_ROUTINE
+AESNI_ENTRY
+VOID
+CypAesCtrHardware (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts a byte sequence using AES counter mode
+    and the processor's AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. The counter is advanced
+        past the blocks processed.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Length - Supplies the length of the input and output buffers, in bytes.
+        This length must be a multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Blocks[AESNI_PARALLEL_BLOCKS];
+    __m128i ByteSwap;
+    ULONGLONG Counter[2];
+    ULONGLONG High;
+    UINTN Index;
+    __m128i Keys[AES_MAX_ROUNDS + 1];
+    ULONGLONG Low;
+    __m128i Value;
+
+    CypAesniLoadKeys(Context, FALSE, Keys);
+
+    //
+    // The counter is stored big-endian. Byte swap the whole thing to get the
+    // low half of the counter in the first native 64-bit word and the high
+    // half in the second.
+    //
+
+    ByteSwap = _mm_set_epi64x(AESNI_BYTE_SWAP_HIGH, AESNI_BYTE_SWAP_LOW);
+    Value = _mm_loadu_si128((const __m128i *)(Context->InitializationVector));
+    _mm_storeu_si128((__m128i *)Counter, _mm_shuffle_epi8(Value, ByteSwap));
+    Low = Counter[0];
+    High = Counter[1];
+    while (Length >= AESNI_PARALLEL_SIZE) {
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Value = _mm_set_epi64x(High, Low);
+            Blocks[Index] = _mm_shuffle_epi8(Value, ByteSwap);
+            AESNI_INCREMENT_COUNTER(High, Low);
+        }
+
+        CypAesniEncryptBlocks(Keys, Context->Rounds, Blocks);
+        for (Index = 0; Index < AESNI_PARALLEL_BLOCKS; Index += 1) {
+            Value = _mm_loadu_si128((const __m128i *)Input + Index);
+            Value = _mm_xor_si128(Value, Blocks[Index]);
+            _mm_storeu_si128((__m128i *)Output + Index, Value);
+        }
+
+        Input += AESNI_PARALLEL_SIZE;
+        Output += AESNI_PARALLEL_SIZE;
+        Length -= AESNI_PARALLEL_SIZE;
+    }
+
+    while (Length != 0) {
+        Value = _mm_set_epi64x(High, Low);
+        Blocks[0] = _mm_shuffle_epi8(Value, ByteSwap);
+        AESNI_INCREMENT_COUNTER(High, Low);
+        CypAesniEncryptBlock(Keys, Context->Rounds, &(Blocks[0]));
+        Value = _mm_loadu_si128((const __m128i *)Input);
+        Value = _mm_xor_si128(Value, Blocks[0]);
+        _mm_storeu_si128((__m128i *)Output, Value);
+        Input += AES_BLOCK_SIZE;
+        Output += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    //
+    // Store the counter back in the context, big-endian.
+    //
+
+    Value = _mm_set_epi64x(High, Low);
+    Value = _mm_shuffle_epi8(Value, ByteSwap);
+    _mm_storeu_si128((__m128i *)(Context->InitializationVector), Value);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+AESNI_ROUTINE
+VOID
+CypAesniLoadKeys (
+    PAES_CONTEXT Context,
+    BOOL Decrypt,
+    __m128i *Keys
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the context's round keys into the form the AES
+    instructions use.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Decrypt - Supplies a boolean indicating whether the round keys are being
+        loaded for decryption. The context's decryption schedule is stored
+        in the forward order, which the decryption instructions need
+        reversed.
+
+    Keys - Supplies a pointer to an array where the rounds plus one round keys
+        will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    __m128i Key;
+    ULONG Round;
+    __m128i WordSwap;
+
+    //
+    // The context stores each word of the key schedule as a native integer
+    // whose most significant byte is the first byte of the word. The AES
+    // instructions want the bytes in order.
+    //
+
+    WordSwap = _mm_set_epi64x(AESNI_WORD_SWAP_HIGH, AESNI_WORD_SWAP_LOW);
+    for (Round = 0; Round <= Context->Rounds; Round += 1) {
+        Index = Round;
+        if (Decrypt != FALSE) {
+            Index = Context->Rounds - Round;
+        }
+
+        Key = _mm_loadu_si128((const __m128i *)&(Context->Keys[Index * 4]));
+        Keys[Round] = _mm_shuffle_epi8(Key, WordSwap);
+    }
+
+    return;
+}
+
+AESNI_ROUTINE
+VOID
+CypAesniEncryptBlocks (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Blocks
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts several independent blocks at once.
+
+Arguments:
+
+    Keys - Supplies a pointer to the round keys.
+
+    Rounds - Supplies the number of rounds.
+
+    Blocks - Supplies a pointer to the AESNI_PARALLEL_BLOCKS blocks to
+        encrypt in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Block0;
+    __m128i Block1;
+    __m128i Block2;
+    __m128i Block3;
+    ULONG Round;
+
+    Block0 = Blocks[0];
+    Block1 = Blocks[1];
+    Block2 = Blocks[2];
+    Block3 = Blocks[3];
+    AESNI_ROUND_BLOCKS(_mm_xor_si128, Keys[0]);
+    for (Round = 1; Round < Rounds; Round += 1) {
+        AESNI_ROUND_BLOCKS(_mm_aesenc_si128, Keys[Round]);
+    }
+
+    AESNI_ROUND_BLOCKS(_mm_aesenclast_si128, Keys[Rounds]);
+    Blocks[0] = Block0;
+    Blocks[1] = Block1;
+    Blocks[2] = Block2;
+    Blocks[3] = Block3;
+    return;
+}
+
+AESNI_ROUTINE
+VOID
+CypAesniDecryptBlocks (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Blocks
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts several independent blocks at once.
+
+Arguments:
+
+    Keys - Supplies a pointer to the round keys, in decryption order.
+
+    Rounds - Supplies the number of rounds.
+
+    Blocks - Supplies a pointer to the AESNI_PARALLEL_BLOCKS blocks to
+        decrypt in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Block0;
+    __m128i Block1;
+    __m128i Block2;
+    __m128i Block3;
+    ULONG Round;
+
+    Block0 = Blocks[0];
+    Block1 = Blocks[1];
+    Block2 = Blocks[2];
+    Block3 = Blocks[3];
+    AESNI_ROUND_BLOCKS(_mm_xor_si128, Keys[0]);
+    for (Round = 1; Round < Rounds; Round += 1) {
+        AESNI_ROUND_BLOCKS(_mm_aesdec_si128, Keys[Round]);
+    }
+
+    AESNI_ROUND_BLOCKS(_mm_aesdeclast_si128, Keys[Rounds]);
+    Blocks[0] = Block0;
+    Blocks[1] = Block1;
+    Blocks[2] = Block2;
+    Blocks[3] = Block3;
+    return;
+}
+
+AESNI_ROUTINE
+VOID
+CypAesniEncryptBlock (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Block
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts a single block.
+
+Arguments:
+
+    Keys - Supplies a pointer to the round keys.
+
+    Rounds - Supplies the number of rounds.
+
+    Block - Supplies a pointer to the block to encrypt in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Round;
+    __m128i Value;
+
+    Value = _mm_xor_si128(*Block, Keys[0]);
+    for (Round = 1; Round < Rounds; Round += 1) {
+        Value = _mm_aesenc_si128(Value, Keys[Round]);
+    }
+
+    *Block = _mm_aesenclast_si128(Value, Keys[Rounds]);
+    return;
+}
+
+AESNI_ROUTINE
+VOID
+CypAesniDecryptBlock (
+    const __m128i *Keys,
+    ULONG Rounds,
+    __m128i *Block
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts a single block.
+
+Arguments:
+
+    Keys - Supplies a pointer to the round keys, in decryption order.
+
+    Rounds - Supplies the number of rounds.
+
+    Block - Supplies a pointer to the block to decrypt in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Round;
+    __m128i Value;
+
+    Value = _mm_xor_si128(*Block, Keys[0]);
+    for (Round = 1; Round < Rounds; Round += 1) {
+        Value = _mm_aesdec_si128(Value, Keys[Round]);
+    }
+
+    *Block = _mm_aesdeclast_si128(Value, Keys[Rounds]);
+    return;
+}
+
@@ -0,0 +1,398 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    shani.c
+
+Abstract:
+
+    This module implements the SHA-1 and SHA-256 compression functions using
+    the processor's SHA instructions. It is shared between x86 and x64.
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "../cryptop.h"
+#include <immintrin.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro performs four SHA-1 rounds while advancing the message schedule.
+// The message words for these rounds are in _Message. The next group of
+// message words gets its final step, the group after that gets its middle
+// step, and the group after that gets its first step. _Save receives the
+// current state, from which the next E value is derived.
+//
+
+#define SHA1_NI_ROUNDS(_E,                                              \
+                       _Save,                                           \
+                       _Message,                                        \
+                       _Next1,                                          \
+                       _Next2,                                          \
+                       _Next3,                                          \
+                       _Function)                                       \
+                                                                        \
+    (_E) = _mm_sha1nexte_epu32((_E), (_Message));                       \
+    (_Save) = Abcd;                                                     \
+    (_Next1) = _mm_sha1msg2_epu32((_Next1), (_Message));                \
+    Abcd = _mm_sha1rnds4_epu32(Abcd, (_E), (_Function));                \
+    (_Next3) = _mm_sha1msg1_epu32((_Next3), (_Message));                \
+    (_Next2) = _mm_xor_si128((_Next2), (_Message))
+
+//
+// This macro performs four SHA-256 rounds on the given message words. The
+// instruction does two rounds at a time, taking the message words and round
+// constants summed together from the low half of its last operand.
+//
+
+#define SHA256_NI_ROUNDS(_Message, _Round)                              \
+    Work = _mm_loadu_si128((const __m128i *)                            \
+                           &(CySha256KConstants[(_Round)]));            \
+                                                                        \
+    Work = _mm_add_epi32(Work, (_Message));                             \
+    State1 = _mm_sha256rnds2_epu32(State1, State0, Work);               \
+    Work = _mm_shuffle_epi32(Work, 0x0E);                               \
+    State0 = _mm_sha256rnds2_epu32(State0, State1, Work)
+
+//
+// This macro computes the next four SHA-256 message words from the previous
+// sixteen.
+//
+
+#define SHA256_NI_SCHEDULE(_Message0, _Message1, _Message2, _Message3)  \
+    (_Message0) = _mm_sha256msg1_epu32((_Message0), (_Message1));       \
+    (_Message0) = _mm_add_epi32((_Message0),                            \
+                                _mm_alignr_epi8((_Message3),            \
+                                                (_Message2),            \
+                                                4));                    \
+                                                                        \
+    (_Message0) = _mm_sha256msg2_epu32((_Message0), (_Message3))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// The SHA instructions are not part of the baseline instruction set on either
+// architecture, and the kernel builds x64 without SSE, so these routines must
+// be compiled for them explicitly. They are only called once the processor
+// has been confirmed to support them.
+//
+
+#define SHANI_ROUTINE __attribute__((__target__("sha,ssse3,sse4.1")))
+
+//
+// The 32-bit stack is only guaranteed to be word aligned, so the routines
+// called from outside this file realign it for the vector values they keep
+// there.
+//
+
+#if defined(__i386)
+
+#define SHANI_ENTRY __attribute__((__force_align_arg_pointer__))
+
+#else
+
+#define SHANI_ENTRY
+
+#endif
+
+//
+// Both SHA-1 and SHA-256 work on 64 byte message blocks.
+//
+
+#define SHANI_BLOCK_SIZE 64
+
+//
+// Define the shuffle masks that convert the big-endian message to native
+// words. SHA-1 also wants the words in reverse order.
+//
+
+#define SHA1_NI_SWAP_HIGH 0x0001020304050607LL
+#define SHA1_NI_SWAP_LOW 0x08090A0B0C0D0E0FLL
+#define SHA256_NI_SWAP_HIGH 0x0C0D0E0F08090A0BLL
+#define SHA256_NI_SWAP_LOW 0x0405060700010203LL
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+SHANI_ROUTINE
+SHANI_ENTRY
+VOID
+CypSha1ProcessBlocksHardware (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds whole message blocks to a SHA-1 digest using the
+    processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Abcd;
+    __m128i AbcdSave;
+    __m128i ByteSwap;
+    __m128i E0;
+    __m128i E1;
+    __m128i ESave;
+    __m128i Message0;
+    __m128i Message1;
+    __m128i Message2;
+    __m128i Message3;
+
+    //
+    // The instructions keep A in the most significant word, and E in the most
+    // significant word of its own register.
+    //
+
+    Abcd = _mm_loadu_si128((const __m128i *)State);
+    Abcd = _mm_shuffle_epi32(Abcd, 0x1B);
+    E0 = _mm_set_epi32(State[4], 0, 0, 0);
+    ByteSwap = _mm_set_epi64x(SHA1_NI_SWAP_HIGH, SHA1_NI_SWAP_LOW);
+    while (BlockCount != 0) {
+        AbcdSave = Abcd;
+        ESave = E0;
+
+        //
+        // Rounds 0 through 15 load the message as they go, and start the
+        // schedule for the words after it.
+        //
+
+        Message0 = _mm_loadu_si128((const __m128i *)Data);
+        Message0 = _mm_shuffle_epi8(Message0, ByteSwap);
+        E0 = _mm_add_epi32(E0, Message0);
+        E1 = Abcd;
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E0, 0);
+        Message1 = _mm_loadu_si128((const __m128i *)Data + 1);
+        Message1 = _mm_shuffle_epi8(Message1, ByteSwap);
+        E1 = _mm_sha1nexte_epu32(E1, Message1);
+        E0 = Abcd;
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E1, 0);
+        Message0 = _mm_sha1msg1_epu32(Message0, Message1);
+        Message2 = _mm_loadu_si128((const __m128i *)Data + 2);
+        Message2 = _mm_shuffle_epi8(Message2, ByteSwap);
+        E0 = _mm_sha1nexte_epu32(E0, Message2);
+        E1 = Abcd;
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E0, 0);
+        Message1 = _mm_sha1msg1_epu32(Message1, Message2);
+        Message0 = _mm_xor_si128(Message0, Message2);
+        Message3 = _mm_loadu_si128((const __m128i *)Data + 3);
+        Message3 = _mm_shuffle_epi8(Message3, ByteSwap);
+        SHA1_NI_ROUNDS(E1, E0, Message3, Message0, Message1, Message2, 0);
+
+        //
+        // Rounds 16 through 67 compute the schedule alongside the rounds.
+        //
+
+        SHA1_NI_ROUNDS(E0, E1, Message0, Message1, Message2, Message3, 0);
+        SHA1_NI_ROUNDS(E1, E0, Message1, Message2, Message3, Message0, 1);
+        SHA1_NI_ROUNDS(E0, E1, Message2, Message3, Message0, Message1, 1);
+        SHA1_NI_ROUNDS(E1, E0, Message3, Message0, Message1, Message2, 1);
+        SHA1_NI_ROUNDS(E0, E1, Message0, Message1, Message2, Message3, 1);
+        SHA1_NI_ROUNDS(E1, E0, Message1, Message2, Message3, Message0, 1);
+        SHA1_NI_ROUNDS(E0, E1, Message2, Message3, Message0, Message1, 2);
+        SHA1_NI_ROUNDS(E1, E0, Message3, Message0, Message1, Message2, 2);
+        SHA1_NI_ROUNDS(E0, E1, Message0, Message1, Message2, Message3, 2);
+        SHA1_NI_ROUNDS(E1, E0, Message1, Message2, Message3, Message0, 2);
+        SHA1_NI_ROUNDS(E0, E1, Message2, Message3, Message0, Message1, 2);
+        SHA1_NI_ROUNDS(E1, E0, Message3, Message0, Message1, Message2, 3);
+        SHA1_NI_ROUNDS(E0, E1, Message0, Message1, Message2, Message3, 3);
+
+        //
+        // The last three groups wind down the schedule.
+        //
+
+        E1 = _mm_sha1nexte_epu32(E1, Message1);
+        E0 = Abcd;
+        Message2 = _mm_sha1msg2_epu32(Message2, Message1);
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E1, 3);
+        Message3 = _mm_xor_si128(Message3, Message1);
+        E0 = _mm_sha1nexte_epu32(E0, Message2);
+        E1 = Abcd;
+        Message3 = _mm_sha1msg2_epu32(Message3, Message2);
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E0, 3);
+        E1 = _mm_sha1nexte_epu32(E1, Message3);
+        E0 = Abcd;
+        Abcd = _mm_sha1rnds4_epu32(Abcd, E1, 3);
+
+        //
+        // Add this block's result into the running hash.
+        //
+
+        E0 = _mm_sha1nexte_epu32(E0, ESave);
+        Abcd = _mm_add_epi32(Abcd, AbcdSave);
+        Data += SHANI_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    Abcd = _mm_shuffle_epi32(Abcd, 0x1B);
+    _mm_storeu_si128((__m128i *)State, Abcd);
+    State[4] = _mm_extract_epi32(E0, 3);
+    return;
+}
+
+SHANI_ROUTINE
+SHANI_ENTRY
+VOID
+CypSha256ProcessBlocksHardware (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds whole message blocks to a SHA-256 digest using the
+    processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i ByteSwap;
+    __m128i Message0;
+    __m128i Message1;
+    __m128i Message2;
+    __m128i Message3;
+    ULONG Round;
+    __m128i State0;
+    __m128i State0Save;
+    __m128i State1;
+    __m128i State1Save;
+    __m128i Work;
+
+    //
+    // The instructions want the state split as A, B, E, F and C, D, G, H,
+    // with A and C in the most significant words.
+    //
+
+    Work = _mm_loadu_si128((const __m128i *)State);
+    State1 = _mm_loadu_si128((const __m128i *)State + 1);
+    Work = _mm_shuffle_epi32(Work, 0xB1);
+    State1 = _mm_shuffle_epi32(State1, 0x1B);
+    State0 = _mm_alignr_epi8(Work, State1, 8);
+    State1 = _mm_blend_epi16(State1, Work, 0xF0);
+    ByteSwap = _mm_set_epi64x(SHA256_NI_SWAP_HIGH, SHA256_NI_SWAP_LOW);
+    while (BlockCount != 0) {
+        State0Save = State0;
+        State1Save = State1;
+        Message0 = _mm_loadu_si128((const __m128i *)Data);
+        Message0 = _mm_shuffle_epi8(Message0, ByteSwap);
+        Message1 = _mm_loadu_si128((const __m128i *)Data + 1);
+        Message1 = _mm_shuffle_epi8(Message1, ByteSwap);
+        Message2 = _mm_loadu_si128((const __m128i *)Data + 2);
+        Message2 = _mm_shuffle_epi8(Message2, ByteSwap);
+        Message3 = _mm_loadu_si128((const __m128i *)Data + 3);
+        Message3 = _mm_shuffle_epi8(Message3, ByteSwap);
+
+        //
+        // Each pass does sixteen rounds. After the first pass, compute each
+        // group of message words just before it is needed so the schedule
+        // overlaps with the rounds on the group before it.
+        //
+
+        for (Round = 0; Round < 64; Round += 16) {
+            if (Round != 0) {
+                SHA256_NI_SCHEDULE(Message0, Message1, Message2, Message3);
+            }
+
+            SHA256_NI_ROUNDS(Message0, Round);
+            if (Round != 0) {
+                SHA256_NI_SCHEDULE(Message1, Message2, Message3, Message0);
+            }
+
+            SHA256_NI_ROUNDS(Message1, Round + 4);
+            if (Round != 0) {
+                SHA256_NI_SCHEDULE(Message2, Message3, Message0, Message1);
+            }
+
+            SHA256_NI_ROUNDS(Message2, Round + 8);
+            if (Round != 0) {
+                SHA256_NI_SCHEDULE(Message3, Message0, Message1, Message2);
+            }
+
+            SHA256_NI_ROUNDS(Message3, Round + 12);
+        }
+
+        State0 = _mm_add_epi32(State0, State0Save);
+        State1 = _mm_add_epi32(State1, State1Save);
+        Data += SHANI_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    //
+    // Put the state back in order.
+    //
+
+    Work = _mm_shuffle_epi32(State0, 0x1B);
+    State1 = _mm_shuffle_epi32(State1, 0xB1);
+    State0 = _mm_blend_epi16(Work, State1, 0xF0);
+    State1 = _mm_alignr_epi8(State1, Work, 8);
+    _mm_storeu_si128((__m128i *)State, State0);
+    _mm_storeu_si128((__m128i *)State + 1, State1);
+    return;
+}
+
@@ -70,6 +70,9 @@ Module Name:
 #define ImpElfGetSymbol ImpElf64GetSymbol
 #define ImpElfApplyRelocation ImpElf64ApplyRelocation
 #define ImpElfFreeContext ImpElf64FreeContext
+#define ImpElfCreateRelocationCache ImpElf64CreateRelocationCache
+#define ImpElfGetSymbolCount ImpElf64GetSymbolCount
+#define ImpElfGetImageIdentity ImpElf64GetImageIdentity
 
 #else
 
@@ -98,6 +101,9 @@ Module Name:
 #define ImpElfGetSymbol ImpElf32GetSymbol
 #define ImpElfApplyRelocation ImpElf32ApplyRelocation
 #define ImpElfFreeContext ImpElf32FreeContext
+#define ImpElfCreateRelocationCache ImpElf32CreateRelocationCache
+#define ImpElfGetSymbolCount ImpElf32GetSymbolCount
+#define ImpElfGetImageIdentity ImpElf32GetImageIdentity
 
 #endif
 
@@ -143,6 +149,14 @@ Structure Description:
     RelocationEnd - Stores the address at the end of the highest image
         relocation.
 
+    RelocationCache - Stores an optional pointer to the relocation cache in
+        use while the image is being relocated.
+
+    SymbolCache - Stores an optional pointer to the relocation cache entries
+        for this image, indexed by symbol index.
+
+    SymbolCount - Stores the number of entries in the symbol cache.
+
 --*/
 
 typedef struct _ELF_LOADING_IMAGE {
@@ -150,6 +164,9 @@ typedef struct _ELF_LOADING_IMAGE {
     PELF_HEADER ElfHeader;
     PVOID RelocationStart;
     PVOID RelocationEnd;
+    PELF_RELOCATION_CACHE RelocationCache;
+    PELF_SYMBOL_CACHE_ENTRY SymbolCache;
+    ULONG SymbolCount;
 } ELF_LOADING_IMAGE, *PELF_LOADING_IMAGE;
 
 //
@@ -232,6 +249,22 @@ ImpElfFreeContext (
     PLOADED_IMAGE Image
     );
 
+VOID
+ImpElfCreateRelocationCache (
+    PLIST_ENTRY ListHead,
+    PELF_RELOCATION_CACHE Cache
+    );
+
+ULONG
+ImpElfGetSymbolCount (
+    PLOADED_IMAGE Image
+    );
+
+ULONGLONG
+ImpElfGetImageIdentity (
+    PLOADED_IMAGE Image
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -1644,29 +1677,67 @@ Return Value:
 
 {
 
+    ELF_RELOCATION_CACHE Cache;
     PLIST_ENTRY CurrentEntry;
     PLOADED_IMAGE CurrentImage;
+    ULONG ImageIndex;
+    PELF_LOADING_IMAGE LoadingImage;
+    PELF_RELOCATION_CACHE_IMAGE Records;
     KSTATUS Status;
 
+    RtlZeroMemory(&Cache, sizeof(ELF_RELOCATION_CACHE));
     Status = ImpElfLoadAllImports(ListHead);
     if (!KSUCCESS(Status)) {
         goto RelocateImagesEnd;
     }
 
+    //
+    // Set up the cache of symbol resolutions. Failure to create it is not
+    // fatal, it just means every symbol is looked up by name.
+    //
+
+    ImpElfCreateRelocationCache(ListHead, &Cache);
+    Records = NULL;
+    if (Cache.Header != NULL) {
+        Records = (PELF_RELOCATION_CACHE_IMAGE)(Cache.Header + 1);
+    }
+
     //
     // Iterate backwards because a copy relocation in the executable might
     // copy a portion of a shared library that has relocations inside it. So
     // the relocations in that region need to be fixed up before the copy.
     //
 
+    ImageIndex = Cache.ImageCount;
     CurrentEntry = ListHead->Previous;
     while (CurrentEntry != ListHead) {
         CurrentImage = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
 
         ASSERT(CurrentImage->Format == ImageElfNative);
 
+        if (Records != NULL) {
+            ImageIndex -= 1;
+        }
+
         if ((CurrentImage->Flags & IMAGE_FLAG_RELOCATED) == 0) {
+            LoadingImage = CurrentImage->ImageContext;
+            if (Records != NULL) {
+
+                ASSERT(Cache.Images[ImageIndex] == CurrentImage);
+
+                LoadingImage->RelocationCache = &Cache;
+                LoadingImage->SymbolCache =
+                               (PELF_SYMBOL_CACHE_ENTRY)(Records +
+                                                         Cache.ImageCount) +
+                               Records[ImageIndex].EntryIndex;
+
+                LoadingImage->SymbolCount = Records[ImageIndex].SymbolCount;
+            }
+
             Status = ImpElfRelocateImage(CurrentImage);
+            LoadingImage->RelocationCache = NULL;
+            LoadingImage->SymbolCache = NULL;
+            LoadingImage->SymbolCount = 0;
             if (!KSUCCESS(Status)) {
                 goto RelocateImagesEnd;
             }
@@ -1691,6 +1762,7 @@ Return Value:
     Status = STATUS_SUCCESS;
 
 RelocateImagesEnd:
+    ImpElfDestroyRelocationCache(&Cache, KSUCCESS(Status));
     return Status;
 }
 
@@ -1807,14 +1879,69 @@ Return Value:
 
 {
 
+    PELF_SCOPE_CACHE Cache;
+    PELF_SCOPE_CACHE_ENTRY CacheEntry;
     PELF_SYMBOL ElfSymbol;
+    BOOL Equal;
     PLOADED_IMAGE FoundImage;
+    ULONG Hash;
     ELF_SYMBOL_TYPE SymbolType;
     ELF_ADDR Value;
 
     ASSERT(Image->Format == ImageElfNative);
 
-    ElfSymbol = ImpElfGetSymbolInScope(Image, Skip, SymbolName, &FoundImage);
+    //
+    // Check the scope's cache of recent lookups before searching every image
+    // in the scope.
+    //
+
+    ElfSymbol = NULL;
+    CacheEntry = NULL;
+    FoundImage = NULL;
+    Cache = ImpElfAcquireScopeCache(Image);
+    if (Cache != NULL) {
+        Hash = ImpElfGnuHash(SymbolName);
+        CacheEntry = &(Cache->Entries[Hash % ELF_SCOPE_CACHE_SIZE]);
+        if ((CacheEntry->Symbol != NULL) &&
+            (CacheEntry->Hash == Hash) &&
+            (CacheEntry->Skip == Skip)) {
+
+            ElfSymbol = CacheEntry->Symbol;
+            FoundImage = CacheEntry->Image;
+            Equal = RtlAreStringsEqual(SymbolName,
+                                       FoundImage->ExportStringTable +
+                                       ElfSymbol->NameOffset,
+                                       FoundImage->ExportStringTableSize -
+                                       ElfSymbol->NameOffset);
+
+            if (Equal == FALSE) {
+                ElfSymbol = NULL;
+            }
+        }
+
+        if (ElfSymbol == NULL) {
+            ElfSymbol = ImpElfGetSymbolInScope(Image,
+                                               Skip,
+                                               SymbolName,
+                                               &FoundImage);
+
+            if (ElfSymbol != NULL) {
+                CacheEntry->Hash = Hash;
+                CacheEntry->Skip = Skip;
+                CacheEntry->Image = FoundImage;
+                CacheEntry->Symbol = ElfSymbol;
+            }
+        }
+
+        ImpElfReleaseScopeCache(Cache);
+
+    } else {
+        ElfSymbol = ImpElfGetSymbolInScope(Image,
+                                           Skip,
+                                           SymbolName,
+                                           &FoundImage);
+    }
+
     if (ElfSymbol == NULL) {
         return STATUS_NOT_FOUND;
     }
@@ -3507,6 +3634,8 @@ Return Value:
     BOOL RelocationNeeded;
     PELF_ADDR RelocationPlace;
     ELF_XWORD RelocationType;
+    PELF_SYMBOL_CACHE_ENTRY SymbolCacheEntry;
+    ULONG SymbolImageIndex;
     PLOADED_IMAGE SymbolImage;
     ELF_XWORD SymbolIndex;
     PELF_SYMBOL Symbols;
@@ -3540,16 +3669,54 @@ Return Value:
     RelocationType = ELF_GET_RELOCATION_TYPE(Information);
 
     //
-    // Compute the symbol value.
+    // Compute the symbol value. While the image is being relocated, each
+    // symbol is only resolved by name once, and may already have been
+    // resolved by a previous process that loaded the same images.
     //
 
-    SymbolValue = ImpElfGetSymbolValue(Image,
-                                       &(Symbols[SymbolIndex]),
-                                       &SymbolImage,
-                                       NULL);
+    SymbolCacheEntry = NULL;
+    if ((LoadingImage != NULL) &&
+        (LoadingImage->SymbolCache != NULL) &&
+        (SymbolIndex != 0) &&
+        (SymbolIndex < LoadingImage->SymbolCount)) {
 
-    if (SymbolValue == ELF_INVALID_ADDRESS) {
-        SymbolValue = 0;
+        SymbolCacheEntry = &(LoadingImage->SymbolCache[SymbolIndex]);
+    }
+
+    if ((SymbolCacheEntry != NULL) &&
+        ((SymbolCacheEntry->Flags & ELF_SYMBOL_CACHE_VALID) != 0)) {
+
+        SymbolValue = (ELF_ADDR)SymbolCacheEntry->Value;
+        SymbolImage = NULL;
+        SymbolImageIndex = SymbolCacheEntry->ImageIndex;
+        if (SymbolImageIndex != ELF_SYMBOL_CACHE_NO_IMAGE) {
+            SymbolImage =
+                      LoadingImage->RelocationCache->Images[SymbolImageIndex];
+        }
+
+    } else {
+        SymbolValue = ImpElfGetSymbolValue(Image,
+                                           &(Symbols[SymbolIndex]),
+                                           &SymbolImage,
+                                           NULL);
+
+        //
+        // Unresolved symbols aren't cached so that the warning shows up
+        // every time.
+        //
+
+        if ((SymbolCacheEntry != NULL) &&
+            (SymbolValue != ELF_INVALID_ADDRESS)) {
+
+            ImpElfRecordCachedSymbol(LoadingImage->RelocationCache,
+                                     SymbolCacheEntry,
+                                     SymbolValue,
+                                     SymbolImage);
+        }
+
+        if (SymbolValue == ELF_INVALID_ADDRESS) {
+            SymbolValue = 0;
+        }
     }
 
     if (FinalSymbolValue != NULL) {
@@ -4111,3 +4278,281 @@ Return Value:
     return;
 }
 
+VOID
+ImpElfCreateRelocationCache (
+    PLIST_ENTRY ListHead,
+    PELF_RELOCATION_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the symbol resolution cache used while relocating the
+    given list of images. If the list is the initial set of images of a
+    process, the cache is persistent and previously saved resolutions are
+    loaded.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of images about to
+        be relocated.
+
+    Cache - Supplies a pointer to the cache to initialize. On failure, the
+        header will be NULL.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    ULONG EntryCount;
+    PELF_RELOCATION_CACHE_HEADER Header;
+    PLOADED_IMAGE Image;
+    ULONG ImageCount;
+    ULONG ImageIndex;
+    BOOL Persistent;
+    PELF_RELOCATION_CACHE_IMAGE Records;
+    UINTN Size;
+    ULONG SymbolCount;
+
+    RtlZeroMemory(Cache, sizeof(ELF_RELOCATION_CACHE));
+
+    //
+    // Only the images a process starts with are worth remembering. Those are
+    // loaded the same way every time the program runs, where the results of
+    // later dynamic loads depend on everything that happened before them.
+    //
+
+    Persistent = FALSE;
+    if ((ImSaveFile != NULL) &&
+        (ImOpenCacheFile != NULL) &&
+        (ImPrimaryExecutable != NULL) &&
+        ((ImPrimaryExecutable->Flags & IMAGE_FLAG_RELOCATED) == 0) &&
+        (ImpElfGetEnvironmentVariable(ELF_NO_RELOCATION_CACHE) == NULL)) {
+
+        Persistent = TRUE;
+    }
+
+    ImageCount = 0;
+    EntryCount = 0;
+    CurrentEntry = ListHead->Next;
+    while (CurrentEntry != ListHead) {
+        Image = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
+        if ((Image->Flags & IMAGE_FLAG_RELOCATED) == 0) {
+            EntryCount += ImpElfGetSymbolCount(Image);
+        }
+
+        ImageCount += 1;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    if (EntryCount == 0) {
+        return;
+    }
+
+    Cache->Images = ImAllocateMemory(ImageCount * sizeof(PLOADED_IMAGE),
+                                     IM_ALLOCATION_TAG);
+
+    if (Cache->Images == NULL) {
+        return;
+    }
+
+    Size = sizeof(ELF_RELOCATION_CACHE_HEADER) +
+           (ImageCount * sizeof(ELF_RELOCATION_CACHE_IMAGE)) +
+           (EntryCount * sizeof(ELF_SYMBOL_CACHE_ENTRY));
+
+    Header = ImAllocateMemory(Size, IM_ALLOCATION_TAG);
+    if (Header == NULL) {
+        ImFreeMemory(Cache->Images);
+        Cache->Images = NULL;
+        return;
+    }
+
+    RtlZeroMemory(Header, Size);
+    Header->Magic = ELF_RELOCATION_CACHE_MAGIC;
+    Header->Version = ELF_RELOCATION_CACHE_VERSION;
+    Header->ImageCount = ImageCount;
+    Header->EntryCount = EntryCount;
+    Records = (PELF_RELOCATION_CACHE_IMAGE)(Header + 1);
+    EntryCount = 0;
+    ImageIndex = 0;
+    CurrentEntry = ListHead->Next;
+    while (CurrentEntry != ListHead) {
+        Image = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
+        Cache->Images[ImageIndex] = Image;
+        SymbolCount = 0;
+        if ((Image->Flags & IMAGE_FLAG_RELOCATED) == 0) {
+            SymbolCount = ImpElfGetSymbolCount(Image);
+        }
+
+        Records[ImageIndex].Base = (UINTN)Image->LoadedImageBuffer;
+        Records[ImageIndex].SymbolCount = SymbolCount;
+        Records[ImageIndex].EntryIndex = EntryCount;
+        if (Persistent != FALSE) {
+            Records[ImageIndex].Identity = ImpElfGetImageIdentity(Image);
+        }
+
+        EntryCount += SymbolCount;
+        ImageIndex += 1;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    Cache->SystemContext = Cache->Images[0]->SystemContext;
+    Cache->ImageCount = ImageCount;
+    Cache->Header = Header;
+    Cache->Size = Size;
+    Cache->Persistent = Persistent;
+    if (Persistent != FALSE) {
+        ImpElfLoadRelocationCache(Cache);
+    }
+
+    return;
+}
+
+ULONG
+ImpElfGetSymbolCount (
+    PLOADED_IMAGE Image
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the number of entries in an image's dynamic
+    symbol table.
+
+Arguments:
+
+    Image - Supplies a pointer to the image.
+
+Return Value:
+
+    Returns the number of dynamic symbols.
+
+--*/
+
+{
+
+    ELF_WORD BucketCount;
+    ELF_WORD BucketIndex;
+    PELF_WORD Buckets;
+    PELF_WORD HashChains;
+    PELF_WORD HashTable;
+    ELF_WORD SymbolBase;
+    ELF_WORD SymbolIndex;
+
+    HashTable = Image->ExportHashTable;
+    if ((Image->ExportSymbolTable == NULL) || (HashTable == NULL)) {
+        return 0;
+    }
+
+    //
+    // The traditional hash table's chain array has one element per symbol.
+    //
+
+    if ((Image->Flags & IMAGE_FLAG_GNU_HASH) == 0) {
+        return HashTable[1];
+    }
+
+    //
+    // The GNU hash table only covers the symbols from the base onward, so
+    // find the last chain and walk to its end. The Bloom filter words are
+    // address sized.
+    //
+
+    BucketCount = HashTable[0];
+    SymbolBase = HashTable[1];
+    Buckets = (PELF_WORD)((PELF_ADDR)(HashTable + 4) + HashTable[2]);
+    HashChains = Buckets + BucketCount;
+    SymbolIndex = 0;
+    for (BucketIndex = 0; BucketIndex < BucketCount; BucketIndex += 1) {
+        if (Buckets[BucketIndex] > SymbolIndex) {
+            SymbolIndex = Buckets[BucketIndex];
+        }
+    }
+
+    if (SymbolIndex < SymbolBase) {
+        return SymbolBase;
+    }
+
+    while ((HashChains[SymbolIndex - SymbolBase] & 0x1) == 0) {
+        SymbolIndex += 1;
+    }
+
+    return SymbolIndex + 1;
+}
+
+ULONGLONG
+ImpElfGetImageIdentity (
+    PLOADED_IMAGE Image
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes a value that changes whenever the given image's
+    file or exported symbols change.
+
+Arguments:
+
+    Image - Supplies a pointer to the image.
+
+Return Value:
+
+    Returns the identity hash of the image.
+
+--*/
+
+{
+
+    PIMAGE_FILE_INFORMATION File;
+    ULONGLONG Identity;
+    ULONG SymbolCount;
+
+    Identity = ELF_DATA_HASH_SEED;
+    File = &(Image->File);
+    if ((File->DeviceId != 0) || (File->FileId != 0)) {
+        Identity = ImpElfHashData(Identity,
+                                  &(File->DeviceId),
+                                  sizeof(File->DeviceId));
+
+        Identity = ImpElfHashData(Identity,
+                                  &(File->FileId),
+                                  sizeof(File->FileId));
+
+        Identity = ImpElfHashData(Identity,
+                                  &(File->Size),
+                                  sizeof(File->Size));
+
+        Identity = ImpElfHashData(Identity,
+                                  &(File->ModificationDate),
+                                  sizeof(File->ModificationDate));
+
+        return Identity;
+    }
+
+    //
+    // Images the kernel loaded (the executable and the dynamic linker) don't
+    // come with file information, so hash what they export instead.
+    //
+
+    SymbolCount = ImpElfGetSymbolCount(Image);
+    if (SymbolCount != 0) {
+        Identity = ImpElfHashData(Identity,
+                                  Image->ExportSymbolTable,
+                                  SymbolCount * sizeof(ELF_SYMBOL));
+
+        Identity = ImpElfHashData(Identity,
+                                  Image->ExportStringTable,
+                                  Image->ExportStringTableSize);
+    }
+
+    return Identity;
+}
+
@@ -38,11 +38,20 @@ Module Name:
 
 #include "imp.h"
 #include "elf.h"
+#include "elfcomm.h"
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the size of a relocation cache file path: the directory, a slash,
+// sixteen hex digits of key, and a terminator.
+//
+
+#define ELF_RELOCATION_CACHE_PATH_SIZE \
+    (sizeof(ELF_RELOCATION_CACHE_DIRECTORY) + 1 + 16)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -84,6 +93,18 @@ ImpElfPerformLibraryPathSubstitutions (
     PUINTN PathCapacity
     );
 
+VOID
+ImpElfGetRelocationCachePath (
+    ULONGLONG Key,
+    PSTR Path
+    );
+
+BOOL
+ImpElfValidateRelocationCache (
+    PELF_RELOCATION_CACHE Cache,
+    PELF_RELOCATION_CACHE_HEADER Saved
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -348,6 +369,376 @@ Return Value:
     return NULL;
 }
 
+ULONGLONG
+ImpElfHashData (
+    ULONGLONG Hash,
+    PCVOID Data,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds a region of memory into a running 64-bit hash.
+
+Arguments:
+
+    Hash - Supplies the hash so far.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Size - Supplies the size of the data in bytes.
+
+Return Value:
+
+    Returns the updated hash.
+
+--*/
+
+{
+
+    PCUCHAR Bytes;
+    const ULONG *Words;
+
+    Bytes = Data;
+    if (((UINTN)Bytes & (sizeof(ULONG) - 1)) == 0) {
+        Words = Data;
+        while (Size >= sizeof(ULONG)) {
+            Hash = (Hash ^ *Words) * ELF_DATA_HASH_PRIME;
+            Words += 1;
+            Size -= sizeof(ULONG);
+        }
+
+        Bytes = (PCUCHAR)Words;
+    }
+
+    while (Size != 0) {
+        Hash = (Hash ^ *Bytes) * ELF_DATA_HASH_PRIME;
+        Bytes += 1;
+        Size -= 1;
+    }
+
+    return Hash;
+}
+
+VOID
+ImpElfLoadRelocationCache (
+    PELF_RELOCATION_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the key of a persistent relocation cache whose image
+    records have been filled in, and loads the saved symbol resolutions for
+    that key if there are any.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+Return Value:
+
+    None. If no valid cache file exists, the entries are left untouched.
+
+--*/
+
+{
+
+    IMAGE_BUFFER Buffer;
+    UINTN EntriesSize;
+    IMAGE_FILE_INFORMATION File;
+    PELF_RELOCATION_CACHE_HEADER Header;
+    ULONGLONG Key;
+    CHAR Path[ELF_RELOCATION_CACHE_PATH_SIZE];
+    PELF_RELOCATION_CACHE_HEADER Saved;
+    KSTATUS Status;
+
+    Header = Cache->Header;
+
+    ASSERT((Header != NULL) && (Cache->ImageCount != 0));
+
+    //
+    // The key covers the layout of the file, the machine, and the identity
+    // and load address of every image. Anything that changes which symbol a
+    // name resolves to changes one of those.
+    //
+
+    Key = ImpElfHashData(ELF_DATA_HASH_SEED,
+                         Header,
+                         FIELD_OFFSET(ELF_RELOCATION_CACHE_HEADER, Key));
+
+    Key = ImpElfHashData(Key,
+                         &(Cache->Images[0]->Machine),
+                         sizeof(IMAGE_MACHINE_TYPE));
+
+    Key = ImpElfHashData(Key,
+                         Header + 1,
+                         Cache->ImageCount *
+                         sizeof(ELF_RELOCATION_CACHE_IMAGE));
+
+    Header->Key = Key;
+    ImpElfGetRelocationCachePath(Key, Path);
+    RtlZeroMemory(&File, sizeof(IMAGE_FILE_INFORMATION));
+    RtlZeroMemory(&Buffer, sizeof(IMAGE_BUFFER));
+    File.Handle = INVALID_HANDLE;
+    Status = ImOpenCacheFile(Cache->SystemContext, Path, &File);
+    if (!KSUCCESS(Status)) {
+        return;
+    }
+
+    if (File.Size != Cache->Size) {
+        goto LoadRelocationCacheEnd;
+    }
+
+    Status = ImLoadFile(&File, &Buffer);
+    if (!KSUCCESS(Status)) {
+        goto LoadRelocationCacheEnd;
+    }
+
+    Saved = Buffer.Data;
+    if ((Buffer.Size < Cache->Size) ||
+        (ImpElfValidateRelocationCache(Cache, Saved) == FALSE)) {
+
+        goto LoadRelocationCacheEnd;
+    }
+
+    EntriesSize = Header->EntryCount * sizeof(ELF_SYMBOL_CACHE_ENTRY);
+    RtlCopyMemory((PUCHAR)Header + Cache->Size - EntriesSize,
+                  (PUCHAR)Saved + Cache->Size - EntriesSize,
+                  EntriesSize);
+
+LoadRelocationCacheEnd:
+    if (Buffer.Data != NULL) {
+        ImUnloadBuffer(&File, &Buffer);
+    }
+
+    ImCloseFile(&File);
+    return;
+}
+
+VOID
+ImpElfRecordCachedSymbol (
+    PELF_RELOCATION_CACHE Cache,
+    PELF_SYMBOL_CACHE_ENTRY Entry,
+    ULONGLONG Value,
+    PLOADED_IMAGE Image
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records a symbol resolution in the relocation cache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+    Entry - Supplies a pointer to the entry to fill in.
+
+    Value - Supplies the final value of the symbol.
+
+    Image - Supplies an optional pointer to the image that defined the symbol.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG ImageIndex;
+
+    ImageIndex = ELF_SYMBOL_CACHE_NO_IMAGE;
+    if (Image != NULL) {
+        for (ImageIndex = 0;
+             ImageIndex < Cache->ImageCount;
+             ImageIndex += 1) {
+
+            if (Cache->Images[ImageIndex] == Image) {
+                break;
+            }
+        }
+
+        //
+        // Don't cache symbols that came from somewhere other than the list,
+        // as there would be no way to find the image again.
+        //
+
+        if (ImageIndex == Cache->ImageCount) {
+            return;
+        }
+    }
+
+    Entry->Value = Value;
+    Entry->ImageIndex = ImageIndex;
+    Entry->Flags = ELF_SYMBOL_CACHE_VALID;
+    Cache->Dirty = TRUE;
+    return;
+}
+
+VOID
+ImpElfDestroyRelocationCache (
+    PELF_RELOCATION_CACHE Cache,
+    BOOL Save
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tears down a relocation cache, saving it first if it is
+    persistent and has changed.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+    Save - Supplies a boolean indicating whether the relocations succeeded
+        and the cache is worth saving.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN EntriesSize;
+    PELF_RELOCATION_CACHE_HEADER Header;
+    CHAR Path[ELF_RELOCATION_CACHE_PATH_SIZE];
+
+    Header = Cache->Header;
+    if ((Header != NULL) &&
+        (Save != FALSE) &&
+        (Cache->Persistent != FALSE) &&
+        (Cache->Dirty != FALSE) &&
+        (ImSaveFile != NULL)) {
+
+        EntriesSize = Header->EntryCount * sizeof(ELF_SYMBOL_CACHE_ENTRY);
+        Header->Checksum = ImpElfHashData(ELF_DATA_HASH_SEED,
+                                          (PUCHAR)Header + Cache->Size -
+                                          EntriesSize,
+                                          EntriesSize);
+
+        //
+        // Failing to save the cache just means the next process does the
+        // lookups too.
+        //
+
+        ImpElfGetRelocationCachePath(Header->Key, Path);
+        ImSaveFile(Cache->SystemContext, Path, Header, Cache->Size);
+    }
+
+    if (Header != NULL) {
+        ImFreeMemory(Header);
+        Cache->Header = NULL;
+    }
+
+    if (Cache->Images != NULL) {
+        ImFreeMemory(Cache->Images);
+        Cache->Images = NULL;
+    }
+
+    Cache->ImageCount = 0;
+    return;
+}
+
+PELF_SCOPE_CACHE
+ImpElfAcquireScopeCache (
+    PLOADED_IMAGE Image
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets exclusive use of the scope symbol cache of the given
+    image, creating it if needed and discarding stale entries.
+
+Arguments:
+
+    Image - Supplies a pointer to the image whose scope is being searched.
+
+Return Value:
+
+    Returns a pointer to the scope cache, which must be released with
+    ImpElfReleaseScopeCache.
+
+    NULL if the cache could not be allocated or another thread is using it.
+
+--*/
+
+{
+
+    PELF_SCOPE_CACHE Cache;
+    ULONG Generation;
+    UINTN Previous;
+
+    Cache = Image->SymbolCache;
+    if (Cache == NULL) {
+        Cache = ImAllocateMemory(sizeof(ELF_SCOPE_CACHE), IM_ALLOCATION_TAG);
+        if (Cache == NULL) {
+            return NULL;
+        }
+
+        RtlZeroMemory(Cache, sizeof(ELF_SCOPE_CACHE));
+        Cache->Generation = ImSymbolCacheGeneration;
+        Previous = RtlAtomicCompareExchange(&(Image->SymbolCache),
+                                            (UINTN)Cache,
+                                            (UINTN)NULL);
+
+        if (Previous != (UINTN)NULL) {
+            ImFreeMemory(Cache);
+            Cache = (PELF_SCOPE_CACHE)Previous;
+        }
+    }
+
+    if (RtlAtomicCompareExchange32(&(Cache->Busy), 1, 0) != 0) {
+        return NULL;
+    }
+
+    Generation = ImSymbolCacheGeneration;
+    if (Cache->Generation != Generation) {
+        RtlZeroMemory(Cache->Entries, sizeof(Cache->Entries));
+        Cache->Generation = Generation;
+    }
+
+    return Cache;
+}
+
+VOID
+ImpElfReleaseScopeCache (
+    PELF_SCOPE_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases a scope cache acquired by ImpElfAcquireScopeCache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the cache to release.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RtlAtomicExchange32(&(Cache->Busy), 0);
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -601,3 +992,145 @@ Return Value:
     return Status;
 }
 
+VOID
+ImpElfGetRelocationCachePath (
+    ULONGLONG Key,
+    PSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the path of the relocation cache file for the given
+    key.
+
+Arguments:
+
+    Key - Supplies the relocation cache key.
+
+    Path - Supplies a pointer to a buffer of ELF_RELOCATION_CACHE_PATH_SIZE
+        bytes where the path will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Digit;
+    INTN Index;
+
+    RtlCopyMemory(Path,
+                  ELF_RELOCATION_CACHE_DIRECTORY,
+                  sizeof(ELF_RELOCATION_CACHE_DIRECTORY) - 1);
+
+    Path += sizeof(ELF_RELOCATION_CACHE_DIRECTORY) - 1;
+    *Path = '/';
+    Path += 1;
+    for (Index = 15; Index >= 0; Index -= 1) {
+        Digit = (ULONG)(Key >> (Index * 4)) & 0xF;
+        if (Digit < 10) {
+            *Path = '0' + Digit;
+
+        } else {
+            *Path = 'A' + Digit - 10;
+        }
+
+        Path += 1;
+    }
+
+    *Path = '\0';
+    return;
+}
+
+BOOL
+ImpElfValidateRelocationCache (
+    PELF_RELOCATION_CACHE Cache,
+    PELF_RELOCATION_CACHE_HEADER Saved
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a saved relocation cache file matches the
+    given cache and is intact.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache, whose key and image
+        records are filled in.
+
+    Saved - Supplies a pointer to the saved cache contents, which are the same
+        size as the cache.
+
+Return Value:
+
+    TRUE if the saved cache can be used.
+
+    FALSE if it is for different images or is corrupt.
+
+--*/
+
+{
+
+    ULONGLONG Checksum;
+    PELF_SYMBOL_CACHE_ENTRY Entries;
+    UINTN EntriesSize;
+    ULONG EntryIndex;
+    PELF_RELOCATION_CACHE_HEADER Header;
+    ULONG ImageIndex;
+    BOOL Match;
+
+    Header = Cache->Header;
+
+    //
+    // Everything up to the checksum, and all the image records, must match
+    // exactly.
+    //
+
+    Match = RtlCompareMemory(Saved,
+                             Header,
+                             FIELD_OFFSET(ELF_RELOCATION_CACHE_HEADER,
+                                          Checksum));
+
+    if (Match == FALSE) {
+        return FALSE;
+    }
+
+    Match = RtlCompareMemory(Saved + 1,
+                             Header + 1,
+                             Header->ImageCount *
+                             sizeof(ELF_RELOCATION_CACHE_IMAGE));
+
+    if (Match == FALSE) {
+        return FALSE;
+    }
+
+    EntriesSize = Header->EntryCount * sizeof(ELF_SYMBOL_CACHE_ENTRY);
+    Entries = (PVOID)((PUCHAR)Saved + Cache->Size - EntriesSize);
+    Checksum = ImpElfHashData(ELF_DATA_HASH_SEED, Entries, EntriesSize);
+    if (Checksum != Saved->Checksum) {
+        return FALSE;
+    }
+
+    for (EntryIndex = 0; EntryIndex < Header->EntryCount; EntryIndex += 1) {
+        if ((Entries[EntryIndex].Flags & ~ELF_SYMBOL_CACHE_VALID) != 0) {
+            return FALSE;
+        }
+
+        ImageIndex = Entries[EntryIndex].ImageIndex;
+        if (((Entries[EntryIndex].Flags & ELF_SYMBOL_CACHE_VALID) != 0) &&
+            (ImageIndex != ELF_SYMBOL_CACHE_NO_IMAGE) &&
+            (ImageIndex >= Header->ImageCount)) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
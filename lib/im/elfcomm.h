@@ -31,10 +31,234 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the directory the persistent relocation cache lives in. The cache is
+// only used if this directory exists. Whoever can write to it controls how
+// the programs that use it get linked, so it should only be writable by the
+// administrator.
+//
+
+#define ELF_RELOCATION_CACHE_DIRECTORY "/var/cache/ld"
+
+//
+// Define the name of the environment variable that, if set, prevents the
+// persistent relocation cache from being used.
+//
+
+#define ELF_NO_RELOCATION_CACHE "LD_NO_RELOCATION_CACHE"
+
+#define ELF_RELOCATION_CACHE_MAGIC 0x43526C45 // 'ElRC'
+#define ELF_RELOCATION_CACHE_VERSION 1
+
+//
+// Define the seed and multiplier of the hash used to identify images and
+// relocation caches (64-bit FNV-1a, folded a word at a time).
+//
+
+#define ELF_DATA_HASH_SEED 0xCBF29CE484222325ULL
+#define ELF_DATA_HASH_PRIME 0x00000100000001B3ULL
+
+//
+// Define the image index of a symbol cache entry that was not defined by any
+// image, such as an undefined weak symbol.
+//
+
+#define ELF_SYMBOL_CACHE_NO_IMAGE MAX_ULONG
+
+//
+// Define symbol cache entry flags.
+//
+
+#define ELF_SYMBOL_CACHE_VALID 0x00000001
+
+//
+// Define the number of entries in each image's scope symbol cache.
+//
+
+#define ELF_SCOPE_CACHE_SIZE 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure stores the header of a persistent relocation cache file.
+    It is followed by an array of image records and then an array of symbol
+    cache entries.
+
+Members:
+
+    Magic - Stores the constant ELF_RELOCATION_CACHE_MAGIC.
+
+    Version - Stores the constant ELF_RELOCATION_CACHE_VERSION.
+
+    ImageCount - Stores the number of image records that follow.
+
+    EntryCount - Stores the total number of symbol cache entries after the
+        image records.
+
+    Key - Stores the hash of the image records, which also names the file.
+
+    Checksum - Stores the hash of the symbol cache entries.
+
+--*/
+
+typedef struct _ELF_RELOCATION_CACHE_HEADER {
+    ULONG Magic;
+    ULONG Version;
+    ULONG ImageCount;
+    ULONG EntryCount;
+    ULONGLONG Key;
+    ULONGLONG Checksum;
+} ELF_RELOCATION_CACHE_HEADER, *PELF_RELOCATION_CACHE_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure stores the record for one image in the relocation cache.
+    There is one for each image on the list, in list order.
+
+Members:
+
+    Identity - Stores a hash identifying the image file and its contents.
+
+    Base - Stores the address the image was loaded at.
+
+    SymbolCount - Stores the number of symbol cache entries that belong to
+        this image. This is zero for images that were already relocated.
+
+    EntryIndex - Stores the index of this image's first symbol cache entry.
+
+--*/
+
+typedef struct _ELF_RELOCATION_CACHE_IMAGE {
+    ULONGLONG Identity;
+    ULONGLONG Base;
+    ULONG SymbolCount;
+    ULONG EntryIndex;
+} ELF_RELOCATION_CACHE_IMAGE, *PELF_RELOCATION_CACHE_IMAGE;
+
+/*++
+
+Structure Description:
+
+    This structure stores the resolution of a single dynamic symbol, indexed
+    by the symbol's index in the symbol table of the image being relocated.
+
+Members:
+
+    Value - Stores the final symbol value.
+
+    ImageIndex - Stores the index of the image that defined the symbol, or
+        ELF_SYMBOL_CACHE_NO_IMAGE.
+
+    Flags - Stores a bitfield of flags. See ELF_SYMBOL_CACHE_* definitions.
+
+--*/
+
+typedef struct _ELF_SYMBOL_CACHE_ENTRY {
+    ULONGLONG Value;
+    ULONG ImageIndex;
+    ULONG Flags;
+} ELF_SYMBOL_CACHE_ENTRY, *PELF_SYMBOL_CACHE_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure stores the symbol resolutions made while relocating a list
+    of images. Every symbol is resolved by name at most once per image. When
+    the cache is persistent, the resolutions are also saved to a file named by
+    the identity and load address of every image on the list, so the next
+    process that loads exactly the same images at the same addresses can skip
+    the lookups altogether.
+
+Members:
+
+    SystemContext - Stores the system context of the images.
+
+    Images - Stores an array of pointers to the images on the list.
+
+    ImageCount - Stores the number of images on the list.
+
+    Header - Stores a pointer to the cache contents, which are laid out
+        exactly as the persistent cache file.
+
+    Size - Stores the size of the cache contents in bytes.
+
+    Persistent - Stores a boolean indicating whether the cache is loaded from
+        and saved to a file.
+
+    Dirty - Stores a boolean indicating whether new entries were added since
+        the cache was loaded.
+
+--*/
+
+typedef struct _ELF_RELOCATION_CACHE {
+    PVOID SystemContext;
+    PLOADED_IMAGE *Images;
+    ULONG ImageCount;
+    PELF_RELOCATION_CACHE_HEADER Header;
+    UINTN Size;
+    BOOL Persistent;
+    BOOL Dirty;
+} ELF_RELOCATION_CACHE, *PELF_RELOCATION_CACHE;
+
+/*++
+
+Structure Description:
+
+    This structure stores a symbol recently looked up in an image's scope.
+
+Members:
+
+    Hash - Stores the GNU hash of the symbol name.
+
+    Skip - Stores the image that was skipped during the lookup.
+
+    Image - Stores the image the symbol was found in.
+
+    Symbol - Stores a pointer to the ELF symbol.
+
+--*/
+
+typedef struct _ELF_SCOPE_CACHE_ENTRY {
+    ULONG Hash;
+    PLOADED_IMAGE Skip;
+    PLOADED_IMAGE Image;
+    PVOID Symbol;
+} ELF_SCOPE_CACHE_ENTRY, *PELF_SCOPE_CACHE_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure stores the scope symbol cache of an image, which saves
+    repeated lookups of the same name by programs that call dlsym often.
+
+Members:
+
+    Busy - Stores a flag that is set while a thread is using the cache.
+        Lookups happen under a shared lock, so a thread that finds the cache
+        busy simply bypasses it.
+
+    Generation - Stores the value of the symbol cache generation when the
+        entries were last valid.
+
+    Entries - Stores the direct-mapped array of cache entries.
+
+--*/
+
+typedef struct _ELF_SCOPE_CACHE {
+    volatile ULONG Busy;
+    ULONG Generation;
+    ELF_SCOPE_CACHE_ENTRY Entries[ELF_SCOPE_CACHE_SIZE];
+} ELF_SCOPE_CACHE, *PELF_SCOPE_CACHE;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -145,3 +369,156 @@ Return Value:
     NULL if the given environment variable is not set.
 
 --*/
+
+ULONGLONG
+ImpElfHashData (
+    ULONGLONG Hash,
+    PCVOID Data,
+    UINTN Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds a region of memory into a running 64-bit hash.
+
+Arguments:
+
+    Hash - Supplies the hash so far.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Size - Supplies the size of the data in bytes.
+
+Return Value:
+
+    Returns the updated hash.
+
+--*/
+
+VOID
+ImpElfLoadRelocationCache (
+    PELF_RELOCATION_CACHE Cache
+    );
+
+/*++
+
+Routine Description:
+
+    This routine computes the key of a persistent relocation cache whose image
+    records have been filled in, and loads the saved symbol resolutions for
+    that key if there are any.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+Return Value:
+
+    None. If no valid cache file exists, the entries are left untouched.
+
+--*/
+
+VOID
+ImpElfRecordCachedSymbol (
+    PELF_RELOCATION_CACHE Cache,
+    PELF_SYMBOL_CACHE_ENTRY Entry,
+    ULONGLONG Value,
+    PLOADED_IMAGE Image
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records a symbol resolution in the relocation cache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+    Entry - Supplies a pointer to the entry to fill in.
+
+    Value - Supplies the final value of the symbol.
+
+    Image - Supplies an optional pointer to the image that defined the symbol.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+ImpElfDestroyRelocationCache (
+    PELF_RELOCATION_CACHE Cache,
+    BOOL Save
+    );
+
+/*++
+
+Routine Description:
+
+    This routine tears down a relocation cache, saving it first if it is
+    persistent and has changed.
+
+Arguments:
+
+    Cache - Supplies a pointer to the relocation cache.
+
+    Save - Supplies a boolean indicating whether the relocations succeeded
+        and the cache is worth saving.
+
+Return Value:
+
+    None.
+
+--*/
+
+PELF_SCOPE_CACHE
+ImpElfAcquireScopeCache (
+    PLOADED_IMAGE Image
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets exclusive use of the scope symbol cache of the given
+    image, creating it if needed and discarding stale entries.
+
+Arguments:
+
+    Image - Supplies a pointer to the image whose scope is being searched.
+
+Return Value:
+
+    Returns a pointer to the scope cache, which must be released with
+    ImpElfReleaseScopeCache.
+
+    NULL if the cache could not be allocated or another thread is using it.
+
+--*/
+
+VOID
+ImpElfReleaseScopeCache (
+    PELF_SCOPE_CACHE Cache
+    );
+
+/*++
+
+Routine Description:
+
+    This routine releases a scope cache acquired by ImpElfAcquireScopeCache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the cache to release.
+
+Return Value:
+
+    None.
+
+--*/
+
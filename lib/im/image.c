@@ -98,6 +98,12 @@ PIM_IMPORT_TABLE ImImportTable = NULL;
 
 PLOADED_IMAGE ImPrimaryExecutable = NULL;
 
+//
+// Store the generation number of the image symbol caches.
+//
+
+ULONG ImSymbolCacheGeneration;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -500,6 +506,12 @@ Return Value:
     ImNotifyImageUnload(Image);
     ImpUnloadImage(Image);
     LIST_REMOVE(&(Image->ListEntry));
+
+    //
+    // Other images may have cached symbols that point into this one.
+    //
+
+    RtlAtomicAdd32(&ImSymbolCacheGeneration, 1);
     if (Image->AllocatorHandle != INVALID_HANDLE) {
         ImFreeAddressSpace(Image);
     }
@@ -516,6 +528,10 @@ Return Value:
         ImFreeMemory(Image->Scope);
     }
 
+    if (Image->SymbolCache != NULL) {
+        ImFreeMemory(Image->SymbolCache);
+    }
+
     ImFreeMemory(Image);
     return;
 }
@@ -1577,6 +1593,7 @@ Return Value:
 
     Image->Scope[Size] = Element;
     Image->ScopeSize += 1;
+    RtlAtomicAdd32(&ImSymbolCacheGeneration, 1);
     return STATUS_SUCCESS;
 }
 
@@ -62,6 +62,8 @@ Module Name:
 
 #define ImGetEnvironmentVariable ImImportTable->GetEnvironmentVariable
 #define ImFinalizeSegments ImImportTable->FinalizeSegments
+#define ImSaveFile ImImportTable->SaveFile
+#define ImOpenCacheFile ImImportTable->OpenCacheFile
 
 //
 // Define the initial scope array size.
@@ -90,6 +92,14 @@ Module Name:
 
 extern PIM_IMPORT_TABLE ImImportTable;
 
+//
+// Store the symbol cache generation number. This is incremented whenever an
+// image's scope changes or an image is unloaded, which invalidates every
+// image's cached symbol lookups.
+//
+
+extern ULONG ImSymbolCacheGeneration;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
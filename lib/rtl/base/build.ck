@@ -80,6 +80,7 @@ function build() {
     ];
 
     x86Sources = x86Intrinsics + [
+        "x86/crc32hw.S",
         "x86/rtlarch.S",
         "x86/rtlmem.S"
     ];
@@ -90,6 +91,7 @@ function build() {
     ];
 
     armv7Sources = armv7Intrinsics + [
+        "armv7/crc32hw.S",
         "armv7/rtlarch.S",
         "armv7/rtlmem.S",
         "fp2int.c"
@@ -102,6 +104,7 @@ function build() {
 
     armv7BootSources = armv7Intrinsics + [
         "armv7/aeabisfp.c",
+        "armv7/crc32hw.S",
         "armv7/rtlmem.S",
         "boot/armv7/rtlarch.S",
         "fp2int.c",
@@ -109,6 +112,7 @@ function build() {
     ];
 
     x64Sources = [
+        "x64/crc32hw.S",
         "x64/rtlarch.S",
         "x64/rtlmem.S"
     ];
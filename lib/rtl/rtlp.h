@@ -360,3 +360,33 @@ Return Value:
 
 --*/
 
+ULONG
+RtlpComputeCrc32Hardware (
+    ULONG Crc,
+    PCVOID Buffer,
+    ULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds a buffer into a CRC-32 using the processor's CRC
+    instructions. It is implemented for each architecture that has them.
+
+Arguments:
+
+    Crc - Supplies the current CRC register value, which is the inverse of the
+        CRC of the data so far.
+
+    Buffer - Supplies a pointer to the data, which need not be aligned.
+
+    Size - Supplies the number of bytes to fold in. This must be a multiple of
+        16 and at least 64.
+
+Return Value:
+
+    Returns the updated CRC register value.
+
+--*/
+
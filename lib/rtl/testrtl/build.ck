@@ -34,6 +34,7 @@ function build() {
     var sources;
 
     sources = [
+        "crctest.c",
         "fpstest.c",
         "fptest.c",
         "heaptest.c",
@@ -0,0 +1,454 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    crctest.c
+
+Abstract:
+
+    This module implements the tests for the runtime library CRC-32 routine.
+
+Environment:
+
+    Test
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define RTL_API
+
+#include <minoca/lib/types.h>
+#include <minoca/lib/status.h>
+#include <minoca/lib/rtl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__i386) || defined(__amd64)
+
+#include <cpuid.h>
+
+#endif
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define TEST_CRC_POLYNOMIAL 0xEDB88320
+
+//
+// Define the check value for the standard "123456789" test string.
+//
+
+#define TEST_CRC_CHECK_STRING "123456789"
+#define TEST_CRC_CHECK_VALUE 0xCBF43926
+
+//
+// Define the sizes used for the exhaustive comparison against the bitwise
+// reference.
+//
+
+#define TEST_CRC_BUFFER_SIZE 1024
+#define TEST_CRC_MAX_OFFSET 16
+#define TEST_CRC_MAX_LENGTH 600
+
+//
+// Define the size and number of passes over the buffer used to measure
+// throughput.
+//
+
+#define TEST_CRC_THROUGHPUT_SIZE (16 * _1MB)
+#define TEST_CRC_THROUGHPUT_PASSES 8
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+TestCrc32Path (
+    PCSTR Name
+    );
+
+ULONG
+TestCrc32Reference (
+    ULONG InitialCrc,
+    PCVOID Buffer,
+    ULONG Size
+    );
+
+ULONG
+TestCrc32MeasurePath (
+    PCSTR Name,
+    PUCHAR Buffer
+    );
+
+BOOL
+TestCrc32HardwareSupported (
+    VOID
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+ULONG
+TestCrc32 (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests the CRC-32 routine against a simple bitwise
+    implementation at every alignment and a range of lengths. The lookup
+    tables are always tested, and the processor's CRC instructions are tested
+    too if the machine has them.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    ULONG Failures;
+
+    RtlEnableHardwareCrc32(FALSE);
+    Failures = TestCrc32Path("tables");
+    if (TestCrc32HardwareSupported() != FALSE) {
+        RtlEnableHardwareCrc32(TRUE);
+        Failures += TestCrc32Path("hardware");
+        RtlEnableHardwareCrc32(FALSE);
+    }
+
+    if (Failures != 0) {
+        printf("%d Crc32 failures.\n", Failures);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestCrc32Throughput (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures and prints the throughput of the CRC-32 routine,
+    using the lookup tables and then the processor's CRC instructions if the
+    machine has them.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    PUCHAR Buffer;
+    ULONG Failures;
+    ULONG Index;
+
+    Buffer = malloc(TEST_CRC_THROUGHPUT_SIZE);
+    if (Buffer == NULL) {
+        printf("Crc32: Failed to allocate throughput buffer.\n");
+        return 1;
+    }
+
+    for (Index = 0; Index < TEST_CRC_THROUGHPUT_SIZE; Index += 1) {
+        Buffer[Index] = Index ^ (Index >> 8);
+    }
+
+    RtlEnableHardwareCrc32(FALSE);
+    Failures = TestCrc32MeasurePath("tables", Buffer);
+    if (TestCrc32HardwareSupported() != FALSE) {
+        RtlEnableHardwareCrc32(TRUE);
+        Failures += TestCrc32MeasurePath("hardware", Buffer);
+        RtlEnableHardwareCrc32(FALSE);
+    }
+
+    free(Buffer);
+    return Failures;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+TestCrc32Path (
+    PCSTR Name
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests whichever CRC-32 path is currently selected against
+    the bitwise reference.
+
+Arguments:
+
+    Name - Supplies the name of the path being tested, for error messages.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    UCHAR Buffer[TEST_CRC_BUFFER_SIZE];
+    ULONG Correct;
+    ULONG Crc;
+    ULONG Failures;
+    ULONG Index;
+    ULONG Length;
+    ULONG Offset;
+    ULONG Split;
+
+    Failures = 0;
+    Crc = RtlComputeCrc32(0,
+                          TEST_CRC_CHECK_STRING,
+                          sizeof(TEST_CRC_CHECK_STRING) - 1);
+
+    if (Crc != TEST_CRC_CHECK_VALUE) {
+        printf("Crc32 (%s): Check value was 0x%08x, expected 0x%08x.\n",
+               Name,
+               Crc,
+               TEST_CRC_CHECK_VALUE);
+
+        Failures += 1;
+    }
+
+    for (Index = 0; Index < TEST_CRC_BUFFER_SIZE; Index += 1) {
+        Buffer[Index] = rand();
+    }
+
+    for (Offset = 0; Offset < TEST_CRC_MAX_OFFSET; Offset += 1) {
+        for (Length = 0; Length < TEST_CRC_MAX_LENGTH; Length += 1) {
+            Correct = TestCrc32Reference(0, Buffer + Offset, Length);
+            Crc = RtlComputeCrc32(0, Buffer + Offset, Length);
+            if (Crc != Correct) {
+                printf("Crc32 (%s): Offset %d length %d got 0x%08x, "
+                       "expected 0x%08x.\n",
+                       Name,
+                       Offset,
+                       Length,
+                       Crc,
+                       Correct);
+
+                Failures += 1;
+            }
+
+            //
+            // Computing the CRC in two pieces should get the same answer.
+            //
+
+            Split = Length / 3;
+            Crc = RtlComputeCrc32(0, Buffer + Offset, Split);
+            Crc = RtlComputeCrc32(Crc,
+                                  Buffer + Offset + Split,
+                                  Length - Split);
+
+            if (Crc != Correct) {
+                printf("Crc32 (%s): Offset %d length %d split at %d got "
+                       "0x%08x, expected 0x%08x.\n",
+                       Name,
+                       Offset,
+                       Length,
+                       Split,
+                       Crc,
+                       Correct);
+
+                Failures += 1;
+            }
+        }
+    }
+
+    return Failures;
+}
+
+ULONG
+TestCrc32Reference (
+    ULONG InitialCrc,
+    PCVOID Buffer,
+    ULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the CRC-32 of the given buffer one bit at a time.
+
+Arguments:
+
+    InitialCrc - Supplies an initial CRC value to start with.
+
+    Buffer - Supplies a pointer to the buffer to compute the CRC32 of.
+
+    Size - Supplies the size of the buffer, in bytes.
+
+Return Value:
+
+    Returns the CRC32 of the buffer.
+
+--*/
+
+{
+
+    ULONG Bit;
+    PCUCHAR Byte;
+    ULONG Crc;
+    ULONG Index;
+
+    Byte = Buffer;
+    Crc = InitialCrc ^ 0xFFFFFFFF;
+    for (Index = 0; Index < Size; Index += 1) {
+        Crc ^= Byte[Index];
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            if ((Crc & 0x1) != 0) {
+                Crc = (Crc >> 1) ^ TEST_CRC_POLYNOMIAL;
+
+            } else {
+                Crc >>= 1;
+            }
+        }
+    }
+
+    return Crc ^ 0xFFFFFFFF;
+}
+
+ULONG
+TestCrc32MeasurePath (
+    PCSTR Name,
+    PUCHAR Buffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures and prints the throughput of whichever CRC-32 path
+    is currently selected.
+
+Arguments:
+
+    Name - Supplies the name of the path being measured.
+
+    Buffer - Supplies a pointer to the data to run through the CRC, which is
+        TEST_CRC_THROUGHPUT_SIZE bytes long.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    clock_t Clocks;
+    ULONG Crc;
+    ULONG Index;
+    ULONGLONG Rate;
+    clock_t Start;
+
+    Crc = 0;
+    Start = clock();
+    for (Index = 0; Index < TEST_CRC_THROUGHPUT_PASSES; Index += 1) {
+        Crc = RtlComputeCrc32(Crc, Buffer, TEST_CRC_THROUGHPUT_SIZE);
+    }
+
+    Clocks = clock() - Start;
+    if (Clocks <= 0) {
+        Clocks = 1;
+    }
+
+    Rate = (ULONGLONG)TEST_CRC_THROUGHPUT_SIZE * TEST_CRC_THROUGHPUT_PASSES *
+           CLOCKS_PER_SEC / Clocks / _1MB;
+
+    printf("Crc32 (%s): %lld MB/s (0x%08x).\n", Name, Rate, Crc);
+    return 0;
+}
+
+BOOL
+TestCrc32HardwareSupported (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the build machine has the instructions
+    the hardware CRC-32 path needs.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the hardware path can be tested.
+
+    FALSE if the processor lacks the instructions or there's no way to tell.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+    unsigned int Eax;
+    unsigned int Ebx;
+    unsigned int Ecx;
+    unsigned int Edx;
+
+    if (__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx) == 0) {
+        return FALSE;
+    }
+
+    if ((Ecx & bit_PCLMUL) != 0) {
+        return TRUE;
+    }
+
+#endif
+
+    return FALSE;
+}
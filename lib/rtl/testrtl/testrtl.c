@@ -48,6 +48,16 @@ Module Name:
 
 #define MAX_OUTPUT 1000
 
+//
+// Define the usage text. Throughput measurements take a while, so they're
+// only run when asked for.
+//
+
+#define TESTRTL_USAGE \
+    "usage: testrtl [-p]\n\n" \
+    "Tests the runtime library.\n\n" \
+    "    -p  Also measure CRC-32 throughput.\n"
+
 //
 // Print format test values
 //
@@ -418,6 +428,16 @@ TestHeaps (
     BOOL Quiet
     );
 
+ULONG
+TestCrc32 (
+    VOID
+    );
+
+ULONG
+TestCrc32Throughput (
+    VOID
+    );
+
 ULONG
 TestSoftFloatSingle (
     VOID
@@ -581,9 +601,11 @@ Return Value:
 
 {
 
+    PSTR Argument;
     int BytesPrinted;
     ULONGLONG Dividend;
     ULONGLONG Divisor;
+    BOOL Performance;
     ULONGLONG Quotient;
     ULONGLONG Remainder;
     LONGLONG SignedDividend;
@@ -593,12 +615,36 @@ Return Value:
     ULONG StringLength;
     ULONG TestsFailed;
 
+    Performance = FALSE;
+
+    //
+    // Process the command line options.
+    //
+
+    while ((ArgumentCount > 1) && (Arguments[1][0] == '-')) {
+        Argument = &(Arguments[1][1]);
+        if (strcmp(Argument, "p") == 0) {
+            Performance = TRUE;
+
+        } else {
+            printf("%s: Invalid option\n\n%s", Argument, TESTRTL_USAGE);
+            return 1;
+        }
+
+        ArgumentCount -= 1;
+        Arguments += 1;
+    }
+
     srand(time(NULL));
     TestsFailed = 0;
     TestsFailed += TestSoftFloatSingle();
     TestsFailed += TestSoftFloatDouble();
     TestsFailed += TestTime();
     TestsFailed += TestHeaps(TRUE);
+    TestsFailed += TestCrc32();
+    if (Performance != FALSE) {
+        TestsFailed += TestCrc32Throughput();
+    }
 
     //
     // Test basic unsigned division.